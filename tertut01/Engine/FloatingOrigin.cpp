@@ -0,0 +1,36 @@
+#include "pch.h"
+#include "FloatingOrigin.h"
+#include "WorldRebase.h"
+#include <chrono>
+
+/// Constructor to initialize the floating origin.
+/// @param threshold Distance from the origin that triggers a rebase.
+FloatingOrigin::FloatingOrigin(float threshold)
+    : threshold(threshold), m_accumulatedOffset(DirectX::SimpleMath::Vector3::Zero), m_lastRebaseMs(0.0f), m_rebaseCount(0)
+{
+}
+
+/// Checks whether the focus point has drifted far enough to require a rebase.
+/// Compares squared lengths to avoid a square root every frame.
+bool FloatingOrigin::NeedsRebase(const DirectX::SimpleMath::Vector3& focus) const
+{
+    return focus.LengthSquared() > threshold * threshold;
+}
+
+/// Translates the whole physics world by the given offset and times the pass.
+void FloatingOrigin::RebaseWorld(btDiscreteDynamicsWorld* world, const DirectX::SimpleMath::Vector3& offset)
+{
+    if (!world)
+    {
+        throw std::runtime_error("Failed to rebase origin: Invalid world.");
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+    RebaseBulletWorld(world, btVector3(offset.x, offset.y, offset.z));
+
+    m_accumulatedOffset += offset;
+    ++m_rebaseCount;
+
+    auto end = std::chrono::high_resolution_clock::now();
+    m_lastRebaseMs = std::chrono::duration<float, std::milli>(end - start).count();
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <btBulletDynamicsCommon.h>
+#include <SimpleMath.h>
+
+/// Keeps the simulation close to the world origin to avoid single-precision jitter.
+/// When the tracked focus point (usually the spaceship) drifts past a threshold distance,
+/// the whole Bullet world is translated back towards the origin in a single batched pass.
+/// Broadphase proxies are translated in place, so no proxy or pair is reallocated.
+class FloatingOrigin
+{
+public:
+    /// Constructor to initialize the floating origin.
+    /// @param threshold Distance from the origin that triggers a rebase.
+    explicit FloatingOrigin(float threshold = 2000.0f);
+
+    /// Checks whether the focus point has drifted far enough to require a rebase.
+    /// @param focus The position being tracked, in current world space.
+    /// @return True if the focus is further than the threshold from the origin.
+    bool NeedsRebase(const DirectX::SimpleMath::Vector3& focus) const;
+
+    /// Translates every collision object, motion state, broadphase volume and cached contact point.
+    /// The rest of the game (camera, orbit centres) must be shifted by the same offset by the caller.
+    /// @param world Pointer to the Bullet physics dynamics world.
+    /// @param offset The translation to apply to all world-space positions.
+    void RebaseWorld(btDiscreteDynamicsWorld* world, const DirectX::SimpleMath::Vector3& offset);
+
+    /// Retrieves the total translation applied since startup.
+    /// Subtracting it from a local position gives the absolute (universe) position.
+    /// @return The accumulated offset.
+    DirectX::SimpleMath::Vector3 GetAccumulatedOffset() const { return m_accumulatedOffset; }
+
+    /// Retrieves the cost of the last rebase.
+    /// @return Duration of the last RebaseWorld call in milliseconds.
+    float GetLastRebaseMs() const { return m_lastRebaseMs; }
+
+    /// Retrieves the number of rebases performed so far.
+    /// @return The rebase count.
+    int GetRebaseCount() const { return m_rebaseCount; }
+
+    float threshold; ///< Distance from the origin that triggers a rebase.
+
+private:
+    DirectX::SimpleMath::Vector3 m_accumulatedOffset; ///< Total translation applied since startup.
+    float m_lastRebaseMs; ///< Duration of the last rebase in milliseconds.
+    int m_rebaseCount; ///< Number of rebases performed.
+};
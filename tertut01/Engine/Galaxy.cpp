@@ -0,0 +1,151 @@
+#include "pch.h"
+#include "Galaxy.h"
+
+using namespace DirectX::SimpleMath;
+
+/// Constructor for the Galaxy.
+/// Sectors are 4000 units wide and hold at most four systems, so a resident cube of
+/// (2 * loadRadius + 3)^3 sectors of the streamer bounds both memory and generation work.
+Galaxy::Galaxy(ID3D11Device* device, btDiscreteDynamicsWorld* dynamicsWorld,
+    const std::vector<Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>>& textures, uint64_t seed)
+    : m_Device(device), m_DynamicsWorld(dynamicsWorld), m_Textures(textures), m_Streamer(SectorGenerator(seed, 4000.0f, 4))
+{
+}
+
+/// Streams sectors in and out and updates the active planetary systems.
+void Galaxy::Update(float deltaTime, const Vector3& shipPos, const Vector3& originOffset)
+{
+    Vector3 universePos = shipPos - originOffset;
+    SectorCoord center = m_Streamer.GetGenerator().GetSector(universePos.x, universePos.y, universePos.z);
+
+    m_Evicted.clear();
+    m_Streamer.Update(center, &m_Evicted);
+
+    // Any active system seeded by an evicted sector is destroyed with it.
+    for (const StarSystemDesc& desc : m_Evicted)
+    {
+        m_ActiveSystems.erase(desc.id);
+    }
+    UpdateActivation(universePos, originOffset);
+
+    for (auto& [id, active] : m_ActiveSystems)
+    {
+        active.system->Update(deltaTime, shipPos);
+    }
+}
+
+/// Draws every loaded but inactive system as a camera-facing quad.
+void Galaxy::RenderImpostors(DirectX::PrimitiveBatch<DirectX::VertexPositionColor>& batch, const Vector3& cameraPos,
+    const Vector3& cameraRight, const Vector3& cameraUp, const Vector3& originOffset)
+{
+    batch.Begin();
+    for (auto& [coord, sector] : m_Streamer.GetSectors())
+    {
+        for (const StarSystemDesc& desc : sector.systems)
+        {
+            if (m_ActiveSystems.find(desc.id) != m_ActiveSystems.end())
+                continue;
+
+            Vector3 toStar = Vector3(desc.x, desc.y, desc.z) + originOffset - cameraPos;
+            float distance = toStar.Length();
+            if (distance < 1.0f)
+                continue;
+
+            // Project the star onto a sphere inside the far plane and keep it a few pixels wide.
+            Vector3 position = cameraPos + toStar * (std::min(distance, impostorDistance) / distance);
+            float halfSize = desc.starSize * std::max(2.0f, std::min(8.0f, 20000.0f / distance));
+            Vector3 right = cameraRight * halfSize;
+            Vector3 up = cameraUp * halfSize;
+            DirectX::XMFLOAT4 colour(desc.r, desc.g, desc.b, 1.0f);
+
+            DirectX::VertexPositionColor v1(position - right - up, colour);
+            DirectX::VertexPositionColor v2(position - right + up, colour);
+            DirectX::VertexPositionColor v3(position + right + up, colour);
+            DirectX::VertexPositionColor v4(position + right - up, colour);
+            batch.DrawQuad(v1, v2, v3, v4);
+        }
+    }
+    batch.End();
+}
+
+/// Renders the active planetary systems.
+void Galaxy::Render(ID3D11DeviceContext* context, Matrix view, Matrix projection, Light light,
+    Shader& shader, ModelClass& planetModel, ModelClass& haloModel)
+{
+    for (auto& [id, active] : m_ActiveSystems)
+    {
+        active.system->Render(context, view, projection, light, shader, planetModel, haloModel);
+    }
+}
+
+/// Shifts the active systems after a floating-origin rebase.
+/// Sector data is stored in universe space and does not need to move.
+void Galaxy::ShiftOrigin(const Vector3& offset)
+{
+    for (auto& [id, active] : m_ActiveSystems)
+    {
+        active.system->ShiftOrigin(offset);
+    }
+}
+
+/// Appends the surfaces of every planet in the active systems.
+void Galaxy::CollectSurfaces(std::vector<PlanetSurface>& surfaces) const
+{
+    for (const auto& [id, active] : m_ActiveSystems)
+    {
+        active.system->CollectSurfaces(surfaces);
+    }
+}
+
+/// Retrieves the number of planets across the active systems.
+int Galaxy::GetPlanetCount() const
+{
+    int count = 0;
+    for (const auto& [id, active] : m_ActiveSystems)
+    {
+        count += active.system->GetPlanetCount();
+    }
+    return count;
+}
+
+/// Promotes the nearest system in range and demotes systems that fell out of range.
+/// At most one system is created per frame, since building planet meshes is the expensive part.
+void Galaxy::UpdateActivation(const Vector3& universePos, const Vector3& originOffset)
+{
+    float deactivationDistance = activationDistance * 1.5f;
+    for (auto it = m_ActiveSystems.begin(); it != m_ActiveSystems.end();)
+    {
+        const StarSystemDesc& desc = it->second.desc;
+        if ((Vector3(desc.x, desc.y, desc.z) - universePos).Length() > deactivationDistance)
+            it = m_ActiveSystems.erase(it);
+        else
+            ++it;
+    }
+
+    if (static_cast<int>(m_ActiveSystems.size()) >= maxActiveSystems)
+        return;
+
+    const StarSystemDesc* nearest = nullptr;
+    float nearestDistance = activationDistance;
+    for (auto& [coord, sector] : m_Streamer.GetSectors())
+    {
+        for (const StarSystemDesc& desc : sector.systems)
+        {
+            float distance = (Vector3(desc.x, desc.y, desc.z) - universePos).Length();
+            if (distance < nearestDistance && m_ActiveSystems.find(desc.id) == m_ActiveSystems.end())
+            {
+                nearest = &desc;
+                nearestDistance = distance;
+            }
+        }
+    }
+
+    if (nearest)
+    {
+        ActiveSystem active;
+        active.desc = *nearest;
+        active.system = std::make_unique<PlanetarySystem>(m_Device, m_DynamicsWorld, m_Textures,
+            Vector3(nearest->x, nearest->y, nearest->z) + originOffset, nearest->seed, nearest->planetCount);
+        m_ActiveSystems[nearest->id] = std::move(active);
+    }
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include <SimpleMath.h>
+#include <PrimitiveBatch.h>
+#include <VertexTypes.h>
+#include <btBulletDynamicsCommon.h>
+
+#include "PlanetarySystem.h"
+#include "SectorGenerator.h"
+
+/// Streams star systems around the spaceship from a sparse, hashed 3D sector grid.
+/// Sectors are generated on worker threads, distant systems are drawn as point impostors
+/// and only the systems close to the ship are promoted to full `PlanetarySystem` instances.
+/// All sector data lives in universe space; the floating-origin offset converts it to world space.
+class Galaxy
+{
+public:
+    /// Constructor for the Galaxy.
+    /// @param device Pointer to the Direct3D device used for rendering.
+    /// @param dynamicsWorld Pointer to the Bullet physics dynamics world for managing physics.
+    /// @param textures A collection of textures to be applied to planets.
+    /// @param seed Seed shared by every sector of the galaxy.
+    Galaxy(ID3D11Device* device, btDiscreteDynamicsWorld* dynamicsWorld,
+        const std::vector<Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>>& textures, uint64_t seed);
+
+    /// Streams sectors in and out and updates the active planetary systems.
+    /// @param deltaTime The time elapsed since the last update.
+    /// @param shipPos The position of the spaceship in world space.
+    /// @param originOffset The accumulated floating-origin offset (world = universe + offset).
+    void Update(float deltaTime, const DirectX::SimpleMath::Vector3& shipPos, const DirectX::SimpleMath::Vector3& originOffset);
+
+    /// Draws every loaded but inactive system as a camera-facing quad.
+    /// Impostors are pulled in to `impostorDistance` so they stay inside the far plane.
+    /// The caller must have applied an effect and input layout for `VertexPositionColor`.
+    /// @param batch The primitive batch used for drawing.
+    /// @param cameraPos The position of the camera in world space.
+    /// @param cameraRight The right vector of the camera.
+    /// @param cameraUp The up vector of the camera.
+    /// @param originOffset The accumulated floating-origin offset.
+    void RenderImpostors(DirectX::PrimitiveBatch<DirectX::VertexPositionColor>& batch, const DirectX::SimpleMath::Vector3& cameraPos,
+        const DirectX::SimpleMath::Vector3& cameraRight, const DirectX::SimpleMath::Vector3& cameraUp,
+        const DirectX::SimpleMath::Vector3& originOffset);
+
+    /// Renders the active planetary systems.
+    /// @param context The Direct3D device context used for rendering.
+    /// @param view The view matrix for rendering.
+    /// @param projection The projection matrix for rendering.
+    /// @param light The light source used for rendering.
+    /// @param shader The shader used for rendering planets and halos.
+    /// @param planetModel The model used for rendering planets.
+    /// @param haloModel The model used for rendering halos.
+    void Render(ID3D11DeviceContext* context, DirectX::SimpleMath::Matrix view, DirectX::SimpleMath::Matrix projection, Light light,
+        Shader& shader, ModelClass& planetModel, ModelClass& haloModel);
+
+    /// Shifts the active systems after a floating-origin rebase.
+    /// @param offset The translation applied to the world.
+    void ShiftOrigin(const DirectX::SimpleMath::Vector3& offset);
+
+    /// Appends the surfaces of every planet in the active systems.
+    /// @param surfaces The list to append to.
+    void CollectSurfaces(std::vector<PlanetSurface>& surfaces) const;
+
+    /// Retrieves the sector streamer, whose `loadRadius` and `maxPendingJobs` control the streaming.
+    /// @return The sector streamer.
+    SectorStreamer& GetStreamer() { return m_Streamer; }
+
+    /// Retrieves the number of resident sectors.
+    /// @return The sector count.
+    int GetSectorCount() const { return m_Streamer.GetSectorCount(); }
+
+    /// Retrieves the number of sectors still being generated.
+    /// @return The pending job count.
+    int GetPendingCount() const { return m_Streamer.GetPendingCount(); }
+
+    /// Retrieves the number of star systems in resident sectors.
+    /// @return The system count.
+    int GetSystemCount() const { return m_Streamer.GetSystemCount(); }
+
+    /// Retrieves the number of systems promoted to full planetary systems.
+    /// @return The active system count.
+    int GetActiveSystemCount() const { return static_cast<int>(m_ActiveSystems.size()); }
+
+    /// Retrieves the number of planets across the active systems.
+    /// @return The planet count.
+    int GetPlanetCount() const;
+
+    /// Retrieves the worker-side cost of the last generated sector.
+    /// @return Generation time in milliseconds.
+    float GetLastGenerationMs() const { return m_Streamer.GetLastGenerationMs(); }
+
+    int maxActiveSystems = 2; ///< Upper bound of full planetary systems alive at once.
+    float activationDistance = 1500.0f; ///< Distance at which a system is promoted to a full planetary system.
+    float impostorDistance = 900.0f; ///< Distance at which impostors are drawn; must be inside the far plane.
+
+private:
+    /// A system promoted to a full planetary system.
+    struct ActiveSystem
+    {
+        StarSystemDesc desc; ///< The seed description of the system.
+        std::unique_ptr<PlanetarySystem> system; ///< The full planetary system.
+    };
+
+    /// Promotes the nearest system in range and demotes systems that fell out of range.
+    /// @param universePos The position of the ship in universe space.
+    /// @param originOffset The accumulated floating-origin offset.
+    void UpdateActivation(const DirectX::SimpleMath::Vector3& universePos, const DirectX::SimpleMath::Vector3& originOffset);
+
+    ID3D11Device* m_Device; ///< Pointer to the Direct3D device.
+    btDiscreteDynamicsWorld* m_DynamicsWorld; ///< Pointer to the Bullet physics dynamics world.
+    const std::vector<Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>>& m_Textures; ///< Collection of textures for planets.
+
+    SectorStreamer m_Streamer; ///< Streams the sectors around the ship on worker threads.
+    std::unordered_map<uint64_t, ActiveSystem> m_ActiveSystems; ///< Full planetary systems indexed by system id.
+    std::vector<StarSystemDesc> m_Evicted; ///< Systems evicted by the last update, reused between frames.
+};
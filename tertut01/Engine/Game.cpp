@@ -4,7 +4,9 @@
 
 #include "pch.h"
 #include "Game.h"
+#include <chrono>
 #include <random>
+#include <unordered_set>
 
 //toreorganise
 #include <fstream>
@@ -17,6 +19,9 @@ using namespace ImGui;
 
 using Microsoft::WRL::ComPtr;
 
+// Maximum number of live exhaust particles, shared by the pool and its vertex buffer
+static const size_t c_exhaustCapacity = 20000;
+
 Game::Game() noexcept(false)
 {
 	m_deviceResources = std::make_unique<DX::DeviceResources>();
@@ -27,6 +32,11 @@ Game::Game() noexcept(false)
 
 Game::~Game()
 {
+	// Planetary systems remove their planets from the world, so they must go first
+	m_terrainCollision.reset();
+	m_galaxy.reset();
+	m_planetarySystem.reset();
+
 	delete m_dynamicsWorld;
 	delete m_solver;
 	delete m_dispatcher;
@@ -109,6 +119,21 @@ void Game::Initialize(HWND window, int width, int height)
 	// Create the procedural planetary system
 	m_planetarySystem = std::make_unique<PlanetarySystem>(m_deviceResources->GetD3DDevice(), m_dynamicsWorld, m_allPlanetTextures, m_orbitCenter);
 
+	// Create the streamed galaxy around the home system
+	m_galaxy = std::make_unique<Galaxy>(m_deviceResources->GetD3DDevice(), m_dynamicsWorld, m_allPlanetTextures, 1337);
+
+	// Terrain collision patches generated under the ship near displaced planets
+	m_terrainCollision = std::make_unique<TerrainCollision>(m_dynamicsWorld);
+
+	// Engine exhaust particles, emitted from both nozzles at the back of the ship
+	m_exhaust = std::make_unique<ParticleSystem>(c_exhaustCapacity);
+	ParticleEmitter nozzle;
+	nozzle.localDirection = btVector3(0.0f, 0.0f, -1.0f);
+	nozzle.localOffset = btVector3(-12.0f, 0.0f, -40.0f);
+	m_exhaustLeft = m_exhaust->AddEmitter(nozzle);
+	nozzle.localOffset = btVector3(12.0f, 0.0f, -40.0f);
+	m_exhaustRight = m_exhaust->AddEmitter(nozzle);
+
 #ifdef DXTK_AUDIO
 	// Create DirectXTK for Audio objects
 	AUDIO_ENGINE_FLAGS eflags = AudioEngine_Default;
@@ -144,11 +169,25 @@ void Game::Tick()
 	//Update all game objects
 	m_timer.Tick([&]()
 		{
+			auto updateStart = std::chrono::high_resolution_clock::now();
 			Update(m_timer);
+			m_frameTelemetry.updateMs = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - updateStart).count();
 		});
 
 	//Render all game content. 
+	auto renderStart = std::chrono::high_resolution_clock::now();
 	Render();
+	m_frameTelemetry.renderMs = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - renderStart).count();
+
+	//collect the frame counters once everything has been submitted
+	m_frameTelemetry.frameMs = static_cast<float>(m_timer.GetElapsedSeconds() * 1000.0);
+	m_frameTelemetry.planets = m_planetarySystem->GetPlanetCount() + m_galaxy->GetPlanetCount();
+	m_frameTelemetry.broadphasePairs = m_broadphase->getOverlappingPairCache()->getNumOverlappingPairs();
+	m_frameTelemetry.manifolds = m_dispatcher->getNumManifolds();
+	m_frameTelemetry.gpuBufferBytes = ModelClass::GetBufferBytes() + (m_exhaustRenderer ? m_exhaustRenderer->GetBufferBytes() : 0);
+	m_frameTelemetry.textureBytes = m_textureBytes;
+	m_telemetry.AddFrame(m_frameTelemetry);
+	m_frameTelemetry.physicsMs = 0.0f;
 
 #ifdef DXTK_AUDIO
 	// Only update audio engine once per frame
@@ -282,16 +321,43 @@ void Game::Update(DX::StepTimer const& timer)
 		}
 
 		// Step simulation
+		auto physicsStart = std::chrono::high_resolution_clock::now();
 		m_dynamicsWorld->stepSimulation(timer.GetElapsedSeconds(), 10);
+		m_frameTelemetry.physicsMs = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - physicsStart).count();
 
 		// Update spaceship to sync graphics
 		m_spaceship->UpdateTransform();
 
+		// Pull the scene back to the origin before precision loss becomes visible
+		if (m_floatingOrigin.NeedsRebase(m_spaceship->GetPosition()))
+		{
+			RebaseOrigin(-m_spaceship->GetPosition());
+		}
+
 		if (m_planetarySystem)
 		{
 			m_planetarySystem->Update(static_cast<float>(timer.GetElapsedSeconds()), m_Camera01.getPosition());
 		}
 
+		if (m_galaxy)
+		{
+			m_galaxy->Update(static_cast<float>(timer.GetElapsedSeconds()), m_spaceship->GetPosition(), m_floatingOrigin.GetAccumulatedOffset());
+		}
+
+		// Build collision only where the ship can actually touch the displaced terrain
+		m_planetSurfaces.clear();
+		m_planetarySystem->CollectSurfaces(m_planetSurfaces);
+		m_galaxy->CollectSurfaces(m_planetSurfaces);
+		m_terrainCollision->Update(m_spaceship->GetPosition(), m_planetSurfaces);
+
+		// Exhaust follows the ship's rigid body, so particles inherit its motion
+		btRigidBody* shipBody = m_spaceship->GetRigidBody();
+		m_exhaust->GetEmitter(m_exhaustLeft).enabled = m_showFlames;
+		m_exhaust->GetEmitter(m_exhaustRight).enabled = m_showFlames;
+		m_exhaust->SetEmitterTransform(m_exhaustLeft, shipBody->getWorldTransform(), shipBody->getLinearVelocity());
+		m_exhaust->SetEmitterTransform(m_exhaustRight, shipBody->getWorldTransform(), shipBody->getLinearVelocity());
+		m_exhaust->Update(static_cast<float>(timer.GetElapsedSeconds()));
+
 		// Update camera to follow spaceship
 		Vector3 spaceshipPos = m_spaceship->GetPosition();
 		Matrix rotationMatrix = Matrix::CreateRotationY(XMConvertToRadians(m_spaceship->GetRotation()));
@@ -366,6 +432,10 @@ void Game::Render()
 
 	Clear();
 
+	//models count their own draws, everything else is counted where it is submitted
+	ModelClass::ResetDrawCallCount();
+	m_frameTelemetry.drawCalls = 1;
+
 	m_sprites->Begin(SpriteSortMode_Deferred, m_states->NonPremultiplied());
 
 	// Draw fullscreen sprite
@@ -385,6 +455,24 @@ void Game::Render()
 	auto renderTargetView = m_deviceResources->GetRenderTargetView();
 	auto depthTargetView = m_deviceResources->GetDepthStencilView();
 
+	//draw distant star systems as impostors over the background
+	if (m_galaxy)
+	{
+		context->OMSetBlendState(m_states->Additive(), nullptr, 0xFFFFFFFF);
+		context->OMSetDepthStencilState(m_states->DepthNone(), 0);
+		context->RSSetState(m_states->CullNone());
+
+		m_batchEffect->SetWorld(Matrix::Identity);
+		m_batchEffect->SetView(m_view);
+		m_batchEffect->SetProjection(m_projection);
+		m_batchEffect->Apply(context);
+		context->IASetInputLayout(m_batchInputLayout.Get());
+
+		Vector3 cameraUp = m_Camera01.getRight().Cross(m_Camera01.getForward());
+		m_galaxy->RenderImpostors(*m_batch, m_Camera01.getPosition(), m_Camera01.getRight(), cameraUp, m_floatingOrigin.GetAccumulatedOffset());
+		m_frameTelemetry.drawCalls++;
+	}
+
 	//Set Rendering states. 
 	context->OMSetBlendState(m_states->Opaque(), nullptr, 0xFFFFFFFF);
 	context->OMSetDepthStencilState(m_states->DepthDefault(), 0);
@@ -453,10 +541,38 @@ void Game::Render()
 			m_PlanetModel,
 			m_PlanetHaloModel);
 	}
+	if (m_galaxy)
+	{
+		m_galaxy->Render(context, m_view, m_projection, m_Light, m_BasicShaderPair, m_PlanetModel, m_PlanetHaloModel);
+	}
+
+	//draw engine exhaust particles, depth tested against the scene but not written
+	if (m_exhaust->GetCount() > 0)
+	{
+		context->OMSetBlendState(m_states->Additive(), nullptr, 0xFFFFFFFF);
+		context->OMSetDepthStencilState(m_states->DepthRead(), 0);
+		context->RSSetState(m_states->CullNone());
+
+		m_batchEffect->SetWorld(Matrix::Identity);
+		m_batchEffect->SetView(m_view);
+		m_batchEffect->SetProjection(m_projection);
+		m_batchEffect->Apply(context);
+		context->IASetInputLayout(m_batchInputLayout.Get());
+
+		Vector3 cameraUp = m_Camera01.getRight().Cross(m_Camera01.getForward());
+		m_exhaustRenderer->Render(context, *m_exhaust, m_Camera01.getRight(), cameraUp);
+		m_frameTelemetry.drawCalls++;
+	}
 
 	//render our GUI
 	ImGui::Render();
-	ImGui_ImplDX11_RenderDrawData(ImGui::GetDrawData());
+	ImDrawData* drawData = ImGui::GetDrawData();
+	ImGui_ImplDX11_RenderDrawData(drawData);
+	for (int n = 0; n < drawData->CmdListsCount; n++)
+	{
+		m_frameTelemetry.drawCalls += drawData->CmdLists[n]->CmdBuffer.Size;
+	}
+	m_frameTelemetry.drawCalls += ModelClass::GetDrawCallCount();
 
 
 	// Show the new frame.
@@ -560,12 +676,24 @@ void Game::CreateDeviceDependentResources()
 	m_font = std::make_unique<SpriteFont>(device, L"SegoeUI_18.spritefont");
 	m_batch = std::make_unique<PrimitiveBatch<VertexPositionColor>>(context);
 
+	//setup the vertex colour effect used for star impostors
+	m_batchEffect = std::make_unique<BasicEffect>(device);
+	m_batchEffect->SetVertexColorEnabled(true);
+	{
+		void const* shaderByteCode;
+		size_t byteCodeLength;
+		m_batchEffect->GetVertexShaderBytecode(&shaderByteCode, &byteCodeLength);
+		DX::ThrowIfFailed(device->CreateInputLayout(VertexPositionColor::InputElements, VertexPositionColor::InputElementCount,
+			shaderByteCode, byteCodeLength, m_batchInputLayout.ReleaseAndGetAddressOf()));
+	}
+
 	//setup spaceship model
 	m_SpaceShipModel.InitializeModel(device, "SpaceShip.obj");
 
 	// Initialize turbo flames
 	m_TurboFlameLeftModel.InitializeModel(device, "FuelTurboFlameLeft.obj");
 	m_TurboFlameRightModel.InitializeModel(device, "FuelTurboFlameRight.obj");
+	m_exhaustRenderer = std::make_unique<ParticleRenderer>(device, c_exhaustCapacity);
 
 	// Initialize planet
 	m_SunModel.InitializeModel(device, "Planet.obj");
@@ -734,6 +862,20 @@ void Game::CreateDeviceDependentResources()
 		m_textureTundra5.Get()
 	};
 
+	//add up texture memory once; the same view may be shared by several users
+	std::unordered_set<ID3D11ShaderResourceView*> textures = {
+		m_texture1.Get(), m_texture2.Get(), m_texture3.Get(), m_textureStars.Get(), m_textureSun.Get(),
+		m_SpaceShipModel.GetTexture(), m_SunModel.GetTexture(), m_PlanetModel.GetTexture(), m_PlanetHaloModel.GetTexture() };
+	for (const auto& texture : m_allPlanetTextures)
+	{
+		textures.insert(texture.Get());
+	}
+	m_textureBytes = 0;
+	for (ID3D11ShaderResourceView* texture : textures)
+	{
+		m_textureBytes += GetTextureBytes(texture);
+	}
+
 	//Initialise Render to texture
 	m_FirstRenderPass = new RenderTexture(device, 800, 600, 1, 2);	//for our rendering, We dont use the last two properties. but.  they cant be zero and they cant be the same. 
 }
@@ -808,6 +950,35 @@ void Game::SetupGUI()
 		ImGui::SliderFloat("Noise Amplitude", &m_planetarySystem->m_noiseAmplitude, 0.0f, 10.0f);
 		ImGui::SliderFloat("Noise Frequency", &m_planetarySystem->m_noiseFrequency, 0.1f, 10.0f);
 
+		ImGui::Text("Floating Origin:");
+		ImGui::SliderFloat("Rebase Threshold", &m_floatingOrigin.threshold, 100.0f, 10000.0f);
+		ImGui::Text("Rebases: %d (last %.3f ms)", m_floatingOrigin.GetRebaseCount(), m_floatingOrigin.GetLastRebaseMs());
+
+		ImGui::Separator();
+
+		ImGui::Text("Galaxy:");
+		ImGui::SliderInt("Sector Load Radius", &m_galaxy->GetStreamer().loadRadius, 1, 4);
+		ImGui::SliderFloat("Activation Distance", &m_galaxy->activationDistance, 200.0f, 3000.0f);
+		ImGui::Text("Sectors: %d (+%d pending)", m_galaxy->GetSectorCount(), m_galaxy->GetPendingCount());
+		ImGui::Text("Systems: %d (%d active)", m_galaxy->GetSystemCount(), m_galaxy->GetActiveSystemCount());
+		ImGui::Text("Last sector generation: %.3f ms", m_galaxy->GetLastGenerationMs());
+
+		ImGui::Separator();
+
+		ImGui::Text("Terrain Collision:");
+		ImGui::SliderFloat("Patch Build Budget (ms)", &m_terrainCollision->buildBudgetMs, 0.05f, 4.0f);
+		ImGui::Text("Patches: %d (frame %.3f ms, last patch %.3f ms)", m_terrainCollision->GetActivePatchCount(),
+			m_terrainCollision->GetFrameBuildMs(), m_terrainCollision->GetLastPatchMs());
+
+		ImGui::Separator();
+
+		ImGui::Text("Engine Exhaust:");
+		ImGui::SliderFloat("Emission Rate", &m_exhaust->GetEmitter(m_exhaustLeft).rate, 0.0f, 8000.0f);
+		m_exhaust->GetEmitter(m_exhaustRight).rate = m_exhaust->GetEmitter(m_exhaustLeft).rate;
+		ImGui::SliderFloat("Exhaust Drag", &m_exhaust->drag, 0.0f, 5.0f);
+		ImGui::Text("Particles: %d / %d (update %.3f ms)", static_cast<int>(m_exhaust->GetCount()),
+			static_cast<int>(m_exhaust->GetCapacity()), m_exhaust->GetLastUpdateMs());
+
 		ImGui::Separator();
 
 		ImGui::Text("Camera:");
@@ -820,6 +991,137 @@ void Game::SetupGUI()
 	}
 
 	ImGui::End();
+
+	SetupTelemetryGUI();
+}
+
+// Draws the telemetry window with rolling timing plots, counters and CSV controls.
+void Game::SetupTelemetryGUI()
+{
+	if (ImGui::Begin("Telemetry"))
+	{
+		const std::pair<const char*, TelemetrySeries> timings[] = {
+			{ "Frame", TelemetrySeries::Frame },
+			{ "Update", TelemetrySeries::Update },
+			{ "Render", TelemetrySeries::Render },
+			{ "Physics", TelemetrySeries::Physics } };
+
+		for (const auto& [label, id] : timings)
+		{
+			const RollingSeries& series = m_telemetry.GetSeries(id);
+			TelemetryPercentiles percentiles = series.ComputePercentiles();
+
+			//scale to the p99 so a single spike doesn't flatten the rest of the plot
+			char overlay[96];
+			sprintf_s(overlay, "%.2f ms  p50 %.2f  p95 %.2f  p99 %.2f", series.GetLatest(), percentiles.p50, percentiles.p95, percentiles.p99);
+			ImGui::PlotLines(label, series.GetData(), series.GetCount(), series.GetOffset(), overlay,
+				0.0f, std::max(percentiles.p99 * 1.25f, 1.0f), ImVec2(0, 60));
+		}
+
+		ImGui::Separator();
+
+		const TelemetryFrame& latest = m_telemetry.GetLatest();
+		ImGui::Text("Planets: %d", latest.planets);
+		ImGui::Text("Draw calls: %d", latest.drawCalls);
+		ImGui::Text("Broadphase pairs: %d", latest.broadphasePairs);
+		ImGui::Text("Manifolds: %d", latest.manifolds);
+		ImGui::Text("GPU buffers: %.2f MB", latest.gpuBufferBytes / (1024.0 * 1024.0));
+		ImGui::Text("Textures: %.2f MB", latest.textureBytes / (1024.0 * 1024.0));
+
+		ImGui::Separator();
+
+		bool streaming = m_telemetry.IsCsvOpen();
+		if (ImGui::Checkbox("Stream to telemetry.csv", &streaming))
+		{
+			if (streaming)
+				m_telemetry.StartCsv("telemetry.csv");
+			else
+				m_telemetry.StopCsv();
+		}
+	}
+
+	ImGui::End();
+}
+
+// Calculates the memory held by a texture, including its mip chain.
+uint64_t Game::GetTextureBytes(ID3D11ShaderResourceView* view)
+{
+	if (!view)
+		return 0;
+
+	ComPtr<ID3D11Resource> resource;
+	view->GetResource(resource.GetAddressOf());
+	ComPtr<ID3D11Texture2D> texture;
+	if (FAILED(resource.As(&texture)))
+		return 0;
+
+	D3D11_TEXTURE2D_DESC desc;
+	texture->GetDesc(&desc);
+
+	//block compressed formats store 4x4 texel blocks, everything else is measured per texel
+	UINT blockBytes = 0;
+	UINT texelBits = 32;
+	switch (desc.Format)
+	{
+	case DXGI_FORMAT_BC1_TYPELESS: case DXGI_FORMAT_BC1_UNORM: case DXGI_FORMAT_BC1_UNORM_SRGB:
+	case DXGI_FORMAT_BC4_TYPELESS: case DXGI_FORMAT_BC4_UNORM: case DXGI_FORMAT_BC4_SNORM:
+		blockBytes = 8;
+		break;
+	case DXGI_FORMAT_BC2_TYPELESS: case DXGI_FORMAT_BC2_UNORM: case DXGI_FORMAT_BC2_UNORM_SRGB:
+	case DXGI_FORMAT_BC3_TYPELESS: case DXGI_FORMAT_BC3_UNORM: case DXGI_FORMAT_BC3_UNORM_SRGB:
+	case DXGI_FORMAT_BC5_TYPELESS: case DXGI_FORMAT_BC5_UNORM: case DXGI_FORMAT_BC5_SNORM:
+	case DXGI_FORMAT_BC6H_TYPELESS: case DXGI_FORMAT_BC6H_UF16: case DXGI_FORMAT_BC6H_SF16:
+	case DXGI_FORMAT_BC7_TYPELESS: case DXGI_FORMAT_BC7_UNORM: case DXGI_FORMAT_BC7_UNORM_SRGB:
+		blockBytes = 16;
+		break;
+	case DXGI_FORMAT_R32G32B32A32_FLOAT:
+		texelBits = 128;
+		break;
+	case DXGI_FORMAT_R16G16B16A16_FLOAT: case DXGI_FORMAT_R16G16B16A16_UNORM:
+		texelBits = 64;
+		break;
+	case DXGI_FORMAT_R8_UNORM: case DXGI_FORMAT_A8_UNORM:
+		texelBits = 8;
+		break;
+	default:
+		break;
+	}
+
+	uint64_t bytes = 0;
+	for (UINT mip = 0; mip < desc.MipLevels; mip++)
+	{
+		UINT width = std::max(desc.Width >> mip, 1u);
+		UINT height = std::max(desc.Height >> mip, 1u);
+		if (blockBytes)
+			bytes += uint64_t((width + 3) / 4) * ((height + 3) / 4) * blockBytes;
+		else
+			bytes += uint64_t(width) * height * texelBits / 8;
+	}
+	return bytes * desc.ArraySize;
+}
+
+void Game::RebaseOrigin(const Vector3& offset)
+{
+	// Shift every Bullet body, proxy and contact in one batched pass
+	m_floatingOrigin.RebaseWorld(m_dynamicsWorld, offset);
+
+	// Shift everything that lives outside the physics world
+	m_spaceship->UpdateTransform();
+	m_Camera01.setPosition(m_Camera01.getPosition() + offset);
+	m_SpaceshipPosition += offset;
+	m_orbitCenter += offset;
+	if (m_planetarySystem)
+	{
+		m_planetarySystem->ShiftOrigin(offset);
+	}
+	if (m_galaxy)
+	{
+		m_galaxy->ShiftOrigin(offset);
+	}
+	if (m_exhaust)
+	{
+		m_exhaust->ShiftOrigin(btVector3(offset.x, offset.y, offset.z));
+	}
 }
 
 
@@ -830,8 +1132,10 @@ void Game::OnDeviceLost()
 	m_sprites.reset();
 	m_font.reset();
 	m_batch.reset();
+	m_batchEffect.reset();
 	m_testmodel.reset();
 	m_batchInputLayout.Reset();
+	m_exhaustRenderer.reset();
 }
 
 void Game::OnDeviceRestored()
@@ -14,6 +14,12 @@
 #include "Spaceship.h"
 #include "Planet.h"
 #include "PlanetarySystem.h"
+#include "FloatingOrigin.h"
+#include "Galaxy.h"
+#include "TerrainCollision.h"
+#include "ParticleSystem.h"
+#include "ParticleRenderer.h"
+#include "Telemetry.h"
 #include <btBulletCollisionCommon.h>
 #include <btBulletDynamicsCommon.h>
 
@@ -90,6 +96,18 @@ private:
     /// Sets up the ImGui-based graphical user interface.
     void SetupGUI();
 
+    /// Draws the telemetry window with rolling timing plots, counters and CSV controls.
+    void SetupTelemetryGUI();
+
+    /// Calculates the memory held by a texture, including its mip chain.
+    /// @param view The shader resource view of the texture.
+    /// @return The texture size in bytes, or zero if it is not a 2D texture.
+    static uint64_t GetTextureBytes(ID3D11ShaderResourceView* view);
+
+    /// Moves the camera, spaceship, orbit centres and every physics body by the same offset.
+    /// @param offset The translation to apply to the whole scene.
+    void RebaseOrigin(const DirectX::SimpleMath::Vector3& offset);
+
     // Device resources.
     std::unique_ptr<DX::DeviceResources>    m_deviceResources;
 
@@ -256,6 +274,15 @@ private:
     bool 																    m_showFlames;
     DirectX::SimpleMath::Matrix											    m_flameLeftWorld;
     DirectX::SimpleMath::Matrix											    m_flameRightWorld;
+    std::unique_ptr<ParticleSystem>                                         m_exhaust;
+    std::unique_ptr<ParticleRenderer>                                       m_exhaustRenderer;
+    int                                                                     m_exhaustLeft;
+    int                                                                     m_exhaustRight;
+
+    // TELEMETRY
+    Telemetry                                                               m_telemetry;
+    TelemetryFrame                                                          m_frameTelemetry;
+    uint64_t                                                                m_textureBytes = 0;
 
     // PHYSICS
 	btDiscreteDynamicsWorld*                                                m_dynamicsWorld = nullptr;
@@ -269,8 +296,12 @@ private:
 
     std::vector<Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>>           m_allPlanetTextures;
 	std::unique_ptr<PlanetarySystem>                                        m_planetarySystem;
+	std::unique_ptr<Galaxy>                                                 m_galaxy;
+	std::unique_ptr<TerrainCollision>                                       m_terrainCollision;
+	std::vector<PlanetSurface>                                              m_planetSurfaces;
 
     DirectX::SimpleMath::Vector3 											m_orbitCenter;
+    FloatingOrigin                                                          m_floatingOrigin;
     DirectX::XMFLOAT4 m_glowColor;
     float m_glowThreshold;
     float m_glowIntensity;
@@ -0,0 +1,54 @@
+#include "pch.h"
+#include "ParticleRenderer.h"
+#include "DeviceResources.h"
+
+static_assert(sizeof(ParticleVertex) == sizeof(DirectX::VertexPositionColor),
+    "ParticleVertex must match the VertexPositionColor input layout");
+
+/// Constructor to create the vertex and index buffers for a pool.
+/// 32-bit indices are used because a large pool needs more than 65536 vertices.
+ParticleRenderer::ParticleRenderer(ID3D11Device* device, size_t capacity)
+    : m_Capacity(capacity)
+{
+    D3D11_BUFFER_DESC vertexDesc = {};
+    vertexDesc.ByteWidth = static_cast<UINT>(sizeof(ParticleVertex) * 4 * capacity);
+    vertexDesc.Usage = D3D11_USAGE_DYNAMIC;
+    vertexDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+    vertexDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+    DX::ThrowIfFailed(device->CreateBuffer(&vertexDesc, nullptr, m_VertexBuffer.ReleaseAndGetAddressOf()));
+
+    std::vector<uint32_t> indices(6 * capacity);
+    ParticleSystem::WriteQuadIndices(indices.data(), capacity);
+
+    D3D11_BUFFER_DESC indexDesc = {};
+    indexDesc.ByteWidth = static_cast<UINT>(sizeof(uint32_t) * indices.size());
+    indexDesc.Usage = D3D11_USAGE_IMMUTABLE;
+    indexDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
+    D3D11_SUBRESOURCE_DATA indexData = {};
+    indexData.pSysMem = indices.data();
+    DX::ThrowIfFailed(device->CreateBuffer(&indexDesc, &indexData, m_IndexBuffer.ReleaseAndGetAddressOf()));
+}
+
+/// Uploads the live particles and draws them as camera-facing quads.
+/// Vertices are generated directly into the mapped buffer, so there is no intermediate copy.
+void ParticleRenderer::Render(ID3D11DeviceContext* context, const ParticleSystem& particles,
+    const DirectX::SimpleMath::Vector3& cameraRight, const DirectX::SimpleMath::Vector3& cameraUp)
+{
+    m_LastUploadBytes = 0;
+    if (particles.GetCount() == 0)
+        return;
+
+    D3D11_MAPPED_SUBRESOURCE mapped;
+    DX::ThrowIfFailed(context->Map(m_VertexBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped));
+    size_t quadCount = particles.WriteVertices(static_cast<ParticleVertex*>(mapped.pData), m_Capacity,
+        btVector3(cameraRight.x, cameraRight.y, cameraRight.z), btVector3(cameraUp.x, cameraUp.y, cameraUp.z));
+    context->Unmap(m_VertexBuffer.Get(), 0);
+    m_LastUploadBytes = quadCount * 4 * sizeof(ParticleVertex);
+
+    UINT stride = sizeof(ParticleVertex);
+    UINT offset = 0;
+    context->IASetVertexBuffers(0, 1, m_VertexBuffer.GetAddressOf(), &stride, &offset);
+    context->IASetIndexBuffer(m_IndexBuffer.Get(), DXGI_FORMAT_R32_UINT, 0);
+    context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+    context->DrawIndexed(static_cast<UINT>(quadCount * 6), 0, 0);
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <d3d11.h>
+#include <wrl/client.h>
+#include <SimpleMath.h>
+#include "ParticleSystem.h"
+
+/// Draws a `ParticleSystem` with Direct3D 11.
+/// Vertices are written straight into one dynamic vertex buffer mapped with WRITE_DISCARD each frame,
+/// and a static index buffer covering the whole pool is created once, so a frame costs one upload and one draw.
+class ParticleRenderer
+{
+public:
+    /// Constructor to create the vertex and index buffers for a pool.
+    /// @param device Pointer to the Direct3D device.
+    /// @param capacity Maximum number of particles that will be drawn.
+    ParticleRenderer(ID3D11Device* device, size_t capacity);
+
+    /// Uploads the live particles and draws them as camera-facing quads.
+    /// The caller must have applied an effect, input layout and blend state for `VertexPositionColor`.
+    /// @param context The Direct3D device context used for rendering.
+    /// @param particles The particle system to draw.
+    /// @param cameraRight The right vector of the camera.
+    /// @param cameraUp The up vector of the camera.
+    void Render(ID3D11DeviceContext* context, const ParticleSystem& particles,
+        const DirectX::SimpleMath::Vector3& cameraRight, const DirectX::SimpleMath::Vector3& cameraUp);
+
+    /// Retrieves the size of the vertex data uploaded in the last frame.
+    /// @return The uploaded size in bytes.
+    size_t GetLastUploadBytes() const { return m_LastUploadBytes; }
+
+    /// Retrieves the size of the vertex and index buffers.
+    /// @return The buffer size in bytes.
+    size_t GetBufferBytes() const { return m_Capacity * (4 * sizeof(ParticleVertex) + 6 * sizeof(uint32_t)); }
+
+private:
+    Microsoft::WRL::ComPtr<ID3D11Buffer> m_VertexBuffer; ///< Dynamic vertex buffer rewritten every frame.
+    Microsoft::WRL::ComPtr<ID3D11Buffer> m_IndexBuffer; ///< Static quad index buffer.
+    size_t m_Capacity; ///< Maximum number of quads the buffers hold.
+    size_t m_LastUploadBytes = 0; ///< Bytes written to the vertex buffer in the last frame.
+};
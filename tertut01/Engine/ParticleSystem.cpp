@@ -0,0 +1,248 @@
+// The particle pool and its SIMD integration only depend on the standard library and LinearMath
+// and are built without the precompiled header, so the same file can be compiled into the unit tests.
+#include "ParticleSystem.h"
+#include <algorithm>
+#include <chrono>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE__)
+#include <xmmintrin.h>
+#define PARTICLES_USE_SSE
+#endif
+
+/// Constructor to allocate the particle pool.
+/// Every array is padded to a multiple of four so the SIMD loop can run over whole lanes.
+ParticleSystem::ParticleSystem(size_t capacity, uint32_t seed)
+    : m_Capacity(capacity), m_RandomState(seed ? seed : 1)
+{
+    int padded = static_cast<int>((capacity + 3) & ~size_t(3));
+    for (btAlignedObjectArray<float>* array : { &m_PositionX, &m_PositionY, &m_PositionZ,
+        &m_VelocityX, &m_VelocityY, &m_VelocityZ, &m_Age, &m_InverseLifetime })
+    {
+        array->resize(padded, 0.0f);
+    }
+}
+
+/// Adds an emitter to the system.
+int ParticleSystem::AddEmitter(const ParticleEmitter& emitter)
+{
+    m_Emitters.push_back(emitter);
+    return static_cast<int>(m_Emitters.size()) - 1;
+}
+
+/// Attaches an emitter to a transform for this frame.
+/// The first transform also becomes the previous one, so a fresh emitter does not streak from the origin.
+void ParticleSystem::SetEmitterTransform(int index, const btTransform& transform, const btVector3& velocity)
+{
+    ParticleEmitter& emitter = m_Emitters[index];
+    emitter.previousTransform = emitter.attached ? emitter.transform : transform;
+    emitter.transform = transform;
+    emitter.velocity = velocity;
+    emitter.attached = true;
+}
+
+/// Spawns particles from every enabled emitter, integrates all particles and removes dead ones.
+void ParticleSystem::Update(float deltaTime)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+
+    Integrate(deltaTime);
+    Compact();
+    for (ParticleEmitter& emitter : m_Emitters)
+    {
+        Emit(emitter, deltaTime);
+    }
+
+    auto end = std::chrono::high_resolution_clock::now();
+    m_LastUpdateMs = std::chrono::duration<float, std::milli>(end - start).count();
+}
+
+/// Translates every particle and emitter after a floating-origin rebase.
+void ParticleSystem::ShiftOrigin(const btVector3& offset)
+{
+    for (size_t i = 0; i < m_Count; ++i)
+    {
+        m_PositionX[i] += offset.x();
+        m_PositionY[i] += offset.y();
+        m_PositionZ[i] += offset.z();
+    }
+    for (ParticleEmitter& emitter : m_Emitters)
+    {
+        emitter.transform.getOrigin() += offset;
+        emitter.previousTransform.getOrigin() += offset;
+    }
+}
+
+/// Writes one camera-facing quad (four vertices) per live particle.
+/// Colour and size are interpolated from the normalised age, so nothing but age is stored for them.
+size_t ParticleSystem::WriteVertices(ParticleVertex* vertices, size_t maxQuads, const btVector3& cameraRight, const btVector3& cameraUp) const
+{
+    size_t count = std::min(m_Count, maxQuads);
+
+    // Corner offsets of a unit quad; scaled per particle instead of rebuilding the basis.
+    const float cornerX[4] = { -cameraRight.x() - cameraUp.x(), -cameraRight.x() + cameraUp.x(), cameraRight.x() + cameraUp.x(), cameraRight.x() - cameraUp.x() };
+    const float cornerY[4] = { -cameraRight.y() - cameraUp.y(), -cameraRight.y() + cameraUp.y(), cameraRight.y() + cameraUp.y(), cameraRight.y() - cameraUp.y() };
+    const float cornerZ[4] = { -cameraRight.z() - cameraUp.z(), -cameraRight.z() + cameraUp.z(), cameraRight.z() + cameraUp.z(), cameraRight.z() - cameraUp.z() };
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        float t = std::min(m_Age[i], 1.0f);
+        float size = startSize + (endSize - startSize) * t;
+        float r = startColour[0] + (endColour[0] - startColour[0]) * t;
+        float g = startColour[1] + (endColour[1] - startColour[1]) * t;
+        float b = startColour[2] + (endColour[2] - startColour[2]) * t;
+        float a = startColour[3] + (endColour[3] - startColour[3]) * t;
+
+        // The destination is usually mapped GPU memory, so write every field once and never read it back.
+        ParticleVertex* quad = vertices + i * 4;
+        for (int c = 0; c < 4; ++c)
+        {
+            quad[c].x = m_PositionX[i] + cornerX[c] * size;
+            quad[c].y = m_PositionY[i] + cornerY[c] * size;
+            quad[c].z = m_PositionZ[i] + cornerZ[c] * size;
+            quad[c].r = r;
+            quad[c].g = g;
+            quad[c].b = b;
+            quad[c].a = a;
+        }
+    }
+    return count;
+}
+
+/// Writes the index pattern for a list of quads, two triangles per quad.
+/// The winding matches `PrimitiveBatch::DrawQuad`.
+void ParticleSystem::WriteQuadIndices(uint32_t* indices, size_t quadCount)
+{
+    for (size_t i = 0; i < quadCount; ++i)
+    {
+        uint32_t base = static_cast<uint32_t>(i * 4);
+        uint32_t* quad = indices + i * 6;
+        quad[0] = base;
+        quad[1] = base + 1;
+        quad[2] = base + 2;
+        quad[3] = base;
+        quad[4] = base + 2;
+        quad[5] = base + 3;
+    }
+}
+
+/// Spawns the particles owed by an emitter since the last update.
+/// Spawn points are spread along the path the nozzle travelled this frame, and particles are
+/// pre-aged by their share of the frame, so the trail stays continuous at high speed.
+void ParticleSystem::Emit(ParticleEmitter& emitter, float deltaTime)
+{
+    if (!emitter.enabled || !emitter.attached || deltaTime <= 0.0f)
+    {
+        emitter.accumulator = 0.0f;
+        return;
+    }
+
+    emitter.accumulator += emitter.rate * deltaTime;
+    int spawnCount = static_cast<int>(emitter.accumulator);
+    emitter.accumulator -= spawnCount;
+
+    btVector3 from = emitter.previousTransform * emitter.localOffset;
+    btVector3 to = emitter.transform * emitter.localOffset;
+    btVector3 direction = emitter.transform.getBasis() * emitter.localDirection;
+    float inverseLifetime = 1.0f / std::max(emitter.lifetime, 0.001f);
+
+    for (int n = 0; n < spawnCount && m_Count < m_Capacity; ++n)
+    {
+        float fraction = (n + 1.0f) / spawnCount;
+        btVector3 jitter(NextSigned(), NextSigned(), NextSigned());
+        btVector3 velocity = (direction + jitter * emitter.spread) * emitter.speed + emitter.velocity;
+        float age = (1.0f - fraction) * deltaTime;
+        btVector3 position = from.lerp(to, fraction) + velocity * age;
+
+        size_t i = m_Count++;
+        m_PositionX[i] = position.x();
+        m_PositionY[i] = position.y();
+        m_PositionZ[i] = position.z();
+        m_VelocityX[i] = velocity.x();
+        m_VelocityY[i] = velocity.y();
+        m_VelocityZ[i] = velocity.z();
+        m_Age[i] = age * inverseLifetime;
+        m_InverseLifetime[i] = inverseLifetime;
+    }
+}
+
+/// Advances position, velocity and age of every live particle.
+/// Velocity is damped with a first-order drag term, then positions are integrated semi-implicitly.
+void ParticleSystem::Integrate(float deltaTime)
+{
+    float damping = std::max(0.0f, 1.0f - drag * deltaTime);
+    float ax = acceleration.x() * deltaTime;
+    float ay = acceleration.y() * deltaTime;
+    float az = acceleration.z() * deltaTime;
+    size_t i = 0;
+
+#ifdef PARTICLES_USE_SSE
+    // The arrays are 16-byte aligned and padded, so whole lanes can be processed past m_Count.
+    const __m128 dt4 = _mm_set1_ps(deltaTime);
+    const __m128 damping4 = _mm_set1_ps(damping);
+    const __m128 ax4 = _mm_set1_ps(ax);
+    const __m128 ay4 = _mm_set1_ps(ay);
+    const __m128 az4 = _mm_set1_ps(az);
+    for (; i < m_Count; i += 4)
+    {
+        __m128 vx = _mm_add_ps(_mm_mul_ps(_mm_load_ps(&m_VelocityX[0] + i), damping4), ax4);
+        __m128 vy = _mm_add_ps(_mm_mul_ps(_mm_load_ps(&m_VelocityY[0] + i), damping4), ay4);
+        __m128 vz = _mm_add_ps(_mm_mul_ps(_mm_load_ps(&m_VelocityZ[0] + i), damping4), az4);
+        _mm_store_ps(&m_VelocityX[0] + i, vx);
+        _mm_store_ps(&m_VelocityY[0] + i, vy);
+        _mm_store_ps(&m_VelocityZ[0] + i, vz);
+
+        _mm_store_ps(&m_PositionX[0] + i, _mm_add_ps(_mm_load_ps(&m_PositionX[0] + i), _mm_mul_ps(vx, dt4)));
+        _mm_store_ps(&m_PositionY[0] + i, _mm_add_ps(_mm_load_ps(&m_PositionY[0] + i), _mm_mul_ps(vy, dt4)));
+        _mm_store_ps(&m_PositionZ[0] + i, _mm_add_ps(_mm_load_ps(&m_PositionZ[0] + i), _mm_mul_ps(vz, dt4)));
+
+        __m128 age = _mm_load_ps(&m_Age[0] + i);
+        __m128 inverseLifetime = _mm_load_ps(&m_InverseLifetime[0] + i);
+        _mm_store_ps(&m_Age[0] + i, _mm_add_ps(age, _mm_mul_ps(inverseLifetime, dt4)));
+    }
+#else
+    for (; i < m_Count; ++i)
+    {
+        m_VelocityX[i] = m_VelocityX[i] * damping + ax;
+        m_VelocityY[i] = m_VelocityY[i] * damping + ay;
+        m_VelocityZ[i] = m_VelocityZ[i] * damping + az;
+        m_PositionX[i] += m_VelocityX[i] * deltaTime;
+        m_PositionY[i] += m_VelocityY[i] * deltaTime;
+        m_PositionZ[i] += m_VelocityZ[i] * deltaTime;
+        m_Age[i] += m_InverseLifetime[i] * deltaTime;
+    }
+#endif
+}
+
+/// Removes dead particles by moving the last live particle into their slot.
+/// Order is not preserved, which is fine for additive particles that need no sorting.
+void ParticleSystem::Compact()
+{
+    size_t i = 0;
+    while (i < m_Count)
+    {
+        if (m_Age[i] < 1.0f)
+        {
+            ++i;
+            continue;
+        }
+
+        size_t last = --m_Count;
+        m_PositionX[i] = m_PositionX[last];
+        m_PositionY[i] = m_PositionY[last];
+        m_PositionZ[i] = m_PositionZ[last];
+        m_VelocityX[i] = m_VelocityX[last];
+        m_VelocityY[i] = m_VelocityY[last];
+        m_VelocityZ[i] = m_VelocityZ[last];
+        m_Age[i] = m_Age[last];
+        m_InverseLifetime[i] = m_InverseLifetime[last];
+    }
+}
+
+/// Generates a random float in [-1, 1] with a 32-bit xorshift generator.
+float ParticleSystem::NextSigned()
+{
+    m_RandomState ^= m_RandomState << 13;
+    m_RandomState ^= m_RandomState >> 17;
+    m_RandomState ^= m_RandomState << 5;
+    return (m_RandomState >> 8) * (2.0f / 16777216.0f) - 1.0f;
+}
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <LinearMath/btAlignedObjectArray.h>
+#include <LinearMath/btTransform.h>
+
+/// A single particle vertex, laid out like `DirectX::VertexPositionColor` so it can be copied
+/// straight into a vertex buffer without depending on any graphics API.
+struct ParticleVertex
+{
+    float x, y, z; ///< Position in world space.
+    float r, g, b, a; ///< Colour of the vertex.
+};
+
+/// Describes an emitter attached to a moving transform, such as an engine nozzle on the spaceship.
+/// Offsets and directions are in the local space of the transform.
+struct ParticleEmitter
+{
+    btVector3 localOffset = btVector3(0, 0, 0); ///< Spawn point in the local space of the transform.
+    btVector3 localDirection = btVector3(0, 0, -1); ///< Emission direction in the local space of the transform.
+    float rate = 2000.0f; ///< Particles spawned per second while enabled.
+    float speed = 60.0f; ///< Initial speed along the emission direction.
+    float spread = 0.15f; ///< Random deviation of the direction, as a fraction of its length.
+    float lifetime = 0.6f; ///< Lifetime of each particle in seconds.
+    bool enabled = false; ///< Whether the emitter spawns particles.
+
+    btTransform transform = btTransform::getIdentity(); ///< Current transform the emitter is attached to.
+    btTransform previousTransform = btTransform::getIdentity(); ///< Transform at the previous update, used to fill gaps at speed.
+    btVector3 velocity = btVector3(0, 0, 0); ///< Velocity of the transform, inherited by new particles.
+    float accumulator = 0.0f; ///< Fractional particles carried over between updates.
+    bool attached = false; ///< Whether the emitter has received a transform yet.
+};
+
+/// A fixed-capacity CPU particle system with structure-of-arrays storage.
+/// Integration runs four particles at a time with SSE where available, dead particles are
+/// removed by swapping in the last live one, and the pool never allocates after construction.
+/// The class does not depend on any graphics API; it only writes plain vertices for the renderer to upload.
+class ParticleSystem
+{
+public:
+    /// Constructor to allocate the particle pool.
+    /// @param capacity Maximum number of live particles; emission stops when the pool is full.
+    /// @param seed Seed for the spawn randomisation.
+    explicit ParticleSystem(size_t capacity, uint32_t seed = 1);
+
+    /// Adds an emitter to the system.
+    /// @param emitter The emitter description.
+    /// @return The index of the emitter.
+    int AddEmitter(const ParticleEmitter& emitter);
+
+    /// Retrieves an emitter so its parameters can be tuned.
+    /// @param index The index returned by AddEmitter.
+    /// @return The emitter.
+    ParticleEmitter& GetEmitter(int index) { return m_Emitters[index]; }
+
+    /// Attaches an emitter to a transform for this frame.
+    /// @param index The index of the emitter.
+    /// @param transform The world transform of the object carrying the emitter.
+    /// @param velocity The linear velocity of the object, inherited by new particles.
+    void SetEmitterTransform(int index, const btTransform& transform, const btVector3& velocity);
+
+    /// Spawns particles from every enabled emitter, integrates all particles and removes dead ones.
+    /// @param deltaTime The time elapsed since the last update, in seconds.
+    void Update(float deltaTime);
+
+    /// Translates every particle and emitter after a floating-origin rebase.
+    /// @param offset The translation applied to the world.
+    void ShiftOrigin(const btVector3& offset);
+
+    /// Writes one camera-facing quad (four vertices) per live particle.
+    /// Quads use the order expected by `ParticleSystem::WriteQuadIndices`.
+    /// @param vertices Destination for the vertices; must hold at least `4 * maxQuads` entries.
+    /// @param maxQuads Maximum number of quads to write.
+    /// @param cameraRight The right vector of the camera.
+    /// @param cameraUp The up vector of the camera.
+    /// @return The number of quads written.
+    size_t WriteVertices(ParticleVertex* vertices, size_t maxQuads, const btVector3& cameraRight, const btVector3& cameraUp) const;
+
+    /// Writes the index pattern for a list of quads, two triangles per quad.
+    /// @param indices Destination for the indices; must hold `6 * quadCount` entries.
+    /// @param quadCount Number of quads.
+    static void WriteQuadIndices(uint32_t* indices, size_t quadCount);
+
+    /// Removes every live particle.
+    void Clear() { m_Count = 0; }
+
+    /// Retrieves the number of live particles.
+    /// @return The particle count.
+    size_t GetCount() const { return m_Count; }
+
+    /// Retrieves the maximum number of live particles.
+    /// @return The pool capacity.
+    size_t GetCapacity() const { return m_Capacity; }
+
+    /// Retrieves the time spent in the last update.
+    /// @return Update time in milliseconds.
+    float GetLastUpdateMs() const { return m_LastUpdateMs; }
+
+    btVector3 acceleration = btVector3(0, 0, 0); ///< Constant acceleration applied to every particle.
+    float drag = 1.5f; ///< Linear drag coefficient, per second.
+    float startSize = 1.5f; ///< Half size of a quad when a particle is born.
+    float endSize = 6.0f; ///< Half size of a quad when a particle dies.
+    float startColour[4] = { 1.0f, 0.8f, 0.3f, 1.0f }; ///< Colour of a particle when it is born.
+    float endColour[4] = { 0.8f, 0.1f, 0.05f, 0.0f }; ///< Colour of a particle when it dies.
+
+private:
+    /// Spawns the particles owed by an emitter since the last update.
+    /// @param emitter The emitter to spawn from.
+    /// @param deltaTime The time elapsed since the last update.
+    void Emit(ParticleEmitter& emitter, float deltaTime);
+
+    /// Advances position, velocity and age of every live particle.
+    /// @param deltaTime The time elapsed since the last update.
+    void Integrate(float deltaTime);
+
+    /// Removes dead particles by moving the last live particle into their slot.
+    void Compact();
+
+    /// Generates a random float in [-1, 1].
+    /// @return The random value.
+    float NextSigned();
+
+    size_t m_Capacity; ///< Maximum number of live particles.
+    size_t m_Count = 0; ///< Number of live particles.
+
+    // Structure-of-arrays storage, padded to a multiple of four so SIMD loops need no tail.
+    btAlignedObjectArray<float> m_PositionX, m_PositionY, m_PositionZ;
+    btAlignedObjectArray<float> m_VelocityX, m_VelocityY, m_VelocityZ;
+    btAlignedObjectArray<float> m_Age; ///< Normalised age of each particle; it dies when the age reaches one.
+    btAlignedObjectArray<float> m_InverseLifetime; ///< Reciprocal of each particle's lifetime.
+
+    std::vector<ParticleEmitter> m_Emitters; ///< Emitters spawning into this pool.
+    uint32_t m_RandomState; ///< State of the xorshift generator used for spawn jitter.
+    float m_LastUpdateMs = 0.0f; ///< Duration of the last update.
+};
@@ -5,11 +5,26 @@
 /// Constructor for the PlanetarySystem.
 /// Initializes the random number generator and stores references to the device, dynamics world, textures, and orbit center.
 PlanetarySystem::PlanetarySystem(ID3D11Device* device, btDiscreteDynamicsWorld* dynamicsWorld,
-    const std::vector<Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>>& textures, const DirectX::SimpleMath::Vector3& orbitCenter)
-    : m_Device(device), m_DynamicsWorld(dynamicsWorld), m_Textures(textures), m_OrbitCenter(orbitCenter)
+    const std::vector<Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>>& textures, const DirectX::SimpleMath::Vector3& orbitCenter,
+    unsigned int seed, int maxOrbits)
+    : m_Device(device), m_DynamicsWorld(dynamicsWorld), m_Textures(textures), m_OrbitCenter(orbitCenter), m_MaxOrbits(maxOrbits)
 {
-    std::random_device rd;
-    m_rng = std::mt19937(rd()); // Seed with a real random value, if available
+    if (seed == 0)
+    {
+        std::random_device rd;
+        seed = rd(); // Seed with a real random value, if available
+    }
+    m_rng = std::mt19937(seed);
+}
+
+/// Destructor to remove every planet from the physics world.
+/// Planets own their rigid bodies, so they must leave the world before they are deleted.
+PlanetarySystem::~PlanetarySystem()
+{
+    for (auto& [index, orbitingPlanet] : m_Planets)
+    {
+        orbitingPlanet.planet->RemoveFromWorld(m_DynamicsWorld);
+    }
 }
 
 /// Updates the state of the planetary system.
@@ -24,6 +39,7 @@ void PlanetarySystem::Update(float deltaTime, const DirectX::SimpleMath::Vector3
     for (int i = centerIndex - range; i <= centerIndex + range; ++i)
     {
         if (i < 0) continue;
+        if (m_MaxOrbits >= 0 && i >= m_MaxOrbits) break;
         TryGeneratePlanet(i);
     }
 
@@ -86,6 +102,33 @@ void PlanetarySystem::Render(ID3D11DeviceContext* context, DirectX::SimpleMath::
     }
 }
 
+/// Shifts the orbit centre after a floating-origin rebase.
+/// Orbit radii and angles are relative to the centre, so only the centre itself has to move.
+void PlanetarySystem::ShiftOrigin(const DirectX::SimpleMath::Vector3& offset)
+{
+    m_OrbitCenter += offset;
+}
+
+/// Appends the displaced surface description of every planet.
+/// Positions are read back from the physics bodies so they match what the solver sees this frame.
+void PlanetarySystem::CollectSurfaces(std::vector<PlanetSurface>& surfaces) const
+{
+    for (const auto& [index, orbitingPlanet] : m_Planets)
+    {
+        btVector3 origin = orbitingPlanet.planet->GetRigidBody()->getWorldTransform().getOrigin();
+
+        PlanetSurface surface;
+        surface.planet = orbitingPlanet.planet.get();
+        surface.center = DirectX::SimpleMath::Vector3(origin.getX(), origin.getY(), origin.getZ());
+        surface.radius = orbitingPlanet.planet->GetRadius();
+        surface.spinAngle = orbitingPlanet.spinAngle;
+        surface.noiseSeed = orbitingPlanet.noiseSeed;
+        surface.noiseAmplitude = orbitingPlanet.noiseAmplitude;
+        surface.noiseFrequency = orbitingPlanet.noiseFrequency;
+        surfaces.push_back(surface);
+    }
+}
+
 /// Attempts to generate a planet at the specified orbit index.
 /// Randomizes the planet's properties and adds it to the system.
 void PlanetarySystem::TryGeneratePlanet(int index)
@@ -119,7 +162,8 @@ void PlanetarySystem::TryGeneratePlanet(int index)
 
     // Generate the planet's 3D model with procedural terrain.
     std::unique_ptr<ModelClass> planetModel = std::make_unique<ModelClass>();
-    siv::PerlinNoise noise(GetRandomInt(0, 999999));
+    unsigned int noiseSeed = static_cast<unsigned int>(GetRandomInt(0, 999999));
+    siv::PerlinNoise noise(noiseSeed);
     planetModel->LoadPlanetModel(m_Device, "Planet.obj", noise, m_noiseAmplitude, m_noiseFrequency);
 
     // Create and store the orbiting planet.
@@ -131,6 +175,9 @@ void PlanetarySystem::TryGeneratePlanet(int index)
     orbitingPlanet.orbitSpeed = orbitSpeed;
     orbitingPlanet.spinAngle = 0.0f;
     orbitingPlanet.spinSpeed = spinSpeed;
+    orbitingPlanet.noiseSeed = noiseSeed;
+    orbitingPlanet.noiseAmplitude = m_noiseAmplitude;
+    orbitingPlanet.noiseFrequency = m_noiseFrequency;
 
     m_Planets[index] = std::move(orbitingPlanet);
 }
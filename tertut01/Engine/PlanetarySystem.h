@@ -11,6 +11,7 @@
 #include "modelclass.h"
 #include "Light.h"
 #include "Shader.h"
+#include "TerrainCollision.h"
 
 /// Represents a system of orbiting planets.
 /// This class manages the creation, updating, and rendering of planets in a dynamic planetary system.
@@ -22,9 +23,14 @@ public:
     /// @param dynamicsWorld Pointer to the Bullet physics dynamics world for managing physics.
     /// @param textures A collection of textures to be applied to planets.
     /// @param orbitCenter The center of the planetary system's orbit.
+    /// @param seed Seed for procedural generation, or 0 to seed from a random device.
+    /// @param maxOrbits Number of orbits the system may populate, or -1 for an unbounded system.
     PlanetarySystem(ID3D11Device* device, btDiscreteDynamicsWorld* dynamicsWorld,
         const std::vector<Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>>& textures,
-        const DirectX::SimpleMath::Vector3& orbitCenter);
+        const DirectX::SimpleMath::Vector3& orbitCenter, unsigned int seed = 0, int maxOrbits = -1);
+
+    /// Destructor to remove every planet from the physics world.
+    ~PlanetarySystem();
 
     /// Updates the state of the planetary system.
     /// @param deltaTime The time elapsed since the last update.
@@ -42,6 +48,19 @@ public:
     void Render(ID3D11DeviceContext* context, DirectX::SimpleMath::Matrix view, DirectX::SimpleMath::Matrix projection, Light light,
         Shader& shader, ModelClass& planetModel, ModelClass& haloModel);
 
+    /// Shifts the orbit centre after a floating-origin rebase.
+    /// Planet bodies are moved by the physics rebase itself; this keeps the orbits consistent with them.
+    /// @param offset The translation applied to the world.
+    void ShiftOrigin(const DirectX::SimpleMath::Vector3& offset);
+
+    /// Appends the displaced surface description of every planet, for on-demand terrain collision.
+    /// @param surfaces The list to append to.
+    void CollectSurfaces(std::vector<PlanetSurface>& surfaces) const;
+
+    /// Retrieves the number of planets generated so far.
+    /// @return The planet count.
+    int GetPlanetCount() const { return static_cast<int>(m_Planets.size()); }
+
     /// Global multipliers for orbit and rotation speeds.
     float orbitSpeed = 1.0f;    ///< Multiplier for orbit speed of all planets.
     float rotationSpeed = 1.0f; ///< Multiplier for rotation speed of all planets.
@@ -60,6 +79,9 @@ private:
         float orbitSpeed; ///< The speed at which the planet orbits.
         float spinAngle; ///< The current spin angle of the planet.
         float spinSpeed; ///< The speed at which the planet spins.
+        unsigned int noiseSeed; ///< Seed of the noise used to displace the planet mesh.
+        float noiseAmplitude; ///< Noise amplitude the mesh was built with.
+        float noiseFrequency; ///< Noise frequency the mesh was built with.
     };
 
     btDiscreteDynamicsWorld* m_DynamicsWorld; ///< Pointer to the Bullet physics dynamics world.
@@ -72,6 +94,7 @@ private:
 
     float m_GenerationRadius = 1500.0f; ///< Radius within which planets are generated.
     float m_Spacing = 50.0f; ///< Spacing between planets in their orbits.
+    int m_MaxOrbits; ///< Number of orbits that may be populated, or -1 for no limit.
 
     /// Attempts to generate a planet at the specified orbit index.
     /// @param index The index of the orbit where the planet should be generated.
@@ -0,0 +1,201 @@
+// The sector generator and streamer only depend on the standard library and are built without
+// the precompiled header, so the same file can be compiled into the unit tests.
+#include "SectorGenerator.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+
+/// Constructor to initialize the generator.
+SectorGenerator::SectorGenerator(uint64_t galaxySeed, float sectorSize, int maxSystemsPerSector)
+    : m_GalaxySeed(galaxySeed), m_SectorSize(sectorSize), m_MaxSystemsPerSector(maxSystemsPerSector)
+{
+}
+
+/// Generates all star systems of a sector.
+/// The sector key is mixed with the galaxy seed, so neighbouring sectors are uncorrelated.
+/// The origin sector is left empty because it already holds the home system.
+std::vector<StarSystemDesc> SectorGenerator::Generate(const SectorCoord& coord) const
+{
+    std::vector<StarSystemDesc> systems;
+    if (coord.x == 0 && coord.y == 0 && coord.z == 0)
+        return systems;
+
+    uint64_t key = GetKey(coord);
+    uint64_t state = m_GalaxySeed ^ (key * 0x9E3779B97F4A7C15ull);
+
+    // Most sectors are sparse: skew the count towards zero.
+    float density = NextFloat(state, 0.0f, 1.0f);
+    int count = static_cast<int>(density * density * (m_MaxSystemsPerSector + 1));
+    if (count > m_MaxSystemsPerSector)
+        count = m_MaxSystemsPerSector;
+
+    systems.reserve(count);
+    for (int i = 0; i < count; ++i)
+    {
+        StarSystemDesc system;
+        system.id = (key << 4) | static_cast<uint64_t>(i);
+
+        // Keep stars away from the sector borders so neighbouring systems never overlap.
+        system.x = (coord.x + NextFloat(state, 0.1f, 0.9f)) * m_SectorSize;
+        system.y = (coord.y + NextFloat(state, 0.1f, 0.9f)) * m_SectorSize * 0.25f;
+        system.z = (coord.z + NextFloat(state, 0.1f, 0.9f)) * m_SectorSize;
+
+        system.starSize = NextFloat(state, 0.5f, 2.0f);
+        float temperature = NextFloat(state, 0.0f, 1.0f);
+        system.r = 1.0f;
+        system.g = 0.6f + 0.4f * temperature;
+        system.b = 0.3f + 0.7f * temperature;
+        system.planetCount = 1 + static_cast<int>(NextFloat(state, 0.0f, 8.0f));
+        system.seed = static_cast<uint32_t>(NextRandom(state)) | 1u; // Zero would ask for a random seed.
+
+        systems.push_back(system);
+    }
+
+    return systems;
+}
+
+/// Finds the sector containing a universe-space position.
+/// The Y axis is compressed to give the galaxy a disc shape.
+/// Indices are clamped before the conversion to int, which is undefined outside its range.
+SectorCoord SectorGenerator::GetSector(float x, float y, float z) const
+{
+    auto index = [](float position, float size)
+    {
+        float limit = static_cast<float>(MaxSectorIndex);
+        return static_cast<int>(std::clamp(std::floor(position / size), -limit, limit));
+    };
+    SectorCoord coord;
+    coord.x = index(x, m_SectorSize);
+    coord.y = index(y, m_SectorSize * 0.25f);
+    coord.z = index(z, m_SectorSize);
+    return coord;
+}
+
+/// Hashes all bits of the three sector coordinates into a 64-bit key.
+/// X and Y fill the first SplitMix64 state exactly, Z is mixed into its output, so every coordinate bit
+/// reaches the whole key.
+uint64_t SectorGenerator::GetKey(const SectorCoord& coord)
+{
+    uint64_t state = (static_cast<uint64_t>(static_cast<uint32_t>(coord.x)) << 32) | static_cast<uint32_t>(coord.y);
+    state = NextRandom(state) ^ static_cast<uint32_t>(coord.z);
+    return NextRandom(state);
+}
+
+/// Advances a SplitMix64 state and returns the next 64-bit value.
+uint64_t SectorGenerator::NextRandom(uint64_t& state)
+{
+    uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+/// Returns a float in [min, max) from a SplitMix64 state.
+/// Uses the top 24 bits so the result is exactly representable.
+float SectorGenerator::NextFloat(uint64_t& state, float min, float max)
+{
+    float unit = static_cast<float>(NextRandom(state) >> 40) / static_cast<float>(1ull << 24);
+    return min + (max - min) * unit;
+}
+
+/// Constructor to initialize the streamer.
+SectorStreamer::SectorStreamer(const SectorGenerator& generator)
+    : m_Generator(generator)
+{
+}
+
+/// Collects finished sectors, evicts distant ones and requests missing ones.
+void SectorStreamer::Update(const SectorCoord& center, std::vector<StarSystemDesc>* evicted)
+{
+    CollectSectors(center);
+    EvictSectors(center, evicted);
+    RequestSectors(center);
+}
+
+/// Starts generating missing sectors around the centre sector, nearest shells first.
+/// Jobs only capture a copy of the generator, so they never touch streamer state.
+void SectorStreamer::RequestSectors(const SectorCoord& center)
+{
+    for (int shell = 0; shell <= loadRadius; ++shell)
+    {
+        for (int x = -shell; x <= shell; ++x)
+        {
+            for (int y = -shell; y <= shell; ++y)
+            {
+                for (int z = -shell; z <= shell; ++z)
+                {
+                    if (static_cast<int>(m_Pending.size()) >= maxPendingJobs)
+                        return;
+
+                    // Only visit the surface of the current shell.
+                    if (std::max(std::abs(x), std::max(std::abs(y), std::abs(z))) != shell)
+                        continue;
+
+                    SectorCoord coord = { center.x + x, center.y + y, center.z + z };
+                    if (m_Sectors.find(coord) != m_Sectors.end() || m_Pending.find(coord) != m_Pending.end())
+                        continue;
+
+                    SectorGenerator generator = m_Generator;
+                    m_Pending[coord] = std::async(std::launch::async, [generator, coord]()
+                        {
+                            auto start = std::chrono::high_resolution_clock::now();
+                            SectorData sector;
+                            sector.coord = coord;
+                            sector.systems = generator.Generate(coord);
+                            auto end = std::chrono::high_resolution_clock::now();
+                            sector.generationMs = std::chrono::duration<float, std::milli>(end - start).count();
+                            return sector;
+                        });
+                }
+            }
+        }
+    }
+}
+
+/// Moves finished sectors from the worker threads into the resident set.
+/// Sectors the ship has already left while they were generating are discarded.
+void SectorStreamer::CollectSectors(const SectorCoord& center)
+{
+    for (auto it = m_Pending.begin(); it != m_Pending.end();)
+    {
+        if (it->second.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+        {
+            ++it;
+            continue;
+        }
+
+        SectorData sector = it->second.get();
+        m_LastGenerationMs = sector.generationMs;
+        if (SectorDistance(sector.coord, center) <= loadRadius)
+        {
+            m_SystemCount += static_cast<int>(sector.systems.size());
+            m_Sectors[it->first] = std::move(sector);
+        }
+        it = m_Pending.erase(it);
+    }
+}
+
+/// Drops sectors outside the load radius (plus one sector of hysteresis).
+void SectorStreamer::EvictSectors(const SectorCoord& center, std::vector<StarSystemDesc>* evicted)
+{
+    for (auto it = m_Sectors.begin(); it != m_Sectors.end();)
+    {
+        if (SectorDistance(it->second.coord, center) <= loadRadius + 1)
+        {
+            ++it;
+            continue;
+        }
+
+        if (evicted)
+            evicted->insert(evicted->end(), it->second.systems.begin(), it->second.systems.end());
+        m_SystemCount -= static_cast<int>(it->second.systems.size());
+        it = m_Sectors.erase(it);
+    }
+}
+
+/// Calculates the Chebyshev distance between two sectors.
+int SectorStreamer::SectorDistance(const SectorCoord& a, const SectorCoord& b)
+{
+    return std::max(std::abs(a.x - b.x), std::max(std::abs(a.y - b.y), std::abs(a.z - b.z)));
+}
@@ -0,0 +1,169 @@
+#pragma once
+#include <cstdint>
+#include <future>
+#include <unordered_map>
+#include <vector>
+
+/// Integer coordinates of a cubic sector in the galaxy grid.
+struct SectorCoord
+{
+    int x; ///< Sector index along the X axis.
+    int y; ///< Sector index along the Y axis.
+    int z; ///< Sector index along the Z axis.
+
+    bool operator==(const SectorCoord& other) const { return x == other.x && y == other.y && z == other.z; }
+};
+
+/// Describes a star system seeded by a sector.
+/// Only plain data is stored here so sectors can be generated off the main thread.
+struct StarSystemDesc
+{
+    uint64_t id; ///< Stable identifier of the system (sector key and slot), see `SectorGenerator::GetKey`.
+    float x, y, z; ///< Position of the star in universe space.
+    float starSize; ///< Visual size of the star.
+    float r, g, b; ///< Colour of the star impostor.
+    int planetCount; ///< Number of orbits generated when the system becomes active.
+    uint32_t seed; ///< Seed used to generate the full planetary system.
+};
+
+/// Deterministically generates the star systems of a galaxy sector.
+/// The generator is stateless apart from its configuration, so it is safe to call from several threads
+/// and the same sector always yields the same systems for a given galaxy seed.
+/// Sectors are supported up to `MaxSectorIndex` from the origin along each axis, about 2e12 world units
+/// with 4000-unit sectors, which is further than float universe positions can tell sectors apart.
+class SectorGenerator
+{
+public:
+    /// Largest sector index along an axis. The headroom below `INT_MAX` keeps neighbour offsets and
+    /// distances between supported sectors from overflowing.
+    static constexpr int MaxSectorIndex = 1 << 29;
+
+    /// Constructor to initialize the generator.
+    /// @param galaxySeed Seed shared by all sectors of the galaxy.
+    /// @param sectorSize Edge length of a sector in world units.
+    /// @param maxSystemsPerSector Upper bound of systems a single sector may contain.
+    SectorGenerator(uint64_t galaxySeed, float sectorSize, int maxSystemsPerSector);
+
+    /// Generates all star systems of a sector.
+    /// @param coord The sector to generate.
+    /// @return The systems in the sector, possibly none.
+    std::vector<StarSystemDesc> Generate(const SectorCoord& coord) const;
+
+    /// Finds the sector containing a universe-space position.
+    /// @param x, y, z The position to look up.
+    /// @return The coordinates of the containing sector, clamped to `MaxSectorIndex`.
+    SectorCoord GetSector(float x, float y, float z) const;
+
+    /// Hashes all bits of the three sector coordinates into a 64-bit key.
+    /// The key seeds the sector and its system ids. Distinct sectors share a key only by hash collision,
+    /// so containers of sectors compare the coordinates themselves, see `SectorCoordHash`.
+    /// @param coord The sector coordinates.
+    /// @return The hashed key.
+    static uint64_t GetKey(const SectorCoord& coord);
+
+    /// Retrieves the edge length of a sector.
+    /// @return The sector size in world units.
+    float GetSectorSize() const { return m_SectorSize; }
+
+private:
+    /// Advances a SplitMix64 state and returns the next 64-bit value.
+    /// Used instead of the standard distributions so results match on every platform.
+    /// @param state The state to advance.
+    /// @return The next pseudo-random value.
+    static uint64_t NextRandom(uint64_t& state);
+
+    /// Returns a float in [min, max) from a SplitMix64 state.
+    /// @param state The state to advance.
+    /// @param min The minimum value.
+    /// @param max The maximum value.
+    /// @return A pseudo-random float.
+    static float NextFloat(uint64_t& state, float min, float max);
+
+    uint64_t m_GalaxySeed; ///< Seed shared by all sectors.
+    float m_SectorSize; ///< Edge length of a sector.
+    int m_MaxSystemsPerSector; ///< Upper bound of systems in a sector.
+};
+
+/// Hash of sector coordinates for unordered containers keyed by `SectorCoord`.
+struct SectorCoordHash
+{
+    size_t operator()(const SectorCoord& coord) const { return static_cast<size_t>(SectorGenerator::GetKey(coord)); }
+};
+
+/// A resident sector and the systems it seeded.
+struct SectorData
+{
+    SectorCoord coord; ///< Coordinates of the sector.
+    std::vector<StarSystemDesc> systems; ///< Systems seeded by the sector.
+    float generationMs; ///< Time spent generating the sector on the worker.
+};
+
+/// Keeps the sectors around a moving centre resident, generating them on worker threads.
+/// Sectors within `loadRadius` are requested nearest shells first, and sectors further than
+/// `loadRadius + 1` are evicted, so memory stays bounded however far the centre moves.
+/// Only uses the standard library, so it can be tested away from Direct3D.
+class SectorStreamer
+{
+public:
+    /// Constructor to initialize the streamer.
+    /// @param generator The generator copied into every worker job.
+    explicit SectorStreamer(const SectorGenerator& generator);
+
+    /// Collects finished sectors, evicts distant ones and requests missing ones.
+    /// @param center The sector containing the ship.
+    /// @param evicted If not null, receives the systems of the sectors evicted by this update.
+    void Update(const SectorCoord& center, std::vector<StarSystemDesc>* evicted = nullptr);
+
+    /// Retrieves the resident sectors.
+    /// @return The sectors indexed by their coordinates.
+    const std::unordered_map<SectorCoord, SectorData, SectorCoordHash>& GetSectors() const { return m_Sectors; }
+
+    /// Retrieves the generator shared with the worker jobs.
+    /// @return The sector generator.
+    const SectorGenerator& GetGenerator() const { return m_Generator; }
+
+    /// Retrieves the number of resident sectors.
+    /// @return The sector count.
+    int GetSectorCount() const { return static_cast<int>(m_Sectors.size()); }
+
+    /// Retrieves the number of sectors still being generated.
+    /// @return The pending job count.
+    int GetPendingCount() const { return static_cast<int>(m_Pending.size()); }
+
+    /// Retrieves the number of star systems in resident sectors.
+    /// @return The system count.
+    int GetSystemCount() const { return m_SystemCount; }
+
+    /// Retrieves the worker-side cost of the last generated sector.
+    /// @return Generation time in milliseconds.
+    float GetLastGenerationMs() const { return m_LastGenerationMs; }
+
+    /// Calculates the Chebyshev distance between two sectors.
+    /// @param a The first sector.
+    /// @param b The second sector.
+    /// @return The largest per-axis distance.
+    static int SectorDistance(const SectorCoord& a, const SectorCoord& b);
+
+    int loadRadius = 2; ///< Sectors kept resident around the ship, in sectors (Chebyshev distance).
+    int maxPendingJobs = 4; ///< Upper bound of sectors generated concurrently.
+
+private:
+    /// Starts generating missing sectors around the centre sector, nearest shells first.
+    /// @param center The sector containing the ship.
+    void RequestSectors(const SectorCoord& center);
+
+    /// Moves finished sectors from the worker threads into the resident set.
+    /// @param center The sector containing the ship.
+    void CollectSectors(const SectorCoord& center);
+
+    /// Drops sectors outside the load radius (plus one sector of hysteresis).
+    /// @param center The sector containing the ship.
+    /// @param evicted If not null, receives the systems of the evicted sectors.
+    void EvictSectors(const SectorCoord& center, std::vector<StarSystemDesc>* evicted);
+
+    SectorGenerator m_Generator; ///< Deterministic sector generator copied into the worker jobs.
+    std::unordered_map<SectorCoord, SectorData, SectorCoordHash> m_Sectors; ///< Resident sectors indexed by their coordinates.
+    std::unordered_map<SectorCoord, std::future<SectorData>, SectorCoordHash> m_Pending; ///< Sectors being generated on worker threads.
+    int m_SystemCount = 0; ///< Number of systems in resident sectors.
+    float m_LastGenerationMs = 0.0f; ///< Generation time of the last collected sector.
+};
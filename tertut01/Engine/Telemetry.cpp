@@ -0,0 +1,115 @@
+// Telemetry only depends on the standard library and is built without the precompiled
+// header, so the same file can be compiled into the unit tests.
+#include "Telemetry.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+/// Constructor to allocate the ring buffer.
+RollingSeries::RollingSeries(int capacity)
+    : m_Samples(std::max(capacity, 1), 0.0f)
+{
+    m_Scratch.reserve(m_Samples.size());
+}
+
+/// Adds a sample, overwriting the oldest one when the buffer is full.
+void RollingSeries::Push(float value)
+{
+    m_Samples[m_Next] = value;
+    m_Next = (m_Next + 1) % static_cast<int>(m_Samples.size());
+    m_Count = std::min(m_Count + 1, static_cast<int>(m_Samples.size()));
+}
+
+/// Calculates percentiles over the samples currently held, using the nearest-rank method.
+/// The samples are sorted once into a reused scratch buffer, so a query never allocates.
+TelemetryPercentiles RollingSeries::ComputePercentiles() const
+{
+    TelemetryPercentiles result;
+    if (m_Count == 0)
+        return result;
+
+    m_Scratch.assign(m_Samples.begin(), m_Samples.begin() + m_Count);
+    std::sort(m_Scratch.begin(), m_Scratch.end());
+
+    auto rank = [this](float percentile)
+        {
+            int index = static_cast<int>(std::ceil(percentile / 100.0f * m_Count)) - 1;
+            return m_Scratch[std::max(0, std::min(index, m_Count - 1))];
+        };
+    result.p50 = rank(50.0f);
+    result.p95 = rank(95.0f);
+    result.p99 = rank(99.0f);
+    return result;
+}
+
+/// Retrieves the most recent sample.
+float RollingSeries::GetLatest() const
+{
+    if (m_Count == 0)
+        return 0.0f;
+    int size = static_cast<int>(m_Samples.size());
+    return m_Samples[(m_Next + size - 1) % size];
+}
+
+/// Constructor to initialize the rolling series.
+Telemetry::Telemetry(int historyLength)
+{
+    for (RollingSeries& series : m_Series)
+    {
+        series = RollingSeries(historyLength);
+    }
+}
+
+/// Adds the counters of a finished frame and appends them to the CSV stream if one is open.
+void Telemetry::AddFrame(const TelemetryFrame& frame)
+{
+    m_Series[static_cast<int>(TelemetrySeries::Frame)].Push(frame.frameMs);
+    m_Series[static_cast<int>(TelemetrySeries::Update)].Push(frame.updateMs);
+    m_Series[static_cast<int>(TelemetrySeries::Render)].Push(frame.renderMs);
+    m_Series[static_cast<int>(TelemetrySeries::Physics)].Push(frame.physicsMs);
+    m_Latest = frame;
+
+    if (m_Csv.is_open())
+    {
+        m_Csv << FormatCsvRow(m_FrameCount, frame) << '\n';
+    }
+    ++m_FrameCount;
+}
+
+/// Starts streaming every subsequent frame to a CSV file, replacing any open stream.
+bool Telemetry::StartCsv(const std::string& path)
+{
+    StopCsv();
+    m_Csv.open(path, std::ios::out | std::ios::trunc);
+    if (!m_Csv.is_open())
+        return false;
+
+    m_Csv << GetCsvHeader() << '\n';
+    return true;
+}
+
+/// Stops streaming and closes the CSV file.
+void Telemetry::StopCsv()
+{
+    if (m_Csv.is_open())
+    {
+        m_Csv.close();
+    }
+}
+
+/// Retrieves the header line written at the top of every CSV file.
+const char* Telemetry::GetCsvHeader()
+{
+    return "frame,frame_ms,update_ms,render_ms,physics_ms,planets,draw_calls,broadphase_pairs,manifolds,gpu_buffer_bytes,texture_bytes";
+}
+
+/// Formats the counters of a frame as a CSV row, without a trailing newline.
+std::string Telemetry::FormatCsvRow(uint64_t frameIndex, const TelemetryFrame& frame)
+{
+    char row[256];
+    std::snprintf(row, sizeof(row), "%llu,%.4f,%.4f,%.4f,%.4f,%d,%d,%d,%d,%llu,%llu",
+        static_cast<unsigned long long>(frameIndex), frame.frameMs, frame.updateMs, frame.renderMs, frame.physicsMs,
+        frame.planets, frame.drawCalls, frame.broadphasePairs, frame.manifolds,
+        static_cast<unsigned long long>(frame.gpuBufferBytes), static_cast<unsigned long long>(frame.textureBytes));
+    return row;
+}
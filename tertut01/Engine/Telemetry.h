@@ -0,0 +1,134 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+/// Counters collected for a single frame.
+/// Timings are CPU-side wall-clock durations in milliseconds.
+struct TelemetryFrame
+{
+    float frameMs = 0.0f; ///< Time between the start of this frame and the previous one.
+    float updateMs = 0.0f; ///< Time spent in Game::Update, physics included.
+    float renderMs = 0.0f; ///< Time spent recording and presenting the frame.
+    float physicsMs = 0.0f; ///< Time spent in btDiscreteDynamicsWorld::stepSimulation.
+    int planets = 0; ///< Number of planets alive across all planetary systems.
+    int drawCalls = 0; ///< Number of draw calls issued by the frame.
+    int broadphasePairs = 0; ///< Number of overlapping pairs in the broadphase.
+    int manifolds = 0; ///< Number of contact manifolds in the dispatcher.
+    uint64_t gpuBufferBytes = 0; ///< Bytes held by vertex and index buffers.
+    uint64_t textureBytes = 0; ///< Bytes held by textures.
+};
+
+/// Percentiles of a rolling series.
+struct TelemetryPercentiles
+{
+    float p50 = 0.0f; ///< Median.
+    float p95 = 0.0f; ///< 95th percentile.
+    float p99 = 0.0f; ///< 99th percentile.
+};
+
+/// A fixed-length ring buffer of samples with percentile queries.
+class RollingSeries
+{
+public:
+    /// Constructor to allocate the ring buffer.
+    /// @param capacity Number of most recent samples kept.
+    explicit RollingSeries(int capacity = 240);
+
+    /// Adds a sample, overwriting the oldest one when the buffer is full.
+    /// @param value The sample to add.
+    void Push(float value);
+
+    /// Calculates percentiles over the samples currently held, using the nearest-rank method.
+    /// @return The percentiles, or zeros if the series is empty.
+    TelemetryPercentiles ComputePercentiles() const;
+
+    /// Retrieves the most recent sample.
+    /// @return The latest sample, or zero if the series is empty.
+    float GetLatest() const;
+
+    /// Retrieves the number of samples currently held.
+    /// @return The sample count.
+    int GetCount() const { return m_Count; }
+
+    /// Retrieves the raw ring buffer, for plotting.
+    /// @return Pointer to `GetCount()` samples starting at `GetOffset()`, wrapping around.
+    const float* GetData() const { return m_Samples.data(); }
+
+    /// Retrieves the index of the oldest sample in the ring buffer.
+    /// @return The ring offset.
+    int GetOffset() const { return m_Count < static_cast<int>(m_Samples.size()) ? 0 : m_Next; }
+
+private:
+    std::vector<float> m_Samples; ///< Ring buffer of samples.
+    mutable std::vector<float> m_Scratch; ///< Sorted copy reused by percentile queries.
+    int m_Next = 0; ///< Index the next sample is written to.
+    int m_Count = 0; ///< Number of valid samples.
+};
+
+/// Identifies the timing series kept by `Telemetry`.
+enum class TelemetrySeries
+{
+    Frame,
+    Update,
+    Render,
+    Physics,
+    Count
+};
+
+/// Aggregates per-frame counters into rolling series and optionally streams them to a CSV file.
+/// The class only uses the standard library, so it can be tested away from Direct3D.
+class Telemetry
+{
+public:
+    /// Constructor to initialize the rolling series.
+    /// @param historyLength Number of frames kept for plots and percentiles.
+    explicit Telemetry(int historyLength = 240);
+
+    /// Adds the counters of a finished frame.
+    /// @param frame The counters of the frame.
+    void AddFrame(const TelemetryFrame& frame);
+
+    /// Retrieves the counters of the last frame.
+    /// @return The latest frame.
+    const TelemetryFrame& GetLatest() const { return m_Latest; }
+
+    /// Retrieves one of the rolling timing series.
+    /// @param series The series to retrieve.
+    /// @return The rolling series.
+    const RollingSeries& GetSeries(TelemetrySeries series) const { return m_Series[static_cast<int>(series)]; }
+
+    /// Retrieves the number of frames added so far.
+    /// @return The frame count.
+    uint64_t GetFrameCount() const { return m_FrameCount; }
+
+    /// Starts streaming every subsequent frame to a CSV file, replacing any open stream.
+    /// @param path Path of the file to create.
+    /// @return True if the file was opened.
+    bool StartCsv(const std::string& path);
+
+    /// Stops streaming and closes the CSV file.
+    void StopCsv();
+
+    /// Checks whether frames are being streamed to a CSV file.
+    /// @return True if a CSV file is open.
+    bool IsCsvOpen() const { return m_Csv.is_open(); }
+
+    /// Retrieves the header line written at the top of every CSV file.
+    /// @return The comma-separated column names.
+    static const char* GetCsvHeader();
+
+    /// Formats the counters of a frame as a CSV row, without a trailing newline.
+    /// @param frameIndex The index of the frame.
+    /// @param frame The counters of the frame.
+    /// @return The comma-separated values.
+    static std::string FormatCsvRow(uint64_t frameIndex, const TelemetryFrame& frame);
+
+private:
+    RollingSeries m_Series[static_cast<int>(TelemetrySeries::Count)]; ///< Rolling timing series.
+    TelemetryFrame m_Latest; ///< Counters of the last frame.
+    uint64_t m_FrameCount = 0; ///< Number of frames added.
+    std::ofstream m_Csv; ///< Open CSV stream, if any.
+};
@@ -0,0 +1,265 @@
+#include "pch.h"
+#include "TerrainCollision.h"
+#include <chrono>
+
+/// Constructor to initialize the patch pool.
+/// Height buffers are allocated once here; shapes keep pointers into them, so they are never resized.
+TerrainCollision::TerrainCollision(btDiscreteDynamicsWorld* dynamicsWorld, int patchCount, int resolution)
+    : m_DynamicsWorld(dynamicsWorld), m_Patches(patchCount), m_Resolution(resolution)
+{
+    for (Patch& patch : m_Patches)
+    {
+        patch.heights.assign(resolution * resolution, 0.0f);
+        patch.staging.assign(resolution * resolution, 0.0f);
+    }
+}
+
+/// Destructor to remove the patches from the physics world and release them.
+TerrainCollision::~TerrainCollision()
+{
+    for (Patch& patch : m_Patches)
+    {
+        Release(patch);
+        delete patch.body;
+        delete patch.motionState;
+        delete patch.shape;
+    }
+}
+
+/// Assigns patches to the nearest planets, recentres them under the ship and continues pending builds.
+void TerrainCollision::Update(const DirectX::SimpleMath::Vector3& shipPos, const std::vector<PlanetSurface>& surfaces)
+{
+    // Find the planets whose displaced surface is within reach of the ship, nearest first.
+    std::vector<std::pair<float, const PlanetSurface*>> candidates;
+    for (const PlanetSurface& surface : surfaces)
+    {
+        float distance = (shipPos - surface.center).Length();
+        float reach = surface.radius * (1.0f + surface.noiseAmplitude) + activationMargin;
+        if (distance < reach)
+        {
+            candidates.emplace_back(distance, &surface);
+        }
+    }
+    std::sort(candidates.begin(), candidates.end(),
+        [](const auto& a, const auto& b) { return a.first < b.first; });
+    if (candidates.size() > m_Patches.size())
+    {
+        candidates.resize(m_Patches.size());
+    }
+
+    // Free the patches of planets that are no longer near, and refresh the others.
+    for (Patch& patch : m_Patches)
+    {
+        if (!patch.planet)
+            continue;
+
+        auto match = std::find_if(candidates.begin(), candidates.end(),
+            [&patch](const auto& candidate) { return candidate.second->planet == patch.planet; });
+        if (match == candidates.end())
+        {
+            Release(patch);
+            continue;
+        }
+
+        // Planets orbit and spin every frame; the noise parameters stay as they were at build time.
+        patch.surface.center = match->second->center;
+        patch.surface.spinAngle = match->second->spinAngle;
+        candidates.erase(match);
+
+        // Recentre once the ship has moved a quarter of the patch away from its centre.
+        btVector3 shipDir = ToPlanetSpace(patch.surface, shipPos).normalized();
+        btVector3 patchUp = patch.frame.getBasis().getColumn(1);
+        if (patch.nextRow < 0 && shipDir.angle(patchUp) > patchSpan * 0.25f)
+        {
+            BeginBuild(patch, shipDir);
+        }
+    }
+
+    // Hand the remaining free patches to newly approached planets.
+    for (const auto& candidate : candidates)
+    {
+        for (Patch& patch : m_Patches)
+        {
+            if (!patch.planet)
+            {
+                Assign(patch, *candidate.second, ToPlanetSpace(*candidate.second, shipPos).normalized());
+                break;
+            }
+        }
+    }
+
+    // Build staged rows until the frame budget runs out; always make some progress.
+    auto frameStart = std::chrono::high_resolution_clock::now();
+    float elapsedMs = 0.0f;
+    bool builtRow = false;
+    for (Patch& patch : m_Patches)
+    {
+        while (patch.nextRow >= 0 && (!builtRow || elapsedMs < buildBudgetMs))
+        {
+            BuildRow(patch);
+            builtRow = true;
+
+            float previousMs = elapsedMs;
+            elapsedMs = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - frameStart).count();
+            patch.buildMs += elapsedMs - previousMs;
+
+            if (patch.nextRow >= m_Resolution)
+            {
+                // Publish the finished patch; the shape reads the live buffer directly.
+                std::copy(patch.staging.begin(), patch.staging.end(), patch.heights.begin());
+                patch.frame = patch.stagingFrame;
+                patch.nextRow = -1;
+                m_LastPatchMs = patch.buildMs;
+
+                // Place the new frame where the planet was on the previous step, so the jump to the
+                // recentred frame is not taken for surface velocity.
+                btTransform previous = patch.planetTransform * patch.frame;
+                patch.body->setWorldTransform(previous);
+                patch.body->setInterpolationWorldTransform(previous);
+                patch.motionState->setWorldTransform(previous);
+
+                if (!patch.inWorld)
+                {
+                    m_DynamicsWorld->addRigidBody(patch.body);
+                    patch.inWorld = true;
+                }
+            }
+        }
+    }
+    m_FrameBuildMs = elapsedMs;
+
+    // Carry the live patches along with their planet's orbit and spin. The next step reads the
+    // new transform from the motion state and derives the surface velocity from the previous one.
+    for (Patch& patch : m_Patches)
+    {
+        if (!patch.planet)
+            continue;
+
+        patch.planetTransform = PlanetTransform(patch.surface);
+        if (patch.inWorld)
+        {
+            patch.motionState->setWorldTransform(patch.planetTransform * patch.frame);
+        }
+    }
+}
+
+/// Retrieves the number of patches currently in the physics world.
+int TerrainCollision::GetActivePatchCount() const
+{
+    int count = 0;
+    for (const Patch& patch : m_Patches)
+    {
+        if (patch.inWorld)
+            ++count;
+    }
+    return count;
+}
+
+/// Assigns a free patch to a planet and starts building it under the ship.
+/// The shape is recreated because its height range and grid spacing depend on the planet size.
+void TerrainCollision::Assign(Patch& patch, const PlanetSurface& surface, const btVector3& shipDir)
+{
+    patch.planet = surface.planet;
+    patch.surface = surface;
+    patch.noise.reseed(surface.noiseSeed);
+    patch.planetTransform = PlanetTransform(surface);
+
+    float maxHeight = surface.radius * (1.0f + surface.noiseAmplitude);
+    float cellSize = patchSpan * surface.radius / (m_Resolution - 1);
+
+    delete patch.shape;
+    patch.shape = new btHeightfieldTerrainShape(m_Resolution, m_Resolution, patch.heights.data(), -maxHeight, maxHeight, 1, false);
+    patch.shape->setLocalScaling(btVector3(cellSize, 1.0f, cellSize));
+
+    if (!patch.body)
+    {
+        // Kinematic, so each step takes the transform from the motion state and gives the body its velocity.
+        patch.motionState = new btDefaultMotionState();
+        btRigidBody::btRigidBodyConstructionInfo rbInfo(0.0f, patch.motionState, patch.shape);
+        patch.body = new btRigidBody(rbInfo);
+        patch.body->setCollisionFlags(patch.body->getCollisionFlags() | btCollisionObject::CF_KINEMATIC_OBJECT);
+        patch.body->setActivationState(DISABLE_DEACTIVATION);
+    }
+    else
+    {
+        patch.body->setCollisionShape(patch.shape);
+    }
+
+    BeginBuild(patch, shipDir);
+}
+
+/// Releases a patch and removes it from the physics world.
+void TerrainCollision::Release(Patch& patch)
+{
+    if (patch.inWorld)
+    {
+        m_DynamicsWorld->removeRigidBody(patch.body);
+        patch.inWorld = false;
+    }
+    patch.planet = nullptr;
+    patch.nextRow = -1;
+}
+
+/// Starts building a patch centred on a direction in planet space.
+/// The patch frame sits on the undisplaced sphere with its Y axis along the surface normal.
+void TerrainCollision::BeginBuild(Patch& patch, const btVector3& shipDir)
+{
+    btVector3 up = shipDir;
+    btVector3 tangent, bitangent;
+    btPlaneSpace1(up, tangent, bitangent);
+    bitangent = tangent.cross(up);
+
+    patch.stagingFrame.setBasis(btMatrix3x3(
+        tangent.x(), up.x(), bitangent.x(),
+        tangent.y(), up.y(), bitangent.y(),
+        tangent.z(), up.z(), bitangent.z()));
+    patch.stagingFrame.setOrigin(up * patch.surface.radius);
+    patch.nextRow = 0;
+    patch.buildMs = 0.0f;
+}
+
+/// Builds one row of staging heights from the planet noise.
+/// Each sample is projected onto the displaced surface exactly as ModelClass::LoadPlanetModel
+/// displaces mesh vertices, then measured along the patch normal.
+void TerrainCollision::BuildRow(Patch& patch)
+{
+    const PlanetSurface& surface = patch.surface;
+    float cellSize = patchSpan * surface.radius / (m_Resolution - 1);
+    float half = 0.5f * (m_Resolution - 1);
+    float maxHeight = surface.radius * (1.0f + surface.noiseAmplitude);
+
+    const btVector3& origin = patch.stagingFrame.getOrigin();
+    btVector3 up = patch.stagingFrame.getBasis().getColumn(1);
+
+    int row = patch.nextRow;
+    for (int i = 0; i < m_Resolution; ++i)
+    {
+        btVector3 local((i - half) * cellSize, 0.0f, (row - half) * cellSize);
+        btVector3 dir = (patch.stagingFrame * local).normalized();
+
+        float n = static_cast<float>(patch.noise.normalizedOctave3D_01(
+            dir.x() * surface.noiseFrequency, dir.y() * surface.noiseFrequency, dir.z() * surface.noiseFrequency, 5, 0.5));
+        btVector3 surfacePoint = dir * (surface.radius * (1.0f + n * surface.noiseAmplitude));
+
+        float height = (surfacePoint - origin).dot(up);
+        patch.staging[row * m_Resolution + i] = btClamped(height, -maxHeight, maxHeight);
+    }
+    ++patch.nextRow;
+}
+
+/// Converts a world-space position to planet space by removing the planet translation and spin.
+btVector3 TerrainCollision::ToPlanetSpace(const PlanetSurface& surface, const DirectX::SimpleMath::Vector3& worldPos)
+{
+    btVector3 offset(worldPos.x - surface.center.x, worldPos.y - surface.center.y, worldPos.z - surface.center.z);
+    return quatRotate(btQuaternion(btVector3(0, 1, 0), -surface.spinAngle), offset);
+}
+
+/// Builds the world transform of a planet from its translation and spin.
+btTransform TerrainCollision::PlanetTransform(const PlanetSurface& surface)
+{
+    btTransform transform;
+    transform.setIdentity();
+    transform.setOrigin(btVector3(surface.center.x, surface.center.y, surface.center.z));
+    transform.setRotation(btQuaternion(btVector3(0, 1, 0), surface.spinAngle));
+    return transform;
+}
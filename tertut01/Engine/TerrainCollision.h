@@ -0,0 +1,116 @@
+#pragma once
+
+#include <vector>
+#include <SimpleMath.h>
+#include <btBulletDynamicsCommon.h>
+#include <BulletCollision/CollisionShapes/btHeightfieldTerrainShape.h>
+#include "PerlinNoise.hpp"
+
+class Planet;
+
+/// Describes the displaced surface of a planet so collision can be rebuilt from the same noise as its mesh.
+struct PlanetSurface
+{
+    const Planet* planet; ///< The planet the surface belongs to, used as an identity.
+    DirectX::SimpleMath::Vector3 center; ///< Centre of the planet in world space.
+    float radius; ///< Undisplaced radius of the planet (the render scale).
+    float spinAngle; ///< Current spin of the planet around its Y axis.
+    unsigned int noiseSeed; ///< Seed of the Perlin noise used to displace the mesh.
+    float noiseAmplitude; ///< Noise amplitude the mesh was built with.
+    float noiseFrequency; ///< Noise frequency the mesh was built with.
+};
+
+/// Generates small heightfield collision patches under the spaceship when it approaches a planet.
+/// A fixed pool of patches is recycled as the ship moves, so narrowphase cost does not depend on
+/// the number of planets or on mesh detail. Patches are rebuilt row by row under a per-frame time budget.
+class TerrainCollision
+{
+public:
+    /// Constructor to initialize the patch pool.
+    /// @param dynamicsWorld Pointer to the Bullet physics dynamics world.
+    /// @param patchCount Number of patches that may be active at once.
+    /// @param resolution Number of height samples along each side of a patch.
+    TerrainCollision(btDiscreteDynamicsWorld* dynamicsWorld, int patchCount = 2, int resolution = 17);
+
+    /// Destructor to remove the patches from the physics world and release them.
+    ~TerrainCollision();
+
+    /// Assigns patches to the nearest planets, recentres them under the ship and continues pending builds.
+    /// @param shipPos The position of the spaceship in world space.
+    /// @param surfaces The surfaces of every planet that may be approached.
+    void Update(const DirectX::SimpleMath::Vector3& shipPos, const std::vector<PlanetSurface>& surfaces);
+
+    /// Retrieves the time spent building patches during the last update.
+    /// @return Build time in milliseconds.
+    float GetFrameBuildMs() const { return m_FrameBuildMs; }
+
+    /// Retrieves the total time spent on the last completed patch, across all frames it took.
+    /// @return Build time in milliseconds.
+    float GetLastPatchMs() const { return m_LastPatchMs; }
+
+    /// Retrieves the number of patches currently in the physics world.
+    /// @return The active patch count.
+    int GetActivePatchCount() const;
+
+    float buildBudgetMs = 0.5f; ///< Time allowed for patch building per frame (at least one row is always built).
+    float patchSpan = 0.5f; ///< Width of a patch as a fraction of the planet radius.
+    float activationMargin = 60.0f; ///< Distance above the highest terrain at which a patch is requested.
+
+private:
+    /// A recyclable heightfield patch.
+    struct Patch
+    {
+        std::vector<float> heights; ///< Heights referenced by the live shape.
+        std::vector<float> staging; ///< Heights of the patch being built.
+        btHeightfieldTerrainShape* shape = nullptr; ///< The heightfield shape.
+        btDefaultMotionState* motionState = nullptr; ///< Transform the body reads on each simulation step.
+        btRigidBody* body = nullptr; ///< Kinematic body carrying the shape.
+        bool inWorld = false; ///< Whether the body is currently in the physics world.
+
+        const Planet* planet = nullptr; ///< The planet the patch is assigned to, or null if free.
+        PlanetSurface surface; ///< Surface parameters the patch is built from.
+        siv::PerlinNoise noise; ///< Noise matching the planet mesh.
+        btTransform frame; ///< Live patch frame in planet space.
+        btTransform stagingFrame; ///< Frame of the patch being built.
+        btTransform planetTransform; ///< Planet transform of the previous update, where the body was last placed.
+        int nextRow = -1; ///< Next staging row to build, or -1 when no build is pending.
+        float buildMs = 0.0f; ///< Time accumulated on the current build.
+    };
+
+    /// Assigns a free patch to a planet and starts building it under the ship.
+    /// @param patch The patch to assign.
+    /// @param surface The surface of the planet.
+    /// @param shipDir Direction from the planet centre to the ship, in planet space.
+    void Assign(Patch& patch, const PlanetSurface& surface, const btVector3& shipDir);
+
+    /// Releases a patch and removes it from the physics world.
+    /// @param patch The patch to release.
+    void Release(Patch& patch);
+
+    /// Starts building a patch centred on a direction in planet space.
+    /// @param patch The patch to rebuild.
+    /// @param shipDir Direction from the planet centre to the ship, in planet space.
+    void BeginBuild(Patch& patch, const btVector3& shipDir);
+
+    /// Builds one row of staging heights from the planet noise.
+    /// @param patch The patch being built.
+    void BuildRow(Patch& patch);
+
+    /// Converts a world-space position to planet space by removing the planet translation and spin.
+    /// @param surface The planet surface.
+    /// @param worldPos The world position to convert.
+    /// @return The unnormalised offset from the planet centre in planet space.
+    static btVector3 ToPlanetSpace(const PlanetSurface& surface, const DirectX::SimpleMath::Vector3& worldPos);
+
+    /// Builds the world transform of a planet from its translation and spin.
+    /// @param surface The planet surface.
+    /// @return The planet-to-world transform.
+    static btTransform PlanetTransform(const PlanetSurface& surface);
+
+    btDiscreteDynamicsWorld* m_DynamicsWorld; ///< Pointer to the Bullet physics dynamics world.
+    std::vector<Patch> m_Patches; ///< Pool of recyclable patches.
+    int m_Resolution; ///< Number of samples along each side of a patch.
+
+    float m_FrameBuildMs = 0.0f; ///< Build time spent in the last update.
+    float m_LastPatchMs = 0.0f; ///< Total build time of the last completed patch.
+};
@@ -0,0 +1,229 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "ParticleSystem.h"
+
+namespace
+{
+	/// A live particle read back through the vertex writer.
+	struct ParticleSample
+	{
+		btVector3 position; ///< Centre of the quad.
+		float age; ///< Normalised age, recovered from the alpha ramp.
+	};
+
+	/// Reads every live particle back from the quads the system writes.
+	/// With the default colours alpha goes from one to zero, so the age is `1 - alpha`.
+	std::vector<ParticleSample> ReadParticles(const ParticleSystem& particles)
+	{
+		std::vector<ParticleVertex> vertices(particles.GetCount() * 4);
+		size_t quads = particles.WriteVertices(vertices.data(), particles.GetCount(), btVector3(1, 0, 0), btVector3(0, 1, 0));
+
+		std::vector<ParticleSample> samples(quads);
+		for (size_t i = 0; i < quads; ++i)
+		{
+			const ParticleVertex& a = vertices[i * 4];
+			const ParticleVertex& b = vertices[i * 4 + 2];
+			samples[i].position = btVector3((a.x + b.x) * 0.5f, (a.y + b.y) * 0.5f, (a.z + b.z) * 0.5f);
+			samples[i].age = 1.0f - a.a;
+		}
+		return samples;
+	}
+
+	/// Creates an emitter at a fixed offset with no spread, so spawned particles are predictable.
+	ParticleEmitter MakeEmitter(const btVector3& offset, float rate, float lifetime)
+	{
+		ParticleEmitter emitter;
+		emitter.localOffset = offset;
+		emitter.rate = rate;
+		emitter.spread = 0.0f;
+		emitter.lifetime = lifetime;
+		emitter.enabled = true;
+		return emitter;
+	}
+}
+
+GTEST_TEST(ParticleSystem, SpawnsRateTimesDeltaTime)
+{
+	ParticleSystem particles(1000);
+	int emitter = particles.AddEmitter(MakeEmitter(btVector3(0, 0, 0), 104.0f, 10.0f));
+	particles.SetEmitterTransform(emitter, btTransform::getIdentity(), btVector3(0, 0, 0));
+
+	particles.Update(0.125f);
+	EXPECT_EQ(13u, particles.GetCount());
+
+	// Spawn points follow the emission direction and are pre-aged by their share of the frame.
+	std::vector<ParticleSample> samples = ReadParticles(particles);
+	ASSERT_EQ(13u, samples.size());
+	for (size_t n = 0; n < samples.size(); ++n)
+	{
+		float age = (1.0f - (n + 1.0f) / 13.0f) * 0.125f;
+		EXPECT_NEAR(-60.0f * age, samples[n].position.z(), 1e-4f);
+		EXPECT_NEAR(0.0f, samples[n].position.x(), 1e-5f);
+		EXPECT_NEAR(age / 10.0f, samples[n].age, 1e-5f);
+	}
+
+	particles.Update(0.125f);
+	EXPECT_EQ(26u, particles.GetCount());
+}
+
+GTEST_TEST(ParticleSystem, EmissionStopsWhenThePoolIsFull)
+{
+	ParticleSystem particles(10);
+	int emitter = particles.AddEmitter(MakeEmitter(btVector3(0, 0, 0), 1000.0f, 10.0f));
+	particles.SetEmitterTransform(emitter, btTransform::getIdentity(), btVector3(0, 0, 0));
+
+	particles.Update(0.125f);
+	EXPECT_EQ(10u, particles.GetCount());
+	particles.Update(0.125f);
+	EXPECT_EQ(10u, particles.GetCount());
+	EXPECT_EQ(10u, particles.GetCapacity());
+}
+
+GTEST_TEST(ParticleSystem, SwapRemoveKeepsOnlyLiveParticles)
+{
+	// The short-lived particles are spawned first, so compaction has to pull the long-lived ones forward.
+	ParticleSystem particles(1000);
+	int shortLived = particles.AddEmitter(MakeEmitter(btVector3(-100, 0, 0), 104.0f, 0.2f));
+	int longLived = particles.AddEmitter(MakeEmitter(btVector3(100, 0, 0), 56.0f, 10.0f));
+	particles.SetEmitterTransform(shortLived, btTransform::getIdentity(), btVector3(0, 0, 0));
+	particles.SetEmitterTransform(longLived, btTransform::getIdentity(), btVector3(0, 0, 0));
+
+	particles.Update(0.125f);
+	EXPECT_EQ(20u, particles.GetCount());
+	particles.GetEmitter(shortLived).enabled = false;
+	particles.GetEmitter(longLived).enabled = false;
+
+	// Part of the short-lived batch dies first, then the rest of it.
+	particles.Update(0.1f);
+	EXPECT_LT(particles.GetCount(), 20u);
+	EXPECT_GT(particles.GetCount(), 7u);
+	for (const ParticleSample& sample : ReadParticles(particles))
+	{
+		EXPECT_LT(sample.age, 1.0f);
+	}
+
+	particles.Update(0.25f);
+	std::vector<ParticleSample> samples = ReadParticles(particles);
+	ASSERT_EQ(7u, samples.size());
+	for (const ParticleSample& sample : samples)
+	{
+		EXPECT_NEAR(100.0f, sample.position.x(), 1e-4f);
+		EXPECT_LT(sample.age, 1.0f);
+	}
+
+	particles.Update(20.0f);
+	EXPECT_EQ(0u, particles.GetCount());
+}
+
+GTEST_TEST(ParticleSystem, IntegrateMatchesScalarReference)
+{
+	// 13 particles leave a partial SIMD lane at the end of the pool.
+	ParticleSystem particles(1000);
+	particles.acceleration = btVector3(0, -9.8f, 2.0f);
+	particles.drag = 1.5f;
+	int emitter = particles.AddEmitter(MakeEmitter(btVector3(0, 0, 0), 104.0f, 10.0f));
+	particles.SetEmitterTransform(emitter, btTransform::getIdentity(), btVector3(0, 0, 0));
+	particles.Update(0.125f);
+	particles.GetEmitter(emitter).enabled = false;
+
+	std::vector<ParticleSample> reference = ReadParticles(particles);
+	std::vector<btVector3> velocity(reference.size(), btVector3(0, 0, -60.0f));
+	const float steps[] = { 0.016f, 0.033f, 0.008f, 0.1f };
+	for (float dt : steps)
+	{
+		particles.Update(dt);
+		float damping = std::max(0.0f, 1.0f - particles.drag * dt);
+		for (size_t n = 0; n < reference.size(); ++n)
+		{
+			velocity[n] = velocity[n] * damping + particles.acceleration * dt;
+			reference[n].position += velocity[n] * dt;
+			reference[n].age += dt / 10.0f;
+		}
+	}
+
+	std::vector<ParticleSample> samples = ReadParticles(particles);
+	ASSERT_EQ(reference.size(), samples.size());
+	for (size_t n = 0; n < samples.size(); ++n)
+	{
+		EXPECT_NEAR(reference[n].position.x(), samples[n].position.x(), 1e-4f);
+		EXPECT_NEAR(reference[n].position.y(), samples[n].position.y(), 1e-4f);
+		EXPECT_NEAR(reference[n].position.z(), samples[n].position.z(), 1e-4f);
+		EXPECT_NEAR(reference[n].age, samples[n].age, 1e-5f);
+	}
+}
+
+GTEST_TEST(ParticleSystem, ShiftOriginMovesParticles)
+{
+	ParticleSystem particles(100);
+	int emitter = particles.AddEmitter(MakeEmitter(btVector3(0, 0, 0), 104.0f, 10.0f));
+	particles.SetEmitterTransform(emitter, btTransform::getIdentity(), btVector3(0, 0, 0));
+	particles.Update(0.125f);
+
+	std::vector<ParticleSample> before = ReadParticles(particles);
+	particles.ShiftOrigin(btVector3(-5000, 0, 250));
+	std::vector<ParticleSample> after = ReadParticles(particles);
+	ASSERT_EQ(before.size(), after.size());
+	for (size_t n = 0; n < after.size(); ++n)
+	{
+		EXPECT_NEAR(before[n].position.x() - 5000.0f, after[n].position.x(), 1e-3f);
+		EXPECT_NEAR(before[n].position.z() + 250.0f, after[n].position.z(), 1e-3f);
+	}
+}
+
+GTEST_TEST(ParticleSystem, QuadIndices)
+{
+	uint32_t indices[12];
+	ParticleSystem::WriteQuadIndices(indices, 2);
+	const uint32_t expected[12] = { 0, 1, 2, 0, 2, 3, 4, 5, 6, 4, 6, 7 };
+	for (int i = 0; i < 12; ++i)
+	{
+		EXPECT_EQ(expected[i], indices[i]);
+	}
+}
+
+GTEST_TEST(ParticleSystem, UpdateTimings)
+{
+	const size_t counts[] = { 100000, 1000000 };
+	for (size_t count : counts)
+	{
+		// Fill the pool in a single frame, then time updates that only integrate and compact.
+		ParticleSystem particles(count, 7);
+		int emitter = particles.AddEmitter(MakeEmitter(btVector3(0, 0, 0), count * 8.0f, 100.0f));
+		particles.GetEmitter(emitter).spread = 0.15f;
+		particles.SetEmitterTransform(emitter, btTransform::getIdentity(), btVector3(0, 0, 0));
+		particles.Update(0.125f);
+		float spawnMs = particles.GetLastUpdateMs();
+		ASSERT_EQ(count, particles.GetCount());
+		particles.GetEmitter(emitter).enabled = false;
+
+		const int frames = 20;
+		float totalMs = 0.0f;
+		for (int frame = 0; frame < frames; ++frame)
+		{
+			particles.Update(1.0f / 60.0f);
+			totalMs += particles.GetLastUpdateMs();
+		}
+		EXPECT_EQ(count, particles.GetCount());
+
+		std::vector<ParticleVertex> vertices(count * 4);
+		auto start = std::chrono::high_resolution_clock::now();
+		size_t quads = particles.WriteVertices(vertices.data(), count, btVector3(1, 0, 0), btVector3(0, 1, 0));
+		auto end = std::chrono::high_resolution_clock::now();
+		EXPECT_EQ(count, quads);
+
+		printf("%zu particles: spawn %.2f ms, update %.3f ms, write vertices %.2f ms\n", count, spawnMs,
+			totalMs / frames, std::chrono::duration<float, std::milli>(end - start).count());
+	}
+}
+
+int main(int argc, char** argv)
+{
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
@@ -0,0 +1,234 @@
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "SectorGenerator.h"
+
+namespace
+{
+	/// Updates the streamer until every sector within the load radius is resident.
+	void Settle(SectorStreamer& streamer, const SectorCoord& center)
+	{
+		int side = 2 * streamer.loadRadius + 1;
+		for (int i = 0; i < 100000; ++i)
+		{
+			streamer.Update(center);
+			if (streamer.GetPendingCount() == 0 && streamer.GetSectorCount() >= side * side * side)
+				return;
+			std::this_thread::yield();
+		}
+		FAIL() << "sectors around (" << center.x << ", " << center.y << ", " << center.z << ") never settled";
+	}
+
+	/// Checks that only sectors within the load radius plus one sector of hysteresis are resident.
+	void ExpectBounded(const SectorStreamer& streamer, const SectorCoord& center)
+	{
+		int side = 2 * streamer.loadRadius + 3;
+		EXPECT_LE(streamer.GetSectorCount(), side * side * side);
+		EXPECT_LE(streamer.GetPendingCount(), streamer.maxPendingJobs);
+
+		int systems = 0;
+		for (const auto& [coord, sector] : streamer.GetSectors())
+		{
+			EXPECT_LE(SectorStreamer::SectorDistance(sector.coord, center), streamer.loadRadius + 1);
+			EXPECT_TRUE(sector.coord == coord);
+			systems += static_cast<int>(sector.systems.size());
+		}
+		EXPECT_EQ(systems, streamer.GetSystemCount());
+	}
+}
+
+GTEST_TEST(SectorGenerator, SameSeedYieldsSameSystems)
+{
+	SectorGenerator a(1234, 4000.0f, 4);
+	SectorGenerator b(1234, 4000.0f, 4);
+	SectorGenerator other(4321, 4000.0f, 4);
+
+	int total = 0;
+	int differing = 0;
+	for (int x = -3; x <= 3; ++x)
+	{
+		for (int z = -3; z <= 3; ++z)
+		{
+			SectorCoord coord = { x, 1, z };
+			std::vector<StarSystemDesc> first = a.Generate(coord);
+			std::vector<StarSystemDesc> second = b.Generate(coord);
+			std::vector<StarSystemDesc> again = a.Generate(coord);
+			ASSERT_EQ(first.size(), second.size());
+			ASSERT_EQ(first.size(), again.size());
+			for (size_t i = 0; i < first.size(); ++i)
+			{
+				EXPECT_EQ(first[i].id, second[i].id);
+				EXPECT_EQ(first[i].x, second[i].x);
+				EXPECT_EQ(first[i].y, second[i].y);
+				EXPECT_EQ(first[i].z, second[i].z);
+				EXPECT_EQ(first[i].starSize, second[i].starSize);
+				EXPECT_EQ(first[i].planetCount, second[i].planetCount);
+				EXPECT_EQ(first[i].seed, second[i].seed);
+				EXPECT_EQ(first[i].seed, again[i].seed);
+
+				// Every system lies in the sector that generated it.
+				SectorCoord home = a.GetSector(first[i].x, first[i].y, first[i].z);
+				EXPECT_TRUE(home == coord);
+			}
+			total += static_cast<int>(first.size());
+
+			std::vector<StarSystemDesc> shuffled = other.Generate(coord);
+			if (shuffled.size() != first.size() || (!first.empty() && shuffled[0].seed != first[0].seed))
+				++differing;
+		}
+	}
+
+	EXPECT_GT(total, 0);
+	EXPECT_GT(differing, 0);
+}
+
+GTEST_TEST(SectorGenerator, OriginSectorIsEmpty)
+{
+	SectorGenerator generator(1234, 4000.0f, 4);
+	EXPECT_TRUE(generator.Generate({ 0, 0, 0 }).empty());
+}
+
+GTEST_TEST(SectorGenerator, KeysCoverTheSupportedRange)
+{
+	// Sectors 2^20 apart, which shared a key when each axis was packed into 20 bits, and the range limits.
+	const int max = SectorGenerator::MaxSectorIndex;
+	const int values[] = { 0, 1, -1, 7, -8, 1000, -1000, (1 << 19) - 1, -(1 << 19), 1 << 20, -(1 << 20), (1 << 20) + 1, max, -max };
+	std::unordered_set<uint64_t> keys;
+	for (int x : values)
+	{
+		for (int y : values)
+		{
+			for (int z : values)
+			{
+				keys.insert(SectorGenerator::GetKey({ x, y, z }));
+			}
+		}
+	}
+	size_t count = sizeof(values) / sizeof(values[0]);
+	EXPECT_EQ(count * count * count, keys.size());
+
+	// Far sectors are seeded apart from their aliases near the origin.
+	SectorGenerator generator(1234, 4000.0f, 4);
+	int differing = 0;
+	for (int x = 1; x <= 8; ++x)
+	{
+		std::vector<StarSystemDesc> near = generator.Generate({ x, 0, 0 });
+		std::vector<StarSystemDesc> far = generator.Generate({ x + (1 << 20), 0, 0 });
+		if (near.size() != far.size() || (!near.empty() && near[0].seed != far[0].seed))
+			++differing;
+		for (size_t i = 0; i < near.size() && i < far.size(); ++i)
+			EXPECT_NE(near[i].id, far[i].id);
+	}
+	EXPECT_GT(differing, 0);
+
+	// Positions beyond the supported range are clamped rather than overflowing the int conversion.
+	SectorCoord clamped = generator.GetSector(1e30f, -1e30f, 0.0f);
+	EXPECT_EQ(max, clamped.x);
+	EXPECT_EQ(-max, clamped.y);
+	EXPECT_EQ(0, clamped.z);
+	EXPECT_EQ(2 * max, SectorStreamer::SectorDistance({ max, 0, 0 }, { -max, 0, 0 }));
+}
+
+GTEST_TEST(SectorStreamer, ResidencyStaysBoundedWhileMoving)
+{
+	SectorStreamer streamer(SectorGenerator(99, 4000.0f, 4));
+	streamer.loadRadius = 2;
+
+	SectorCoord center = { 0, 0, 0 };
+	Settle(streamer, center);
+	ExpectBounded(streamer, center);
+
+	// Fly diagonally, then turn around, checking residency after every update.
+	for (int step = 0; step < 24; ++step)
+	{
+		int direction = step < 12 ? 1 : -1;
+		center.x += direction;
+		center.z += (step % 2) * direction;
+		for (int frame = 0; frame < 4; ++frame)
+		{
+			streamer.Update(center);
+			ExpectBounded(streamer, center);
+		}
+		Settle(streamer, center);
+		ExpectBounded(streamer, center);
+
+		for (int x = -2; x <= 2; ++x)
+		{
+			for (int y = -2; y <= 2; ++y)
+			{
+				for (int z = -2; z <= 2; ++z)
+				{
+					SectorCoord coord = { center.x + x, center.y + y, center.z + z };
+					EXPECT_EQ(1u, streamer.GetSectors().count(coord));
+				}
+			}
+		}
+	}
+}
+
+GTEST_TEST(SectorStreamer, EvictionReportsSystems)
+{
+	SectorStreamer streamer(SectorGenerator(7, 4000.0f, 4));
+	streamer.loadRadius = 1;
+	Settle(streamer, { 0, 0, 0 });
+	int before = streamer.GetSystemCount();
+
+	// Jumping far away evicts every resident sector in the first update.
+	std::vector<StarSystemDesc> evicted;
+	streamer.Update({ 100, 0, 0 }, &evicted);
+	EXPECT_EQ(0, streamer.GetSectorCount());
+	EXPECT_EQ(0, streamer.GetSystemCount());
+	EXPECT_EQ(before, static_cast<int>(evicted.size()));
+}
+
+GTEST_TEST(SectorStreamer, LoadManySectorCrossings)
+{
+	SectorStreamer streamer(SectorGenerator(2024, 4000.0f, 4));
+	streamer.loadRadius = 2;
+	streamer.maxPendingJobs = 8;
+
+	const int crossings = 1000;
+	SectorCoord center = { 0, 0, 0 };
+	int maxResident = 0;
+	auto start = std::chrono::high_resolution_clock::now();
+	for (int i = 0; i < crossings; ++i)
+	{
+		// A wandering path that revisits sectors and changes axis every few crossings.
+		switch ((i / 5) % 4)
+		{
+		case 0: ++center.x; break;
+		case 1: ++center.z; break;
+		case 2: --center.y; break;
+		default: --center.x; break;
+		}
+
+		// A few frames without waiting leave stale jobs behind, then the new shell is loaded fully.
+		for (int frame = 0; frame < 3; ++frame)
+		{
+			streamer.Update(center);
+		}
+		ExpectBounded(streamer, center);
+		Settle(streamer, center);
+		ExpectBounded(streamer, center);
+		if (streamer.GetSectorCount() > maxResident)
+			maxResident = streamer.GetSectorCount();
+	}
+	auto end = std::chrono::high_resolution_clock::now();
+
+	int side = 2 * streamer.loadRadius + 3;
+	EXPECT_GE(maxResident, (side - 2) * (side - 2) * (side - 2));
+	EXPECT_LE(maxResident, side * side * side);
+	printf("%d sector crossings, at most %d resident sectors: %.1f ms\n", crossings, maxResident,
+		std::chrono::duration<double, std::milli>(end - start).count());
+}
+
+int main(int argc, char** argv)
+{
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
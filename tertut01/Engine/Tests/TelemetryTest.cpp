@@ -0,0 +1,124 @@
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "Telemetry.h"
+
+GTEST_TEST(Telemetry, EmptySeriesReportsZero)
+{
+	RollingSeries series(8);
+	TelemetryPercentiles percentiles = series.ComputePercentiles();
+	EXPECT_EQ(0, series.GetCount());
+	EXPECT_FLOAT_EQ(0.0f, series.GetLatest());
+	EXPECT_FLOAT_EQ(0.0f, percentiles.p50);
+	EXPECT_FLOAT_EQ(0.0f, percentiles.p99);
+}
+
+GTEST_TEST(Telemetry, NearestRankPercentiles)
+{
+	// Push 1..100 in reverse so the result does not depend on insertion order.
+	RollingSeries series(100);
+	for (int i = 100; i >= 1; --i)
+	{
+		series.Push(static_cast<float>(i));
+	}
+
+	TelemetryPercentiles percentiles = series.ComputePercentiles();
+	EXPECT_FLOAT_EQ(50.0f, percentiles.p50);
+	EXPECT_FLOAT_EQ(95.0f, percentiles.p95);
+	EXPECT_FLOAT_EQ(99.0f, percentiles.p99);
+	EXPECT_FLOAT_EQ(1.0f, series.GetLatest());
+}
+
+GTEST_TEST(Telemetry, SingleSpikeShowsOnlyInTail)
+{
+	RollingSeries series(100);
+	for (int i = 0; i < 99; ++i)
+	{
+		series.Push(16.0f);
+	}
+	series.Push(100.0f);
+
+	TelemetryPercentiles percentiles = series.ComputePercentiles();
+	EXPECT_FLOAT_EQ(16.0f, percentiles.p50);
+	EXPECT_FLOAT_EQ(16.0f, percentiles.p99);
+
+	series.Push(100.0f);
+	EXPECT_FLOAT_EQ(100.0f, series.ComputePercentiles().p99);
+}
+
+GTEST_TEST(Telemetry, RingBufferKeepsMostRecentSamples)
+{
+	RollingSeries series(4);
+	for (int i = 1; i <= 6; ++i)
+	{
+		series.Push(static_cast<float>(i));
+	}
+
+	// Samples 3..6 remain, and the oldest one sits at the reported offset.
+	EXPECT_EQ(4, series.GetCount());
+	EXPECT_FLOAT_EQ(3.0f, series.GetData()[series.GetOffset()]);
+	EXPECT_FLOAT_EQ(6.0f, series.GetLatest());
+	EXPECT_FLOAT_EQ(4.0f, series.ComputePercentiles().p50);
+}
+
+GTEST_TEST(Telemetry, FramesFeedTimingSeries)
+{
+	Telemetry telemetry(16);
+	TelemetryFrame frame;
+	frame.frameMs = 16.6f;
+	frame.updateMs = 4.0f;
+	frame.renderMs = 6.0f;
+	frame.physicsMs = 1.5f;
+	frame.drawCalls = 42;
+	telemetry.AddFrame(frame);
+	telemetry.AddFrame(frame);
+
+	EXPECT_EQ(2u, telemetry.GetFrameCount());
+	EXPECT_EQ(42, telemetry.GetLatest().drawCalls);
+	EXPECT_EQ(2, telemetry.GetSeries(TelemetrySeries::Frame).GetCount());
+	EXPECT_FLOAT_EQ(16.6f, telemetry.GetSeries(TelemetrySeries::Frame).GetLatest());
+	EXPECT_FLOAT_EQ(4.0f, telemetry.GetSeries(TelemetrySeries::Update).GetLatest());
+	EXPECT_FLOAT_EQ(6.0f, telemetry.GetSeries(TelemetrySeries::Render).GetLatest());
+	EXPECT_FLOAT_EQ(1.5f, telemetry.GetSeries(TelemetrySeries::Physics).GetLatest());
+}
+
+GTEST_TEST(Telemetry, CsvStreamsHeaderAndRows)
+{
+	const std::string path = "telemetry_test.csv";
+	{
+		Telemetry telemetry;
+		TelemetryFrame frame;
+		frame.frameMs = 10.0f;
+		frame.planets = 3;
+		frame.gpuBufferBytes = 5000000000ull;
+
+		telemetry.AddFrame(frame); // Not streamed, the file is not open yet.
+		ASSERT_TRUE(telemetry.StartCsv(path));
+		telemetry.AddFrame(frame);
+		telemetry.AddFrame(frame);
+		telemetry.StopCsv();
+		EXPECT_FALSE(telemetry.IsCsvOpen());
+	}
+
+	std::ifstream file(path);
+	std::string line;
+	ASSERT_TRUE(static_cast<bool>(std::getline(file, line)));
+	EXPECT_EQ(Telemetry::GetCsvHeader(), line);
+	ASSERT_TRUE(static_cast<bool>(std::getline(file, line)));
+	EXPECT_EQ("1,10.0000,0.0000,0.0000,0.0000,3,0,0,0,5000000000,0", line);
+	ASSERT_TRUE(static_cast<bool>(std::getline(file, line)));
+	EXPECT_EQ(0u, line.find("2,"));
+	EXPECT_FALSE(static_cast<bool>(std::getline(file, line)));
+
+	file.close();
+	std::remove(path.c_str());
+}
+
+int main(int argc, char** argv)
+{
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
@@ -0,0 +1,172 @@
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "WorldRebase.h"
+#include <BulletCollision/BroadphaseCollision/btDbvtBroadphase.h>
+#include <BulletDynamics/Dynamics/btWorldSnapshot.h>
+
+namespace
+{
+    /// A world of spheres packed closely enough to touch their neighbours, like a debris field.
+    struct SphereField
+    {
+        btDefaultCollisionConfiguration configuration;
+        btCollisionDispatcher dispatcher;
+        btDbvtBroadphase broadphase;
+        btSequentialImpulseConstraintSolver solver;
+        btDiscreteDynamicsWorld world;
+        btSphereShape shape;
+        std::vector<btDefaultMotionState*> motionStates;
+        std::vector<btRigidBody*> bodies;
+
+        explicit SphereField(int side)
+            : dispatcher(&configuration), world(&dispatcher, &broadphase, &solver, &configuration), shape(1.0f)
+        {
+            world.setGravity(btVector3(0, 0, 0));
+            btVector3 inertia;
+            shape.calculateLocalInertia(1.0f, inertia);
+            for (int z = 0; z < side; ++z)
+            {
+                for (int y = 0; y < side; ++y)
+                {
+                    for (int x = 0; x < side; ++x)
+                    {
+                        // Far from the origin, where a rebase would happen in the game.
+                        btTransform transform(btQuaternion::getIdentity(), btVector3(5000.0f + x * 1.9f, y * 1.9f, z * 1.9f));
+                        motionStates.push_back(new btDefaultMotionState(transform));
+                        bodies.push_back(new btRigidBody(1.0f, motionStates.back(), &shape, inertia));
+                        world.addRigidBody(bodies.back());
+                    }
+                }
+            }
+        }
+
+        ~SphereField()
+        {
+            for (int i = static_cast<int>(bodies.size()) - 1; i >= 0; --i)
+            {
+                world.removeRigidBody(bodies[i]);
+                delete bodies[i];
+                delete motionStates[i];
+            }
+        }
+    };
+
+    /// Checks that every internal node of a tree still contains both of its children.
+    int CheckTree(const btDbvtNode* node)
+    {
+        if (node->isleaf())
+        {
+            return 1;
+        }
+        EXPECT_TRUE(node->volume.Contain(node->childs[0]->volume));
+        EXPECT_TRUE(node->volume.Contain(node->childs[1]->volume));
+        return CheckTree(node->childs[0]) + CheckTree(node->childs[1]);
+    }
+}
+
+GTEST_TEST(WorldRebase, ShiftsTransformsProxiesAndContactsOf10kBodies)
+{
+    // 22^3 = 10648 bodies.
+    SphereField field(22);
+    field.world.stepSimulation(1.0f / 60.0f, 0);
+    const int numPairs = field.broadphase.getOverlappingPairCache()->getNumOverlappingPairs();
+    const int numManifolds = field.dispatcher.getNumManifolds();
+    ASSERT_GT(numManifolds, 10000);
+
+    const btVector3 shift(-5000.0f, 0.0f, 0.0f);
+    std::vector<btVector3> origins, aabbMins, aabbMaxs, leafMins, leafMaxs, graphics;
+    for (btRigidBody* body : field.bodies)
+    {
+        origins.push_back(body->getWorldTransform().getOrigin() + shift);
+        aabbMins.push_back(body->getBroadphaseHandle()->m_aabbMin + shift);
+        aabbMaxs.push_back(body->getBroadphaseHandle()->m_aabbMax + shift);
+        const btDbvtNode* leaf = static_cast<const btDbvtProxy*>(body->getBroadphaseHandle())->leaf;
+        leafMins.push_back(leaf->volume.Mins() + shift);
+        leafMaxs.push_back(leaf->volume.Maxs() + shift);
+        btTransform transform;
+        body->getMotionState()->getWorldTransform(transform);
+        graphics.push_back(transform.getOrigin() + shift);
+    }
+    std::vector<btVector3> pointsOnA, pointsOnB;
+    for (int i = 0; i < numManifolds; ++i)
+    {
+        const btPersistentManifold* manifold = field.dispatcher.getManifoldByIndexInternal(i);
+        for (int j = 0; j < manifold->getNumContacts(); ++j)
+        {
+            pointsOnA.push_back(manifold->getContactPoint(j).m_positionWorldOnA + shift);
+            pointsOnB.push_back(manifold->getContactPoint(j).m_positionWorldOnB + shift);
+        }
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+    RebaseBulletWorld(&field.world, shift);
+    auto end = std::chrono::high_resolution_clock::now();
+    printf("rebase of %d bodies, %d pairs, %d manifolds: %.3f ms\n", static_cast<int>(field.bodies.size()), numPairs, numManifolds,
+           std::chrono::duration<double, std::milli>(end - start).count());
+
+    for (size_t i = 0; i < field.bodies.size(); ++i)
+    {
+        const btRigidBody* body = field.bodies[i];
+        ASSERT_EQ(origins[i], body->getWorldTransform().getOrigin());
+        ASSERT_EQ(origins[i], body->getInterpolationWorldTransform().getOrigin());
+        ASSERT_EQ(aabbMins[i], body->getBroadphaseHandle()->m_aabbMin);
+        ASSERT_EQ(aabbMaxs[i], body->getBroadphaseHandle()->m_aabbMax);
+        btTransform transform;
+        body->getMotionState()->getWorldTransform(transform);
+        ASSERT_EQ(graphics[i], transform.getOrigin());
+
+        // The tree leaf, which is the proxy aabb plus the broadphase margin, moved with the proxy.
+        const btDbvtNode* leaf = static_cast<const btDbvtProxy*>(body->getBroadphaseHandle())->leaf;
+        ASSERT_EQ(leafMins[i], leaf->volume.Mins());
+        ASSERT_EQ(leafMaxs[i], leaf->volume.Maxs());
+    }
+    EXPECT_EQ(static_cast<int>(field.bodies.size()), CheckTree(field.broadphase.m_sets[btDbvtBroadphase::DYNAMIC_SET].m_root));
+
+    ASSERT_EQ(numManifolds, field.dispatcher.getNumManifolds());
+    size_t point = 0;
+    for (int i = 0; i < numManifolds; ++i)
+    {
+        const btPersistentManifold* manifold = field.dispatcher.getManifoldByIndexInternal(i);
+        for (int j = 0; j < manifold->getNumContacts(); ++j, ++point)
+        {
+            ASSERT_EQ(pointsOnA[point], manifold->getContactPoint(j).m_positionWorldOnA);
+            ASSERT_EQ(pointsOnB[point], manifold->getContactPoint(j).m_positionWorldOnB);
+        }
+    }
+
+    // The next step sees the same pairs and keeps the cached contacts, nothing was reinserted.
+    field.world.stepSimulation(1.0f / 60.0f, 0);
+    EXPECT_EQ(numPairs, field.broadphase.getOverlappingPairCache()->getNumOverlappingPairs());
+    EXPECT_EQ(numManifolds, field.dispatcher.getNumManifolds());
+}
+
+GTEST_TEST(WorldRebase, DeltaSnapshotHoldsShiftedSleepingAndStaticBodies)
+{
+    // One sphere without contacts, asleep, above static ground.
+    SphereField field(1);
+    btStaticPlaneShape groundShape(btVector3(0, 1, 0), -10.0f);
+    btRigidBody ground(0.0f, nullptr, &groundShape);
+    field.world.addRigidBody(&ground);
+    field.bodies[0]->setActivationState(ISLAND_SLEEPING);
+    field.world.stepSimulation(1.0f / 60.0f, 0);
+    ASSERT_EQ(ISLAND_SLEEPING, field.bodies[0]->getActivationState());
+
+    btWorldSnapshot keyFrame, delta;
+    field.world.captureSnapshot(keyFrame);
+    RebaseBulletWorld(&field.world, btVector3(-5000.0f, 0.0f, 0.0f));
+    field.world.captureSnapshot(delta, &keyFrame);
+    // Both moved, although neither was simulated.
+    EXPECT_EQ(field.world.getNumCollisionObjects(), delta.getNumObjectStates());
+
+    field.world.removeRigidBody(&ground);
+}
+
+int main(int argc, char** argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
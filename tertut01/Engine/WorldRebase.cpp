@@ -0,0 +1,104 @@
+// WorldRebase only depends on Bullet and is built without the precompiled header,
+// so the same file can be compiled into the unit tests.
+#include "WorldRebase.h"
+#include <BulletCollision/BroadphaseCollision/btDbvtBroadphase.h>
+
+/// Translates the whole physics world by the given offset.
+/// Collision objects and motion states are shifted directly, the btDbvtBroadphase trees are
+/// translated node by node (a uniform translation keeps every parent volume valid), and
+/// persistent manifolds have their cached world-space contact points moved as well.
+void RebaseBulletWorld(btDiscreteDynamicsWorld* world, const btVector3& shift)
+{
+    // Shift every collision object, its interpolation transform, motion state and broadphase proxy.
+    btCollisionObjectArray& objects = world->getCollisionObjectArray();
+    for (int i = 0; i < objects.size(); ++i)
+    {
+        btCollisionObject* object = objects[i];
+        // Through the setters, which bump the update revision, so a btWorldSnapshot delta sees the shift
+        // of sleeping and static objects too.
+        btTransform transform = object->getWorldTransform();
+        transform.getOrigin() += shift;
+        object->setWorldTransform(transform);
+        transform = object->getInterpolationWorldTransform();
+        transform.getOrigin() += shift;
+        object->setInterpolationWorldTransform(transform);
+
+        btRigidBody* body = btRigidBody::upcast(object);
+        if (body && body->getMotionState())
+        {
+            btTransform graphics;
+            body->getMotionState()->getWorldTransform(graphics);
+            graphics.getOrigin() += shift;
+            body->getMotionState()->setWorldTransform(graphics);
+        }
+
+        btBroadphaseProxy* proxy = object->getBroadphaseHandle();
+        if (proxy)
+        {
+            proxy->m_aabbMin += shift;
+            proxy->m_aabbMax += shift;
+        }
+    }
+
+    // Translate the broadphase trees in place so no proxy has to be removed and reinserted.
+    btDbvtBroadphase* dbvt = dynamic_cast<btDbvtBroadphase*>(world->getBroadphase());
+    if (dbvt)
+    {
+        TranslateDbvt(dbvt->m_sets[btDbvtBroadphase::DYNAMIC_SET], shift);
+        TranslateDbvt(dbvt->m_sets[btDbvtBroadphase::FIXED_SET], shift);
+    }
+    else
+    {
+        // Other broadphases only see the new bounds through setAabb, which keeps the proxies alive.
+        for (int i = 0; i < objects.size(); ++i)
+        {
+            btBroadphaseProxy* proxy = objects[i]->getBroadphaseHandle();
+            if (proxy)
+            {
+                world->getBroadphase()->setAabb(proxy, proxy->m_aabbMin, proxy->m_aabbMax, world->getDispatcher());
+            }
+        }
+    }
+
+    // Move cached contact points so warm starting stays valid across the rebase.
+    btDispatcher* dispatcher = world->getDispatcher();
+    for (int i = 0; i < dispatcher->getNumManifolds(); ++i)
+    {
+        btPersistentManifold* manifold = dispatcher->getManifoldByIndexInternal(i);
+        for (int j = 0; j < manifold->getNumContacts(); ++j)
+        {
+            btManifoldPoint& point = manifold->getContactPoint(j);
+            point.m_positionWorldOnA += shift;
+            point.m_positionWorldOnB += shift;
+        }
+    }
+}
+
+/// Translates every node volume of a dynamic AABB tree without changing its topology.
+/// Uses an explicit stack so very deep trees do not overflow the call stack.
+void TranslateDbvt(btDbvt& tree, const btVector3& shift)
+{
+    if (!tree.m_root)
+    {
+        return;
+    }
+
+    btAlignedObjectArray<btDbvtNode*> stack;
+    stack.reserve(btDbvt::DOUBLE_STACKSIZE);
+    stack.push_back(tree.m_root);
+
+    while (stack.size() > 0)
+    {
+        btDbvtNode* node = stack[stack.size() - 1];
+        stack.pop_back();
+
+        node->volume.tMins() += shift;
+        node->volume.tMaxs() += shift;
+
+        if (node->isinternal())
+        {
+            stack.push_back(node->childs[0]);
+            stack.push_back(node->childs[1]);
+        }
+    }
+}
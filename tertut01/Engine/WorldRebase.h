@@ -0,0 +1,15 @@
+#pragma once
+#include <btBulletDynamicsCommon.h>
+
+/// Translates every collision object, motion state, broadphase volume and cached contact point of a world.
+/// The btDbvtBroadphase trees are translated node by node, so no proxy or pair is reallocated;
+/// other broadphases are updated through setAabb.
+/// Only depends on Bullet, so it is built without the precompiled header and tested on its own.
+/// @param world The Bullet dynamics world to translate.
+/// @param shift The translation to apply to all world-space positions.
+void RebaseBulletWorld(btDiscreteDynamicsWorld* world, const btVector3& shift);
+
+/// Translates every node volume of a dynamic AABB tree without changing its topology.
+/// @param tree The tree to translate.
+/// @param shift The translation to apply.
+void TranslateDbvt(btDbvt& tree, const btVector3& shift);
@@ -718,6 +718,11 @@ char *bFile::readStruct(char *head, bChunkInd &dataChunk)
 		oldType = mFileDNA->getType(oldStruct[0]);
 		printf("%s equal structure, just memcpy\n", oldType);
 #endif  //
+		if ((mFlags & FD_ZERO_COPY) && !structHasPointers(dataChunk.dna_nr))
+		{
+			// nothing is written to the data of such structs, so it can stay in the file buffer
+			return head;
+		}
 	}
 
 	char *dataAlloc = new char[(dataChunk.len) + sizeof(void*)];
@@ -730,6 +735,38 @@ char *bFile::readStruct(char *head, bChunkInd &dataChunk)
 	return dataAlloc;
 }
 
+bool bFile::structHasPointers(int dna_nr)
+{
+	if (mStructPointerFlags.size() != mFileDNA->getNumStructs())
+	{
+		mStructPointerFlags.resize(mFileDNA->getNumStructs(), 0);
+	}
+	if (!mStructPointerFlags[dna_nr])
+	{
+		bool hasPointers = false;
+		const short firstStructType = mFileDNA->getStruct(0)[0];
+		const short *strc = mFileDNA->getStruct(dna_nr);
+		const int numElements = strc[1];
+		strc += 2;
+		for (int ele = 0; ele < numElements && !hasPointers; ele++, strc += 2)
+		{
+			const char *name = mFileDNA->getName(strc[1]);
+			if (name[0] == '*' || name[1] == '*')
+			{
+				hasPointers = true;
+			}
+			else if (strc[0] >= firstStructType)
+			{
+				// a struct cannot contain itself other than by pointer, so this recursion ends
+				const int nested = mFileDNA->getReverseType(strc[0]);
+				hasPointers = (nested < 0) || structHasPointers(nested);
+			}
+		}
+		mStructPointerFlags[dna_nr] = hasPointers ? 2 : 1;
+	}
+	return mStructPointerFlags[dna_nr] == 2;
+}
+
 // ----------------------------------------------------- //
 void bFile::parseStruct(char *strcPtr, char *dtPtr, int old_dna, int new_dna, bool fixupPointers)
 {
@@ -1410,6 +1447,10 @@ void bFile::resolvePointers(int verboseMode)
 		{
 			const bChunkInd &dataChunk = m_chunks.at(i);
 
+			// large arrays like vertices have nothing to resolve, and walking them element by element is slow
+			if (mFileDNA && !(verboseMode & FD_VERBOSE_EXPORT_XML) && !structHasPointers(dataChunk.dna_nr))
+				continue;
+
 			if (!mFileDNA || fileDna->flagEqual(dataChunk.dna_nr))
 			{
 				//dataChunk.len
@@ -34,7 +34,8 @@ enum bFileFlags
 	FD_VERSION_VARIES = 32,
 	FD_DOUBLE_PRECISION = 64,
 	FD_BROKEN_DNA = 128,
-	FD_FILEDNA_IS_MEMDNA = 256
+	FD_FILEDNA_IS_MEMDNA = 256,
+	FD_ZERO_COPY = 512
 };
 
 enum bFileVerboseMode
@@ -73,6 +74,9 @@ protected:
 
 	int mFlags;
 
+	// per file struct: 0 not checked yet, 1 without pointers, 2 with pointers
+	btAlignedObjectArray<char> mStructPointerFlags;
+
 	// ////////////////////////////////////////////////////////////////////////////
 
 	// buffer offset util
@@ -100,6 +104,7 @@ protected:
 	void swapDNA(char* ptr);
 
 	char* readStruct(char* head, class bChunkInd& chunk);
+	bool structHasPointers(int dna_nr);
 	char* getAsString(int code);
 
 	virtual void parseInternal(int verboseMode, char* memDna, int memDnaLength);
@@ -129,6 +134,14 @@ public:
 		mFlags |= FD_FILEDNA_IS_MEMDNA;
 	}
 
+	///chunks of structs without pointers whose layout matches the memory DNA are used in place in the file buffer instead
+	///of copied, so large arrays like vertices and BVH nodes are not duplicated. The buffer has to stay writable and has to
+	///outlive the parsed data, a copy-on-write btMappedFile works
+	void setZeroCopy()
+	{
+		mFlags |= FD_ZERO_COPY;
+	}
+
 	bPtrMap& getLibPointers()
 	{
 		return mLibPointers;
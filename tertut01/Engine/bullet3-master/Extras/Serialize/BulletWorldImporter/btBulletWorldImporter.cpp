@@ -15,6 +15,7 @@ subject to the following restrictions:
 
 #include "btBulletWorldImporter.h"
 #include "../BulletFileLoader/btBulletFile.h"
+#include "LinearMath/btMappedFile.h"
 
 #include "btBulletDynamicsCommon.h"
 #ifndef USE_GIMPACT
@@ -35,6 +36,20 @@ btBulletWorldImporter::~btBulletWorldImporter()
 {
 }
 
+void btBulletWorldImporter::deleteAllData()
+{
+	btWorldImporter::deleteAllData();
+
+	//the shapes are gone, so the files they referenced can be released
+	for (int i = 0; i < m_mappedBulletFiles.size(); i++)
+	{
+		delete m_mappedBulletFiles[i];
+		delete m_mappedFiles[i];
+	}
+	m_mappedBulletFiles.clear();
+	m_mappedFiles.clear();
+}
+
 bool btBulletWorldImporter::loadFile(const char* fileName, const char* preSwapFilenameOut)
 {
 	bParse::btBulletFile* bulletFile2 = new bParse::btBulletFile(fileName);
@@ -55,6 +70,28 @@ bool btBulletWorldImporter::loadFile(const char* fileName, const char* preSwapFi
 	return result;
 }
 
+bool btBulletWorldImporter::loadFileMapped(const char* fileName)
+{
+	btMappedFile* mappedFile = new btMappedFile();
+	//copy-on-write, because endian swapping and pointer fixups write to the file buffer
+	if (!mappedFile->open(fileName, true))
+	{
+		delete mappedFile;
+		return false;
+	}
+	bParse::btBulletFile* bulletFile2 = new bParse::btBulletFile((char*)mappedFile->getWritableData(), int(mappedFile->getSize()));
+	bulletFile2->setZeroCopy();
+
+	m_referenceFileData = true;
+	bool result = loadFileFromMemory(bulletFile2);
+	m_referenceFileData = false;
+
+	//the converted objects point into the file, so it stays loaded until deleteAllData
+	m_mappedBulletFiles.push_back(bulletFile2);
+	m_mappedFiles.push_back(mappedFile);
+	return result;
+}
+
 bool btBulletWorldImporter::loadFileFromMemory(char* memoryBuffer, int len)
 {
 	bParse::btBulletFile* bulletFile2 = new bParse::btBulletFile(memoryBuffer, len);
@@ -97,12 +134,18 @@ bool btBulletWorldImporter::convertAllObjects(bParse::btBulletFile* bulletFile2)
 		if (bulletFile2->getFlags() & bParse::FD_DOUBLE_PRECISION)
 		{
 			btQuantizedBvhDoubleData* bvhData = (btQuantizedBvhDoubleData*)bulletFile2->m_bvhs[i];
-			bvh->deSerializeDouble(*bvhData);
+			if (!m_referenceFileData || !bvh->initializeFromMappedData(*bvhData))
+			{
+				bvh->deSerializeDouble(*bvhData);
+			}
 		}
 		else
 		{
 			btQuantizedBvhFloatData* bvhData = (btQuantizedBvhFloatData*)bulletFile2->m_bvhs[i];
-			bvh->deSerializeFloat(*bvhData);
+			if (!m_referenceFileData || !bvh->initializeFromMappedData(*bvhData))
+			{
+				bvh->deSerializeFloat(*bvhData);
+			}
 		}
 		m_bvhMap.insert(bulletFile2->m_bvhs[i], bvh);
 	}
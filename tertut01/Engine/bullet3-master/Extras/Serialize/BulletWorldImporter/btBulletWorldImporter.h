@@ -19,6 +19,7 @@ subject to the following restrictions:
 #include "btWorldImporter.h"
 
 class btBulletFile;
+class btMappedFile;
 
 namespace bParse
 {
@@ -31,15 +32,27 @@ class btBulletFile;
 ///See Bullet/Demos/SerializeDemo for a derived class that extract btSoftBody objects too.
 class btBulletWorldImporter : public btWorldImporter
 {
+protected:
+	btAlignedObjectArray<btMappedFile*> m_mappedFiles;
+	btAlignedObjectArray<bParse::btBulletFile*> m_mappedBulletFiles;
+
 public:
 	btBulletWorldImporter(btDynamicsWorld* world = 0);
 
 	virtual ~btBulletWorldImporter();
 
+	///also releases the files loaded with loadFileMapped
+	virtual void deleteAllData();
+
 	///if you pass a valid preSwapFilenameOut, it will save a new file with a different endianness
 	///this pre-swapped file can be loaded without swapping on a target platform of different endianness
 	bool loadFile(const char* fileName, const char* preSwapFilenameOut = 0);
 
+	///loadFileMapped maps the file copy-on-write instead of reading it, and the loaded triangle meshes and quantized BVHs use
+	///their vertex, index and node arrays in place where the layout matches, rather than copying them. Such shapes must not
+	///outlive the mapping, which is released by deleteAllData
+	bool loadFileMapped(const char* fileName);
+
 	///the memoryBuffer might be modified (for example if endian swaps are necessary)
 	bool loadFileFromMemory(char* memoryBuffer, int len);
 
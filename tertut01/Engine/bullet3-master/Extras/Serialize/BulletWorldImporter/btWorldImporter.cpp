@@ -22,7 +22,8 @@ subject to the following restrictions:
 btWorldImporter::btWorldImporter(btDynamicsWorld* world)
 	: m_dynamicsWorld(world),
 	  m_verboseMode(0),
-	  m_importerFlags(0)
+	  m_importerFlags(0),
+	  m_referenceFileData(false)
 {
 }
 
@@ -410,7 +411,10 @@ btCollisionShape* btWorldImporter::convertCollisionShape(btCollisionShapeData* s
 				else
 				{
 					bvh = createOptimizedBvh();
-					bvh->deSerializeFloat(*trimesh->m_quantizedFloatBvh);
+					if (!m_referenceFileData || !bvh->initializeFromMappedData(*trimesh->m_quantizedFloatBvh))
+					{
+						bvh->deSerializeFloat(*trimesh->m_quantizedFloatBvh);
+					}
 				}
 			}
 			if (trimesh->m_quantizedDoubleBvh)
@@ -423,7 +427,10 @@ btCollisionShape* btWorldImporter::convertCollisionShape(btCollisionShapeData* s
 				else
 				{
 					bvh = createOptimizedBvh();
-					bvh->deSerializeDouble(*trimesh->m_quantizedDoubleBvh);
+					if (!m_referenceFileData || !bvh->initializeFromMappedData(*trimesh->m_quantizedDoubleBvh))
+					{
+						bvh->deSerializeDouble(*trimesh->m_quantizedDoubleBvh);
+					}
 				}
 			}
 #endif
@@ -1394,32 +1401,48 @@ btTriangleIndexVertexArray* btWorldImporter::createMeshInterface(btStridingMeshI
 		{
 			meshPart.m_indexType = PHY_INTEGER;
 			meshPart.m_triangleIndexStride = 3 * sizeof(int);
-			int* indexArray = (int*)btAlignedAlloc(sizeof(int) * 3 * meshPart.m_numTriangles, 16);
-			m_indexArrays.push_back(indexArray);
-			for (int j = 0; j < 3 * meshPart.m_numTriangles; j++)
+			if (m_referenceFileData)
+			{
+				meshPart.m_triangleIndexBase = (const unsigned char*)meshData.m_meshPartsPtr[i].m_indices32;
+			}
+			else
 			{
-				indexArray[j] = meshData.m_meshPartsPtr[i].m_indices32[j].m_value;
+				int* indexArray = (int*)btAlignedAlloc(sizeof(int) * 3 * meshPart.m_numTriangles, 16);
+				m_indexArrays.push_back(indexArray);
+				for (int j = 0; j < 3 * meshPart.m_numTriangles; j++)
+				{
+					indexArray[j] = meshData.m_meshPartsPtr[i].m_indices32[j].m_value;
+				}
+				meshPart.m_triangleIndexBase = (const unsigned char*)indexArray;
 			}
-			meshPart.m_triangleIndexBase = (const unsigned char*)indexArray;
 		}
 		else
 		{
 			if (meshData.m_meshPartsPtr[i].m_3indices16)
 			{
 				meshPart.m_indexType = PHY_SHORT;
-				meshPart.m_triangleIndexStride = sizeof(short int) * 3;  //sizeof(btShortIntIndexTripletData);
-
-				short int* indexArray = (short int*)btAlignedAlloc(sizeof(short int) * 3 * meshPart.m_numTriangles, 16);
-				m_shortIndexArrays.push_back(indexArray);
-
-				for (int j = 0; j < meshPart.m_numTriangles; j++)
+				if (m_referenceFileData)
 				{
-					indexArray[3 * j] = meshData.m_meshPartsPtr[i].m_3indices16[j].m_values[0];
-					indexArray[3 * j + 1] = meshData.m_meshPartsPtr[i].m_3indices16[j].m_values[1];
-					indexArray[3 * j + 2] = meshData.m_meshPartsPtr[i].m_3indices16[j].m_values[2];
+					//the triplets are padded to 8 bytes
+					meshPart.m_triangleIndexStride = sizeof(btShortIntIndexTripletData);
+					meshPart.m_triangleIndexBase = (const unsigned char*)meshData.m_meshPartsPtr[i].m_3indices16;
 				}
+				else
+				{
+					meshPart.m_triangleIndexStride = sizeof(short int) * 3;  //sizeof(btShortIntIndexTripletData);
 
-				meshPart.m_triangleIndexBase = (const unsigned char*)indexArray;
+					short int* indexArray = (short int*)btAlignedAlloc(sizeof(short int) * 3 * meshPart.m_numTriangles, 16);
+					m_shortIndexArrays.push_back(indexArray);
+
+					for (int j = 0; j < meshPart.m_numTriangles; j++)
+					{
+						indexArray[3 * j] = meshData.m_meshPartsPtr[i].m_3indices16[j].m_values[0];
+						indexArray[3 * j + 1] = meshData.m_meshPartsPtr[i].m_3indices16[j].m_values[1];
+						indexArray[3 * j + 2] = meshData.m_meshPartsPtr[i].m_3indices16[j].m_values[2];
+					}
+
+					meshPart.m_triangleIndexBase = (const unsigned char*)indexArray;
+				}
 			}
 			if (meshData.m_meshPartsPtr[i].m_indices16)
 			{
@@ -1438,19 +1461,27 @@ btTriangleIndexVertexArray* btWorldImporter::createMeshInterface(btStridingMeshI
 			if (meshData.m_meshPartsPtr[i].m_3indices8)
 			{
 				meshPart.m_indexType = PHY_UCHAR;
-				meshPart.m_triangleIndexStride = sizeof(unsigned char) * 3;
-
-				unsigned char* indexArray = (unsigned char*)btAlignedAlloc(sizeof(unsigned char) * 3 * meshPart.m_numTriangles, 16);
-				m_charIndexArrays.push_back(indexArray);
-
-				for (int j = 0; j < meshPart.m_numTriangles; j++)
+				if (m_referenceFileData)
 				{
-					indexArray[3 * j] = meshData.m_meshPartsPtr[i].m_3indices8[j].m_values[0];
-					indexArray[3 * j + 1] = meshData.m_meshPartsPtr[i].m_3indices8[j].m_values[1];
-					indexArray[3 * j + 2] = meshData.m_meshPartsPtr[i].m_3indices8[j].m_values[2];
+					meshPart.m_triangleIndexStride = sizeof(btCharIndexTripletData);
+					meshPart.m_triangleIndexBase = (const unsigned char*)meshData.m_meshPartsPtr[i].m_3indices8;
 				}
+				else
+				{
+					meshPart.m_triangleIndexStride = sizeof(unsigned char) * 3;
 
-				meshPart.m_triangleIndexBase = (const unsigned char*)indexArray;
+					unsigned char* indexArray = (unsigned char*)btAlignedAlloc(sizeof(unsigned char) * 3 * meshPart.m_numTriangles, 16);
+					m_charIndexArrays.push_back(indexArray);
+
+					for (int j = 0; j < meshPart.m_numTriangles; j++)
+					{
+						indexArray[3 * j] = meshData.m_meshPartsPtr[i].m_3indices8[j].m_values[0];
+						indexArray[3 * j + 1] = meshData.m_meshPartsPtr[i].m_3indices8[j].m_values[1];
+						indexArray[3 * j + 2] = meshData.m_meshPartsPtr[i].m_3indices8[j].m_values[2];
+					}
+
+					meshPart.m_triangleIndexBase = (const unsigned char*)indexArray;
+				}
 			}
 		}
 
@@ -1458,6 +1489,19 @@ btTriangleIndexVertexArray* btWorldImporter::createMeshInterface(btStridingMeshI
 		{
 			meshPart.m_vertexType = PHY_FLOAT;
 			meshPart.m_vertexStride = sizeof(btVector3FloatData);
+		}
+		else
+		{
+			meshPart.m_vertexType = PHY_DOUBLE;
+			meshPart.m_vertexStride = sizeof(btVector3DoubleData);
+		}
+
+		if (m_referenceFileData)
+		{
+			meshPart.m_vertexBase = meshData.m_meshPartsPtr[i].m_vertices3f ? (const unsigned char*)meshData.m_meshPartsPtr[i].m_vertices3f : (const unsigned char*)meshData.m_meshPartsPtr[i].m_vertices3d;
+		}
+		else if (meshData.m_meshPartsPtr[i].m_vertices3f)
+		{
 			btVector3FloatData* vertices = (btVector3FloatData*)btAlignedAlloc(sizeof(btVector3FloatData) * meshPart.m_numVertices, 16);
 			m_floatVertexArrays.push_back(vertices);
 
@@ -1472,9 +1516,6 @@ btTriangleIndexVertexArray* btWorldImporter::createMeshInterface(btStridingMeshI
 		}
 		else
 		{
-			meshPart.m_vertexType = PHY_DOUBLE;
-			meshPart.m_vertexStride = sizeof(btVector3DoubleData);
-
 			btVector3DoubleData* vertices = (btVector3DoubleData*)btAlignedAlloc(sizeof(btVector3DoubleData) * meshPart.m_numVertices, 16);
 			m_doubleVertexArrays.push_back(vertices);
 
@@ -1499,6 +1540,20 @@ btTriangleIndexVertexArray* btWorldImporter::createMeshInterface(btStridingMeshI
 
 btStridingMeshInterfaceData* btWorldImporter::createStridingMeshInterfaceData(btStridingMeshInterfaceData* interfaceData)
 {
+	if (m_referenceFileData)
+	{
+		//the file stays loaded, so its data is used as is, apart from the m_3indices8 workaround below
+		for (int i = 0; i < interfaceData->m_numMeshParts; i++)
+		{
+			btMeshPartData* curPart = &interfaceData->m_meshPartsPtr[i];
+			if (curPart->m_indices32 || curPart->m_3indices16 || curPart->m_indices16)
+			{
+				curPart->m_3indices8 = NULL;
+			}
+		}
+		return interfaceData;
+	}
+
 	//create a new btStridingMeshInterfaceData that is an exact copy of shapedata and store it in the WorldImporter
 	btStridingMeshInterfaceData* newData = new btStridingMeshInterfaceData;
 
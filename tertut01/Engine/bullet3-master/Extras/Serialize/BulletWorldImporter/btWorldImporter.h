@@ -71,6 +71,9 @@ protected:
 	int m_verboseMode;
 	int m_importerFlags;
 
+	//set while converting a file that stays loaded, then mesh and BVH arrays are used in place instead of copied
+	bool m_referenceFileData;
+
 	btAlignedObjectArray<btCollisionShape*> m_allocatedCollisionShapes;
 	btAlignedObjectArray<btCollisionObject*> m_allocatedRigidBodies;
 	btAlignedObjectArray<btTypedConstraint*> m_allocatedConstraints;
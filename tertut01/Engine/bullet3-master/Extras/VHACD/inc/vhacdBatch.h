@@ -0,0 +1,155 @@
+/* Copyright (c) 2011 Khaled Mamou (kmamou at gmail dot com)
+ All rights reserved.
+ 
+ 
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ 
+ 3. The names of the contributors may not be used to endorse or promote products derived from this software without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+#ifndef VHACD_BATCH_H
+#define VHACD_BATCH_H
+
+#include "LinearMath/btAlignedObjectArray.h"
+#include "LinearMath/btHashMap.h"
+#include "vhacdMesh.h"
+#include "vhacdSArray.h"
+
+namespace VHACD
+{
+//! Key of the result cache, a 64 bit hash of the mesh and of the parameters that change the decomposition.
+struct BatchKey
+{
+	unsigned long long m_hash;
+
+	BatchKey(unsigned long long hash) : m_hash(hash) {}
+	unsigned int getHash() const
+	{
+		return (unsigned int)(m_hash ^ (m_hash >> 32));
+	}
+	bool equals(const BatchKey& other) const
+	{
+		return m_hash == other.m_hash;
+	}
+};
+
+class Batch : public IVHACDBatch
+{
+	friend class BatchLoop;
+
+public:
+	//! Constructor.
+	Batch();
+	//! Destructor.
+	~Batch(void);
+	unsigned int AddMesh(const float* const points,
+						 const unsigned int stridePoints,
+						 const unsigned int countPoints,
+						 const int* const triangles,
+						 const unsigned int strideTriangles,
+						 const unsigned int countTriangles,
+						 const IVHACD::Parameters& params);
+	unsigned int AddMesh(const double* const points,
+						 const unsigned int stridePoints,
+						 const unsigned int countPoints,
+						 const int* const triangles,
+						 const unsigned int strideTriangles,
+						 const unsigned int countTriangles,
+						 const IVHACD::Parameters& params);
+	void Compute();
+	unsigned int GetNMeshes() const
+	{
+		return (unsigned int)m_inputs.size();
+	}
+	unsigned int GetNConvexHulls(const unsigned int mesh) const;
+	void GetConvexHull(const unsigned int mesh, const unsigned int index, IVHACD::ConvexHull& ch) const;
+	bool IsCached(const unsigned int mesh) const
+	{
+		return m_inputs[mesh].m_cached;
+	}
+	double GetComputeTime(const unsigned int mesh) const
+	{
+		return m_inputs[mesh].m_time;
+	}
+	double GetTotalTime() const
+	{
+		return m_totalTime;
+	}
+	unsigned int GetNWaves() const
+	{
+		return m_nWaves;
+	}
+	size_t GetMaxWaveMemory() const
+	{
+		return m_maxWaveMemory;
+	}
+	void SetMemoryBudget(const size_t bytes)
+	{
+		m_memoryBudget = bytes;
+	}
+	size_t GetMemoryBudget() const
+	{
+		return m_memoryBudget;
+	}
+	size_t EstimateMemory(const unsigned int countPoints,
+						  const unsigned int countTriangles,
+						  const IVHACD::Parameters& params) const;
+	void Clear(void);
+	void ClearCache(void);
+	unsigned int GetNCachedResults() const
+	{
+		return (unsigned int)m_results.size();
+	}
+	void Release(void)
+	{
+		delete this;
+	}
+
+private:
+	struct Input
+	{
+		const float* m_pointsFloat;
+		const double* m_pointsDouble;
+		unsigned int m_stridePoints;
+		unsigned int m_nPoints;
+		const int* m_triangles;
+		unsigned int m_strideTriangles;
+		unsigned int m_nTriangles;
+		IVHACD::Parameters m_params;
+		unsigned long long m_hash;
+		int m_result;  // index in m_results, -1 until computed
+		bool m_cached;
+		double m_time;
+	};
+	struct Result
+	{
+		SArray<Mesh*> m_convexHulls;
+	};
+
+	template <class T>
+	unsigned int AddInput(const T* const points,
+						  const unsigned int stridePoints,
+						  const unsigned int nPoints,
+						  const int* const triangles,
+						  const unsigned int strideTriangles,
+						  const unsigned int nTriangles,
+						  const IVHACD::Parameters& params);
+	void Decompose(const int job);
+
+	btAlignedObjectArray<Input> m_inputs;
+	btAlignedObjectArray<Result*> m_results;
+	btHashMap<BatchKey, int> m_cache;  // hash of a mesh -> index in m_results
+	btAlignedObjectArray<int> m_jobs;  // meshes to decompose in this Compute, one per hash
+	size_t m_memoryBudget;
+	double m_totalTime;
+	unsigned int m_nWaves;
+	size_t m_maxWaveMemory;
+};
+}  // namespace VHACD
+#endif  // VHACD_BATCH_H
@@ -32,8 +32,12 @@ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
 #define CH_APP_MIN_NUM_PRIMITIVES 64000
 namespace VHACD
 {
+struct ClippingPlaneSearch;
+
 class VHACD : public IVHACD
 {
+	friend class ClippingPlaneCostLoop;
+
 public:
 	//! Constructor.
 	VHACD()
@@ -167,6 +171,9 @@ private:
 								  Plane& bestPlane,
 								  double& minConcavity,
 								  const Parameters& params);
+	void ComputeClippingPlaneCosts(ClippingPlaneSearch& search,
+								   const int planeBegin,
+								   const int planeEnd);
 	template <class T>
 	void AlignMesh(const T* const points,
 				   const unsigned int stridePoints,
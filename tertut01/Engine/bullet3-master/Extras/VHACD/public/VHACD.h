@@ -19,6 +19,8 @@
 #define VHACD_VERSION_MAJOR 2
 #define VHACD_VERSION_MINOR 2
 
+#include <stddef.h>
+
 namespace VHACD
 {
 class IVHACD
@@ -119,5 +121,58 @@ protected:
 	virtual ~IVHACD(void) {}
 };
 IVHACD* CreateVHACD(void);
+
+//! Decomposes many meshes at once, one mesh per task of the Bullet task scheduler, with the meshes that run at the same
+//! time sharing a memory budget. The results are cached by a hash of the mesh and of its parameters, so that a mesh that
+//! was already decomposed by this batch, or that is queued twice, is decomposed only once.
+//! A mesh decomposed on its own, or without a task scheduler, runs its clipping plane search on the task scheduler instead.
+//! The callback and logger of the parameters are called from the worker threads.
+class IVHACDBatch
+{
+public:
+	//! Queues a mesh and returns its index. The arrays must stay valid until Compute returns.
+	virtual unsigned int AddMesh(const float* const points,
+								 const unsigned int stridePoints,
+								 const unsigned int countPoints,
+								 const int* const triangles,
+								 const unsigned int strideTriangles,
+								 const unsigned int countTriangles,
+								 const IVHACD::Parameters& params) = 0;
+	virtual unsigned int AddMesh(const double* const points,
+								 const unsigned int stridePoints,
+								 const unsigned int countPoints,
+								 const int* const triangles,
+								 const unsigned int strideTriangles,
+								 const unsigned int countTriangles,
+								 const IVHACD::Parameters& params) = 0;
+	//! Decomposes the queued meshes that are not in the cache.
+	virtual void Compute() = 0;
+	virtual unsigned int GetNMeshes() const = 0;
+	virtual unsigned int GetNConvexHulls(const unsigned int mesh) const = 0;
+	virtual void GetConvexHull(const unsigned int mesh, const unsigned int index, IVHACD::ConvexHull& ch) const = 0;
+	//! true if the last Compute took the mesh from the cache
+	virtual bool IsCached(const unsigned int mesh) const = 0;
+	//! time in ms the last Compute spent decomposing the mesh, 0 if it was cached
+	virtual double GetComputeTime(const unsigned int mesh) const = 0;
+	//! time in ms of the last Compute
+	virtual double GetTotalTime() const = 0;
+	//! number of waves of the last Compute and the largest memory estimate of the meshes of one wave
+	virtual unsigned int GetNWaves() const = 0;
+	virtual size_t GetMaxWaveMemory() const = 0;
+	//! bytes the decompositions running at the same time may use together, as estimated by EstimateMemory, 0 for no limit
+	virtual void SetMemoryBudget(const size_t bytes) = 0;
+	virtual size_t GetMemoryBudget() const = 0;
+	virtual size_t EstimateMemory(const unsigned int countPoints,
+								  const unsigned int countTriangles,
+								  const IVHACD::Parameters& params) const = 0;
+	virtual void Clear(void) = 0;       // forget the queued meshes, keep the cache
+	virtual void ClearCache(void) = 0;  // forget the queued meshes and the cache
+	virtual unsigned int GetNCachedResults() const = 0;
+	virtual void Release(void) = 0;  // release IVHACDBatch
+
+protected:
+	virtual ~IVHACDBatch(void) {}
+};
+IVHACDBatch* CreateVHACDBatch(void);
 }  // namespace VHACD
 #endif  // VHACD_H
\ No newline at end of file
@@ -26,6 +26,7 @@
 
 #include "../public/VHACD.h"
 #include "LinearMath/btConvexHullComputer.h"
+#include "LinearMath/btThreads.h"
 #include "vhacdICHull.h"
 #include "vhacdMesh.h"
 #include "vhacdSArray.h"
@@ -208,6 +209,19 @@ __kernel void ComputePartialSums(__global uint4 * data,
 
 namespace VHACD
 {
+// runs body on the threads of the Bullet task scheduler, or serially when there is none or when called from a task
+static void ParallelFor(const int iBegin, const int iEnd, const int grainSize, const btIParallelForBody& body)
+{
+#if BT_THREADSAFE
+	btITaskScheduler* scheduler = btGetTaskScheduler();
+	if (scheduler && scheduler->getNumThreads() > 1 && !btThreadsAreRunning())
+	{
+		btParallelFor(iBegin, iEnd, grainSize, body);
+		return;
+	}
+#endif  // BT_THREADSAFE
+	body.forLoop(iBegin, iEnd);
+}
 IVHACD* CreateVHACD(void)
 {
 	return new VHACD();
@@ -742,6 +756,228 @@ inline double ComputeConcavity(const double volume, const double volumeCH, const
 	return fabs(volumeCH - volume) / volume0;
 }
 
+struct ClippingPlaneSearch
+{
+	const PrimitiveSet* m_inputPSet;
+	const PrimitiveSet* m_onSurfacePSet;
+	const SArray<Plane>* m_planes;
+	Vec3<double> m_preferredCuttingDirection;
+	double m_w;
+	double m_alpha;
+	double m_beta;
+	int m_convexhullDownsampling;
+	double m_progress0;
+	double m_progress1;
+	const IVHACD::Parameters* m_params;
+	bool m_oclAcceleration;
+	double* m_costs;  // total, concavity, balance and symmetry of each plane
+	Mutex m_progressMutex;
+	int m_done;
+#ifdef CL_VERSION_1_1
+	cl_mem* m_partialVolumes;
+	size_t m_globalSize;
+	size_t m_nWorkGroups;
+	double m_unitVolume;
+#endif  // CL_VERSION_1_1
+};
+
+class ClippingPlaneCostLoop : public btIParallelForBody
+{
+public:
+	ClippingPlaneCostLoop(VHACD* vhacd, ClippingPlaneSearch* search)
+		: m_vhacd(vhacd), m_search(search)
+	{
+	}
+	void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
+	{
+		m_vhacd->ComputeClippingPlaneCosts(*m_search, iBegin, iEnd);
+	}
+
+private:
+	VHACD* m_vhacd;
+	ClippingPlaneSearch* m_search;
+};
+
+void VHACD::ComputeClippingPlaneCosts(ClippingPlaneSearch& search, const int planeBegin, const int planeEnd)
+{
+	const PrimitiveSet* const inputPSet = search.m_inputPSet;
+	const Parameters& params = *search.m_params;
+
+	// scratch buffers shared by the planes of this range
+	Mesh leftCH;
+	Mesh rightCH;
+	SArray<Vec3<double> > leftCHPts;
+	SArray<Vec3<double> > rightCHPts;
+	PrimitiveSet* right = 0;
+	PrimitiveSet* left = 0;
+	if (!params.m_convexhullApproximation)
+	{
+		right = inputPSet->Create();
+		left = inputPSet->Create();
+	}
+
+	for (int x = planeBegin; x < planeEnd; ++x)
+	{
+		double* const cost = search.m_costs + 4 * x;
+		if (GetCancel())
+		{
+			cost[0] = MAX_DOUBLE;
+			continue;
+		}
+		const Plane& plane = (*search.m_planes)[x];
+
+		if (search.m_oclAcceleration)
+		{
+#ifdef CL_VERSION_1_1
+			// the OpenCL path runs on the calling thread only, see ComputeBestClippingPlane
+			const int threadID = 0;
+			const float fPlane[4] = {(float)plane.m_a, (float)plane.m_b, (float)plane.m_c, (float)plane.m_d};
+			cl_int error = clSetKernelArg(m_oclKernelComputePartialVolumes[threadID], 2, sizeof(float) * 4, fPlane);
+			if (error != CL_SUCCESS)
+			{
+				if (params.m_logger)
+				{
+					params.m_logger->Log("Couldn't kernel atguments \n");
+				}
+				SetCancel(true);
+			}
+
+			error = clEnqueueNDRangeKernel(m_oclQueue[threadID], m_oclKernelComputePartialVolumes[threadID],
+										   1, NULL, &search.m_globalSize, &m_oclWorkGroupSize, 0, NULL, NULL);
+			if (error != CL_SUCCESS)
+			{
+				if (params.m_logger)
+				{
+					params.m_logger->Log("Couldn't run kernel \n");
+				}
+				SetCancel(true);
+			}
+			int nValues = (int)search.m_nWorkGroups;
+			while (nValues > 1)
+			{
+				error = clSetKernelArg(m_oclKernelComputeSum[threadID], 1, sizeof(int), &nValues);
+				if (error != CL_SUCCESS)
+				{
+					if (params.m_logger)
+					{
+						params.m_logger->Log("Couldn't kernel atguments \n");
+					}
+					SetCancel(true);
+				}
+				size_t nWorkGroups = (nValues + m_oclWorkGroupSize - 1) / m_oclWorkGroupSize;
+				size_t globalSize = nWorkGroups * m_oclWorkGroupSize;
+				error = clEnqueueNDRangeKernel(m_oclQueue[threadID], m_oclKernelComputeSum[threadID],
+											   1, NULL, &globalSize, &m_oclWorkGroupSize, 0, NULL, NULL);
+				if (error != CL_SUCCESS)
+				{
+					if (params.m_logger)
+					{
+						params.m_logger->Log("Couldn't run kernel \n");
+					}
+					SetCancel(true);
+				}
+				nValues = (int)nWorkGroups;
+			}
+#endif  // CL_VERSION_1_1
+		}
+
+		rightCH.ResizePoints(0);
+		leftCH.ResizePoints(0);
+		rightCH.ResizeTriangles(0);
+		leftCH.ResizeTriangles(0);
+
+// compute convex-hulls
+#ifdef TEST_APPROX_CH
+		double volumeLeftCH1;
+		double volumeRightCH1;
+#endif  //TEST_APPROX_CH
+		if (params.m_convexhullApproximation)
+		{
+			rightCHPts.Resize(0);
+			leftCHPts.Resize(0);
+			search.m_onSurfacePSet->Intersect(plane, &rightCHPts, &leftCHPts, search.m_convexhullDownsampling * 32);
+			inputPSet->GetConvexHull().Clip(plane, rightCHPts, leftCHPts);
+			rightCH.ComputeConvexHull((double*)rightCHPts.Data(), rightCHPts.Size());
+			leftCH.ComputeConvexHull((double*)leftCHPts.Data(), leftCHPts.Size());
+#ifdef TEST_APPROX_CH
+			Mesh leftCH1;
+			Mesh rightCH1;
+			VoxelSet right;
+			VoxelSet left;
+			search.m_onSurfacePSet->Clip(plane, &right, &left);
+			right.ComputeConvexHull(rightCH1, search.m_convexhullDownsampling);
+			left.ComputeConvexHull(leftCH1, search.m_convexhullDownsampling);
+
+			volumeLeftCH1 = leftCH1.ComputeVolume();
+			volumeRightCH1 = rightCH1.ComputeVolume();
+#endif  //TEST_APPROX_CH
+		}
+		else
+		{
+			search.m_onSurfacePSet->Clip(plane, right, left);
+			right->ComputeConvexHull(rightCH, search.m_convexhullDownsampling);
+			left->ComputeConvexHull(leftCH, search.m_convexhullDownsampling);
+		}
+		double volumeLeftCH = leftCH.ComputeVolume();
+		double volumeRightCH = rightCH.ComputeVolume();
+
+		// compute clipped volumes
+		double volumeLeft = 0.0;
+		double volumeRight = 0.0;
+		if (search.m_oclAcceleration)
+		{
+#ifdef CL_VERSION_1_1
+			const int threadID = 0;
+			unsigned int volumes[4];
+			cl_int error = clEnqueueReadBuffer(m_oclQueue[threadID], search.m_partialVolumes[threadID], CL_TRUE,
+											   0, sizeof(unsigned int) * 4, volumes, 0, NULL, NULL);
+			size_t nPrimitivesRight = volumes[0] + volumes[1] + volumes[2] + volumes[3];
+			size_t nPrimitivesLeft = inputPSet->GetNPrimitives() - nPrimitivesRight;
+			volumeRight = nPrimitivesRight * search.m_unitVolume;
+			volumeLeft = nPrimitivesLeft * search.m_unitVolume;
+			if (error != CL_SUCCESS)
+			{
+				if (params.m_logger)
+				{
+					params.m_logger->Log("Couldn't read buffer \n");
+				}
+				SetCancel(true);
+			}
+#endif  // CL_VERSION_1_1
+		}
+		else
+		{
+			inputPSet->ComputeClippedVolumes(plane, volumeRight, volumeLeft);
+		}
+		double concavityLeft = ComputeConcavity(volumeLeft, volumeLeftCH, m_volumeCH0);
+		double concavityRight = ComputeConcavity(volumeRight, volumeRightCH, m_volumeCH0);
+		double concavity = (concavityLeft + concavityRight);
+
+		// compute cost
+		double balance = search.m_alpha * fabs(volumeLeft - volumeRight) / m_volumeCH0;
+		double d = search.m_w * (search.m_preferredCuttingDirection[0] * plane.m_a + search.m_preferredCuttingDirection[1] * plane.m_b + search.m_preferredCuttingDirection[2] * plane.m_c);
+		double symmetry = search.m_beta * d;
+		double total = concavity + balance + symmetry;
+
+		cost[0] = total;
+		cost[1] = concavity;
+		cost[2] = balance;
+		cost[3] = symmetry;
+
+		search.m_progressMutex.Lock();
+		++search.m_done;
+		if (!(search.m_done & 127))  // reduce update frequency
+		{
+			double progress = search.m_done * (search.m_progress1 - search.m_progress0) / search.m_planes->Size() + search.m_progress0;
+			Update(m_stageProgress, progress, params);
+		}
+		search.m_progressMutex.Unlock();
+	}
+
+	delete right;
+	delete left;
+}
+
 //#define DEBUG_TEMP
 void VHACD::ComputeBestClippingPlane(const PrimitiveSet* inputPSet, const double volume, const SArray<Plane>& planes,
 									 const Vec3<double>& preferredCuttingDirection, const double w, const double alpha, const double beta,
@@ -757,27 +993,31 @@ void VHACD::ComputeBestClippingPlane(const PrimitiveSet* inputPSet, const double
 	bool oclAcceleration = (nPrimitives > OCL_MIN_NUM_PRIMITIVES && params.m_oclAcceleration && params.m_mode == 0) ? true : false;
 	int iBest = -1;
 	int nPlanes = static_cast<int>(planes.Size());
-	bool cancel = false;
-	int done = 0;
 	double minTotal = MAX_DOUBLE;
 	double minBalance = MAX_DOUBLE;
 	double minSymmetry = MAX_DOUBLE;
 	minConcavity = MAX_DOUBLE;
 
-	SArray<Vec3<double> >* chPts = new SArray<Vec3<double> >[2 * m_ompNumProcessors];
-	Mesh* chs = new Mesh[2 * m_ompNumProcessors];
 	PrimitiveSet* onSurfacePSet = inputPSet->Create();
 	inputPSet->SelectOnSurface(onSurfacePSet);
 
-	PrimitiveSet** psets = 0;
-	if (!params.m_convexhullApproximation)
-	{
-		psets = new PrimitiveSet*[2 * m_ompNumProcessors];
-		for (int i = 0; i < 2 * m_ompNumProcessors; ++i)
-		{
-			psets[i] = inputPSet->Create();
-		}
-	}
+	SArray<double> costs;
+	costs.Resize(4 * planes.Size());
+
+	ClippingPlaneSearch search;
+	search.m_inputPSet = inputPSet;
+	search.m_onSurfacePSet = onSurfacePSet;
+	search.m_planes = &planes;
+	search.m_preferredCuttingDirection = preferredCuttingDirection;
+	search.m_w = w;
+	search.m_alpha = alpha;
+	search.m_beta = beta;
+	search.m_convexhullDownsampling = convexhullDownsampling;
+	search.m_progress0 = progress0;
+	search.m_progress1 = progress1;
+	search.m_params = &params;
+	search.m_costs = costs.Data();
+	search.m_done = 0;
 
 #ifdef CL_VERSION_1_1
 	// allocate OpenCL data structures
@@ -846,193 +1086,43 @@ void VHACD::ComputeBestClippingPlane(const PrimitiveSet* inputPSet, const double
 			}
 		}
 	}
+	search.m_partialVolumes = partialVolumes;
+	search.m_globalSize = globalSize;
+	search.m_nWorkGroups = nWorkGroups;
+	search.m_unitVolume = unitVolume;
 #else   // CL_VERSION_1_1
 	oclAcceleration = false;
 #endif  // CL_VERSION_1_1
+	search.m_oclAcceleration = oclAcceleration;
 
 #ifdef DEBUG_TEMP
 	Timer timerComputeCost;
 	timerComputeCost.Tic();
 #endif  // DEBUG_TEMP
 
-#if USE_THREAD == 1 && _OPENMP
-#pragma omp parallel for
-#endif
+	// the planes are independent, evaluate them on the task scheduler; the OpenCL kernels are bound to one queue
+	ClippingPlaneCostLoop loop(this, &search);
+	if (oclAcceleration)
+	{
+		loop.forLoop(0, nPlanes);
+	}
+	else
+	{
+		ParallelFor(0, nPlanes, 1, loop);
+	}
+
+	// pick the cheapest plane, the first one on ties, whatever the number of threads
 	for (int x = 0; x < nPlanes; ++x)
 	{
-		int threadID = 0;
-#if USE_THREAD == 1 && _OPENMP
-		threadID = omp_get_thread_num();
-#pragma omp flush(cancel)
-#endif
-		if (!cancel)
+		const double* const cost = costs.Data() + 4 * x;
+		if (cost[0] < minTotal)
 		{
-			//Update progress
-			if (GetCancel())
-			{
-				cancel = true;
-#if USE_THREAD == 1 && _OPENMP
-#pragma omp flush(cancel)
-#endif
-			}
-			Plane plane = planes[x];
-
-			if (oclAcceleration)
-			{
-#ifdef CL_VERSION_1_1
-				const float fPlane[4] = {(float)plane.m_a, (float)plane.m_b, (float)plane.m_c, (float)plane.m_d};
-				cl_int error = clSetKernelArg(m_oclKernelComputePartialVolumes[threadID], 2, sizeof(float) * 4, fPlane);
-				if (error != CL_SUCCESS)
-				{
-					if (params.m_logger)
-					{
-						params.m_logger->Log("Couldn't kernel atguments \n");
-					}
-					SetCancel(true);
-				}
-
-				error = clEnqueueNDRangeKernel(m_oclQueue[threadID], m_oclKernelComputePartialVolumes[threadID],
-											   1, NULL, &globalSize, &m_oclWorkGroupSize, 0, NULL, NULL);
-				if (error != CL_SUCCESS)
-				{
-					if (params.m_logger)
-					{
-						params.m_logger->Log("Couldn't run kernel \n");
-					}
-					SetCancel(true);
-				}
-				int nValues = (int)nWorkGroups;
-				while (nValues > 1)
-				{
-					error = clSetKernelArg(m_oclKernelComputeSum[threadID], 1, sizeof(int), &nValues);
-					if (error != CL_SUCCESS)
-					{
-						if (params.m_logger)
-						{
-							params.m_logger->Log("Couldn't kernel atguments \n");
-						}
-						SetCancel(true);
-					}
-					size_t nWorkGroups = (nValues + m_oclWorkGroupSize - 1) / m_oclWorkGroupSize;
-					size_t globalSize = nWorkGroups * m_oclWorkGroupSize;
-					error = clEnqueueNDRangeKernel(m_oclQueue[threadID], m_oclKernelComputeSum[threadID],
-												   1, NULL, &globalSize, &m_oclWorkGroupSize, 0, NULL, NULL);
-					if (error != CL_SUCCESS)
-					{
-						if (params.m_logger)
-						{
-							params.m_logger->Log("Couldn't run kernel \n");
-						}
-						SetCancel(true);
-					}
-					nValues = (int)nWorkGroups;
-				}
-#endif  // CL_VERSION_1_1
-			}
-
-			Mesh& leftCH = chs[threadID];
-			Mesh& rightCH = chs[threadID + m_ompNumProcessors];
-			rightCH.ResizePoints(0);
-			leftCH.ResizePoints(0);
-			rightCH.ResizeTriangles(0);
-			leftCH.ResizeTriangles(0);
-
-// compute convex-hulls
-#ifdef TEST_APPROX_CH
-			double volumeLeftCH1;
-			double volumeRightCH1;
-#endif  //TEST_APPROX_CH
-			if (params.m_convexhullApproximation)
-			{
-				SArray<Vec3<double> >& leftCHPts = chPts[threadID];
-				SArray<Vec3<double> >& rightCHPts = chPts[threadID + m_ompNumProcessors];
-				rightCHPts.Resize(0);
-				leftCHPts.Resize(0);
-				onSurfacePSet->Intersect(plane, &rightCHPts, &leftCHPts, convexhullDownsampling * 32);
-				inputPSet->GetConvexHull().Clip(plane, rightCHPts, leftCHPts);
-				rightCH.ComputeConvexHull((double*)rightCHPts.Data(), rightCHPts.Size());
-				leftCH.ComputeConvexHull((double*)leftCHPts.Data(), leftCHPts.Size());
-#ifdef TEST_APPROX_CH
-				Mesh leftCH1;
-				Mesh rightCH1;
-				VoxelSet right;
-				VoxelSet left;
-				onSurfacePSet->Clip(plane, &right, &left);
-				right.ComputeConvexHull(rightCH1, convexhullDownsampling);
-				left.ComputeConvexHull(leftCH1, convexhullDownsampling);
-
-				volumeLeftCH1 = leftCH1.ComputeVolume();
-				volumeRightCH1 = rightCH1.ComputeVolume();
-#endif  //TEST_APPROX_CH
-			}
-			else
-			{
-				PrimitiveSet* const right = psets[threadID];
-				PrimitiveSet* const left = psets[threadID + m_ompNumProcessors];
-				onSurfacePSet->Clip(plane, right, left);
-				right->ComputeConvexHull(rightCH, convexhullDownsampling);
-				left->ComputeConvexHull(leftCH, convexhullDownsampling);
-			}
-			double volumeLeftCH = leftCH.ComputeVolume();
-			double volumeRightCH = rightCH.ComputeVolume();
-
-			// compute clipped volumes
-			double volumeLeft = 0.0;
-			double volumeRight = 0.0;
-			if (oclAcceleration)
-			{
-#ifdef CL_VERSION_1_1
-				unsigned int volumes[4];
-				cl_int error = clEnqueueReadBuffer(m_oclQueue[threadID], partialVolumes[threadID], CL_TRUE,
-												   0, sizeof(unsigned int) * 4, volumes, 0, NULL, NULL);
-				size_t nPrimitivesRight = volumes[0] + volumes[1] + volumes[2] + volumes[3];
-				size_t nPrimitivesLeft = nPrimitives - nPrimitivesRight;
-				volumeRight = nPrimitivesRight * unitVolume;
-				volumeLeft = nPrimitivesLeft * unitVolume;
-				if (error != CL_SUCCESS)
-				{
-					if (params.m_logger)
-					{
-						params.m_logger->Log("Couldn't read buffer \n");
-					}
-					SetCancel(true);
-				}
-#endif  // CL_VERSION_1_1
-			}
-			else
-			{
-				inputPSet->ComputeClippedVolumes(plane, volumeRight, volumeLeft);
-			}
-			double concavityLeft = ComputeConcavity(volumeLeft, volumeLeftCH, m_volumeCH0);
-			double concavityRight = ComputeConcavity(volumeRight, volumeRightCH, m_volumeCH0);
-			double concavity = (concavityLeft + concavityRight);
-
-			// compute cost
-			double balance = alpha * fabs(volumeLeft - volumeRight) / m_volumeCH0;
-			double d = w * (preferredCuttingDirection[0] * plane.m_a + preferredCuttingDirection[1] * plane.m_b + preferredCuttingDirection[2] * plane.m_c);
-			double symmetry = beta * d;
-			double total = concavity + balance + symmetry;
-
-#if USE_THREAD == 1 && _OPENMP
-#pragma omp critical
-#endif
-			{
-				if (total < minTotal || (total == minTotal && x < iBest))
-				{
-					minConcavity = concavity;
-					minBalance = balance;
-					minSymmetry = symmetry;
-					bestPlane = plane;
-					minTotal = total;
-					iBest = x;
-				}
-				++done;
-				if (!(done & 127))  // reduce update frequency
-				{
-					double progress = done * (progress1 - progress0) / nPlanes + progress0;
-					Update(m_stageProgress, progress, params);
-				}
-			}
+			minTotal = cost[0];
+			minConcavity = cost[1];
+			minBalance = cost[2];
+			minSymmetry = cost[3];
+			bestPlane = planes[x];
+			iBest = x;
 		}
 	}
 
@@ -1053,23 +1143,46 @@ void VHACD::ComputeBestClippingPlane(const PrimitiveSet* inputPSet, const double
 	}
 #endif  // CL_VERSION_1_1
 
-	if (psets)
-	{
-		for (int i = 0; i < 2 * m_ompNumProcessors; ++i)
-		{
-			delete psets[i];
-		}
-		delete[] psets;
-	}
 	delete onSurfacePSet;
-	delete[] chPts;
-	delete[] chs;
 	if (params.m_logger)
 	{
 		sprintf(msg, "\n\t\t\t Best  %04i T=%2.6f C=%2.6f B=%2.6f S=%2.6f (%1.1f, %1.1f, %1.1f, %3.3f)\n\n", iBest, minTotal, minConcavity, minBalance, minSymmetry, bestPlane.m_a, bestPlane.m_b, bestPlane.m_c, bestPlane.m_d);
 		params.m_logger->Log(msg);
 	}
 }
+class ConvexHullLoop : public btIParallelForBody
+{
+public:
+	ConvexHullLoop(PrimitiveSet* const* parts, Mesh* const* convexHulls, const double (&rot)[3][3], const Vec3<double>& barycenter)
+		: m_parts(parts), m_convexHulls(convexHulls), m_rot(rot), m_barycenter(barycenter)
+	{
+	}
+	void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
+	{
+		for (int p = iBegin; p < iEnd; ++p)
+		{
+			m_parts[p]->ComputeConvexHull(*m_convexHulls[p]);
+			size_t nv = m_convexHulls[p]->GetNPoints();
+			double x, y, z;
+			for (size_t i = 0; i < nv; ++i)
+			{
+				Vec3<double>& pt = m_convexHulls[p]->GetPoint(i);
+				x = pt[0];
+				y = pt[1];
+				z = pt[2];
+				pt[0] = m_rot[0][0] * x + m_rot[0][1] * y + m_rot[0][2] * z + m_barycenter[0];
+				pt[1] = m_rot[1][0] * x + m_rot[1][1] * y + m_rot[1][2] * z + m_barycenter[1];
+				pt[2] = m_rot[2][0] * x + m_rot[2][1] * y + m_rot[2][2] * z + m_barycenter[2];
+			}
+		}
+	}
+
+private:
+	PrimitiveSet* const* m_parts;
+	Mesh* const* m_convexHulls;
+	const double (&m_rot)[3][3];
+	const Vec3<double>& m_barycenter;
+};
 void VHACD::ComputeACD(const Parameters& params)
 {
 	if (GetCancel())
@@ -1313,24 +1426,12 @@ void VHACD::ComputeACD(const Parameters& params)
 
 	Update(m_stageProgress, 0.0, params);
 	m_convexHulls.Resize(0);
-	for (size_t p = 0; p < nConvexHulls && !m_cancel; ++p)
+	for (size_t p = 0; p < nConvexHulls; ++p)
 	{
-		Update(m_stageProgress, p * 100.0 / nConvexHulls, params);
 		m_convexHulls.PushBack(new Mesh);
-		parts[p]->ComputeConvexHull(*m_convexHulls[p]);
-		size_t nv = m_convexHulls[p]->GetNPoints();
-		double x, y, z;
-		for (size_t i = 0; i < nv; ++i)
-		{
-			Vec3<double>& pt = m_convexHulls[p]->GetPoint(i);
-			x = pt[0];
-			y = pt[1];
-			z = pt[2];
-			pt[0] = m_rot[0][0] * x + m_rot[0][1] * y + m_rot[0][2] * z + m_barycenter[0];
-			pt[1] = m_rot[1][0] * x + m_rot[1][1] * y + m_rot[1][2] * z + m_barycenter[1];
-			pt[2] = m_rot[2][0] * x + m_rot[2][1] * y + m_rot[2][2] * z + m_barycenter[2];
-		}
 	}
+	ConvexHullLoop convexHullLoop(parts.Data(), m_convexHulls.Data(), m_rot, m_barycenter);
+	ParallelFor(0, (int)nConvexHulls, 1, convexHullLoop);
 
 	const size_t nParts = parts.Size();
 	for (size_t p = 0; p < nParts; ++p)
@@ -1400,6 +1501,34 @@ void ComputeConvexHull(const Mesh* const ch1, const Mesh* const ch2, SArray<Vec3
 		}
 	}
 }
+class MergeCostLoop : public btIParallelForBody
+{
+public:
+	MergeCostLoop(Mesh* const* convexHulls, float* costMatrix, const double volumeCH0)
+		: m_convexHulls(convexHulls), m_costMatrix(costMatrix), m_volumeCH0(volumeCH0)
+	{
+	}
+	void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
+	{
+		SArray<Vec3<double> > pts;
+		Mesh combinedCH;
+		for (size_t p1 = iBegin; p1 < (size_t)iEnd; ++p1)
+		{
+			size_t idx = ((p1 - 1) * p1) >> 1;
+			const float volume1 = m_convexHulls[p1]->ComputeVolume();
+			for (size_t p2 = 0; p2 < p1; ++p2)
+			{
+				ComputeConvexHull(m_convexHulls[p1], m_convexHulls[p2], pts, &combinedCH);
+				m_costMatrix[idx++] = ComputeConcavity(volume1 + m_convexHulls[p2]->ComputeVolume(), combinedCH.ComputeVolume(), m_volumeCH0);
+			}
+		}
+	}
+
+private:
+	Mesh* const* m_convexHulls;
+	float* m_costMatrix;
+	double m_volumeCH0;
+};
 void VHACD::MergeConvexHulls(const Parameters& params)
 {
 	if (GetCancel())
@@ -1425,19 +1554,11 @@ void VHACD::MergeConvexHulls(const Parameters& params)
 		SArray<Vec3<double> > pts;
 		Mesh combinedCH;
 
-		// Populate the cost matrix
-		size_t idx = 0;
+		// Populate the cost matrix, one row per task
 		SArray<float> costMatrix;
 		costMatrix.Resize(((nConvexHulls * nConvexHulls) - nConvexHulls) >> 1);
-		for (size_t p1 = 1; p1 < nConvexHulls; ++p1)
-		{
-			const float volume1 = m_convexHulls[p1]->ComputeVolume();
-			for (size_t p2 = 0; p2 < p1; ++p2)
-			{
-				ComputeConvexHull(m_convexHulls[p1], m_convexHulls[p2], pts, &combinedCH);
-				costMatrix[idx++] = ComputeConcavity(volume1 + m_convexHulls[p2]->ComputeVolume(), combinedCH.ComputeVolume(), m_volumeCH0);
-			}
-		}
+		MergeCostLoop mergeCostLoop(m_convexHulls.Data(), costMatrix.Data(), m_volumeCH0);
+		ParallelFor(1, (int)nConvexHulls, 1, mergeCostLoop);
 
 		// Until we cant merge below the maximum cost
 		size_t costSize = m_convexHulls.Size();
@@ -1557,6 +1678,26 @@ void SimplifyConvexHull(Mesh* const ch, const size_t nvertices, const double min
 	ch->ResizeTriangles(nT);
 	mesh.GetIFS(ch->GetPointsBuffer(), ch->GetTrianglesBuffer());
 }
+class SimplifyConvexHullLoop : public btIParallelForBody
+{
+public:
+	SimplifyConvexHullLoop(Mesh* const* convexHulls, const size_t nvertices, const double minVolume)
+		: m_convexHulls(convexHulls), m_nvertices(nvertices), m_minVolume(minVolume)
+	{
+	}
+	void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
+	{
+		for (int i = iBegin; i < iEnd; ++i)
+		{
+			SimplifyConvexHull(m_convexHulls[i], m_nvertices, m_minVolume);
+		}
+	}
+
+private:
+	Mesh* const* m_convexHulls;
+	size_t m_nvertices;
+	double m_minVolume;
+};
 void VHACD::SimplifyConvexHulls(const Parameters& params)
 {
 	if (m_cancel || params.m_maxNumVerticesPerCH < 4)
@@ -1577,16 +1718,14 @@ void VHACD::SimplifyConvexHulls(const Parameters& params)
 	}
 
 	Update(0.0, 0.0, params);
-	for (size_t i = 0; i < nConvexHulls && !m_cancel; ++i)
+	for (size_t i = 0; i < nConvexHulls && params.m_logger; ++i)
 	{
-		if (params.m_logger)
-		{
-			msg.str("");
-			msg << "\t\t Simplify CH[" << std::setfill('0') << std::setw(5) << i << "] " << m_convexHulls[i]->GetNPoints() << " V, " << m_convexHulls[i]->GetNTriangles() << " T" << std::endl;
-			params.m_logger->Log(msg.str().c_str());
-		}
-		SimplifyConvexHull(m_convexHulls[i], params.m_maxNumVerticesPerCH, m_volumeCH0 * params.m_minVolumePerCH);
+		msg.str("");
+		msg << "\t\t Simplify CH[" << std::setfill('0') << std::setw(5) << i << "] " << m_convexHulls[i]->GetNPoints() << " V, " << m_convexHulls[i]->GetNTriangles() << " T" << std::endl;
+		params.m_logger->Log(msg.str().c_str());
 	}
+	SimplifyConvexHullLoop simplifyLoop(m_convexHulls.Data(), params.m_maxNumVerticesPerCH, m_volumeCH0 * params.m_minVolumePerCH);
+	ParallelFor(0, (int)nConvexHulls, 1, simplifyLoop);
 
 	m_overallProgress = 100.0;
 	Update(100.0, 100.0, params);
@@ -0,0 +1,322 @@
+/* Copyright (c) 2011 Khaled Mamou (kmamou at gmail dot com)
+ All rights reserved.
+ 
+ 
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ 
+ 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ 
+ 3. The names of the contributors may not be used to endorse or promote products derived from this software without specific prior written permission.
+ 
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "../public/VHACD.h"
+#include "LinearMath/btThreads.h"
+#include "vhacdBatch.h"
+#include "vhacdTimer.h"
+#include "vhacdVolume.h"
+
+namespace VHACD
+{
+// 64 bit FNV-1a
+static inline void HashBytes(unsigned long long& hash, const void* const data, const size_t size)
+{
+	const unsigned char* const bytes = (const unsigned char*)data;
+	for (size_t i = 0; i < size; ++i)
+	{
+		hash ^= bytes[i];
+		hash *= 1099511628211ULL;
+	}
+}
+template <class T>
+static inline void HashValue(unsigned long long& hash, const T& value)
+{
+	HashBytes(hash, &value, sizeof(T));
+}
+// the points are hashed as doubles, so that the same mesh given as floats or as doubles shares its result
+template <class T>
+static unsigned long long ComputeMeshHash(const T* const points,
+										  const unsigned int stridePoints,
+										  const unsigned int nPoints,
+										  const int* const triangles,
+										  const unsigned int strideTriangles,
+										  const unsigned int nTriangles,
+										  const IVHACD::Parameters& params)
+{
+	unsigned long long hash = 14695981039346656037ULL;
+	HashValue(hash, nPoints);
+	HashValue(hash, nTriangles);
+	for (unsigned int v = 0; v < nPoints; ++v)
+	{
+		for (int k = 0; k < 3; ++k)
+		{
+			const double x = (double)points[v * stridePoints + k];
+			HashValue(hash, x);
+		}
+	}
+	for (unsigned int t = 0; t < nTriangles; ++t)
+	{
+		for (int k = 0; k < 3; ++k)
+		{
+			HashValue(hash, triangles[t * strideTriangles + k]);
+		}
+	}
+	// everything but the callback, the logger and the OpenCL switch changes the decomposition
+	HashValue(hash, params.m_concavity);
+	HashValue(hash, params.m_alpha);
+	HashValue(hash, params.m_beta);
+	HashValue(hash, params.m_gamma);
+	HashValue(hash, params.m_minVolumePerCH);
+	HashValue(hash, params.m_resolution);
+	HashValue(hash, params.m_maxNumVerticesPerCH);
+	HashValue(hash, params.m_depth);
+	HashValue(hash, params.m_planeDownsampling);
+	HashValue(hash, params.m_convexhullDownsampling);
+	HashValue(hash, params.m_pca);
+	HashValue(hash, params.m_mode);
+	HashValue(hash, params.m_convexhullApproximation);
+	return hash;
+}
+
+class BatchLoop : public btIParallelForBody
+{
+public:
+	BatchLoop(Batch* batch)
+		: m_batch(batch)
+	{
+	}
+	void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
+	{
+		for (int job = iBegin; job < iEnd; ++job)
+		{
+			m_batch->Decompose(job);
+		}
+	}
+
+private:
+	Batch* m_batch;
+};
+
+IVHACDBatch* CreateVHACDBatch(void)
+{
+	return new Batch();
+}
+Batch::Batch()
+{
+	m_memoryBudget = 0;
+	m_totalTime = 0.0;
+	m_nWaves = 0;
+	m_maxWaveMemory = 0;
+}
+Batch::~Batch(void)
+{
+	ClearCache();
+}
+template <class T>
+unsigned int Batch::AddInput(const T* const points,
+							 const unsigned int stridePoints,
+							 const unsigned int nPoints,
+							 const int* const triangles,
+							 const unsigned int strideTriangles,
+							 const unsigned int nTriangles,
+							 const IVHACD::Parameters& params)
+{
+	Input& input = m_inputs.expandNonInitializing();
+	input.m_pointsFloat = 0;
+	input.m_pointsDouble = 0;
+	input.m_stridePoints = stridePoints;
+	input.m_nPoints = nPoints;
+	input.m_triangles = triangles;
+	input.m_strideTriangles = strideTriangles;
+	input.m_nTriangles = nTriangles;
+	input.m_params = params;
+	// the OpenCL kernels belong to an IVHACD, see IVHACD::OCLInit
+	input.m_params.m_oclAcceleration = false;
+	input.m_hash = ComputeMeshHash(points, stridePoints, nPoints, triangles, strideTriangles, nTriangles, params);
+	input.m_result = -1;
+	input.m_cached = false;
+	input.m_time = 0.0;
+	return (unsigned int)(m_inputs.size() - 1);
+}
+unsigned int Batch::AddMesh(const float* const points,
+							const unsigned int stridePoints,
+							const unsigned int countPoints,
+							const int* const triangles,
+							const unsigned int strideTriangles,
+							const unsigned int countTriangles,
+							const IVHACD::Parameters& params)
+{
+	const unsigned int mesh = AddInput(points, stridePoints, countPoints, triangles, strideTriangles, countTriangles, params);
+	m_inputs[mesh].m_pointsFloat = points;
+	return mesh;
+}
+unsigned int Batch::AddMesh(const double* const points,
+							const unsigned int stridePoints,
+							const unsigned int countPoints,
+							const int* const triangles,
+							const unsigned int strideTriangles,
+							const unsigned int countTriangles,
+							const IVHACD::Parameters& params)
+{
+	const unsigned int mesh = AddInput(points, stridePoints, countPoints, triangles, strideTriangles, countTriangles, params);
+	m_inputs[mesh].m_pointsDouble = points;
+	return mesh;
+}
+size_t Batch::EstimateMemory(const unsigned int countPoints,
+							 const unsigned int countTriangles,
+							 const IVHACD::Parameters& params) const
+{
+	// the voxel grid, the primitive sets of two subdivision levels and the parts clipped by each plane,
+	// tetrahedron mode keeps 5 tetrahedra per voxel instead of one voxel
+	const size_t primitiveSize = (params.m_mode == 0) ? sizeof(Voxel) : 5 * sizeof(Tetrahedron);
+	size_t bytes = (size_t)params.m_resolution * (sizeof(unsigned char) + 4 * primitiveSize);
+	bytes += (size_t)countPoints * sizeof(Vec3<double>) + (size_t)countTriangles * sizeof(Vec3<int>);
+	return bytes;
+}
+void Batch::Decompose(const int job)
+{
+	Input& input = m_inputs[m_jobs[job]];
+	Timer timer;
+	timer.Tic();
+	IVHACD* const vhacd = CreateVHACD();
+	if (input.m_pointsFloat)
+	{
+		vhacd->Compute(input.m_pointsFloat, input.m_stridePoints, input.m_nPoints,
+					   input.m_triangles, input.m_strideTriangles, input.m_nTriangles, input.m_params);
+	}
+	else
+	{
+		vhacd->Compute(input.m_pointsDouble, input.m_stridePoints, input.m_nPoints,
+					   input.m_triangles, input.m_strideTriangles, input.m_nTriangles, input.m_params);
+	}
+	Result* const result = m_results[input.m_result];
+	const unsigned int nConvexHulls = vhacd->GetNConvexHulls();
+	for (unsigned int p = 0; p < nConvexHulls; ++p)
+	{
+		IVHACD::ConvexHull ch;
+		vhacd->GetConvexHull(p, ch);
+		Mesh* const mesh = new Mesh;
+		for (unsigned int v = 0; v < ch.m_nPoints; ++v)
+		{
+			mesh->AddPoint(Vec3<double>(ch.m_points[3 * v], ch.m_points[3 * v + 1], ch.m_points[3 * v + 2]));
+		}
+		for (unsigned int t = 0; t < ch.m_nTriangles; ++t)
+		{
+			mesh->AddTriangle(Vec3<int>(ch.m_triangles[3 * t], ch.m_triangles[3 * t + 1], ch.m_triangles[3 * t + 2]));
+		}
+		result->m_convexHulls.PushBack(mesh);
+	}
+	vhacd->Release();
+	timer.Toc();
+	input.m_time = timer.GetElapsedTime();
+}
+void Batch::Compute()
+{
+	Timer timer;
+	timer.Tic();
+
+	// look the meshes up in the cache, the first mesh with a new hash is decomposed for all of them
+	m_jobs.resize(0);
+	const int firstResult = m_results.size();
+	for (int i = 0; i < m_inputs.size(); ++i)
+	{
+		Input& input = m_inputs[i];
+		const int* const found = m_cache.find(BatchKey(input.m_hash));
+		input.m_cached = (found && *found < firstResult);
+		input.m_time = 0.0;
+		if (found)
+		{
+			input.m_result = *found;
+		}
+		else
+		{
+			input.m_result = m_results.size();
+			m_cache.insert(BatchKey(input.m_hash), input.m_result);
+			m_results.push_back(new Result);
+			m_jobs.push_back(i);
+		}
+	}
+
+	// one mesh per task, in waves of meshes that fit the memory budget together, a mesh over budget runs alone
+	BatchLoop loop(this);
+	const int nJobs = m_jobs.size();
+	m_nWaves = 0;
+	m_maxWaveMemory = 0;
+	int begin = 0;
+	while (begin < nJobs)
+	{
+		int end = begin;
+		size_t memory = 0;
+		for (; end < nJobs; ++end)
+		{
+			const Input& input = m_inputs[m_jobs[end]];
+			const size_t jobMemory = EstimateMemory(input.m_nPoints, input.m_nTriangles, input.m_params);
+			if (m_memoryBudget > 0 && memory + jobMemory > m_memoryBudget && end > begin)
+			{
+				break;
+			}
+			memory += jobMemory;
+		}
+		m_nWaves++;
+		m_maxWaveMemory = (memory > m_maxWaveMemory) ? memory : m_maxWaveMemory;
+		// a single mesh runs its plane search on the task scheduler instead
+		bool parallel = false;
+#if BT_THREADSAFE
+		btITaskScheduler* scheduler = btGetTaskScheduler();
+		parallel = end - begin > 1 && scheduler && scheduler->getNumThreads() > 1 && !btThreadsAreRunning();
+#endif  // BT_THREADSAFE
+		if (parallel)
+		{
+			btParallelFor(begin, end, 1, loop);
+		}
+		else
+		{
+			loop.forLoop(begin, end);
+		}
+		begin = end;
+	}
+
+	timer.Toc();
+	m_totalTime = timer.GetElapsedTime();
+}
+unsigned int Batch::GetNConvexHulls(const unsigned int mesh) const
+{
+	const int result = m_inputs[mesh].m_result;
+	return (result < 0) ? 0 : (unsigned int)m_results[result]->m_convexHulls.Size();
+}
+void Batch::GetConvexHull(const unsigned int mesh, const unsigned int index, IVHACD::ConvexHull& ch) const
+{
+	Mesh* const convexHull = m_results[m_inputs[mesh].m_result]->m_convexHulls[index];
+	ch.m_nPoints = (unsigned int)convexHull->GetNPoints();
+	ch.m_nTriangles = (unsigned int)convexHull->GetNTriangles();
+	ch.m_points = convexHull->GetPoints();
+	ch.m_triangles = convexHull->GetTriangles();
+}
+void Batch::Clear(void)
+{
+	m_inputs.clear();
+	m_jobs.clear();
+	m_totalTime = 0.0;
+	m_nWaves = 0;
+	m_maxWaveMemory = 0;
+}
+void Batch::ClearCache(void)
+{
+	Clear();
+	for (int r = 0; r < m_results.size(); ++r)
+	{
+		Result* const result = m_results[r];
+		const size_t nConvexHulls = result->m_convexHulls.Size();
+		for (size_t p = 0; p < nConvexHulls; ++p)
+		{
+			delete result->m_convexHulls[p];
+		}
+		delete result;
+	}
+	m_results.clear();
+	m_cache.clear();
+}
+}  // namespace VHACD
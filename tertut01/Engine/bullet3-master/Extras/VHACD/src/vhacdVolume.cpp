@@ -21,6 +21,11 @@
 #include <queue>
 #include <string.h>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define VHACD_USE_SSE2
+#include <emmintrin.h>
+#endif
+
 namespace VHACD
 {
 /********************************************************/
@@ -645,7 +650,36 @@ void VoxelSet::ComputeClippedVolumes(const Plane& plane,
 	double d;
 	Vec3<double> pt;
 	size_t nPositiveVoxels = 0;
-	for (size_t v = 0; v < nVoxels; ++v)
+	size_t v = 0;
+#ifdef VHACD_USE_SSE2
+	// two voxels per iteration, with the same operations in the same order as the scalar loop below
+	const __m128d scale = _mm_set1_pd(m_scale);
+	const __m128d minX = _mm_set1_pd(m_minBB[0]);
+	const __m128d minY = _mm_set1_pd(m_minBB[1]);
+	const __m128d minZ = _mm_set1_pd(m_minBB[2]);
+	const __m128d a = _mm_set1_pd(plane.m_a);
+	const __m128d b = _mm_set1_pd(plane.m_b);
+	const __m128d c = _mm_set1_pd(plane.m_c);
+	const __m128d planeD = _mm_set1_pd(plane.m_d);
+	const __m128d zero = _mm_setzero_pd();
+	const Voxel* const voxels = m_voxels.Data();
+	for (; v + 2 <= nVoxels; v += 2)
+	{
+		// 2 voxels are 8 shorts: x0 y0 z0 data0 x1 y1 z1 data1
+		const __m128i packed = _mm_loadu_si128((const __m128i*)(voxels + v));
+		const __m128i voxel0 = _mm_srai_epi32(_mm_unpacklo_epi16(packed, packed), 16);
+		const __m128i voxel1 = _mm_srai_epi32(_mm_unpackhi_epi16(packed, packed), 16);
+		const __m128i xy = _mm_unpacklo_epi32(voxel0, voxel1);
+		const __m128i z = _mm_unpackhi_epi32(voxel0, voxel1);
+		const __m128d ptX = _mm_add_pd(_mm_mul_pd(_mm_cvtepi32_pd(xy), scale), minX);
+		const __m128d ptY = _mm_add_pd(_mm_mul_pd(_mm_cvtepi32_pd(_mm_srli_si128(xy, 8)), scale), minY);
+		const __m128d ptZ = _mm_add_pd(_mm_mul_pd(_mm_cvtepi32_pd(z), scale), minZ);
+		const __m128d dist = _mm_add_pd(_mm_add_pd(_mm_add_pd(_mm_mul_pd(a, ptX), _mm_mul_pd(b, ptY)), _mm_mul_pd(c, ptZ)), planeD);
+		const int mask = _mm_movemask_pd(_mm_cmpge_pd(dist, zero));
+		nPositiveVoxels += (mask & 1) + (mask >> 1);
+	}
+#endif  // VHACD_USE_SSE2
+	for (; v < nVoxels; ++v)
 	{
 		pt = GetPoint(m_voxels[v]);
 		d = plane.m_a * pt[0] + plane.m_b * pt[1] + plane.m_c * pt[2] + plane.m_d;
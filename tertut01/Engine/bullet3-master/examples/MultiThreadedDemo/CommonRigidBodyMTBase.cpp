@@ -39,6 +39,7 @@ class btCollisionShape;
 
 static int gNumIslands = 0;
 bool gAllowNestedParallelForLoops = false;
+static bool gTaskGraphIslandDispatch = false;
 
 class Profiler
 {
@@ -203,7 +204,14 @@ void myParallelIslandDispatch(btAlignedObjectArray<btSimulationIslandManagerMt::
 {
 	ProfileHelper prof(Profiler::kRecordDispatchIslands);
 	gNumIslands = islandsPtr->size();
-	btSimulationIslandManagerMt::parallelIslandDispatch(islandsPtr, solverParams);
+	if (gTaskGraphIslandDispatch)
+	{
+		btSimulationIslandManagerMt::taskGraphIslandDispatch(islandsPtr, solverParams);
+	}
+	else
+	{
+		btSimulationIslandManagerMt::parallelIslandDispatch(islandsPtr, solverParams);
+	}
 }
 
 ///
@@ -665,6 +673,14 @@ void CommonRigidBodyMTBase::createDefaultParameters()
 		button.m_userPointer = this;
 		m_guiHelper->getParameterInterface()->registerButtonParameter(button);
 	}
+	{
+		ButtonParams button("Solver wide SIMD blocks", 0, true);
+		button.m_buttonId = SOLVER_WIDE_SIMD;
+		button.m_initialState = !!(gSolverMode & button.m_buttonId);
+		button.m_callback = toggleSolverModeCallback;
+		button.m_userPointer = this;
+		m_guiHelper->getParameterInterface()->registerButtonParameter(button);
+	}
 	{
 		ButtonParams button("Solver randomize order", 0, true);
 		button.m_buttonId = SOLVER_RANDMIZE_ORDER;
@@ -804,6 +820,15 @@ void CommonRigidBodyMTBase::createDefaultParameters()
 			button.m_callback = boolPtrButtonCallback;
 			m_guiHelper->getParameterInterface()->registerButtonParameter(button);
 		}
+		{
+			// islands solved by a task graph get integrated as soon as each one is done
+			ButtonParams button("Island task graph", 0, true);
+			bool* ptr = &gTaskGraphIslandDispatch;
+			button.m_initialState = *ptr;
+			button.m_userPointer = ptr;
+			button.m_callback = boolPtrButtonCallback;
+			m_guiHelper->getParameterInterface()->registerButtonParameter(button);
+		}
 		{
 			ButtonParams button("Allow Nested ParallelFor", 0, true);
 			button.m_initialState = btSequentialImpulseConstraintSolverMt::s_allowNestedParallelForLoops;
@@ -864,9 +889,11 @@ void CommonRigidBodyMTBase::drawScreenText()
 		}
 		{
 			int sm = gSolverMode;
-			sprintf(msg, "solver %s mode [%s%s%s%s%s%s]",
+			sprintf(msg, "solver %s mode [%s%s%s%s%s%s%s%s]",
 					getSolverTypeName(m_solverType),
 					sm & SOLVER_SIMD ? "SIMD" : "",
+					sm & SOLVER_WIDE_SIMD ? " wide " : "",
+					sm & SOLVER_WIDE_SIMD ? btWideConstraintBlocks::getKernelName(btWideConstraintBlocks::chooseKernel()) : "",
 					sm & SOLVER_RANDMIZE_ORDER ? " randomize" : "",
 					sm & SOLVER_INTERLEAVE_CONTACT_AND_FRICTION_CONSTRAINTS ? " interleave" : "",
 					sm & SOLVER_USE_2_FRICTION_DIRECTIONS ? " friction2x" : "",
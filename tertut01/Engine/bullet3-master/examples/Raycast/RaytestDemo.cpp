@@ -22,16 +22,31 @@ subject to the following restrictions:
 #include <stdio.h>  //printf debugging
 
 #include "LinearMath/btAlignedObjectArray.h"
+#include "LinearMath/btQuickprof.h"
 
 ///RaytestDemo shows how to use the btCollisionWorld::rayTest feature
+///It also measures how many rays per second rayTest and rayTestBatch manage, over a field of static objects
+
+#define NUM_BENCHMARK_RAYS 20000
+#define NUM_BENCHMARK_FRAMES 60
 
 #include "../CommonInterfaces/CommonRigidBodyBase.h"
 
 class RaytestDemo : public CommonRigidBodyBase
 {
+	btAlignedObjectArray<btVector3> m_benchmarkFrom;
+	btAlignedObjectArray<btVector3> m_benchmarkTo;
+	btCollisionWorld::RayBatchResults m_benchmarkResults;
+	unsigned long m_rayTestMicroseconds;
+	unsigned long m_rayTestBatchMicroseconds;
+	int m_benchmarkFrames;
+
 public:
 	RaytestDemo(struct GUIHelperInterface* helper)
-		: CommonRigidBodyBase(helper)
+		: CommonRigidBodyBase(helper),
+		  m_rayTestMicroseconds(0),
+		  m_rayTestBatchMicroseconds(0),
+		  m_benchmarkFrames(0)
 	{
 	}
 	virtual ~RaytestDemo()
@@ -43,6 +58,8 @@ public:
 
 	void castRays();
 
+	void benchmarkRays();
+
 	virtual void stepSimulation(float deltaTime);
 
 	virtual void resetCamera()
@@ -127,9 +144,43 @@ void RaytestDemo::castRays()
 	}
 }
 
+void RaytestDemo::benchmarkRays()
+{
+	btClock clock;
+	for (int i = 0; i < m_benchmarkFrom.size(); i++)
+	{
+		btCollisionWorld::ClosestRayResultCallback closestResults(m_benchmarkFrom[i], m_benchmarkTo[i]);
+		m_dynamicsWorld->rayTest(m_benchmarkFrom[i], m_benchmarkTo[i], closestResults);
+	}
+	m_rayTestMicroseconds += clock.getTimeMicroseconds();
+
+	clock.reset();
+	m_dynamicsWorld->rayTestBatch(&m_benchmarkFrom[0], &m_benchmarkTo[0], 0, m_benchmarkFrom.size(), m_benchmarkResults);
+	m_rayTestBatchMicroseconds += clock.getTimeMicroseconds();
+
+	if (++m_benchmarkFrames == NUM_BENCHMARK_FRAMES)
+	{
+		const double numRays = double(NUM_BENCHMARK_FRAMES) * m_benchmarkFrom.size();
+		printf("rayTest: %.0f rays/sec, rayTestBatch: %.0f rays/sec\n",
+			   numRays * 1e6 / btMax(m_rayTestMicroseconds, 1ul),
+			   numRays * 1e6 / btMax(m_rayTestBatchMicroseconds, 1ul));
+		m_rayTestMicroseconds = 0;
+		m_rayTestBatchMicroseconds = 0;
+		m_benchmarkFrames = 0;
+	}
+
+	// show a few of the batched rays
+	btVector3 green(0, 1, 0);
+	for (int i = 0; i < m_benchmarkFrom.size(); i += 500)
+	{
+		m_dynamicsWorld->getDebugDrawer()->drawLine(m_benchmarkFrom[i], m_benchmarkResults.m_hitPointWorld[i], green);
+	}
+}
+
 void RaytestDemo::stepSimulation(float deltaTime)
 {
 	castRays();
+	benchmarkRays();
 	CommonRigidBodyBase::stepSimulation(deltaTime);
 }
 
@@ -250,6 +301,37 @@ void RaytestDemo::initPhysics()
 		}
 	}
 
+	///a field of static boxes and spheres behind the demo shapes, for the benchmark rays to hit
+	{
+		btCollisionShape* boxShape = new btBoxShape(btVector3(0.4, 0.4, 0.4));
+		btCollisionShape* sphereShape = new btSphereShape(0.4);
+		m_collisionShapes.push_back(boxShape);
+		m_collisionShapes.push_back(sphereShape);
+		for (int x = 0; x < 30; x++)
+		{
+			for (int z = 0; z < 30; z++)
+			{
+				btTransform startTransform;
+				startTransform.setIdentity();
+				startTransform.setOrigin(btVector3(x * 2 - 30, 0.4 + ((x + z) % 3), z * 2 + 6));
+				btRigidBody::btRigidBodyConstructionInfo rbInfo(0, 0, (x + z) % 2 ? boxShape : sphereShape);
+				rbInfo.m_startWorldTransform = startTransform;
+				m_dynamicsWorld->addRigidBody(new btRigidBody(rbInfo));
+			}
+		}
+
+		///sensors above the field, each casting a cone of rays down into it
+		srand(1234);
+		for (int i = 0; i < NUM_BENCHMARK_RAYS; i++)
+		{
+			const int sensor = i % 16;
+			btVector3 from((sensor % 4) * 15 - 22, 10, (sensor / 4) * 15 + 8);
+			btVector3 dir(btScalar(rand()) / RAND_MAX - 0.5, -1, btScalar(rand()) / RAND_MAX - 0.5);
+			m_benchmarkFrom.push_back(from);
+			m_benchmarkTo.push_back(from + dir.normalized() * 30);
+		}
+	}
+
 	m_guiHelper->autogenerateGraphicsObjects(m_dynamicsWorld);
 }
 
@@ -26,6 +26,7 @@ project ("pybullet")
 		{
 			"../../Extras/VHACD/test/src/main_vhacd.cpp",
 			"../../Extras/VHACD/src/VHACD.cpp",
+			"../../Extras/VHACD/src/vhacdBatch.cpp",
 			"../../Extras/VHACD/src/vhacdICHull.cpp",
 			"../../Extras/VHACD/src/vhacdManifoldMesh.cpp",
 			"../../Extras/VHACD/src/vhacdMesh.cpp",
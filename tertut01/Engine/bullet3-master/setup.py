@@ -242,6 +242,7 @@ sources = ["examples/pybullet/pybullet.c"]\
 +["Extras/InverseDynamics/SimpleTreeCreator.cpp"]\
 +["Extras/InverseDynamics/invdyn_bullet_comparison.cpp"]\
 +["src/BulletSoftBody/btDefaultSoftBodySolver.cpp"]\
++["src/BulletSoftBody/btDefaultSoftBodySolverMt.cpp"]\
 +["src/BulletSoftBody/btSoftBodyHelpers.cpp"]\
 +["src/BulletSoftBody/btSoftRigidCollisionAlgorithm.cpp"]\
 +["src/BulletSoftBody/btSoftBody.cpp"]\
@@ -256,6 +257,7 @@ sources = ["examples/pybullet/pybullet.c"]\
 +["src/BulletSoftBody/btDeformableContactConstraint.cpp"]\
 +["src/BulletSoftBody/btDeformableMultiBodyConstraintSolver.cpp"]\
 +["src/BulletSoftBody/btDeformableMultiBodyDynamicsWorld.cpp"]\
++["src/BulletSoftBody/btPreconditioner.cpp"]\
 +["src/BulletSoftBody/poly34.cpp"]\
 +["src/BulletSoftBody/BulletReducedDeformableBody/btReducedDeformableBody.cpp"]\
 +["src/BulletSoftBody/BulletReducedDeformableBody/btReducedDeformableBodyHelpers.cpp"]\
@@ -340,6 +342,7 @@ sources = ["examples/pybullet/pybullet.c"]\
 +["examples/ThirdPartyLibs/Gwen/Renderers/OpenGL_DebugFont.cpp"]\
 +["Extras/VHACD/test/src/main_vhacd.cpp"] \
 +["Extras/VHACD/src/VHACD.cpp"] \
++["Extras/VHACD/src/vhacdBatch.cpp"] \
 +["Extras/VHACD/src/vhacdICHull.cpp"] \
 +["Extras/VHACD/src/vhacdManifoldMesh.cpp"] \
 +["Extras/VHACD/src/vhacdMesh.cpp"] \
@@ -381,6 +384,7 @@ egl_renderer_sources = \
 +["src/LinearMath/btGeometryUtil.cpp"]\
 +["src/LinearMath/btQuickprof.cpp"] \
 +["src/LinearMath/btThreads.cpp"] \
++["src/LinearMath/btTaskGraph.cpp"] \
 +["src/Bullet3Common/b3AlignedAllocator.cpp"] \
 +["examples/ThirdPartyLibs/glad/gl.c"]\
 +["examples/OpenGLWindow/GLInstancingRenderer.cpp"]\
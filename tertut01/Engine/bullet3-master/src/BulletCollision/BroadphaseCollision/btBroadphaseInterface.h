@@ -41,6 +41,25 @@ protected:
 	btBroadphaseRayCallback() {}
 };
 
+///btBroadphaseRayPacketCallback is used by rayTestPacket, which tests up to BT_RAY_PACKET_SIZE rays together.
+///Each proxy is reported once, with a bit set in rayMask for every ray that hits its aabb.
+///Lower m_hitFractionMax of a ray when it found a closer hit, the broadphase then skips the aabbs behind it
+#define BT_RAY_PACKET_SIZE 4
+struct btBroadphaseRayPacketCallback
+{
+	btScalar m_hitFractionMax[BT_RAY_PACKET_SIZE];
+
+	virtual ~btBroadphaseRayPacketCallback() {}
+	virtual void process(const btBroadphaseProxy* proxy, unsigned int rayMask) = 0;
+
+protected:
+	btBroadphaseRayPacketCallback()
+	{
+		for (int i = 0; i < BT_RAY_PACKET_SIZE; i++)
+			m_hitFractionMax[i] = btScalar(1.);
+	}
+};
+
 #include "LinearMath/btVector3.h"
 
 ///The btBroadphaseInterface class provides an interface to detect aabb-overlapping object pairs.
@@ -60,6 +79,10 @@ public:
 
 	virtual void aabbTest(const btVector3& aabbMin, const btVector3& aabbMax, btBroadphaseAabbCallback& callback) = 0;
 
+	///rayTestPacket tests up to BT_RAY_PACKET_SIZE rays at once, see btBroadphaseRayPacketCallback.
+	///The default implementation tests the rays one by one with rayTest
+	virtual void rayTestPacket(const btVector3* rayFrom, const btVector3* rayTo, int numRays, btBroadphaseRayPacketCallback& callback);
+
 	///calculateOverlappingPairs is optional: incremental algorithms (sweep and prune) might do it during the set aabb
 	virtual void calculateOverlappingPairs(btDispatcher* dispatcher) = 0;
 
@@ -76,4 +99,42 @@ public:
 	virtual void printStats() = 0;
 };
 
+struct btBroadphaseSingleRayOfPacket : public btBroadphaseRayCallback
+{
+	btBroadphaseRayPacketCallback& m_packetCallback;
+	unsigned int m_rayMask;
+
+	btBroadphaseSingleRayOfPacket(const btVector3& rayFrom, const btVector3& rayTo, int ray, btBroadphaseRayPacketCallback& packetCallback)
+		: m_packetCallback(packetCallback),
+		  m_rayMask(1u << ray)
+	{
+		btVector3 rayDir = (rayTo - rayFrom);
+		rayDir.normalize();
+		///what about division by zero? --> just set rayDirection[i] to INF/BT_LARGE_FLOAT
+		m_rayDirectionInverse[0] = rayDir[0] == btScalar(0.0) ? btScalar(BT_LARGE_FLOAT) : btScalar(1.0) / rayDir[0];
+		m_rayDirectionInverse[1] = rayDir[1] == btScalar(0.0) ? btScalar(BT_LARGE_FLOAT) : btScalar(1.0) / rayDir[1];
+		m_rayDirectionInverse[2] = rayDir[2] == btScalar(0.0) ? btScalar(BT_LARGE_FLOAT) : btScalar(1.0) / rayDir[2];
+		m_signs[0] = m_rayDirectionInverse[0] < 0.0;
+		m_signs[1] = m_rayDirectionInverse[1] < 0.0;
+		m_signs[2] = m_rayDirectionInverse[2] < 0.0;
+		m_lambda_max = rayDir.dot(rayTo - rayFrom);
+	}
+
+	virtual bool process(const btBroadphaseProxy* proxy)
+	{
+		m_packetCallback.process(proxy, m_rayMask);
+		return true;
+	}
+};
+
+inline void btBroadphaseInterface::rayTestPacket(const btVector3* rayFrom, const btVector3* rayTo, int numRays, btBroadphaseRayPacketCallback& callback)
+{
+	btAssert(numRays <= BT_RAY_PACKET_SIZE);
+	for (int i = 0; i < numRays; i++)
+	{
+		btBroadphaseSingleRayOfPacket rayCallback(rayFrom[i], rayTo[i], i, callback);
+		rayTest(rayFrom[i], rayTo[i], rayCallback);
+	}
+}
+
 #endif  //BT_BROADPHASE_INTERFACE_H
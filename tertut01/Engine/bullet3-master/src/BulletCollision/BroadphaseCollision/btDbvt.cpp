@@ -15,6 +15,7 @@ subject to the following restrictions:
 ///btDbvt implementation by Nathanael Presson
 
 #include "btDbvt.h"
+#include "LinearMath/btThreads.h"
 
 //
 typedef btAlignedObjectArray<btDbvtNode*> tNodeArray;
@@ -453,6 +454,258 @@ static DBVT_INLINE btDbvtNode*	walkup(btDbvtNode* n,int count)
 }
 #endif
 
+//
+// Binned SAH build
+//
+
+// half the surface area, the chance of a random ray or box hitting the volume is proportional to it
+static DBVT_INLINE btScalar area(const btDbvtVolume& a)
+{
+	const btVector3 edges = a.Lengths();
+	return (edges.x() * edges.y() + edges.y() * edges.z() + edges.z() * edges.x());
+}
+
+// btParallelFor asserts without BT_THREADSAFE, and trees are often built before a task scheduler is set
+static int numbuildthreads()
+{
+#if BT_THREADSAFE
+	btITaskScheduler* scheduler = btGetTaskScheduler();
+	return (scheduler ? scheduler->getNumThreads() : 1);
+#else
+	return (1);
+#endif
+}
+
+static void parallelfor(int count, int grainSize, const btIParallelForBody& body)
+{
+	if (numbuildthreads() > 1)
+		btParallelFor(0, count, grainSize, body);
+	else
+		body.forLoop(0, count);
+}
+
+struct btDbvtSAHBuilder : public btIParallelForBody
+{
+	enum
+	{
+		BINCOUNT = 16
+	};
+	struct Subtree
+	{
+		int begin;
+		int end;
+		btDbvtNode* parent;
+		int child;
+	};
+	// Leaves [b,e) split at m use the internal node nodes[m-1], the left half uses nodes[b..m-2] and
+	// the right half nodes[m..e-2], so every subtree owns its nodes and can be built on any thread
+	btDbvtNode** m_leaves;
+	btDbvtNode** m_nodes;
+	int m_deferSize;
+	btAlignedObjectArray<Subtree> m_subtrees;
+	tNodeArray m_topNodes;
+
+	btDbvtSAHBuilder(btDbvtNode** leaves, btDbvtNode** nodes) : m_leaves(leaves), m_nodes(nodes), m_deferSize(0) {}
+
+	int binof(const btDbvtNode* leaf, int axis, btScalar cmin, btScalar scale) const
+	{
+		const btScalar c = leaf->volume.Mins()[axis] + leaf->volume.Maxs()[axis];
+		return (btMin(int((c - cmin) * scale), int(BINCOUNT) - 1));
+	}
+
+	// returns where [b,e) is split, after moving the leaves of the left half to the front
+	int partition(int b, int e) const
+	{
+		// centers are kept doubled, mins+maxs, which is all the binning needs
+		btVector3 cmin = m_leaves[b]->volume.Mins() + m_leaves[b]->volume.Maxs();
+		btVector3 cmax = cmin;
+		for (int i = b + 1; i < e; ++i)
+		{
+			const btVector3 c = m_leaves[i]->volume.Mins() + m_leaves[i]->volume.Maxs();
+			cmin.setMin(c);
+			cmax.setMax(c);
+		}
+		const int axis = (cmax - cmin).maxAxis();
+		const btScalar extent = cmax[axis] - cmin[axis];
+		if (extent <= SIMD_EPSILON)
+		{
+			return ((b + e) / 2);
+		}
+		const btScalar scale = btScalar(BINCOUNT) / extent;
+		int counts[BINCOUNT] = {0};
+		btDbvtVolume volumes[BINCOUNT];
+		for (int i = b; i < e; ++i)
+		{
+			const int bin = binof(m_leaves[i], axis, cmin[axis], scale);
+			if (counts[bin]++)
+				Merge(volumes[bin], m_leaves[i]->volume, volumes[bin]);
+			else
+				volumes[bin] = m_leaves[i]->volume;
+		}
+		// sweep from the right to get the cost of everything right of each plane, then from the left
+		btScalar rightCosts[BINCOUNT];
+		btDbvtVolume right;
+		int rightCount = 0;
+		for (int i = BINCOUNT - 1; i > 0; --i)
+		{
+			if (counts[i])
+			{
+				if (rightCount)
+					Merge(right, volumes[i], right);
+				else
+					right = volumes[i];
+				rightCount += counts[i];
+			}
+			rightCosts[i] = rightCount ? area(right) * rightCount : 0;
+		}
+		btDbvtVolume left;
+		int leftCount = 0;
+		int bestPlane = -1;
+		btScalar bestCost = SIMD_INFINITY;
+		for (int i = 0; i < BINCOUNT - 1; ++i)
+		{
+			if (counts[i])
+			{
+				if (leftCount)
+					Merge(left, volumes[i], left);
+				else
+					left = volumes[i];
+				leftCount += counts[i];
+			}
+			if (leftCount == 0 || leftCount == e - b)
+				continue;
+			const btScalar cost = area(left) * leftCount + rightCosts[i + 1];
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				bestPlane = i;
+			}
+		}
+		if (bestPlane < 0)
+		{
+			return ((b + e) / 2);
+		}
+		int m = b;
+		for (int i = b; i < e; ++i)
+		{
+			if (binof(m_leaves[i], axis, cmin[axis], scale) <= bestPlane)
+			{
+				btSwap(m_leaves[i], m_leaves[m++]);
+			}
+		}
+		btAssert(m > b && m < e);
+		return (m);
+	}
+
+	// builds [b,e) under parent
+	btDbvtNode* buildsubtree(int b, int e, btDbvtNode* parent) const
+	{
+		if (e - b == 1)
+		{
+			m_leaves[b]->parent = parent;
+			return (m_leaves[b]);
+		}
+		const int m = partition(b, e);
+		btDbvtNode* node = m_nodes[m - 1];
+		node->parent = parent;
+		node->childs[0] = buildsubtree(b, m, node);
+		node->childs[1] = buildsubtree(m, e, node);
+		Merge(node->childs[0]->volume, node->childs[1]->volume, node->volume);
+		return (node);
+	}
+
+	// like buildsubtree, but only records subtrees smaller than m_deferSize so forLoop can build them later.
+	// The volumes of the nodes above them are merged once they are done
+	btDbvtNode* buildtop(int b, int e, btDbvtNode* parent, int child)
+	{
+		if (e - b == 1)
+		{
+			m_leaves[b]->parent = parent;
+			return (m_leaves[b]);
+		}
+		if (parent && e - b < m_deferSize)
+		{
+			Subtree subtree = {b, e, parent, child};
+			m_subtrees.push_back(subtree);
+			return (0);
+		}
+		const int m = partition(b, e);
+		btDbvtNode* node = m_nodes[m - 1];
+		node->parent = parent;
+		m_topNodes.push_back(node);
+		node->childs[0] = buildtop(b, m, node, 0);
+		node->childs[1] = buildtop(m, e, node, 1);
+		return (node);
+	}
+
+	void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
+	{
+		for (int i = iBegin; i < iEnd; ++i)
+		{
+			const Subtree& subtree = m_subtrees[i];
+			subtree.parent->childs[subtree.child] = buildsubtree(subtree.begin, subtree.end, subtree.parent);
+		}
+	}
+};
+
+//
+static btDbvtNode* buildsah(btDbvt* pdbvt,
+							btDbvtNode** leaves,
+							int count)
+{
+	if (count == 1)
+	{
+		leaves[0]->parent = 0;
+		return (leaves[0]);
+	}
+	tNodeArray nodes;
+	nodes.resize(count - 1);
+	for (int i = 0; i < count - 1; ++i)
+	{
+		nodes[i] = createnode(pdbvt, 0, 0);
+	}
+	btDbvtSAHBuilder builder(leaves, &nodes[0]);
+	const int numThreads = numbuildthreads();
+	if (numThreads <= 1)
+	{
+		return (builder.buildsubtree(0, count, 0));
+	}
+	// a few subtrees per thread to even out the load, but not so small that scheduling costs more than building
+	builder.m_deferSize = btMax(count / (numThreads * 4), 256);
+	btDbvtNode* root = builder.buildtop(0, count, 0, 0);
+	parallelfor(builder.m_subtrees.size(), 1, builder);
+	for (int i = builder.m_topNodes.size() - 1; i >= 0; --i)
+	{
+		btDbvtNode* node = builder.m_topNodes[i];
+		Merge(node->childs[0]->volume, node->childs[1]->volume, node->volume);
+	}
+	return (root);
+}
+
+//
+static void refitnode(btDbvtNode* node)
+{
+	if (node->isinternal())
+	{
+		refitnode(node->childs[0]);
+		refitnode(node->childs[1]);
+		Merge(node->childs[0]->volume, node->childs[1]->volume, node->volume);
+	}
+}
+
+struct btDbvtRefitBody : public btIParallelForBody
+{
+	const tNodeArray& m_subtrees;
+	btDbvtRefitBody(const tNodeArray& subtrees) : m_subtrees(subtrees) {}
+	void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
+	{
+		for (int i = iBegin; i < iEnd; ++i)
+		{
+			refitnode(m_subtrees[i]);
+		}
+	}
+};
+
 //
 // Api
 //
@@ -510,6 +763,38 @@ void btDbvt::optimizeTopDown(int bu_treshold)
 	}
 }
 
+//
+void btDbvt::optimizeSAH()
+{
+	if (m_root)
+	{
+		tNodeArray leaves;
+		leaves.reserve(m_leaves);
+		fetchleaves(this, m_root, leaves);
+		m_root = buildsah(this, &leaves[0], leaves.size());
+	}
+}
+
+//
+void btDbvt::insertBulk(const btDbvtVolume* volumes, void* const* data, int count, btDbvtNode** newleaves)
+{
+	if (count <= 0) return;
+	tNodeArray leaves;
+	leaves.reserve(m_leaves + count);
+	if (m_root)
+	{
+		fetchleaves(this, m_root, leaves);
+	}
+	for (int i = 0; i < count; ++i)
+	{
+		btDbvtNode* leaf = createnode(this, 0, volumes[i], data[i]);
+		leaves.push_back(leaf);
+		if (newleaves) newleaves[i] = leaf;
+	}
+	m_leaves += count;
+	m_root = buildsah(this, &leaves[0], leaves.size());
+}
+
 //
 void btDbvt::optimizeIncremental(int passes)
 {
@@ -531,6 +816,49 @@ void btDbvt::optimizeIncremental(int passes)
 	}
 }
 
+//
+void btDbvt::refit()
+{
+	if (!m_root) return;
+	const int numThreads = numbuildthreads();
+	if (numThreads <= 1)
+	{
+		refitnode(m_root);
+		return;
+	}
+	// hand out whole levels of subtrees until every thread gets a few, the nodes above them are merged afterwards
+	tNodeArray top;
+	tNodeArray subtrees;
+	tNodeArray next;
+	subtrees.push_back(m_root);
+	while (subtrees.size() < numThreads * 4)
+	{
+		next.resize(0);
+		for (int i = 0; i < subtrees.size(); ++i)
+		{
+			btDbvtNode* node = subtrees[i];
+			if (node->isinternal())
+			{
+				top.push_back(node);
+				next.push_back(node->childs[0]);
+				next.push_back(node->childs[1]);
+			}
+			else
+			{
+				next.push_back(node);
+			}
+		}
+		if (next.size() == subtrees.size()) break;
+		subtrees.copyFromArray(next);
+	}
+	parallelfor(subtrees.size(), 1, btDbvtRefitBody(subtrees));
+	for (int i = top.size() - 1; i >= 0; --i)
+	{
+		btDbvtNode* node = top[i];
+		Merge(node->childs[0]->volume, node->childs[1]->volume, node->volume);
+	}
+}
+
 //
 btDbvtNode* btDbvt::insert(const btDbvtVolume& volume, void* data)
 {
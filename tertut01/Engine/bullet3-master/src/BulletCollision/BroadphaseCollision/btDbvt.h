@@ -59,15 +59,18 @@ subject to the following restrictions:
 #define DBVT_SELECT_IMPL DBVT_IMPL_SSE
 #define DBVT_MERGE_IMPL DBVT_IMPL_SSE
 #define DBVT_INT0_IMPL DBVT_IMPL_SSE
+#define DBVT_RAYPACKET_IMPL DBVT_IMPL_SSE
 #else
 #define DBVT_SELECT_IMPL DBVT_IMPL_GENERIC
 #define DBVT_MERGE_IMPL DBVT_IMPL_GENERIC
 #define DBVT_INT0_IMPL DBVT_IMPL_GENERIC
+#define DBVT_RAYPACKET_IMPL DBVT_IMPL_GENERIC
 #endif
 
 #if (DBVT_SELECT_IMPL == DBVT_IMPL_SSE) || \
 	(DBVT_MERGE_IMPL == DBVT_IMPL_SSE) ||  \
-	(DBVT_INT0_IMPL == DBVT_IMPL_SSE)
+	(DBVT_INT0_IMPL == DBVT_IMPL_SSE) ||   \
+	(DBVT_RAYPACKET_IMPL == DBVT_IMPL_SSE)
 #include <emmintrin.h>
 #endif
 
@@ -222,6 +225,42 @@ struct btDbvntNode
 
 typedef btAlignedObjectArray<const btDbvtNode*> btNodeStack;
 
+///btDbvtRayPacket holds up to four rays as structure of arrays, so a node is tested against all of them at once.
+///The ray parameter runs from 0 at rayFrom to 1 at rayTo. m_lambdaMax can be lowered while the tree is walked,
+///to skip the nodes behind a hit
+ATTRIBUTE_ALIGNED16(struct)
+btDbvtRayPacket
+{
+	btScalar m_from[3][4];
+	btScalar m_directionInverse[3][4];
+	btScalar m_lambdaMax[4];
+	unsigned int m_rayMask;  // a bit for each ray in use
+
+	btDbvtRayPacket() : m_rayMask(0)
+	{
+		for (int i = 0; i < 4; ++i)
+		{
+			m_from[0][i] = m_from[1][i] = m_from[2][i] = 0;
+			m_directionInverse[0][i] = m_directionInverse[1][i] = m_directionInverse[2][i] = 0;
+			m_lambdaMax[i] = -1;
+		}
+	}
+	DBVT_INLINE void setRay(int i, const btVector3& rayFrom, const btVector3& rayTo)
+	{
+		const btVector3 direction = rayTo - rayFrom;
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			m_from[axis][i] = rayFrom[axis];
+			///what about division by zero? --> just set rayDirection[i] to INF/BT_LARGE_FLOAT
+			m_directionInverse[axis][i] = direction[axis] == btScalar(0.0) ? btScalar(BT_LARGE_FLOAT) : btScalar(1.0) / direction[axis];
+		}
+		m_lambdaMax[i] = 1;
+		m_rayMask |= 1u << i;
+	}
+	// returns a bit for each ray that hits the volume, slab test as in btRayAabb2
+	DBVT_INLINE unsigned int intersect(const btDbvtVolume& volume) const;
+};
+
 ///The btDbvt class implements a fast dynamic bounding volume tree based on axis aligned bounding boxes (aabb tree).
 ///This btDbvt is used for soft body collision detection and for the btDbvtBroadphase. It has a fast insert, remove and update of nodes.
 ///Unlike the btQuantizedBvh, nodes can be dynamically moved around, which allows for change in topology of the underlying data structure.
@@ -272,6 +311,7 @@ struct btDbvt
 		DBVT_VIRTUAL void Process(const btDbvtNode*, const btDbvtNode*) {}
 		DBVT_VIRTUAL void Process(const btDbvtNode*) {}
 		DBVT_VIRTUAL void Process(const btDbvtNode* n, btScalar) { Process(n); }
+		DBVT_VIRTUAL void ProcessRays(const btDbvtNode* n, unsigned int /*rayMask*/) { Process(n); }
         DBVT_VIRTUAL void Process(const btDbvntNode*, const btDbvntNode*) {}
 		DBVT_VIRTUAL bool Descent(const btDbvtNode*) { return (true); }
 		DBVT_VIRTUAL bool AllLeaves(const btDbvtNode*) { return (true); }
@@ -315,7 +355,16 @@ struct btDbvt
 	void optimizeBottomUp();
 	void optimizeTopDown(int bu_treshold = 128);
 	void optimizeIncremental(int passes);
+	///optimizeSAH rebuilds the whole tree with a binned surface area heuristic, the subtrees are built in parallel
+	///when a task scheduler with several threads is set. Queries on it are cheaper than after optimizeTopDown
+	void optimizeSAH();
 	btDbvtNode* insert(const btDbvtVolume& box, void* data);
+	///insertBulk adds count leaves at once and rebuilds the tree like optimizeSAH, which is much faster than
+	///calling insert for each of them when there are many. If newleaves is not null it receives the new leaves
+	void insertBulk(const btDbvtVolume* volumes, void* const* data, int count, btDbvtNode** newleaves = 0);
+	///refit recomputes the volumes of all internal nodes after leaf volumes were changed in place, in parallel like optimizeSAH.
+	///The topology is kept, so the tree gets worse when leaves move far, optimize it now and then
+	void refit();
 	void update(btDbvtNode* leaf, int lookahead = -1);
 	void update(btDbvtNode* leaf, btDbvtVolume& volume);
 	bool update(btDbvtNode* leaf, btDbvtVolume& volume, const btVector3& velocity, btScalar margin);
@@ -402,6 +451,14 @@ struct btDbvt
 						 btAlignedObjectArray<const btDbvtNode*>& stack,
 						 DBVT_IPOLICY) const;
 
+	///rayTestPacket walks the tree once for all rays of the packet. policy.ProcessRays gets every leaf hit by
+	///any of the rays, with a bit set in rayMask for each ray that hits it
+	DBVT_PREFIX
+	void rayTestPacket(const btDbvtNode* root,
+					   const btDbvtRayPacket& packet,
+					   btNodeStack& stack,
+					   DBVT_IPOLICY) const;
+
 	DBVT_PREFIX
 	static void collideKDOP(const btDbvtNode* root,
 							const btVector3* normals,
@@ -1271,6 +1328,81 @@ inline void btDbvt::rayTestInternal(const btDbvtNode* root,
 	}
 }
 
+//
+DBVT_INLINE unsigned int btDbvtRayPacket::intersect(const btDbvtVolume& volume) const
+{
+#if DBVT_RAYPACKET_IMPL == DBVT_IMPL_SSE
+	__m128 tmin = _mm_setzero_ps();
+	__m128 tmax = _mm_load_ps(m_lambdaMax);
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		const __m128 from = _mm_load_ps(m_from[axis]);
+		const __m128 inv = _mm_load_ps(m_directionInverse[axis]);
+		const __m128 t0 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(volume.Mins()[axis]), from), inv);
+		const __m128 t1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(volume.Maxs()[axis]), from), inv);
+		tmin = _mm_max_ps(tmin, _mm_min_ps(t0, t1));
+		tmax = _mm_min_ps(tmax, _mm_max_ps(t0, t1));
+	}
+	return ((unsigned int)_mm_movemask_ps(_mm_cmple_ps(tmin, tmax)) & m_rayMask);
+#else
+	unsigned int mask = 0;
+	for (int i = 0; i < 4; ++i)
+	{
+		btScalar tmin = 0;
+		btScalar tmax = m_lambdaMax[i];
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			const btScalar t0 = (volume.Mins()[axis] - m_from[axis][i]) * m_directionInverse[axis][i];
+			const btScalar t1 = (volume.Maxs()[axis] - m_from[axis][i]) * m_directionInverse[axis][i];
+			tmin = btMax(tmin, btMin(t0, t1));
+			tmax = btMin(tmax, btMax(t0, t1));
+		}
+		mask |= (tmin <= tmax ? 1u : 0u) << i;
+	}
+	return (mask & m_rayMask);
+#endif
+}
+
+//
+DBVT_PREFIX
+inline void btDbvt::rayTestPacket(const btDbvtNode* root,
+								  const btDbvtRayPacket& packet,
+								  btNodeStack& stack,
+								  DBVT_IPOLICY) const
+{
+	DBVT_CHECKTYPE
+	if (root)
+	{
+		int depth = 1;
+		int treshold = DOUBLE_STACKSIZE - 2;
+		stack.resize(DOUBLE_STACKSIZE);
+		stack[0] = root;
+		do
+		{
+			const btDbvtNode* node = stack[--depth];
+			// m_lambdaMax is read again for every node, the policy may have lowered it
+			const unsigned int rayMask = packet.intersect(node->volume);
+			if (rayMask)
+			{
+				if (node->isinternal())
+				{
+					if (depth > treshold)
+					{
+						stack.resize(stack.size() * 2);
+						treshold = stack.size() - 2;
+					}
+					stack[depth++] = node->childs[0];
+					stack[depth++] = node->childs[1];
+				}
+				else
+				{
+					policy.ProcessRays(node, rayMask);
+				}
+			}
+		} while (depth);
+	}
+}
+
 //
 DBVT_PREFIX
 inline void btDbvt::rayTest(const btDbvtNode* root,
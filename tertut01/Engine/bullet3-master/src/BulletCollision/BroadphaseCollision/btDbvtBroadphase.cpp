@@ -24,6 +24,7 @@ btScalar gDbvtMargin = btScalar(0.05);
 
 #if DBVT_BP_PROFILE || DBVT_BP_ENABLE_BENCHMARK
 #include <stdio.h>
+#include "LinearMath/btQuickprof.h"
 #endif
 
 #if DBVT_BP_PROFILE
@@ -123,6 +124,66 @@ struct btDbvtTreeCollider : btDbvt::ICollide
 	}
 };
 
+/* Leaf refitter	*/
+struct btDbvtLeafRefitter : btIParallelForBody
+{
+	enum
+	{
+		UNCHANGED,
+		FIXED,   /* In the fixed set, goes through setAabb	*/
+		STAYED,  /* Still inside its leaf volume			*/
+		MOVED,   /* Leaf volume changed, tree needs a refit	*/
+		TELEPORTED /* Left its leaf volume, reinserted serially	*/
+	};
+	btDbvtBroadphase* pbp;
+	btBroadphaseProxy* const* proxies;
+	const btVector3* aabbMins;
+	const btVector3* aabbMaxs;
+	char* results;
+	void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
+	{
+		for (int i = iBegin; i < iEnd; ++i)
+		{
+			btDbvtProxy* proxy = (btDbvtProxy*)proxies[i];
+			ATTRIBUTE_ALIGNED16(btDbvtVolume)
+			aabb = btDbvtVolume::FromMM(aabbMins[i], aabbMaxs[i]);
+			if (proxy->stage == btDbvtBroadphase::STAGECOUNT)
+			{
+				results[i] = FIXED;
+				continue;
+			}
+#if DBVT_BP_PREVENTFALSEUPDATE
+			if (!NotEqual(aabb, proxy->leaf->volume))
+			{
+				results[i] = UNCHANGED;
+				continue;
+			}
+#endif
+			results[i] = MOVED;
+			if (Intersect(proxy->leaf->volume, aabb))
+			{ /* Moving				*/
+				if (proxy->leaf->volume.Contain(aabb))
+				{
+					results[i] = STAYED;
+					continue;
+				}
+				const btVector3 delta = aabbMins[i] - proxy->m_aabbMin;
+				btVector3 velocity(((proxy->m_aabbMax - proxy->m_aabbMin) / 2) * pbp->m_prediction);
+				if (delta[0] < 0) velocity[0] = -velocity[0];
+				if (delta[1] < 0) velocity[1] = -velocity[1];
+				if (delta[2] < 0) velocity[2] = -velocity[2];
+				aabb.Expand(btVector3(gDbvtMargin, gDbvtMargin, gDbvtMargin));
+				aabb.SignedExpand(velocity);
+				proxy->leaf->volume = aabb;
+			}
+			else
+			{ /* Teleporting			*/
+				results[i] = TELEPORTED;
+			}
+		}
+	}
+};
+
 //
 // btDbvtBroadphase
 //
@@ -283,6 +344,48 @@ void btDbvtBroadphase::rayTest(const btVector3& rayFrom, const btVector3& rayTo,
 							  callback);
 }
 
+struct BroadphaseRayPacketTester : btDbvt::ICollide
+{
+	btBroadphaseRayPacketCallback& m_packetCallback;
+	btDbvtRayPacket& m_packet;
+	BroadphaseRayPacketTester(btBroadphaseRayPacketCallback& orgCallback, btDbvtRayPacket& packet)
+		: m_packetCallback(orgCallback),
+		  m_packet(packet)
+	{
+	}
+	void ProcessRays(const btDbvtNode* leaf, unsigned int rayMask)
+	{
+		btDbvtProxy* proxy = (btDbvtProxy*)leaf->data;
+		m_packetCallback.process(proxy, rayMask);
+		// rays that found a closer hit stop looking behind it
+		for (int i = 0; i < BT_RAY_PACKET_SIZE; i++)
+		{
+			m_packet.m_lambdaMax[i] = btMin(m_packet.m_lambdaMax[i], m_packetCallback.m_hitFractionMax[i]);
+		}
+	}
+};
+
+void btDbvtBroadphase::rayTestPacket(const btVector3* rayFrom, const btVector3* rayTo, int numRays, btBroadphaseRayPacketCallback& rayCallback)
+{
+	btAssert(numRays <= BT_RAY_PACKET_SIZE);
+	btDbvtRayPacket packet;
+	for (int i = 0; i < numRays; i++)
+	{
+		packet.setRay(i, rayFrom[i], rayTo[i]);
+		packet.m_lambdaMax[i] = rayCallback.m_hitFractionMax[i];
+	}
+	BroadphaseRayPacketTester callback(rayCallback, packet);
+	btAlignedObjectArray<const btDbvtNode*>* stack = &m_rayTestStacks[0];
+#if BT_THREADSAFE
+	// each thread needs its own stack, see rayTest
+	btAlignedObjectArray<const btDbvtNode*> localStack;
+	stack = &localStack;
+#endif
+
+	m_sets[0].rayTestPacket(m_sets[0].m_root, packet, *stack, callback);
+	m_sets[1].rayTestPacket(m_sets[1].m_root, packet, *stack, callback);
+}
+
 struct BroadphaseAabbTester : btDbvt::ICollide
 {
 	btBroadphaseAabbCallback& m_aabbCallback;
@@ -413,6 +516,79 @@ void btDbvtBroadphase::setAabbForceUpdate(btBroadphaseProxy* absproxy,
 	}
 }
 
+//
+void btDbvtBroadphase::setAabbs(btBroadphaseProxy* const* proxies,
+								const btVector3* aabbMins,
+								const btVector3* aabbMaxs,
+								int count,
+								btDispatcher* dispatcher)
+{
+	if (count <= 0) return;
+	m_refitResults.resizeNoInitialize(count);
+	btDbvtLeafRefitter refitter;
+	refitter.pbp = this;
+	refitter.proxies = proxies;
+	refitter.aabbMins = aabbMins;
+	refitter.aabbMaxs = aabbMaxs;
+	refitter.results = &m_refitResults[0];
+	/* Grow the leaves in place	*/
+#if BT_THREADSAFE
+	if (btGetTaskScheduler() && btGetTaskScheduler()->getNumThreads() > 1)
+		btParallelFor(0, count, 256, refitter);
+	else
+#endif
+		refitter.forLoop(0, count);
+	for (int i = 0; i < count; ++i)
+	{
+		if (m_refitResults[i] == btDbvtLeafRefitter::MOVED)
+		{
+			m_sets[0].refit();
+			break;
+		}
+	}
+	/* Reinsert teleported leaves, growing them in place would make their ancestors span both places	*/
+	for (int i = 0; i < count; ++i)
+	{
+		if (m_refitResults[i] == btDbvtLeafRefitter::TELEPORTED)
+		{
+			btDbvtProxy* proxy = (btDbvtProxy*)proxies[i];
+			ATTRIBUTE_ALIGNED16(btDbvtVolume)
+			aabb = btDbvtVolume::FromMM(aabbMins[i], aabbMaxs[i]);
+			m_sets[0].update(proxy->leaf, aabb);
+		}
+	}
+	/* Stages and pairs, as setAabb	*/
+	for (int i = 0; i < count; ++i)
+	{
+		btDbvtProxy* proxy = (btDbvtProxy*)proxies[i];
+		const char result = m_refitResults[i];
+		if (result == btDbvtLeafRefitter::UNCHANGED)
+			continue;
+		if (result == btDbvtLeafRefitter::FIXED)
+		{
+			setAabb(proxy, aabbMins[i], aabbMaxs[i], dispatcher);
+			continue;
+		}
+		++m_updates_call;
+		listremove(proxy, m_stageRoots[proxy->stage]);
+		proxy->m_aabbMin = aabbMins[i];
+		proxy->m_aabbMax = aabbMaxs[i];
+		proxy->stage = m_stageCurrent;
+		listappend(proxy, m_stageRoots[m_stageCurrent]);
+		if (result == btDbvtLeafRefitter::MOVED || result == btDbvtLeafRefitter::TELEPORTED)
+		{
+			++m_updates_done;
+			m_needcleanup = true;
+			if (!m_deferedcollide)
+			{
+				btDbvtTreeCollider collider(this);
+				m_sets[1].collideTTpersistentStack(m_sets[1].m_root, proxy->leaf, collider);
+				m_sets[0].collideTTpersistentStack(m_sets[0].m_root, proxy->leaf, collider);
+			}
+		}
+	}
+}
+
 //
 void btDbvtBroadphase::calculateOverlappingPairs(btDispatcher* dispatcher)
 {
@@ -630,6 +806,13 @@ void btDbvtBroadphase::optimize()
 	m_sets[1].optimizeTopDown();
 }
 
+//
+void btDbvtBroadphase::optimizeSAH()
+{
+	m_sets[0].optimizeSAH();
+	m_sets[1].optimizeSAH();
+}
+
 //
 btOverlappingPairCache* btDbvtBroadphase::getOverlappingPairCache()
 {
@@ -730,6 +913,12 @@ struct btBroadphaseBenchmark
 			pbi->setAabb(proxy, center - extents, center + extents, 0);
 		}
 	};
+	struct LeafCounter : btDbvt::ICollide
+	{
+		int count;
+		LeafCounter() : count(0) {}
+		void Process(const btDbvtNode*) { ++count; }
+	};
 	static int UnsignedRand(int range = RAND_MAX - 1) { return (rand() % (range + 1)); }
 	static btScalar UnitRand() { return (UnsignedRand(16384) / (btScalar)16384); }
 	static void OutputTime(const char* name, btClock& c, unsigned count = 0)
@@ -784,7 +973,7 @@ void btDbvtBroadphase::benchmark(btBroadphaseInterface* pbi)
 			po->extents[1] = btBroadphaseBenchmark::UnitRand() * 2 + 2;
 			po->extents[2] = btBroadphaseBenchmark::UnitRand() * 2 + 2;
 			po->time = btBroadphaseBenchmark::UnitRand() * 2000;
-			po->proxy = pbi->createProxy(po->center - po->extents, po->center + po->extents, 0, po, 1, 1, 0, 0);
+			po->proxy = pbi->createProxy(po->center - po->extents, po->center + po->extents, 0, po, 1, 1, 0);
 			objects.push_back(po);
 		}
 		btBroadphaseBenchmark::OutputTime("\tInitialization", wallclock);
@@ -816,6 +1005,85 @@ void btDbvtBroadphase::benchmark(btBroadphaseInterface* pbi)
 		objects.resize(0);
 		btBroadphaseBenchmark::OutputTime("\tRelease", wallclock);
 	}
+	/* Tree build and query cost	*/
+	{
+		static const int leaf_count = 8192;
+		static const int query_count = 4096;
+		printf("Tree build (%u leaves) and queries (%u):\r\n", leaf_count, query_count);
+		srand(180673);
+		btAlignedObjectArray<btDbvtVolume> volumes;
+		btAlignedObjectArray<void*> data;
+		for (int i = 0; i < leaf_count; ++i)
+		{
+			const btVector3 center(btBroadphaseBenchmark::UnitRand() * 500,
+								   btBroadphaseBenchmark::UnitRand() * 500,
+								   btBroadphaseBenchmark::UnitRand() * 500);
+			const btVector3 extents(btBroadphaseBenchmark::UnitRand() * 2 + 2,
+									btBroadphaseBenchmark::UnitRand() * 2 + 2,
+									btBroadphaseBenchmark::UnitRand() * 2 + 2);
+			volumes.push_back(btDbvtVolume::FromCE(center, extents));
+			data.push_back(0);
+		}
+		btAlignedObjectArray<btDbvtVolume> queries;
+		for (int i = 0; i < query_count; ++i)
+		{
+			queries.push_back(btDbvtVolume::FromCE(volumes[i].Center(), btVector3(10, 10, 10)));
+		}
+		static const char* names[] = {"insert", "insert+optimizeTopDown", "insertBulk"};
+		btDbvt trees[3];
+		for (int itree = 0; itree < 3; ++itree)
+		{
+			btDbvt& tree = trees[itree];
+			wallclock.reset();
+			if (itree == 2)
+			{
+				tree.insertBulk(&volumes[0], &data[0], leaf_count);
+			}
+			else
+			{
+				for (int i = 0; i < leaf_count; ++i)
+				{
+					tree.insert(volumes[i], data[i]);
+				}
+				if (itree == 1)
+				{
+					tree.optimizeTopDown();
+				}
+			}
+			printf("\t%s:\r\n", names[itree]);
+			btBroadphaseBenchmark::OutputTime("\t\tBuild", wallclock, leaf_count);
+			btBroadphaseBenchmark::LeafCounter counter;
+			wallclock.reset();
+			for (int i = 0; i < query_count; ++i)
+			{
+				tree.collideTV(tree.m_root, queries[i], counter);
+			}
+			btBroadphaseBenchmark::OutputTime("\t\tQueries", wallclock, query_count);
+			printf("\t\tOverlaps: %u, depth: %u\r\n", counter.count, btDbvt::maxdepth(tree.m_root));
+		}
+		/* All leaves move, update each vs refit once	*/
+		const btVector3 offset(1, 0, 0);
+		btAlignedObjectArray<const btDbvtNode*> leaves;
+		btDbvt::extractLeaves(trees[1].m_root, leaves);
+		wallclock.reset();
+		for (int i = 0; i < leaves.size(); ++i)
+		{
+			btDbvtNode* leaf = const_cast<btDbvtNode*>(leaves[i]);
+			btDbvtVolume volume = btDbvtVolume::FromMM(leaf->volume.Mins() + offset, leaf->volume.Maxs() + offset);
+			trees[1].update(leaf, volume);
+		}
+		btBroadphaseBenchmark::OutputTime("\tUpdate each leaf", wallclock, leaf_count);
+		leaves.resize(0);
+		btDbvt::extractLeaves(trees[2].m_root, leaves);
+		wallclock.reset();
+		for (int i = 0; i < leaves.size(); ++i)
+		{
+			btDbvtNode* leaf = const_cast<btDbvtNode*>(leaves[i]);
+			leaf->volume = btDbvtVolume::FromMM(leaf->volume.Mins() + offset, leaf->volume.Maxs() + offset);
+		}
+		trees[2].refit();
+		btBroadphaseBenchmark::OutputTime("\tMove leaves and refit", wallclock, leaf_count);
+	}
 }
 #else
 void btDbvtBroadphase::benchmark(btBroadphaseInterface*)
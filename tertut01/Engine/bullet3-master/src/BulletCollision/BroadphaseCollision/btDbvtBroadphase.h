@@ -89,6 +89,7 @@ struct btDbvtBroadphase : btBroadphaseInterface
 	bool m_deferedcollide;                      // Defere dynamic/static collision to collide call
 	bool m_needcleanup;                         // Need to run cleanup?
 	btAlignedObjectArray<btAlignedObjectArray<const btDbvtNode*> > m_rayTestStacks;
+	btAlignedObjectArray<char> m_refitResults;  // What setAabbs did with each proxy
 #if DBVT_BP_PROFILE
 	btClock m_clock;
 	struct
@@ -105,6 +106,8 @@ struct btDbvtBroadphase : btBroadphaseInterface
 	~btDbvtBroadphase();
 	void collide(btDispatcher* dispatcher);
 	void optimize();
+	///optimizeSAH rebuilds both trees with btDbvt::optimizeSAH, for example after adding many proxies during a level load
+	void optimizeSAH();
 
 	/* btBroadphaseInterface Implementation	*/
 	btBroadphaseProxy* createProxy(const btVector3& aabbMin, const btVector3& aabbMax, int shapeType, void* userPtr, int collisionFilterGroup, int collisionFilterMask, btDispatcher* dispatcher);
@@ -112,6 +115,8 @@ struct btDbvtBroadphase : btBroadphaseInterface
 	virtual void setAabb(btBroadphaseProxy* proxy, const btVector3& aabbMin, const btVector3& aabbMax, btDispatcher* dispatcher);
 	virtual void rayTest(const btVector3& rayFrom, const btVector3& rayTo, btBroadphaseRayCallback& rayCallback, const btVector3& aabbMin = btVector3(0, 0, 0), const btVector3& aabbMax = btVector3(0, 0, 0));
 	virtual void aabbTest(const btVector3& aabbMin, const btVector3& aabbMax, btBroadphaseAabbCallback& callback);
+	///rayTestPacket walks each tree once for all rays of the packet, testing a node against the rays with SIMD
+	virtual void rayTestPacket(const btVector3* rayFrom, const btVector3* rayTo, int numRays, btBroadphaseRayPacketCallback& rayCallback);
 
 	virtual void getAabb(btBroadphaseProxy* proxy, btVector3& aabbMin, btVector3& aabbMax) const;
 	virtual void calculateOverlappingPairs(btDispatcher* dispatcher);
@@ -140,6 +145,13 @@ struct btDbvtBroadphase : btBroadphaseInterface
 	///http://code.google.com/p/bullet/issues/detail?id=223
 	void setAabbForceUpdate(btBroadphaseProxy* absproxy, const btVector3& aabbMin, const btVector3& aabbMax, btDispatcher* /*dispatcher*/);
 
+	///setAabbs is a batched setAabb for when most proxies moved, each proxy may appear only once.
+	///Leaves of the dynamic set are grown in place, in parallel when a task scheduler with several threads is set,
+	///and the dynamic tree is refit once instead of removing and reinserting each moved leaf.
+	///Leaves that no longer overlap their old volume are removed and reinserted afterwards, as setAabb does.
+	///The tree is not restructured, so call optimize or optimizeSAH now and then if objects travel far.
+	void setAabbs(btBroadphaseProxy* const* proxies, const btVector3* aabbMins, const btVector3* aabbMaxs, int count, btDispatcher* dispatcher);
+
 	static void benchmark(btBroadphaseInterface*);
 };
 
@@ -105,6 +105,13 @@ public:
 	virtual void* allocateCollisionAlgorithm(int size) = 0;
 
 	virtual void freeCollisionAlgorithm(void* ptr) = 0;
+
+	///the collision algorithms allocated between these two calls on this thread are destroyed and freed before
+	///endTransientAllocations, like the one per triangle of btConvexConcaveCollisionAlgorithm, so a dispatcher may take them
+	///from a per thread arena
+	virtual void beginTransientAllocations() {}
+
+	virtual void endTransientAllocations() {}
 };
 
 #endif  //BT_DISPATCHER_H
@@ -0,0 +1,376 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2006 Erwin Coumans  https://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "btOpenAddressingPairCache.h"
+
+#include "btDispatcher.h"
+#include "btCollisionAlgorithm.h"
+#include "LinearMath/btQuickprof.h"
+
+#include <string.h>  //memset
+
+btOpenAddressingPairCache::btOpenAddressingPairCache() : m_table(0),
+														 m_tableSize(0),
+														 m_tableMask(0),
+														 m_tableShift(32),
+														 m_overlapFilterCallback(0),
+														 m_ghostPairCallback(0)
+{
+	growTable();
+}
+
+btOpenAddressingPairCache::~btOpenAddressingPairCache()
+{
+	if (m_table)
+		btAlignedFree(m_table);
+}
+
+int btOpenAddressingPairCache::findSlot(unsigned int hash, const btBroadphaseProxy* proxy0, const btBroadphaseProxy* proxy1, unsigned int& slot, unsigned int& distance) const
+{
+	slot = hash >> m_tableShift;
+	for (distance = 0;; ++distance)
+	{
+		const Slot& s = m_table[slot];
+		// Robin Hood keeps every pair closer to home than the pairs after it, so a poorer slot ends the search
+		if (s.m_pairIndex == BT_NULL_PAIR || getDistance(s, slot) < distance)
+			return BT_NULL_PAIR;
+		if (s.m_hash == hash)
+		{
+			const btBroadphasePair& pair = m_overlappingPairArray[s.m_pairIndex];
+			if (pair.m_pProxy0 == proxy0 && pair.m_pProxy1 == proxy1)
+				return int(slot);
+		}
+		slot = (slot + 1) & m_tableMask;
+	}
+}
+
+int btOpenAddressingPairCache::findSlot(unsigned int hash, const btBroadphaseProxy* proxy0, const btBroadphaseProxy* proxy1) const
+{
+	unsigned int slot, distance;
+	return findSlot(hash, proxy0, proxy1, slot, distance);
+}
+
+void btOpenAddressingPairCache::insertSlot(unsigned int hash, int pairIndex, unsigned int slot, unsigned int distance)
+{
+	Slot entry;
+	entry.m_hash = hash;
+	entry.m_pairIndex = pairIndex;
+	for (;; ++distance)
+	{
+		Slot& s = m_table[slot];
+		if (s.m_pairIndex == BT_NULL_PAIR)
+		{
+			s = entry;
+			return;
+		}
+		// take the slot from a pair that is closer to its home and carry that one on
+		const unsigned int slotDistance = getDistance(s, slot);
+		if (slotDistance < distance)
+		{
+			btSwap(s, entry);
+			distance = slotDistance;
+		}
+		slot = (slot + 1) & m_tableMask;
+	}
+}
+
+void btOpenAddressingPairCache::eraseSlot(int slot)
+{
+	// shift the following pairs back by one instead of leaving a tombstone
+	unsigned int hole = (unsigned int)slot;
+	unsigned int next = (hole + 1) & m_tableMask;
+	while (m_table[next].m_pairIndex != BT_NULL_PAIR && getDistance(m_table[next], next) > 0)
+	{
+		m_table[hole] = m_table[next];
+		hole = next;
+		next = (next + 1) & m_tableMask;
+	}
+	m_table[hole].m_pairIndex = BT_NULL_PAIR;
+}
+
+void btOpenAddressingPairCache::growTable()
+{
+	// room for one more pair at most 7/8 full, Robin Hood probe lengths stay short up to there
+	const int minSize = ((m_overlappingPairArray.size() + 1) * 8 + 6) / 7;
+	if (m_tableSize >= minSize)
+		return;
+	int newSize = m_tableSize ? m_tableSize : 16;
+	while (newSize < minSize)
+		newSize *= 2;
+	m_tableMask = (unsigned int)(newSize - 1);
+	m_tableShift = 32;
+	for (int size = newSize; size > 1; size >>= 1)
+		m_tableShift--;
+
+	Slot* oldTable = m_table;
+	const int oldSize = m_tableSize;
+	m_table = (Slot*)btAlignedAlloc(sizeof(Slot) * newSize, 64);
+	m_tableSize = newSize;
+	// all bits set is an empty slot, BT_NULL_PAIR is -1
+	memset(m_table, 0xff, sizeof(Slot) * newSize);
+	// rehash from the old slots, they already hold the hashes so the pairs are not touched
+	for (int i = 0; i < oldSize; i++)
+	{
+		if (oldTable[i].m_pairIndex != BT_NULL_PAIR)
+			insertSlot(oldTable[i].m_hash, oldTable[i].m_pairIndex, oldTable[i].m_hash >> m_tableShift, 0);
+	}
+	if (oldTable)
+		btAlignedFree(oldTable);
+}
+
+void btOpenAddressingPairCache::cleanOverlappingPair(btBroadphasePair& pair, btDispatcher* dispatcher)
+{
+	if (pair.m_algorithm && dispatcher)
+	{
+		pair.m_algorithm->~btCollisionAlgorithm();
+		dispatcher->freeCollisionAlgorithm(pair.m_algorithm);
+		pair.m_algorithm = 0;
+	}
+}
+
+void btOpenAddressingPairCache::cleanProxyFromPairs(btBroadphaseProxy* proxy, btDispatcher* dispatcher)
+{
+	for (int i = 0; i < m_overlappingPairArray.size(); i++)
+	{
+		btBroadphasePair& pair = m_overlappingPairArray[i];
+		if ((pair.m_pProxy0 == proxy) || (pair.m_pProxy1 == proxy))
+		{
+			cleanOverlappingPair(pair, dispatcher);
+		}
+	}
+}
+
+void btOpenAddressingPairCache::removeOverlappingPairsContainingProxy(btBroadphaseProxy* proxy, btDispatcher* dispatcher)
+{
+	for (int i = 0; i < m_overlappingPairArray.size();)
+	{
+		btBroadphasePair& pair = m_overlappingPairArray[i];
+		if ((pair.m_pProxy0 == proxy) || (pair.m_pProxy1 == proxy))
+		{
+			removeOverlappingPair(pair.m_pProxy0, pair.m_pProxy1, dispatcher);
+		}
+		else
+		{
+			i++;
+		}
+	}
+}
+
+btBroadphasePair* btOpenAddressingPairCache::findPair(btBroadphaseProxy* proxy0, btBroadphaseProxy* proxy1)
+{
+	if (proxy0->m_uniqueId > proxy1->m_uniqueId)
+		btSwap(proxy0, proxy1);
+	const int slot = findSlot(getHash(getKey(proxy0, proxy1)), proxy0, proxy1);
+	if (slot == BT_NULL_PAIR)
+	{
+		return NULL;
+	}
+	return &m_overlappingPairArray[m_table[slot].m_pairIndex];
+}
+
+btBroadphasePair* btOpenAddressingPairCache::internalAddPair(btBroadphaseProxy* proxy0, btBroadphaseProxy* proxy1)
+{
+	if (proxy0->m_uniqueId > proxy1->m_uniqueId)
+		btSwap(proxy0, proxy1);
+	const unsigned int hash = getHash(getKey(proxy0, proxy1));
+	// grow first, so the new pair can go where the search stops
+	growTable();
+	unsigned int stopSlot, stopDistance;
+	const int slot = findSlot(hash, proxy0, proxy1, stopSlot, stopDistance);
+	if (slot != BT_NULL_PAIR)
+	{
+		return &m_overlappingPairArray[m_table[slot].m_pairIndex];
+	}
+
+	//this is where we add an actual pair, so also call the 'ghost'
+	if (m_ghostPairCallback)
+		m_ghostPairCallback->addOverlappingPair(proxy0, proxy1);
+
+	insertSlot(hash, m_overlappingPairArray.size(), stopSlot, stopDistance);
+
+	btBroadphasePair* pair = new (&m_overlappingPairArray.expandNonInitializing()) btBroadphasePair(*proxy0, *proxy1);
+	pair->m_algorithm = 0;
+	pair->m_internalTmpValue = 0;
+	return pair;
+}
+
+void* btOpenAddressingPairCache::removeOverlappingPair(btBroadphaseProxy* proxy0, btBroadphaseProxy* proxy1, btDispatcher* dispatcher)
+{
+	if (proxy0->m_uniqueId > proxy1->m_uniqueId)
+		btSwap(proxy0, proxy1);
+	const int slot = findSlot(getHash(getKey(proxy0, proxy1)), proxy0, proxy1);
+	if (slot == BT_NULL_PAIR)
+	{
+		return 0;
+	}
+	const int pairIndex = m_table[slot].m_pairIndex;
+	btBroadphasePair& pair = m_overlappingPairArray[pairIndex];
+
+	cleanOverlappingPair(pair, dispatcher);
+
+	void* userData = pair.m_internalInfo1;
+
+	eraseSlot(slot);
+
+	if (m_ghostPairCallback)
+		m_ghostPairCallback->removeOverlappingPair(proxy0, proxy1, dispatcher);
+
+	// Move the last pair into the spot of the removed one, so its slot must point there now
+	const int lastPairIndex = m_overlappingPairArray.size() - 1;
+	if (lastPairIndex != pairIndex)
+	{
+		const btBroadphasePair& last = m_overlappingPairArray[lastPairIndex];
+		unsigned int lastSlot = getHash(getKey(last.m_pProxy0, last.m_pProxy1)) >> m_tableShift;
+		while (m_table[lastSlot].m_pairIndex != lastPairIndex)
+		{
+			btAssert(m_table[lastSlot].m_pairIndex != BT_NULL_PAIR);
+			lastSlot = (lastSlot + 1) & m_tableMask;
+		}
+		m_table[lastSlot].m_pairIndex = pairIndex;
+		m_overlappingPairArray[pairIndex] = last;
+	}
+	m_overlappingPairArray.pop_back();
+
+	return userData;
+}
+
+void btOpenAddressingPairCache::addOverlappingPairConcurrent(btBroadphaseProxy* proxy0, btBroadphaseProxy* proxy1)
+{
+	if (!needsBroadphaseCollision(proxy0, proxy1))
+		return;
+	if (proxy0->m_uniqueId > proxy1->m_uniqueId)
+		btSwap(proxy0, proxy1);
+	const unsigned int threadIndex = btGetCurrentThreadIndex();
+	btAssert(threadIndex < BT_MAX_THREAD_COUNT);
+	QueuedPair& queued = m_queuedPairs[threadIndex].expandNonInitializing();
+	queued.m_key = getKey(proxy0, proxy1);
+	queued.m_proxy0 = proxy0;
+	queued.m_proxy1 = proxy1;
+}
+
+struct btQueuedPairSortPredicate
+{
+	template <class T>
+	bool operator()(const T& a, const T& b) const
+	{
+		return a.m_key < b.m_key;
+	}
+};
+
+void btOpenAddressingPairCache::flushConcurrentPairs()
+{
+	BT_PROFILE("btOpenAddressingPairCache::flushConcurrentPairs");
+	m_flushPairs.resize(0);
+	for (int i = 0; i < int(BT_MAX_THREAD_COUNT); ++i)
+	{
+		btAlignedObjectArray<QueuedPair>& queue = m_queuedPairs[i];
+		for (int j = 0; j < queue.size(); ++j)
+		{
+			m_flushPairs.push_back(queue[j]);
+		}
+		queue.resize(0);
+	}
+	// the same pairs in the same order, no matter which threads found them
+	m_flushPairs.quickSort(btQueuedPairSortPredicate());
+	for (int i = 0; i < m_flushPairs.size(); ++i)
+	{
+		if (i > 0 && m_flushPairs[i].m_key == m_flushPairs[i - 1].m_key)
+			continue;
+		internalAddPair(m_flushPairs[i].m_proxy0, m_flushPairs[i].m_proxy1);
+	}
+}
+
+void btOpenAddressingPairCache::processAllOverlappingPairs(btOverlapCallback* callback, btDispatcher* dispatcher)
+{
+	BT_PROFILE("btOpenAddressingPairCache::processAllOverlappingPairs");
+	for (int i = 0; i < m_overlappingPairArray.size();)
+	{
+		btBroadphasePair* pair = &m_overlappingPairArray[i];
+		if (callback->processOverlap(*pair))
+		{
+			removeOverlappingPair(pair->m_pProxy0, pair->m_pProxy1, dispatcher);
+		}
+		else
+		{
+			i++;
+		}
+	}
+}
+
+struct btPairIndexSortPredicate
+{
+	const btBroadphasePairArray& m_pairs;
+	btPairIndexSortPredicate(const btBroadphasePairArray& pairs) : m_pairs(pairs) {}
+	bool operator()(int a, int b) const
+	{
+		return btBroadphasePairSortPredicate()(m_pairs[a], m_pairs[b]);
+	}
+};
+
+void btOpenAddressingPairCache::processAllOverlappingPairs(btOverlapCallback* callback, btDispatcher* dispatcher, const struct btDispatcherInfo& dispatchInfo)
+{
+	if (!dispatchInfo.m_deterministicOverlappingPairs)
+	{
+		processAllOverlappingPairs(callback, dispatcher);
+		return;
+	}
+	btAlignedObjectArray<int> indices;
+	{
+		BT_PROFILE("sortOverlappingPairs");
+		indices.resize(m_overlappingPairArray.size());
+		for (int i = 0; i < indices.size(); i++)
+		{
+			indices[i] = i;
+		}
+		indices.quickSort(btPairIndexSortPredicate(m_overlappingPairArray));
+	}
+	{
+		BT_PROFILE("btOpenAddressingPairCache::processAllOverlappingPairs");
+		for (int i = 0; i < indices.size();)
+		{
+			btBroadphasePair* pair = &m_overlappingPairArray[indices[i]];
+			if (callback->processOverlap(*pair))
+			{
+				removeOverlappingPair(pair->m_pProxy0, pair->m_pProxy1, dispatcher);
+			}
+			else
+			{
+				i++;
+			}
+		}
+	}
+}
+
+void btOpenAddressingPairCache::sortOverlappingPairs(btDispatcher* dispatcher)
+{
+	///the table points into the pair array, so rebuild all
+	btBroadphasePairArray tmpPairs;
+	for (int i = 0; i < m_overlappingPairArray.size(); i++)
+	{
+		tmpPairs.push_back(m_overlappingPairArray[i]);
+	}
+
+	for (int i = 0; i < tmpPairs.size(); i++)
+	{
+		removeOverlappingPair(tmpPairs[i].m_pProxy0, tmpPairs[i].m_pProxy1, dispatcher);
+	}
+
+	tmpPairs.quickSort(btBroadphasePairSortPredicate());
+
+	for (int i = 0; i < tmpPairs.size(); i++)
+	{
+		addOverlappingPair(tmpPairs[i].m_pProxy0, tmpPairs[i].m_pProxy1);
+	}
+}
@@ -0,0 +1,179 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2006 Erwin Coumans  https://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef BT_OPEN_ADDRESSING_PAIR_CACHE_H
+#define BT_OPEN_ADDRESSING_PAIR_CACHE_H
+
+#include "btOverlappingPairCache.h"
+#include "LinearMath/btThreads.h"
+
+///btOpenAddressingPairCache is a drop-in replacement for btHashedOverlappingPairCache.
+///The pairs are kept in the same dense array, so iteration order and swap-back removal are unchanged,
+///but they are looked up through one flat Robin Hood hash table of 8 byte slots, a hash and a pair index.
+///Most lookups stay within one cache line of the table and only touch the pair that matches,
+///instead of following the hash table, next and pair arrays for every pair in the bucket.
+///
+///Broadphase threads can add pairs at the same time with addOverlappingPairConcurrent, which only
+///queues them per thread. flushConcurrentPairs then adds them sorted by uid, so the pair order does not
+///depend on which thread found a pair first.
+ATTRIBUTE_ALIGNED16(class)
+btOpenAddressingPairCache : public btOverlappingPairCache
+{
+	struct Slot
+	{
+		unsigned int m_hash;  // the pair is only compared when this matches
+		int m_pairIndex;      // BT_NULL_PAIR for an empty slot
+	};
+
+	btBroadphasePairArray m_overlappingPairArray;
+	Slot* m_table;
+	int m_tableSize;
+	unsigned int m_tableMask;
+	int m_tableShift;
+	btOverlapFilterCallback* m_overlapFilterCallback;
+	btOverlappingPairCallback* m_ghostPairCallback;
+
+	struct QueuedPair
+	{
+		unsigned long long m_key;
+		btBroadphaseProxy* m_proxy0;
+		btBroadphaseProxy* m_proxy1;
+	};
+	btAlignedObjectArray<QueuedPair> m_queuedPairs[BT_MAX_THREAD_COUNT];
+	btAlignedObjectArray<QueuedPair> m_flushPairs;
+
+	static unsigned long long getKey(const btBroadphaseProxy* proxy0, const btBroadphaseProxy* proxy1)
+	{
+		return ((unsigned long long)(unsigned int)proxy0->getUid() << 32) | (unsigned int)proxy1->getUid();
+	}
+
+	// Fibonacci hashing, the high bits of the product are well mixed and the top ones pick the slot
+	static unsigned int getHash(unsigned long long key)
+	{
+		return (unsigned int)((key * 11400714819323198485ull) >> 32);
+	}
+
+	// how far the slot is from where its pair hashes to
+	unsigned int getDistance(const Slot& s, unsigned int slot) const
+	{
+		return (slot - (s.m_hash >> m_tableShift)) & m_tableMask;
+	}
+
+	// returns the slot of the pair or BT_NULL_PAIR, slot and distance are where the search stopped
+	int findSlot(unsigned int hash, const btBroadphaseProxy* proxy0, const btBroadphaseProxy* proxy1, unsigned int& slot, unsigned int& distance) const;
+	int findSlot(unsigned int hash, const btBroadphaseProxy* proxy0, const btBroadphaseProxy* proxy1) const;
+	void insertSlot(unsigned int hash, int pairIndex, unsigned int slot, unsigned int distance);
+	void eraseSlot(int slot);
+	void growTable();
+
+	btBroadphasePair* internalAddPair(btBroadphaseProxy * proxy0, btBroadphaseProxy * proxy1);
+
+public:
+	BT_DECLARE_ALIGNED_ALLOCATOR();
+
+	btOpenAddressingPairCache();
+	virtual ~btOpenAddressingPairCache();
+
+	void removeOverlappingPairsContainingProxy(btBroadphaseProxy * proxy, btDispatcher * dispatcher);
+
+	virtual void* removeOverlappingPair(btBroadphaseProxy * proxy0, btBroadphaseProxy * proxy1, btDispatcher * dispatcher);
+
+	SIMD_FORCE_INLINE bool needsBroadphaseCollision(btBroadphaseProxy * proxy0, btBroadphaseProxy * proxy1) const
+	{
+		if (m_overlapFilterCallback)
+			return m_overlapFilterCallback->needBroadphaseCollision(proxy0, proxy1);
+
+		bool collides = (proxy0->m_collisionFilterGroup & proxy1->m_collisionFilterMask) != 0;
+		collides = collides && (proxy1->m_collisionFilterGroup & proxy0->m_collisionFilterMask);
+
+		return collides;
+	}
+
+	// Add a pair and return the new pair. If the pair already exists,
+	// no new pair is created and the old one is returned.
+	virtual btBroadphasePair* addOverlappingPair(btBroadphaseProxy * proxy0, btBroadphaseProxy * proxy1)
+	{
+		if (!needsBroadphaseCollision(proxy0, proxy1))
+			return 0;
+
+		return internalAddPair(proxy0, proxy1);
+	}
+
+	// Thread safe: queues the pair for flushConcurrentPairs, the pair array does not change until then.
+	// Each thread must have its own thread index, as for btParallelFor bodies
+	void addOverlappingPairConcurrent(btBroadphaseProxy * proxy0, btBroadphaseProxy * proxy1);
+
+	// Adds the queued pairs in uid order and skips the ones already there, call from one thread only
+	void flushConcurrentPairs();
+
+	void cleanProxyFromPairs(btBroadphaseProxy * proxy, btDispatcher * dispatcher);
+
+	virtual void processAllOverlappingPairs(btOverlapCallback*, btDispatcher * dispatcher);
+
+	virtual void processAllOverlappingPairs(btOverlapCallback * callback, btDispatcher * dispatcher, const struct btDispatcherInfo& dispatchInfo);
+
+	virtual btBroadphasePair* getOverlappingPairArrayPtr()
+	{
+		return &m_overlappingPairArray[0];
+	}
+
+	const btBroadphasePair* getOverlappingPairArrayPtr() const
+	{
+		return &m_overlappingPairArray[0];
+	}
+
+	btBroadphasePairArray& getOverlappingPairArray()
+	{
+		return m_overlappingPairArray;
+	}
+
+	const btBroadphasePairArray& getOverlappingPairArray() const
+	{
+		return m_overlappingPairArray;
+	}
+
+	void cleanOverlappingPair(btBroadphasePair & pair, btDispatcher * dispatcher);
+
+	btBroadphasePair* findPair(btBroadphaseProxy * proxy0, btBroadphaseProxy * proxy1);
+
+	btOverlapFilterCallback* getOverlapFilterCallback()
+	{
+		return m_overlapFilterCallback;
+	}
+
+	void setOverlapFilterCallback(btOverlapFilterCallback * callback)
+	{
+		m_overlapFilterCallback = callback;
+	}
+
+	int getNumOverlappingPairs() const
+	{
+		return m_overlappingPairArray.size();
+	}
+
+	virtual bool hasDeferredRemoval()
+	{
+		return false;
+	}
+
+	virtual void setInternalGhostPairCallback(btOverlappingPairCallback * ghostPairCallback)
+	{
+		m_ghostPairCallback = ghostPairCallback;
+	}
+
+	virtual void sortOverlappingPairs(btDispatcher * dispatcher);
+};
+
+#endif  //BT_OPEN_ADDRESSING_PAIR_CACHE_H
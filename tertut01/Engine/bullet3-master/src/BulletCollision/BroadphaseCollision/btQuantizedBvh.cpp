@@ -18,6 +18,7 @@ subject to the following restrictions:
 #include "LinearMath/btAabbUtil2.h"
 #include "LinearMath/btIDebugDraw.h"
 #include "LinearMath/btSerializer.h"
+#include "LinearMath/btThreads.h"
 
 #define RAYAABB2
 
@@ -68,6 +69,32 @@ void btQuantizedBvh::buildInternal()
 	m_leafNodes.clear();
 }
 
+void btQuantizedBvh::buildInternalSAH()
+{
+	///assumes that caller filled in the m_quantizedLeafNodes
+	m_useQuantization = true;
+	int numLeafNodes = m_quantizedLeafNodes.size();
+
+	m_quantizedContiguousNodes.resize(2 * numLeafNodes);
+
+	buildTreeSAH(numLeafNodes);
+
+	///if the entire tree is small then subtree size, we need to create a header info for the tree
+	if (!m_SubtreeHeaders.size())
+	{
+		btBvhSubtreeInfo& subtree = m_SubtreeHeaders.expand();
+		subtree.setAabbFromQuantizeNode(m_quantizedContiguousNodes[0]);
+		subtree.m_rootNodeIndex = 0;
+		subtree.m_subtreeSize = m_quantizedContiguousNodes[0].isLeafNode() ? 1 : m_quantizedContiguousNodes[0].getEscapeIndex();
+	}
+
+	//PCK: update the copy of the size
+	m_subtreeHeaderCount = m_SubtreeHeaders.size();
+
+	m_quantizedLeafNodes.clear();
+	m_leafNodes.clear();
+}
+
 ///just for debugging, to visualize the individual patches/subtrees
 #ifdef DEBUG_PATCH_COLORS
 btVector3 color[4] =
@@ -309,6 +336,326 @@ int btQuantizedBvh::calcSplittingAxis(int startIndex, int endIndex)
 	return variance.maxAxis();
 }
 
+//
+// Binned SAH build
+//
+
+struct btQuantizedBvhSAHBuilder : public btIParallelForBody
+{
+	enum
+	{
+		BINCOUNT = 16,
+		// deeper ranges split at the mean like buildTree, which keeps the depth logarithmic on odd inputs
+		MAX_SAH_DEPTH = 64
+	};
+	struct Subtree
+	{
+		int m_begin;
+		int m_end;
+		int m_nodeIndex;
+		int m_depth;
+	};
+	// Leaves [b,e) go into the 2*(e-b)-1 nodes from nodeIndex on, in the depth first order of buildTree. A split at m
+	// puts the left half right after nodeIndex and the right half at nodeIndex+2*(m-b), so every subtree owns its nodes
+	// and its leaves, and can be built on any thread
+	btQuantizedBvhNode* m_leaves;
+	btQuantizedBvhNode* m_nodes;
+	btScalar m_stepSize[3];  // world size of one quantization step on each axis
+	int m_deferSize;
+	btAlignedObjectArray<Subtree> m_subtrees;
+	btAlignedObjectArray<int> m_topNodes;
+
+	btQuantizedBvhSAHBuilder(btQuantizedBvhNode* leaves, btQuantizedBvhNode* nodes, const btVector3& quantization)
+		: m_leaves(leaves), m_nodes(nodes), m_deferSize(0)
+	{
+		for (int i = 0; i < 3; i++)
+		{
+			m_stepSize[i] = btScalar(1.) / quantization[i];
+		}
+	}
+
+	static int numBuildThreads()
+	{
+#if BT_THREADSAFE
+		btITaskScheduler* scheduler = btGetTaskScheduler();
+		return scheduler ? scheduler->getNumThreads() : 1;
+#else
+		return 1;
+#endif
+	}
+
+	// doubled center, which is all the binning needs
+	static int center(const btQuantizedBvhNode& node, int axis)
+	{
+		return int(node.m_quantizedAabbMin[axis]) + int(node.m_quantizedAabbMax[axis]);
+	}
+
+	static void merge(btQuantizedBvhNode& node, const btQuantizedBvhNode& other)
+	{
+		for (int i = 0; i < 3; i++)
+		{
+			node.m_quantizedAabbMin[i] = btMin(node.m_quantizedAabbMin[i], other.m_quantizedAabbMin[i]);
+			node.m_quantizedAabbMax[i] = btMax(node.m_quantizedAabbMax[i], other.m_quantizedAabbMax[i]);
+		}
+	}
+
+	// half the surface area, the chance of a query hitting the node is proportional to it
+	btScalar area(const btQuantizedBvhNode& node) const
+	{
+		btScalar size[3];
+		for (int i = 0; i < 3; i++)
+		{
+			size[i] = btScalar(node.m_quantizedAabbMax[i] - node.m_quantizedAabbMin[i]) * m_stepSize[i];
+		}
+		return size[0] * size[1] + size[1] * size[2] + size[2] * size[0];
+	}
+
+	static int binOf(int c, int cmin, int extent)
+	{
+		return int((long long)(c - cmin) * BINCOUNT / (extent + 1));
+	}
+
+	// the split of buildTree: at the mean center on the axis, or in the middle when that is too unbalanced
+	int meanSplit(int b, int e, int axis) const
+	{
+		long long sum = 0;
+		for (int i = b; i < e; i++)
+		{
+			sum += center(m_leaves[i], axis);
+		}
+		const long long mean = sum / (e - b);
+		int m = b;
+		for (int i = b; i < e; i++)
+		{
+			if (center(m_leaves[i], axis) > mean)
+			{
+				btSwap(m_leaves[i], m_leaves[m++]);
+			}
+		}
+		const int rangeBalancedIndices = (e - b) / 3;
+		if ((m <= (b + rangeBalancedIndices)) || (m >= (e - 1 - rangeBalancedIndices)))
+		{
+			m = b + ((e - b) >> 1);
+		}
+		return m;
+	}
+
+	// returns where [b,e) is split, after moving the leaves of the left half to the front
+	int partition(int b, int e, int depth) const
+	{
+		int cmin[3], cmax[3];
+		for (int axis = 0; axis < 3; axis++)
+		{
+			cmin[axis] = cmax[axis] = center(m_leaves[b], axis);
+		}
+		for (int i = b + 1; i < e; i++)
+		{
+			for (int axis = 0; axis < 3; axis++)
+			{
+				const int c = center(m_leaves[i], axis);
+				cmin[axis] = btMin(cmin[axis], c);
+				cmax[axis] = btMax(cmax[axis], c);
+			}
+		}
+		if (depth >= MAX_SAH_DEPTH)
+		{
+			int axis = 0;
+			for (int i = 1; i < 3; i++)
+			{
+				if ((cmax[i] - cmin[i]) * m_stepSize[i] > (cmax[axis] - cmin[axis]) * m_stepSize[axis])
+					axis = i;
+			}
+			return meanSplit(b, e, axis);
+		}
+
+		// bin the leaves on all three axes in one pass
+		int counts[3][BINCOUNT];
+		btQuantizedBvhNode bins[3][BINCOUNT];
+		for (int axis = 0; axis < 3; axis++)
+		{
+			for (int bin = 0; bin < BINCOUNT; bin++)
+			{
+				counts[axis][bin] = 0;
+			}
+		}
+		for (int i = b; i < e; i++)
+		{
+			const btQuantizedBvhNode& leaf = m_leaves[i];
+			for (int axis = 0; axis < 3; axis++)
+			{
+				const int bin = binOf(center(leaf, axis), cmin[axis], cmax[axis] - cmin[axis]);
+				if (counts[axis][bin]++)
+					merge(bins[axis][bin], leaf);
+				else
+					bins[axis][bin] = leaf;
+			}
+		}
+
+		int bestAxis = -1;
+		int bestPlane = -1;
+		btScalar bestCost = SIMD_INFINITY;
+		for (int axis = 0; axis < 3; axis++)
+		{
+			if (cmax[axis] == cmin[axis])
+				continue;
+			// sweep from the right to get the cost of everything right of each plane, then from the left
+			btScalar rightCosts[BINCOUNT];
+			btQuantizedBvhNode right;
+			int rightCount = 0;
+			for (int bin = BINCOUNT - 1; bin > 0; bin--)
+			{
+				if (counts[axis][bin])
+				{
+					if (rightCount)
+						merge(right, bins[axis][bin]);
+					else
+						right = bins[axis][bin];
+					rightCount += counts[axis][bin];
+				}
+				rightCosts[bin] = rightCount ? area(right) * rightCount : 0;
+			}
+			btQuantizedBvhNode left;
+			int leftCount = 0;
+			for (int bin = 0; bin < BINCOUNT - 1; bin++)
+			{
+				if (counts[axis][bin])
+				{
+					if (leftCount)
+						merge(left, bins[axis][bin]);
+					else
+						left = bins[axis][bin];
+					leftCount += counts[axis][bin];
+				}
+				if (leftCount == 0 || leftCount == e - b)
+					continue;
+				const btScalar cost = area(left) * leftCount + rightCosts[bin + 1];
+				if (cost < bestCost)
+				{
+					bestCost = cost;
+					bestAxis = axis;
+					bestPlane = bin;
+				}
+			}
+		}
+		if (bestAxis < 0)
+		{
+			// all centers coincide
+			return b + ((e - b) >> 1);
+		}
+		int m = b;
+		for (int i = b; i < e; i++)
+		{
+			if (binOf(center(m_leaves[i], bestAxis), cmin[bestAxis], cmax[bestAxis] - cmin[bestAxis]) <= bestPlane)
+			{
+				btSwap(m_leaves[i], m_leaves[m++]);
+			}
+		}
+		btAssert(m > b && m < e);
+		return m;
+	}
+
+	void setInternalNode(int nodeIndex, int numLeaves) const
+	{
+		const int leftIndex = nodeIndex + 1;
+		const btQuantizedBvhNode& leftNode = m_nodes[leftIndex];
+		const int rightIndex = leftIndex + (leftNode.isLeafNode() ? 1 : leftNode.getEscapeIndex());
+		btQuantizedBvhNode& node = m_nodes[nodeIndex];
+		node = leftNode;
+		merge(node, m_nodes[rightIndex]);
+		node.m_escapeIndexOrTriangleIndex = -(2 * numLeaves - 1);
+	}
+
+	void buildSubtree(int b, int e, int nodeIndex, int depth) const
+	{
+		if (e - b == 1)
+		{
+			m_nodes[nodeIndex] = m_leaves[b];
+			return;
+		}
+		const int m = partition(b, e, depth);
+		buildSubtree(b, m, nodeIndex + 1, depth + 1);
+		buildSubtree(m, e, nodeIndex + 2 * (m - b), depth + 1);
+		setInternalNode(nodeIndex, e - b);
+	}
+
+	// like buildSubtree, but only records ranges smaller than m_deferSize so forLoop can build them later.
+	// The nodes above them are set once they are done
+	void buildTop(int b, int e, int nodeIndex, int depth)
+	{
+		if (e - b == 1)
+		{
+			m_nodes[nodeIndex] = m_leaves[b];
+			return;
+		}
+		if (nodeIndex > 0 && e - b < m_deferSize)
+		{
+			Subtree subtree = {b, e, nodeIndex, depth};
+			m_subtrees.push_back(subtree);
+			return;
+		}
+		const int m = partition(b, e, depth);
+		m_topNodes.push_back(nodeIndex);
+		m_topNodes.push_back(e - b);
+		buildTop(b, m, nodeIndex + 1, depth + 1);
+		buildTop(m, e, nodeIndex + 2 * (m - b), depth + 1);
+	}
+
+	void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
+	{
+		for (int i = iBegin; i < iEnd; i++)
+		{
+			const Subtree& subtree = m_subtrees[i];
+			buildSubtree(subtree.m_begin, subtree.m_end, subtree.m_nodeIndex, subtree.m_depth);
+		}
+	}
+};
+
+void btQuantizedBvh::buildTreeSAH(int numLeafNodes)
+{
+	btAssert(m_useQuantization);
+	btAssert(numLeafNodes > 0);
+
+	btQuantizedBvhSAHBuilder builder(&m_quantizedLeafNodes[0], &m_quantizedContiguousNodes[0], m_bvhQuantization);
+	const int numThreads = btQuantizedBvhSAHBuilder::numBuildThreads();
+	if (numThreads <= 1)
+	{
+		builder.buildSubtree(0, numLeafNodes, 0, 0);
+	}
+	else
+	{
+		// a few ranges per thread to even out the load, but not so small that scheduling costs more than building
+		builder.m_deferSize = btMax(numLeafNodes / (numThreads * 4), 1024);
+		builder.buildTop(0, numLeafNodes, 0, 0);
+		btParallelFor(0, builder.m_subtrees.size(), 1, builder);
+		// parents were recorded before their children
+		for (int i = builder.m_topNodes.size() - 2; i >= 0; i -= 2)
+		{
+			builder.setInternalNode(builder.m_topNodes[i], builder.m_topNodes[i + 1]);
+		}
+	}
+	m_curNodeIndex = 2 * numLeafNodes - 1;
+
+	buildSubtreeHeaders(0);
+}
+
+void btQuantizedBvh::buildSubtreeHeaders(int nodeIndex)
+{
+	const btQuantizedBvhNode& node = m_quantizedContiguousNodes[nodeIndex];
+	if (node.isLeafNode())
+		return;
+	// smaller subtrees have no headers below them either
+	const int escapeIndex = node.getEscapeIndex();
+	if (escapeIndex * static_cast<int>(sizeof(btQuantizedBvhNode)) <= MAX_SUBTREE_SIZE_IN_BYTES)
+		return;
+
+	const int leftChildNodexIndex = nodeIndex + 1;
+	const btQuantizedBvhNode& leftChildNode = m_quantizedContiguousNodes[leftChildNodexIndex];
+	const int rightChildNodexIndex = leftChildNodexIndex + (leftChildNode.isLeafNode() ? 1 : leftChildNode.getEscapeIndex());
+	buildSubtreeHeaders(leftChildNodexIndex);
+	buildSubtreeHeaders(rightChildNodexIndex);
+	updateSubtreeHeaders(leftChildNodexIndex, rightChildNodexIndex);
+}
+
 void btQuantizedBvh::reportAabbOverlappingNodex(btNodeOverlapCallback* nodeCallback, const btVector3& aabbMin, const btVector3& aabbMax) const
 {
 	//either choose recursive traversal (walkTree) or stackless (walkStacklessTree)
@@ -1108,6 +1455,55 @@ btQuantizedBvh* btQuantizedBvh::deSerializeInPlace(void* i_alignedDataBuffer, un
 	return bvh;
 }
 
+bool btQuantizedBvh::initializeFromMappedBuffer(const void* i_alignedDataBuffer, unsigned int i_dataBufferSize)
+{
+	if (i_alignedDataBuffer == NULL || (size_t(i_alignedDataBuffer) & 15) != 0 || i_dataBufferSize < sizeof(btQuantizedBvh))
+	{
+		return false;
+	}
+	// only the plain members of the serialized header are read, its array pointers were cleared by serialize
+	const btQuantizedBvh* image = static_cast<const btQuantizedBvh*>(i_alignedDataBuffer);
+	const int nodeCount = image->m_curNodeIndex;
+	const int subtreeHeaderCount = image->m_subtreeHeaderCount;
+	const bool useQuantization = image->m_useQuantization;
+	if (nodeCount <= 0 || subtreeHeaderCount < 0)
+	{
+		return false;
+	}
+	const unsigned long long nodeSize = useQuantization ? sizeof(btQuantizedBvhNode) : sizeof(btOptimizedBvhNode);
+	const unsigned long long requiredSize = sizeof(btQuantizedBvh) + nodeSize * nodeCount + sizeof(btBvhSubtreeInfo) * subtreeHeaderCount;
+	if (requiredSize > i_dataBufferSize)
+	{
+		return false;
+	}
+
+	m_bvhAabbMin = image->m_bvhAabbMin;
+	m_bvhAabbMax = image->m_bvhAabbMax;
+	m_bvhQuantization = image->m_bvhQuantization;
+	m_curNodeIndex = nodeCount;
+	m_useQuantization = useQuantization;
+	m_traversalMode = image->m_traversalMode;
+	m_subtreeHeaderCount = subtreeHeaderCount;
+	m_leafNodes.clear();
+	m_quantizedLeafNodes.clear();
+
+	// the arrays do not own the buffer, and nothing but refit writes to them after this
+	unsigned char* nodeData = (unsigned char*)const_cast<void*>(i_alignedDataBuffer) + sizeof(btQuantizedBvh);
+	if (useQuantization)
+	{
+		m_contiguousNodes.clear();
+		m_quantizedContiguousNodes.initializeFromBuffer(nodeData, nodeCount, nodeCount);
+	}
+	else
+	{
+		m_quantizedContiguousNodes.clear();
+		m_contiguousNodes.initializeFromBuffer(nodeData, nodeCount, nodeCount);
+	}
+	nodeData += nodeSize * nodeCount;
+	m_SubtreeHeaders.initializeFromBuffer(nodeData, subtreeHeaderCount, subtreeHeaderCount);
+	return true;
+}
+
 // Constructor that prevents btVector3's default constructor from being called
 btQuantizedBvh::btQuantizedBvh(btQuantizedBvh& self, bool /* ownsMemory */) : m_bvhAabbMin(self.m_bvhAabbMin),
 																			  m_bvhAabbMax(self.m_bvhAabbMax),
@@ -1258,6 +1654,70 @@ void btQuantizedBvh::deSerializeDouble(struct btQuantizedBvhDoubleData& quantize
 	}
 }
 
+static bool btQuantizedBvhNodesAreMappable(int useQuantization, const btQuantizedBvhNodeData* nodes, int numNodes)
+{
+	return useQuantization && numNodes > 0 && nodes && (size_t(nodes) & 15) == 0;
+}
+
+void btQuantizedBvh::initializeMappedNodes(const btQuantizedBvhNodeData* nodes, int numNodes, const btBvhSubtreeInfoData* subtreeHeaders, int numSubtreeHeaders)
+{
+	btAssert(sizeof(btQuantizedBvhNodeData) == sizeof(btQuantizedBvhNode));
+	m_leafNodes.clear();
+	m_quantizedLeafNodes.clear();
+	m_contiguousNodes.clear();
+	// the array does not own the nodes, and nothing but refit writes to them
+	m_quantizedContiguousNodes.initializeFromBuffer(const_cast<btQuantizedBvhNodeData*>(nodes), numNodes, numNodes);
+
+	// the file layout of the subtree headers differs from btBvhSubtreeInfo, and there are few of them
+	m_SubtreeHeaders.resize(numSubtreeHeaders);
+	for (int i = 0; i < numSubtreeHeaders; i++)
+	{
+		const btBvhSubtreeInfoData& header = subtreeHeaders[i];
+		for (int k = 0; k < 3; k++)
+		{
+			m_SubtreeHeaders[i].m_quantizedAabbMin[k] = header.m_quantizedAabbMin[k];
+			m_SubtreeHeaders[i].m_quantizedAabbMax[k] = header.m_quantizedAabbMax[k];
+		}
+		m_SubtreeHeaders[i].m_rootNodeIndex = header.m_rootNodeIndex;
+		m_SubtreeHeaders[i].m_subtreeSize = header.m_subtreeSize;
+	}
+	m_subtreeHeaderCount = numSubtreeHeaders;
+}
+
+bool btQuantizedBvh::initializeFromMappedData(const btQuantizedBvhFloatData& quantizedBvhFloatData)
+{
+	if (!btQuantizedBvhNodesAreMappable(quantizedBvhFloatData.m_useQuantization, quantizedBvhFloatData.m_quantizedContiguousNodesPtr, quantizedBvhFloatData.m_numQuantizedContiguousNodes))
+	{
+		return false;
+	}
+	m_bvhAabbMax.deSerializeFloat(quantizedBvhFloatData.m_bvhAabbMax);
+	m_bvhAabbMin.deSerializeFloat(quantizedBvhFloatData.m_bvhAabbMin);
+	m_bvhQuantization.deSerializeFloat(quantizedBvhFloatData.m_bvhQuantization);
+	m_curNodeIndex = quantizedBvhFloatData.m_curNodeIndex;
+	m_useQuantization = true;
+	m_traversalMode = btTraversalMode(quantizedBvhFloatData.m_traversalMode);
+	initializeMappedNodes(quantizedBvhFloatData.m_quantizedContiguousNodesPtr, quantizedBvhFloatData.m_numQuantizedContiguousNodes,
+						  quantizedBvhFloatData.m_subTreeInfoPtr, quantizedBvhFloatData.m_numSubtreeHeaders);
+	return true;
+}
+
+bool btQuantizedBvh::initializeFromMappedData(const btQuantizedBvhDoubleData& quantizedBvhDoubleData)
+{
+	if (!btQuantizedBvhNodesAreMappable(quantizedBvhDoubleData.m_useQuantization, quantizedBvhDoubleData.m_quantizedContiguousNodesPtr, quantizedBvhDoubleData.m_numQuantizedContiguousNodes))
+	{
+		return false;
+	}
+	m_bvhAabbMax.deSerializeDouble(quantizedBvhDoubleData.m_bvhAabbMax);
+	m_bvhAabbMin.deSerializeDouble(quantizedBvhDoubleData.m_bvhAabbMin);
+	m_bvhQuantization.deSerializeDouble(quantizedBvhDoubleData.m_bvhQuantization);
+	m_curNodeIndex = quantizedBvhDoubleData.m_curNodeIndex;
+	m_useQuantization = true;
+	m_traversalMode = btTraversalMode(quantizedBvhDoubleData.m_traversalMode);
+	initializeMappedNodes(quantizedBvhDoubleData.m_quantizedContiguousNodesPtr, quantizedBvhDoubleData.m_numQuantizedContiguousNodes,
+						  quantizedBvhDoubleData.m_subTreeInfoPtr, quantizedBvhDoubleData.m_numSubtreeHeaders);
+	return true;
+}
+
 ///fills the dataBuffer and returns the struct name (and 0 on failure)
 const char* btQuantizedBvh::serialize(void* dataBuffer, btSerializer* serializer) const
 {
@@ -307,6 +307,12 @@ protected:
 
 	void updateSubtreeHeaders(int leftChildNodexIndex, int rightChildNodexIndex);
 
+	///builds the quantized nodes like buildTree(0, numLeafNodes), but with a binned surface area heuristic
+	void buildTreeSAH(int numLeafNodes);
+
+	///adds the subtree headers below nodeIndex in the same order as buildTree does
+	void buildSubtreeHeaders(int nodeIndex);
+
 public:
 	BT_DECLARE_ALIGNED_ALLOCATOR();
 
@@ -319,6 +325,10 @@ public:
 	QuantizedNodeArray& getLeafNodeArray() { return m_quantizedLeafNodes; }
 	///buildInternal is expert use only: assumes that setQuantizationValues and LeafNodeArray are initialized
 	void buildInternal();
+	///buildInternalSAH is like buildInternal, but splits with a binned surface area heuristic instead of at the mean of the axis
+	///with the largest variance, and builds subtrees in parallel when a task scheduler with several threads is set.
+	///The nodes have the same format, so traversal and serialization do not change, queries just visit fewer of them
+	void buildInternalSAH();
 	///***************************************** expert/internal use only *************************
 
 	void reportAabbOverlappingNodex(btNodeOverlapCallback * nodeCallback, const btVector3& aabbMin, const btVector3& aabbMax) const;
@@ -438,6 +448,11 @@ public:
 	///deSerializeInPlace loads and initializes a BVH from a buffer in memory 'in place'
 	static btQuantizedBvh* deSerializeInPlace(void* i_alignedDataBuffer, unsigned int i_dataBufferSize, bool i_swapEndian);
 
+	///initializeFromMappedBuffer makes this BVH use the nodes of a buffer written by serialize without swapping endianness,
+	///usually a read-only file mapping (see btMappedFile). Unlike deSerializeInPlace, the buffer is neither copied nor written to.
+	///The buffer must outlive the BVH, and the BVH must not be refitted. Returns false if the buffer is misaligned or too small
+	bool initializeFromMappedBuffer(const void* i_alignedDataBuffer, unsigned int i_dataBufferSize);
+
 	static unsigned int getAlignmentSerializationPadding();
 	//////////////////////////////////////////////////////////////////////
 
@@ -450,6 +465,13 @@ public:
 
 	virtual void deSerializeDouble(struct btQuantizedBvhDoubleData & quantizedBvhDoubleData);
 
+	///initializeFromMappedData works like deSerializeFloat, but the quantized nodes are used where they are instead of copied,
+	///for example in a file loaded with btBulletWorldImporter::loadFileMapped. The data must outlive the BVH.
+	///Returns false and leaves the BVH alone if the tree is not quantized or its nodes are not 16 byte aligned
+	bool initializeFromMappedData(const struct btQuantizedBvhFloatData& quantizedBvhFloatData);
+
+	bool initializeFromMappedData(const struct btQuantizedBvhDoubleData& quantizedBvhDoubleData);
+
 	////////////////////////////////////////////////////////////////////
 
 	SIMD_FORCE_INLINE bool isQuantized()
@@ -462,6 +484,8 @@ private:
 	// Prevents btVector3's default constructor from being called, but doesn't inialize much else
 	// ownsMemory should most likely be false if deserializing, and if you are not, don't call this (it also changes the function signature, which we need)
 	btQuantizedBvh(btQuantizedBvh & other, bool ownsMemory);
+
+	void initializeMappedNodes(const struct btQuantizedBvhNodeData* nodes, int numNodes, const struct btBvhSubtreeInfoData* subtreeHeaders, int numSubtreeHeaders);
 };
 
 // clang-format off
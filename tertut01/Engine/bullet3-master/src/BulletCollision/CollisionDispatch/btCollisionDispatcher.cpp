@@ -24,6 +24,10 @@ subject to the following restrictions:
 #include "LinearMath/btPoolAllocator.h"
 #include "BulletCollision/CollisionDispatch/btCollisionConfiguration.h"
 #include "BulletCollision/CollisionDispatch/btCollisionObjectWrapper.h"
+#include "BulletCollision/CollisionDispatch/btConvexConvexAlgorithm.h"
+#include "BulletCollision/CollisionShapes/btConvexShape.h"
+#include "BulletCollision/NarrowPhaseCollision/btGjkPairBatch.h"
+#include "LinearMath/btThreads.h"
 
 #ifdef BT_DEBUG
 #include <stdio.h>
@@ -40,6 +44,11 @@ btCollisionDispatcher::btCollisionDispatcher(btCollisionConfiguration* collision
 
 	m_persistentManifoldPoolAllocator = collisionConfiguration->getPersistentManifoldPool();
 
+	for (i = 0; i < int(BT_MAX_THREAD_COUNT); i++)
+	{
+		m_transientScopes[i].m_depth = 0;
+	}
+
 	for (i = 0; i < MAX_BROADPHASE_COLLISION_TYPES; i++)
 	{
 		for (int j = 0; j < MAX_BROADPHASE_COLLISION_TYPES; j++)
@@ -219,14 +228,165 @@ void btCollisionDispatcher::dispatchAllCollisionPairs(btOverlappingPairCache* pa
 
 	btCollisionPairCallback collisionCallback(dispatchInfo, this);
 
+	batchConvexConvexPairs(pairCache, dispatchInfo);
 	{
 		BT_PROFILE("processAllOverlappingPairs");
 		pairCache->processAllOverlappingPairs(&collisionCallback, dispatcher, dispatchInfo);
 	}
+	clearConvexConvexBatch();
 
 	//m_blockedForChanges = false;
 }
 
+// the batch groups of btGjkPairBatch, index of box, sphere, capsule and convex hull shapes
+static int btGetConvexBatchShapeIndex(int shapeType)
+{
+	switch (shapeType)
+	{
+		case BOX_SHAPE_PROXYTYPE:
+			return 0;
+		case SPHERE_SHAPE_PROXYTYPE:
+			return 1;
+		case CAPSULE_SHAPE_PROXYTYPE:
+			return 2;
+		case CONVEX_HULL_SHAPE_PROXYTYPE:
+			return 3;
+		default:
+			return -1;
+	}
+}
+
+struct btConvexConvexBatchLoop : public btIParallelForBody
+{
+	btBroadphasePair* const* m_pairs;
+	const int* m_groupStarts;
+
+	void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
+	{
+		btGjkPairBatch batch;
+		for (int group = iBegin; group < iEnd; ++group)
+		{
+			const int firstPair = m_groupStarts[group];
+			const int numLanes = m_groupStarts[group + 1] - firstPair;
+			for (int lane = 0; lane < numLanes; ++lane)
+			{
+				const btBroadphasePair& pair = *m_pairs[firstPair + lane];
+				const btCollisionObject* colObj0 = static_cast<const btCollisionObject*>(pair.m_pProxy0->m_clientObject);
+				const btCollisionObject* colObj1 = static_cast<const btCollisionObject*>(pair.m_pProxy1->m_clientObject);
+				btConvexConvexAlgorithm* algorithm = static_cast<btConvexConvexAlgorithm*>(pair.m_algorithm);
+				batch.setPair(lane, static_cast<const btConvexShape*>(colObj0->getCollisionShape()), colObj0->getWorldTransform(),
+							  static_cast<const btConvexShape*>(colObj1->getCollisionShape()), colObj1->getWorldTransform(),
+							  algorithm->getCachedSeparatingAxis(), algorithm->getManifold()->getContactBreakingThreshold());
+			}
+			batch.computeSeparation(numLanes);
+			for (int lane = 0; lane < numLanes; ++lane)
+			{
+				btConvexConvexAlgorithm* algorithm = static_cast<btConvexConvexAlgorithm*>(m_pairs[firstPair + lane]->m_algorithm);
+				algorithm->setBatchSeparated(batch.isSeparated(lane), batch.getSeparatingAxis(lane));
+			}
+		}
+	}
+};
+
+void btCollisionDispatcher::batchConvexConvexPairs(btOverlappingPairCache* pairCache, const btDispatcherInfo& dispatchInfo)
+{
+	m_batchPairs.resize(0);
+	if (!(m_dispatcherFlags & CD_BATCH_CONVEX_CONVEX_PAIRS) || dispatchInfo.m_dispatchFunc != btDispatcherInfo::DISPATCH_DISCRETE ||
+		m_nearCallback != defaultNearCallback || pairCache->getNumOverlappingPairs() == 0)
+	{
+		return;
+	}
+	BT_PROFILE("batchConvexConvexPairs");
+
+	enum
+	{
+		NUM_SHAPE_INDICES = 4
+	};
+	btCollisionAlgorithmCreateFunc* convexConvexCreateFunc = m_collisionConfiguration->getCollisionAlgorithmCreateFunc(CONVEX_HULL_SHAPE_PROXYTYPE, CONVEX_HULL_SHAPE_PROXYTYPE);
+	int groupSizes[NUM_SHAPE_INDICES * NUM_SHAPE_INDICES] = {0};
+
+	m_batchCandidatePairs.resize(0);
+	m_batchCandidateTypes.resize(0);
+	btBroadphasePair* pairs = pairCache->getOverlappingPairArrayPtr();
+	const int numPairs = pairCache->getNumOverlappingPairs();
+	for (int i = 0; i < numPairs; ++i)
+	{
+		btBroadphasePair& pair = pairs[i];
+		if (!pair.m_algorithm)
+		{
+			continue;
+		}
+		const btCollisionObject* colObj0 = static_cast<const btCollisionObject*>(pair.m_pProxy0->m_clientObject);
+		const btCollisionObject* colObj1 = static_cast<const btCollisionObject*>(pair.m_pProxy1->m_clientObject);
+		const int shapeType0 = colObj0->getCollisionShape()->getShapeType();
+		const int shapeType1 = colObj1->getCollisionShape()->getShapeType();
+		const int index0 = btGetConvexBatchShapeIndex(shapeType0);
+		const int index1 = btGetConvexBatchShapeIndex(shapeType1);
+		if (index0 < 0 || index1 < 0 || m_doubleDispatchContactPoints[shapeType0][shapeType1] != convexConvexCreateFunc)
+		{
+			continue;
+		}
+		//btConvexConvexAlgorithm has closed form distances between capsules and spheres
+		if ((shapeType0 == CAPSULE_SHAPE_PROXYTYPE || shapeType0 == SPHERE_SHAPE_PROXYTYPE) &&
+			(shapeType1 == CAPSULE_SHAPE_PROXYTYPE || shapeType1 == SPHERE_SHAPE_PROXYTYPE))
+		{
+			continue;
+		}
+		if (!static_cast<btConvexConvexAlgorithm*>(pair.m_algorithm)->isBatchable() || !needsCollision(colObj0, colObj1))
+		{
+			continue;
+		}
+		const int group = index0 * NUM_SHAPE_INDICES + index1;
+		m_batchCandidatePairs.push_back(&pair);
+		m_batchCandidateTypes.push_back(group);
+		groupSizes[group]++;
+	}
+	if (m_batchCandidatePairs.size() == 0)
+	{
+		return;
+	}
+
+	//sort the pairs by shape types, each batch has up to four pairs of the same types
+	int groupOffsets[NUM_SHAPE_INDICES * NUM_SHAPE_INDICES];
+	int offset = 0;
+	m_batchGroupStarts.resize(0);
+	for (int group = 0; group < NUM_SHAPE_INDICES * NUM_SHAPE_INDICES; ++group)
+	{
+		groupOffsets[group] = offset;
+		for (int start = 0; start < groupSizes[group]; start += btGjkPairBatch::MAX_LANES)
+		{
+			m_batchGroupStarts.push_back(offset + start);
+		}
+		offset += groupSizes[group];
+	}
+	m_batchGroupStarts.push_back(offset);
+	m_batchPairs.resizeNoInitialize(m_batchCandidatePairs.size());
+	for (int i = 0; i < m_batchCandidatePairs.size(); ++i)
+	{
+		m_batchPairs[groupOffsets[m_batchCandidateTypes[i]]++] = m_batchCandidatePairs[i];
+	}
+
+	btConvexConvexBatchLoop loop;
+	loop.m_pairs = &m_batchPairs[0];
+	loop.m_groupStarts = &m_batchGroupStarts[0];
+	const int numGroups = m_batchGroupStarts.size() - 1;
+#if BT_THREADSAFE
+	if (btGetTaskScheduler() && btGetTaskScheduler()->getNumThreads() > 1)
+		btParallelFor(0, numGroups, 64, loop);
+	else
+#endif
+		loop.forLoop(0, numGroups);
+}
+
+void btCollisionDispatcher::clearConvexConvexBatch()
+{
+	for (int i = 0; i < m_batchPairs.size(); ++i)
+	{
+		static_cast<btConvexConvexAlgorithm*>(m_batchPairs[i]->m_algorithm)->clearBatchSeparated();
+	}
+	m_batchPairs.resize(0);
+}
+
 //by default, Bullet will use this near callback
 void btCollisionDispatcher::defaultNearCallback(btBroadphasePair& collisionPair, btCollisionDispatcher& dispatcher, const btDispatcherInfo& dispatchInfo)
 {
@@ -267,6 +427,10 @@ void btCollisionDispatcher::defaultNearCallback(btBroadphasePair& collisionPair,
 
 void* btCollisionDispatcher::allocateCollisionAlgorithm(int size)
 {
+	if ((m_dispatcherFlags & CD_USE_THREAD_ARENAS) && m_transientScopes[btGetCurrentThreadIndex()].m_depth > 0)
+	{
+		return btGetThreadArena()->allocate(static_cast<size_t>(size));
+	}
 	void* mem = m_collisionAlgorithmPoolAllocator->allocate(size);
 	if (NULL == mem)
 	{
@@ -282,8 +446,37 @@ void btCollisionDispatcher::freeCollisionAlgorithm(void* ptr)
 	{
 		m_collisionAlgorithmPoolAllocator->freeMemory(ptr);
 	}
+	else if ((m_dispatcherFlags & CD_USE_THREAD_ARENAS) && m_transientScopes[btGetCurrentThreadIndex()].m_depth > 0 && btGetThreadArena()->owns(ptr))
+	{
+		// released by endTransientAllocations
+	}
 	else
 	{
 		btAlignedFree(ptr);
 	}
 }
+
+void btCollisionDispatcher::beginTransientAllocations()
+{
+	if (m_dispatcherFlags & CD_USE_THREAD_ARENAS)
+	{
+		TransientScope& scope = m_transientScopes[btGetCurrentThreadIndex()];
+		if (scope.m_depth++ == 0)
+		{
+			scope.m_marker = btGetThreadArena()->getMarker();
+		}
+	}
+}
+
+void btCollisionDispatcher::endTransientAllocations()
+{
+	if (m_dispatcherFlags & CD_USE_THREAD_ARENAS)
+	{
+		TransientScope& scope = m_transientScopes[btGetCurrentThreadIndex()];
+		btAssert(scope.m_depth > 0);
+		if (--scope.m_depth == 0)
+		{
+			btGetThreadArena()->rewind(scope.m_marker);
+		}
+	}
+}
@@ -23,11 +23,13 @@ subject to the following restrictions:
 
 #include "BulletCollision/BroadphaseCollision/btBroadphaseProxy.h"
 #include "LinearMath/btAlignedObjectArray.h"
+#include "LinearMath/btStepArena.h"
 
 class btIDebugDraw;
 class btOverlappingPairCache;
 class btPoolAllocator;
 class btCollisionConfiguration;
+class btConvexConvexAlgorithm;
 
 #include "btCollisionCreateFunc.h"
 
@@ -58,12 +60,39 @@ protected:
 
 	btCollisionConfiguration* m_collisionConfiguration;
 
+	///convex pairs of the batched separation test, grouped by shape types, and the first pair of each group of up to four
+	btAlignedObjectArray<btBroadphasePair*> m_batchCandidatePairs;
+	btAlignedObjectArray<int> m_batchCandidateTypes;
+	btAlignedObjectArray<btBroadphasePair*> m_batchPairs;
+	btAlignedObjectArray<int> m_batchGroupStarts;
+
+	///marks the convex-convex pairs that are further apart than their contact breaking threshold, so their processCollision returns early
+	void batchConvexConvexPairs(btOverlappingPairCache* pairCache, const btDispatcherInfo& dispatchInfo);
+
+	///clears the marks of pairs that were not dispatched
+	void clearConvexConvexBatch();
+
+	///the open begin/endTransientAllocations calls of a thread, and the arena position at the outermost one
+	struct TransientScope
+	{
+		btStepArena::Marker m_marker;
+		int m_depth;
+	};
+	TransientScope m_transientScopes[BT_MAX_THREAD_COUNT];
+
 public:
 	enum DispatcherFlags
 	{
 		CD_STATIC_STATIC_REPORTED = 1,
 		CD_USE_RELATIVE_CONTACT_BREAKING_THRESHOLD = 2,
-		CD_DISABLE_CONTACTPOOL_DYNAMIC_ALLOCATION = 4
+		CD_DISABLE_CONTACTPOOL_DYNAMIC_ALLOCATION = 4,
+		///test box, sphere, capsule and convex hull pairs that use btConvexConvexAlgorithm four at a time (btGjkPairBatch)
+		///before the discrete dispatch, and skip the full query of pairs that are separated. Contacts are unchanged.
+		///Only applies with the default near callback
+		CD_BATCH_CONVEX_CONVEX_PAIRS = 8,
+		///allocate the collision algorithms between begin/endTransientAllocations from the arena of the thread (btGetThreadArena)
+		///instead of the collision algorithm pool, which the threads share
+		CD_USE_THREAD_ARENAS = 16
 	};
 
 	int getDispatcherFlags() const
@@ -140,6 +169,10 @@ public:
 
 	virtual void freeCollisionAlgorithm(void* ptr);
 
+	virtual void beginTransientAllocations();
+
+	virtual void endTransientAllocations();
+
 	btCollisionConfiguration* getCollisionConfiguration()
 	{
 		return m_collisionConfiguration;
@@ -28,8 +28,9 @@ subject to the following restrictions:
 btCollisionDispatcherMt::btCollisionDispatcherMt(btCollisionConfiguration* config, int grainSize)
 	: btCollisionDispatcher(config)
 {
-	m_batchManifoldsPtr.resize(btGetTaskScheduler()->getNumThreads());
-	m_batchReleasePtr.resize(btGetTaskScheduler()->getNumThreads());
+	// indexed by thread index, which a scheduler running fewer threads than it has can still hand out up to BT_MAX_THREAD_COUNT
+	m_batchManifoldsPtr.resize(BT_MAX_THREAD_COUNT);
+	m_batchReleasePtr.resize(BT_MAX_THREAD_COUNT);
 
 	m_batchUpdating = false;
 	m_grainSize = grainSize;  // iterations per task
@@ -130,6 +131,56 @@ struct CollisionDispatcherUpdater : public btIParallelForBody
 	}
 };
 
+struct btGatheredManifoldSortPredicate
+{
+	const btAlignedObjectArray<btPersistentManifold*>* m_manifolds;
+
+	bool operator()(int lhs, int rhs) const
+	{
+		const btPersistentManifold* manifoldA = (*m_manifolds)[lhs];
+		const btPersistentManifold* manifoldB = (*m_manifolds)[rhs];
+		const int uidA0 = manifoldA->getBody0()->getBroadphaseHandle()->m_uniqueId;
+		const int uidB0 = manifoldB->getBody0()->getBroadphaseHandle()->m_uniqueId;
+		if (uidA0 != uidB0)
+		{
+			return uidA0 < uidB0;
+		}
+		const int uidA1 = manifoldA->getBody1()->getBroadphaseHandle()->m_uniqueId;
+		const int uidB1 = manifoldB->getBody1()->getBroadphaseHandle()->m_uniqueId;
+		if (uidA1 != uidB1)
+		{
+			return uidA1 < uidB1;
+		}
+		// the manifolds of one pair all come from the thread that processed the pair, keep the order it made them in
+		return lhs < rhs;
+	}
+};
+
+void btCollisionDispatcherMt::gatherBatchManifolds(btAlignedObjectArray<btAlignedObjectArray<btPersistentManifold*> >& batches, bool deterministic)
+{
+	m_gatheredManifoldsPtr.resizeNoInitialize(0);
+	for (int i = 0; i < batches.size(); ++i)
+	{
+		btAlignedObjectArray<btPersistentManifold*>& batchManifoldsPtr = batches[i];
+		for (int j = 0; j < batchManifoldsPtr.size(); ++j)
+		{
+			m_gatheredManifoldsPtr.push_back(batchManifoldsPtr[j]);
+		}
+		batchManifoldsPtr.resizeNoInitialize(0);
+	}
+	m_gatheredOrder.resizeNoInitialize(m_gatheredManifoldsPtr.size());
+	for (int i = 0; i < m_gatheredOrder.size(); ++i)
+	{
+		m_gatheredOrder[i] = i;
+	}
+	if (deterministic && m_gatheredOrder.size() > 1)
+	{
+		btGatheredManifoldSortPredicate predicate;
+		predicate.m_manifolds = &m_gatheredManifoldsPtr;
+		m_gatheredOrder.quickSort(predicate);
+	}
+}
+
 void btCollisionDispatcherMt::dispatchAllCollisionPairs(btOverlappingPairCache* pairCache, const btDispatcherInfo& info, btDispatcher* dispatcher)
 {
 	const int pairCount = pairCache->getNumOverlappingPairs();
@@ -143,32 +194,27 @@ void btCollisionDispatcherMt::dispatchAllCollisionPairs(btOverlappingPairCache*
 	updater.mDispatcher = this;
 	updater.mInfo = &info;
 
+	batchConvexConvexPairs(pairCache, info);
 	m_batchUpdating = true;
 	btParallelFor(0, pairCount, m_grainSize, updater);
 	m_batchUpdating = false;
+	clearConvexConvexBatch();
 
 	// merge new manifolds, if any
-	for (int i = 0; i < m_batchManifoldsPtr.size(); ++i)
+	gatherBatchManifolds(m_batchManifoldsPtr, info.m_deterministicOverlappingPairs);
+	for (int i = 0; i < m_gatheredOrder.size(); ++i)
 	{
-		btAlignedObjectArray<btPersistentManifold*>& batchManifoldsPtr = m_batchManifoldsPtr[i];
-
-		for (int j = 0; j < batchManifoldsPtr.size(); ++j)
-		{
-			m_manifoldsPtr.push_back(batchManifoldsPtr[j]);
-		}
-
-		batchManifoldsPtr.resizeNoInitialize(0);
+		btPersistentManifold* manifold = m_gatheredManifoldsPtr[m_gatheredOrder[i]];
+		// a manifold may be released again below, which needs its index
+		manifold->m_index1a = m_manifoldsPtr.size();
+		m_manifoldsPtr.push_back(manifold);
 	}
 
 	// remove batched remove manifolds.
-	for (int i = 0; i < m_batchReleasePtr.size(); ++i)
+	gatherBatchManifolds(m_batchReleasePtr, info.m_deterministicOverlappingPairs);
+	for (int i = 0; i < m_gatheredOrder.size(); ++i)
 	{
-		btAlignedObjectArray<btPersistentManifold*>& batchManifoldsPtr = m_batchReleasePtr[i];
-		for (int j = 0; j < batchManifoldsPtr.size(); ++j)
-		{
-			releaseManifold(batchManifoldsPtr[j]);
-		}
-		batchManifoldsPtr.resizeNoInitialize(0);
+		releaseManifold(m_gatheredManifoldsPtr[m_gatheredOrder[i]]);
 	}
 
 	// update the indices (used when releasing manifolds)
@@ -32,8 +32,15 @@ public:
 protected:
 	btAlignedObjectArray<btAlignedObjectArray<btPersistentManifold*> > m_batchManifoldsPtr;
 	btAlignedObjectArray<btAlignedObjectArray<btPersistentManifold*> > m_batchReleasePtr;
+	btAlignedObjectArray<btPersistentManifold*> m_gatheredManifoldsPtr;
+	btAlignedObjectArray<int> m_gatheredOrder;
 	bool m_batchUpdating;
 	int m_grainSize;
+
+	///moves the manifolds the threads created or released into m_gatheredManifoldsPtr, to be applied in m_gatheredOrder.
+	///With btDispatcherInfo::m_deterministicOverlappingPairs they are ordered by the unique ids of their bodies,
+	///so the manifold array does not depend on the number of threads or which thread processed a pair
+	void gatherBatchManifolds(btAlignedObjectArray<btAlignedObjectArray<btPersistentManifold*> >& batches, bool deterministic);
 };
 
 #endif  //BT_COLLISION_DISPATCHER_MT_H
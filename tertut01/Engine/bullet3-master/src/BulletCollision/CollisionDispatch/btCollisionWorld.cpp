@@ -34,6 +34,7 @@ subject to the following restrictions:
 #include "LinearMath/btAabbUtil2.h"
 #include "LinearMath/btQuickprof.h"
 #include "LinearMath/btSerializer.h"
+#include "LinearMath/btThreads.h"
 #include "BulletCollision/CollisionShapes/btConvexPolyhedron.h"
 #include "BulletCollision/CollisionDispatch/btCollisionObjectWrapper.h"
 
@@ -1131,6 +1132,249 @@ void btCollisionWorld::convexSweepTest(const btConvexShape* castShape, const btT
 #endif  //USE_BRUTEFORCE_RAYBROADPHASE
 }
 
+// spreads the low 9 bits of x so that two zero bits follow each, for a morton code
+static unsigned int btSpreadBits9(unsigned int x)
+{
+	x &= 0x1ff;
+	x = (x | (x << 16)) & 0x030000ff;
+	x = (x | (x << 8)) & 0x0300f00f;
+	x = (x | (x << 4)) & 0x030c30c3;
+	x = (x | (x << 2)) & 0x09249249;
+	return x;
+}
+
+struct btRaySortEntry
+{
+	unsigned int m_key;
+	int m_ray;
+};
+
+struct btRaySortPredicate
+{
+	bool operator()(const btRaySortEntry& a, const btRaySortEntry& b) const
+	{
+		return a.m_key < b.m_key || (a.m_key == b.m_key && a.m_ray < b.m_ray);
+	}
+};
+
+struct btBatchRayResultCallback : public btCollisionWorld::ClosestRayResultCallback
+{
+	btBatchRayResultCallback() : ClosestRayResultCallback(btVector3(0, 0, 0), btVector3(0, 0, 0)) {}
+};
+
+struct btRayPacketCallback : public btBroadphaseRayPacketCallback
+{
+	btBatchRayResultCallback m_results[BT_RAY_PACKET_SIZE];
+	btTransform m_rayFromTrans[BT_RAY_PACKET_SIZE];
+	btTransform m_rayToTrans[BT_RAY_PACKET_SIZE];
+
+	virtual void process(const btBroadphaseProxy* proxy, unsigned int rayMask)
+	{
+		btCollisionObject* collisionObject = (btCollisionObject*)proxy->m_clientObject;
+		for (int i = 0; i < BT_RAY_PACKET_SIZE; i++)
+		{
+			btBatchRayResultCallback& result = m_results[i];
+			///the ray is done once its closestHitFraction reached zero, as in btSingleRayCallback
+			if (!(rayMask & (1u << i)) || result.m_closestHitFraction == btScalar(0.f))
+				continue;
+			if (result.needsCollision(collisionObject->getBroadphaseHandle()))
+			{
+				btCollisionWorld::rayTestSingle(m_rayFromTrans[i], m_rayToTrans[i],
+												collisionObject,
+												collisionObject->getCollisionShape(),
+												collisionObject->getWorldTransform(),
+												result);
+				m_hitFractionMax[i] = result.m_closestHitFraction;
+			}
+		}
+	}
+};
+
+struct btRayBatchLoop : public btIParallelForBody
+{
+	btBroadphaseInterface* m_broadphase;
+	const btVector3* m_rayFromWorld;
+	const btVector3* m_rayToWorld;
+	const int* m_collisionFilterMasks;
+	int m_collisionFilterGroup;
+	const btAlignedObjectArray<btRaySortEntry>* m_order;
+	btCollisionWorld::RayBatchResults* m_results;
+
+	void forLoop(int iBegin, int iEnd) const
+	{
+		const int numRays = m_order->size();
+		for (int packet = iBegin; packet < iEnd; ++packet)
+		{
+			btRayPacketCallback packetCallback;
+			btVector3 rayFrom[BT_RAY_PACKET_SIZE];
+			btVector3 rayTo[BT_RAY_PACKET_SIZE];
+			const int first = packet * BT_RAY_PACKET_SIZE;
+			const int count = btMin(int(BT_RAY_PACKET_SIZE), numRays - first);
+			for (int i = 0; i < count; ++i)
+			{
+				const int ray = (*m_order)[first + i].m_ray;
+				rayFrom[i] = m_rayFromWorld[ray];
+				rayTo[i] = m_rayToWorld[ray];
+				btBatchRayResultCallback& result = packetCallback.m_results[i];
+				result.m_rayFromWorld = rayFrom[i];
+				result.m_rayToWorld = rayTo[i];
+				result.m_collisionFilterGroup = m_collisionFilterGroup;
+				result.m_collisionFilterMask = m_collisionFilterMasks ? m_collisionFilterMasks[ray] : int(btBroadphaseProxy::AllFilter);
+				packetCallback.m_rayFromTrans[i].setIdentity();
+				packetCallback.m_rayFromTrans[i].setOrigin(rayFrom[i]);
+				packetCallback.m_rayToTrans[i].setIdentity();
+				packetCallback.m_rayToTrans[i].setOrigin(rayTo[i]);
+			}
+			m_broadphase->rayTestPacket(rayFrom, rayTo, count, packetCallback);
+			for (int i = 0; i < count; ++i)
+			{
+				const int ray = (*m_order)[first + i].m_ray;
+				const btBatchRayResultCallback& result = packetCallback.m_results[i];
+				m_results->m_collisionObjects[ray] = result.m_collisionObject;
+				m_results->m_hitFractions[ray] = result.m_closestHitFraction;
+				if (result.hasHit())
+				{
+					m_results->m_hitPointWorld[ray] = result.m_hitPointWorld;
+					m_results->m_hitNormalWorld[ray] = result.m_hitNormalWorld;
+				}
+				else
+				{
+					m_results->m_hitPointWorld[ray] = rayTo[i];
+					m_results->m_hitNormalWorld[ray].setValue(0, 0, 0);
+				}
+			}
+		}
+	}
+};
+
+void btCollisionWorld::rayTestBatch(const btVector3* rayFromWorld, const btVector3* rayToWorld, const int* collisionFilterMasks, int numRays, RayBatchResults& results, int collisionFilterGroup) const
+{
+	BT_PROFILE("rayTestBatch");
+	results.m_collisionObjects.resize(numRays);
+	results.m_hitFractions.resize(numRays);
+	results.m_hitPointWorld.resize(numRays);
+	results.m_hitNormalWorld.resize(numRays);
+	if (numRays <= 0)
+		return;
+
+	/// sort the rays by direction octant and then along a morton curve through their midpoints,
+	/// so the rays of a packet mostly visit the same nodes of the broadphase
+	btAlignedObjectArray<btRaySortEntry> order;
+	order.resize(numRays);
+	btVector3 centerMin = (rayFromWorld[0] + rayToWorld[0]) * btScalar(0.5);
+	btVector3 centerMax = centerMin;
+	for (int i = 1; i < numRays; i++)
+	{
+		const btVector3 center = (rayFromWorld[i] + rayToWorld[i]) * btScalar(0.5);
+		centerMin.setMin(center);
+		centerMax.setMax(center);
+	}
+	const btVector3 extent = centerMax - centerMin;
+	btVector3 scale;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		scale[axis] = extent[axis] > SIMD_EPSILON ? btScalar(511) / extent[axis] : btScalar(0);
+	}
+	for (int i = 0; i < numRays; i++)
+	{
+		const btVector3 direction = rayToWorld[i] - rayFromWorld[i];
+		const btVector3 cell = ((rayFromWorld[i] + rayToWorld[i]) * btScalar(0.5) - centerMin) * scale;
+		const unsigned int octant = (direction[0] < 0 ? 1 : 0) | (direction[1] < 0 ? 2 : 0) | (direction[2] < 0 ? 4 : 0);
+		order[i].m_key = (octant << 27) |
+						 btSpreadBits9((unsigned int)cell[0]) |
+						 (btSpreadBits9((unsigned int)cell[1]) << 1) |
+						 (btSpreadBits9((unsigned int)cell[2]) << 2);
+		order[i].m_ray = i;
+	}
+	order.quickSort(btRaySortPredicate());
+
+	btRayBatchLoop loop;
+	loop.m_broadphase = m_broadphasePairCache;
+	loop.m_rayFromWorld = rayFromWorld;
+	loop.m_rayToWorld = rayToWorld;
+	loop.m_collisionFilterMasks = collisionFilterMasks;
+	loop.m_collisionFilterGroup = collisionFilterGroup;
+	loop.m_order = &order;
+	loop.m_results = &results;
+	const int numPackets = (numRays + BT_RAY_PACKET_SIZE - 1) / BT_RAY_PACKET_SIZE;
+#if BT_THREADSAFE
+	if (btGetTaskScheduler() && btGetTaskScheduler()->getNumThreads() > 1)
+	{
+		const int grainSize = 16;  // packets per task
+		btParallelFor(0, numPackets, grainSize, loop);
+	}
+	else
+#endif
+	{
+		loop.forLoop(0, numPackets);
+	}
+}
+
+struct btConvexBatchLoop : public btIParallelForBody
+{
+	const btCollisionWorld* m_world;
+	const btConvexShape* m_castShape;
+	const btTransform* m_from;
+	const btTransform* m_to;
+	const int* m_collisionFilterMasks;
+	int m_collisionFilterGroup;
+	btScalar m_allowedCcdPenetration;
+	btCollisionWorld::ConvexBatchResults* m_results;
+
+	void forLoop(int iBegin, int iEnd) const
+	{
+		for (int i = iBegin; i < iEnd; ++i)
+		{
+			btCollisionWorld::ClosestConvexResultCallback result(m_from[i].getOrigin(), m_to[i].getOrigin());
+			result.m_collisionFilterGroup = m_collisionFilterGroup;
+			result.m_collisionFilterMask = m_collisionFilterMasks ? m_collisionFilterMasks[i] : int(btBroadphaseProxy::AllFilter);
+			m_world->convexSweepTest(m_castShape, m_from[i], m_to[i], result, m_allowedCcdPenetration);
+			m_results->m_hitCollisionObjects[i] = result.m_hitCollisionObject;
+			m_results->m_hitFractions[i] = result.m_closestHitFraction;
+			if (result.hasHit())
+			{
+				m_results->m_hitPointWorld[i] = result.m_hitPointWorld;
+				m_results->m_hitNormalWorld[i] = result.m_hitNormalWorld;
+			}
+			else
+			{
+				m_results->m_hitPointWorld[i] = m_to[i].getOrigin();
+				m_results->m_hitNormalWorld[i].setValue(0, 0, 0);
+			}
+		}
+	}
+};
+
+void btCollisionWorld::convexSweepTestBatch(const btConvexShape* castShape, const btTransform* from, const btTransform* to, const int* collisionFilterMasks, int numCasts, ConvexBatchResults& results, int collisionFilterGroup, btScalar allowedCcdPenetration) const
+{
+	BT_PROFILE("convexSweepTestBatch");
+	results.m_hitCollisionObjects.resize(numCasts);
+	results.m_hitFractions.resize(numCasts);
+	results.m_hitPointWorld.resize(numCasts);
+	results.m_hitNormalWorld.resize(numCasts);
+
+	btConvexBatchLoop loop;
+	loop.m_world = this;
+	loop.m_castShape = castShape;
+	loop.m_from = from;
+	loop.m_to = to;
+	loop.m_collisionFilterMasks = collisionFilterMasks;
+	loop.m_collisionFilterGroup = collisionFilterGroup;
+	loop.m_allowedCcdPenetration = allowedCcdPenetration;
+	loop.m_results = &results;
+#if BT_THREADSAFE
+	if (btGetTaskScheduler() && btGetTaskScheduler()->getNumThreads() > 1)
+	{
+		const int grainSize = 8;  // casts per task, each is much more work than a ray
+		btParallelFor(0, numCasts, grainSize, loop);
+	}
+	else
+#endif
+	{
+		loop.forLoop(0, numCasts);
+	}
+}
+
 struct btBridgedManifoldResult : public btManifoldResult
 {
 	btCollisionWorld::ContactResultCallback& m_resultCallback;
@@ -424,6 +424,24 @@ public:
 		virtual btScalar addSingleResult(btManifoldPoint& cp, const btCollisionObjectWrapper* colObj0Wrap, int partId0, int index0, const btCollisionObjectWrapper* colObj1Wrap, int partId1, int index1) = 0;
 	};
 
+	///RayBatchResults holds the closest hit of every ray of rayTestBatch, as structure of arrays
+	struct RayBatchResults
+	{
+		btAlignedObjectArray<const btCollisionObject*> m_collisionObjects;  //0 where the ray hit nothing
+		btAlignedObjectArray<btScalar> m_hitFractions;                      //1 where the ray hit nothing
+		btAlignedObjectArray<btVector3> m_hitPointWorld;
+		btAlignedObjectArray<btVector3> m_hitNormalWorld;
+	};
+
+	///ConvexBatchResults holds the closest hit of every cast of convexSweepTestBatch, as structure of arrays
+	struct ConvexBatchResults
+	{
+		btAlignedObjectArray<const btCollisionObject*> m_hitCollisionObjects;  //0 where the cast hit nothing
+		btAlignedObjectArray<btScalar> m_hitFractions;                         //1 where the cast hit nothing
+		btAlignedObjectArray<btVector3> m_hitPointWorld;
+		btAlignedObjectArray<btVector3> m_hitNormalWorld;
+	};
+
 	int getNumCollisionObjects() const
 	{
 		return int(m_collisionObjects.size());
@@ -437,6 +455,16 @@ public:
 	/// This allows for several queries: first hit, all hits, any hit, dependent on the value return by the callback.
 	void convexSweepTest(const btConvexShape* castShape, const btTransform& from, const btTransform& to, ConvexResultCallback& resultCallback, btScalar allowedCcdPenetration = btScalar(0.)) const;
 
+	/// rayTestBatch finds the closest hit of each of numRays rays, with the same results as rayTest with a ClosestRayResultCallback.
+	/// The rays are sorted into packets of nearby rays with similar directions, each packet walks the broadphase once,
+	/// and the packets are spread over the threads of the task scheduler.
+	/// collisionFilterMasks has one mask per ray, or is 0 to use btBroadphaseProxy::AllFilter for all of them
+	void rayTestBatch(const btVector3* rayFromWorld, const btVector3* rayToWorld, const int* collisionFilterMasks, int numRays, RayBatchResults& results, int collisionFilterGroup = btBroadphaseProxy::DefaultFilter) const;
+
+	/// convexSweepTestBatch finds the closest hit of each of numCasts casts of the same shape, like convexSweepTest with a ClosestConvexResultCallback.
+	/// The casts are spread over the threads of the task scheduler
+	void convexSweepTestBatch(const btConvexShape* castShape, const btTransform* from, const btTransform* to, const int* collisionFilterMasks, int numCasts, ConvexBatchResults& results, int collisionFilterGroup = btBroadphaseProxy::DefaultFilter, btScalar allowedCcdPenetration = btScalar(0.)) const;
+
 	///contactTest performs a discrete collision test between colObj against all objects in the btCollisionWorld, and calls the resultCallback.
 	///it reports one or more contact points for every overlapping object (including the one with deepest penetration)
 	void contactTest(btCollisionObject* colObj, ContactResultCallback& resultCallback);
@@ -148,6 +148,7 @@ void btConvexTriangleCallback::processTriangle(btVector3* triangle, int partId,
 		btCollisionObjectWrapper triObWrap(m_triBodyWrap, &tm, m_triBodyWrap->getCollisionObject(), m_triBodyWrap->getWorldTransform(), partId, triangleIndex);  //correct transform?
 		btCollisionAlgorithm* colAlgo = 0;
 
+		ci.m_dispatcher1->beginTransientAllocations();
 		if (m_resultOut->m_closestPointDistanceThreshold > 0)
 		{
 			colAlgo = ci.m_dispatcher1->findAlgorithm(m_convexBodyWrap, &triObWrap, 0, BT_CLOSEST_POINT_ALGORITHMS);
@@ -187,6 +188,7 @@ void btConvexTriangleCallback::processTriangle(btVector3* triangle, int partId,
 
 		colAlgo->~btCollisionAlgorithm();
 		ci.m_dispatcher1->freeCollisionAlgorithm(colAlgo);
+		ci.m_dispatcher1->endTransientAllocations();
 	}
 }
 
@@ -192,7 +192,9 @@ btConvexConvexAlgorithm::btConvexConvexAlgorithm(btPersistentManifold* mf, const
 					(static_cast<btConvexShape*>(body1->getCollisionShape()))->getAngularMotionDisc()),
 #endif
 	  m_numPerturbationIterations(numPerturbationIterations),
-	  m_minimumPointsPerturbationThreshold(minimumPointsPerturbationThreshold)
+	  m_minimumPointsPerturbationThreshold(minimumPointsPerturbationThreshold),
+	  m_cachedSeparatingAxis(btScalar(0.), btScalar(0.), btScalar(0.)),
+	  m_batchSeparated(false)
 {
 	(void)body0Wrap;
 	(void)body1Wrap;
@@ -280,6 +282,17 @@ void btConvexConvexAlgorithm ::processCollision(const btCollisionObjectWrapper*
 	}
 	resultOut->setPersistentManifold(m_manifoldPtr);
 
+	if (m_batchSeparated)
+	{
+		//the shapes are too far apart to add contact points, the existing ones only need a refresh
+		m_batchSeparated = false;
+		if (m_ownManifold)
+		{
+			resultOut->refreshContactPoints();
+		}
+		return;
+	}
+
 	//comment-out next line to test multi-contact generation
 	//resultOut->getPersistentManifold()->clearManifold();
 
@@ -56,6 +56,10 @@ class btConvexConvexAlgorithm : public btActivatingCollisionAlgorithm
 	int m_minimumPointsPerturbationThreshold;
 
 	///cache separating vector to speedup collision detection
+	btVector3 m_cachedSeparatingAxis;
+
+	///set by btCollisionDispatcher when a batched query proved the shapes further apart than the contact breaking threshold
+	bool m_batchSeparated;
 
 public:
 	btConvexConvexAlgorithm(btPersistentManifold* mf, const btCollisionAlgorithmConstructionInfo& ci, const btCollisionObjectWrapper* body0Wrap, const btCollisionObjectWrapper* body1Wrap, btConvexPenetrationDepthSolver* pdSolver, int numPerturbationIterations, int minimumPointsPerturbationThreshold);
@@ -80,6 +84,29 @@ public:
 		return m_manifoldPtr;
 	}
 
+	///pairs with their own manifold and without perturbation can skip processCollision when they are known to be separated
+	bool isBatchable() const
+	{
+		return m_manifoldPtr && m_ownManifold && m_numPerturbationIterations == 0;
+	}
+
+	const btVector3& getCachedSeparatingAxis() const
+	{
+		return m_cachedSeparatingAxis;
+	}
+
+	///the next processCollision only refreshes the contact points, see btCollisionDispatcher::CD_BATCH_CONVEX_CONVEX_PAIRS
+	void setBatchSeparated(bool separated, const btVector3& separatingAxis)
+	{
+		m_batchSeparated = separated;
+		m_cachedSeparatingAxis = separatingAxis;
+	}
+
+	void clearBatchSeparated()
+	{
+		m_batchSeparated = false;
+	}
+
 	struct CreateFunc : public btCollisionAlgorithmCreateFunc
 	{
 		btConvexPenetrationDepthSolver* m_pdSolver;
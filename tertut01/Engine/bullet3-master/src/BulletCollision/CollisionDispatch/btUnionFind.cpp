@@ -14,6 +14,7 @@ subject to the following restrictions:
 */
 
 #include "btUnionFind.h"
+#include "LinearMath/btThreads.h"
 
 btUnionFind::~btUnionFind()
 {
@@ -72,3 +73,42 @@ void btUnionFind::sortIslands()
 	//std::sort(m_elements.begin(), m_elements.end(), btUnionFindElementSortPredicate);
 	m_elements.quickSort(btUnionFindElementSortPredicate());
 }
+
+int btUnionFind::findConcurrent(int x)
+{
+	// path halving: parents only ever move up the tree, so a stale write still points at an ancestor
+	int parent = btAtomicLoad(&m_elements[x].m_id);
+	while (parent != x)
+	{
+		const int grandParent = btAtomicLoad(&m_elements[parent].m_id);
+		if (grandParent != parent)
+		{
+			btAtomicStore(&m_elements[x].m_id, grandParent);
+		}
+		x = grandParent;
+		parent = btAtomicLoad(&m_elements[x].m_id);
+	}
+	return x;
+}
+
+void btUnionFind::uniteConcurrent(int p, int q)
+{
+	while (true)
+	{
+		p = findConcurrent(p);
+		q = findConcurrent(q);
+		if (p == q)
+		{
+			return;
+		}
+		if (p < q)
+		{
+			btSwap(p, q);
+		}
+		// fails if another thread linked p in the meantime, then look for the roots again
+		if (btAtomicCompareExchange(&m_elements[p].m_id, p, q))
+		{
+			return;
+		}
+	}
+}
@@ -68,6 +68,12 @@ public:
 	void allocate(int N);
 	void Free();
 
+	// Thread safe versions of find and unite, for use from several threads at once inside a btParallelFor loop.
+	// Do not mix with unite in the same round: uniteConcurrent always links the root with the larger index below
+	// the other root, so each set ends up with its smallest element as root, whatever order the unions come in.
+	int findConcurrent(int x);
+	void uniteConcurrent(int p, int q);
+
 	int find(int p, int q)
 	{
 		return (find(p) == find(q));
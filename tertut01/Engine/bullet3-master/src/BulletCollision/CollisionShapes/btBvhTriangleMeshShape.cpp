@@ -26,7 +26,9 @@ btBvhTriangleMeshShape::btBvhTriangleMeshShape(btStridingMeshInterface* meshInte
 	  m_bvh(0),
 	  m_triangleInfoMap(0),
 	  m_useQuantizedAabbCompression(useQuantizedAabbCompression),
-	  m_ownsBvh(false)
+	  m_ownsBvh(false),
+	  m_useSurfaceAreaHeuristic(false),
+	  m_mappedBvh(false)
 {
 	m_shapeType = TRIANGLE_MESH_SHAPE_PROXYTYPE;
 	//construct bvh from meshInterface
@@ -45,7 +47,9 @@ btBvhTriangleMeshShape::btBvhTriangleMeshShape(btStridingMeshInterface* meshInte
 	  m_bvh(0),
 	  m_triangleInfoMap(0),
 	  m_useQuantizedAabbCompression(useQuantizedAabbCompression),
-	  m_ownsBvh(false)
+	  m_ownsBvh(false),
+	  m_useSurfaceAreaHeuristic(false),
+	  m_mappedBvh(false)
 {
 	m_shapeType = TRIANGLE_MESH_SHAPE_PROXYTYPE;
 	//construct bvh from meshInterface
@@ -65,6 +69,7 @@ btBvhTriangleMeshShape::btBvhTriangleMeshShape(btStridingMeshInterface* meshInte
 
 void btBvhTriangleMeshShape::partialRefitTree(const btVector3& aabbMin, const btVector3& aabbMax)
 {
+	btAssert(!m_mappedBvh);
 	m_bvh->refitPartial(m_meshInterface, aabbMin, aabbMax);
 
 	m_localAabbMin.setMin(aabbMin);
@@ -73,6 +78,7 @@ void btBvhTriangleMeshShape::partialRefitTree(const btVector3& aabbMin, const bt
 
 void btBvhTriangleMeshShape::refitTree(const btVector3& aabbMin, const btVector3& aabbMax)
 {
+	btAssert(!m_mappedBvh);
 	m_bvh->refit(m_meshInterface, aabbMin, aabbMax);
 
 	recalcLocalAabb();
@@ -348,8 +354,9 @@ void btBvhTriangleMeshShape::buildOptimizedBvh()
 	void* mem = btAlignedAlloc(sizeof(btOptimizedBvh), 16);
 	m_bvh = new (mem) btOptimizedBvh();
 	//rebuild the bvh...
-	m_bvh->build(m_meshInterface, m_useQuantizedAabbCompression, m_localAabbMin, m_localAabbMax);
+	m_bvh->build(m_meshInterface, m_useQuantizedAabbCompression, m_localAabbMin, m_localAabbMax, m_useSurfaceAreaHeuristic);
 	m_ownsBvh = true;
+	m_mappedBvh = false;
 }
 
 void btBvhTriangleMeshShape::setOptimizedBvh(btOptimizedBvh* bvh, const btVector3& scaling)
@@ -366,6 +373,26 @@ void btBvhTriangleMeshShape::setOptimizedBvh(btOptimizedBvh* bvh, const btVector
 	}
 }
 
+bool btBvhTriangleMeshShape::setMappedOptimizedBvh(const void* alignedDataBuffer, unsigned int dataBufferSize, const btVector3& scaling)
+{
+	btAssert(!m_bvh);
+	btAssert(!m_ownsBvh);
+
+	// only the small btOptimizedBvh object is allocated, its nodes stay in the buffer
+	void* mem = btAlignedAlloc(sizeof(btOptimizedBvh), 16);
+	btOptimizedBvh* bvh = new (mem) btOptimizedBvh();
+	if (!bvh->initializeFromMappedBuffer(alignedDataBuffer, dataBufferSize))
+	{
+		bvh->~btOptimizedBvh();
+		btAlignedFree(mem);
+		return false;
+	}
+	setOptimizedBvh(bvh, scaling);
+	m_ownsBvh = true;
+	m_mappedBvh = true;
+	return true;
+}
+
 ///fills the dataBuffer and returns the struct name (and 0 on failure)
 const char* btBvhTriangleMeshShape::serialize(void* dataBuffer, btSerializer* serializer) const
 {
@@ -39,10 +39,12 @@ btBvhTriangleMeshShape : public btTriangleMeshShape
 
 	bool m_useQuantizedAabbCompression;
 	bool m_ownsBvh;
+	bool m_useSurfaceAreaHeuristic;
+	bool m_mappedBvh;
 #ifdef __clang__
-	bool m_pad[11] __attribute__((unused));  ////need padding due to alignment
+	bool m_pad[9] __attribute__((unused));  ////need padding due to alignment
 #else
-	bool m_pad[11];  ////need padding due to alignment
+	bool m_pad[9];  ////need padding due to alignment
 #endif
 
 public:
@@ -82,8 +84,24 @@ public:
 
 	void setOptimizedBvh(btOptimizedBvh * bvh, const btVector3& localScaling = btVector3(1, 1, 1));
 
+	///setMappedOptimizedBvh uses a BVH written with btOptimizedBvh::serializeInPlace straight from memory, typically a btMappedFile,
+	///without copying or writing to it. The buffer must outlive the shape, and the tree cannot be refitted.
+	///Returns false if the buffer does not hold a BVH, see btQuantizedBvh::initializeFromMappedBuffer
+	bool setMappedOptimizedBvh(const void* alignedDataBuffer, unsigned int dataBufferSize, const btVector3& localScaling = btVector3(1, 1, 1));
+
 	void buildOptimizedBvh();
 
+	///the BVH of buildOptimizedBvh uses a surface area heuristic, see btOptimizedBvh::build
+	void setUseSurfaceAreaHeuristic(bool useSurfaceAreaHeuristic)
+	{
+		m_useSurfaceAreaHeuristic = useSurfaceAreaHeuristic;
+	}
+
+	bool getUseSurfaceAreaHeuristic() const
+	{
+		return m_useSurfaceAreaHeuristic;
+	}
+
 	bool usesQuantizedAabbCompression() const
 	{
 		return m_useQuantizedAabbCompression;
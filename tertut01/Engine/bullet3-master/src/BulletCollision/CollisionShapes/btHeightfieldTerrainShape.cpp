@@ -310,6 +310,14 @@ static btHeightfieldTerrainShape::Range minmaxRange(btScalar a, btScalar b, btSc
 	}
 }
 
+// The range of raw heights between two heights of a query, widened a little so that the rounding of
+// the conversion to raw heights never culls a triangle the exact test would not.
+static btHeightfieldTerrainShape::Range rawHeightRange(btScalar a, btScalar b)
+{
+	const btScalar tolerance = (btFabs(a) + btFabs(b) + btScalar(1.)) * btScalar(1e-5);
+	return btHeightfieldTerrainShape::Range(btMin(a, b) - tolerance, btMax(a, b) + tolerance);
+}
+
 /// given input vector, return quantized version
 /**
   This routine is basically determining the gridpoint indices for a given
@@ -411,9 +419,35 @@ void btHeightfieldTerrainShape::processAllTriangles(btTriangleCallback* callback
 		}
 	}
 
-	// TODO If m_vboundsGrid is available, use it to determine if we really need to process this area
-	
 	const Range aabbUpRange(aabbMin[m_upAxis], aabbMax[m_upAxis]);
+	if (m_vboundsLevels.size() == 0)
+	{
+		processQuads(callback, startX, endX, startJ, endJ, aabbUpRange);
+		return;
+	}
+
+	// the accelerator holds raw heights, which is what localAabbMin and localAabbMax are on the up axis
+	const Range rawUpRange = rawHeightRange(localAabbMin[m_upAxis], localAabbMax[m_upAxis]);
+
+	// start at the finest level where the quads in the aabb fall into no more than 2x2 nodes
+	int level = 0;
+	while (level + 1 < m_vboundsLevels.size() && m_vboundsLevels[level].m_cellsPerNode < btMax(endX - startX, endJ - startJ))
+	{
+		++level;
+	}
+	const int cellsPerNode = m_vboundsLevels[level].m_cellsPerNode;
+	for (int nodeJ = startJ / cellsPerNode; nodeJ * cellsPerNode < endJ; ++nodeJ)
+	{
+		for (int nodeX = startX / cellsPerNode; nodeX * cellsPerNode < endX; ++nodeX)
+		{
+			processQuadsInNode(callback, level, nodeX, nodeJ, startX, endX, startJ, endJ, aabbUpRange, rawUpRange);
+		}
+	}
+}
+
+/// calls back the triangles of the quads [startX, endX) x [startJ, endJ) that overlap aabbUpRange
+void btHeightfieldTerrainShape::processQuads(btTriangleCallback* callback, int startX, int endX, int startJ, int endJ, const Range& aabbUpRange) const
+{
 	for (int j = startJ; j < endJ; j++)
 	{
 		for (int x = startX; x < endX; x++)
@@ -478,6 +512,42 @@ void btHeightfieldTerrainShape::processAllTriangles(btTriangleCallback* callback
 	}
 }
 
+/// processQuads for the part of the quad range under a node of the accelerator, skipping the nodes
+/// with heights all above or all below the aabb
+void btHeightfieldTerrainShape::processQuadsInNode(btTriangleCallback* callback, int level, int nodeX, int nodeJ, int startX, int endX, int startJ, int endJ, const Range& aabbUpRange, const Range& rawUpRange) const
+{
+	if (!getAcceleratorRange(level, nodeX, nodeJ).overlaps(rawUpRange))
+	{
+		return;
+	}
+
+	if (level == 0)
+	{
+		const int cellsPerNode = m_vboundsLevels[0].m_cellsPerNode;
+		const int x0 = nodeX * cellsPerNode;
+		const int j0 = nodeJ * cellsPerNode;
+		processQuads(callback, btMax(startX, x0), btMin(endX, x0 + cellsPerNode), btMax(startJ, j0), btMin(endJ, j0 + cellsPerNode), aabbUpRange);
+		return;
+	}
+
+	const MinMaxLevel& child = m_vboundsLevels[level - 1];
+	for (int j = 2 * nodeJ; j < 2 * nodeJ + 2 && j < child.m_length; ++j)
+	{
+		if (j * child.m_cellsPerNode >= endJ || (j + 1) * child.m_cellsPerNode <= startJ)
+		{
+			continue;
+		}
+		for (int x = 2 * nodeX; x < 2 * nodeX + 2 && x < child.m_width; ++x)
+		{
+			if (x * child.m_cellsPerNode >= endX || (x + 1) * child.m_cellsPerNode <= startX)
+			{
+				continue;
+			}
+			processQuadsInNode(callback, level - 1, x, j, startX, endX, startJ, endJ, aabbUpRange, rawUpRange);
+		}
+	}
+}
+
 void btHeightfieldTerrainShape::calculateLocalInertia(btScalar, btVector3& inertia) const
 {
 	//moving concave objects not supported
@@ -654,13 +724,16 @@ struct ProcessTrianglesAction
 	const btHeightfieldTerrainShape* shape;
 	bool flipQuadEdges;
 	bool useDiamondSubdivision;
-	int width;
-	int length;
+	// the quads [startX, endX) x [startZ, endZ) to process
+	int startX;
+	int startZ;
+	int endX;
+	int endZ;
 	btTriangleCallback* callback;
 
 	void exec(int x, int z) const
 	{
-		if (x < 0 || z < 0 || x >= width || z >= length)
+		if (x < startX || z < startZ || x >= endX || z >= endZ)
 		{
 			return;
 		}
@@ -706,70 +779,99 @@ struct ProcessTrianglesAction
 	}
 };
 
-struct ProcessVBoundsAction
+/// Walks the min-max pyramid of the accelerator from the single top node down, visiting only the nodes where
+/// the part of the ray over the node overlaps the heights under it, and runs the quad raycast in those chunks.
+struct ProcessMinMaxPyramidAction
 {
-	const btAlignedObjectArray<btHeightfieldTerrainShape::Range>& vbounds;
-	int width;
-	int length;
-	int chunkSize;
-
-	btVector3 rayBegin;
-	btVector3 rayEnd;
-	btVector3 rayDir;
-
+	const btHeightfieldTerrainShape* shape;
 	int* m_indices;
+	btVector3 rayBegin;
+	btVector3 rayDelta;
 	ProcessTrianglesAction processTriangles;
 
-	ProcessVBoundsAction(const btAlignedObjectArray<btHeightfieldTerrainShape::Range>& bnd, int* indices)
-		: vbounds(bnd),
+	ProcessMinMaxPyramidAction(const btHeightfieldTerrainShape* shape, int* indices)
+		: shape(shape),
 		m_indices(indices)
 	{
 	}
-	void operator()(const GridRaycastState& rs) const
+
+	/// clips [t0, t1] of the ray to the cells [begin, end) along axis, widened a little so the
+	/// rounding never loses the quads on the border
+	bool clip(int axis, int begin, int end, btScalar& t0, btScalar& t1) const
 	{
-		int x = rs.prev_x;
-		int z = rs.prev_z;
+		const btScalar lo = btScalar(begin) - btScalar(0.001);
+		const btScalar hi = btScalar(end) + btScalar(0.001);
+		if (rayDelta[axis] == btScalar(0.))
+		{
+			return rayBegin[axis] >= lo && rayBegin[axis] <= hi;
+		}
+		btScalar tLo = (lo - rayBegin[axis]) / rayDelta[axis];
+		btScalar tHi = (hi - rayBegin[axis]) / rayDelta[axis];
+		if (tLo > tHi)
+		{
+			btSwap(tLo, tHi);
+		}
+		t0 = btMax(t0, tLo);
+		t1 = btMin(t1, tHi);
+		return t0 <= t1;
+	}
 
-		if (x < 0 || z < 0 || x >= width || z >= length)
+	void processNode(int level, int x, int z, btScalar t0, btScalar t1) const
+	{
+		const btHeightfieldTerrainShape::MinMaxLevel& l = shape->getAcceleratorLevel(level);
+		const int x0 = x * l.m_cellsPerNode;
+		const int z0 = z * l.m_cellsPerNode;
+		const int x1 = btMin(x0 + l.m_cellsPerNode, processTriangles.endX);
+		const int z1 = btMin(z0 + l.m_cellsPerNode, processTriangles.endZ);
+		if (x0 >= x1 || z0 >= z1)
+		{
+			return;
+		}
+		if (!clip(m_indices[0], x0, x1, t0, t1) || !clip(m_indices[2], z0, z1, t0, t1))
 		{
 			return;
 		}
 
-		const btHeightfieldTerrainShape::Range chunk = vbounds[x + z * width];
-
-		btVector3 enterPos;
-		btVector3 exitPos;
-
-		if (rs.maxDistanceFlat > 0.0001)
+		// The ray is a line, so its heights over the node are between those where it enters and leaves
+		const btScalar enterHeight = rayBegin[m_indices[1]] + rayDelta[m_indices[1]] * t0;
+		const btScalar exitHeight = rayBegin[m_indices[1]] + rayDelta[m_indices[1]] * t1;
+		if (!shape->getAcceleratorRange(level, x, z).overlaps(rawHeightRange(enterHeight, exitHeight)))
 		{
-			btScalar flatTo3d = chunkSize * rs.maxDistance3d / rs.maxDistanceFlat;
-			btScalar enterParam3d = rs.prevParam * flatTo3d;
-			btScalar exitParam3d = rs.param * flatTo3d;
-			enterPos = rayBegin + rayDir * enterParam3d;
-			exitPos = rayBegin + rayDir * exitParam3d;
+			return;
+		}
 
-			// We did enter the flat projection of the AABB,
-			// but we have to check if we intersect it on the vertical axis
-			if (enterPos[1] > chunk.max && exitPos[m_indices[1]] > chunk.max)
+		if (level == 0)
+		{
+			ProcessTrianglesAction chunk = processTriangles;
+			chunk.startX = x0;
+			chunk.startZ = z0;
+			chunk.endX = x1;
+			chunk.endZ = z1;
+			const btVector3 enterPos = rayBegin + rayDelta * t0;
+			const btVector3 exitPos = rayBegin + rayDelta * t1;
+			if (enterPos.distance2(exitPos) < btScalar(0.0001 * 0.0001))
 			{
-				return;
+				// gridRaycast ignores a piece of ray this short, but it can still hit the quad it is in
+				const btVector3 midPos = (enterPos + exitPos) * btScalar(0.5);
+				chunk.exec(static_cast<int>(floor(midPos[m_indices[0]])), static_cast<int>(floor(midPos[m_indices[2]])));
 			}
-			if (enterPos[1] < chunk.min && exitPos[m_indices[1]] < chunk.min)
+			else
 			{
-				return;
+				gridRaycast(chunk, enterPos, exitPos, m_indices);
 			}
+			return;
 		}
-		else
+
+		// the children nearer to the ray source first
+		const int flipX = rayDelta[m_indices[0]] < 0 ? 1 : 0;
+		const int flipZ = rayDelta[m_indices[2]] < 0 ? 1 : 0;
+		for (int j = 0; j < 2; ++j)
 		{
-			// Consider the ray vertical
-			// (though we shouldn't reach this often because there is an early check up-front)
-			enterPos = rayBegin;
-			exitPos = rayEnd;
+			for (int i = 0; i < 2; ++i)
+			{
+				processNode(level - 1, 2 * x + (i ^ flipX), 2 * z + (j ^ flipZ), t0, t1);
+			}
 		}
-
-		gridRaycast(processTriangles, enterPos, exitPos, m_indices);
-		// Note: it could be possible to have more than one grid at different levels,
-		// to do this there would be a branch using a pointer to another ProcessVBoundsAction
 	}
 };
 
@@ -789,12 +891,19 @@ void btHeightfieldTerrainShape::performRaycast(btTriangleCallback* callback, con
 	processTriangles.flipQuadEdges = m_flipQuadEdges;
 	processTriangles.useDiamondSubdivision = m_useDiamondSubdivision;
 	processTriangles.callback = callback;
-	processTriangles.width = m_heightStickWidth - 1;
-	processTriangles.length = m_heightStickLength - 1;
+	processTriangles.startX = 0;
+	processTriangles.startZ = 0;
+	processTriangles.endX = m_heightStickWidth - 1;
+	processTriangles.endZ = m_heightStickLength - 1;
 
-	// TODO Transform vectors to account for m_upAxis
+	// the axes of the quad columns, the heights and the quad rows, see getVertex
 	int indices[3] = { 0, 1, 2 };
-	if (m_upAxis == 2)
+	if (m_upAxis == 0)
+	{
+		indices[0] = 1;
+		indices[1] = 0;
+	}
+	else if (m_upAxis == 2)
 	{
 		indices[1] = 2;
 		indices[2] = 1;
@@ -815,7 +924,7 @@ void btHeightfieldTerrainShape::performRaycast(btTriangleCallback* callback, con
 
 	
 
-	if (m_vboundsGrid.size()==0)
+	if (m_vboundsLevels.size() == 0)
 	{
 		// Process all quads intersecting the flat projection of the ray
 		gridRaycast(processTriangles, beginPos, endPos, &indices[0]);
@@ -831,20 +940,68 @@ void btHeightfieldTerrainShape::performRaycast(btTriangleCallback* callback, con
 			return;
 		}
 
-		ProcessVBoundsAction processVBounds(m_vboundsGrid, &indices[0]);
-		processVBounds.width = m_vboundsGridWidth;
-		processVBounds.length = m_vboundsGridLength;
-		processVBounds.rayBegin = beginPos;
-		processVBounds.rayEnd = endPos;
-		processVBounds.rayDir = rayDiff.normalized();
-		processVBounds.processTriangles = processTriangles;
-		processVBounds.chunkSize = m_vboundsChunkSize;
-		// The ray is long, run raycast on a higher-level grid
-		gridRaycast(processVBounds, beginPos / m_vboundsChunkSize, endPos / m_vboundsChunkSize, indices);
+		// The ray is long, skip the parts of it that pass above or below the terrain
+		ProcessMinMaxPyramidAction processPyramid(this, &indices[0]);
+		processPyramid.rayBegin = beginPos;
+		processPyramid.rayDelta = rayDiff;
+		processPyramid.processTriangles = processTriangles;
+		processPyramid.processNode(m_vboundsLevels.size() - 1, 0, 0, btScalar(0.), btScalar(1.));
 	}
 }
 
-/// Builds a grid data structure storing the min and max heights of the terrain in chunks.
+/// Computes the min and max raw height of all chunks straight from the heightfield data,
+/// comparing the values in their own type and scaling only the result.
+template <typename T>
+static void computeChunkRanges(const T* data, btScalar heightScale, int heightStickWidth, int heightStickLength, int chunkSize, int nChunksX, int nChunksZ, btAlignedObjectArray<btHeightfieldTerrainShape::Range>& grid)
+{
+	for (int cz = 0; cz < nChunksZ; ++cz)
+	{
+		const int z0 = cz * chunkSize;
+
+		for (int cx = 0; cx < nChunksX; ++cx)
+		{
+			const int x0 = cx * chunkSize;
+
+			T lo = data[z0 * heightStickWidth + x0];
+			T hi = lo;
+
+			// Compute min and max height for this chunk.
+			// We have to include one extra cell to account for neighbors.
+			// Here is why:
+			// Say we have a flat terrain, and a plateau that fits a chunk perfectly.
+			//
+			//   Left        Right
+			// 0---0---0---1---1---1
+			// |   |   |   |   |   |
+			// 0---0---0---1---1---1
+			// |   |   |   |   |   |
+			// 0---0---0---1---1---1
+			//           x
+			//
+			// If the AABB for the Left chunk did not share vertices with the Right,
+			// then we would fail collision tests at x due to a gap.
+			//
+			const int z1 = btMin(z0 + chunkSize + 1, heightStickLength);
+			const int x1 = btMin(x0 + chunkSize + 1, heightStickWidth);
+			for (int z = z0; z < z1; ++z)
+			{
+				const T* row = data + z * heightStickWidth;
+				for (int x = x0; x < x1; ++x)
+				{
+					lo = btMin(lo, row[x]);
+					hi = btMax(hi, row[x]);
+				}
+			}
+
+			const btScalar a = btScalar(lo) * heightScale;
+			const btScalar b = btScalar(hi) * heightScale;
+			grid[cx + cz * nChunksX] = btHeightfieldTerrainShape::Range(btMin(a, b), btMax(a, b));
+		}
+	}
+}
+
+/// Builds a grid data structure storing the min and max heights of the terrain in chunks,
+/// and the min-max pyramid over it.
 /// if chunkSize is zero, that accelerator is removed.
 /// If you modify the heights, you need to rebuild this accelerator.
 void btHeightfieldTerrainShape::buildAccelerator(int chunkSize)
@@ -884,63 +1041,90 @@ void btHeightfieldTerrainShape::buildAccelerator(int chunkSize)
 	m_vboundsGrid.resize(nChunksX * nChunksZ);
 	
 	// Compute min and max height for all chunks
-	for (int cz = 0; cz < nChunksZ; ++cz)
+	switch (m_heightDataType)
 	{
-		int z0 = cz * chunkSize;
+		case PHY_FLOAT:
+		{
+			computeChunkRanges(m_heightfieldDataFloat, btScalar(1.), m_heightStickWidth, m_heightStickLength, chunkSize, nChunksX, nChunksZ, m_vboundsGrid);
+			break;
+		}
 
-		for (int cx = 0; cx < nChunksX; ++cx)
+		case PHY_DOUBLE:
 		{
-			int x0 = cx * chunkSize;
+			computeChunkRanges(m_heightfieldDataDouble, btScalar(1.), m_heightStickWidth, m_heightStickLength, chunkSize, nChunksX, nChunksZ, m_vboundsGrid);
+			break;
+		}
 
-			Range r;
+		case PHY_UCHAR:
+		{
+			computeChunkRanges(m_heightfieldDataUnsignedChar, m_heightScale, m_heightStickWidth, m_heightStickLength, chunkSize, nChunksX, nChunksZ, m_vboundsGrid);
+			break;
+		}
 
-			r.min = getRawHeightFieldValue(x0, z0);
-			r.max = r.min;
+		case PHY_SHORT:
+		{
+			computeChunkRanges(m_heightfieldDataShort, m_heightScale, m_heightStickWidth, m_heightStickLength, chunkSize, nChunksX, nChunksZ, m_vboundsGrid);
+			break;
+		}
 
-			// Compute min and max height for this chunk.
-			// We have to include one extra cell to account for neighbors.
-			// Here is why:
-			// Say we have a flat terrain, and a plateau that fits a chunk perfectly.
-			//
-			//   Left        Right
-			// 0---0---0---1---1---1
-			// |   |   |   |   |   |
-			// 0---0---0---1---1---1
-			// |   |   |   |   |   |
-			// 0---0---0---1---1---1
-			//           x
-			//
-			// If the AABB for the Left chunk did not share vertices with the Right,
-			// then we would fail collision tests at x due to a gap.
-			//
-			for (int z = z0; z < z0 + chunkSize + 1; ++z)
-			{
-				if (z >= m_heightStickLength)
-				{
-					continue;
-				}
+		default:
+		{
+			btAssert(!"Bad m_heightDataType");
+		}
+	}
 
-				for (int x = x0; x < x0 + chunkSize + 1; ++x)
-				{
-					if (x >= m_heightStickWidth)
-					{
-						continue;
-					}
+	buildMinMaxPyramid();
+}
 
-					btScalar height = getRawHeightFieldValue(x, z);
+/// Builds the levels above m_vboundsGrid, each node holding the range of 2x2 nodes of the level below,
+/// up to a single node for the whole terrain.
+void btHeightfieldTerrainShape::buildMinMaxPyramid()
+{
+	MinMaxLevel level;
+	level.m_firstNode = 0;
+	level.m_width = m_vboundsGridWidth;
+	level.m_length = m_vboundsGridLength;
+	level.m_cellsPerNode = m_vboundsChunkSize;
+	m_vboundsLevels.resize(0);
+	m_vboundsLevels.push_back(level);
+
+	int numNodes = 0;
+	for (int w = level.m_width, l = level.m_length; w > 1 || l > 1;)
+	{
+		w = (w + 1) / 2;
+		l = (l + 1) / 2;
+		numNodes += w * l;
+	}
+	m_vboundsPyramid.resize(numNodes);
 
-					if (height < r.min)
-					{
-						r.min = height;
-					}
-					else if (height > r.max)
+	int firstNode = 0;
+	while (level.m_width > 1 || level.m_length > 1)
+	{
+		const int childLevel = m_vboundsLevels.size() - 1;
+		const MinMaxLevel child = level;
+		level.m_firstNode = firstNode;
+		level.m_width = (child.m_width + 1) / 2;
+		level.m_length = (child.m_length + 1) / 2;
+		level.m_cellsPerNode = child.m_cellsPerNode * 2;
+		m_vboundsLevels.push_back(level);
+		firstNode += level.m_width * level.m_length;
+
+		for (int z = 0; z < level.m_length; ++z)
+		{
+			for (int x = 0; x < level.m_width; ++x)
+			{
+				Range r = getAcceleratorRange(childLevel, 2 * x, 2 * z);
+				for (int j = 2 * z; j < 2 * z + 2 && j < child.m_length; ++j)
+				{
+					for (int i = 2 * x; i < 2 * x + 2 && i < child.m_width; ++i)
 					{
-						r.max = height;
+						const Range& c = getAcceleratorRange(childLevel, i, j);
+						r.min = btMin(r.min, c.min);
+						r.max = btMax(r.max, c.max);
 					}
 				}
+				m_vboundsPyramid[level.m_firstNode + x + z * level.m_width] = r;
 			}
-
-			m_vboundsGrid[cx + cz * nChunksX] = r;
 		}
 	}
 }
@@ -948,4 +1132,6 @@ void btHeightfieldTerrainShape::buildAccelerator(int chunkSize)
 void btHeightfieldTerrainShape::clearAccelerator()
 {
 	m_vboundsGrid.clear();
+	m_vboundsPyramid.clear();
+	m_vboundsLevels.clear();
 }
@@ -85,6 +85,16 @@ public:
 		btScalar max;
 	};
 
+	///one level of the min-max pyramid built by buildAccelerator. Level 0 is m_vboundsGrid,
+	///a node of level i+1 holds the ranges of 2x2 nodes of level i
+	struct MinMaxLevel
+	{
+		int m_firstNode;  // index into m_vboundsGrid for level 0, into m_vboundsPyramid for the others
+		int m_width;
+		int m_length;
+		int m_cellsPerNode;
+	};
+
 protected:
 	btVector3 m_localAabbMin;
 	btVector3 m_localAabbMax;
@@ -120,8 +130,9 @@ protected:
 	int m_vboundsGridWidth;
 	int m_vboundsGridLength;
 	int m_vboundsChunkSize;
+	btAlignedObjectArray<Range> m_vboundsPyramid;
+	btAlignedObjectArray<MinMaxLevel> m_vboundsLevels;
 
-	
 	btScalar m_userValue3;
 
 	struct btTriangleInfoMap* m_triangleInfoMap;
@@ -129,6 +140,10 @@ protected:
 	virtual btScalar getRawHeightFieldValue(int x, int y) const;
 	void quantizeWithClamp(int* out, const btVector3& point, int isMax) const;
 
+	void processQuads(btTriangleCallback * callback, int startX, int endX, int startJ, int endJ, const Range& aabbUpRange) const;
+	void processQuadsInNode(btTriangleCallback * callback, int level, int nodeX, int nodeJ, int startX, int endX, int startJ, int endJ, const Range& aabbUpRange, const Range& rawUpRange) const;
+	void buildMinMaxPyramid();
+
 	/// protected initialization
 	/**
 	  Handles the work of constructors so that public constructors can be
@@ -210,9 +225,31 @@ public:
 
 	void performRaycast(btTriangleCallback * callback, const btVector3& raySource, const btVector3& rayTarget) const;
 
+	/// Builds a min-max pyramid over the heights: level 0 holds the range of heights of each chunk of
+	/// chunkSize x chunkSize quads, every further level halves the resolution down to a single node.
+	/// performRaycast skips the parts of long rays that pass above or below the terrain at the coarsest
+	/// level it can, and processAllTriangles skips chunks the aabb is above or below of.
+	/// Smaller chunks cull more precisely, for a 4k x 4k terrain the accelerator takes 0.7 MB at 16 and 11 MB at 4.
+	/// The heights are read from the heightfield data array, so rebuild the accelerator after changing them.
 	void buildAccelerator(int chunkSize = 16);
 	void clearAccelerator();
 
+	int getNumAcceleratorLevels() const
+	{
+		return m_vboundsLevels.size();
+	}
+	const MinMaxLevel& getAcceleratorLevel(int level) const
+	{
+		return m_vboundsLevels[level];
+	}
+	///the range of raw heights of the quads under a node, including the vertices shared with the neighbor nodes
+	const Range& getAcceleratorRange(int level, int x, int z) const
+	{
+		const MinMaxLevel& l = m_vboundsLevels[level];
+		const int index = l.m_firstNode + x + z * l.m_width;
+		return level == 0 ? m_vboundsGrid[index] : m_vboundsPyramid[index];
+	}
+
 	int getUpAxis() const
 	{
 		return m_upAxis;
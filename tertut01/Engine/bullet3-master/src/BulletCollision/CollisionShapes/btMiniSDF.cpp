@@ -152,6 +152,93 @@ bool btMiniSDF::load(const char* data, int size)
 	return m_isValid;
 }
 
+struct btSdfDataWriter
+{
+	char* m_data;
+	int m_currentOffset;
+
+	btSdfDataWriter(char* data)
+		: m_data(data),
+		  m_currentOffset(0)
+	{
+	}
+
+	template <class T>
+	void write(const T& val)
+	{
+		memcpy(&m_data[m_currentOffset], &val, sizeof(T));
+		m_currentOffset += sizeof(T);
+	}
+};
+
+void btMiniSDF::save(btAlignedObjectArray<char>& data) const
+{
+	int size = 6 * sizeof(double) + 3 * sizeof(unsigned int) + 6 * sizeof(double) + 5 * sizeof(unsigned long long int);
+	for (int i = 0; i < m_nodes.size(); i++)
+	{
+		size += sizeof(unsigned long long int) + m_nodes[i].size() * sizeof(double);
+	}
+	for (int i = 0; i < m_cells.size(); i++)
+	{
+		size += sizeof(unsigned long long int) + m_cells[i].size() * sizeof(btCell32);
+	}
+	for (int i = 0; i < m_cell_map.size(); i++)
+	{
+		size += sizeof(unsigned long long int) + m_cell_map[i].size() * sizeof(unsigned int);
+	}
+	data.resize(size);
+
+	btSdfDataWriter ds(&data[0]);
+	for (int i = 0; i < 3; i++)
+	{
+		ds.write(double(m_domain.m_min[i]));
+	}
+	for (int i = 0; i < 3; i++)
+	{
+		ds.write(double(m_domain.m_max[i]));
+	}
+	ds.write(m_resolution);
+	for (int i = 0; i < 3; i++)
+	{
+		ds.write(double(m_cell_size[i]));
+	}
+	for (int i = 0; i < 3; i++)
+	{
+		ds.write(double(m_inv_cell_size[i]));
+	}
+	ds.write((unsigned long long int)m_n_cells);
+	ds.write((unsigned long long int)m_n_fields);
+
+	ds.write((unsigned long long int)m_nodes.size());
+	for (int i = 0; i < m_nodes.size(); i++)
+	{
+		ds.write((unsigned long long int)m_nodes[i].size());
+		for (int j = 0; j < m_nodes[i].size(); j++)
+		{
+			ds.write(m_nodes[i][j]);
+		}
+	}
+	ds.write((unsigned long long int)m_cells.size());
+	for (int i = 0; i < m_cells.size(); i++)
+	{
+		ds.write((unsigned long long int)m_cells[i].size());
+		for (int j = 0; j < m_cells[i].size(); j++)
+		{
+			ds.write(m_cells[i][j]);
+		}
+	}
+	ds.write((unsigned long long int)m_cell_map.size());
+	for (int i = 0; i < m_cell_map.size(); i++)
+	{
+		ds.write((unsigned long long int)m_cell_map[i].size());
+		for (int j = 0; j < m_cell_map[i].size(); j++)
+		{
+			ds.write(m_cell_map[i][j]);
+		}
+	}
+	btAssert(ds.m_currentOffset == size);
+}
+
 unsigned int btMiniSDF::multiToSingleIndex(btMultiIndex const& ijk) const
 {
 	return m_resolution[1] * m_resolution[0] * ijk.ijk[2] + m_resolution[0] * ijk.ijk[1] + ijk.ijk[0];
@@ -106,6 +106,8 @@ struct btMiniSDF
 	{
 	}
 	bool load(const char* data, int size);
+	///writes the sdf in the format that load reads
+	void save(btAlignedObjectArray<char>& data) const;
 	bool isValid() const
 	{
 		return m_isValid;
@@ -26,7 +26,7 @@ btOptimizedBvh::~btOptimizedBvh()
 {
 }
 
-void btOptimizedBvh::build(btStridingMeshInterface* triangles, bool useQuantizedAabbCompression, const btVector3& bvhAabbMin, const btVector3& bvhAabbMax)
+void btOptimizedBvh::build(btStridingMeshInterface* triangles, bool useQuantizedAabbCompression, const btVector3& bvhAabbMin, const btVector3& bvhAabbMax, bool useSurfaceAreaHeuristic)
 {
 	m_useQuantization = useQuantizedAabbCompression;
 
@@ -167,9 +167,16 @@ void btOptimizedBvh::build(btStridingMeshInterface* triangles, bool useQuantized
 		m_contiguousNodes.resize(2 * numLeafNodes);
 	}
 
-	m_curNodeIndex = 0;
+	if (m_useQuantization && useSurfaceAreaHeuristic)
+	{
+		buildTreeSAH(numLeafNodes);
+	}
+	else
+	{
+		m_curNodeIndex = 0;
 
-	buildTree(0, numLeafNodes);
+		buildTree(0, numLeafNodes);
+	}
 
 	///if the entire tree is small then subtree size, we need to create a header info for the tree
 	if (m_useQuantization && !m_SubtreeHeaders.size())
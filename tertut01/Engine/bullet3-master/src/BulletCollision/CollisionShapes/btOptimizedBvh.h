@@ -35,7 +35,9 @@ public:
 
 	virtual ~btOptimizedBvh();
 
-	void build(btStridingMeshInterface * triangles, bool useQuantizedAabbCompression, const btVector3& bvhAabbMin, const btVector3& bvhAabbMax);
+	///useSurfaceAreaHeuristic builds quantized trees like buildInternalSAH, which takes about as long but gives faster queries.
+	///Trees without quantization always use the mean split
+	void build(btStridingMeshInterface * triangles, bool useQuantizedAabbCompression, const btVector3& bvhAabbMin, const btVector3& bvhAabbMax, bool useSurfaceAreaHeuristic = false);
 
 	void refit(btStridingMeshInterface * triangles, const btVector3& aabbMin, const btVector3& aabbMax);
 
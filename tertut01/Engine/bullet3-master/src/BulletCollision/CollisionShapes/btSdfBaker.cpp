@@ -0,0 +1,696 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2009 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "btSdfBaker.h"
+#include "btMiniSDF.h"
+#include "btStridingMeshInterface.h"
+#include "btTriangleCallback.h"
+#include "LinearMath/btThreads.h"
+
+#include <float.h>
+#include <limits.h>
+
+//
+// The cells and nodes follow the cubic Lagrange discretization of DiscreGrid that btMiniSDF interpolates:
+// 8 corner nodes and 2 nodes on each of the 12 edges of a cell, at one and two thirds of the edge. The corner nodes
+// are numbered first, then the nodes on the edges along x, y and z, each edge once for all cells that share it.
+//
+
+static const int btSdfBakerLeafSize = 4;
+
+// below this depth the hierarchy splits in halves, which keeps the traversal stacks small
+static const int btSdfBakerMaxMidpointDepth = 40;
+static const int btSdfBakerStackSize = 128;
+
+// the far field of the winding number is used for nodes whose distance is larger than this times their radius
+static const btScalar btSdfBakerWindingAccuracy = btScalar(2);
+
+struct btSdfBakerNode
+{
+	btVector3 m_aabbMin;
+	btVector3 m_aabbMax;
+	// area weighted center and normal of the triangles, the dipole of the far field of the winding number
+	btVector3 m_center;
+	btVector3 m_areaNormal;
+	btScalar m_radius;
+	// leaf nodes have m_count triangles from m_first, inner nodes have their children at index + 1 and m_first
+	int m_first;
+	int m_count;
+};
+
+struct btSdfBakerTriangleCollector : public btInternalTriangleIndexCallback
+{
+	btAlignedObjectArray<btVector3> m_vertices;
+
+	virtual void internalProcessTriangleIndex(btVector3* triangle, int partId, int triangleIndex)
+	{
+		m_vertices.push_back(triangle[0]);
+		m_vertices.push_back(triangle[1]);
+		m_vertices.push_back(triangle[2]);
+	}
+};
+
+static btVector3 btSdfBakerClosestPointOnTriangle(const btVector3& p, const btVector3& a, const btVector3& b, const btVector3& c)
+{
+	const btVector3 ab = b - a;
+	const btVector3 ac = c - a;
+	const btVector3 ap = p - a;
+	const btScalar d1 = ab.dot(ap);
+	const btScalar d2 = ac.dot(ap);
+	if (d1 <= btScalar(0) && d2 <= btScalar(0))
+	{
+		return a;
+	}
+	const btVector3 bp = p - b;
+	const btScalar d3 = ab.dot(bp);
+	const btScalar d4 = ac.dot(bp);
+	if (d3 >= btScalar(0) && d4 <= d3)
+	{
+		return b;
+	}
+	const btScalar vc = d1 * d4 - d3 * d2;
+	if (vc <= btScalar(0) && d1 >= btScalar(0) && d3 <= btScalar(0))
+	{
+		return a + ab * (d1 / (d1 - d3));
+	}
+	const btVector3 cp = p - c;
+	const btScalar d5 = ab.dot(cp);
+	const btScalar d6 = ac.dot(cp);
+	if (d6 >= btScalar(0) && d5 <= d6)
+	{
+		return c;
+	}
+	const btScalar vb = d5 * d2 - d1 * d6;
+	if (vb <= btScalar(0) && d2 >= btScalar(0) && d6 <= btScalar(0))
+	{
+		return a + ac * (d2 / (d2 - d6));
+	}
+	const btScalar va = d3 * d6 - d5 * d4;
+	if (va <= btScalar(0) && (d4 - d3) >= btScalar(0) && (d5 - d6) >= btScalar(0))
+	{
+		return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+	}
+	const btScalar denom = btScalar(1) / (va + vb + vc);
+	return a + ab * (vb * denom) + ac * (vc * denom);
+}
+
+// solid angle of the triangle seen from the origin, positive if the triangle winds counter-clockwise around it
+static btScalar btSdfBakerSolidAngle(const btVector3& a, const btVector3& b, const btVector3& c)
+{
+	const btScalar la = a.length();
+	const btScalar lb = b.length();
+	const btScalar lc = c.length();
+	const btScalar numerator = a.dot(b.cross(c));
+	const btScalar denominator = la * lb * lc + a.dot(b) * lc + b.dot(c) * la + c.dot(a) * lb;
+	return btScalar(2) * btAtan2(numerator, denominator);
+}
+
+class btSdfBakerMesh
+{
+	btAlignedObjectArray<btVector3> m_vertices;
+	btAlignedObjectArray<btSdfBakerNode> m_nodes;
+
+	int build(btAlignedObjectArray<int>& triangles, const btAlignedObjectArray<btVector3>& centroids, int begin, int end, int depth, const btAlignedObjectArray<btVector3>& vertices)
+	{
+		const int nodeIndex = m_nodes.size();
+		m_nodes.expand();
+
+		btVector3 aabbMin = vertices[3 * triangles[begin]];
+		btVector3 aabbMax = aabbMin;
+		btVector3 centroidMin = centroids[triangles[begin]];
+		btVector3 centroidMax = centroidMin;
+		btVector3 center(0, 0, 0);
+		btVector3 areaNormal(0, 0, 0);
+		btScalar area = 0;
+		for (int i = begin; i < end; i++)
+		{
+			const btVector3* v = &vertices[3 * triangles[i]];
+			for (int k = 0; k < 3; k++)
+			{
+				aabbMin.setMin(v[k]);
+				aabbMax.setMax(v[k]);
+			}
+			centroidMin.setMin(centroids[triangles[i]]);
+			centroidMax.setMax(centroids[triangles[i]]);
+			const btVector3 normal = (v[1] - v[0]).cross(v[2] - v[0]) * btScalar(0.5);
+			const btScalar triangleArea = normal.length();
+			center += centroids[triangles[i]] * triangleArea;
+			areaNormal += normal;
+			area += triangleArea;
+		}
+		center = (area > btScalar(0)) ? center / area : (aabbMin + aabbMax) * btScalar(0.5);
+		btScalar radius2 = 0;
+		for (int i = begin; i < end; i++)
+		{
+			const btVector3* v = &vertices[3 * triangles[i]];
+			for (int k = 0; k < 3; k++)
+			{
+				radius2 = btMax(radius2, (v[k] - center).length2());
+			}
+		}
+		{
+			btSdfBakerNode& node = m_nodes[nodeIndex];
+			node.m_aabbMin = aabbMin;
+			node.m_aabbMax = aabbMax;
+			node.m_center = center;
+			node.m_areaNormal = areaNormal;
+			node.m_radius = btSqrt(radius2);
+		}
+
+		if (end - begin <= btSdfBakerLeafSize)
+		{
+			m_nodes[nodeIndex].m_first = begin;
+			m_nodes[nodeIndex].m_count = end - begin;
+			return nodeIndex;
+		}
+
+		// split at the middle of the centroids along the longest axis, or in halves if that leaves one side empty
+		int mid = (begin + end) / 2;
+		if (depth < btSdfBakerMaxMidpointDepth)
+		{
+			const int axis = (centroidMax - centroidMin).maxAxis();
+			const btScalar split = (centroidMin[axis] + centroidMax[axis]) * btScalar(0.5);
+			int numLeft = begin;
+			for (int i = begin; i < end; i++)
+			{
+				if (centroids[triangles[i]][axis] < split)
+				{
+					triangles.swap(i, numLeft);
+					numLeft++;
+				}
+			}
+			if (numLeft > begin && numLeft < end)
+			{
+				mid = numLeft;
+			}
+		}
+		build(triangles, centroids, begin, mid, depth + 1, vertices);
+		const int right = build(triangles, centroids, mid, end, depth + 1, vertices);
+		m_nodes[nodeIndex].m_first = right;
+		m_nodes[nodeIndex].m_count = 0;
+		return nodeIndex;
+	}
+
+	static btScalar aabbDistance2(const btSdfBakerNode& node, const btVector3& p)
+	{
+		btVector3 d = node.m_aabbMin - p;
+		d.setMax(p - node.m_aabbMax);
+		d.setMax(btVector3(0, 0, 0));
+		return d.length2();
+	}
+
+public:
+	// builds the hierarchy and stores the triangles in its order, returns false for a mesh without triangles
+	bool init(const btAlignedObjectArray<btVector3>& vertices)
+	{
+		const int numTriangles = vertices.size() / 3;
+		if (numTriangles == 0)
+		{
+			return false;
+		}
+		btAlignedObjectArray<int> triangles;
+		btAlignedObjectArray<btVector3> centroids;
+		triangles.resize(numTriangles);
+		centroids.resize(numTriangles);
+		for (int i = 0; i < numTriangles; i++)
+		{
+			triangles[i] = i;
+			centroids[i] = (vertices[3 * i] + vertices[3 * i + 1] + vertices[3 * i + 2]) / btScalar(3);
+		}
+		m_nodes.reserve(2 * (numTriangles / btSdfBakerLeafSize + 1));
+		build(triangles, centroids, 0, numTriangles, 0, vertices);
+
+		m_vertices.resize(vertices.size());
+		for (int i = 0; i < numTriangles; i++)
+		{
+			for (int k = 0; k < 3; k++)
+			{
+				m_vertices[3 * i + k] = vertices[3 * triangles[i] + k];
+			}
+		}
+		return true;
+	}
+
+	// squared distance to the closest triangle, or maxDistance2 if all triangles are farther
+	btScalar closestDistance2(const btVector3& p, btScalar maxDistance2) const
+	{
+		btScalar best = maxDistance2;
+		int stack[btSdfBakerStackSize];
+		int stackSize = 0;
+		int nodeIndex = 0;
+		for (;;)
+		{
+			const btSdfBakerNode& node = m_nodes[nodeIndex];
+			if (node.m_count)
+			{
+				for (int i = node.m_first; i < node.m_first + node.m_count; i++)
+				{
+					const btVector3* v = &m_vertices[3 * i];
+					best = btMin(best, (btSdfBakerClosestPointOnTriangle(p, v[0], v[1], v[2]) - p).length2());
+				}
+			}
+			else
+			{
+				// the closer child first
+				int children[2] = {nodeIndex + 1, node.m_first};
+				btScalar distances[2];
+				for (int k = 0; k < 2; k++)
+				{
+					distances[k] = aabbDistance2(m_nodes[children[k]], p);
+				}
+				if (distances[1] < distances[0])
+				{
+					btSwap(children[0], children[1]);
+					btSwap(distances[0], distances[1]);
+				}
+				if (distances[1] < best)
+				{
+					btAssert(stackSize < btSdfBakerStackSize);
+					stack[stackSize++] = children[1];
+				}
+				if (distances[0] < best)
+				{
+					nodeIndex = children[0];
+					continue;
+				}
+			}
+			// pop the next node that can still be closer
+			for (;;)
+			{
+				if (!stackSize)
+				{
+					return best;
+				}
+				nodeIndex = stack[--stackSize];
+				if (aabbDistance2(m_nodes[nodeIndex], p) < best)
+				{
+					break;
+				}
+			}
+		}
+	}
+
+	// generalized winding number, the far field of a node is approximated by the dipole of its triangles
+	btScalar windingNumber(const btVector3& p) const
+	{
+		btScalar solidAngle = 0;
+		int stack[btSdfBakerStackSize];
+		int stackSize = 0;
+		stack[stackSize++] = 0;
+		while (stackSize)
+		{
+			const int nodeIndex = stack[--stackSize];
+			const btSdfBakerNode& node = m_nodes[nodeIndex];
+			const btVector3 r = node.m_center - p;
+			const btScalar distance = r.length();
+			if (distance > btSdfBakerWindingAccuracy * node.m_radius)
+			{
+				solidAngle += r.dot(node.m_areaNormal) / (distance * distance * distance);
+			}
+			else if (node.m_count)
+			{
+				for (int i = node.m_first; i < node.m_first + node.m_count; i++)
+				{
+					const btVector3* v = &m_vertices[3 * i];
+					solidAngle += btSdfBakerSolidAngle(v[0] - p, v[1] - p, v[2] - p);
+				}
+			}
+			else
+			{
+				btAssert(stackSize + 2 <= btSdfBakerStackSize);
+				stack[stackSize++] = nodeIndex + 1;
+				stack[stackSize++] = node.m_first;
+			}
+		}
+		return solidAngle / (btScalar(4) * SIMD_PI);
+	}
+
+	// maxDistance has to be larger than the distance, it only speeds up the search
+	btScalar signedDistance(const btVector3& p, btScalar maxDistance, btScalar& distance) const
+	{
+		distance = btSqrt(closestDistance2(p, maxDistance * maxDistance));
+		return (windingNumber(p) > btScalar(0.5)) ? -distance : distance;
+	}
+
+	void getAabb(btVector3& aabbMin, btVector3& aabbMax) const
+	{
+		aabbMin = m_nodes[0].m_aabbMin;
+		aabbMax = m_nodes[0].m_aabbMax;
+	}
+
+	// collects the triangles of the mesh and builds the hierarchy, returns false for a mesh without triangles
+	bool init(const btStridingMeshInterface* mesh)
+	{
+		btSdfBakerTriangleCollector collector;
+		mesh->InternalProcessAllTriangles(&collector, btVector3(-BT_LARGE_FLOAT, -BT_LARGE_FLOAT, -BT_LARGE_FLOAT), btVector3(BT_LARGE_FLOAT, BT_LARGE_FLOAT, BT_LARGE_FLOAT));
+		return init(collector.m_vertices);
+	}
+};
+
+struct btSdfBakerGrid
+{
+	unsigned int m_resolution[3];
+	btVector3 m_domainMin;
+	btVector3 m_cellSize;
+	unsigned int m_numVertices;
+	unsigned int m_numEdgesX;
+	unsigned int m_numEdgesY;
+
+	void init(const int* resolution, const btVector3& domainMin, const btVector3& cellSize)
+	{
+		const unsigned int nx = resolution[0];
+		const unsigned int ny = resolution[1];
+		const unsigned int nz = resolution[2];
+		m_resolution[0] = nx;
+		m_resolution[1] = ny;
+		m_resolution[2] = nz;
+		m_domainMin = domainMin;
+		m_cellSize = cellSize;
+		m_numVertices = (nx + 1) * (ny + 1) * (nz + 1);
+		m_numEdgesX = nx * (ny + 1) * (nz + 1);
+		m_numEdgesY = (nx + 1) * ny * (nz + 1);
+	}
+
+	static btScalar numNodes(const int* resolution)
+	{
+		const btScalar nx = btScalar(resolution[0]);
+		const btScalar ny = btScalar(resolution[1]);
+		const btScalar nz = btScalar(resolution[2]);
+		const btScalar numVertices = (nx + 1) * (ny + 1) * (nz + 1);
+		const btScalar numEdges = nx * (ny + 1) * (nz + 1) + (nx + 1) * ny * (nz + 1) + (nx + 1) * (ny + 1) * nz;
+		return numVertices + 2 * numEdges;
+	}
+
+	unsigned int numNodes() const
+	{
+		const unsigned int nx = m_resolution[0];
+		const unsigned int ny = m_resolution[1];
+		const unsigned int nz = m_resolution[2];
+		return m_numVertices + 2 * (m_numEdgesX + m_numEdgesY + (nx + 1) * (ny + 1) * nz);
+	}
+
+	btVector3 cellCenter(unsigned int cell) const
+	{
+		const unsigned int nx = m_resolution[0];
+		const unsigned int ny = m_resolution[1];
+		const unsigned int k = cell / (nx * ny);
+		const unsigned int j = (cell % (nx * ny)) / nx;
+		const unsigned int i = cell % nx;
+		return m_domainMin + m_cellSize * btVector3(btScalar(i) + btScalar(0.5), btScalar(j) + btScalar(0.5), btScalar(k) + btScalar(0.5));
+	}
+
+	void cellNodes(unsigned int cell, btCell32& nodes) const
+	{
+		const unsigned int nx = m_resolution[0];
+		const unsigned int ny = m_resolution[1];
+		const unsigned int nz = m_resolution[2];
+		const unsigned int k = cell / (nx * ny);
+		const unsigned int j = (cell % (nx * ny)) / nx;
+		const unsigned int i = cell % nx;
+		unsigned int* n = nodes.m_cells;
+
+		n[0] = (nx + 1) * (ny + 1) * k + (nx + 1) * j + i;
+		n[1] = n[0] + 1;
+		n[2] = n[0] + nx + 1;
+		n[3] = n[2] + 1;
+		n[4] = n[0] + (nx + 1) * (ny + 1);
+		n[5] = n[4] + 1;
+		n[6] = n[4] + nx + 1;
+		n[7] = n[6] + 1;
+
+		unsigned int offset = m_numVertices;
+		n[8] = offset + 2 * (nx * (ny + 1) * k + nx * j + i);
+		n[10] = offset + 2 * (nx * (ny + 1) * (k + 1) + nx * j + i);
+		n[12] = offset + 2 * (nx * (ny + 1) * k + nx * (j + 1) + i);
+		n[14] = offset + 2 * (nx * (ny + 1) * (k + 1) + nx * (j + 1) + i);
+
+		offset += 2 * m_numEdgesX;
+		n[16] = offset + 2 * (ny * (nz + 1) * i + ny * k + j);
+		n[18] = offset + 2 * (ny * (nz + 1) * (i + 1) + ny * k + j);
+		n[20] = offset + 2 * (ny * (nz + 1) * i + ny * (k + 1) + j);
+		n[22] = offset + 2 * (ny * (nz + 1) * (i + 1) + ny * (k + 1) + j);
+
+		offset += 2 * m_numEdgesY;
+		n[24] = offset + 2 * (nz * (nx + 1) * j + nz * i + k);
+		n[26] = offset + 2 * (nz * (nx + 1) * (j + 1) + nz * i + k);
+		n[28] = offset + 2 * (nz * (nx + 1) * j + nz * (i + 1) + k);
+		n[30] = offset + 2 * (nz * (nx + 1) * (j + 1) + nz * (i + 1) + k);
+
+		for (int e = 8; e < 32; e += 2)
+		{
+			n[e + 1] = n[e] + 1;
+		}
+	}
+
+	btVector3 nodePosition(unsigned int node) const
+	{
+		const unsigned int nx = m_resolution[0];
+		const unsigned int ny = m_resolution[1];
+		const unsigned int nz = m_resolution[2];
+		if (node < m_numVertices)
+		{
+			const unsigned int k = node / ((nx + 1) * (ny + 1));
+			const unsigned int temp = node % ((nx + 1) * (ny + 1));
+			return m_domainMin + m_cellSize * btVector3(btScalar(temp % (nx + 1)), btScalar(temp / (nx + 1)), btScalar(k));
+		}
+		node -= m_numVertices;
+		const btScalar third = btScalar(1 + node % 2) / btScalar(3);
+		if (node < 2 * m_numEdgesX)
+		{
+			const unsigned int edge = node / 2;
+			const unsigned int k = edge / (nx * (ny + 1));
+			const unsigned int temp = edge % (nx * (ny + 1));
+			return m_domainMin + m_cellSize * btVector3(btScalar(temp % nx) + third, btScalar(temp / nx), btScalar(k));
+		}
+		node -= 2 * m_numEdgesX;
+		if (node < 2 * m_numEdgesY)
+		{
+			const unsigned int edge = node / 2;
+			const unsigned int i = edge / (ny * (nz + 1));
+			const unsigned int temp = edge % (ny * (nz + 1));
+			return m_domainMin + m_cellSize * btVector3(btScalar(i), btScalar(temp % ny) + third, btScalar(temp / ny));
+		}
+		node -= 2 * m_numEdgesY;
+		const unsigned int edge = node / 2;
+		const unsigned int j = edge / (nz * (nx + 1));
+		const unsigned int temp = edge % (nz * (nx + 1));
+		return m_domainMin + m_cellSize * btVector3(btScalar(temp / nz), btScalar(j), btScalar(temp % nz) + third);
+	}
+};
+
+static void btSdfBakerParallelFor(int iBegin, int iEnd, int grainSize, const btIParallelForBody& body)
+{
+#if BT_THREADSAFE
+	btITaskScheduler* scheduler = btGetTaskScheduler();
+	if (scheduler && scheduler->getNumThreads() > 1 && !btThreadsAreRunning())
+	{
+		btParallelFor(iBegin, iEnd, grainSize, body);
+		return;
+	}
+#endif  // #if BT_THREADSAFE
+	body.forLoop(iBegin, iEnd);
+}
+
+// flags the cells whose center is closer to the surface than the narrow band plus half their diagonal
+struct btSdfBakerNarrowBandLoop : public btIParallelForBody
+{
+	const btSdfBakerMesh* m_mesh;
+	const btSdfBakerGrid* m_grid;
+	btScalar m_maxDistance;
+	unsigned char* m_inBand;
+
+	void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
+	{
+		const btScalar maxDistance2 = m_maxDistance * m_maxDistance;
+		for (int i = iBegin; i < iEnd; i++)
+		{
+			m_inBand[i] = m_mesh->closestDistance2(m_grid->cellCenter(i), maxDistance2) < maxDistance2;
+		}
+	}
+};
+
+struct btSdfBakerNodeLoop : public btIParallelForBody
+{
+	const btSdfBakerMesh* m_mesh;
+	const btSdfBakerGrid* m_grid;
+	const unsigned int* m_nodeIndices;
+	double* m_values;
+
+	void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
+	{
+		// the distance of the previous node plus the distance between the nodes bounds the distance of the next one,
+		// enlarged a little so that the closest triangle is found the same way for any range of nodes
+		btVector3 previous(0, 0, 0);
+		btScalar previousDistance = BT_LARGE_FLOAT;
+		for (int i = iBegin; i < iEnd; i++)
+		{
+			const btVector3 p = m_grid->nodePosition(m_nodeIndices[i]);
+			const btScalar maxDistance = (previousDistance + (p - previous).length()) * btScalar(1.001) + SIMD_EPSILON;
+			m_values[i] = m_mesh->signedDistance(p, btMin(maxDistance, btScalar(BT_LARGE_FLOAT)), previousDistance);
+			previous = p;
+		}
+	}
+};
+
+static bool btSdfBakerBake(const btSdfBaker& baker, const btSdfBakerMesh& mesh, const btVector3& domainMin, const btVector3& domainMax, btMiniSDF& sdf)
+{
+	sdf.m_isValid = false;
+	for (int k = 0; k < 3; k++)
+	{
+		if (baker.m_resolution[k] <= 0 || !(domainMax[k] > domainMin[k]))
+		{
+			return false;
+		}
+	}
+	// btMiniSDF indexes cells and nodes with 32 bit unsigned integers
+	if (btSdfBakerGrid::numNodes(baker.m_resolution) >= btScalar(UINT_MAX))
+	{
+		return false;
+	}
+
+	const btVector3 cellSize = (domainMax - domainMin) / btVector3(btScalar(baker.m_resolution[0]), btScalar(baker.m_resolution[1]), btScalar(baker.m_resolution[2]));
+	btSdfBakerGrid grid;
+	grid.init(baker.m_resolution, domainMin, cellSize);
+	const unsigned int numCells = grid.m_resolution[0] * grid.m_resolution[1] * grid.m_resolution[2];
+	const unsigned int numNodes = grid.numNodes();
+
+	btAlignedObjectArray<unsigned char> inBand;
+	inBand.resize(numCells);
+	if (baker.m_narrowBand > btScalar(0))
+	{
+		btSdfBakerNarrowBandLoop bandLoop;
+		bandLoop.m_mesh = &mesh;
+		bandLoop.m_grid = &grid;
+		bandLoop.m_maxDistance = baker.m_narrowBand + cellSize.length() * btScalar(0.5);
+		bandLoop.m_inBand = &inBand[0];
+		btSdfBakerParallelFor(0, numCells, 256, bandLoop);
+	}
+	else
+	{
+		for (unsigned int i = 0; i < numCells; i++)
+		{
+			inBand[i] = 1;
+		}
+	}
+	// the nodes of the cells in the band, numbered in the order of the grid
+	btAlignedObjectArray<unsigned int> nodeMap;
+	nodeMap.resize(numNodes, UINT_MAX);
+	btCell32 cellNodes;
+	for (unsigned int i = 0; i < numCells; i++)
+	{
+		if (inBand[i])
+		{
+			grid.cellNodes(i, cellNodes);
+			for (int j = 0; j < 32; j++)
+			{
+				nodeMap[cellNodes.m_cells[j]] = 0;
+			}
+		}
+	}
+	btAlignedObjectArray<unsigned int> nodeIndices;
+	for (unsigned int i = 0; i < numNodes; i++)
+	{
+		if (nodeMap[i] == 0)
+		{
+			nodeMap[i] = nodeIndices.size();
+			nodeIndices.push_back(i);
+		}
+	}
+
+	sdf.m_nodes.resize(1);
+	sdf.m_cells.resize(1);
+	sdf.m_cell_map.resize(1);
+	btAlignedObjectArray<double>& nodes = sdf.m_nodes[0];
+	btAlignedObjectArray<btCell32>& cells = sdf.m_cells[0];
+	btAlignedObjectArray<unsigned int>& cellMap = sdf.m_cell_map[0];
+	nodes.resize(nodeIndices.size());
+	if (nodeIndices.size())
+	{
+		btSdfBakerNodeLoop nodeLoop;
+		nodeLoop.m_mesh = &mesh;
+		nodeLoop.m_grid = &grid;
+		nodeLoop.m_nodeIndices = &nodeIndices[0];
+		nodeLoop.m_values = &nodes[0];
+		btSdfBakerParallelFor(0, nodeIndices.size(), 64, nodeLoop);
+	}
+
+	cells.resize(0);
+	cellMap.resize(numCells);
+	for (unsigned int i = 0; i < numCells; i++)
+	{
+		if (inBand[i])
+		{
+			grid.cellNodes(i, cellNodes);
+			for (int j = 0; j < 32; j++)
+			{
+				cellNodes.m_cells[j] = nodeMap[cellNodes.m_cells[j]];
+			}
+			cellMap[i] = cells.size();
+			cells.push_back(cellNodes);
+		}
+		else
+		{
+			cellMap[i] = UINT_MAX;
+		}
+	}
+
+	sdf.m_domain = btAlignedBox3d(domainMin, domainMax);
+	sdf.m_domain.m_min[3] = 0;
+	sdf.m_domain.m_max[3] = 0;
+	for (int k = 0; k < 3; k++)
+	{
+		sdf.m_resolution[k] = grid.m_resolution[k];
+	}
+	sdf.m_cell_size = cellSize;
+	sdf.m_inv_cell_size = btVector3(btScalar(1), btScalar(1), btScalar(1)) / cellSize;
+	sdf.m_n_cells = numCells;
+	sdf.m_n_fields = 1;
+	sdf.m_isValid = true;
+	return true;
+}
+
+btSdfBaker::btSdfBaker()
+	: m_narrowBand(0),
+	  m_domainMargin(btScalar(0.1))
+{
+	m_resolution[0] = 32;
+	m_resolution[1] = 32;
+	m_resolution[2] = 32;
+}
+
+bool btSdfBaker::bake(const btStridingMeshInterface* mesh, btMiniSDF& sdf) const
+{
+	btSdfBakerMesh bakerMesh;
+	if (!bakerMesh.init(mesh))
+	{
+		sdf.m_isValid = false;
+		return false;
+	}
+	btVector3 aabbMin, aabbMax;
+	bakerMesh.getAabb(aabbMin, aabbMax);
+	const btVector3 margin(m_domainMargin, m_domainMargin, m_domainMargin);
+	return btSdfBakerBake(*this, bakerMesh, aabbMin - margin, aabbMax + margin, sdf);
+}
+
+bool btSdfBaker::bake(const btStridingMeshInterface* mesh, const btVector3& domainMin, const btVector3& domainMax, btMiniSDF& sdf) const
+{
+	btSdfBakerMesh bakerMesh;
+	if (!bakerMesh.init(mesh))
+	{
+		sdf.m_isValid = false;
+		return false;
+	}
+	return btSdfBakerBake(*this, bakerMesh, domainMin, domainMax, sdf);
+}
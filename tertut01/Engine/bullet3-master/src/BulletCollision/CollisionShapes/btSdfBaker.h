@@ -0,0 +1,52 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2009 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef BT_SDF_BAKER_H
+#define BT_SDF_BAKER_H
+
+#include "LinearMath/btVector3.h"
+
+class btStridingMeshInterface;
+struct btMiniSDF;
+
+///The btSdfBaker computes the signed distance field of a triangle mesh in the btMiniSDF format, so that a
+///btSdfCollisionShape can be created for procedural meshes without the external GenerateSDF tool.
+///The distances are the exact distances to the closest triangle, found with a bounding volume hierarchy.
+///The sign comes from the generalized winding number, which stays robust for meshes with small holes or
+///overlapping parts: points with a winding number above one half are inside and get negative distances.
+///With a narrow band only the cells near the surface are stored, and queries in the other cells fail.
+///The cells and nodes are evaluated on the task scheduler.
+class btSdfBaker
+{
+public:
+	///number of cells along each axis of the domain
+	int m_resolution[3];
+
+	///cells that are farther than this from the surface are left out, 0 keeps all cells
+	btScalar m_narrowBand;
+
+	///space around the mesh for the domain, used by the bake method without explicit domain
+	btScalar m_domainMargin;
+
+	btSdfBaker();
+
+	///bakes the mesh into sdf, over the bounding box of the mesh enlarged by m_domainMargin
+	bool bake(const btStridingMeshInterface* mesh, btMiniSDF& sdf) const;
+
+	///bakes the mesh into sdf over the given domain, returns false for an empty mesh, domain or resolution
+	bool bake(const btStridingMeshInterface* mesh, const btVector3& domainMin, const btVector3& domainMax, btMiniSDF& sdf) const;
+};
+
+#endif  //BT_SDF_BAKER_H
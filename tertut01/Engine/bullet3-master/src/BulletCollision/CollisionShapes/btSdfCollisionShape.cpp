@@ -23,6 +23,13 @@ bool btSdfCollisionShape::initializeSDF(const char* sdfData, int sizeInBytes)
 	bool valid = m_data->m_sdf.load(sdfData, sizeInBytes);
 	return valid;
 }
+
+bool btSdfCollisionShape::initializeSDF(const btMiniSDF& sdf)
+{
+	m_data->m_sdf = sdf;
+	return m_data->m_sdf.isValid();
+}
+
 btSdfCollisionShape::btSdfCollisionShape()
 {
 	m_shapeType = SDF_SHAPE_PROXYTYPE;
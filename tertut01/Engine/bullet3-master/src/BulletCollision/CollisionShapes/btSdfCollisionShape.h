@@ -12,6 +12,8 @@ public:
 	virtual ~btSdfCollisionShape();
 
 	bool initializeSDF(const char* sdfData, int sizeInBytes);
+	///copies an sdf that is already in memory, for example from btSdfBaker
+	bool initializeSDF(const struct btMiniSDF& sdf);
 
 	virtual void getAabb(const btTransform& t, btVector3& aabbMin, btVector3& aabbMax) const;
 	virtual void setLocalScaling(const btVector3& scaling);
@@ -0,0 +1,502 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2006 Erwin Coumans  https://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "btGjkPairBatch.h"
+#include "BulletCollision/CollisionShapes/btConvexInternalShape.h"
+
+#if !defined(BT_USE_DOUBLE_PRECISION) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define BT_GJK_PAIR_BATCH_SSE 1
+#include <emmintrin.h>
+#endif
+
+// the lanes hold one scalar of each pair
+#if BT_GJK_PAIR_BATCH_SSE
+typedef __m128 btGjkLanes;
+
+static SIMD_FORCE_INLINE btGjkLanes btGjkLoad(const btScalar* p) { return _mm_load_ps(p); }
+static SIMD_FORCE_INLINE void btGjkStore(btScalar* p, btGjkLanes a) { _mm_store_ps(p, a); }
+static SIMD_FORCE_INLINE btGjkLanes btGjkAdd(btGjkLanes a, btGjkLanes b) { return _mm_add_ps(a, b); }
+static SIMD_FORCE_INLINE btGjkLanes btGjkSub(btGjkLanes a, btGjkLanes b) { return _mm_sub_ps(a, b); }
+static SIMD_FORCE_INLINE btGjkLanes btGjkMul(btGjkLanes a, btGjkLanes b) { return _mm_mul_ps(a, b); }
+static SIMD_FORCE_INLINE btGjkLanes btGjkNeg(btGjkLanes a) { return _mm_xor_ps(a, _mm_set1_ps(-0.0f)); }
+// the support of an interval [-h, h] in direction d, as in btConvexShape::localGetSupportVertexWithoutMarginNonVirtual
+static SIMD_FORCE_INLINE btGjkLanes btGjkSelectSign(btGjkLanes d, btGjkLanes h) { return _mm_xor_ps(_mm_and_ps(d, _mm_set1_ps(-0.0f)), h); }
+static SIMD_FORCE_INLINE int btGjkSeparatedMask(btGjkLanes vw, btGjkLanes vv, btGjkLanes maxDistance2)
+{
+	__m128 positive = _mm_cmpgt_ps(vw, _mm_setzero_ps());
+	__m128 beyond = _mm_cmpgt_ps(_mm_mul_ps(vw, vw), _mm_mul_ps(vv, maxDistance2));
+	return _mm_movemask_ps(_mm_and_ps(positive, beyond));
+}
+#else
+struct btGjkLanes
+{
+	btScalar m[btGjkPairBatch::MAX_LANES];
+};
+
+static SIMD_FORCE_INLINE btGjkLanes btGjkLoad(const btScalar* p)
+{
+	btGjkLanes r;
+	for (int l = 0; l < btGjkPairBatch::MAX_LANES; ++l) r.m[l] = p[l];
+	return r;
+}
+static SIMD_FORCE_INLINE void btGjkStore(btScalar* p, const btGjkLanes& a)
+{
+	for (int l = 0; l < btGjkPairBatch::MAX_LANES; ++l) p[l] = a.m[l];
+}
+static SIMD_FORCE_INLINE btGjkLanes btGjkAdd(const btGjkLanes& a, const btGjkLanes& b)
+{
+	btGjkLanes r;
+	for (int l = 0; l < btGjkPairBatch::MAX_LANES; ++l) r.m[l] = a.m[l] + b.m[l];
+	return r;
+}
+static SIMD_FORCE_INLINE btGjkLanes btGjkSub(const btGjkLanes& a, const btGjkLanes& b)
+{
+	btGjkLanes r;
+	for (int l = 0; l < btGjkPairBatch::MAX_LANES; ++l) r.m[l] = a.m[l] - b.m[l];
+	return r;
+}
+static SIMD_FORCE_INLINE btGjkLanes btGjkMul(const btGjkLanes& a, const btGjkLanes& b)
+{
+	btGjkLanes r;
+	for (int l = 0; l < btGjkPairBatch::MAX_LANES; ++l) r.m[l] = a.m[l] * b.m[l];
+	return r;
+}
+static SIMD_FORCE_INLINE btGjkLanes btGjkNeg(const btGjkLanes& a)
+{
+	btGjkLanes r;
+	for (int l = 0; l < btGjkPairBatch::MAX_LANES; ++l) r.m[l] = -a.m[l];
+	return r;
+}
+static SIMD_FORCE_INLINE btGjkLanes btGjkSelectSign(const btGjkLanes& d, const btGjkLanes& h)
+{
+	btGjkLanes r;
+	for (int l = 0; l < btGjkPairBatch::MAX_LANES; ++l) r.m[l] = btFsels(d.m[l], h.m[l], -h.m[l]);
+	return r;
+}
+static SIMD_FORCE_INLINE int btGjkSeparatedMask(const btGjkLanes& vw, const btGjkLanes& vv, const btGjkLanes& maxDistance2)
+{
+	int mask = 0;
+	for (int l = 0; l < btGjkPairBatch::MAX_LANES; ++l)
+	{
+		if (vw.m[l] > btScalar(0.) && vw.m[l] * vw.m[l] > vv.m[l] * maxDistance2.m[l])
+		{
+			mask |= 1 << l;
+		}
+	}
+	return mask;
+}
+#endif
+
+static SIMD_FORCE_INLINE btGjkLanes btGjkDot(const btGjkLanes* a, const btGjkLanes* b)
+{
+	return btGjkAdd(btGjkAdd(btGjkMul(a[0], b[0]), btGjkMul(a[1], b[1])), btGjkMul(a[2], b[2]));
+}
+
+// the points of the Minkowski difference that support the current closest point, newest last
+struct btGjkBatchSimplex
+{
+	btVector3 m_points[4];
+	int m_numPoints;
+};
+
+// closest point to the origin on the triangle abc, keeps the points of the feature it lies on (Ericson, Real-Time Collision Detection 5.1.5)
+static btVector3 btGjkBatchClosestOnTriangle(const btVector3& a, const btVector3& b, const btVector3& c, btVector3* feature, int& numFeaturePoints)
+{
+	const btVector3 ab = b - a;
+	const btVector3 ac = c - a;
+	const btVector3 ap = -a;
+	const btScalar d1 = ab.dot(ap);
+	const btScalar d2 = ac.dot(ap);
+	if (d1 <= btScalar(0.) && d2 <= btScalar(0.))
+	{
+		feature[0] = a;
+		numFeaturePoints = 1;
+		return a;
+	}
+	const btVector3 bp = -b;
+	const btScalar d3 = ab.dot(bp);
+	const btScalar d4 = ac.dot(bp);
+	if (d3 >= btScalar(0.) && d4 <= d3)
+	{
+		feature[0] = b;
+		numFeaturePoints = 1;
+		return b;
+	}
+	const btScalar vc = d1 * d4 - d3 * d2;
+	if (vc <= btScalar(0.) && d1 >= btScalar(0.) && d3 <= btScalar(0.))
+	{
+		const btScalar v = d1 / (d1 - d3);
+		feature[0] = a;
+		feature[1] = b;
+		numFeaturePoints = 2;
+		return a + v * ab;
+	}
+	const btVector3 cp = -c;
+	const btScalar d5 = ab.dot(cp);
+	const btScalar d6 = ac.dot(cp);
+	if (d6 >= btScalar(0.) && d5 <= d6)
+	{
+		feature[0] = c;
+		numFeaturePoints = 1;
+		return c;
+	}
+	const btScalar vb = d5 * d2 - d1 * d6;
+	if (vb <= btScalar(0.) && d2 >= btScalar(0.) && d6 <= btScalar(0.))
+	{
+		const btScalar w = d2 / (d2 - d6);
+		feature[0] = a;
+		feature[1] = c;
+		numFeaturePoints = 2;
+		return a + w * ac;
+	}
+	const btScalar va = d3 * d6 - d5 * d4;
+	if (va <= btScalar(0.) && (d4 - d3) >= btScalar(0.) && (d5 - d6) >= btScalar(0.))
+	{
+		const btScalar w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+		feature[0] = b;
+		feature[1] = c;
+		numFeaturePoints = 2;
+		return b + w * (c - b);
+	}
+	const btScalar denom = btScalar(1.) / (va + vb + vc);
+	feature[0] = a;
+	feature[1] = b;
+	feature[2] = c;
+	numFeaturePoints = 3;
+	return a + ab * (vb * denom) + ac * (vc * denom);
+}
+
+// moves v to the point of the simplex closest to the origin and drops the points that do not support it,
+// returns false if the simplex contains the origin
+static bool btGjkBatchClosest(btGjkBatchSimplex& simplex, btVector3& v)
+{
+	btVector3* p = simplex.m_points;
+	switch (simplex.m_numPoints)
+	{
+		case 1:
+		{
+			v = p[0];
+			return true;
+		}
+		case 2:
+		{
+			const btVector3 ab = p[1] - p[0];
+			const btScalar lengthSquared = ab.length2();
+			const btScalar t = lengthSquared > btScalar(0.) ? -p[0].dot(ab) / lengthSquared : btScalar(1.);
+			if (t >= btScalar(1.))
+			{
+				p[0] = p[1];
+				simplex.m_numPoints = 1;
+				v = p[0];
+			}
+			else if (t <= btScalar(0.))
+			{
+				simplex.m_numPoints = 1;
+				v = p[0];
+			}
+			else
+			{
+				v = p[0] + t * ab;
+			}
+			return true;
+		}
+		case 3:
+		{
+			btVector3 feature[3];
+			v = btGjkBatchClosestOnTriangle(p[0], p[1], p[2], feature, simplex.m_numPoints);
+			for (int i = 0; i < simplex.m_numPoints; ++i)
+			{
+				p[i] = feature[i];
+			}
+			return true;
+		}
+		default:
+		{
+			// the faces that have the origin on their outside, away from the fourth point
+			static const int faces[4][4] = {{0, 1, 2, 3}, {0, 2, 3, 1}, {0, 3, 1, 2}, {1, 3, 2, 0}};
+			btScalar bestDistance2 = BT_LARGE_FLOAT;
+			btVector3 bestFeature[3];
+			int bestNumPoints = 0;
+			for (int f = 0; f < 4; ++f)
+			{
+				const btVector3& a = p[faces[f][0]];
+				const btVector3& b = p[faces[f][1]];
+				const btVector3& c = p[faces[f][2]];
+				const btVector3 normal = (b - a).cross(c - a);
+				const btScalar originSide = -a.dot(normal);
+				const btScalar otherSide = (p[faces[f][3]] - a).dot(normal);
+				if (originSide * otherSide >= btScalar(0.))
+				{
+					continue;
+				}
+				btVector3 feature[3];
+				int numPoints;
+				const btVector3 closest = btGjkBatchClosestOnTriangle(a, b, c, feature, numPoints);
+				if (closest.length2() < bestDistance2)
+				{
+					bestDistance2 = closest.length2();
+					v = closest;
+					bestNumPoints = numPoints;
+					for (int i = 0; i < numPoints; ++i)
+					{
+						bestFeature[i] = feature[i];
+					}
+				}
+			}
+			if (bestNumPoints == 0)
+			{
+				return false;
+			}
+			for (int i = 0; i < bestNumPoints; ++i)
+			{
+				p[i] = bestFeature[i];
+			}
+			simplex.m_numPoints = bestNumPoints;
+			return true;
+		}
+	}
+}
+
+bool btGjkPairBatch::isSupportedShapeType(int shapeType)
+{
+	return shapeType == BOX_SHAPE_PROXYTYPE || shapeType == SPHERE_SHAPE_PROXYTYPE ||
+		   shapeType == CAPSULE_SHAPE_PROXYTYPE || shapeType == CONVEX_HULL_SHAPE_PROXYTYPE;
+}
+
+btGjkPairBatch::btGjkPairBatch()
+	: m_separatedMask(0),
+	  m_numIterations(0)
+{
+	for (int l = 0; l < MAX_LANES; ++l)
+	{
+		m_shapeA[l] = 0;
+		m_shapeB[l] = 0;
+		m_maximumDistance[l] = btScalar(0.);
+	}
+}
+
+void btGjkPairBatch::setPair(int lane, const btConvexShape* shapeA, const btTransform& transformA, const btConvexShape* shapeB, const btTransform& transformB,
+							 const btVector3& separatingAxis, btScalar maximumDistance)
+{
+	btAssert(lane >= 0 && lane < MAX_LANES);
+	btAssert(isSupportedShapeType(shapeA->getShapeType()) && isSupportedShapeType(shapeB->getShapeType()));
+	btAssert(lane == 0 || (shapeA->getShapeType() == m_shapeA[0]->getShapeType() && shapeB->getShapeType() == m_shapeB[0]->getShapeType()));
+	m_shapeA[lane] = shapeA;
+	m_shapeB[lane] = shapeB;
+	m_transformA[lane] = transformA;
+	m_transformB[lane] = transformB;
+	m_separatingAxis[lane] = separatingAxis;
+	m_maximumDistance[lane] = maximumDistance;
+}
+
+// the lanes of a support mapping, the shapes of a side of the batch all have the same type
+struct btGjkBatchSide
+{
+	btScalar m_basis[9][btGjkPairBatch::MAX_LANES];
+	btScalar m_origin[3][btGjkPairBatch::MAX_LANES];
+	btScalar m_halfExtents[3][btGjkPairBatch::MAX_LANES];
+	int m_shapeType;
+
+	void init(int lane, const btConvexShape* shape, const btTransform& transform, const btVector3& offset)
+	{
+		for (int i = 0; i < 3; ++i)
+		{
+			for (int j = 0; j < 3; ++j)
+			{
+				m_basis[i * 3 + j][lane] = transform.getBasis()[i][j];
+			}
+			m_origin[i][lane] = transform.getOrigin()[i] - offset[i];
+			m_halfExtents[i][lane] = shape->getShapeType() == BOX_SHAPE_PROXYTYPE
+										 ? static_cast<const btConvexInternalShape*>(shape)->getImplicitShapeDimensions()[i]
+										 : btScalar(0.);
+		}
+	}
+
+	// the world space support points in direction dir, without margin
+	SIMD_FORCE_INLINE void support(const btGjkLanes* dir, const btConvexShape* const* shapes, int activeMask, btGjkLanes* point) const
+	{
+		btGjkLanes basis[9];
+		for (int i = 0; i < 9; ++i)
+		{
+			basis[i] = btGjkLoad(m_basis[i]);
+		}
+		// the direction in shape space is dir * basis
+		btGjkLanes localDir[3];
+		for (int j = 0; j < 3; ++j)
+		{
+			localDir[j] = btGjkAdd(btGjkAdd(btGjkMul(dir[0], basis[j]), btGjkMul(dir[1], basis[3 + j])), btGjkMul(dir[2], basis[6 + j]));
+		}
+		btGjkLanes localPoint[3];
+		if (m_shapeType == BOX_SHAPE_PROXYTYPE)
+		{
+			for (int j = 0; j < 3; ++j)
+			{
+				localPoint[j] = btGjkSelectSign(localDir[j], btGjkLoad(m_halfExtents[j]));
+			}
+		}
+		else if (m_shapeType == SPHERE_SHAPE_PROXYTYPE)
+		{
+			// the core of a sphere is its center
+			for (int i = 0; i < 3; ++i)
+			{
+				point[i] = btGjkLoad(m_origin[i]);
+			}
+			return;
+		}
+		else
+		{
+			ATTRIBUTE_ALIGNED16(btScalar dirs[3][btGjkPairBatch::MAX_LANES]);
+			ATTRIBUTE_ALIGNED16(btScalar points[3][btGjkPairBatch::MAX_LANES]);
+			for (int j = 0; j < 3; ++j)
+			{
+				btGjkStore(dirs[j], localDir[j]);
+			}
+			for (int l = 0; l < btGjkPairBatch::MAX_LANES; ++l)
+			{
+				btVector3 p(0, 0, 0);
+				if (activeMask & (1 << l))
+				{
+					p = shapes[l]->localGetSupportVertexWithoutMarginNonVirtual(btVector3(dirs[0][l], dirs[1][l], dirs[2][l]));
+				}
+				points[0][l] = p[0];
+				points[1][l] = p[1];
+				points[2][l] = p[2];
+			}
+			for (int j = 0; j < 3; ++j)
+			{
+				localPoint[j] = btGjkLoad(points[j]);
+			}
+		}
+		for (int i = 0; i < 3; ++i)
+		{
+			point[i] = btGjkAdd(btGjkAdd(btGjkAdd(btGjkMul(basis[i * 3], localPoint[0]), btGjkMul(basis[i * 3 + 1], localPoint[1])),
+										 btGjkMul(basis[i * 3 + 2], localPoint[2])),
+								btGjkLoad(m_origin[i]));
+		}
+	}
+};
+
+void btGjkPairBatch::computeSeparation(int numLanes)
+{
+	btAssert(numLanes > 0 && numLanes <= MAX_LANES);
+	ATTRIBUTE_ALIGNED16(btGjkBatchSide sideA);
+	ATTRIBUTE_ALIGNED16(btGjkBatchSide sideB);
+	ATTRIBUTE_ALIGNED16(btScalar axis[3][MAX_LANES]);
+	ATTRIBUTE_ALIGNED16(btScalar maximumDistance2[MAX_LANES]);
+	btGjkBatchSimplex simplex[MAX_LANES];
+	btScalar squaredDistance[MAX_LANES];
+
+	sideA.m_shapeType = m_shapeA[0]->getShapeType();
+	sideB.m_shapeType = m_shapeB[0]->getShapeType();
+	for (int l = 0; l < MAX_LANES; ++l)
+	{
+		// unused lanes repeat the first pair
+		const int pair = l < numLanes ? l : 0;
+		// work relative to the middle of the pair, as btGjkPairDetector does, for precision
+		const btVector3 offset = (m_transformA[pair].getOrigin() + m_transformB[pair].getOrigin()) * btScalar(0.5);
+		sideA.init(l, m_shapeA[pair], m_transformA[pair], offset);
+		sideB.init(l, m_shapeB[pair], m_transformB[pair], offset);
+
+		btVector3 v = m_separatingAxis[pair];
+		if (v.length2() < SIMD_EPSILON)
+		{
+			v = m_transformA[pair].getOrigin() - m_transformB[pair].getOrigin();
+			if (v.length2() < SIMD_EPSILON)
+			{
+				v.setValue(btScalar(0.), btScalar(1.), btScalar(0.));
+			}
+		}
+		axis[0][l] = v[0];
+		axis[1][l] = v[1];
+		axis[2][l] = v[2];
+
+		// the margins are not part of the support points, a little slack keeps rounding from separating touching shapes
+		const btScalar distance = m_maximumDistance[pair] + m_shapeA[pair]->getMarginNonVirtual() + m_shapeB[pair]->getMarginNonVirtual();
+		maximumDistance2[l] = distance * distance * btScalar(1.0001);
+		simplex[l].m_numPoints = 0;
+		squaredDistance[l] = BT_LARGE_FLOAT;
+	}
+
+	m_separatedMask = 0;
+	int activeMask = (1 << numLanes) - 1;
+	for (m_numIterations = 0; activeMask && m_numIterations < MAX_SEPARATION_ITERATIONS; ++m_numIterations)
+	{
+		btGjkLanes v[3], negV[3], pointA[3], pointB[3], w[3];
+		for (int i = 0; i < 3; ++i)
+		{
+			v[i] = btGjkLoad(axis[i]);
+			negV[i] = btGjkNeg(v[i]);
+		}
+		sideA.support(negV, m_shapeA, activeMask, pointA);
+		sideB.support(v, m_shapeB, activeMask, pointB);
+		for (int i = 0; i < 3; ++i)
+		{
+			w[i] = btGjkSub(pointA[i], pointB[i]);
+		}
+		const btGjkLanes vw = btGjkDot(v, w);
+		const btGjkLanes vv = btGjkDot(v, v);
+
+		// v.w / |v| is a lower bound of the distance between the cores
+		const int separated = btGjkSeparatedMask(vw, vv, btGjkLoad(maximumDistance2)) & activeMask;
+		m_separatedMask |= separated;
+		activeMask &= ~separated;
+		if (!activeMask)
+		{
+			break;
+		}
+
+		ATTRIBUTE_ALIGNED16(btScalar ws[3][MAX_LANES]);
+		ATTRIBUTE_ALIGNED16(btScalar vws[MAX_LANES]);
+		for (int i = 0; i < 3; ++i)
+		{
+			btGjkStore(ws[i], w[i]);
+		}
+		btGjkStore(vws, vw);
+		for (int l = 0; l < numLanes; ++l)
+		{
+			if (!(activeMask & (1 << l)))
+			{
+				continue;
+			}
+			// the first axis is only a direction, later ones are points of the Minkowski difference
+			const bool converged = simplex[l].m_numPoints > 0 && squaredDistance[l] - vws[l] <= squaredDistance[l] * btScalar(1e-6);
+			btGjkBatchSimplex& s = simplex[l];
+			btVector3 newAxis;
+			s.m_points[s.m_numPoints++] = btVector3(ws[0][l], ws[1][l], ws[2][l]);
+			if (converged || !btGjkBatchClosest(s, newAxis))
+			{
+				// the shapes are closer than the maximum distance, or overlap
+				activeMask &= ~(1 << l);
+				continue;
+			}
+			const btScalar newSquaredDistance = newAxis.length2();
+			if (!(newSquaredDistance > SIMD_EPSILON * SIMD_EPSILON) || !(newSquaredDistance < squaredDistance[l]))
+			{
+				// touching, or no progress
+				activeMask &= ~(1 << l);
+				continue;
+			}
+			squaredDistance[l] = newSquaredDistance;
+			axis[0][l] = newAxis[0];
+			axis[1][l] = newAxis[1];
+			axis[2][l] = newAxis[2];
+		}
+	}
+
+	for (int l = 0; l < numLanes; ++l)
+	{
+		m_separatingAxis[l].setValue(axis[0][l], axis[1][l], axis[2][l]);
+	}
+}
@@ -0,0 +1,78 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2006 Erwin Coumans  https://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef BT_GJK_PAIR_BATCH_H
+#define BT_GJK_PAIR_BATCH_H
+
+#include "LinearMath/btTransform.h"
+
+class btConvexShape;
+
+///btGjkPairBatch runs the GJK distance iteration for up to four pairs of convex shapes at once, one pair per SIMD lane.
+///It only answers whether the shapes are further apart than a given distance: a lane is separated when a separating
+///axis proves it, which is exact up to rounding. Lanes that come closer, penetrate or do not converge quickly are left
+///to btGjkPairDetector, which computes the contact points.
+///All pairs of a batch have the same shape types, box, sphere, capsule or convex hull. Box and sphere supports are
+///computed in the lanes, the other shapes use localGetSupportVertexWithoutMarginNonVirtual, without virtual calls.
+///The separating axis of the previous step is a good start, so a pair that keeps apart usually takes one iteration.
+class btGjkPairBatch
+{
+public:
+	enum
+	{
+		MAX_LANES = 4,
+		MAX_SEPARATION_ITERATIONS = 32
+	};
+
+	///returns true for the shape types the batch supports
+	static bool isSupportedShapeType(int shapeType);
+
+	btGjkPairBatch();
+
+	///separatingAxis is the warm start, any non-zero vector pointing from B to A works.
+	///The pair is separated when the distance between the shapes, including their margins, exceeds maximumDistance
+	void setPair(int lane, const btConvexShape* shapeA, const btTransform& transformA, const btConvexShape* shapeB, const btTransform& transformB,
+				 const btVector3& separatingAxis, btScalar maximumDistance);
+
+	void computeSeparation(int numLanes);
+
+	bool isSeparated(int lane) const
+	{
+		return (m_separatedMask & (1 << lane)) != 0;
+	}
+
+	///the last axis of the iteration, to warm start the next step
+	const btVector3& getSeparatingAxis(int lane) const
+	{
+		return m_separatingAxis[lane];
+	}
+
+	int getNumIterations() const
+	{
+		return m_numIterations;
+	}
+
+private:
+	const btConvexShape* m_shapeA[MAX_LANES];
+	const btConvexShape* m_shapeB[MAX_LANES];
+	btTransform m_transformA[MAX_LANES];
+	btTransform m_transformB[MAX_LANES];
+	btVector3 m_separatingAxis[MAX_LANES];
+	btScalar m_maximumDistance[MAX_LANES];
+	int m_separatedMask;
+	int m_numIterations;
+};
+
+#endif  //BT_GJK_PAIR_BATCH_H
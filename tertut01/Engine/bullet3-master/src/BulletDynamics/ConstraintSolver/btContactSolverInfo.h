@@ -32,6 +32,9 @@ enum btSolverMode
 	SOLVER_ALLOW_ZERO_LENGTH_FRICTION_DIRECTIONS = 1024,
 	SOLVER_DISABLE_IMPLICIT_CONE_FRICTION = 2048,
 	SOLVER_USE_ARTICULATED_WARMSTARTING = 4096,
+	SOLVER_WIDE_SIMD = 8192,  //solve contact and friction rows in 8 or 16 lane AVX2/AVX-512 blocks, see btWideConstraintBlocks.
+	                          //Only the single-threaded solver loop honours it: btSequentialImpulseConstraintSolverMt ignores it while batching is enabled
+	SOLVER_DETERMINISTIC = 16384,  //results of the multithreaded solver do not depend on the number of threads, see btDiscreteDynamicsWorldMt::setDeterministic
 };
 
 struct btContactSolverInfoData
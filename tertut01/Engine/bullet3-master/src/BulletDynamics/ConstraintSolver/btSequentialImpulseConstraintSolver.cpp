@@ -354,6 +354,7 @@ btSequentialImpulseConstraintSolver::btSequentialImpulseConstraintSolver()
 {
 	m_btSeed2 = 0;
 	m_cachedSolverMode = 0;
+	m_wideBlocksInUse = false;
 	setupSolverFunctions(false);
 }
 
@@ -1592,7 +1593,12 @@ btScalar btSequentialImpulseConstraintSolver::solveSingleIteration(int iteration
 		}
 
 		///solve all contact constraints
-		if (infoGlobal.m_solverMode & SOLVER_INTERLEAVE_CONTACT_AND_FRICTION_CONSTRAINTS)
+		if (infoGlobal.m_solverMode & SOLVER_WIDE_SIMD)
+		{
+			//contacts, then friction, in conflict-free blocks; interleaving and randomized order do not apply here
+			leastSquaresResidual = btMax(leastSquaresResidual, solveWideContactIteration(iteration));
+		}
+		else if (infoGlobal.m_solverMode & SOLVER_INTERLEAVE_CONTACT_AND_FRICTION_CONSTRAINTS)
 		{
 			int numPoolConstraints = m_tmpSolverContactConstraintPool.size();
 			int multiplier = (infoGlobal.m_solverMode & SOLVER_USE_2_FRICTION_DIRECTIONS) ? 2 : 1;
@@ -1694,6 +1700,35 @@ btScalar btSequentialImpulseConstraintSolver::solveSingleIteration(int iteration
 	return leastSquaresResidual;
 }
 
+btScalar btSequentialImpulseConstraintSolver::solveWideContactIteration(int iteration)
+{
+	if (iteration == 0 || !m_wideBlocksInUse)
+	{
+		//the applied impulses stay in the blocks until writeBackWideBlocks is called
+		m_wideContactBlocks.setup(&m_tmpSolverContactConstraintPool, m_tmpSolverBodyPool);
+		m_wideFrictionBlocks.setup(&m_tmpSolverContactFrictionConstraintPool, m_tmpSolverBodyPool, &m_wideContactBlocks);
+		m_wideBlocksInUse = true;
+	}
+	btScalar leastSquaresResidual = m_wideContactBlocks.solve(m_tmpSolverBodyPool);
+	leastSquaresResidual = btMax(leastSquaresResidual, m_wideFrictionBlocks.solve(m_tmpSolverBodyPool, &m_wideContactBlocks));
+	if (m_tmpSolverContactRollingFrictionConstraintPool.size())
+	{
+		//rolling friction is still solved row by row and reads the normal impulses from the pool
+		m_wideContactBlocks.writeBackAppliedImpulses(&m_tmpSolverContactConstraintPool);
+	}
+	return leastSquaresResidual;
+}
+
+void btSequentialImpulseConstraintSolver::writeBackWideBlocks()
+{
+	if (m_wideBlocksInUse)
+	{
+		m_wideContactBlocks.writeBackAppliedImpulses(&m_tmpSolverContactConstraintPool);
+		m_wideFrictionBlocks.writeBackAppliedImpulses(&m_tmpSolverContactFrictionConstraintPool);
+		m_wideBlocksInUse = false;
+	}
+}
+
 void btSequentialImpulseConstraintSolver::solveGroupCacheFriendlySplitImpulseIterations(btCollisionObject** bodies, int numBodies, btPersistentManifold** manifoldPtr, int numManifolds, btTypedConstraint** constraints, int numConstraints, const btContactSolverInfo& infoGlobal, btIDebugDraw* debugDrawer)
 {
 	BT_PROFILE("solveGroupCacheFriendlySplitImpulseIterations");
@@ -1758,6 +1793,7 @@ btScalar btSequentialImpulseConstraintSolver::solveGroupCacheFriendlyIterations(
 				break;
 			}
 		}
+		writeBackWideBlocks();
 	}
 	return 0.f;
 }
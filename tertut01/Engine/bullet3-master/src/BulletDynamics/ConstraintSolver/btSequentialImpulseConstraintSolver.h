@@ -26,6 +26,7 @@ class btCollisionObject;
 #include "BulletDynamics/ConstraintSolver/btSolverConstraint.h"
 #include "BulletCollision/NarrowPhaseCollision/btManifoldPoint.h"
 #include "BulletDynamics/ConstraintSolver/btConstraintSolver.h"
+#include "BulletDynamics/ConstraintSolver/btWideConstraintBlocks.h"
 
 typedef btScalar (*btSingleConstraintRowSolver)(btSolverBody&, btSolverBody&, const btSolverConstraint&);
 
@@ -82,6 +83,13 @@ protected:
 
 	btScalar m_leastSquaresResidual;
 
+	///SOLVER_WIDE_SIMD keeps the contact and friction rows in SoA blocks during the iterations
+	btWideConstraintBlocks m_wideContactBlocks;
+	btWideConstraintBlocks m_wideFrictionBlocks;
+	bool m_wideBlocksInUse;
+	btScalar solveWideContactIteration(int iteration);
+	void writeBackWideBlocks();
+
 	void setupFrictionConstraint(btSolverConstraint & solverConstraint, const btVector3& normalAxis, int solverBodyIdA, int solverBodyIdB,
 		btManifoldPoint& cp, const btVector3& rel_pos1, const btVector3& rel_pos2,
 		btCollisionObject* colObj0, btCollisionObject* colObj1, btScalar relaxation,
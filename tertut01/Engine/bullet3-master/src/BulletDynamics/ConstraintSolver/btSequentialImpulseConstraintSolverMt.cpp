@@ -16,6 +16,7 @@ subject to the following restrictions:
 #include "btSequentialImpulseConstraintSolverMt.h"
 
 #include "LinearMath/btQuickprof.h"
+#include "LinearMath/btStepArena.h"
 
 #include "BulletCollision/NarrowPhaseCollision/btPersistentManifold.h"
 
@@ -513,17 +514,37 @@ struct AllocContactConstraintsLoop : public btIParallelForBody
 void btSequentialImpulseConstraintSolverMt::allocAllContactConstraints(btPersistentManifold** manifoldPtr, int numManifolds, const btContactSolverInfo& infoGlobal)
 {
 	BT_PROFILE("allocAllContactConstraints");
-	btAlignedObjectArray<btContactManifoldCachedInfo> cachedInfoArray;  // = m_manifoldCachedInfoArray;
-	cachedInfoArray.resizeNoInitialize(numManifolds);
+	// scratch for this call only, from the arena of the calling thread
+	btStepArena* arena = btGetThreadArena();
+	const btStepArena::Marker arenaMarker = arena->getMarker();
+	btContactManifoldCachedInfo* cachedInfoArray = arena->allocateArray<btContactManifoldCachedInfo>(numManifolds);
+	if (infoGlobal.m_solverMode & SOLVER_DETERMINISTIC)
+	{
+		// kinematic bodies are the only ones that get their solver body on first use,
+		// give them one in manifold order before the threads race for it
+		for (int i = 0; i < numManifolds; ++i)
+		{
+			btCollisionObject* colObj0 = (btCollisionObject*)manifoldPtr[i]->getBody0();
+			btCollisionObject* colObj1 = (btCollisionObject*)manifoldPtr[i]->getBody1();
+			if (colObj0->isKinematicObject())
+			{
+				getOrInitSolverBodyThreadsafe(*colObj0, infoGlobal.m_timeStep);
+			}
+			if (colObj1->isKinematicObject())
+			{
+				getOrInitSolverBodyThreadsafe(*colObj1, infoGlobal.m_timeStep);
+			}
+		}
+	}
 	if (/* DISABLES CODE */ (false))
 	{
 		// sequential
-		internalCollectContactManifoldCachedInfo(&cachedInfoArray[0], manifoldPtr, numManifolds, infoGlobal);
+		internalCollectContactManifoldCachedInfo(cachedInfoArray, manifoldPtr, numManifolds, infoGlobal);
 	}
 	else
 	{
 		// may alter ordering of bodies which affects determinism
-		CollectContactManifoldCachedInfoLoop loop(this, &cachedInfoArray[0], manifoldPtr, infoGlobal);
+		CollectContactManifoldCachedInfoLoop loop(this, cachedInfoArray, manifoldPtr, infoGlobal);
 		int grainSize = 200;
 		btParallelFor(0, numManifolds, grainSize, loop);
 	}
@@ -564,10 +585,11 @@ void btSequentialImpulseConstraintSolverMt::allocAllContactConstraints(btPersist
 		}
 	}
 	{
-		AllocContactConstraintsLoop loop(this, &cachedInfoArray[0]);
+		AllocContactConstraintsLoop loop(this, cachedInfoArray);
 		int grainSize = 200;
 		btParallelFor(0, numManifolds, grainSize, loop);
 	}
+	arena->rewind(arenaMarker);
 }
 
 void btSequentialImpulseConstraintSolverMt::convertContacts(btPersistentManifold** manifoldPtr, int numManifolds, const btContactSolverInfo& infoGlobal)
@@ -640,7 +662,7 @@ struct InitJointsLoop : public btIParallelForBody
 	}
 };
 
-void btSequentialImpulseConstraintSolverMt::internalConvertMultipleJoints(const btAlignedObjectArray<JointParams>& jointParamsArray, btTypedConstraint** constraints, int iBegin, int iEnd, const btContactSolverInfo& infoGlobal)
+void btSequentialImpulseConstraintSolverMt::internalConvertMultipleJoints(const JointParams* jointParamsArray, btTypedConstraint** constraints, int iBegin, int iEnd, const btContactSolverInfo& infoGlobal)
 {
 	BT_PROFILE("internalConvertMultipleJoints");
 	for (int i = iBegin; i < iEnd; ++i)
@@ -664,17 +686,17 @@ void btSequentialImpulseConstraintSolverMt::internalConvertMultipleJoints(const
 struct ConvertJointsLoop : public btIParallelForBody
 {
 	btSequentialImpulseConstraintSolverMt* m_solver;
-	const btAlignedObjectArray<btSequentialImpulseConstraintSolverMt::JointParams>& m_jointParamsArray;
+	const btSequentialImpulseConstraintSolverMt::JointParams* m_jointParamsArray;
 	btTypedConstraint** m_srcConstraints;
 	const btContactSolverInfo& m_infoGlobal;
 
 	ConvertJointsLoop(btSequentialImpulseConstraintSolverMt* solver,
-					  const btAlignedObjectArray<btSequentialImpulseConstraintSolverMt::JointParams>& jointParamsArray,
+					  const btSequentialImpulseConstraintSolverMt::JointParams* jointParamsArray,
 					  btTypedConstraint** srcConstraints,
-					  const btContactSolverInfo& infoGlobal) : m_jointParamsArray(jointParamsArray),
-															   m_infoGlobal(infoGlobal)
+					  const btContactSolverInfo& infoGlobal) : m_infoGlobal(infoGlobal)
 	{
 		m_solver = solver;
+		m_jointParamsArray = jointParamsArray;
 		m_srcConstraints = srcConstraints;
 	}
 	void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
@@ -705,8 +727,10 @@ void btSequentialImpulseConstraintSolverMt::convertJoints(btTypedConstraint** co
 	}
 
 	int totalNumRows = 0;
-	btAlignedObjectArray<JointParams> jointParamsArray;
-	jointParamsArray.resizeNoInitialize(numConstraints);
+	// scratch for this call only, from the arena of the calling thread
+	btStepArena* arena = btGetThreadArena();
+	const btStepArena::Marker arenaMarker = arena->getMarker();
+	JointParams* jointParamsArray = arena->allocateArray<JointParams>(numConstraints);
 
 	//calculate the total number of contraint rows
 	for (int i = 0; i < numConstraints; i++)
@@ -741,6 +765,7 @@ void btSequentialImpulseConstraintSolverMt::convertJoints(btTypedConstraint** co
 	{
 		internalConvertMultipleJoints(jointParamsArray, constraints, 0, numConstraints, infoGlobal);
 	}
+	arena->rewind(arenaMarker);
 	setupBatchedJointConstraints();
 }
 
@@ -911,7 +936,7 @@ void btSequentialImpulseConstraintSolverMt::solveGroupCacheFriendlySplitImpulseI
 					int iPhase = batchedCons.m_phaseOrder[iiPhase];
 					const btBatchedConstraints::Range& phase = batchedCons.m_phases[iPhase];
 					int grainSize = batchedCons.m_phaseGrainSize[iPhase];
-					leastSquaresResidual += btParallelSum(phase.begin, phase.end, grainSize, loop);
+					leastSquaresResidual += parallelSumResidual(phase.begin, phase.end, grainSize, loop);
 				}
 			}
 			else
@@ -936,6 +961,7 @@ btScalar btSequentialImpulseConstraintSolverMt::solveSingleIteration(int iterati
 	{
 		return btSequentialImpulseConstraintSolver::solveSingleIteration(iteration, bodies, numBodies, manifoldPtr, numManifolds, constraints, numConstraints, infoGlobal, debugDrawer);
 	}
+	// the batches are solved row by row on the worker threads, so SOLVER_WIDE_SIMD has no effect here
 	BT_PROFILE("solveSingleIterationMt");
 	btScalar leastSquaresResidual = 0.f;
 
@@ -1226,6 +1252,15 @@ struct JointSolverLoop : public btIParallelSumBody
 	}
 };
 
+btScalar btSequentialImpulseConstraintSolverMt::parallelSumResidual(int iBegin, int iEnd, int grainSize, const btIParallelSumBody& body) const
+{
+	if (m_cachedSolverMode & SOLVER_DETERMINISTIC)
+	{
+		return btParallelSumOrdered(iBegin, iEnd, grainSize, body);
+	}
+	return btParallelSum(iBegin, iEnd, grainSize, body);
+}
+
 btScalar btSequentialImpulseConstraintSolverMt::resolveAllJointConstraints(int iteration)
 {
 	BT_PROFILE("resolveAllJointConstraints");
@@ -1237,7 +1272,7 @@ btScalar btSequentialImpulseConstraintSolverMt::resolveAllJointConstraints(int i
 		int iPhase = batchedCons.m_phaseOrder[iiPhase];
 		const btBatchedConstraints::Range& phase = batchedCons.m_phases[iPhase];
 		int grainSize = 1;
-		leastSquaresResidual += btParallelSum(phase.begin, phase.end, grainSize, loop);
+		leastSquaresResidual += parallelSumResidual(phase.begin, phase.end, grainSize, loop);
 	}
 	return leastSquaresResidual;
 }
@@ -1276,7 +1311,7 @@ btScalar btSequentialImpulseConstraintSolverMt::resolveAllContactConstraints()
 		int iPhase = batchedCons.m_phaseOrder[iiPhase];
 		const btBatchedConstraints::Range& phase = batchedCons.m_phases[iPhase];
 		int grainSize = batchedCons.m_phaseGrainSize[iPhase];
-		leastSquaresResidual += btParallelSum(phase.begin, phase.end, grainSize, loop);
+		leastSquaresResidual += parallelSumResidual(phase.begin, phase.end, grainSize, loop);
 	}
 	return leastSquaresResidual;
 }
@@ -1315,7 +1350,7 @@ btScalar btSequentialImpulseConstraintSolverMt::resolveAllContactFrictionConstra
 		int iPhase = batchedCons.m_phaseOrder[iiPhase];
 		const btBatchedConstraints::Range& phase = batchedCons.m_phases[iPhase];
 		int grainSize = batchedCons.m_phaseGrainSize[iPhase];
-		leastSquaresResidual += btParallelSum(phase.begin, phase.end, grainSize, loop);
+		leastSquaresResidual += parallelSumResidual(phase.begin, phase.end, grainSize, loop);
 	}
 	return leastSquaresResidual;
 }
@@ -1354,7 +1389,7 @@ btScalar btSequentialImpulseConstraintSolverMt::resolveAllContactConstraintsInte
 		int iPhase = batchedCons.m_phaseOrder[iiPhase];
 		const btBatchedConstraints::Range& phase = batchedCons.m_phases[iPhase];
 		int grainSize = 1;
-		leastSquaresResidual += btParallelSum(phase.begin, phase.end, grainSize, loop);
+		leastSquaresResidual += parallelSumResidual(phase.begin, phase.end, grainSize, loop);
 	}
 	return leastSquaresResidual;
 }
@@ -1414,7 +1449,7 @@ btScalar btSequentialImpulseConstraintSolverMt::resolveAllRollingFrictionConstra
 			int iPhase = batchedCons.m_phaseOrder[iiPhase];
 			const btBatchedConstraints::Range& phase = batchedCons.m_phases[iPhase];
 			int grainSize = 1;
-			leastSquaresResidual += btParallelSum(phase.begin, phase.end, grainSize, loop);
+			leastSquaresResidual += parallelSumResidual(phase.begin, phase.end, grainSize, loop);
 		}
 	}
 	else
@@ -52,6 +52,8 @@ subject to the following restrictions:
 ///  if the task scheduler's parallelSum operation is non-deterministic. The parallelSum operation can be non-deterministic
 ///  because floating point addition is not associative due to rounding errors.
 ///  The task scheduler can and should ensure that the result of any parallelSum operation is deterministic.
+///  When the SOLVER_DETERMINISTIC flag is enabled, the residual is summed with btParallelSumOrdered instead, which gives the
+///  same result for any number of threads, and kinematic bodies get their solver bodies in manifold order.
 ///
 ATTRIBUTE_ALIGNED16(class)
 btSequentialImpulseConstraintSolverMt : public btSequentialImpulseConstraintSolver
@@ -82,7 +84,7 @@ public:
 		int m_solverBodyB;
 	};
 	void internalInitMultipleJoints(btTypedConstraint * *constraints, int iBegin, int iEnd);
-	void internalConvertMultipleJoints(const btAlignedObjectArray<JointParams>& jointParamsArray, btTypedConstraint** constraints, int iBegin, int iEnd, const btContactSolverInfo& infoGlobal);
+	void internalConvertMultipleJoints(const JointParams* jointParamsArray, btTypedConstraint** constraints, int iBegin, int iEnd, const btContactSolverInfo& infoGlobal);
 
 	// parameters to control batching
 	static bool s_allowNestedParallelForLoops;        // whether to allow nested parallel operations
@@ -124,6 +126,7 @@ protected:
 	void allocAllContactConstraints(btPersistentManifold * *manifoldPtr, int numManifolds, const btContactSolverInfo& infoGlobal);
 	void setupAllContactConstraints(const btContactSolverInfo& infoGlobal);
 	void randomizeBatchedConstraintOrdering(btBatchedConstraints * batchedConstraints);
+	btScalar parallelSumResidual(int iBegin, int iEnd, int grainSize, const btIParallelSumBody& body) const;
 
 public:
 	BT_DECLARE_ALIGNED_ALLOCATOR();
@@ -0,0 +1,868 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2006 Erwin Coumans  https://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "btWideConstraintBlocks.h"
+
+#include "BulletDynamics/Dynamics/btRigidBody.h"
+#include "LinearMath/btCpuFeatureUtility.h"
+#include "LinearMath/btQuickprof.h"
+#include "LinearMath/btThreads.h"
+
+//The AVX2 and AVX-512 kernels are compiled with per-function target attributes (GCC, Clang) or need no flags at all (MSVC),
+//so the library itself does not require -mavx2 and the kernel is picked at run-time from the CPU features.
+#if !defined(BT_USE_DOUBLE_PRECISION)
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86)) && (_MSC_VER >= 1910)
+#define BT_WIDE_X86_KERNELS 1
+#define BT_WIDE_TARGET_AVX2
+#define BT_WIDE_TARGET_AVX512
+#elif defined(__clang__) && (defined(__x86_64__) || defined(__i386__))
+#define BT_WIDE_X86_KERNELS 1
+#define BT_WIDE_TARGET_AVX2 __attribute__((target("avx2")))
+#define BT_WIDE_TARGET_AVX512 __attribute__((target("avx512f")))
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && (__GNUC__ >= 5)
+//AVX-512 implies FMA, and GCC would fuse the separate multiply and add intrinsics, so the lanes would no longer match the scalar kernel
+#define BT_WIDE_X86_KERNELS 1
+#define BT_WIDE_TARGET_AVX2 __attribute__((target("avx2")))
+#define BT_WIDE_TARGET_AVX512 __attribute__((target("avx512f"), optimize("fp-contract=off")))
+#endif
+#endif  //BT_USE_DOUBLE_PRECISION
+
+#ifdef BT_WIDE_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+btWideConstraintBlocks::SolverKernel btWideConstraintBlocks::s_preferredKernel = btWideConstraintBlocks::KERNEL_AVX512;
+
+// a few blocks are kept open while packing, so a row that conflicts with the newest block can still fill an older one
+const int kMaxOpenBlocks = 4;
+const int kMaxLaneCount = 16;
+
+struct btWideSolveParams
+{
+	btScalar* m_data;
+	const int* m_bodyIdA;
+	const int* m_bodyIdB;
+	const int* m_normalSlot;
+	const btScalar* m_normalImpulses;  // NULL for contact blocks
+	btScalar* m_bodyData;
+	int m_bodyStride;
+	int m_linearOffset;
+	int m_angularOffset;
+	int m_numBlocks;
+	int m_laneCount;
+};
+
+static bool isBodyDynamic(const btSolverBody& body)
+{
+	// bodies without mass never pick up delta velocities, so any number of lanes may read them
+	return body.m_originalBody && body.m_originalBody->getInvMass() > btScalar(0);
+}
+
+// Reference kernel, also used when the CPU or the build has no wide kernel. It performs the same operations
+// in the same order as the vector kernels, so all kernels give the same results for the same blocks.
+static btScalar solveBlocksScalar(const btWideSolveParams& p)
+{
+	const int W = p.m_laneCount;
+	const btScalar zero[3] = {btScalar(0), btScalar(0), btScalar(0)};
+	btScalar leastSquaresResidual = btScalar(0);
+	for (int block = 0; block < p.m_numBlocks; ++block)
+	{
+		btScalar* s = p.m_data + block * btWideConstraintBlocks::STREAM_COUNT * W;
+		for (int lane = 0; lane < W; ++lane)
+		{
+#define BT_WIDE_STREAM(stream) s[btWideConstraintBlocks::stream * W + lane]
+			const int idA = p.m_bodyIdA[block * W + lane];
+			const int idB = p.m_bodyIdB[block * W + lane];
+			btScalar* linA = idA >= 0 ? p.m_bodyData + idA * p.m_bodyStride + p.m_linearOffset : NULL;
+			btScalar* angA = idA >= 0 ? p.m_bodyData + idA * p.m_bodyStride + p.m_angularOffset : NULL;
+			btScalar* linB = idB >= 0 ? p.m_bodyData + idB * p.m_bodyStride + p.m_linearOffset : NULL;
+			btScalar* angB = idB >= 0 ? p.m_bodyData + idB * p.m_bodyStride + p.m_angularOffset : NULL;
+			const btScalar* velLinA = linA ? linA : zero;
+			const btScalar* velAngA = angA ? angA : zero;
+			const btScalar* velLinB = linB ? linB : zero;
+			const btScalar* velAngB = angB ? angB : zero;
+
+			btScalar lowerLimit = BT_WIDE_STREAM(STREAM_LOWER_LIMIT);
+			btScalar upperLimit = BT_WIDE_STREAM(STREAM_UPPER_LIMIT);
+			if (p.m_normalImpulses)
+			{
+				const int slot = p.m_normalSlot[block * W + lane];
+				const btScalar totalImpulse = slot >= 0 ? p.m_normalImpulses[slot] : btScalar(0);
+				if (!(totalImpulse > btScalar(0)))
+					continue;
+				lowerLimit = -(BT_WIDE_STREAM(STREAM_FRICTION) * totalImpulse);
+				upperLimit = BT_WIDE_STREAM(STREAM_FRICTION) * totalImpulse;
+			}
+
+			const btScalar appliedImpulse = BT_WIDE_STREAM(STREAM_APPLIED_IMPULSE);
+			const btScalar jacDiagABInv = BT_WIDE_STREAM(STREAM_JAC_DIAG_AB_INV);
+			btScalar deltaImpulse = BT_WIDE_STREAM(STREAM_RHS) - appliedImpulse * BT_WIDE_STREAM(STREAM_CFM);
+			const btScalar deltaVel1Dotn = BT_WIDE_STREAM(STREAM_NORMAL1_X) * velLinA[0] + BT_WIDE_STREAM(STREAM_NORMAL1_Y) * velLinA[1] + BT_WIDE_STREAM(STREAM_NORMAL1_Z) * velLinA[2] +
+										   (BT_WIDE_STREAM(STREAM_RELPOS1_CROSS_NORMAL_X) * velAngA[0] + BT_WIDE_STREAM(STREAM_RELPOS1_CROSS_NORMAL_Y) * velAngA[1] + BT_WIDE_STREAM(STREAM_RELPOS1_CROSS_NORMAL_Z) * velAngA[2]);
+			const btScalar deltaVel2Dotn = BT_WIDE_STREAM(STREAM_NORMAL2_X) * velLinB[0] + BT_WIDE_STREAM(STREAM_NORMAL2_Y) * velLinB[1] + BT_WIDE_STREAM(STREAM_NORMAL2_Z) * velLinB[2] +
+										   (BT_WIDE_STREAM(STREAM_RELPOS2_CROSS_NORMAL_X) * velAngB[0] + BT_WIDE_STREAM(STREAM_RELPOS2_CROSS_NORMAL_Y) * velAngB[1] + BT_WIDE_STREAM(STREAM_RELPOS2_CROSS_NORMAL_Z) * velAngB[2]);
+			deltaImpulse -= deltaVel1Dotn * jacDiagABInv;
+			deltaImpulse -= deltaVel2Dotn * jacDiagABInv;
+
+			const btScalar sum = appliedImpulse + deltaImpulse;
+			if (sum < lowerLimit)
+			{
+				deltaImpulse = lowerLimit - appliedImpulse;
+				BT_WIDE_STREAM(STREAM_APPLIED_IMPULSE) = lowerLimit;
+			}
+			else if (sum > upperLimit)
+			{
+				deltaImpulse = upperLimit - appliedImpulse;
+				BT_WIDE_STREAM(STREAM_APPLIED_IMPULSE) = upperLimit;
+			}
+			else
+			{
+				BT_WIDE_STREAM(STREAM_APPLIED_IMPULSE) = sum;
+			}
+
+			if (linA)
+			{
+				linA[0] += BT_WIDE_STREAM(STREAM_LINEAR_A_X) * deltaImpulse;
+				linA[1] += BT_WIDE_STREAM(STREAM_LINEAR_A_Y) * deltaImpulse;
+				linA[2] += BT_WIDE_STREAM(STREAM_LINEAR_A_Z) * deltaImpulse;
+				angA[0] += BT_WIDE_STREAM(STREAM_ANGULAR_A_X) * deltaImpulse;
+				angA[1] += BT_WIDE_STREAM(STREAM_ANGULAR_A_Y) * deltaImpulse;
+				angA[2] += BT_WIDE_STREAM(STREAM_ANGULAR_A_Z) * deltaImpulse;
+			}
+			if (linB)
+			{
+				linB[0] += BT_WIDE_STREAM(STREAM_LINEAR_B_X) * deltaImpulse;
+				linB[1] += BT_WIDE_STREAM(STREAM_LINEAR_B_Y) * deltaImpulse;
+				linB[2] += BT_WIDE_STREAM(STREAM_LINEAR_B_Z) * deltaImpulse;
+				angB[0] += BT_WIDE_STREAM(STREAM_ANGULAR_B_X) * deltaImpulse;
+				angB[1] += BT_WIDE_STREAM(STREAM_ANGULAR_B_Y) * deltaImpulse;
+				angB[2] += BT_WIDE_STREAM(STREAM_ANGULAR_B_Z) * deltaImpulse;
+			}
+
+			const btScalar residual = deltaImpulse * (btScalar(1) / jacDiagABInv);
+			leastSquaresResidual = btMax(leastSquaresResidual, residual * residual);
+#undef BT_WIDE_STREAM
+		}
+	}
+	return leastSquaresResidual;
+}
+
+#ifdef BT_WIDE_X86_KERNELS
+
+#define BT_WIDE_DOT3(mul, add, ax, ay, az, bx, by, bz) add(add(mul(ax, bx), mul(ay, by)), mul(az, bz))
+
+BT_WIDE_TARGET_AVX2 static btScalar solveBlocksAvx2(const btWideSolveParams& p)
+{
+	btAssert(p.m_laneCount == 8);
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 one = _mm256_set1_ps(1.0f);
+	const __m256i minusOne = _mm256_set1_epi32(-1);
+	const __m256i stride = _mm256_set1_epi32(p.m_bodyStride);
+	const __m256i linearOffset = _mm256_set1_epi32(p.m_linearOffset);
+	const __m256i angularOffset = _mm256_set1_epi32(p.m_angularOffset);
+	const __m256i offsetY = _mm256_set1_epi32(1);
+	const __m256i offsetZ = _mm256_set1_epi32(2);
+	__m256 leastSquaresResidual = zero;
+	float scatter[12][8];
+
+	for (int block = 0; block < p.m_numBlocks; ++block)
+	{
+		const float* s = p.m_data + block * btWideConstraintBlocks::STREAM_COUNT * 8;
+#define BT_WIDE_LOAD(stream) _mm256_loadu_ps(s + btWideConstraintBlocks::stream * 8)
+		const __m256i idA = _mm256_loadu_si256((const __m256i*)(p.m_bodyIdA + block * 8));
+		const __m256i idB = _mm256_loadu_si256((const __m256i*)(p.m_bodyIdB + block * 8));
+		const __m256 maskA = _mm256_castsi256_ps(_mm256_cmpgt_epi32(idA, minusOne));
+		const __m256 maskB = _mm256_castsi256_ps(_mm256_cmpgt_epi32(idB, minusOne));
+		const __m256i linA = _mm256_add_epi32(_mm256_mullo_epi32(idA, stride), linearOffset);
+		const __m256i angA = _mm256_add_epi32(_mm256_mullo_epi32(idA, stride), angularOffset);
+		const __m256i linB = _mm256_add_epi32(_mm256_mullo_epi32(idB, stride), linearOffset);
+		const __m256i angB = _mm256_add_epi32(_mm256_mullo_epi32(idB, stride), angularOffset);
+
+		// masked lanes are not read, so empty lanes and massless bodies see zero velocity
+		__m256 linAx = _mm256_mask_i32gather_ps(zero, p.m_bodyData, linA, maskA, 4);
+		__m256 linAy = _mm256_mask_i32gather_ps(zero, p.m_bodyData, _mm256_add_epi32(linA, offsetY), maskA, 4);
+		__m256 linAz = _mm256_mask_i32gather_ps(zero, p.m_bodyData, _mm256_add_epi32(linA, offsetZ), maskA, 4);
+		__m256 angAx = _mm256_mask_i32gather_ps(zero, p.m_bodyData, angA, maskA, 4);
+		__m256 angAy = _mm256_mask_i32gather_ps(zero, p.m_bodyData, _mm256_add_epi32(angA, offsetY), maskA, 4);
+		__m256 angAz = _mm256_mask_i32gather_ps(zero, p.m_bodyData, _mm256_add_epi32(angA, offsetZ), maskA, 4);
+		__m256 linBx = _mm256_mask_i32gather_ps(zero, p.m_bodyData, linB, maskB, 4);
+		__m256 linBy = _mm256_mask_i32gather_ps(zero, p.m_bodyData, _mm256_add_epi32(linB, offsetY), maskB, 4);
+		__m256 linBz = _mm256_mask_i32gather_ps(zero, p.m_bodyData, _mm256_add_epi32(linB, offsetZ), maskB, 4);
+		__m256 angBx = _mm256_mask_i32gather_ps(zero, p.m_bodyData, angB, maskB, 4);
+		__m256 angBy = _mm256_mask_i32gather_ps(zero, p.m_bodyData, _mm256_add_epi32(angB, offsetY), maskB, 4);
+		__m256 angBz = _mm256_mask_i32gather_ps(zero, p.m_bodyData, _mm256_add_epi32(angB, offsetZ), maskB, 4);
+
+		__m256 lowerLimit = BT_WIDE_LOAD(STREAM_LOWER_LIMIT);
+		__m256 upperLimit = BT_WIDE_LOAD(STREAM_UPPER_LIMIT);
+		__m256 active = _mm256_castsi256_ps(minusOne);
+		if (p.m_normalImpulses)
+		{
+			const __m256i slot = _mm256_loadu_si256((const __m256i*)(p.m_normalSlot + block * 8));
+			const __m256 totalImpulse = _mm256_mask_i32gather_ps(zero, p.m_normalImpulses, slot, _mm256_castsi256_ps(_mm256_cmpgt_epi32(slot, minusOne)), 4);
+			const __m256 friction = BT_WIDE_LOAD(STREAM_FRICTION);
+			active = _mm256_cmp_ps(totalImpulse, zero, _CMP_GT_OQ);
+			upperLimit = _mm256_mul_ps(friction, totalImpulse);
+			lowerLimit = _mm256_sub_ps(zero, upperLimit);
+		}
+
+		const __m256 appliedImpulse = BT_WIDE_LOAD(STREAM_APPLIED_IMPULSE);
+		const __m256 jacDiagABInv = BT_WIDE_LOAD(STREAM_JAC_DIAG_AB_INV);
+		__m256 deltaImpulse = _mm256_sub_ps(BT_WIDE_LOAD(STREAM_RHS), _mm256_mul_ps(appliedImpulse, BT_WIDE_LOAD(STREAM_CFM)));
+		const __m256 deltaVel1Dotn = _mm256_add_ps(
+			BT_WIDE_DOT3(_mm256_mul_ps, _mm256_add_ps, BT_WIDE_LOAD(STREAM_NORMAL1_X), BT_WIDE_LOAD(STREAM_NORMAL1_Y), BT_WIDE_LOAD(STREAM_NORMAL1_Z), linAx, linAy, linAz),
+			BT_WIDE_DOT3(_mm256_mul_ps, _mm256_add_ps, BT_WIDE_LOAD(STREAM_RELPOS1_CROSS_NORMAL_X), BT_WIDE_LOAD(STREAM_RELPOS1_CROSS_NORMAL_Y), BT_WIDE_LOAD(STREAM_RELPOS1_CROSS_NORMAL_Z), angAx, angAy, angAz));
+		const __m256 deltaVel2Dotn = _mm256_add_ps(
+			BT_WIDE_DOT3(_mm256_mul_ps, _mm256_add_ps, BT_WIDE_LOAD(STREAM_NORMAL2_X), BT_WIDE_LOAD(STREAM_NORMAL2_Y), BT_WIDE_LOAD(STREAM_NORMAL2_Z), linBx, linBy, linBz),
+			BT_WIDE_DOT3(_mm256_mul_ps, _mm256_add_ps, BT_WIDE_LOAD(STREAM_RELPOS2_CROSS_NORMAL_X), BT_WIDE_LOAD(STREAM_RELPOS2_CROSS_NORMAL_Y), BT_WIDE_LOAD(STREAM_RELPOS2_CROSS_NORMAL_Z), angBx, angBy, angBz));
+		deltaImpulse = _mm256_sub_ps(deltaImpulse, _mm256_mul_ps(deltaVel1Dotn, jacDiagABInv));
+		deltaImpulse = _mm256_sub_ps(deltaImpulse, _mm256_mul_ps(deltaVel2Dotn, jacDiagABInv));
+
+		const __m256 sum = _mm256_add_ps(appliedImpulse, deltaImpulse);
+		const __m256 belowLower = _mm256_cmp_ps(sum, lowerLimit, _CMP_LT_OQ);
+		const __m256 aboveUpper = _mm256_andnot_ps(belowLower, _mm256_cmp_ps(sum, upperLimit, _CMP_GT_OQ));
+		__m256 newAppliedImpulse = _mm256_blendv_ps(sum, lowerLimit, belowLower);
+		newAppliedImpulse = _mm256_blendv_ps(newAppliedImpulse, upperLimit, aboveUpper);
+		deltaImpulse = _mm256_blendv_ps(deltaImpulse, _mm256_sub_ps(newAppliedImpulse, appliedImpulse), _mm256_or_ps(belowLower, aboveUpper));
+		deltaImpulse = _mm256_and_ps(deltaImpulse, active);
+		_mm256_storeu_ps(p.m_data + block * btWideConstraintBlocks::STREAM_COUNT * 8 + btWideConstraintBlocks::STREAM_APPLIED_IMPULSE * 8,
+						 _mm256_blendv_ps(appliedImpulse, newAppliedImpulse, active));
+
+		_mm256_storeu_ps(scatter[0], _mm256_add_ps(linAx, _mm256_mul_ps(BT_WIDE_LOAD(STREAM_LINEAR_A_X), deltaImpulse)));
+		_mm256_storeu_ps(scatter[1], _mm256_add_ps(linAy, _mm256_mul_ps(BT_WIDE_LOAD(STREAM_LINEAR_A_Y), deltaImpulse)));
+		_mm256_storeu_ps(scatter[2], _mm256_add_ps(linAz, _mm256_mul_ps(BT_WIDE_LOAD(STREAM_LINEAR_A_Z), deltaImpulse)));
+		_mm256_storeu_ps(scatter[3], _mm256_add_ps(angAx, _mm256_mul_ps(BT_WIDE_LOAD(STREAM_ANGULAR_A_X), deltaImpulse)));
+		_mm256_storeu_ps(scatter[4], _mm256_add_ps(angAy, _mm256_mul_ps(BT_WIDE_LOAD(STREAM_ANGULAR_A_Y), deltaImpulse)));
+		_mm256_storeu_ps(scatter[5], _mm256_add_ps(angAz, _mm256_mul_ps(BT_WIDE_LOAD(STREAM_ANGULAR_A_Z), deltaImpulse)));
+		_mm256_storeu_ps(scatter[6], _mm256_add_ps(linBx, _mm256_mul_ps(BT_WIDE_LOAD(STREAM_LINEAR_B_X), deltaImpulse)));
+		_mm256_storeu_ps(scatter[7], _mm256_add_ps(linBy, _mm256_mul_ps(BT_WIDE_LOAD(STREAM_LINEAR_B_Y), deltaImpulse)));
+		_mm256_storeu_ps(scatter[8], _mm256_add_ps(linBz, _mm256_mul_ps(BT_WIDE_LOAD(STREAM_LINEAR_B_Z), deltaImpulse)));
+		_mm256_storeu_ps(scatter[9], _mm256_add_ps(angBx, _mm256_mul_ps(BT_WIDE_LOAD(STREAM_ANGULAR_B_X), deltaImpulse)));
+		_mm256_storeu_ps(scatter[10], _mm256_add_ps(angBy, _mm256_mul_ps(BT_WIDE_LOAD(STREAM_ANGULAR_B_Y), deltaImpulse)));
+		_mm256_storeu_ps(scatter[11], _mm256_add_ps(angBz, _mm256_mul_ps(BT_WIDE_LOAD(STREAM_ANGULAR_B_Z), deltaImpulse)));
+
+		// AVX2 has no scatter instruction; the lanes never share a body, so the stores can go in any order
+		for (int lane = 0; lane < 8; ++lane)
+		{
+			const int bodyIdA = p.m_bodyIdA[block * 8 + lane];
+			if (bodyIdA >= 0)
+			{
+				float* body = p.m_bodyData + bodyIdA * p.m_bodyStride;
+				body[p.m_linearOffset + 0] = scatter[0][lane];
+				body[p.m_linearOffset + 1] = scatter[1][lane];
+				body[p.m_linearOffset + 2] = scatter[2][lane];
+				body[p.m_angularOffset + 0] = scatter[3][lane];
+				body[p.m_angularOffset + 1] = scatter[4][lane];
+				body[p.m_angularOffset + 2] = scatter[5][lane];
+			}
+			const int bodyIdB = p.m_bodyIdB[block * 8 + lane];
+			if (bodyIdB >= 0)
+			{
+				float* body = p.m_bodyData + bodyIdB * p.m_bodyStride;
+				body[p.m_linearOffset + 0] = scatter[6][lane];
+				body[p.m_linearOffset + 1] = scatter[7][lane];
+				body[p.m_linearOffset + 2] = scatter[8][lane];
+				body[p.m_angularOffset + 0] = scatter[9][lane];
+				body[p.m_angularOffset + 1] = scatter[10][lane];
+				body[p.m_angularOffset + 2] = scatter[11][lane];
+			}
+		}
+
+		const __m256 residual = _mm256_and_ps(_mm256_mul_ps(deltaImpulse, _mm256_div_ps(one, jacDiagABInv)), active);
+		leastSquaresResidual = _mm256_max_ps(leastSquaresResidual, _mm256_mul_ps(residual, residual));
+#undef BT_WIDE_LOAD
+	}
+
+	float lanes[8];
+	_mm256_storeu_ps(lanes, leastSquaresResidual);
+	btScalar result = btScalar(0);
+	for (int lane = 0; lane < 8; ++lane)
+	{
+		result = btMax(result, lanes[lane]);
+	}
+	return result;
+}
+
+BT_WIDE_TARGET_AVX512 static btScalar solveBlocksAvx512(const btWideSolveParams& p)
+{
+	btAssert(p.m_laneCount == 16);
+	const __m512 zero = _mm512_setzero_ps();
+	const __m512 one = _mm512_set1_ps(1.0f);
+	const __m512i minusOne = _mm512_set1_epi32(-1);
+	const __m512i stride = _mm512_set1_epi32(p.m_bodyStride);
+	const __m512i linearOffset = _mm512_set1_epi32(p.m_linearOffset);
+	const __m512i angularOffset = _mm512_set1_epi32(p.m_angularOffset);
+	const __m512i offsetY = _mm512_set1_epi32(1);
+	const __m512i offsetZ = _mm512_set1_epi32(2);
+	__m512 leastSquaresResidual = zero;
+
+	for (int block = 0; block < p.m_numBlocks; ++block)
+	{
+		float* s = p.m_data + block * btWideConstraintBlocks::STREAM_COUNT * 16;
+#define BT_WIDE_LOAD(stream) _mm512_loadu_ps(s + btWideConstraintBlocks::stream * 16)
+		const __m512i idA = _mm512_loadu_si512(p.m_bodyIdA + block * 16);
+		const __m512i idB = _mm512_loadu_si512(p.m_bodyIdB + block * 16);
+		const __mmask16 maskA = _mm512_cmpgt_epi32_mask(idA, minusOne);
+		const __mmask16 maskB = _mm512_cmpgt_epi32_mask(idB, minusOne);
+		const __m512i linA = _mm512_add_epi32(_mm512_mullo_epi32(idA, stride), linearOffset);
+		const __m512i angA = _mm512_add_epi32(_mm512_mullo_epi32(idA, stride), angularOffset);
+		const __m512i linB = _mm512_add_epi32(_mm512_mullo_epi32(idB, stride), linearOffset);
+		const __m512i angB = _mm512_add_epi32(_mm512_mullo_epi32(idB, stride), angularOffset);
+
+		const __m512 linAx = _mm512_mask_i32gather_ps(zero, maskA, linA, p.m_bodyData, 4);
+		const __m512 linAy = _mm512_mask_i32gather_ps(zero, maskA, _mm512_add_epi32(linA, offsetY), p.m_bodyData, 4);
+		const __m512 linAz = _mm512_mask_i32gather_ps(zero, maskA, _mm512_add_epi32(linA, offsetZ), p.m_bodyData, 4);
+		const __m512 angAx = _mm512_mask_i32gather_ps(zero, maskA, angA, p.m_bodyData, 4);
+		const __m512 angAy = _mm512_mask_i32gather_ps(zero, maskA, _mm512_add_epi32(angA, offsetY), p.m_bodyData, 4);
+		const __m512 angAz = _mm512_mask_i32gather_ps(zero, maskA, _mm512_add_epi32(angA, offsetZ), p.m_bodyData, 4);
+		const __m512 linBx = _mm512_mask_i32gather_ps(zero, maskB, linB, p.m_bodyData, 4);
+		const __m512 linBy = _mm512_mask_i32gather_ps(zero, maskB, _mm512_add_epi32(linB, offsetY), p.m_bodyData, 4);
+		const __m512 linBz = _mm512_mask_i32gather_ps(zero, maskB, _mm512_add_epi32(linB, offsetZ), p.m_bodyData, 4);
+		const __m512 angBx = _mm512_mask_i32gather_ps(zero, maskB, angB, p.m_bodyData, 4);
+		const __m512 angBy = _mm512_mask_i32gather_ps(zero, maskB, _mm512_add_epi32(angB, offsetY), p.m_bodyData, 4);
+		const __m512 angBz = _mm512_mask_i32gather_ps(zero, maskB, _mm512_add_epi32(angB, offsetZ), p.m_bodyData, 4);
+
+		__m512 lowerLimit = BT_WIDE_LOAD(STREAM_LOWER_LIMIT);
+		__m512 upperLimit = BT_WIDE_LOAD(STREAM_UPPER_LIMIT);
+		__mmask16 active = 0xffff;
+		if (p.m_normalImpulses)
+		{
+			const __m512i slot = _mm512_loadu_si512(p.m_normalSlot + block * 16);
+			const __m512 totalImpulse = _mm512_mask_i32gather_ps(zero, _mm512_cmpgt_epi32_mask(slot, minusOne), slot, p.m_normalImpulses, 4);
+			active = _mm512_cmp_ps_mask(totalImpulse, zero, _CMP_GT_OQ);
+			upperLimit = _mm512_mul_ps(BT_WIDE_LOAD(STREAM_FRICTION), totalImpulse);
+			lowerLimit = _mm512_sub_ps(zero, upperLimit);
+		}
+
+		const __m512 appliedImpulse = BT_WIDE_LOAD(STREAM_APPLIED_IMPULSE);
+		const __m512 jacDiagABInv = BT_WIDE_LOAD(STREAM_JAC_DIAG_AB_INV);
+		__m512 deltaImpulse = _mm512_sub_ps(BT_WIDE_LOAD(STREAM_RHS), _mm512_mul_ps(appliedImpulse, BT_WIDE_LOAD(STREAM_CFM)));
+		const __m512 deltaVel1Dotn = _mm512_add_ps(
+			BT_WIDE_DOT3(_mm512_mul_ps, _mm512_add_ps, BT_WIDE_LOAD(STREAM_NORMAL1_X), BT_WIDE_LOAD(STREAM_NORMAL1_Y), BT_WIDE_LOAD(STREAM_NORMAL1_Z), linAx, linAy, linAz),
+			BT_WIDE_DOT3(_mm512_mul_ps, _mm512_add_ps, BT_WIDE_LOAD(STREAM_RELPOS1_CROSS_NORMAL_X), BT_WIDE_LOAD(STREAM_RELPOS1_CROSS_NORMAL_Y), BT_WIDE_LOAD(STREAM_RELPOS1_CROSS_NORMAL_Z), angAx, angAy, angAz));
+		const __m512 deltaVel2Dotn = _mm512_add_ps(
+			BT_WIDE_DOT3(_mm512_mul_ps, _mm512_add_ps, BT_WIDE_LOAD(STREAM_NORMAL2_X), BT_WIDE_LOAD(STREAM_NORMAL2_Y), BT_WIDE_LOAD(STREAM_NORMAL2_Z), linBx, linBy, linBz),
+			BT_WIDE_DOT3(_mm512_mul_ps, _mm512_add_ps, BT_WIDE_LOAD(STREAM_RELPOS2_CROSS_NORMAL_X), BT_WIDE_LOAD(STREAM_RELPOS2_CROSS_NORMAL_Y), BT_WIDE_LOAD(STREAM_RELPOS2_CROSS_NORMAL_Z), angBx, angBy, angBz));
+		deltaImpulse = _mm512_sub_ps(deltaImpulse, _mm512_mul_ps(deltaVel1Dotn, jacDiagABInv));
+		deltaImpulse = _mm512_sub_ps(deltaImpulse, _mm512_mul_ps(deltaVel2Dotn, jacDiagABInv));
+
+		const __m512 sum = _mm512_add_ps(appliedImpulse, deltaImpulse);
+		const __mmask16 belowLower = _mm512_cmp_ps_mask(sum, lowerLimit, _CMP_LT_OQ);
+		const __mmask16 aboveUpper = (__mmask16)(~belowLower & _mm512_cmp_ps_mask(sum, upperLimit, _CMP_GT_OQ));
+		__m512 newAppliedImpulse = _mm512_mask_blend_ps(belowLower, sum, lowerLimit);
+		newAppliedImpulse = _mm512_mask_blend_ps(aboveUpper, newAppliedImpulse, upperLimit);
+		deltaImpulse = _mm512_mask_blend_ps((__mmask16)(belowLower | aboveUpper), deltaImpulse, _mm512_sub_ps(newAppliedImpulse, appliedImpulse));
+		deltaImpulse = _mm512_maskz_mov_ps(active, deltaImpulse);
+		_mm512_mask_storeu_ps(s + btWideConstraintBlocks::STREAM_APPLIED_IMPULSE * 16, active, newAppliedImpulse);
+
+		// the lanes never share a body, so the scatters cannot collide
+		_mm512_mask_i32scatter_ps(p.m_bodyData, maskA, linA, _mm512_add_ps(linAx, _mm512_mul_ps(BT_WIDE_LOAD(STREAM_LINEAR_A_X), deltaImpulse)), 4);
+		_mm512_mask_i32scatter_ps(p.m_bodyData, maskA, _mm512_add_epi32(linA, offsetY), _mm512_add_ps(linAy, _mm512_mul_ps(BT_WIDE_LOAD(STREAM_LINEAR_A_Y), deltaImpulse)), 4);
+		_mm512_mask_i32scatter_ps(p.m_bodyData, maskA, _mm512_add_epi32(linA, offsetZ), _mm512_add_ps(linAz, _mm512_mul_ps(BT_WIDE_LOAD(STREAM_LINEAR_A_Z), deltaImpulse)), 4);
+		_mm512_mask_i32scatter_ps(p.m_bodyData, maskA, angA, _mm512_add_ps(angAx, _mm512_mul_ps(BT_WIDE_LOAD(STREAM_ANGULAR_A_X), deltaImpulse)), 4);
+		_mm512_mask_i32scatter_ps(p.m_bodyData, maskA, _mm512_add_epi32(angA, offsetY), _mm512_add_ps(angAy, _mm512_mul_ps(BT_WIDE_LOAD(STREAM_ANGULAR_A_Y), deltaImpulse)), 4);
+		_mm512_mask_i32scatter_ps(p.m_bodyData, maskA, _mm512_add_epi32(angA, offsetZ), _mm512_add_ps(angAz, _mm512_mul_ps(BT_WIDE_LOAD(STREAM_ANGULAR_A_Z), deltaImpulse)), 4);
+		_mm512_mask_i32scatter_ps(p.m_bodyData, maskB, linB, _mm512_add_ps(linBx, _mm512_mul_ps(BT_WIDE_LOAD(STREAM_LINEAR_B_X), deltaImpulse)), 4);
+		_mm512_mask_i32scatter_ps(p.m_bodyData, maskB, _mm512_add_epi32(linB, offsetY), _mm512_add_ps(linBy, _mm512_mul_ps(BT_WIDE_LOAD(STREAM_LINEAR_B_Y), deltaImpulse)), 4);
+		_mm512_mask_i32scatter_ps(p.m_bodyData, maskB, _mm512_add_epi32(linB, offsetZ), _mm512_add_ps(linBz, _mm512_mul_ps(BT_WIDE_LOAD(STREAM_LINEAR_B_Z), deltaImpulse)), 4);
+		_mm512_mask_i32scatter_ps(p.m_bodyData, maskB, angB, _mm512_add_ps(angBx, _mm512_mul_ps(BT_WIDE_LOAD(STREAM_ANGULAR_B_X), deltaImpulse)), 4);
+		_mm512_mask_i32scatter_ps(p.m_bodyData, maskB, _mm512_add_epi32(angB, offsetY), _mm512_add_ps(angBy, _mm512_mul_ps(BT_WIDE_LOAD(STREAM_ANGULAR_B_Y), deltaImpulse)), 4);
+		_mm512_mask_i32scatter_ps(p.m_bodyData, maskB, _mm512_add_epi32(angB, offsetZ), _mm512_add_ps(angBz, _mm512_mul_ps(BT_WIDE_LOAD(STREAM_ANGULAR_B_Z), deltaImpulse)), 4);
+
+		const __m512 residual = _mm512_maskz_mov_ps(active, _mm512_mul_ps(deltaImpulse, _mm512_div_ps(one, jacDiagABInv)));
+		leastSquaresResidual = _mm512_max_ps(leastSquaresResidual, _mm512_mul_ps(residual, residual));
+#undef BT_WIDE_LOAD
+	}
+
+	float lanes[16];
+	_mm512_storeu_ps(lanes, leastSquaresResidual);
+	btScalar result = btScalar(0);
+	for (int lane = 0; lane < 16; ++lane)
+	{
+		result = btMax(result, lanes[lane]);
+	}
+	return result;
+}
+
+#undef BT_WIDE_DOT3
+
+#endif  //BT_WIDE_X86_KERNELS
+
+btWideConstraintBlocks::btWideConstraintBlocks()
+{
+	m_kernel = KERNEL_SCALAR;
+	m_laneCount = getKernelLaneCount(m_kernel);
+	m_numBlocks = 0;
+	m_numRows = 0;
+}
+
+bool btWideConstraintBlocks::isKernelSupported(SolverKernel kernel)
+{
+	switch (kernel)
+	{
+		case KERNEL_SCALAR:
+			return true;
+#ifdef BT_WIDE_X86_KERNELS
+		case KERNEL_AVX2:
+			return (btCpuFeatureUtility::getCpuFeatures() & btCpuFeatureUtility::CPU_FEATURE_AVX2) != 0;
+		case KERNEL_AVX512:
+			return (btCpuFeatureUtility::getCpuFeatures() & btCpuFeatureUtility::CPU_FEATURE_AVX512F) != 0;
+#endif
+		default:
+			return false;
+	}
+}
+
+btWideConstraintBlocks::SolverKernel btWideConstraintBlocks::chooseKernel()
+{
+	if (s_preferredKernel >= KERNEL_AVX512 && isKernelSupported(KERNEL_AVX512))
+	{
+		return KERNEL_AVX512;
+	}
+	if (s_preferredKernel >= KERNEL_AVX2 && isKernelSupported(KERNEL_AVX2))
+	{
+		return KERNEL_AVX2;
+	}
+	return KERNEL_SCALAR;
+}
+
+int btWideConstraintBlocks::getKernelLaneCount(SolverKernel kernel)
+{
+	return kernel == KERNEL_AVX512 ? kMaxLaneCount : 8;
+}
+
+const char* btWideConstraintBlocks::getKernelName(SolverKernel kernel)
+{
+	switch (kernel)
+	{
+		case KERNEL_SCALAR:
+			return "scalar";
+		case KERNEL_AVX2:
+			return "AVX2";
+		case KERNEL_AVX512:
+			return "AVX-512";
+		default:
+			return "unknown";
+	}
+}
+
+void btWideConstraintBlocks::allocateBlocks(int numBlocks)
+{
+	const int numLanes = numBlocks * m_laneCount;
+	if (m_rowIndex.capacity() < numLanes)
+	{
+		// resize() reserves exactly the requested size, so grow geometrically to keep packing linear
+		const int reserveLanes = btMax(numLanes * 2, m_numRows + kMaxOpenBlocks * m_laneCount);
+		m_bodyIdA.reserve(reserveLanes);
+		m_bodyIdB.reserve(reserveLanes);
+		m_rowIndex.reserve(reserveLanes);
+	}
+	m_bodyIdA.resize(numLanes, -1);
+	m_bodyIdB.resize(numLanes, -1);
+	m_rowIndex.resize(numLanes, -1);
+	m_numBlocks = numBlocks;
+}
+
+void btWideConstraintBlocks::assignLane(int laneIndex, int iRow, int bodyIdA, int bodyIdB)
+{
+	m_bodyIdA[laneIndex] = bodyIdA;
+	m_bodyIdB[laneIndex] = bodyIdB;
+	m_rowIndex[laneIndex] = iRow;
+	m_rowSlot[iRow] = laneIndex;
+}
+
+void btWideConstraintBlocks::packContactRows(const btConstraintArray* rows)
+{
+	// Greedily pack the rows into blocks, keeping a bit per open block in each body to detect conflicts.
+	// The pool holds the contacts manifold by manifold, and neighbouring manifolds tend to share bodies,
+	// so the rows are visited with a stride of one block's worth of pool: consecutive visits then come
+	// from far apart manifolds and rarely conflict. The packer only reads the compact body ids gathered here
+	const int W = m_laneCount;
+	m_bodyOpenBlockMask.resizeNoInitialize(m_dynamicBodyId.size());
+	for (int iBody = 0; iBody < m_bodyOpenBlockMask.size(); ++iBody)
+	{
+		m_bodyOpenBlockMask[iBody] = 0;
+	}
+	m_rowBodyIds.resizeNoInitialize(m_numRows * 2);
+	for (int iRow = 0; iRow < m_numRows; ++iRow)
+	{
+		const btSolverConstraint& row = (*rows)[iRow];
+		m_rowBodyIds[iRow * 2] = m_dynamicBodyId[row.m_solverBodyIdA];
+		m_rowBodyIds[iRow * 2 + 1] = m_dynamicBodyId[row.m_solverBodyIdB];
+	}
+	m_visitOrder.resizeNoInitialize(0);
+	const int stride = (m_numRows + W - 1) / W;
+	for (int start = 0; start < stride; ++start)
+	{
+		for (int iRow = start; iRow < m_numRows; iRow += stride)
+		{
+			m_visitOrder.push_back(iRow);
+		}
+	}
+
+	int openBlock[kMaxOpenBlocks];
+	int openLaneCount[kMaxOpenBlocks];
+	for (int i = 0; i < kMaxOpenBlocks; ++i)
+	{
+		openBlock[i] = -1;
+		openLaneCount[i] = 0;
+	}
+
+	for (int iVisit = 0; iVisit < m_visitOrder.size(); ++iVisit)
+	{
+		const int iRow = m_visitOrder[iVisit];
+		const int bodyIdA = m_rowBodyIds[iRow * 2];
+		const int bodyIdB = m_rowBodyIds[iRow * 2 + 1];
+		const unsigned int busy = (bodyIdA >= 0 ? m_bodyOpenBlockMask[bodyIdA] : 0) | (bodyIdB >= 0 ? m_bodyOpenBlockMask[bodyIdB] : 0);
+
+		// prefer the oldest open block without a conflict, so rows keep roughly the order they were visited in
+		int slot = -1;
+		int oldestSlot = -1;
+		int freeSlot = -1;
+		for (int i = 0; i < kMaxOpenBlocks; ++i)
+		{
+			if (openBlock[i] < 0)
+			{
+				freeSlot = i;
+				continue;
+			}
+			if (oldestSlot < 0 || openBlock[i] < openBlock[oldestSlot])
+			{
+				oldestSlot = i;
+			}
+			if (!(busy & (1u << i)) && (slot < 0 || openBlock[i] < openBlock[slot]))
+			{
+				slot = i;
+			}
+		}
+		if (slot < 0)
+		{
+			if (freeSlot < 0)
+			{
+				// every open block conflicts: close the oldest one and leave its remaining lanes empty
+				for (int lane = 0; lane < openLaneCount[oldestSlot]; ++lane)
+				{
+					const int index = openBlock[oldestSlot] * W + lane;
+					if (m_bodyIdA[index] >= 0)
+						m_bodyOpenBlockMask[m_bodyIdA[index]] &= ~(1u << oldestSlot);
+					if (m_bodyIdB[index] >= 0)
+						m_bodyOpenBlockMask[m_bodyIdB[index]] &= ~(1u << oldestSlot);
+				}
+				freeSlot = oldestSlot;
+			}
+			slot = freeSlot;
+			openBlock[slot] = m_numBlocks;
+			openLaneCount[slot] = 0;
+			allocateBlocks(m_numBlocks + 1);
+		}
+
+		assignLane(openBlock[slot] * W + openLaneCount[slot]++, iRow, bodyIdA, bodyIdB);
+		if (bodyIdA >= 0)
+			m_bodyOpenBlockMask[bodyIdA] |= 1u << slot;
+		if (bodyIdB >= 0)
+			m_bodyOpenBlockMask[bodyIdB] |= 1u << slot;
+
+		if (openLaneCount[slot] == W)
+		{
+			for (int i = 0; i < W; ++i)
+			{
+				const int laneIndex = openBlock[slot] * W + i;
+				if (m_bodyIdA[laneIndex] >= 0)
+					m_bodyOpenBlockMask[m_bodyIdA[laneIndex]] &= ~(1u << slot);
+				if (m_bodyIdB[laneIndex] >= 0)
+					m_bodyOpenBlockMask[m_bodyIdB[laneIndex]] &= ~(1u << slot);
+			}
+			openBlock[slot] = -1;
+		}
+	}
+}
+
+void btWideConstraintBlocks::layOutFrictionRows(const btConstraintArray* rows, const btWideConstraintBlocks* contactBlocks)
+{
+	// Friction rows act on the same bodies as their contact, so they can reuse the conflict free layout
+	// of the contact blocks: the k-th friction row of a contact takes the lane of that contact in the k-th layer of blocks.
+	// Layers are only as long as the contact blocks they copy, and blocks left without rows are dropped afterwards
+	const int W = m_laneCount;
+	const int layerBlocks = contactBlocks->m_numBlocks;
+	btAssert(contactBlocks->m_laneCount == W);
+	m_contactRowCount.resizeNoInitialize(0);
+	m_contactRowCount.resize(contactBlocks->m_numRows, 0);
+	int numLayers = 0;
+	for (int iRow = 0; iRow < m_numRows; ++iRow)
+	{
+		btAssert((*rows)[iRow].m_frictionIndex >= 0 && (*rows)[iRow].m_frictionIndex < contactBlocks->m_numRows);
+		numLayers = btMax(numLayers, ++m_contactRowCount[(*rows)[iRow].m_frictionIndex]);
+	}
+	allocateBlocks(numLayers * layerBlocks);
+	for (int iContact = 0; iContact < m_contactRowCount.size(); ++iContact)
+	{
+		m_contactRowCount[iContact] = 0;
+	}
+	for (int iRow = 0; iRow < m_numRows; ++iRow)
+	{
+		const btSolverConstraint& row = (*rows)[iRow];
+		const int contactSlot = contactBlocks->m_rowSlot[row.m_frictionIndex];
+		const int contactLane = contactSlot / (STREAM_COUNT * W) * W + contactSlot % W;
+		const int layer = m_contactRowCount[row.m_frictionIndex]++;
+		assignLane(layer * layerBlocks * W + contactLane, iRow, m_dynamicBodyId[row.m_solverBodyIdA], m_dynamicBodyId[row.m_solverBodyIdB]);
+	}
+
+	// drop empty blocks, which appear when only some contacts have a second friction direction
+	int numBlocks = 0;
+	for (int block = 0; block < m_numBlocks; ++block)
+	{
+		bool isEmpty = true;
+		for (int lane = 0; lane < W && isEmpty; ++lane)
+		{
+			isEmpty = m_rowIndex[block * W + lane] < 0;
+		}
+		if (isEmpty)
+		{
+			continue;
+		}
+		for (int lane = 0; lane < W; ++lane)
+		{
+			const int iRow = m_rowIndex[block * W + lane];
+			if (iRow >= 0)
+			{
+				assignLane(numBlocks * W + lane, iRow, m_bodyIdA[block * W + lane], m_bodyIdB[block * W + lane]);
+			}
+			else
+			{
+				m_bodyIdA[numBlocks * W + lane] = -1;
+				m_bodyIdB[numBlocks * W + lane] = -1;
+				m_rowIndex[numBlocks * W + lane] = -1;
+			}
+		}
+		++numBlocks;
+	}
+	allocateBlocks(numBlocks);
+}
+
+void btWideConstraintBlocks::setup(btConstraintArray* rows,
+								   const btAlignedObjectArray<btSolverBody>& bodies,
+								   const btWideConstraintBlocks* contactBlocks)
+{
+	BT_PROFILE("btWideConstraintBlocks::setup");
+	m_kernel = chooseKernel();
+	m_laneCount = getKernelLaneCount(m_kernel);
+	m_numBlocks = 0;
+	m_numRows = rows->size();
+	m_data.resizeNoInitialize(0);
+	m_bodyIdA.resizeNoInitialize(0);
+	m_bodyIdB.resizeNoInitialize(0);
+	m_rowIndex.resizeNoInitialize(0);
+	m_normalSlot.resizeNoInitialize(0);
+	m_rowSlot.resizeNoInitialize(m_numRows);
+	if (m_numRows == 0)
+	{
+		return;
+	}
+
+	const int W = m_laneCount;
+	m_dynamicBodyId.resizeNoInitialize(bodies.size());
+	for (int iBody = 0; iBody < bodies.size(); ++iBody)
+	{
+		// look at each rigid body once here rather than twice per row
+		m_dynamicBodyId[iBody] = isBodyDynamic(bodies[iBody]) ? iBody : -1;
+	}
+	if (contactBlocks)
+	{
+		layOutFrictionRows(rows, contactBlocks);
+	}
+	else
+	{
+		packContactRows(rows);
+	}
+
+	// copy the rows block by block and stream by stream, so every cache line of m_data is written in one go.
+	// Empty lanes read a row that solves to a zero impulse: no bodies, zero limits and a unit diagonal to keep the residual finite
+	btSolverConstraint emptyRow = btSolverConstraint();
+	emptyRow.m_jacDiagABInv = btScalar(1);
+	const btVector3 zero(0, 0, 0);
+	m_data.resizeNoInitialize(m_numBlocks * STREAM_COUNT * W);
+	if (contactBlocks)
+	{
+		m_normalSlot.resizeNoInitialize(m_numBlocks * W);
+	}
+	for (int block = 0; block < m_numBlocks; ++block)
+	{
+		const btSolverConstraint* laneRows[kMaxLaneCount];
+		btVector3 linearA[kMaxLaneCount];
+		btVector3 angularA[kMaxLaneCount];
+		btVector3 linearB[kMaxLaneCount];
+		btVector3 angularB[kMaxLaneCount];
+		for (int lane = 0; lane < W; ++lane)
+		{
+			const int iRow = m_rowIndex[block * W + lane];
+			const btSolverConstraint& row = iRow >= 0 ? (*rows)[iRow] : emptyRow;
+			const btSolverBody& bodyA = bodies[row.m_solverBodyIdA];
+			const btSolverBody& bodyB = bodies[row.m_solverBodyIdB];
+			const bool dynamicA = m_bodyIdA[block * W + lane] >= 0;
+			const bool dynamicB = m_bodyIdB[block * W + lane] >= 0;
+			laneRows[lane] = &row;
+			linearA[lane] = dynamicA ? row.m_contactNormal1 * bodyA.internalGetInvMass() * bodyA.m_linearFactor : zero;
+			angularA[lane] = dynamicA ? row.m_angularComponentA * bodyA.m_angularFactor : zero;
+			linearB[lane] = dynamicB ? row.m_contactNormal2 * bodyB.internalGetInvMass() * bodyB.m_linearFactor : zero;
+			angularB[lane] = dynamicB ? row.m_angularComponentB * bodyB.m_angularFactor : zero;
+			if (iRow >= 0)
+			{
+				m_rowSlot[iRow] = getSlot(block, STREAM_APPLIED_IMPULSE, lane);
+			}
+			if (contactBlocks)
+			{
+				btAssert(iRow < 0 || (row.m_frictionIndex >= 0 && row.m_frictionIndex < contactBlocks->m_rowSlot.size()));
+				m_normalSlot[block * W + lane] = iRow >= 0 ? contactBlocks->m_rowSlot[row.m_frictionIndex] : -1;
+			}
+		}
+		btScalar* out = &m_data[getSlot(block, 0, 0)];
+		for (int i = 0; i < 3; ++i)
+		{
+			for (int lane = 0; lane < W; ++lane)
+				out[(STREAM_NORMAL1_X + i) * W + lane] = laneRows[lane]->m_contactNormal1[i];
+			for (int lane = 0; lane < W; ++lane)
+				out[(STREAM_RELPOS1_CROSS_NORMAL_X + i) * W + lane] = laneRows[lane]->m_relpos1CrossNormal[i];
+			for (int lane = 0; lane < W; ++lane)
+				out[(STREAM_NORMAL2_X + i) * W + lane] = laneRows[lane]->m_contactNormal2[i];
+			for (int lane = 0; lane < W; ++lane)
+				out[(STREAM_RELPOS2_CROSS_NORMAL_X + i) * W + lane] = laneRows[lane]->m_relpos2CrossNormal[i];
+		}
+		for (int i = 0; i < 3; ++i)
+		{
+			for (int lane = 0; lane < W; ++lane)
+				out[(STREAM_LINEAR_A_X + i) * W + lane] = linearA[lane][i];
+			for (int lane = 0; lane < W; ++lane)
+				out[(STREAM_ANGULAR_A_X + i) * W + lane] = angularA[lane][i];
+			for (int lane = 0; lane < W; ++lane)
+				out[(STREAM_LINEAR_B_X + i) * W + lane] = linearB[lane][i];
+			for (int lane = 0; lane < W; ++lane)
+				out[(STREAM_ANGULAR_B_X + i) * W + lane] = angularB[lane][i];
+		}
+		for (int lane = 0; lane < W; ++lane)
+		{
+			out[STREAM_RHS * W + lane] = laneRows[lane]->m_rhs;
+			out[STREAM_CFM * W + lane] = laneRows[lane]->m_cfm;
+			out[STREAM_JAC_DIAG_AB_INV * W + lane] = laneRows[lane]->m_jacDiagABInv;
+			out[STREAM_LOWER_LIMIT * W + lane] = laneRows[lane]->m_lowerLimit;
+			out[STREAM_UPPER_LIMIT * W + lane] = laneRows[lane]->m_upperLimit;
+			out[STREAM_FRICTION * W + lane] = laneRows[lane]->m_friction;
+			out[STREAM_APPLIED_IMPULSE * W + lane] = btScalar(laneRows[lane]->m_appliedImpulse);
+		}
+	}
+	btAssert(validate(rows, bodies));
+}
+
+btScalar btWideConstraintBlocks::solve(btAlignedObjectArray<btSolverBody>& bodies, const btWideConstraintBlocks* contactBlocks)
+{
+	if (m_numBlocks == 0)
+	{
+		return btScalar(0);
+	}
+	BT_PROFILE("btWideConstraintBlocks::solve");
+	btAssert(sizeof(btSolverBody) % sizeof(btScalar) == 0);
+	btScalar* bodyData = reinterpret_cast<btScalar*>(&bodies[0]);
+
+	btWideSolveParams params;
+	params.m_data = &m_data[0];
+	params.m_bodyIdA = &m_bodyIdA[0];
+	params.m_bodyIdB = &m_bodyIdB[0];
+	params.m_normalSlot = contactBlocks ? &m_normalSlot[0] : NULL;
+	params.m_normalImpulses = contactBlocks && contactBlocks->m_data.size() ? &contactBlocks->m_data[0] : NULL;
+	params.m_bodyData = bodyData;
+	params.m_bodyStride = int(sizeof(btSolverBody) / sizeof(btScalar));
+	params.m_linearOffset = int(bodies[0].m_deltaLinearVelocity.m_floats - bodyData);
+	params.m_angularOffset = int(bodies[0].m_deltaAngularVelocity.m_floats - bodyData);
+	params.m_numBlocks = m_numBlocks;
+	params.m_laneCount = m_laneCount;
+	if (contactBlocks && !params.m_normalImpulses)
+	{
+		// friction without any contact rows never has a positive normal impulse
+		return btScalar(0);
+	}
+
+	switch (m_kernel)
+	{
+#ifdef BT_WIDE_X86_KERNELS
+		case KERNEL_AVX2:
+			return solveBlocksAvx2(params);
+		case KERNEL_AVX512:
+			return solveBlocksAvx512(params);
+#endif
+		default:
+			return solveBlocksScalar(params);
+	}
+}
+
+void btWideConstraintBlocks::writeBackAppliedImpulses(btConstraintArray* rows) const
+{
+	BT_PROFILE("btWideConstraintBlocks::writeBackAppliedImpulses");
+	btAssert(rows->size() == m_numRows);
+	for (int iRow = 0; iRow < m_numRows; ++iRow)
+	{
+		(*rows)[iRow].m_appliedImpulse = m_data[m_rowSlot[iRow]];
+	}
+}
+
+bool btWideConstraintBlocks::validate(const btConstraintArray* rows, const btAlignedObjectArray<btSolverBody>& bodies) const
+{
+	if (rows->size() != m_numRows || m_rowIndex.size() != m_numBlocks * m_laneCount)
+	{
+		return false;
+	}
+	btAlignedObjectArray<int> rowSeen;
+	rowSeen.resize(m_numRows, 0);
+	btAlignedObjectArray<int> bodyBlock;
+	bodyBlock.resize(bodies.size(), -1);
+	for (int block = 0; block < m_numBlocks; ++block)
+	{
+		for (int lane = 0; lane < m_laneCount; ++lane)
+		{
+			const int index = block * m_laneCount + lane;
+			const int iRow = m_rowIndex[index];
+			if (iRow < 0)
+			{
+				if (m_bodyIdA[index] >= 0 || m_bodyIdB[index] >= 0)
+					return false;
+				continue;
+			}
+			if (iRow >= m_numRows || rowSeen[iRow]++ || m_rowSlot[iRow] != getSlot(block, STREAM_APPLIED_IMPULSE, lane))
+			{
+				return false;
+			}
+			const btSolverConstraint& row = (*rows)[iRow];
+			const int ids[2] = {row.m_solverBodyIdA, row.m_solverBodyIdB};
+			const int packedIds[2] = {m_bodyIdA[index], m_bodyIdB[index]};
+			for (int i = 0; i < 2; ++i)
+			{
+				if (isBodyDynamic(bodies[ids[i]]))
+				{
+					// a dynamic body may only appear once per block
+					if (packedIds[i] != ids[i] || bodyBlock[ids[i]] == block)
+						return false;
+					bodyBlock[ids[i]] = block;
+				}
+				else if (packedIds[i] >= 0)
+				{
+					return false;
+				}
+			}
+		}
+	}
+	for (int iRow = 0; iRow < m_numRows; ++iRow)
+	{
+		if (rowSeen[iRow] != 1)
+			return false;
+	}
+	return true;
+}
@@ -0,0 +1,130 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2006 Erwin Coumans  https://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef BT_WIDE_CONSTRAINT_BLOCKS_H
+#define BT_WIDE_CONSTRAINT_BLOCKS_H
+
+#include "LinearMath/btAlignedObjectArray.h"
+#include "BulletDynamics/ConstraintSolver/btSolverBody.h"
+#include "BulletDynamics/ConstraintSolver/btSolverConstraint.h"
+
+///btWideConstraintBlocks packs contact or friction rows into structure-of-arrays blocks of 8 or 16 lanes,
+///so that one AVX2 or AVX-512 pass solves a whole block. No dynamic body appears twice in a block,
+///which lets the lanes gather and scatter body velocities without conflicts.
+///Contact rows are packed greedily, friction rows reuse the lanes of their contact.
+///btBatchedConstraints is not reused here: it only keeps whole batches apart for the worker threads, while rows
+///inside a batch may share bodies, and its batches are sized for threads rather than for 8 or 16 lanes.
+///Block setup costs about as much as five wide iterations, so SOLVER_WIDE_SIMD pays off from roughly 10 iterations.
+struct btWideConstraintBlocks
+{
+	enum SolverKernel
+	{
+		KERNEL_SCALAR,
+		KERNEL_AVX2,
+		KERNEL_AVX512,
+		KERNEL_COUNT
+	};
+
+	enum Stream
+	{
+		STREAM_NORMAL1_X,
+		STREAM_NORMAL1_Y,
+		STREAM_NORMAL1_Z,
+		STREAM_RELPOS1_CROSS_NORMAL_X,
+		STREAM_RELPOS1_CROSS_NORMAL_Y,
+		STREAM_RELPOS1_CROSS_NORMAL_Z,
+		STREAM_NORMAL2_X,
+		STREAM_NORMAL2_Y,
+		STREAM_NORMAL2_Z,
+		STREAM_RELPOS2_CROSS_NORMAL_X,
+		STREAM_RELPOS2_CROSS_NORMAL_Y,
+		STREAM_RELPOS2_CROSS_NORMAL_Z,
+		STREAM_LINEAR_A_X,  // contact normal scaled by the inverse mass and linear factor of body A
+		STREAM_LINEAR_A_Y,
+		STREAM_LINEAR_A_Z,
+		STREAM_ANGULAR_A_X,  // angular component scaled by the angular factor of body A
+		STREAM_ANGULAR_A_Y,
+		STREAM_ANGULAR_A_Z,
+		STREAM_LINEAR_B_X,
+		STREAM_LINEAR_B_Y,
+		STREAM_LINEAR_B_Z,
+		STREAM_ANGULAR_B_X,
+		STREAM_ANGULAR_B_Y,
+		STREAM_ANGULAR_B_Z,
+		STREAM_RHS,
+		STREAM_CFM,
+		STREAM_JAC_DIAG_AB_INV,
+		STREAM_LOWER_LIMIT,
+		STREAM_UPPER_LIMIT,
+		STREAM_FRICTION,
+		STREAM_APPLIED_IMPULSE,
+		STREAM_COUNT
+	};
+
+	SolverKernel m_kernel;
+	int m_laneCount;
+	int m_numBlocks;
+	int m_numRows;
+	btAlignedObjectArray<btScalar> m_data;  // STREAM_COUNT x m_laneCount scalars per block
+	btAlignedObjectArray<int> m_bodyIdA;    // solver body index per lane, -1 for empty lanes and bodies that never move
+	btAlignedObjectArray<int> m_bodyIdB;
+	btAlignedObjectArray<int> m_rowIndex;   // index into the constraint pool per lane, -1 for empty lanes
+	btAlignedObjectArray<int> m_normalSlot; // friction blocks only: offset of the contact's applied impulse in the contact blocks
+	btAlignedObjectArray<int> m_rowSlot;    // offset of the applied impulse in m_data for each pool row
+
+	btAlignedObjectArray<int> m_visitOrder;
+	btAlignedObjectArray<unsigned int> m_bodyOpenBlockMask;
+	btAlignedObjectArray<int> m_dynamicBodyId;   // solver body index, or -1 for bodies that never move
+	btAlignedObjectArray<int> m_rowBodyIds;      // dynamic body ids of each pool row, A then B
+	btAlignedObjectArray<int> m_contactRowCount;  // friction blocks only: friction rows laid out per contact
+
+	static SolverKernel s_preferredKernel;  // widest kernel to use, narrower ones are picked if the CPU lacks support
+
+	btWideConstraintBlocks();
+
+	///runtime CPU dispatch: reports whether the CPU and OS support a kernel and the build compiled it in
+	static bool isKernelSupported(SolverKernel kernel);
+	static SolverKernel chooseKernel();
+	static int getKernelLaneCount(SolverKernel kernel);
+	static const char* getKernelName(SolverKernel kernel);
+
+	///packs the rows of a pool into blocks. Friction rows pass the contact blocks so they can find the normal impulse of their contact
+	void setup(btConstraintArray* rows,
+			   const btAlignedObjectArray<btSolverBody>& bodies,
+			   const btWideConstraintBlocks* contactBlocks = NULL);
+
+	///runs one projected Gauss-Seidel pass over all blocks and returns the least squares residual.
+	///Contact rows are clamped below by their lower limit. Friction rows take their limits from the normal impulse
+	///in the contact blocks and are skipped while it is not positive, like the scalar solver does.
+	btScalar solve(btAlignedObjectArray<btSolverBody>& bodies, const btWideConstraintBlocks* contactBlocks = NULL);
+
+	///copies the applied impulses back to the constraint pool the blocks were built from
+	void writeBackAppliedImpulses(btConstraintArray* rows) const;
+
+	bool validate(const btConstraintArray* rows, const btAlignedObjectArray<btSolverBody>& bodies) const;
+
+	int getSlot(int block, int stream, int lane) const
+	{
+		return (block * STREAM_COUNT + stream) * m_laneCount + lane;
+	}
+
+private:
+	void allocateBlocks(int numBlocks);
+	void assignLane(int laneIndex, int iRow, int bodyIdA, int bodyIdB);
+	void packContactRows(const btConstraintArray* rows);
+	void layOutFrictionRows(const btConstraintArray* rows, const btWideConstraintBlocks* contactBlocks);
+};
+
+#endif  // BT_WIDE_CONSTRAINT_BLOCKS_H
@@ -45,6 +45,7 @@ subject to the following restrictions:
 #include "LinearMath/btMotionState.h"
 
 #include "LinearMath/btSerializer.h"
+#include "btWorldSnapshot.h"
 
 #if 0
 btAlignedObjectArray<btVector3> debugContacts;
@@ -612,7 +613,8 @@ void btDiscreteDynamicsWorld::updateActivationState(btScalar timeStep)
 				{
 					if (body->getActivationState() == ACTIVE_TAG)
 						body->setActivationState(WANTS_DEACTIVATION);
-					if (body->getActivationState() == ISLAND_SLEEPING)
+					//only once, so that the update revision of a sleeping body stays the same (see btWorldSnapshot)
+					if (body->getActivationState() == ISLAND_SLEEPING && !(body->getLinearVelocity().isZero() && body->getAngularVelocity().isZero()))
 					{
 						body->setAngularVelocity(btVector3(0, 0, 0));
 						body->setLinearVelocity(btVector3(0, 0, 0));
@@ -1467,3 +1469,13 @@ void btDiscreteDynamicsWorld::serialize(btSerializer* serializer)
 
 	serializer->finishSerialization();
 }
+
+void btDiscreteDynamicsWorld::captureSnapshot(btWorldSnapshot& snapshot, const btWorldSnapshot* base)
+{
+	snapshot.capture(this, m_localTime, base);
+}
+
+bool btDiscreteDynamicsWorld::restoreSnapshot(const btWorldSnapshot& snapshot, int* numLostManifolds)
+{
+	return snapshot.restore(this, m_localTime, numLostManifolds);
+}
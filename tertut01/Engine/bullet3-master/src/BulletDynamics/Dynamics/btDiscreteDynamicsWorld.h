@@ -25,6 +25,7 @@ class btTypedConstraint;
 class btActionInterface;
 class btPersistentManifold;
 class btIDebugDraw;
+class btWorldSnapshot;
 
 struct InplaceSolverIslandCallback;
 
@@ -219,6 +220,13 @@ public:
 	///Preliminary serialization test for Bullet 2.76. Loading those files requires a separate parser (see Bullet/Demos/SerializeDemo)
 	virtual void serialize(btSerializer * serializer);
 
+	///Store the state of the world in memory, see btWorldSnapshot. With a base the snapshot is a delta against it.
+	virtual void captureSnapshot(btWorldSnapshot & snapshot, const btWorldSnapshot* base = 0);
+
+	///Roll the world back to a snapshot taken from it. Returns false and leaves the world untouched when objects or
+	///constraints were added or removed since the capture.
+	virtual bool restoreSnapshot(const btWorldSnapshot& snapshot, int* numLostManifolds = 0);
+
 	///Interpolate motion state between previous and current transform, instead of current and next transform.
 	///This can relieve discontinuities in the rendering, due to penetrations
 	void setLatencyMotionStateInterpolation(bool latencyInterpolation)
@@ -23,6 +23,7 @@ subject to the following restrictions:
 #include "btSimulationIslandManagerMt.h"
 #include "LinearMath/btTransformUtil.h"
 #include "LinearMath/btQuickprof.h"
+#include "LinearMath/btStepArena.h"
 
 //rigidbody & constraints
 #include "BulletDynamics/Dynamics/btRigidBody.h"
@@ -45,6 +46,7 @@ subject to the following restrictions:
 #include "LinearMath/btMotionState.h"
 
 #include "LinearMath/btSerializer.h"
+#include <string.h>  //for memset
 
 ///
 /// btConstraintSolverPoolMt
@@ -170,6 +172,21 @@ btDiscreteDynamicsWorldMt::~btDiscreteDynamicsWorldMt()
 {
 }
 
+void btDiscreteDynamicsWorldMt::calculateSimulationIslands()
+{
+	BT_PROFILE("calculateSimulationIslands");
+
+	btSimulationIslandManagerMt* im = static_cast<btSimulationIslandManagerMt*>(m_islandManager);
+	im->updateActivationState(getCollisionWorld(), getCollisionWorld()->getDispatcher());
+
+	//merge islands based on speculative contact manifolds and constraints too
+	im->findConstraintUnions(m_predictiveManifolds.size() ? &m_predictiveManifolds[0] : NULL, m_predictiveManifolds.size(),
+							 m_constraints.size() ? &m_constraints[0] : NULL, m_constraints.size());
+
+	//Store the island id in each body
+	im->storeIslandActivationState(getCollisionWorld());
+}
+
 void btDiscreteDynamicsWorldMt::solveConstraints(btContactSolverInfo& solverInfo)
 {
 	BT_PROFILE("solveConstraints");
@@ -184,11 +201,38 @@ void btDiscreteDynamicsWorldMt::solveConstraints(btContactSolverInfo& solverInfo
 	solverParams.m_solverInfo = &solverInfo;
 	solverParams.m_debugDrawer = m_debugDrawer;
 	solverParams.m_dispatcher = getCollisionWorld()->getDispatcher();
+	IntegrateSolvedIsland integrateIsland;
+	integrateIsland.timeStep = solverInfo.m_timeStep;
+	integrateIsland.world = this;
+	solverParams.m_islandSolvedCallback = &integrateIsland;
+	// cleared every step; dispatch functions that ignore the callback leave all bodies to integrateTransforms
+	m_integratedAfterSolve.resizeNoInitialize(getNumCollisionObjects());
+	if (m_integratedAfterSolve.size())
+	{
+		memset(&m_integratedAfterSolve[0], 0, m_integratedAfterSolve.size());
+	}
 	im->buildAndProcessIslands(getCollisionWorld()->getDispatcher(), getCollisionWorld(), m_constraints, solverParams);
 
 	m_constraintSolver->allSolved(solverInfo, m_debugDrawer);
 }
 
+void btDiscreteDynamicsWorldMt::IntegrateSolvedIsland::processIsland(btSimulationIslandManagerMt::Island& island) const
+{
+	for (int i = 0; i < island.bodyArray.size(); ++i)
+	{
+		if (btRigidBody* body = btRigidBody::upcast(island.bodyArray[i]))
+		{
+			if (world->isDeterministic() && world->needsMotionClamping(body, timeStep))
+			{
+				// other islands may still be moving, integrateTransforms picks it up
+				continue;
+			}
+			world->integrateTransformsInternal(&body, 1, timeStep);
+			world->m_integratedAfterSolve[body->getWorldArrayIndex()] = 1;
+		}
+	}
+}
+
 struct UpdaterUnconstrainedMotion : public btIParallelForBody
 {
 	btScalar timeStep;
@@ -228,15 +272,88 @@ void btDiscreteDynamicsWorldMt::createPredictiveContacts(btScalar timeStep)
 	releasePredictiveContacts();
 	if (m_nonStaticRigidBodies.size() > 0)
 	{
+		const int firstManifold = m_dispatcher1->getNumManifolds();
 		UpdaterCreatePredictiveContacts update;
 		update.world = this;
 		update.timeStep = timeStep;
 		update.rigidBodies = &m_nonStaticRigidBodies[0];
 		int grainSize = 50;  // num of iterations per task for task scheduler
 		btParallelFor(0, m_nonStaticRigidBodies.size(), grainSize, update);
+		if (isDeterministic())
+		{
+			sortPredictiveContacts(firstManifold);
+		}
 	}
 }
 
+struct btPredictiveManifoldSortPredicate
+{
+	bool operator()(const btPersistentManifold* lhs, const btPersistentManifold* rhs) const
+	{
+		// body0 is the swept body, which makes at most one predictive manifold
+		return lhs->getBody0()->getBroadphaseHandle()->m_uniqueId < rhs->getBody0()->getBroadphaseHandle()->m_uniqueId;
+	}
+};
+
+void btDiscreteDynamicsWorldMt::sortPredictiveContacts(int firstManifold)
+{
+	// the threads appended their predictive manifolds in the order they got the mutex
+	btAssert(m_dispatcher1->getNumManifolds() - firstManifold == m_predictiveManifolds.size());
+	m_predictiveManifolds.quickSort(btPredictiveManifoldSortPredicate());
+	btPersistentManifold** manifolds = m_dispatcher1->getInternalManifoldPointer();
+	for (int i = 0; i < m_predictiveManifolds.size(); ++i)
+	{
+		btPersistentManifold* manifold = m_predictiveManifolds[i];
+		manifold->m_index1a = firstManifold + i;
+		manifolds[firstManifold + i] = manifold;
+	}
+}
+
+void btDiscreteDynamicsWorldMt::setDeterministic(bool deterministic)
+{
+	getDispatchInfo().m_deterministicOverlappingPairs = deterministic;
+	if (deterministic)
+	{
+		getSolverInfo().m_solverMode |= SOLVER_DETERMINISTIC;
+	}
+	else
+	{
+		getSolverInfo().m_solverMode &= ~SOLVER_DETERMINISTIC;
+	}
+}
+
+void btDiscreteDynamicsWorldMt::UpdaterIntegrateTransforms::forLoop(int iBegin, int iEnd) const
+{
+	char* integrated = &world->m_integratedAfterSolve[0];
+	for (int i = iBegin; i < iEnd; ++i)
+	{
+		btRigidBody* body = rigidBodies[i];
+		if (!integrated[body->getWorldArrayIndex()])
+		{
+			if (deferMotionClamping && world->needsMotionClamping(body, timeStep))
+			{
+				continue;
+			}
+			world->integrateTransformsInternal(&body, 1, timeStep);
+			integrated[body->getWorldArrayIndex()] = 1;
+		}
+	}
+}
+
+bool btDiscreteDynamicsWorldMt::needsMotionClamping(btRigidBody* body, btScalar timeStep)
+{
+	// same test as integrateTransformsInternal
+	if (!getDispatchInfo().m_useContinuous || !body->getCcdSquareMotionThreshold() || !body->isActive() ||
+		body->isStaticOrKinematicObject() || !body->getCollisionShape()->isConvex())
+	{
+		return false;
+	}
+	btTransform predictedTrans;
+	body->predictIntegratedTransform(timeStep, predictedTrans);
+	btScalar squareMotion = (predictedTrans.getOrigin() - body->getWorldTransform().getOrigin()).length2();
+	return body->getCcdSquareMotionThreshold() < squareMotion;
+}
+
 void btDiscreteDynamicsWorldMt::integrateTransforms(btScalar timeStep)
 {
 	BT_PROFILE("integrateTransforms");
@@ -246,14 +363,29 @@ void btDiscreteDynamicsWorldMt::integrateTransforms(btScalar timeStep)
 		update.world = this;
 		update.timeStep = timeStep;
 		update.rigidBodies = &m_nonStaticRigidBodies[0];
+		update.deferMotionClamping = isDeterministic();
 		int grainSize = 50;  // num of iterations per task for task scheduler
 		btParallelFor(0, m_nonStaticRigidBodies.size(), grainSize, update);
+		if (update.deferMotionClamping)
+		{
+			// the clamped bodies sweep through a world that no longer moves under them
+			for (int i = 0; i < m_nonStaticRigidBodies.size(); ++i)
+			{
+				btRigidBody* body = m_nonStaticRigidBodies[i];
+				if (!m_integratedAfterSolve[body->getWorldArrayIndex()])
+				{
+					integrateTransformsInternal(&body, 1, timeStep);
+				}
+			}
+		}
 	}
 }
 
 int btDiscreteDynamicsWorldMt::stepSimulation(btScalar timeStep, int maxSubSteps, btScalar fixedTimeStep)
 {
 	int numSubSteps = btDiscreteDynamicsWorld::stepSimulation(timeStep, maxSubSteps, fixedTimeStep);
+	// everything allocated from the arenas of the threads during the step is released by now
+	btResetThreadArenas();
 	if (btITaskScheduler* scheduler = btGetTaskScheduler())
 	{
 		// tell Bullet's threads to sleep, so other threads can run
@@ -78,13 +78,35 @@ private:
 ///     - predictUnconstraintMotion
 ///     - integrateTransforms
 ///     - createPredictiveContacts
+///  With btSimulationIslandManagerMt::taskGraphIslandDispatch, islands are integrated as soon as they are solved
+///  and integrateTransforms only picks up the bodies that were left over.
+///
+///  The island manager is a btSimulationIslandManagerMt, with its setParallelIslands(true) the islands are built
+///  on several threads too.
+///  With setDeterministic(true) a step gives bit for bit the same result for any number of threads: manifolds made
+///  on different threads are ordered by the unique ids of their bodies, and the solver sums its residual in a fixed
+///  order. Bodies whose motion is clamped by continuous collision detection are integrated one after another once
+///  all other bodies have moved. This costs a sort of the new manifolds and an extra pass over each solver phase.
+///  SOLVER_RANDMIZE_ORDER still depends on which solver of the pool an island lands on, so leave it off when
+///  determinism matters.
 ///
 ATTRIBUTE_ALIGNED16(class)
 btDiscreteDynamicsWorldMt : public btDiscreteDynamicsWorld
 {
 protected:
 	btConstraintSolver* m_constraintSolverMt;
+	btAlignedObjectArray<char> m_integratedAfterSolve;  // per collision object, set for bodies that were integrated as soon as their island was solved
+
+	// passed to the island dispatch, which may integrate an island while others are still solving
+	struct IntegrateSolvedIsland : public btSimulationIslandManagerMt::IslandCallback
+	{
+		btScalar timeStep;
+		btDiscreteDynamicsWorldMt* world;
+
+		void processIsland(btSimulationIslandManagerMt::Island & island) const BT_OVERRIDE;
+	};
 
+	virtual void calculateSimulationIslands() BT_OVERRIDE;
 	virtual void solveConstraints(btContactSolverInfo & solverInfo) BT_OVERRIDE;
 
 	virtual void predictUnconstraintMotion(btScalar timeStep) BT_OVERRIDE;
@@ -101,19 +123,20 @@ protected:
 		}
 	};
 	virtual void createPredictiveContacts(btScalar timeStep) BT_OVERRIDE;
+	void sortPredictiveContacts(int firstManifold);
 
 	struct UpdaterIntegrateTransforms : public btIParallelForBody
 	{
 		btScalar timeStep;
 		btRigidBody** rigidBodies;
 		btDiscreteDynamicsWorldMt* world;
+		bool deferMotionClamping;
 
-		void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
-		{
-			world->integrateTransformsInternal(&rigidBodies[iBegin], iEnd - iBegin, timeStep);
-		}
+		void forLoop(int iBegin, int iEnd) const BT_OVERRIDE;  // skips bodies already integrated after their island was solved
 	};
 	virtual void integrateTransforms(btScalar timeStep) BT_OVERRIDE;
+	// true when integrating the body sweeps it through the world, which reads the transforms of other bodies
+	bool needsMotionClamping(btRigidBody * body, btScalar timeStep);
 
 public:
 	BT_DECLARE_ALIGNED_ALLOCATOR();
@@ -126,6 +149,13 @@ public:
 	virtual ~btDiscreteDynamicsWorldMt();
 
 	virtual int stepSimulation(btScalar timeStep, int maxSubSteps, btScalar fixedTimeStep) BT_OVERRIDE;
+
+	///sets btDispatcherInfo::m_deterministicOverlappingPairs and SOLVER_DETERMINISTIC, off by default
+	void setDeterministic(bool deterministic);
+	bool isDeterministic() const
+	{
+		return getDispatchInfo().m_deterministicOverlappingPairs;
+	}
 };
 
 #endif  //BT_DISCRETE_DYNAMICS_WORLD_H
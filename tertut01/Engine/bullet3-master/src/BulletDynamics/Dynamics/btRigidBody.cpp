@@ -107,6 +107,7 @@ void btRigidBody::saveKinematicState(btScalar timeStep)
 	//todo: clamp to some (user definable) safe minimum timestep, to limit maximum angular/linear velocities
 	if (timeStep != btScalar(0.))
 	{
+		m_updateRevision++;
 		//if we use motionstate to synchronize world transforms, get the new kinematic/animated world transform
 		if (getMotionState())
 			getMotionState()->getWorldTransform(m_worldTransform);
@@ -398,6 +399,7 @@ btQuaternion btRigidBody::getOrientation() const
 
 void btRigidBody::setCenterOfMassTransform(const btTransform& xform)
 {
+	m_updateRevision++;
 	if (isKinematicObject())
 	{
 		m_interpolationWorldTransform = m_worldTransform;
@@ -318,6 +318,7 @@ public:
 
 	void applyCentralImpulse(const btVector3& impulse)
 	{
+		m_updateRevision++;
 		m_linearVelocity += impulse * m_linearFactor * m_inverseMass;
 		#if defined(BT_CLAMP_VELOCITY_TO) && BT_CLAMP_VELOCITY_TO > 0
 		clampVelocity(m_linearVelocity);
@@ -326,6 +327,7 @@ public:
 
 	void applyTorqueImpulse(const btVector3& torque)
 	{
+		m_updateRevision++;
 		m_angularVelocity += m_invInertiaTensorWorld * torque * m_angularFactor;
 		#if defined(BT_CLAMP_VELOCITY_TO) && BT_CLAMP_VELOCITY_TO > 0
 		clampVelocity(m_angularVelocity);
@@ -474,6 +476,7 @@ public:
 
 	void translate(const btVector3& v)
 	{
+		m_updateRevision++;
 		m_worldTransform.getOrigin() += v;
 	}
 
@@ -558,7 +561,10 @@ public:
 	{
 		m_optionalMotionState = motionState;
 		if (m_optionalMotionState)
+		{
+			m_updateRevision++;
 			motionState->getWorldTransform(m_worldTransform);
+		}
 	}
 
 	//for experimental overriding of friction/contact solver func
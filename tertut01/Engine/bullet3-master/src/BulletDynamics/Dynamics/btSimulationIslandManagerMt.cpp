@@ -15,6 +15,7 @@ subject to the following restrictions:
 
 #include "LinearMath/btScalar.h"
 #include "LinearMath/btThreads.h"
+#include "LinearMath/btTaskGraph.h"
 #include "btSimulationIslandManagerMt.h"
 #include "BulletCollision/BroadphaseCollision/btDispatcher.h"
 #include "BulletCollision/NarrowPhaseCollision/btPersistentManifold.h"
@@ -25,6 +26,7 @@ subject to the following restrictions:
 
 //#include <stdio.h>
 #include "LinearMath/btQuickprof.h"
+#include <string.h>  // for memset
 
 SIMD_FORCE_INLINE int calcBatchCost(int bodies, int manifolds, int constraints)
 {
@@ -44,6 +46,7 @@ btSimulationIslandManagerMt::btSimulationIslandManagerMt()
 	m_batchIslandMinBodyCount = 32;
 	m_islandDispatch = parallelIslandDispatch;
 	m_batchIsland = NULL;
+	m_parallelIslands = false;
 }
 
 btSimulationIslandManagerMt::~btSimulationIslandManagerMt()
@@ -264,6 +267,11 @@ btSimulationIslandManagerMt::Island* btSimulationIslandManagerMt::allocateIsland
 void btSimulationIslandManagerMt::buildIslands(btDispatcher* dispatcher, btCollisionWorld* collisionWorld)
 {
 	BT_PROFILE("buildIslands");
+	if (m_parallelIslands)
+	{
+		buildIslandsParallel(collisionWorld);
+		return;
+	}
 
 	btCollisionObjectArray& collisionObjects = collisionWorld->getCollisionObjectArray();
 
@@ -464,6 +472,691 @@ void btSimulationIslandManagerMt::addConstraintsToIslands(btAlignedObjectArray<b
 	}
 }
 
+struct UnitePairsLoop : public btIParallelForBody
+{
+	btUnionFind* m_unionFind;
+	const btBroadphasePair* m_pairs;
+
+	void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
+	{
+		for (int i = iBegin; i < iEnd; ++i)
+		{
+			const btCollisionObject* colObj0 = (const btCollisionObject*)m_pairs[i].m_pProxy0->m_clientObject;
+			const btCollisionObject* colObj1 = (const btCollisionObject*)m_pairs[i].m_pProxy1->m_clientObject;
+			if (colObj0 && colObj0->mergesSimulationIslands() && colObj1 && colObj1->mergesSimulationIslands())
+			{
+				m_unionFind->uniteConcurrent(colObj0->getIslandTag(), colObj1->getIslandTag());
+			}
+		}
+	}
+};
+
+struct UniteManifoldsLoop : public btIParallelForBody
+{
+	btUnionFind* m_unionFind;
+	btPersistentManifold** m_manifolds;
+	bool m_concurrent;
+
+	void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
+	{
+		for (int i = iBegin; i < iEnd; ++i)
+		{
+			const btCollisionObject* colObj0 = m_manifolds[i]->getBody0();
+			const btCollisionObject* colObj1 = m_manifolds[i]->getBody1();
+			if (colObj0 && !colObj0->isStaticOrKinematicObject() && colObj1 && !colObj1->isStaticOrKinematicObject())
+			{
+				if (m_concurrent)
+					m_unionFind->uniteConcurrent(colObj0->getIslandTag(), colObj1->getIslandTag());
+				else
+					m_unionFind->unite(colObj0->getIslandTag(), colObj1->getIslandTag());
+			}
+		}
+	}
+};
+
+struct UniteConstraintsLoop : public btIParallelForBody
+{
+	btUnionFind* m_unionFind;
+	btTypedConstraint** m_constraints;
+	bool m_concurrent;
+
+	void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
+	{
+		for (int i = iBegin; i < iEnd; ++i)
+		{
+			const btTypedConstraint* constraint = m_constraints[i];
+			const btRigidBody& colObj0 = constraint->getRigidBodyA();
+			const btRigidBody& colObj1 = constraint->getRigidBodyB();
+			if (constraint->isEnabled() && !colObj0.isStaticOrKinematicObject() && !colObj1.isStaticOrKinematicObject())
+			{
+				if (m_concurrent)
+					m_unionFind->uniteConcurrent(colObj0.getIslandTag(), colObj1.getIslandTag());
+				else
+					m_unionFind->unite(colObj0.getIslandTag(), colObj1.getIslandTag());
+			}
+		}
+	}
+};
+
+struct StoreIslandTagsLoop : public btIParallelForBody
+{
+	btUnionFind* m_unionFind;
+	btCollisionObject** m_collisionObjects;
+
+	void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
+	{
+		for (int i = iBegin; i < iEnd; ++i)
+		{
+			btCollisionObject* collisionObject = m_collisionObjects[i];
+			if (!collisionObject->isStaticOrKinematicObject())
+			{
+				// the tag is still the union-find index from updateActivationState
+				int index = collisionObject->getIslandTag();
+				collisionObject->setIslandTag(m_unionFind->findConcurrent(index));
+				m_unionFind->getElement(index).m_sz = i;
+				collisionObject->setCompanionId(-1);
+			}
+			else
+			{
+				collisionObject->setIslandTag(-1);
+				collisionObject->setCompanionId(-2);
+			}
+		}
+	}
+};
+
+void btSimulationIslandManagerMt::updateActivationState(btCollisionWorld* colWorld, btDispatcher* dispatcher)
+{
+#ifdef STATIC_SIMULATION_ISLAND_OPTIMIZATION
+	if (m_parallelIslands)
+	{
+		BT_PROFILE("updateActivationStateParallel");
+		btCollisionObjectArray& collisionObjects = colWorld->getCollisionObjectArray();
+		int index = 0;
+		for (int i = 0; i < collisionObjects.size(); i++)
+		{
+			btCollisionObject* collisionObject = collisionObjects[i];
+			if (!collisionObject->isStaticOrKinematicObject())
+			{
+				collisionObject->setIslandTag(index++);
+			}
+			collisionObject->setCompanionId(-1);
+			collisionObject->setHitFraction(btScalar(1.));
+		}
+		initUnionFind(index);
+
+		btOverlappingPairCache* pairCache = colWorld->getPairCache();
+		if (int numPairs = pairCache->getNumOverlappingPairs())
+		{
+			UnitePairsLoop loop;
+			loop.m_unionFind = &getUnionFind();
+			loop.m_pairs = pairCache->getOverlappingPairArrayPtr();
+			btParallelFor(0, numPairs, 256, loop);
+		}
+		return;
+	}
+#endif  //STATIC_SIMULATION_ISLAND_OPTIMIZATION
+	btSimulationIslandManager::updateActivationState(colWorld, dispatcher);
+}
+
+void btSimulationIslandManagerMt::findConstraintUnions(btPersistentManifold** manifolds, int numManifolds, btTypedConstraint** constraints, int numConstraints)
+{
+	// the serial version unites in array order, exactly like btDiscreteDynamicsWorld::calculateSimulationIslands
+	UniteManifoldsLoop manifoldLoop;
+	manifoldLoop.m_unionFind = &getUnionFind();
+	manifoldLoop.m_manifolds = manifolds;
+	manifoldLoop.m_concurrent = m_parallelIslands;
+	UniteConstraintsLoop constraintLoop;
+	constraintLoop.m_unionFind = &getUnionFind();
+	constraintLoop.m_constraints = constraints;
+	constraintLoop.m_concurrent = m_parallelIslands;
+	if (m_parallelIslands)
+	{
+		btParallelFor(0, numManifolds, 256, manifoldLoop);
+		btParallelFor(0, numConstraints, 256, constraintLoop);
+	}
+	else
+	{
+		manifoldLoop.forLoop(0, numManifolds);
+		constraintLoop.forLoop(0, numConstraints);
+	}
+}
+
+void btSimulationIslandManagerMt::storeIslandActivationState(btCollisionWorld* world)
+{
+#ifdef STATIC_SIMULATION_ISLAND_OPTIMIZATION
+	if (m_parallelIslands)
+	{
+		BT_PROFILE("storeIslandActivationStateParallel");
+		btCollisionObjectArray& collisionObjects = world->getCollisionObjectArray();
+		if (collisionObjects.size())
+		{
+			StoreIslandTagsLoop loop;
+			loop.m_unionFind = &getUnionFind();
+			loop.m_collisionObjects = &collisionObjects[0];
+			btParallelFor(0, collisionObjects.size(), 256, loop);
+		}
+		return;
+	}
+#endif  //STATIC_SIMULATION_ISLAND_OPTIMIZATION
+	btSimulationIslandManager::storeIslandActivationState(world);
+}
+
+// sorts the items of one island, which the scatter of IslandGrouping::build leaves nearly in order
+static void btSortIslandItems(int* items, int n)
+{
+	while (n > 16)
+	{
+		const int pivot = items[n / 2];
+		int i = 0;
+		int j = n - 1;
+		while (i <= j)
+		{
+			while (items[i] < pivot)
+				i++;
+			while (items[j] > pivot)
+				j--;
+			if (i <= j)
+			{
+				btSwap(items[i], items[j]);
+				i++;
+				j--;
+			}
+		}
+		// recurse into the smaller part and go on with the larger one
+		if (j + 1 < n - i)
+		{
+			btSortIslandItems(items, j + 1);
+			items += i;
+			n -= i;
+		}
+		else
+		{
+			btSortIslandItems(items + i, n - i);
+			n = j + 1;
+		}
+	}
+	for (int i = 1; i < n; ++i)
+	{
+		const int item = items[i];
+		int j = i;
+		for (; j > 0 && items[j - 1] > item; --j)
+		{
+			items[j] = items[j - 1];
+		}
+		items[j] = item;
+	}
+}
+
+struct ClearCountsLoop : public btIParallelForBody
+{
+	int* m_counts;
+
+	void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
+	{
+		memset(m_counts + iBegin, 0, (iEnd - iBegin) * sizeof(int));
+	}
+};
+
+struct CountIslandItemsLoop : public btIParallelForBody
+{
+	const int* m_itemIslandIds;
+	int* m_counts;
+
+	void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
+	{
+		for (int i = iBegin; i < iEnd; ++i)
+		{
+			if (m_itemIslandIds[i] >= 0)
+			{
+				btAtomicFetchAdd(&m_counts[m_itemIslandIds[i]], 1);
+			}
+		}
+	}
+};
+
+// inclusive prefix sum of each block, the offsets of the blocks before it are added by AddBlockOffsetsLoop
+struct ScanBlocksLoop : public btIParallelForBody
+{
+	int* m_values;
+	int* m_blockSums;
+	int m_numValues;
+	int m_blockSize;
+
+	void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
+	{
+		for (int b = iBegin; b < iEnd; ++b)
+		{
+			int* values = m_values + b * m_blockSize;
+			const int n = btMin(m_blockSize, m_numValues - b * m_blockSize);
+			for (int i = 1; i < n; ++i)
+			{
+				values[i] += values[i - 1];
+			}
+			m_blockSums[b] = values[n - 1];
+		}
+	}
+};
+
+struct AddBlockOffsetsLoop : public btIParallelForBody
+{
+	int* m_values;
+	const int* m_blockOffsets;
+	int m_numValues;
+	int m_blockSize;
+
+	void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
+	{
+		for (int b = iBegin; b < iEnd; ++b)
+		{
+			int* values = m_values + b * m_blockSize;
+			const int n = btMin(m_blockSize, m_numValues - b * m_blockSize);
+			const int offset = m_blockOffsets[b];
+			for (int i = 0; i < n; ++i)
+			{
+				values[i] += offset;
+			}
+		}
+	}
+};
+
+struct ScatterIslandItemsLoop : public btIParallelForBody
+{
+	const int* m_itemIslandIds;
+	int* m_groupEnd;
+	int* m_items;
+
+	void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
+	{
+		for (int i = iBegin; i < iEnd; ++i)
+		{
+			if (m_itemIslandIds[i] >= 0)
+			{
+				// counts the end of the group down to its start
+				m_items[btAtomicFetchAdd(&m_groupEnd[m_itemIslandIds[i]], -1) - 1] = i;
+			}
+		}
+	}
+};
+
+struct SortIslandItemsLoop : public btIParallelForBody
+{
+	const int* m_groupStart;
+	int* m_items;
+
+	void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
+	{
+		for (int id = iBegin; id < iEnd; ++id)
+		{
+			const int n = m_groupStart[id + 1] - m_groupStart[id];
+			if (n > 1)
+			{
+				btSortIslandItems(m_items + m_groupStart[id], n);
+			}
+		}
+	}
+};
+
+void btSimulationIslandManagerMt::IslandGrouping::build(const btAlignedObjectArray<int>& itemIslandIds, int numIslandIds)
+{
+	// counting sort: count the items of each island, prefix sum, scatter, then sort each island so the
+	// order of the items does not depend on which thread got to them first
+	const int grainSize = 1024;
+	const int numItems = itemIslandIds.size();
+	groupStart.resizeNoInitialize(numIslandIds + 1);
+	groupStart[numIslandIds] = 0;
+	if (numIslandIds == 0)
+	{
+		items.resize(0);
+		return;
+	}
+	int* counts = &groupStart[0];
+	const int* ids = numItems ? &itemIslandIds[0] : NULL;
+	{
+		ClearCountsLoop loop;
+		loop.m_counts = counts;
+		btParallelFor(0, numIslandIds, grainSize, loop);
+	}
+	{
+		CountIslandItemsLoop loop;
+		loop.m_itemIslandIds = ids;
+		loop.m_counts = counts;
+		btParallelFor(0, numItems, grainSize, loop);
+	}
+	{
+		const int blockSize = 4096;
+		const int numBlocks = (numIslandIds + blockSize - 1) / blockSize;
+		btAlignedObjectArray<int> blockSums;
+		blockSums.resizeNoInitialize(numBlocks);
+		ScanBlocksLoop scanLoop;
+		scanLoop.m_values = counts;
+		scanLoop.m_blockSums = &blockSums[0];
+		scanLoop.m_numValues = numIslandIds;
+		scanLoop.m_blockSize = blockSize;
+		btParallelFor(0, numBlocks, 1, scanLoop);
+		int sum = 0;
+		for (int b = 0; b < numBlocks; ++b)
+		{
+			const int blockSum = blockSums[b];
+			blockSums[b] = sum;
+			sum += blockSum;
+		}
+		AddBlockOffsetsLoop offsetLoop;
+		offsetLoop.m_values = counts;
+		offsetLoop.m_blockOffsets = &blockSums[0];
+		offsetLoop.m_numValues = numIslandIds;
+		offsetLoop.m_blockSize = blockSize;
+		btParallelFor(1, numBlocks, 1, offsetLoop);
+		groupStart[numIslandIds] = sum;
+	}
+	items.resizeNoInitialize(groupStart[numIslandIds]);
+	if (items.size() == 0)
+	{
+		return;
+	}
+	{
+		ScatterIslandItemsLoop loop;
+		loop.m_itemIslandIds = ids;
+		loop.m_groupEnd = counts;
+		loop.m_items = &items[0];
+		btParallelFor(0, numItems, grainSize, loop);
+	}
+	{
+		SortIslandItemsLoop loop;
+		loop.m_groupStart = &groupStart[0];
+		loop.m_items = &items[0];
+		btParallelFor(0, numIslandIds, grainSize, loop);
+	}
+}
+
+struct ElementIslandIdsLoop : public btIParallelForBody
+{
+	const btUnionFind* m_unionFind;
+	btCollisionObject** m_collisionObjects;
+	int* m_islandIds;
+
+	void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
+	{
+		for (int i = iBegin; i < iEnd; ++i)
+		{
+			m_islandIds[i] = m_collisionObjects[m_unionFind->getElement(i).m_sz]->getIslandTag();
+		}
+	}
+};
+
+struct UpdateIslandSleepingLoop : public btIParallelForBody
+{
+	const btUnionFind* m_unionFind;
+	btCollisionObject** m_collisionObjects;
+	const int* m_groupStart;
+	const int* m_elements;
+	char* m_islandIsAwake;
+
+	void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
+	{
+		for (int islandId = iBegin; islandId < iEnd; ++islandId)
+		{
+			const int startIndex = m_groupStart[islandId];
+			const int endIndex = m_groupStart[islandId + 1];
+			// same rules as the serial buildIslands, each island only touches its own bodies
+			bool allSleeping = true;
+			for (int idx = startIndex; idx < endIndex; idx++)
+			{
+				const btCollisionObject* colObj0 = m_collisionObjects[m_unionFind->getElement(m_elements[idx]).m_sz];
+				if (colObj0->getActivationState() == ACTIVE_TAG ||
+					colObj0->getActivationState() == DISABLE_DEACTIVATION)
+				{
+					allSleeping = false;
+					break;
+				}
+			}
+			bool isAwake = false;
+			for (int idx = startIndex; idx < endIndex; idx++)
+			{
+				btCollisionObject* colObj0 = m_collisionObjects[m_unionFind->getElement(m_elements[idx]).m_sz];
+				if (allSleeping)
+				{
+					colObj0->setActivationState(ISLAND_SLEEPING);
+				}
+				else if (colObj0->getActivationState() == ISLAND_SLEEPING)
+				{
+					colObj0->setActivationState(WANTS_DEACTIVATION);
+					colObj0->setDeactivationTime(0.f);
+				}
+				isAwake = isAwake || colObj0->isActive();
+			}
+			m_islandIsAwake[islandId] = isAwake;
+		}
+	}
+};
+
+void btSimulationIslandManagerMt::buildIslandsParallel(btCollisionWorld* collisionWorld)
+{
+	btCollisionObjectArray& collisionObjects = collisionWorld->getCollisionObjectArray();
+	const int numElem = getUnionFind().getNumElements();
+	m_islandIsAwake.resizeNoInitialize(numElem);
+	if (numElem == 0)
+	{
+		return;
+	}
+	// the island id of every union-find element, storeIslandActivationState put the collision object index in m_sz
+	m_itemIslandIds.resizeNoInitialize(numElem);
+	{
+		ElementIslandIdsLoop loop;
+		loop.m_unionFind = &getUnionFind();
+		loop.m_collisionObjects = &collisionObjects[0];
+		loop.m_islandIds = &m_itemIslandIds[0];
+		btParallelFor(0, numElem, 1024, loop);
+	}
+	m_bodyGrouping.build(m_itemIslandIds, numElem);
+	{
+		UpdateIslandSleepingLoop loop;
+		loop.m_unionFind = &getUnionFind();
+		loop.m_collisionObjects = &collisionObjects[0];
+		loop.m_groupStart = &m_bodyGrouping.groupStart[0];
+		loop.m_elements = &m_bodyGrouping.items[0];
+		loop.m_islandIsAwake = &m_islandIsAwake[0];
+		btParallelFor(0, numElem, 256, loop);
+	}
+}
+
+struct ManifoldIslandIdsLoop : public btIParallelForBody
+{
+	btPersistentManifold** m_manifolds;
+	btDispatcher* m_dispatcher;
+	btSimulationIslandManagerMt::Island* const* m_lookupIslandFromId;
+	int* m_islandIds;
+	char* m_wakeUp;
+
+	void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
+	{
+		for (int i = iBegin; i < iEnd; ++i)
+		{
+			const btPersistentManifold* manifold = m_manifolds[i];
+			const btCollisionObject* colObj0 = static_cast<const btCollisionObject*>(manifold->getBody0());
+			const btCollisionObject* colObj1 = static_cast<const btCollisionObject*>(manifold->getBody1());
+			int islandId = -1;
+			char wakeUp = 0;
+			if (((colObj0) && colObj0->getActivationState() != ISLAND_SLEEPING) ||
+				((colObj1) && colObj1->getActivationState() != ISLAND_SLEEPING))
+			{
+				// bodies touched by kinematic objects are woken up after the loop, several manifolds may wake the same body
+				if (colObj0->isKinematicObject() && colObj0->getActivationState() != ISLAND_SLEEPING && colObj0->hasContactResponse())
+				{
+					wakeUp |= 2;
+				}
+				if (colObj1->isKinematicObject() && colObj1->getActivationState() != ISLAND_SLEEPING && colObj1->hasContactResponse())
+				{
+					wakeUp |= 1;
+				}
+				if (m_dispatcher->needsResponse(colObj0, colObj1))
+				{
+					int id = getIslandId(manifold);
+					// only awake islands were allocated
+					if (id >= 0 && m_lookupIslandFromId[id])
+					{
+						islandId = id;
+					}
+				}
+			}
+			m_islandIds[i] = islandId;
+			m_wakeUp[i] = wakeUp;
+		}
+	}
+};
+
+struct ConstraintIslandIdsLoop : public btIParallelForBody
+{
+	btTypedConstraint** m_constraints;
+	btSimulationIslandManagerMt::Island* const* m_lookupIslandFromId;
+	int* m_islandIds;
+
+	void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
+	{
+		for (int i = iBegin; i < iEnd; ++i)
+		{
+			int islandId = -1;
+			if (m_constraints[i]->isEnabled())
+			{
+				int id = btGetConstraintIslandId1(m_constraints[i]);
+				if (id >= 0 && m_lookupIslandFromId[id])
+				{
+					islandId = id;
+				}
+			}
+			m_islandIds[i] = islandId;
+		}
+	}
+};
+
+struct FillIslandsLoop : public btIParallelForBody
+{
+	const btSimulationIslandManagerMt::IslandTarget* m_targets;
+	const btUnionFind* m_unionFind;
+	btCollisionObject** m_collisionObjects;
+	btPersistentManifold** m_manifolds;
+	btTypedConstraint** m_constraints;
+	const btSimulationIslandManagerMt::IslandGrouping* m_bodyGrouping;
+	const btSimulationIslandManagerMt::IslandGrouping* m_manifoldGrouping;
+	const btSimulationIslandManagerMt::IslandGrouping* m_constraintGrouping;
+
+	void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
+	{
+		for (int i = iBegin; i < iEnd; ++i)
+		{
+			// the arrays were sized up front, islands that share an Island write to their own ranges
+			const btSimulationIslandManagerMt::IslandTarget& target = m_targets[i];
+			btSimulationIslandManagerMt::Island* island = target.island;
+			int start = m_bodyGrouping->groupStart[target.id];
+			int n = m_bodyGrouping->getGroupSize(target.id);
+			for (int k = 0; k < n; ++k)
+			{
+				island->bodyArray[target.bodyOffset + k] = m_collisionObjects[m_unionFind->getElement(m_bodyGrouping->items[start + k]).m_sz];
+			}
+			start = m_manifoldGrouping->groupStart[target.id];
+			n = m_manifoldGrouping->getGroupSize(target.id);
+			for (int k = 0; k < n; ++k)
+			{
+				island->manifoldArray[target.manifoldOffset + k] = m_manifolds[m_manifoldGrouping->items[start + k]];
+			}
+			start = m_constraintGrouping->groupStart[target.id];
+			n = m_constraintGrouping->getGroupSize(target.id);
+			for (int k = 0; k < n; ++k)
+			{
+				island->constraintArray[target.constraintOffset + k] = m_constraints[m_constraintGrouping->items[start + k]];
+			}
+		}
+	}
+};
+
+void btSimulationIslandManagerMt::addToIslandsParallel(btDispatcher* dispatcher, btCollisionWorld* collisionWorld, btAlignedObjectArray<btTypedConstraint*>& constraints)
+{
+	BT_PROFILE("addToIslandsParallel");
+	btCollisionObjectArray& collisionObjects = collisionWorld->getCollisionObjectArray();
+	const int numElem = getUnionFind().getNumElements();
+
+	// allocate the awake islands in island id order, only the bookkeeping is serial
+	m_islandTargets.resize(0);
+	for (int id = 0; id < numElem; ++id)
+	{
+		if (m_islandIsAwake[id])
+		{
+			int numBodies = m_bodyGrouping.getGroupSize(id);
+			IslandTarget target;
+			target.id = id;
+			target.island = allocateIsland(id, numBodies);
+			target.island->isSleeping = false;
+			target.bodyOffset = target.island->bodyArray.size();
+			target.manifoldOffset = 0;
+			target.constraintOffset = 0;
+			target.island->bodyArray.resizeNoInitialize(target.bodyOffset + numBodies);
+			m_islandTargets.push_back(target);
+		}
+	}
+
+	const int numManifolds = dispatcher->getNumManifolds();
+	btPersistentManifold** manifolds = numManifolds ? dispatcher->getInternalManifoldPointer() : NULL;
+	m_itemIslandIds.resizeNoInitialize(numManifolds);
+	m_manifoldWakeUp.resizeNoInitialize(numManifolds);
+	if (numManifolds)
+	{
+		ManifoldIslandIdsLoop loop;
+		loop.m_manifolds = manifolds;
+		loop.m_dispatcher = dispatcher;
+		loop.m_lookupIslandFromId = numElem ? &m_lookupIslandFromId[0] : NULL;
+		loop.m_islandIds = &m_itemIslandIds[0];
+		loop.m_wakeUp = &m_manifoldWakeUp[0];
+		btParallelFor(0, numManifolds, 256, loop);
+		for (int i = 0; i < numManifolds; ++i)
+		{
+			if (m_manifoldWakeUp[i])
+			{
+				btCollisionObject* colObj0 = (btCollisionObject*)manifolds[i]->getBody0();
+				btCollisionObject* colObj1 = (btCollisionObject*)manifolds[i]->getBody1();
+				if (m_manifoldWakeUp[i] & 1)
+					colObj0->activate();
+				if (m_manifoldWakeUp[i] & 2)
+					colObj1->activate();
+			}
+		}
+	}
+	m_manifoldGrouping.build(m_itemIslandIds, numElem);
+
+	m_itemIslandIds.resizeNoInitialize(constraints.size());
+	if (constraints.size())
+	{
+		ConstraintIslandIdsLoop loop;
+		loop.m_constraints = &constraints[0];
+		loop.m_lookupIslandFromId = numElem ? &m_lookupIslandFromId[0] : NULL;
+		loop.m_islandIds = &m_itemIslandIds[0];
+		btParallelFor(0, constraints.size(), 256, loop);
+	}
+	m_constraintGrouping.build(m_itemIslandIds, numElem);
+
+	for (int i = 0; i < m_islandTargets.size(); ++i)
+	{
+		IslandTarget& target = m_islandTargets[i];
+		Island* island = target.island;
+		target.manifoldOffset = island->manifoldArray.size();
+		island->manifoldArray.resizeNoInitialize(target.manifoldOffset + m_manifoldGrouping.getGroupSize(target.id));
+		target.constraintOffset = island->constraintArray.size();
+		island->constraintArray.resizeNoInitialize(target.constraintOffset + m_constraintGrouping.getGroupSize(target.id));
+	}
+	if (m_islandTargets.size())
+	{
+		FillIslandsLoop loop;
+		loop.m_targets = &m_islandTargets[0];
+		loop.m_unionFind = &getUnionFind();
+		loop.m_collisionObjects = &collisionObjects[0];
+		loop.m_manifolds = manifolds;
+		loop.m_constraints = constraints.size() ? &constraints[0] : NULL;
+		loop.m_bodyGrouping = &m_bodyGrouping;
+		loop.m_manifoldGrouping = &m_manifoldGrouping;
+		loop.m_constraintGrouping = &m_constraintGrouping;
+		btParallelFor(0, m_islandTargets.size(), 64, loop);
+	}
+}
+
 void btSimulationIslandManagerMt::mergeIslands()
 {
 	// sort islands in order of decreasing batch size
@@ -621,6 +1314,78 @@ void btSimulationIslandManagerMt::parallelIslandDispatch(btAlignedObjectArray<Is
 	btParallelFor(iBegin, islandsPtr->size(), 1, dispatcher);
 }
 
+struct SolveIslandTask : public btITaskBody
+{
+	btAlignedObjectArray<btSimulationIslandManagerMt::Island*>& m_islandsPtr;
+	const btSimulationIslandManagerMt::SolverParams& m_solverParams;
+
+	SolveIslandTask(btAlignedObjectArray<btSimulationIslandManagerMt::Island*>& islandsPtr, const btSimulationIslandManagerMt::SolverParams& solverParams)
+		: m_islandsPtr(islandsPtr), m_solverParams(solverParams)
+	{
+	}
+
+	void runTask(int iIsland) const BT_OVERRIDE
+	{
+		btSimulationIslandManagerMt::solveIsland(m_solverParams.m_solverPool, *m_islandsPtr[iIsland], m_solverParams);
+	}
+};
+
+struct IslandSolvedTask : public btITaskBody
+{
+	btAlignedObjectArray<btSimulationIslandManagerMt::Island*>& m_islandsPtr;
+	const btSimulationIslandManagerMt::IslandCallback* m_callback;
+
+	IslandSolvedTask(btAlignedObjectArray<btSimulationIslandManagerMt::Island*>& islandsPtr, const btSimulationIslandManagerMt::IslandCallback* callback)
+		: m_islandsPtr(islandsPtr), m_callback(callback)
+	{
+	}
+
+	void runTask(int iIsland) const BT_OVERRIDE
+	{
+		m_callback->processIsland(*m_islandsPtr[iIsland]);
+	}
+};
+
+void btSimulationIslandManagerMt::taskGraphIslandDispatch(btAlignedObjectArray<Island*>* islandsPtr, const SolverParams& solverParams)
+{
+	BT_PROFILE("taskGraphIslandDispatch");
+	btAlignedObjectArray<Island*>& islands = *islandsPtr;
+	const IslandCallback* callback = solverParams.m_islandSolvedCallback;
+	// large islands go serially to the parallel solver first, same as parallelIslandDispatch
+	int iBegin = 0;
+	if (solverParams.m_solverMt)
+	{
+		while (iBegin < islands.size())
+		{
+			Island* island = islands[iBegin];
+			if (island->manifoldArray.size() < btSequentialImpulseConstraintSolverMt::s_minimumContactManifoldsForBatching)
+			{
+				break;
+			}
+			solveIsland(solverParams.m_solverMt, *island, solverParams);
+			if (callback)
+			{
+				callback->processIsland(*island);
+			}
+			++iBegin;
+		}
+	}
+	// every remaining island is a solve task, followed by a continuation that picks up the island
+	// on the same thread as soon as it is solved
+	SolveIslandTask solveTask(islands, solverParams);
+	IslandSolvedTask solvedTask(islands, callback);
+	btTaskGraph graph;
+	for (int i = iBegin; i < islands.size(); ++i)
+	{
+		int task = graph.addTask(solveTask, i);
+		if (callback)
+		{
+			graph.addContinuation(solvedTask, i, &task, 1);
+		}
+	}
+	btRunTaskGraph(graph);
+}
+
 ///@todo: this is random access, it can be walked 'cache friendly'!
 void btSimulationIslandManagerMt::buildAndProcessIslands(btDispatcher* dispatcher,
 														 btCollisionWorld* collisionWorld,
@@ -678,9 +1443,16 @@ void btSimulationIslandManagerMt::buildAndProcessIslands(btDispatcher* dispatche
 		initIslandPools();
 
 		//traverse the simulation islands, and call the solver, unless all objects are sleeping/deactivated
-		addBodiesToIslands(collisionWorld);
-		addManifoldsToIslands(dispatcher);
-		addConstraintsToIslands(constraints);
+		if (m_parallelIslands)
+		{
+			addToIslandsParallel(dispatcher, collisionWorld, constraints);
+		}
+		else
+		{
+			addBodiesToIslands(collisionWorld);
+			addManifoldsToIslands(dispatcher);
+			addConstraintsToIslands(constraints);
+		}
 
 		// m_activeIslands array should now contain all non-sleeping Islands, and each Island should
 		// have all the necessary bodies, manifolds and constraints.
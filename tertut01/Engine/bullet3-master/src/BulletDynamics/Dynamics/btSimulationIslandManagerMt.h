@@ -32,6 +32,12 @@ class btIDebugDraw;
 ///                       of islands. If only a single island exists, then no parallelism is
 ///                       possible.
 ///
+///                       With setParallelIslands(true) the islands are also built on several threads: a concurrent
+///                       union-find is fed from the overlapping pairs, predictive manifolds and constraints in
+///                       parallel, and a parallel counting sort groups bodies, manifolds and constraints by island.
+///                       Each island id is the smallest union-find index of its bodies and the items of an island keep
+///                       their array order, so the islands come out the same for any number of threads.
+///
 class btSimulationIslandManagerMt : public btSimulationIslandManager
 {
 public:
@@ -47,6 +53,31 @@ public:
 
 		void append(const Island& other);  // add bodies, manifolds, constraints to my own
 	};
+	// used by the parallel island building: items sorted by island id,
+	// the items of island id are items[groupStart[id]] .. items[groupStart[id + 1] - 1]
+	struct IslandGrouping
+	{
+		btAlignedObjectArray<int> groupStart;
+		btAlignedObjectArray<int> items;
+
+		int getGroupSize(int id) const { return groupStart[id + 1] - groupStart[id]; }
+		void build(const btAlignedObjectArray<int>& itemIslandIds, int numIslandIds);
+	};
+	// an awake island whose bodies, manifolds and constraints go to a (possibly shared) Island
+	struct IslandTarget
+	{
+		int id;
+		Island* island;
+		int bodyOffset;
+		int manifoldOffset;
+		int constraintOffset;
+	};
+	// work to do on an island as soon as it is solved, while other islands may still be solving
+	struct IslandCallback
+	{
+		virtual ~IslandCallback() {}
+		virtual void processIsland(Island& island) const = 0;
+	};
 	struct SolverParams
 	{
 		btConstraintSolver* m_solverPool;
@@ -54,12 +85,26 @@ public:
 		btContactSolverInfo* m_solverInfo;
 		btIDebugDraw* m_debugDrawer;
 		btDispatcher* m_dispatcher;
+		const IslandCallback* m_islandSolvedCallback;  // optional, only dispatch functions that overlap solving with other work call it
+
+		SolverParams()
+		{
+			m_solverPool = NULL;
+			m_solverMt = NULL;
+			m_solverInfo = NULL;
+			m_debugDrawer = NULL;
+			m_dispatcher = NULL;
+			m_islandSolvedCallback = NULL;
+		}
 	};
 	static void solveIsland(btConstraintSolver* solver, Island& island, const SolverParams& solverParams);
 
 	typedef void (*IslandDispatchFunc)(btAlignedObjectArray<Island*>* islands, const SolverParams& solverParams);
 	static void serialIslandDispatch(btAlignedObjectArray<Island*>* islandsPtr, const SolverParams& solverParams);
 	static void parallelIslandDispatch(btAlignedObjectArray<Island*>* islandsPtr, const SolverParams& solverParams);
+	// like parallelIslandDispatch, but runs the solve of each island and then its m_islandSolvedCallback as a btTaskGraph,
+	// so islands that are done move on without waiting for the largest island to finish solving
+	static void taskGraphIslandDispatch(btAlignedObjectArray<Island*>* islandsPtr, const SolverParams& solverParams);
 
 protected:
 	btAlignedObjectArray<Island*> m_allocatedIslands;    // owner of all Islands
@@ -70,6 +115,15 @@ protected:
 	int m_minimumSolverBatchSize;
 	int m_batchIslandMinBodyCount;
 	IslandDispatchFunc m_islandDispatch;
+	bool m_parallelIslands;
+
+	IslandGrouping m_bodyGrouping;
+	IslandGrouping m_manifoldGrouping;
+	IslandGrouping m_constraintGrouping;
+	btAlignedObjectArray<int> m_itemIslandIds;    // scratch for the groupings, island id of each item or -1
+	btAlignedObjectArray<char> m_islandIsAwake;   // per island id
+	btAlignedObjectArray<char> m_manifoldWakeUp;  // per manifold, bit 0 wakes body0 and bit 1 body1
+	btAlignedObjectArray<IslandTarget> m_islandTargets;
 
 	Island* getIsland(int id);
 	virtual Island* allocateIsland(int id, int numBodies);
@@ -78,6 +132,8 @@ protected:
 	virtual void addManifoldsToIslands(btDispatcher* dispatcher);
 	virtual void addConstraintsToIslands(btAlignedObjectArray<btTypedConstraint*>& constraints);
 	virtual void mergeIslands();
+	virtual void buildIslandsParallel(btCollisionWorld* collisionWorld);
+	virtual void addToIslandsParallel(btDispatcher* dispatcher, btCollisionWorld* collisionWorld, btAlignedObjectArray<btTypedConstraint*>& constraints);
 
 public:
 	btSimulationIslandManagerMt();
@@ -90,6 +146,12 @@ public:
 
 	virtual void buildIslands(btDispatcher* dispatcher, btCollisionWorld* colWorld);
 
+	virtual void updateActivationState(btCollisionWorld* colWorld, btDispatcher* dispatcher);
+	virtual void storeIslandActivationState(btCollisionWorld* world);
+	// merges the islands of the dynamic bodies joined by these manifolds and enabled constraints, between
+	// updateActivationState and storeIslandActivationState. Runs on several threads when getParallelIslands()
+	void findConstraintUnions(btPersistentManifold** manifolds, int numManifolds, btTypedConstraint** constraints, int numConstraints);
+
 	int getMinimumSolverBatchSize() const
 	{
 		return m_minimumSolverBatchSize;
@@ -107,6 +169,15 @@ public:
 	{
 		m_islandDispatch = func;
 	}
+	bool getParallelIslands() const
+	{
+		return m_parallelIslands;
+	}
+	// build the islands on several threads, off by default
+	void setParallelIslands(bool parallel)
+	{
+		m_parallelIslands = parallel;
+	}
 };
 
 #endif  //BT_SIMULATION_ISLAND_MANAGER_H
@@ -0,0 +1,351 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2009 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "btWorldSnapshot.h"
+#include "btDiscreteDynamicsWorld.h"
+#include "btRigidBody.h"
+#include "BulletCollision/BroadphaseCollision/btBroadphaseInterface.h"
+#include "BulletCollision/BroadphaseCollision/btDispatcher.h"
+#include "BulletDynamics/ConstraintSolver/btTypedConstraint.h"
+#include "LinearMath/btQuickprof.h"
+
+static bool btSameVector3(const btVector3& a, const btVector3& b)
+{
+	// the unused fourth component may hold anything
+	return a.x() == b.x() && a.y() == b.y() && a.z() == b.z();
+}
+
+static void btCaptureObjectState(const btCollisionObject* object, btWorldSnapshot::ObjectState& state)
+{
+	state.m_worldTransform = object->getWorldTransform();
+	state.m_interpolationWorldTransform = object->getInterpolationWorldTransform();
+	state.m_interpolationLinearVelocity = object->getInterpolationLinearVelocity();
+	state.m_interpolationAngularVelocity = object->getInterpolationAngularVelocity();
+	if (const btRigidBody* body = btRigidBody::upcast(object))
+	{
+		state.m_linearVelocity = body->getLinearVelocity();
+		state.m_angularVelocity = body->getAngularVelocity();
+	}
+	else
+	{
+		state.m_linearVelocity.setZero();
+		state.m_angularVelocity.setZero();
+	}
+	if (const btBroadphaseProxy* proxy = object->getBroadphaseHandle())
+	{
+		state.m_aabbMin = proxy->m_aabbMin;
+		state.m_aabbMax = proxy->m_aabbMax;
+	}
+	else
+	{
+		state.m_aabbMin.setZero();
+		state.m_aabbMax.setZero();
+	}
+	state.m_object = object;
+	state.m_deactivationTime = object->getDeactivationTime();
+	state.m_hitFraction = object->getHitFraction();
+	state.m_activationState = object->getActivationState();
+}
+
+struct btManifoldStateSortPredicate
+{
+	const btAlignedObjectArray<btWorldSnapshot::ManifoldState>* m_states;
+
+	bool operator()(int lhs, int rhs) const
+	{
+		return size_t((*m_states)[lhs].m_manifold) < size_t((*m_states)[rhs].m_manifold);
+	}
+};
+
+btWorldSnapshot::btWorldSnapshot()
+	: m_base(NULL),
+	  m_numObjects(0),
+	  m_numManifolds(0),
+	  m_localTime(0)
+{
+}
+
+size_t btWorldSnapshot::getMemorySize() const
+{
+	return m_objectStates.capacity() * sizeof(ObjectState) +
+		   m_objectIndices.capacity() * sizeof(int) +
+		   m_revisions.capacity() * sizeof(ObjectRevision) +
+		   m_manifoldStates.capacity() * sizeof(ManifoldState) +
+		   m_manifoldOrder.capacity() * sizeof(int) +
+		   m_constraints.capacity() * sizeof(const btTypedConstraint*) +
+		   m_appliedImpulses.capacity() * sizeof(btScalar);
+}
+
+void btWorldSnapshot::capture(btDiscreteDynamicsWorld* world, btScalar localTime, const btWorldSnapshot* base)
+{
+	BT_PROFILE("btWorldSnapshot::capture");
+	const btCollisionObjectArray& objects = world->getCollisionObjectArray();
+	const int numObjects = objects.size();
+	// a delta needs an earlier snapshot of the same objects that does not build on this one
+	m_base = (base && base->m_numObjects == numObjects) ? base : NULL;
+	for (const btWorldSnapshot* snapshot = m_base; snapshot; snapshot = snapshot->m_base)
+	{
+		if (snapshot == this)
+		{
+			m_base = NULL;
+		}
+	}
+	btAssert(m_base == base);
+	m_numObjects = numObjects;
+	m_localTime = localTime;
+
+	m_objectIndices.resizeNoInitialize(0);
+	m_revisions.resizeNoInitialize(numObjects);
+	if (m_base)
+	{
+		m_objectStates.resizeNoInitialize(0);
+		for (int i = 0; i < numObjects; ++i)
+		{
+			captureRevision(objects[i], m_revisions[i]);
+			if (hasChanged(i))
+			{
+				btCaptureObjectState(objects[i], m_objectStates.expandNonInitializing());
+				m_objectIndices.push_back(i);
+			}
+		}
+	}
+	else
+	{
+		m_objectStates.resizeNoInitialize(numObjects);
+		for (int i = 0; i < numObjects; ++i)
+		{
+			captureRevision(objects[i], m_revisions[i]);
+			btCaptureObjectState(objects[i], m_objectStates[i]);
+		}
+	}
+
+	// manifolds without contacts have nothing to warm start, they are cleared on restore.
+	// Contacts only change when one of the bodies does, a delta leaves the others to its base.
+	btDispatcher* dispatcher = world->getDispatcher();
+	const int numManifolds = dispatcher->getNumManifolds();
+	m_manifoldStates.resizeNoInitialize(0);
+	m_numManifolds = 0;
+	for (int i = 0; i < numManifolds; ++i)
+	{
+		const btPersistentManifold* manifold = dispatcher->getManifoldByIndexInternal(i);
+		const int numContacts = manifold->getNumContacts();
+		if (numContacts == 0)
+		{
+			continue;
+		}
+		m_numManifolds++;
+		if (!hasChanged(manifold->getBody0()->getWorldArrayIndex()) && !hasChanged(manifold->getBody1()->getWorldArrayIndex()))
+		{
+			continue;
+		}
+		ManifoldState& state = m_manifoldStates.expandNonInitializing();
+		state.m_manifold = manifold;
+		state.m_body0 = manifold->getBody0();
+		state.m_body1 = manifold->getBody1();
+		state.m_numContacts = numContacts;
+		for (int j = 0; j < numContacts; ++j)
+		{
+			state.m_points[j] = manifold->getContactPoint(j);
+			// the user data of a point is destroyed with the point, it can not be shared with the snapshot
+			state.m_points[j].m_userPersistentData = NULL;
+		}
+	}
+	m_manifoldOrder.resizeNoInitialize(m_manifoldStates.size());
+	for (int i = 0; i < m_manifoldOrder.size(); ++i)
+	{
+		m_manifoldOrder[i] = i;
+	}
+	btManifoldStateSortPredicate predicate;
+	predicate.m_states = &m_manifoldStates;
+	m_manifoldOrder.quickSort(predicate);
+
+	const int numConstraints = world->getNumConstraints();
+	m_constraints.resizeNoInitialize(numConstraints);
+	m_appliedImpulses.resizeNoInitialize(numConstraints);
+	for (int i = 0; i < numConstraints; ++i)
+	{
+		btTypedConstraint* constraint = world->getConstraint(i);
+		m_constraints[i] = constraint;
+		m_appliedImpulses[i] = constraint->internalGetAppliedImpulse();
+	}
+}
+
+void btWorldSnapshot::captureRevision(const btCollisionObject* object, ObjectRevision& revision)
+{
+	revision.m_updateRevision = object->getUpdateRevisionInternal();
+	revision.m_activationState = object->getActivationState();
+	revision.m_deactivationTime = object->getDeactivationTime();
+	revision.m_hitFraction = object->getHitFraction();
+}
+
+void btWorldSnapshot::restoreObject(btDiscreteDynamicsWorld* world, btCollisionObject* object, const ObjectState& state) const
+{
+	object->setWorldTransform(state.m_worldTransform);
+	object->setInterpolationWorldTransform(state.m_interpolationWorldTransform);
+	object->setInterpolationLinearVelocity(state.m_interpolationLinearVelocity);
+	object->setInterpolationAngularVelocity(state.m_interpolationAngularVelocity);
+	object->setDeactivationTime(state.m_deactivationTime);
+	object->setHitFraction(state.m_hitFraction);
+	object->forceActivationState(state.m_activationState);
+	if (btRigidBody* body = btRigidBody::upcast(object))
+	{
+		body->setLinearVelocity(state.m_linearVelocity);
+		body->setAngularVelocity(state.m_angularVelocity);
+		body->updateInertiaTensor();
+	}
+	btBroadphaseProxy* proxy = object->getBroadphaseHandle();
+	if (proxy && !(btSameVector3(proxy->m_aabbMin, state.m_aabbMin) && btSameVector3(proxy->m_aabbMax, state.m_aabbMax)))
+	{
+		world->getBroadphase()->setAabb(proxy, state.m_aabbMin, state.m_aabbMax, world->getDispatcher());
+	}
+}
+
+const btWorldSnapshot& btWorldSnapshot::getKeyFrame() const
+{
+	const btWorldSnapshot* keyFrame = this;
+	while (keyFrame->m_base)
+	{
+		keyFrame = keyFrame->m_base;
+	}
+	return *keyFrame;
+}
+
+void btWorldSnapshot::restoreObjects(btDiscreteDynamicsWorld* world) const
+{
+	btCollisionObjectArray& objects = world->getCollisionObjectArray();
+	if (m_base)
+	{
+		// oldest first, a delta overrides what it builds on for the objects it holds
+		m_base->restoreObjects(world);
+		for (int i = 0; i < m_objectIndices.size(); ++i)
+		{
+			restoreObject(world, objects[m_objectIndices[i]], m_objectStates[i]);
+		}
+	}
+	else
+	{
+		for (int i = 0; i < m_numObjects; ++i)
+		{
+			restoreObject(world, objects[i], m_objectStates[i]);
+		}
+	}
+}
+
+const btWorldSnapshot::ManifoldState* btWorldSnapshot::findManifoldState(const btPersistentManifold* manifold) const
+{
+	// the newest snapshot in which one of the bodies changed has the manifold as it was then, or has it without contacts
+	const int index0 = manifold->getBody0()->getWorldArrayIndex();
+	const int index1 = manifold->getBody1()->getWorldArrayIndex();
+	const btWorldSnapshot* snapshot = this;
+	while (!snapshot->hasChanged(index0) && !snapshot->hasChanged(index1))
+	{
+		snapshot = snapshot->m_base;
+	}
+	int lo = 0;
+	int hi = snapshot->m_manifoldOrder.size();
+	while (lo < hi)
+	{
+		const int mid = (lo + hi) / 2;
+		const ManifoldState& state = snapshot->m_manifoldStates[snapshot->m_manifoldOrder[mid]];
+		if (state.m_manifold == manifold)
+		{
+			return &state;
+		}
+		if (size_t(state.m_manifold) < size_t(manifold))
+		{
+			lo = mid + 1;
+		}
+		else
+		{
+			hi = mid;
+		}
+	}
+	return NULL;
+}
+
+bool btWorldSnapshot::restore(btDiscreteDynamicsWorld* world, btScalar& localTime, int* numLostManifolds) const
+{
+	BT_PROFILE("btWorldSnapshot::restore");
+	btCollisionObjectArray& objects = world->getCollisionObjectArray();
+	const btWorldSnapshot& keyFrame = getKeyFrame();
+	if (objects.size() != m_numObjects || keyFrame.m_numObjects != m_numObjects || world->getNumConstraints() != m_constraints.size())
+	{
+		return false;
+	}
+	for (int i = 0; i < m_numObjects; ++i)
+	{
+		if (objects[i] != keyFrame.m_objectStates[i].m_object)
+		{
+			return false;
+		}
+	}
+	for (const btWorldSnapshot* delta = this; delta->m_base; delta = delta->m_base)
+	{
+		for (int i = 0; i < delta->m_objectIndices.size(); ++i)
+		{
+			if (objects[delta->m_objectIndices[i]] != delta->m_objectStates[i].m_object)
+			{
+				return false;
+			}
+		}
+	}
+	for (int i = 0; i < m_constraints.size(); ++i)
+	{
+		if (world->getConstraint(i) != m_constraints[i])
+		{
+			return false;
+		}
+	}
+
+	restoreObjects(world);
+
+	btDispatcher* dispatcher = world->getDispatcher();
+	const int numManifolds = dispatcher->getNumManifolds();
+	int numRestored = 0;
+	for (int i = 0; i < numManifolds; ++i)
+	{
+		btPersistentManifold* manifold = dispatcher->getManifoldByIndexInternal(i);
+		const ManifoldState* state = findManifoldState(manifold);
+		// the memory of a destroyed manifold may have been reused for another pair
+		if (state && (state->m_body0 != manifold->getBody0() || state->m_body1 != manifold->getBody1()))
+		{
+			state = NULL;
+		}
+		if (manifold->getNumContacts())
+		{
+			manifold->clearManifold();
+		}
+		if (state)
+		{
+			for (int j = 0; j < state->m_numContacts; ++j)
+			{
+				manifold->getContactPoint(j) = state->m_points[j];
+			}
+			manifold->setNumContacts(state->m_numContacts);
+			numRestored++;
+		}
+	}
+	if (numLostManifolds)
+	{
+		*numLostManifolds = m_numManifolds - numRestored;
+	}
+
+	for (int i = 0; i < m_constraints.size(); ++i)
+	{
+		world->getConstraint(i)->internalSetAppliedImpulse(m_appliedImpulses[i]);
+	}
+	localTime = m_localTime;
+	return true;
+}
@@ -0,0 +1,153 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2009 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef BT_WORLD_SNAPSHOT_H
+#define BT_WORLD_SNAPSHOT_H
+
+#include "LinearMath/btTransform.h"
+#include "LinearMath/btAlignedObjectArray.h"
+#include "BulletCollision/NarrowPhaseCollision/btPersistentManifold.h"
+
+class btDiscreteDynamicsWorld;
+class btCollisionObject;
+class btTypedConstraint;
+
+///btWorldSnapshot holds the mutable state of a btDiscreteDynamicsWorld in memory, to roll the world back or to branch
+///off a what-if simulation and come back, see btDiscreteDynamicsWorld::captureSnapshot and restoreSnapshot.
+///It keeps transforms, velocities, activation and broadphase AABBs of the collision objects, the contact points of the
+///persistent manifolds (the warm starting cache) and the applied impulses of the constraints in flat arrays.
+///Objects, constraints, pairs and collision algorithms stay in the world, so a snapshot only restores into the world
+///it was taken from, with the same objects and constraints. A manifold destroyed after the capture does not come back,
+///its pair starts again without warm starting on the next step.
+///The first capture sizes the arrays. Later captures of the same world and restoring don't allocate, unless a delta
+///holds more changes than before.
+///Forces applied since the last step and motion states are input rather than state and are not part of a snapshot.
+ATTRIBUTE_ALIGNED16(class)
+btWorldSnapshot
+{
+public:
+	BT_DECLARE_ALIGNED_ALLOCATOR();
+
+	struct ObjectState
+	{
+		btTransform m_worldTransform;
+		btTransform m_interpolationWorldTransform;
+		btVector3 m_interpolationLinearVelocity;
+		btVector3 m_interpolationAngularVelocity;
+		btVector3 m_linearVelocity;
+		btVector3 m_angularVelocity;
+		btVector3 m_aabbMin;
+		btVector3 m_aabbMax;
+		const btCollisionObject* m_object;
+		btScalar m_deactivationTime;
+		btScalar m_hitFraction;
+		int m_activationState;
+	};
+
+	struct ManifoldState
+	{
+		btManifoldPoint m_points[MANIFOLD_CACHE_SIZE];
+		const btPersistentManifold* m_manifold;
+		const btCollisionObject* m_body0;
+		const btCollisionObject* m_body1;
+		int m_numContacts;
+	};
+
+	btWorldSnapshot();
+
+	///a delta snapshot keeps only the objects that changed since its base was captured. The base is a full snapshot (a
+	///key frame) or another delta, so every frame can be a delta on the previous one. Restoring a delta restores the
+	///key frame and then each delta of the chain, which has to stay alive and must not be captured again while in use.
+	///Changes are found with the update revision of the collision objects, which the setters and the simulation step
+	///increase, and with the activation state, deactivation time and hit fraction, which change without it.
+	///Writes through the non-const getWorldTransform() or getInterpolationWorldTransform() references do not increase
+	///the revision. After such writes call setWorldTransform or setInterpolationWorldTransform with the new transform,
+	///or capture a key frame, or the next delta misses the objects that only changed that way.
+	///Restoring counts as a change, so the first delta after a restore holds every object.
+	///The manifolds of a delta are those of the changed objects, the others are taken from further down the chain.
+	bool isDelta() const
+	{
+		return m_base != NULL;
+	}
+
+	const btWorldSnapshot* getBase() const
+	{
+		return m_base;
+	}
+
+	///number of object states stored, all objects for a full snapshot and the changed ones for a delta
+	int getNumObjectStates() const
+	{
+		return m_objectStates.size();
+	}
+
+	///number of manifold states stored, the manifolds of the changed objects for a delta
+	int getNumManifoldStates() const
+	{
+		return m_manifoldStates.size();
+	}
+
+	///memory held by the snapshot arrays
+	size_t getMemorySize() const;
+
+	///called by btDiscreteDynamicsWorld::captureSnapshot
+	void capture(btDiscreteDynamicsWorld* world, btScalar localTime, const btWorldSnapshot* base);
+
+	///called by btDiscreteDynamicsWorld::restoreSnapshot, returns false without touching the world when it has other
+	///objects or constraints than the snapshot
+	bool restore(btDiscreteDynamicsWorld* world, btScalar& localTime, int* numLostManifolds) const;
+
+private:
+	struct ObjectRevision
+	{
+		int m_updateRevision;
+		int m_activationState;
+		btScalar m_deactivationTime;
+		btScalar m_hitFraction;
+	};
+
+	btAlignedObjectArray<ObjectState> m_objectStates;
+	btAlignedObjectArray<int> m_objectIndices;  // delta only, world array index of each object state, increasing
+	btAlignedObjectArray<ObjectRevision> m_revisions;  // of every object, to find the changes for the next delta
+	btAlignedObjectArray<ManifoldState> m_manifoldStates;
+	btAlignedObjectArray<int> m_manifoldOrder;  // manifold states sorted by manifold address, to find them on restore
+	btAlignedObjectArray<const btTypedConstraint*> m_constraints;
+	btAlignedObjectArray<btScalar> m_appliedImpulses;
+	const btWorldSnapshot* m_base;
+	int m_numObjects;
+	int m_numManifolds;  // manifolds with contacts in the world at capture, including those a delta leaves to its base
+	btScalar m_localTime;
+
+	const btWorldSnapshot& getKeyFrame() const;
+	static void captureRevision(const btCollisionObject* object, ObjectRevision& revision);
+	bool hasChanged(int objectIndex) const
+	{
+		if (!m_base)
+		{
+			return true;
+		}
+		const ObjectRevision& revision = m_revisions[objectIndex];
+		const ObjectRevision& baseRevision = m_base->m_revisions[objectIndex];
+		return revision.m_updateRevision != baseRevision.m_updateRevision ||
+			   revision.m_activationState != baseRevision.m_activationState ||
+			   revision.m_deactivationTime != baseRevision.m_deactivationTime ||
+			   revision.m_hitFraction != baseRevision.m_hitFraction;
+	}
+	void restoreObject(btDiscreteDynamicsWorld* world, btCollisionObject* object, const ObjectState& state) const;
+	void restoreObjects(btDiscreteDynamicsWorld* world) const;
+	const ManifoldState* findManifoldState(const btPersistentManifold* manifold) const;
+};
+
+#endif  //BT_WORLD_SNAPSHOT_H
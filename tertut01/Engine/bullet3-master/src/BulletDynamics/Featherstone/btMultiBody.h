@@ -741,6 +741,8 @@ public:
 
 
 private:
+	friend class btMultiBodyBatch;
+
 	btMultiBody(const btMultiBody &);     // not implemented
 	void operator=(const btMultiBody &);  // not implemented
 
@@ -0,0 +1,817 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2013 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "btMultiBodyBatch.h"
+#include "btMultiBody.h"
+#include "LinearMath/btQuickprof.h"
+#include "LinearMath/btThreads.h"
+
+#if !defined(BT_USE_DOUBLE_PRECISION) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define BT_MULTIBODY_BATCH_SSE 1
+#include <emmintrin.h>
+#endif
+
+// the lanes hold one scalar of each multibody of a batch
+#if BT_MULTIBODY_BATCH_SSE
+typedef __m128 btMbLanes;
+
+static SIMD_FORCE_INLINE btMbLanes btMbLoad(const btScalar* p) { return _mm_load_ps(p); }
+static SIMD_FORCE_INLINE void btMbStore(btScalar* p, btMbLanes a) { _mm_store_ps(p, a); }
+static SIMD_FORCE_INLINE btMbLanes btMbZero() { return _mm_setzero_ps(); }
+static SIMD_FORCE_INLINE btMbLanes btMbAdd(btMbLanes a, btMbLanes b) { return _mm_add_ps(a, b); }
+static SIMD_FORCE_INLINE btMbLanes btMbSub(btMbLanes a, btMbLanes b) { return _mm_sub_ps(a, b); }
+static SIMD_FORCE_INLINE btMbLanes btMbMul(btMbLanes a, btMbLanes b) { return _mm_mul_ps(a, b); }
+static SIMD_FORCE_INLINE btMbLanes btMbNeg(btMbLanes a) { return _mm_xor_ps(a, _mm_set1_ps(-0.0f)); }
+// 1 / d where d >= SIMD_EPSILON, else 0, like the invD of a single degree of freedom joint
+static SIMD_FORCE_INLINE btMbLanes btMbInverseOrZero(btMbLanes d)
+{
+	return _mm_and_ps(_mm_cmpge_ps(d, _mm_set1_ps(SIMD_EPSILON)), _mm_div_ps(_mm_set1_ps(1.0f), d));
+}
+// btSqrt(d) where d > SIMD_EPSILON, else 0, like btVector3::safeNorm
+static SIMD_FORCE_INLINE btMbLanes btMbSafeSqrt(btMbLanes d)
+{
+	return _mm_and_ps(_mm_cmpgt_ps(d, _mm_set1_ps(SIMD_EPSILON)), _mm_sqrt_ps(d));
+}
+#else
+struct btMbLanes
+{
+	btScalar m[btMultiBodyBatch::MAX_LANES];
+};
+
+static SIMD_FORCE_INLINE btMbLanes btMbLoad(const btScalar* p)
+{
+	btMbLanes r;
+	for (int l = 0; l < btMultiBodyBatch::MAX_LANES; ++l) r.m[l] = p[l];
+	return r;
+}
+static SIMD_FORCE_INLINE void btMbStore(btScalar* p, const btMbLanes& a)
+{
+	for (int l = 0; l < btMultiBodyBatch::MAX_LANES; ++l) p[l] = a.m[l];
+}
+static SIMD_FORCE_INLINE btMbLanes btMbZero()
+{
+	btMbLanes r;
+	for (int l = 0; l < btMultiBodyBatch::MAX_LANES; ++l) r.m[l] = btScalar(0.);
+	return r;
+}
+static SIMD_FORCE_INLINE btMbLanes btMbAdd(const btMbLanes& a, const btMbLanes& b)
+{
+	btMbLanes r;
+	for (int l = 0; l < btMultiBodyBatch::MAX_LANES; ++l) r.m[l] = a.m[l] + b.m[l];
+	return r;
+}
+static SIMD_FORCE_INLINE btMbLanes btMbSub(const btMbLanes& a, const btMbLanes& b)
+{
+	btMbLanes r;
+	for (int l = 0; l < btMultiBodyBatch::MAX_LANES; ++l) r.m[l] = a.m[l] - b.m[l];
+	return r;
+}
+static SIMD_FORCE_INLINE btMbLanes btMbMul(const btMbLanes& a, const btMbLanes& b)
+{
+	btMbLanes r;
+	for (int l = 0; l < btMultiBodyBatch::MAX_LANES; ++l) r.m[l] = a.m[l] * b.m[l];
+	return r;
+}
+static SIMD_FORCE_INLINE btMbLanes btMbNeg(const btMbLanes& a)
+{
+	btMbLanes r;
+	for (int l = 0; l < btMultiBodyBatch::MAX_LANES; ++l) r.m[l] = -a.m[l];
+	return r;
+}
+static SIMD_FORCE_INLINE btMbLanes btMbInverseOrZero(const btMbLanes& d)
+{
+	btMbLanes r;
+	for (int l = 0; l < btMultiBodyBatch::MAX_LANES; ++l) r.m[l] = d.m[l] >= SIMD_EPSILON ? btScalar(1.0) / d.m[l] : btScalar(0.);
+	return r;
+}
+static SIMD_FORCE_INLINE btMbLanes btMbSafeSqrt(const btMbLanes& d)
+{
+	btMbLanes r;
+	for (int l = 0; l < btMultiBodyBatch::MAX_LANES; ++l) r.m[l] = d.m[l] > SIMD_EPSILON ? btSqrt(d.m[l]) : btScalar(0.);
+	return r;
+}
+#endif
+
+static SIMD_FORCE_INLINE btMbLanes btMbMulAdd(const btMbLanes& a, const btMbLanes& b, const btMbLanes& c)
+{
+	return btMbAdd(btMbMul(a, b), c);
+}
+
+struct btMbVec3
+{
+	btMbLanes m[3];
+};
+
+// m[row][col]
+struct btMbMat3
+{
+	btMbLanes m[3][3];
+};
+
+static SIMD_FORCE_INLINE void btMbSetZero(btMbVec3& v)
+{
+	v.m[0] = v.m[1] = v.m[2] = btMbZero();
+}
+static SIMD_FORCE_INLINE btMbVec3 btMbAdd(const btMbVec3& a, const btMbVec3& b)
+{
+	btMbVec3 r;
+	for (int k = 0; k < 3; ++k) r.m[k] = btMbAdd(a.m[k], b.m[k]);
+	return r;
+}
+static SIMD_FORCE_INLINE btMbVec3 btMbSub(const btMbVec3& a, const btMbVec3& b)
+{
+	btMbVec3 r;
+	for (int k = 0; k < 3; ++k) r.m[k] = btMbSub(a.m[k], b.m[k]);
+	return r;
+}
+static SIMD_FORCE_INLINE btMbVec3 btMbNeg(const btMbVec3& a)
+{
+	btMbVec3 r;
+	for (int k = 0; k < 3; ++k) r.m[k] = btMbNeg(a.m[k]);
+	return r;
+}
+static SIMD_FORCE_INLINE btMbVec3 btMbScale(const btMbVec3& a, const btMbLanes& s)
+{
+	btMbVec3 r;
+	for (int k = 0; k < 3; ++k) r.m[k] = btMbMul(a.m[k], s);
+	return r;
+}
+// component-wise, like btVector3 * btVector3
+static SIMD_FORCE_INLINE btMbVec3 btMbMul(const btMbVec3& a, const btMbVec3& b)
+{
+	btMbVec3 r;
+	for (int k = 0; k < 3; ++k) r.m[k] = btMbMul(a.m[k], b.m[k]);
+	return r;
+}
+static SIMD_FORCE_INLINE btMbLanes btMbDot(const btMbVec3& a, const btMbVec3& b)
+{
+	return btMbAdd(btMbAdd(btMbMul(a.m[0], b.m[0]), btMbMul(a.m[1], b.m[1])), btMbMul(a.m[2], b.m[2]));
+}
+static SIMD_FORCE_INLINE btMbVec3 btMbCross(const btMbVec3& a, const btMbVec3& b)
+{
+	btMbVec3 r;
+	r.m[0] = btMbSub(btMbMul(a.m[1], b.m[2]), btMbMul(a.m[2], b.m[1]));
+	r.m[1] = btMbSub(btMbMul(a.m[2], b.m[0]), btMbMul(a.m[0], b.m[2]));
+	r.m[2] = btMbSub(btMbMul(a.m[0], b.m[1]), btMbMul(a.m[1], b.m[0]));
+	return r;
+}
+// M * v
+static SIMD_FORCE_INLINE btMbVec3 btMbMul(const btMbMat3& M, const btMbVec3& v)
+{
+	btMbVec3 r;
+	for (int i = 0; i < 3; ++i)
+		r.m[i] = btMbAdd(btMbAdd(btMbMul(M.m[i][0], v.m[0]), btMbMul(M.m[i][1], v.m[1])), btMbMul(M.m[i][2], v.m[2]));
+	return r;
+}
+// M^T * v
+static SIMD_FORCE_INLINE btMbVec3 btMbTransposeMul(const btMbMat3& M, const btMbVec3& v)
+{
+	btMbVec3 r;
+	for (int i = 0; i < 3; ++i)
+		r.m[i] = btMbAdd(btMbAdd(btMbMul(M.m[0][i], v.m[0]), btMbMul(M.m[1][i], v.m[1])), btMbMul(M.m[2][i], v.m[2]));
+	return r;
+}
+// A * B
+static SIMD_FORCE_INLINE void btMbMul(const btMbMat3& A, const btMbMat3& B, btMbMat3& out)
+{
+	for (int i = 0; i < 3; ++i)
+		for (int j = 0; j < 3; ++j)
+			out.m[i][j] = btMbAdd(btMbAdd(btMbMul(A.m[i][0], B.m[0][j]), btMbMul(A.m[i][1], B.m[1][j])), btMbMul(A.m[i][2], B.m[2][j]));
+}
+// A^T * B, added to out
+static SIMD_FORCE_INLINE void btMbTransposeMulAdd(const btMbMat3& A, const btMbMat3& B, btMbMat3& out)
+{
+	for (int i = 0; i < 3; ++i)
+		for (int j = 0; j < 3; ++j)
+			out.m[i][j] = btMbAdd(out.m[i][j], btMbAdd(btMbAdd(btMbMul(A.m[0][i], B.m[0][j]), btMbMul(A.m[1][i], B.m[1][j])), btMbMul(A.m[2][i], B.m[2][j])));
+}
+// A * [r]x, with [r]x the cross product matrix of r
+static SIMD_FORCE_INLINE void btMbMulCross(const btMbMat3& A, const btMbVec3& r, btMbMat3& out)
+{
+	for (int i = 0; i < 3; ++i)
+	{
+		out.m[i][0] = btMbSub(btMbMul(A.m[i][1], r.m[2]), btMbMul(A.m[i][2], r.m[1]));
+		out.m[i][1] = btMbSub(btMbMul(A.m[i][2], r.m[0]), btMbMul(A.m[i][0], r.m[2]));
+		out.m[i][2] = btMbSub(btMbMul(A.m[i][0], r.m[1]), btMbMul(A.m[i][1], r.m[0]));
+	}
+}
+// A^T * [r]x
+static SIMD_FORCE_INLINE void btMbTransposeMulCross(const btMbMat3& A, const btMbVec3& r, btMbMat3& out)
+{
+	for (int i = 0; i < 3; ++i)
+	{
+		out.m[i][0] = btMbSub(btMbMul(A.m[1][i], r.m[2]), btMbMul(A.m[2][i], r.m[1]));
+		out.m[i][1] = btMbSub(btMbMul(A.m[2][i], r.m[0]), btMbMul(A.m[0][i], r.m[2]));
+		out.m[i][2] = btMbSub(btMbMul(A.m[0][i], r.m[1]), btMbMul(A.m[1][i], r.m[0]));
+	}
+}
+// [r]x * A
+static SIMD_FORCE_INLINE void btMbCrossMul(const btMbVec3& r, const btMbMat3& A, btMbMat3& out)
+{
+	for (int j = 0; j < 3; ++j)
+	{
+		out.m[0][j] = btMbSub(btMbMul(r.m[1], A.m[2][j]), btMbMul(r.m[2], A.m[1][j]));
+		out.m[1][j] = btMbSub(btMbMul(r.m[2], A.m[0][j]), btMbMul(r.m[0], A.m[2][j]));
+		out.m[2][j] = btMbSub(btMbMul(r.m[0], A.m[1][j]), btMbMul(r.m[1], A.m[0][j]));
+	}
+}
+// out -= a * b^T
+static SIMD_FORCE_INLINE void btMbSubOuter(const btMbVec3& a, const btMbVec3& b, btMbMat3& out)
+{
+	for (int i = 0; i < 3; ++i)
+		for (int j = 0; j < 3; ++j)
+			out.m[i][j] = btMbSub(out.m[i][j], btMbMul(a.m[i], b.m[j]));
+}
+
+// gathers and scatters between the lanes and the scalar types
+
+static SIMD_FORCE_INLINE btMbLanes btMbGather(const btScalar* values)
+{
+	ATTRIBUTE_ALIGNED16(btScalar tmp[btMultiBodyBatch::MAX_LANES]);
+	for (int l = 0; l < btMultiBodyBatch::MAX_LANES; ++l) tmp[l] = values[l];
+	return btMbLoad(tmp);
+}
+static SIMD_FORCE_INLINE btMbVec3 btMbGather(const btVector3* values)
+{
+	btMbVec3 r;
+	for (int k = 0; k < 3; ++k)
+	{
+		ATTRIBUTE_ALIGNED16(btScalar tmp[btMultiBodyBatch::MAX_LANES]);
+		for (int l = 0; l < btMultiBodyBatch::MAX_LANES; ++l) tmp[l] = values[l][k];
+		r.m[k] = btMbLoad(tmp);
+	}
+	return r;
+}
+static SIMD_FORCE_INLINE void btMbGather(const btMatrix3x3* values, btMbMat3& out)
+{
+	for (int i = 0; i < 3; ++i)
+	{
+		for (int j = 0; j < 3; ++j)
+		{
+			ATTRIBUTE_ALIGNED16(btScalar tmp[btMultiBodyBatch::MAX_LANES]);
+			for (int l = 0; l < btMultiBodyBatch::MAX_LANES; ++l) tmp[l] = values[l][i][j];
+			out.m[i][j] = btMbLoad(tmp);
+		}
+	}
+}
+static SIMD_FORCE_INLINE void btMbScatter(const btMbLanes& a, btScalar* values)
+{
+	ATTRIBUTE_ALIGNED16(btScalar tmp[btMultiBodyBatch::MAX_LANES]);
+	btMbStore(tmp, a);
+	for (int l = 0; l < btMultiBodyBatch::MAX_LANES; ++l) values[l] = tmp[l];
+}
+static SIMD_FORCE_INLINE void btMbScatter(const btMbVec3& a, btVector3* values)
+{
+	for (int k = 0; k < 3; ++k)
+	{
+		ATTRIBUTE_ALIGNED16(btScalar tmp[btMultiBodyBatch::MAX_LANES]);
+		btMbStore(tmp, a.m[k]);
+		for (int l = 0; l < btMultiBodyBatch::MAX_LANES; ++l) values[l][k] = tmp[l];
+	}
+}
+static SIMD_FORCE_INLINE void btMbScatter(const btMbMat3& a, btMatrix3x3* values)
+{
+	for (int i = 0; i < 3; ++i)
+	{
+		for (int j = 0; j < 3; ++j)
+		{
+			ATTRIBUTE_ALIGNED16(btScalar tmp[btMultiBodyBatch::MAX_LANES]);
+			btMbStore(tmp, a.m[i][j]);
+			for (int l = 0; l < btMultiBodyBatch::MAX_LANES; ++l) values[l][i][j] = tmp[l];
+		}
+	}
+}
+
+// the state of link i + 1 (0 is the base) of all lanes, see btMultiBody::computeAccelerationsArticulatedBodyAlgorithmMultiDof
+// for the meaning of the spatial quantities. Motion vectors are stored angular, linear and force vectors linear, angular.
+struct btMbLinkLanes
+{
+	btMbMat3 m_rotFromParent;
+	btMbMat3 m_rotFromWorld;
+	btMbVec3 m_rVector;
+	btMbVec3 m_axisTop;
+	btMbVec3 m_axisBottom;
+	btMbVec3 m_velTop;
+	btMbVec3 m_velBottom;
+	btMbVec3 m_coriolisTop;
+	btMbVec3 m_coriolisBottom;
+	btMbVec3 m_zeroAccTop;
+	btMbVec3 m_zeroAccBottom;
+	btMbVec3 m_hTop;
+	btMbVec3 m_hBottom;
+	btMbVec3 m_accTop;
+	btMbVec3 m_accBottom;
+	// Ihat_i^A, the bottom right block is the transpose of the top left one
+	btMbMat3 m_inertiaTopLeft;
+	btMbMat3 m_inertiaTopRight;
+	btMbMat3 m_inertiaBottomLeft;
+	btMbLanes m_Y;
+	btMbLanes m_invD;
+};
+
+// zhat of a body with velocity (omega, vel) in its local frame, without the applied forces
+static SIMD_FORCE_INLINE void btMbBiasForce(const btMbVec3& omega, const btMbVec3& vel, const btMbLanes& mass, const btMbVec3& inertia,
+											const btMbLanes& linearDamping, const btMbLanes& angularDamping, bool useGyroTerm,
+											btMbVec3& zeroAccTop, btMbVec3& zeroAccBottom)
+{
+	const btMbVec3 inertiaOmega = btMbMul(inertia, omega);
+	//adding damping terms (only)
+	const btMbLanes angularFactor = btMbMulAdd(angularDamping, btMbSafeSqrt(btMbDot(omega, omega)), angularDamping);
+	const btMbLanes linearFactor = btMbMulAdd(linearDamping, btMbSafeSqrt(btMbDot(vel, vel)), linearDamping);
+	zeroAccBottom = btMbAdd(zeroAccBottom, btMbScale(inertiaOmega, angularFactor));
+	zeroAccTop = btMbAdd(zeroAccTop, btMbScale(btMbScale(vel, mass), linearFactor));
+	//p += vhat x Ihat vhat - done in a simpler way
+	if (useGyroTerm)
+		zeroAccBottom = btMbAdd(zeroAccBottom, btMbCross(omega, inertiaOmega));
+	zeroAccTop = btMbAdd(zeroAccTop, btMbScale(btMbCross(omega, vel), mass));
+}
+
+// init the spatial AB inertia, it has the simple form thanks to choosing local body frames origins at their COMs
+static SIMD_FORCE_INLINE void btMbSetRigidInertia(const btMbLanes& mass, const btMbVec3& inertia, btMbLinkLanes& link)
+{
+	const btMbLanes zero = btMbZero();
+	for (int i = 0; i < 3; ++i)
+	{
+		for (int j = 0; j < 3; ++j)
+		{
+			link.m_inertiaTopLeft.m[i][j] = zero;
+			link.m_inertiaTopRight.m[i][j] = i == j ? mass : zero;
+			link.m_inertiaBottomLeft.m[i][j] = i == j ? inertia.m[i] : zero;
+		}
+	}
+}
+
+struct btMultiBodyBatchScratch
+{
+	btAlignedObjectArray<btMbLinkLanes> m_links;
+	btAlignedObjectArray<btScalar> m_output;
+};
+
+// runs computeAccelerationsArticulatedBodyAlgorithmMultiDof for up to MAX_LANES multibodies of the same topology,
+// unused lanes repeat the last multibody
+void btMultiBodyBatch::computeBatchAccelerations(btMultiBody* const* bodies, int numBodies, btScalar dt, btMultiBodyBatchScratch& scratch)
+{
+	btMultiBody* lanes[btMultiBodyBatch::MAX_LANES];
+	for (int l = 0; l < btMultiBodyBatch::MAX_LANES; ++l)
+	{
+		lanes[l] = bodies[btMin(l, numBodies - 1)];
+	}
+	const btMultiBody* first = lanes[0];
+	const int numLinks = first->getNumLinks();
+	const int numDofs = first->getNumDofs();
+	const bool fixedBase = first->hasFixedBase();
+	const bool useGyroTerm = first->getUseGyroTerm();
+
+	scratch.m_links.resize(numLinks + 1);
+	btMbLinkLanes* links = &scratch.m_links[0];
+
+	btScalar scalars[btMultiBodyBatch::MAX_LANES];
+	btVector3 vectors[btMultiBodyBatch::MAX_LANES];
+	btVector3 vectors2[btMultiBodyBatch::MAX_LANES];
+	btMatrix3x3 matrices[btMultiBodyBatch::MAX_LANES];
+
+	for (int l = 0; l < btMultiBodyBatch::MAX_LANES; ++l) scalars[l] = lanes[l]->m_linearDamping;
+	const btMbLanes linearDamping = btMbGather(scalars);
+	for (int l = 0; l < btMultiBodyBatch::MAX_LANES; ++l) scalars[l] = lanes[l]->m_angularDamping;
+	const btMbLanes angularDamping = btMbGather(scalars);
+
+	// First 'upward' loop.
+	{
+		btMbLinkLanes& base = links[0];
+		for (int l = 0; l < numBodies; ++l)
+		{
+			lanes[l]->m_internalNeedsJointFeedback = false;
+			lanes[l]->m_matrixBuf[0] = btMatrix3x3(lanes[l]->m_baseQuat);
+		}
+		for (int l = 0; l < btMultiBodyBatch::MAX_LANES; ++l) matrices[l] = lanes[l]->m_matrixBuf[0];
+		btMbGather(matrices, base.m_rotFromParent);
+		base.m_rotFromWorld = base.m_rotFromParent;
+
+		for (int l = 0; l < btMultiBodyBatch::MAX_LANES; ++l) vectors[l] = lanes[l]->getBaseOmega();
+		base.m_velTop = btMbMul(base.m_rotFromParent, btMbGather(vectors));
+		for (int l = 0; l < btMultiBodyBatch::MAX_LANES; ++l) vectors[l] = lanes[l]->getBaseVel();
+		base.m_velBottom = btMbMul(base.m_rotFromParent, btMbGather(vectors));
+
+		for (int l = 0; l < btMultiBodyBatch::MAX_LANES; ++l) scalars[l] = lanes[l]->m_baseMass;
+		const btMbLanes mass = btMbGather(scalars);
+		for (int l = 0; l < btMultiBodyBatch::MAX_LANES; ++l) vectors[l] = lanes[l]->m_baseInertia;
+		const btMbVec3 inertia = btMbGather(vectors);
+
+		if (fixedBase)
+		{
+			btMbSetZero(base.m_zeroAccTop);
+			btMbSetZero(base.m_zeroAccBottom);
+		}
+		else
+		{
+			//external forces
+			for (int l = 0; l < btMultiBodyBatch::MAX_LANES; ++l) vectors[l] = lanes[l]->m_baseForce;
+			base.m_zeroAccTop = btMbNeg(btMbMul(base.m_rotFromParent, btMbGather(vectors)));
+			for (int l = 0; l < btMultiBodyBatch::MAX_LANES; ++l) vectors[l] = lanes[l]->m_baseTorque;
+			base.m_zeroAccBottom = btMbNeg(btMbMul(base.m_rotFromParent, btMbGather(vectors)));
+			btMbBiasForce(base.m_velTop, base.m_velBottom, mass, inertia, linearDamping, angularDamping, useGyroTerm, base.m_zeroAccTop, base.m_zeroAccBottom);
+		}
+		btMbSetRigidInertia(mass, inertia, base);
+	}
+
+	for (int i = 0; i < numLinks; ++i)
+	{
+		const btMultibodyLink& firstLink = first->m_links[i];
+		const btMbLinkLanes& parent = links[firstLink.m_parent + 1];
+		btMbLinkLanes& link = links[i + 1];
+		const bool hasDof = firstLink.m_dofCount > 0;
+
+		for (int l = 0; l < numBodies; ++l)
+		{
+			lanes[l]->m_matrixBuf[i + 1] = btMatrix3x3(lanes[l]->m_links[i].m_cachedRotParentToThis);
+		}
+		for (int l = 0; l < btMultiBodyBatch::MAX_LANES; ++l) matrices[l] = lanes[l]->m_matrixBuf[i + 1];
+		btMbGather(matrices, link.m_rotFromParent);
+		btMbMul(link.m_rotFromParent, parent.m_rotFromWorld, link.m_rotFromWorld);
+		for (int l = 0; l < btMultiBodyBatch::MAX_LANES; ++l) vectors[l] = lanes[l]->m_links[i].m_cachedRVector;
+		link.m_rVector = btMbGather(vectors);
+
+		// vhat_i = i_xhat_p(i) * vhat_p(i)
+		link.m_velTop = btMbMul(link.m_rotFromParent, parent.m_velTop);
+		link.m_velBottom = btMbSub(btMbMul(link.m_rotFromParent, parent.m_velBottom), btMbCross(link.m_rVector, link.m_velTop));
+
+		if (hasDof)
+		{
+			// vhat_i += qidot * shat_i, chat_i = vhat_i x (qidot * shat_i)
+			for (int l = 0; l < btMultiBodyBatch::MAX_LANES; ++l)
+			{
+				vectors[l] = lanes[l]->m_links[i].m_axes[0].m_topVec;
+				vectors2[l] = lanes[l]->m_links[i].m_axes[0].m_bottomVec;
+			}
+			link.m_axisTop = btMbGather(vectors);
+			link.m_axisBottom = btMbGather(vectors2);
+			for (int l = 0; l < btMultiBodyBatch::MAX_LANES; ++l) scalars[l] = lanes[l]->getJointVelMultiDof(i)[0];
+			const btMbLanes jointVel = btMbGather(scalars);
+			const btMbVec3 jointVelTop = btMbScale(link.m_axisTop, jointVel);
+			const btMbVec3 jointVelBottom = btMbScale(link.m_axisBottom, jointVel);
+			link.m_velTop = btMbAdd(link.m_velTop, jointVelTop);
+			link.m_velBottom = btMbAdd(link.m_velBottom, jointVelBottom);
+			link.m_coriolisTop = btMbCross(link.m_velTop, jointVelTop);
+			link.m_coriolisBottom = btMbAdd(btMbCross(link.m_velBottom, jointVelTop), btMbCross(link.m_velTop, jointVelBottom));
+		}
+		else
+		{
+			btMbSetZero(link.m_coriolisTop);
+			btMbSetZero(link.m_coriolisBottom);
+		}
+
+		// calculate zhat_i^A
+		for (int l = 0; l < btMultiBodyBatch::MAX_LANES; ++l) vectors[l] = lanes[l]->m_links[i].m_appliedForce;
+		link.m_zeroAccTop = btMbNeg(btMbMul(link.m_rotFromWorld, btMbGather(vectors)));
+		for (int l = 0; l < btMultiBodyBatch::MAX_LANES; ++l) vectors[l] = lanes[l]->m_links[i].m_appliedTorque;
+		link.m_zeroAccBottom = btMbNeg(btMbMul(link.m_rotFromWorld, btMbGather(vectors)));
+
+		for (int l = 0; l < btMultiBodyBatch::MAX_LANES; ++l) scalars[l] = lanes[l]->m_links[i].m_mass;
+		const btMbLanes mass = btMbGather(scalars);
+		for (int l = 0; l < btMultiBodyBatch::MAX_LANES; ++l) vectors[l] = lanes[l]->m_links[i].m_inertiaLocal;
+		const btMbVec3 inertia = btMbGather(vectors);
+		btMbBiasForce(link.m_velTop, link.m_velBottom, mass, inertia, linearDamping, angularDamping, useGyroTerm, link.m_zeroAccTop, link.m_zeroAccBottom);
+
+		// calculate Ihat_i^A
+		btMbSetRigidInertia(mass, inertia, link);
+	}
+
+	// 'Downward' loop.
+	btMbMat3 tmp, tmp2, rotated;
+	for (int i = numLinks - 1; i >= 0; --i)
+	{
+		const btMultibodyLink& firstLink = first->m_links[i];
+		btMbLinkLanes& parent = links[firstLink.m_parent + 1];
+		btMbLinkLanes& link = links[i + 1];
+		const bool hasDof = firstLink.m_dofCount > 0;
+
+		// Ihat_i^A * chat_i
+		btMbVec3 forceTop = btMbAdd(btMbMul(link.m_inertiaTopLeft, link.m_coriolisTop), btMbMul(link.m_inertiaTopRight, link.m_coriolisBottom));
+		btMbVec3 forceBottom = btMbAdd(btMbMul(link.m_inertiaBottomLeft, link.m_coriolisTop), btMbTransposeMul(link.m_inertiaTopLeft, link.m_coriolisBottom));
+		forceTop = btMbAdd(link.m_zeroAccTop, forceTop);
+		forceBottom = btMbAdd(link.m_zeroAccBottom, forceBottom);
+
+		// dyad = Ihat_i^A - h * D^{-1} * h^{T}
+		btMbMat3 dyadTopLeft = link.m_inertiaTopLeft;
+		btMbMat3 dyadTopRight = link.m_inertiaTopRight;
+		btMbMat3 dyadBottomLeft = link.m_inertiaBottomLeft;
+
+		if (hasDof)
+		{
+			for (int l = 0; l < btMultiBodyBatch::MAX_LANES; ++l) scalars[l] = lanes[l]->m_links[i].m_jointTorque[0];
+			const btMbLanes jointTorque = btMbGather(scalars);
+
+			link.m_hTop = btMbAdd(btMbMul(link.m_inertiaTopLeft, link.m_axisTop), btMbMul(link.m_inertiaTopRight, link.m_axisBottom));
+			link.m_hBottom = btMbAdd(btMbMul(link.m_inertiaBottomLeft, link.m_axisTop), btMbTransposeMul(link.m_inertiaTopLeft, link.m_axisBottom));
+
+			const btMbLanes sDotZ = btMbAdd(btMbDot(link.m_axisBottom, link.m_zeroAccTop), btMbDot(link.m_axisTop, link.m_zeroAccBottom));
+			const btMbLanes cDotH = btMbAdd(btMbDot(link.m_coriolisBottom, link.m_hTop), btMbDot(link.m_coriolisTop, link.m_hBottom));
+			link.m_Y = btMbSub(btMbSub(jointTorque, sDotZ), cDotH);
+
+			const btMbLanes D = btMbAdd(btMbDot(link.m_axisBottom, link.m_hTop), btMbDot(link.m_axisTop, link.m_hBottom));
+			link.m_invD = btMbInverseOrZero(D);
+
+			const btMbVec3 hInvDTop = btMbScale(link.m_hTop, link.m_invD);
+			const btMbVec3 hInvDBottom = btMbScale(link.m_hBottom, link.m_invD);
+			btMbSubOuter(link.m_hTop, hInvDBottom, dyadTopLeft);
+			btMbSubOuter(link.m_hTop, hInvDTop, dyadTopRight);
+			btMbSubOuter(link.m_hBottom, hInvDBottom, dyadBottomLeft);
+
+			const btMbLanes invDTimesY = btMbMul(link.m_invD, link.m_Y);
+			forceTop = btMbAdd(forceTop, btMbScale(link.m_hTop, invDTimesY));
+			forceBottom = btMbAdd(forceBottom, btMbScale(link.m_hBottom, invDTimesY));
+		}
+
+		// Ihat_p(i)^A += p(i)_xhat_i^T * dyad * i_xhat_p(i), see btSpatialTransformationMatrix::transformInverse
+		const btMbMat3& R = link.m_rotFromParent;
+		const btMbVec3& r = link.m_rVector;
+		btMbTransposeMulCross(dyadTopLeft, r, tmp2);
+		btMbMulCross(dyadTopRight, r, tmp);
+		for (int row = 0; row < 3; ++row)
+			for (int col = 0; col < 3; ++col)
+				dyadTopLeft.m[row][col] = btMbSub(dyadTopLeft.m[row][col], tmp.m[row][col]);
+		// dyadTopLeft now holds TL - TR * [r]x
+		btMbMul(dyadTopLeft, R, rotated);
+		btMbTransposeMulAdd(R, rotated, parent.m_inertiaTopLeft);
+		btMbMul(dyadTopRight, R, rotated);
+		btMbTransposeMulAdd(R, rotated, parent.m_inertiaTopRight);
+		btMbCrossMul(r, dyadTopLeft, tmp);
+		for (int row = 0; row < 3; ++row)
+			for (int col = 0; col < 3; ++col)
+				tmp.m[row][col] = btMbSub(btMbAdd(tmp.m[row][col], dyadBottomLeft.m[row][col]), tmp2.m[row][col]);
+		btMbMul(tmp, R, rotated);
+		btMbTransposeMulAdd(R, rotated, parent.m_inertiaBottomLeft);
+
+		// zhat_p(i)^A += p(i)_xhat_i^T * (zhat_i^A + Ihat_i^A * chat_i + h * D^{-1} * Y)
+		parent.m_zeroAccTop = btMbAdd(parent.m_zeroAccTop, btMbTransposeMul(R, forceTop));
+		parent.m_zeroAccBottom = btMbAdd(parent.m_zeroAccBottom, btMbTransposeMul(R, btMbAdd(forceBottom, btMbCross(r, forceTop))));
+	}
+
+	// the base acceleration, the inverse of the base inertia is computed per multibody
+	btMbLinkLanes& base = links[0];
+	if (fixedBase)
+	{
+		btMbSetZero(base.m_accTop);
+		btMbSetZero(base.m_accBottom);
+	}
+	else
+	{
+		btVector3 zeroAccTop[btMultiBodyBatch::MAX_LANES], zeroAccBottom[btMultiBodyBatch::MAX_LANES];
+		btMatrix3x3 topLeft[btMultiBodyBatch::MAX_LANES], topRight[btMultiBodyBatch::MAX_LANES], bottomLeft[btMultiBodyBatch::MAX_LANES];
+		btMbScatter(base.m_zeroAccTop, zeroAccTop);
+		btMbScatter(base.m_zeroAccBottom, zeroAccBottom);
+		btMbScatter(base.m_inertiaTopLeft, topLeft);
+		btMbScatter(base.m_inertiaTopRight, topRight);
+		btMbScatter(base.m_inertiaBottomLeft, bottomLeft);
+		for (int l = 0; l < btMultiBodyBatch::MAX_LANES; ++l)
+		{
+			btMultiBody* body = lanes[l];
+			if (numLinks > 0 && l < numBodies)
+			{
+				body->m_cachedInertiaValid = true;
+				body->m_cachedInertiaTopLeft = topLeft[l];
+				body->m_cachedInertiaTopRight = topRight[l];
+				body->m_cachedInertiaLowerLeft = bottomLeft[l];
+				body->m_cachedInertiaLowerRight = topLeft[l].transpose();
+			}
+			btSpatialForceVector rhs;
+			rhs.m_topVec = zeroAccTop[l];
+			rhs.m_bottomVec = zeroAccBottom[l];
+			btSpatialMotionVector result;
+			body->solveImatrix(rhs, result);
+			vectors[l] = -result.m_topVec;
+			vectors2[l] = -result.m_bottomVec;
+		}
+		base.m_accTop = btMbGather(vectors);
+		base.m_accBottom = btMbGather(vectors2);
+	}
+
+	// Second 'upward' loop
+	for (int i = 0; i < numLinks; ++i)
+	{
+		const btMultibodyLink& firstLink = first->m_links[i];
+		const btMbLinkLanes& parent = links[firstLink.m_parent + 1];
+		btMbLinkLanes& link = links[i + 1];
+
+		link.m_accTop = btMbMul(link.m_rotFromParent, parent.m_accTop);
+		link.m_accBottom = btMbSub(btMbMul(link.m_rotFromParent, parent.m_accBottom), btMbCross(link.m_rVector, link.m_accTop));
+
+		if (firstLink.m_dofCount > 0)
+		{
+			//	qdd = D^{-1} * (Y - h^{T}*apar), a = apar + cor + Sqdd
+			const btMbLanes hDotA = btMbAdd(btMbDot(link.m_accBottom, link.m_hTop), btMbDot(link.m_accTop, link.m_hBottom));
+			link.m_Y = btMbMul(link.m_invD, btMbSub(link.m_Y, hDotA));
+			link.m_accTop = btMbAdd(btMbAdd(link.m_accTop, link.m_coriolisTop), btMbScale(link.m_axisTop, link.m_Y));
+			link.m_accBottom = btMbAdd(btMbAdd(link.m_accBottom, link.m_coriolisBottom), btMbScale(link.m_axisBottom, link.m_Y));
+		}
+		else
+		{
+			link.m_accTop = btMbAdd(link.m_accTop, link.m_coriolisTop);
+			link.m_accBottom = btMbAdd(link.m_accBottom, link.m_coriolisBottom);
+		}
+	}
+
+	// transform base accelerations back to the world frame.
+	btVector3 omegadot[btMultiBodyBatch::MAX_LANES], vdot[btMultiBodyBatch::MAX_LANES];
+	btMbScatter(btMbTransposeMul(base.m_rotFromParent, base.m_accTop), omegadot);
+	btMbScatter(btMbTransposeMul(base.m_rotFromParent, btMbAdd(base.m_accBottom, btMbCross(base.m_velTop, base.m_velBottom))), vdot);
+
+	// write the cached h and D^{-1} that calcAccelerationDeltasMultiDof uses, and the outputs
+	const int outputSize = 6 + numDofs;
+	scratch.m_output.resize(btMultiBodyBatch::MAX_LANES * outputSize);
+	btScalar* accelerations = &scratch.m_output[0];
+	for (int l = 0; l < numBodies; ++l)
+	{
+		btScalar* laneOutput = accelerations + l * outputSize;
+		laneOutput[0] = omegadot[l][0];
+		laneOutput[1] = omegadot[l][1];
+		laneOutput[2] = omegadot[l][2];
+		laneOutput[3] = vdot[l][0];
+		laneOutput[4] = vdot[l][1];
+		laneOutput[5] = vdot[l][2];
+	}
+	for (int i = 0; i < numLinks; ++i)
+	{
+		const btMultibodyLink& firstLink = first->m_links[i];
+		if (firstLink.m_dofCount == 0)
+			continue;
+		const btMbLinkLanes& link = links[i + 1];
+		const int dofOffset = firstLink.m_dofOffset;
+		btScalar jointAccel[btMultiBodyBatch::MAX_LANES];
+		btMbScatter(link.m_hTop, vectors);
+		btMbScatter(link.m_hBottom, vectors2);
+		btMbScatter(link.m_invD, scalars);
+		btMbScatter(link.m_Y, jointAccel);
+		for (int l = 0; l < numBodies; ++l)
+		{
+			btMultiBody* body = lanes[l];
+			btSpatialForceVector* h = (btSpatialForceVector*)&body->m_vectorBuf[0];
+			h[dofOffset].m_topVec = vectors[l];
+			h[dofOffset].m_bottomVec = vectors2[l];
+			body->m_realBuf[6 + numDofs + dofOffset * dofOffset] = scalars[l];
+			accelerations[l * outputSize + 6 + dofOffset] = jointAccel[l];
+		}
+	}
+
+	// Final step: add the accelerations (times dt) to the velocities.
+	if (dt > 0.)
+	{
+		for (int l = 0; l < numBodies; ++l)
+		{
+			lanes[l]->applyDeltaVeeMultiDof(accelerations + l * outputSize, dt);
+		}
+	}
+}
+
+struct btMultiBodyBatchLoop : public btIParallelForBody
+{
+	btMultiBody* const* m_bodies;
+	const btMultiBodyBatch::Batch* m_batches;
+	btScalar m_timeStep;
+
+	btMultiBodyBatchLoop(btMultiBody* const* bodies, const btMultiBodyBatch::Batch* batches, btScalar timeStep)
+		: m_bodies(bodies), m_batches(batches), m_timeStep(timeStep)
+	{
+	}
+
+	void forLoop(int iBegin, int iEnd) const
+	{
+		btMultiBodyBatchScratch scratch;
+		for (int i = iBegin; i < iEnd; ++i)
+		{
+			const btMultiBodyBatch::Batch& batch = m_batches[i];
+			btMultiBodyBatch::computeBatchAccelerations(m_bodies + batch.m_firstBody, batch.m_numBodies, m_timeStep, scratch);
+		}
+	}
+};
+
+struct btMultiBodyBatchSortPredicate
+{
+	bool operator()(const btMultiBodyBatch::SortKey& a, const btMultiBodyBatch::SortKey& b) const
+	{
+		if (a.m_hash != b.m_hash)
+			return a.m_hash < b.m_hash;
+		return a.m_index < b.m_index;
+	}
+};
+
+btMultiBodyBatch::btMultiBodyBatch()
+	: m_numGroups(0)
+{
+}
+
+btMultiBodyBatch::~btMultiBodyBatch()
+{
+}
+
+bool btMultiBodyBatch::isSupported(const btMultiBody* body)
+{
+	if (body->isUsingRK4Integration() || body->isUsingGlobalVelocities() || body->isBaseKinematic())
+		return false;
+	for (int i = 0; i < body->getNumLinks(); ++i)
+	{
+		const btMultibodyLink& link = body->getLink(i);
+		if (link.m_jointFeedback || body->isLinkKinematic(i))
+			return false;
+		if (link.m_jointType != btMultibodyLink::eRevolute && link.m_jointType != btMultibodyLink::ePrismatic && link.m_jointType != btMultibodyLink::eFixed)
+			return false;
+	}
+	return true;
+}
+
+unsigned int btMultiBodyBatch::getTopologyHash(const btMultiBody* body)
+{
+	// FNV-1a
+	unsigned int hash = 2166136261u;
+	hash = (hash ^ unsigned(body->getNumLinks())) * 16777619u;
+	hash = (hash ^ unsigned(body->hasFixedBase())) * 16777619u;
+	hash = (hash ^ unsigned(body->getUseGyroTerm())) * 16777619u;
+	for (int i = 0; i < body->getNumLinks(); ++i)
+	{
+		const btMultibodyLink& link = body->getLink(i);
+		hash = (hash ^ unsigned(link.m_parent + 1)) * 16777619u;
+		hash = (hash ^ unsigned(link.m_dofCount)) * 16777619u;
+	}
+	return hash;
+}
+
+bool btMultiBodyBatch::isSameTopology(const btMultiBody* bodyA, const btMultiBody* bodyB)
+{
+	if (bodyA->getNumLinks() != bodyB->getNumLinks() || bodyA->hasFixedBase() != bodyB->hasFixedBase() || bodyA->getUseGyroTerm() != bodyB->getUseGyroTerm())
+		return false;
+	for (int i = 0; i < bodyA->getNumLinks(); ++i)
+	{
+		const btMultibodyLink& linkA = bodyA->getLink(i);
+		const btMultibodyLink& linkB = bodyB->getLink(i);
+		if (linkA.m_parent != linkB.m_parent || linkA.m_dofCount != linkB.m_dofCount)
+			return false;
+	}
+	return true;
+}
+
+void btMultiBodyBatch::computeAccelerations(btMultiBody** bodies, int numBodies, btScalar dt)
+{
+	BT_PROFILE("btMultiBodyBatch::computeAccelerations");
+	m_keys.resize(numBodies);
+	for (int i = 0; i < numBodies; ++i)
+	{
+		btAssert(isSupported(bodies[i]));
+		m_keys[i].m_hash = getTopologyHash(bodies[i]);
+		m_keys[i].m_index = i;
+	}
+	m_keys.quickSort(btMultiBodyBatchSortPredicate());
+
+	m_sortedBodies.resize(numBodies);
+	for (int i = 0; i < numBodies; ++i)
+	{
+		m_sortedBodies[i] = bodies[m_keys[i].m_index];
+	}
+
+	// split the groups of the same topology into batches of up to MAX_LANES multibodies
+	m_batches.resize(0);
+	m_numGroups = 0;
+	int groupStart = 0;
+	while (groupStart < numBodies)
+	{
+		int groupEnd = groupStart + 1;
+		while (groupEnd < numBodies && isSameTopology(m_sortedBodies[groupStart], m_sortedBodies[groupEnd]))
+		{
+			++groupEnd;
+		}
+		for (int first = groupStart; first < groupEnd; first += MAX_LANES)
+		{
+			Batch batch;
+			batch.m_firstBody = first;
+			batch.m_numBodies = btMin(int(MAX_LANES), groupEnd - first);
+			m_batches.push_back(batch);
+		}
+		++m_numGroups;
+		groupStart = groupEnd;
+	}
+
+	if (m_batches.size())
+	{
+		btMultiBodyBatchLoop loop(&m_sortedBodies[0], &m_batches[0], dt);
+#if BT_THREADSAFE
+		btITaskScheduler* scheduler = btGetTaskScheduler();
+		if (scheduler && scheduler->getNumThreads() > 1)
+		{
+			btParallelFor(0, m_batches.size(), 8, loop);
+			return;
+		}
+#endif  // #if BT_THREADSAFE
+		loop.forLoop(0, m_batches.size());
+	}
+}
@@ -0,0 +1,89 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2013 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef BT_MULTIBODY_BATCH_H
+#define BT_MULTIBODY_BATCH_H
+
+#include "LinearMath/btAlignedObjectArray.h"
+#include "LinearMath/btScalar.h"
+
+class btMultiBody;
+struct btMultiBodyBatchScratch;
+
+///btMultiBodyBatch runs the velocity step of btMultiBody::computeAccelerationsArticulatedBodyAlgorithmMultiDof for
+///many multibodies at once. Multibodies with the same topology, the same parents and number of degrees of freedom of
+///every link and the same kind of base, are grouped, and the articulated body algorithm of up to MAX_LANES of them
+///runs together, one multibody per SIMD lane, with the link states stored per link across the lanes.
+///The lanes of a group may differ in everything else: masses, inertias, joint axes, offsets, damping and state.
+///The groups are distributed over the threads of the task scheduler with btParallelFor.
+///
+///Only revolute, prismatic and fixed joints are batched, and only multibodies that use neither RK4 integration, global
+///velocities, joint feedback nor a kinematic base, see isSupported. The results are the same as the scalar algorithm
+///up to rounding, and do not depend on the number of threads or on which multibodies share a batch.
+class btMultiBodyBatch
+{
+public:
+	enum
+	{
+		MAX_LANES = 4
+	};
+
+	btMultiBodyBatch();
+
+	virtual ~btMultiBodyBatch();
+
+	static bool isSupported(const btMultiBody* body);
+
+	///Adds the accelerations due to the applied forces, times dt, to the velocities of the bodies, like
+	///computeAccelerationsArticulatedBodyAlgorithmMultiDof(dt, ..., false, ...) does for each of them.
+	///All bodies must be supported.
+	void computeAccelerations(btMultiBody** bodies, int numBodies, btScalar dt);
+
+	///number of topology groups and batches of the last computeAccelerations
+	int getNumGroups() const
+	{
+		return m_numGroups;
+	}
+	int getNumBatches() const
+	{
+		return m_batches.size();
+	}
+
+	struct Batch
+	{
+		int m_firstBody;  // index into m_sortedBodies
+		int m_numBodies;
+	};
+
+	struct SortKey
+	{
+		unsigned int m_hash;
+		int m_index;
+	};
+
+private:
+	btAlignedObjectArray<SortKey> m_keys;
+	btAlignedObjectArray<btMultiBody*> m_sortedBodies;
+	btAlignedObjectArray<Batch> m_batches;
+	int m_numGroups;
+
+	static unsigned int getTopologyHash(const btMultiBody* body);
+	static bool isSameTopology(const btMultiBody* bodyA, const btMultiBody* bodyB);
+	static void computeBatchAccelerations(btMultiBody* const* bodies, int numBodies, btScalar dt, btMultiBodyBatchScratch& scratch);
+
+	friend struct btMultiBodyBatchLoop;
+};
+
+#endif  //BT_MULTIBODY_BATCH_H
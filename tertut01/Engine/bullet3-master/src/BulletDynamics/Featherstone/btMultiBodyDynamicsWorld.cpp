@@ -23,6 +23,20 @@ subject to the following restrictions:
 #include "LinearMath/btIDebugDraw.h"
 #include "LinearMath/btSerializer.h"
 
+static bool isMultiBodySleeping(const btMultiBody* bod)
+{
+	if (bod->getBaseCollider() && bod->getBaseCollider()->getActivationState() == ISLAND_SLEEPING)
+	{
+		return true;
+	}
+	for (int b = 0; b < bod->getNumLinks(); b++)
+	{
+		if (bod->getLink(b).m_collider && bod->getLink(b).m_collider->getActivationState() == ISLAND_SLEEPING)
+			return true;
+	}
+	return false;
+}
+
 void btMultiBodyDynamicsWorld::addMultiBody(btMultiBody* body, int group, int mask)
 {
 	m_multiBodies.push_back(body);
@@ -183,7 +197,8 @@ void btMultiBodyDynamicsWorld::getAnalyticsData(btAlignedObjectArray<btSolverAna
 
 btMultiBodyDynamicsWorld::btMultiBodyDynamicsWorld(btDispatcher* dispatcher, btBroadphaseInterface* pairCache, btMultiBodyConstraintSolver* constraintSolver, btCollisionConfiguration* collisionConfiguration)
 	: btDiscreteDynamicsWorld(dispatcher, pairCache, constraintSolver, collisionConfiguration),
-	  m_multiBodyConstraintSolver(constraintSolver)
+	  m_multiBodyConstraintSolver(constraintSolver),
+	  m_useBatchedArticulations(false)
 {
 	//split impulse is not yet supported for Featherstone hierarchies
 	//	getSolverInfo().m_splitImpulse = false;
@@ -353,21 +368,23 @@ void btMultiBodyDynamicsWorld::solveExternalForces(btContactSolverInfo& solverIn
     
     {
         BT_PROFILE("btMultiBody stepVelocities");
+        if (m_useBatchedArticulations)
+        {
+            m_batchedMultiBodies.resize(0);
+            for (int i = 0; i < this->m_multiBodies.size(); i++)
+            {
+                btMultiBody* bod = m_multiBodies[i];
+                if (!isMultiBodySleeping(bod) && btMultiBodyBatch::isSupported(bod))
+                    m_batchedMultiBodies.push_back(bod);
+            }
+            if (m_batchedMultiBodies.size())
+                m_articulationBatch.computeAccelerations(&m_batchedMultiBodies[0], m_batchedMultiBodies.size(), solverInfo.m_timeStep);
+        }
         for (int i = 0; i < this->m_multiBodies.size(); i++)
         {
             btMultiBody* bod = m_multiBodies[i];
             
-            bool isSleeping = false;
-            
-            if (bod->getBaseCollider() && bod->getBaseCollider()->getActivationState() == ISLAND_SLEEPING)
-            {
-                isSleeping = true;
-            }
-            for (int b = 0; b < bod->getNumLinks(); b++)
-            {
-                if (bod->getLink(b).m_collider && bod->getLink(b).m_collider->getActivationState() == ISLAND_SLEEPING)
-                    isSleeping = true;
-            }
+            bool isSleeping = isMultiBodySleeping(bod);
             
             if (!isSleeping)
             {
@@ -377,6 +394,11 @@ void btMultiBodyDynamicsWorld::solveExternalForces(btContactSolverInfo& solverIn
                 m_scratch_m.resize(bod->getNumLinks() + 1);
                 bool doNotUpdatePos = false;
                 bool isConstraintPass = false;
+                if (m_useBatchedArticulations && btMultiBodyBatch::isSupported(bod))
+                {
+                    //already stepped by m_articulationBatch
+                }
+                else
                 {
                     if (!bod->isUsingRK4Integration())
                     {
@@ -18,6 +18,7 @@ subject to the following restrictions:
 
 #include "BulletDynamics/Dynamics/btDiscreteDynamicsWorld.h"
 #include "BulletDynamics/Featherstone/btMultiBodyInplaceSolverIslandCallback.h"
+#include "BulletDynamics/Featherstone/btMultiBodyBatch.h"
 
 #define BT_USE_VIRTUAL_CLEARFORCES_AND_GRAVITY
 
@@ -46,6 +47,10 @@ protected:
 	btAlignedObjectArray<btVector3> m_scratch_v;
 	btAlignedObjectArray<btMatrix3x3> m_scratch_m;
 
+	btMultiBodyBatch m_articulationBatch;
+	btAlignedObjectArray<btMultiBody*> m_batchedMultiBodies;
+	bool m_useBatchedArticulations;
+
 	virtual void calculateSimulationIslands();
 	virtual void updateActivationState(btScalar timeStep);
 	
@@ -122,5 +127,20 @@ public:
     void buildIslands();
 
 	virtual void saveKinematicState(btScalar timeStep);
+
+	///If enabled, the velocities of the awake multibodies that btMultiBodyBatch::isSupported are stepped together by
+	///btMultiBodyBatch, several multibodies of the same topology per SIMD operation. Disabled by default.
+	void setUseBatchedArticulations(bool useBatched)
+	{
+		m_useBatchedArticulations = useBatched;
+	}
+	bool getUseBatchedArticulations() const
+	{
+		return m_useBatchedArticulations;
+	}
+	const btMultiBodyBatch& getArticulationBatch() const
+	{
+		return m_articulationBatch;
+	}
 };
 #endif  //BT_MULTIBODY_DYNAMICS_WORLD_H
@@ -86,9 +86,9 @@ public:
 			btScalar beta = r_dot_Ar_new / r_dot_Ar;
 			r_dot_Ar = r_dot_Ar_new;
 			// p = beta*p + r;
-			p = this->multAndAdd(beta, p, r);
+			this->multSelfAndAdd(beta, p, r);
 			// temp_p = beta*temp_p + temp_r;
-			temp_p = this->multAndAdd(beta, temp_p, temp_r);
+			this->multSelfAndAdd(beta, temp_p, temp_r);
 		}
 		if (verbose)
 		{
@@ -0,0 +1,608 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2006 Erwin Coumans  https://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "btDefaultSoftBodySolverMt.h"
+#include "btSoftBodyInternals.h"
+#include "BulletCollision/BroadphaseCollision/btBroadphaseInterface.h"
+#include "LinearMath/btQuickprof.h"
+
+// btParallelFor asserts without BT_THREADSAFE, run the loops on the calling thread then
+static void btSoftBodySolverParallelFor(int count, int grainSize, const btIParallelForBody& body)
+{
+#if BT_THREADSAFE
+	btITaskScheduler* scheduler = btGetTaskScheduler();
+	if (scheduler && scheduler->getNumThreads() > 1)
+	{
+		btParallelFor(0, count, grainSize, body);
+		return;
+	}
+#endif  // #if BT_THREADSAFE
+	body.forLoop(0, count);
+}
+
+struct btSoftBodyPredictLoop : public btIParallelForBody
+{
+	btSoftBody* const* m_bodies;
+	btScalar m_timeStep;
+
+	void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
+	{
+		for (int i = iBegin; i < iEnd; ++i)
+		{
+			m_bodies[i]->predictMotion(m_timeStep);
+		}
+	}
+};
+
+struct btSoftBodySolveLoop : public btIParallelForBody
+{
+	btSoftBody* const* m_bodies;
+
+	void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
+	{
+		for (int i = iBegin; i < iEnd; ++i)
+		{
+			m_bodies[i]->solveConstraints();
+		}
+	}
+};
+
+struct btSoftBodyIntegrateLoop : public btIParallelForBody
+{
+	btSoftBody* const* m_bodies;
+
+	void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
+	{
+		for (int i = iBegin; i < iEnd; ++i)
+		{
+			m_bodies[i]->integrateMotion();
+		}
+	}
+};
+
+struct btSoftBodyGatherNodesLoop : public btIParallelForBody
+{
+	const btSoftBody::Node* m_nodes;
+	btVector3* m_state;
+	btScalar* m_invMasses;
+	bool m_velocities;
+
+	void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
+	{
+		for (int i = iBegin; i < iEnd; ++i)
+		{
+			const btSoftBody::Node& n = m_nodes[i];
+			m_state[i] = m_velocities ? n.m_v : n.m_x;
+			m_invMasses[i] = n.m_im;
+		}
+	}
+};
+
+struct btSoftBodyScatterNodesLoop : public btIParallelForBody
+{
+	btSoftBody::Node* m_nodes;
+	const btVector3* m_state;
+	bool m_velocities;
+
+	void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
+	{
+		for (int i = iBegin; i < iEnd; ++i)
+		{
+			btSoftBody::Node& n = m_nodes[i];
+			(m_velocities ? n.m_v : n.m_x) = m_state[i];
+		}
+	}
+};
+
+// same arithmetic as btSoftBody::PSolve_Links, on the links of one batch
+struct btSoftBodyLinkPositionLoop : public btIParallelForBody
+{
+	const btDefaultSoftBodySolverMt::PackedLink* m_links;
+	btVector3* m_x;
+	const btScalar* m_im;
+	btScalar m_kst;
+
+	void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
+	{
+		for (int i = iBegin; i < iEnd; ++i)
+		{
+			const btDefaultSoftBodySolverMt::PackedLink& l = m_links[i];
+			if (l.m_c0 > 0)
+			{
+				btVector3& a = m_x[l.m_node0];
+				btVector3& b = m_x[l.m_node1];
+				const btVector3 del = b - a;
+				const btScalar len = del.length2();
+				if (l.m_c1 + len > SIMD_EPSILON)
+				{
+					const btScalar k = ((l.m_c1 - len) / (l.m_c0 * (l.m_c1 + len))) * m_kst;
+					a -= del * (k * m_im[l.m_node0]);
+					b += del * (k * m_im[l.m_node1]);
+				}
+			}
+		}
+	}
+};
+
+// same arithmetic as btSoftBody::VSolve_Links, on the links of one batch
+struct btSoftBodyLinkVelocityLoop : public btIParallelForBody
+{
+	const btDefaultSoftBodySolverMt::PackedLink* m_links;
+	const btVector3* m_gradients;
+	const btScalar* m_gradientScales;
+	btVector3* m_v;
+	const btScalar* m_im;
+	btScalar m_kst;
+
+	void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
+	{
+		for (int i = iBegin; i < iEnd; ++i)
+		{
+			const btDefaultSoftBodySolverMt::PackedLink& l = m_links[i];
+			const btVector3& c3 = m_gradients[i];
+			btVector3& va = m_v[l.m_node0];
+			btVector3& vb = m_v[l.m_node1];
+			const btScalar j = -btDot(c3, va - vb) * m_gradientScales[i] * m_kst;
+			va += c3 * (j * m_im[l.m_node0]);
+			vb -= c3 * (j * m_im[l.m_node1]);
+		}
+	}
+};
+
+btDefaultSoftBodySolverMt::btDefaultSoftBodySolverMt()
+	: m_minBatchedLinks(1024),
+	  m_linkGrainSize(256)
+{
+}
+
+btDefaultSoftBodySolverMt::~btDefaultSoftBodySolverMt()
+{
+}
+
+void btDefaultSoftBodySolverMt::optimize(btAlignedObjectArray<btSoftBody*>& softBodies, bool forceUpdate)
+{
+	btDefaultSoftBodySolver::optimize(softBodies, forceUpdate);
+	m_linkBatches.resize(m_softBodySet.size());
+	if (forceUpdate)
+	{
+		for (int i = 0; i < m_linkBatches.size(); ++i)
+		{
+			m_linkBatches[i].m_body = NULL;
+		}
+	}
+}
+
+bool btDefaultSoftBodySolverMt::isIndependent(const btSoftBody* psb) const
+{
+	if (psb->m_anchors.size() || psb->m_scontacts.size())
+	{
+		return false;
+	}
+	for (int i = 0; i < psb->m_rcontacts.size(); ++i)
+	{
+		const btCollisionObject* colObj = psb->m_rcontacts[i].m_cti.m_colObj;
+		if (!colObj->hasContactResponse())
+		{
+			continue;
+		}
+		if (colObj->getInternalType() == btCollisionObject::CO_RIGID_BODY)
+		{
+			// static and kinematic bodies ignore the impulses
+			const btRigidBody* body = btRigidBody::upcast(colObj);
+			if (body && body->getInvMass() != btScalar(0.))
+			{
+				return false;
+			}
+		}
+		else if (colObj->getInternalType() == btCollisionObject::CO_FEATHERSTONE_LINK)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+btDefaultSoftBodySolverMt::LinkBatches& btDefaultSoftBodySolverMt::updateLinkBatches(int bodyIndex)
+{
+	const btSoftBody* psb = m_softBodySet[bodyIndex];
+	LinkBatches& batches = m_linkBatches[bodyIndex];
+	const int numNodes = psb->m_nodes.size();
+	const int numLinks = psb->m_links.size();
+	const btSoftBody::Node* nodes = numNodes ? &psb->m_nodes[0] : NULL;
+	const btSoftBody::Link* links = numLinks ? &psb->m_links[0] : NULL;
+	if (batches.m_body == psb && batches.m_nodes == nodes && batches.m_links == links &&
+		batches.m_numNodes == numNodes && batches.m_numLinks == numLinks)
+	{
+		return batches;
+	}
+	BT_PROFILE("updateLinkBatches");
+	batches.m_body = psb;
+	batches.m_nodes = nodes;
+	batches.m_links = links;
+	batches.m_numNodes = numNodes;
+	batches.m_numLinks = numLinks;
+
+	// greedy colouring in link order, a link takes the first colour that none of its nodes has yet
+	const int maxColors = 64;
+	btAlignedObjectArray<unsigned long long> nodeColors;
+	nodeColors.resize(numNodes, 0);
+	btAlignedObjectArray<int> linkColors;
+	linkColors.resizeNoInitialize(numLinks);
+	btAlignedObjectArray<int> colorCounts;
+	colorCounts.resize(maxColors + 1, 0);
+	int numColors = 0;
+	for (int i = 0; i < numLinks; ++i)
+	{
+		const int n0 = int(links[i].m_n[0] - nodes);
+		const int n1 = int(links[i].m_n[1] - nodes);
+		const unsigned long long used = nodeColors[n0] | nodeColors[n1];
+		int color = 0;
+		while (color < maxColors && (used & (1ULL << color)))
+		{
+			color++;
+		}
+		if (color < maxColors)
+		{
+			nodeColors[n0] |= 1ULL << color;
+			nodeColors[n1] |= 1ULL << color;
+			numColors = btMax(numColors, color + 1);
+		}
+		linkColors[i] = color;
+		colorCounts[color]++;
+	}
+	batches.m_numParallelBatches = numColors;
+	const int numBatches = numColors + (colorCounts[maxColors] ? 1 : 0);
+	batches.m_batchOffsets.resizeNoInitialize(numBatches + 1);
+	int offset = 0;
+	for (int c = 0; c < numBatches; ++c)
+	{
+		batches.m_batchOffsets[c] = offset;
+		offset += colorCounts[c < numColors ? c : maxColors];
+	}
+	batches.m_batchOffsets[numBatches] = offset;
+
+	btAlignedObjectArray<int> cursors;
+	cursors.resizeNoInitialize(maxColors + 1);
+	for (int c = 0; c < numBatches; ++c)
+	{
+		cursors[c < numColors ? c : maxColors] = batches.m_batchOffsets[c];
+	}
+	batches.m_linkSlots.resizeNoInitialize(numLinks);
+	batches.m_packedLinks.resizeNoInitialize(numLinks);
+	for (int i = 0; i < numLinks; ++i)
+	{
+		const int slot = cursors[linkColors[i]]++;
+		batches.m_linkSlots[i] = slot;
+		PackedLink& packed = batches.m_packedLinks[slot];
+		packed.m_node0 = int(links[i].m_n[0] - nodes);
+		packed.m_node1 = int(links[i].m_n[1] - nodes);
+	}
+	batches.m_gradients.resizeNoInitialize(numLinks);
+	batches.m_gradientScales.resizeNoInitialize(numLinks);
+	batches.m_nodeState.resizeNoInitialize(numNodes);
+	batches.m_invMasses.resizeNoInitialize(numNodes);
+	return batches;
+}
+
+void btDefaultSoftBodySolverMt::solveLinkPositions(btSoftBody* psb, LinkBatches& batches, btScalar kst)
+{
+	BT_PROFILE("PSolve_LinksMt");
+	const int numNodes = psb->m_nodes.size();
+	if (batches.m_packedLinks.size() == 0)
+	{
+		return;
+	}
+	btSoftBodyGatherNodesLoop gather;
+	gather.m_nodes = &psb->m_nodes[0];
+	gather.m_state = &batches.m_nodeState[0];
+	gather.m_invMasses = &batches.m_invMasses[0];
+	gather.m_velocities = false;
+	btSoftBodySolverParallelFor(numNodes, m_linkGrainSize, gather);
+
+	btSoftBodyLinkPositionLoop loop;
+	loop.m_x = &batches.m_nodeState[0];
+	loop.m_im = &batches.m_invMasses[0];
+	loop.m_kst = kst;
+	for (int b = 0; b < batches.m_batchOffsets.size() - 1; ++b)
+	{
+		const int begin = batches.m_batchOffsets[b];
+		loop.m_links = &batches.m_packedLinks[begin];
+		const int count = batches.m_batchOffsets[b + 1] - begin;
+		if (b < batches.m_numParallelBatches)
+		{
+			btSoftBodySolverParallelFor(count, m_linkGrainSize, loop);
+		}
+		else
+		{
+			loop.forLoop(0, count);
+		}
+	}
+
+	btSoftBodyScatterNodesLoop scatter;
+	scatter.m_nodes = &psb->m_nodes[0];
+	scatter.m_state = &batches.m_nodeState[0];
+	scatter.m_velocities = false;
+	btSoftBodySolverParallelFor(numNodes, m_linkGrainSize, scatter);
+}
+
+void btDefaultSoftBodySolverMt::solveLinkVelocities(btSoftBody* psb, LinkBatches& batches, btScalar kst)
+{
+	BT_PROFILE("VSolve_LinksMt");
+	const int numNodes = psb->m_nodes.size();
+	if (batches.m_packedLinks.size() == 0)
+	{
+		return;
+	}
+	btSoftBodyGatherNodesLoop gather;
+	gather.m_nodes = &psb->m_nodes[0];
+	gather.m_state = &batches.m_nodeState[0];
+	gather.m_invMasses = &batches.m_invMasses[0];
+	gather.m_velocities = true;
+	btSoftBodySolverParallelFor(numNodes, m_linkGrainSize, gather);
+
+	btSoftBodyLinkVelocityLoop loop;
+	loop.m_v = &batches.m_nodeState[0];
+	loop.m_im = &batches.m_invMasses[0];
+	loop.m_kst = kst;
+	for (int b = 0; b < batches.m_batchOffsets.size() - 1; ++b)
+	{
+		const int begin = batches.m_batchOffsets[b];
+		loop.m_links = &batches.m_packedLinks[begin];
+		loop.m_gradients = &batches.m_gradients[begin];
+		loop.m_gradientScales = &batches.m_gradientScales[begin];
+		const int count = batches.m_batchOffsets[b + 1] - begin;
+		if (b < batches.m_numParallelBatches)
+		{
+			btSoftBodySolverParallelFor(count, m_linkGrainSize, loop);
+		}
+		else
+		{
+			loop.forLoop(0, count);
+		}
+	}
+
+	btSoftBodyScatterNodesLoop scatter;
+	scatter.m_nodes = &psb->m_nodes[0];
+	scatter.m_state = &batches.m_nodeState[0];
+	scatter.m_velocities = true;
+	btSoftBodySolverParallelFor(numNodes, m_linkGrainSize, scatter);
+}
+
+// btSoftBody::solveConstraints with the link solvers replaced by the batched ones
+void btDefaultSoftBodySolverMt::solveConstraintsBatched(btSoftBody* psb, LinkBatches& batches)
+{
+	BT_PROFILE("solveConstraintsBatched");
+	/* Apply clusters		*/
+	psb->applyClusters(false);
+	/* Prepare links		*/
+	int i, ni;
+	for (i = 0, ni = psb->m_links.size(); i < ni; ++i)
+	{
+		btSoftBody::Link& l = psb->m_links[i];
+		l.m_c3 = l.m_n[1]->m_q - l.m_n[0]->m_q;
+		l.m_c2 = 1 / (l.m_c3.length2() * l.m_c0);
+		const int slot = batches.m_linkSlots[i];
+		PackedLink& packed = batches.m_packedLinks[slot];
+		packed.m_c0 = l.m_c0;
+		packed.m_c1 = l.m_c1;
+		batches.m_gradients[slot] = l.m_c3;
+		batches.m_gradientScales[slot] = l.m_c2;
+	}
+	/* Prepare anchors		*/
+	for (i = 0, ni = psb->m_anchors.size(); i < ni; ++i)
+	{
+		btSoftBody::Anchor& a = psb->m_anchors[i];
+		const btVector3 ra = a.m_body->getWorldTransform().getBasis() * a.m_local;
+		a.m_c0 = ImpulseMatrix(psb->m_sst.sdt,
+							   a.m_node->m_im,
+							   a.m_body->getInvMass(),
+							   a.m_body->getInvInertiaTensorWorld(),
+							   ra);
+		a.m_c1 = ra;
+		a.m_c2 = psb->m_sst.sdt * a.m_node->m_im;
+		a.m_body->activate();
+	}
+	/* Solve velocities		*/
+	const btSoftBody::Config& cfg = psb->m_cfg;
+	if (cfg.viterations > 0)
+	{
+		for (int isolve = 0; isolve < cfg.viterations; ++isolve)
+		{
+			for (int iseq = 0; iseq < cfg.m_vsequence.size(); ++iseq)
+			{
+				if (cfg.m_vsequence[iseq] == btSoftBody::eVSolver::Linear)
+				{
+					solveLinkVelocities(psb, batches, 1);
+				}
+				else
+				{
+					btSoftBody::getSolver(cfg.m_vsequence[iseq])(psb, 1);
+				}
+			}
+		}
+		for (i = 0, ni = psb->m_nodes.size(); i < ni; ++i)
+		{
+			btSoftBody::Node& n = psb->m_nodes[i];
+			n.m_x = n.m_q + n.m_v * psb->m_sst.sdt;
+		}
+	}
+	/* Solve positions		*/
+	if (cfg.piterations > 0)
+	{
+		for (int isolve = 0; isolve < cfg.piterations; ++isolve)
+		{
+			const btScalar ti = isolve / (btScalar)cfg.piterations;
+			for (int iseq = 0; iseq < cfg.m_psequence.size(); ++iseq)
+			{
+				if (cfg.m_psequence[iseq] == btSoftBody::ePSolver::Linear)
+				{
+					solveLinkPositions(psb, batches, 1);
+				}
+				else
+				{
+					btSoftBody::getSolver(cfg.m_psequence[iseq])(psb, 1, ti);
+				}
+			}
+		}
+		const btScalar vc = psb->m_sst.isdt * (1 - cfg.kDP);
+		for (i = 0, ni = psb->m_nodes.size(); i < ni; ++i)
+		{
+			btSoftBody::Node& n = psb->m_nodes[i];
+			n.m_v = (n.m_x - n.m_q) * vc;
+			n.m_f = btVector3(0, 0, 0);
+		}
+	}
+	/* Solve drift			*/
+	if (cfg.diterations > 0)
+	{
+		const btScalar vcf = cfg.kVCF * psb->m_sst.isdt;
+		for (i = 0, ni = psb->m_nodes.size(); i < ni; ++i)
+		{
+			btSoftBody::Node& n = psb->m_nodes[i];
+			n.m_q = n.m_x;
+		}
+		for (int idrift = 0; idrift < cfg.diterations; ++idrift)
+		{
+			for (int iseq = 0; iseq < cfg.m_dsequence.size(); ++iseq)
+			{
+				if (cfg.m_dsequence[iseq] == btSoftBody::ePSolver::Linear)
+				{
+					solveLinkPositions(psb, batches, 1);
+				}
+				else
+				{
+					btSoftBody::getSolver(cfg.m_dsequence[iseq])(psb, 1, 0);
+				}
+			}
+		}
+		for (i = 0, ni = psb->m_nodes.size(); i < ni; ++i)
+		{
+			btSoftBody::Node& n = psb->m_nodes[i];
+			n.m_v += (n.m_x - n.m_q) * vcf;
+		}
+	}
+	/* Apply clusters		*/
+	psb->dampClusters();
+	psb->applyClusters(true);
+}
+
+void btDefaultSoftBodySolverMt::predictMotion(btScalar timeStep)
+{
+	BT_PROFILE("predictMotionMt");
+	m_scratchBodies.resize(0);
+	m_scratchProxies.resize(0);
+	for (int i = 0; i < m_softBodySet.size(); ++i)
+	{
+		btSoftBody* psb = m_softBodySet[i];
+		if (psb->isActive())
+		{
+			// the broadphase is shared, the bounds go to it below in body order, as btDefaultSoftBodySolver does
+			m_scratchBodies.push_back(psb);
+			m_scratchProxies.push_back(psb->getBroadphaseHandle());
+			psb->setBroadphaseHandle(NULL);
+		}
+	}
+	if (m_scratchBodies.size() == 0)
+	{
+		return;
+	}
+	btSoftBodyPredictLoop loop;
+	loop.m_bodies = &m_scratchBodies[0];
+	loop.m_timeStep = timeStep;
+	btSoftBodySolverParallelFor(m_scratchBodies.size(), 1, loop);
+	for (int i = 0; i < m_scratchBodies.size(); ++i)
+	{
+		btSoftBody* psb = m_scratchBodies[i];
+		btBroadphaseProxy* proxy = m_scratchProxies[i];
+		psb->setBroadphaseHandle(proxy);
+		if (proxy && psb->m_nodes.size())
+		{
+			psb->m_worldInfo->m_broadphase->setAabb(proxy, psb->m_bounds[0], psb->m_bounds[1], psb->m_worldInfo->m_dispatcher);
+		}
+	}
+}
+
+void btDefaultSoftBodySolverMt::solveConstraints(btScalar solverdt)
+{
+	BT_PROFILE("solveConstraintsMt");
+	// a soft-soft contact moves the nodes of another body, keep the bodies that may have them in order
+	bool softContacts = false;
+	for (int i = 0; i < m_softBodySet.size(); ++i)
+	{
+		if (m_softBodySet[i]->isActive() && m_softBodySet[i]->m_scontacts.size())
+		{
+			softContacts = true;
+			break;
+		}
+	}
+	m_scratchBodies.resize(0);
+	m_scratchIndices.resize(0);
+	for (int i = 0; i < m_softBodySet.size(); ++i)
+	{
+		btSoftBody* psb = m_softBodySet[i];
+		if (!psb->isActive())
+		{
+			continue;
+		}
+		const bool batched = psb->m_links.size() >= m_minBatchedLinks;
+		const bool softCollisions = softContacts && (psb->m_cfg.collisions & btSoftBody::fCollision::SVSmask);
+		if (!batched && !softCollisions && isIndependent(psb))
+		{
+			m_scratchBodies.push_back(psb);
+		}
+		else
+		{
+			m_scratchIndices.push_back(i);
+		}
+	}
+	if (m_scratchBodies.size())
+	{
+		btSoftBodySolveLoop loop;
+		loop.m_bodies = &m_scratchBodies[0];
+		btSoftBodySolverParallelFor(m_scratchBodies.size(), 1, loop);
+	}
+	for (int i = 0; i < m_scratchIndices.size(); ++i)
+	{
+		const int bodyIndex = m_scratchIndices[i];
+		btSoftBody* psb = m_softBodySet[bodyIndex];
+		if (psb->m_links.size() >= m_minBatchedLinks)
+		{
+			solveConstraintsBatched(psb, updateLinkBatches(bodyIndex));
+		}
+		else
+		{
+			psb->solveConstraints();
+		}
+	}
+}
+
+void btDefaultSoftBodySolverMt::updateSoftBodies()
+{
+	BT_PROFILE("updateSoftBodiesMt");
+	m_scratchBodies.resize(0);
+	for (int i = 0; i < m_softBodySet.size(); ++i)
+	{
+		if (m_softBodySet[i]->isActive())
+		{
+			m_scratchBodies.push_back(m_softBodySet[i]);
+		}
+	}
+	if (m_scratchBodies.size())
+	{
+		btSoftBodyIntegrateLoop loop;
+		loop.m_bodies = &m_scratchBodies[0];
+		btSoftBodySolverParallelFor(m_scratchBodies.size(), 1, loop);
+	}
+}
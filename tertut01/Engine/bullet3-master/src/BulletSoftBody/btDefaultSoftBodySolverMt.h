@@ -0,0 +1,122 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2006 Erwin Coumans  https://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef BT_SOFT_BODY_DEFAULT_SOLVER_MT_H
+#define BT_SOFT_BODY_DEFAULT_SOLVER_MT_H
+
+#include "btDefaultSoftBodySolver.h"
+#include "BulletSoftBody/btSoftBody.h"
+#include "LinearMath/btThreads.h"
+
+///
+/// btDefaultSoftBodySolverMt
+///
+///  A multithreaded variant of the default soft body solver, using the task scheduler set with btSetTaskScheduler.
+///  predictMotion and updateSoftBodies run the soft bodies in parallel. The broadphase AABBs are still updated on the
+///  calling thread, in soft body order.
+///
+///  solveConstraints solves the soft bodies that touch nothing but their own nodes and static or kinematic objects in
+///  parallel, with the same results as btDefaultSoftBodySolver for any number of threads. Bodies with anchors, contacts
+///  with dynamic rigid bodies or multibodies, or soft-soft contacts are solved one after another in the original order.
+///
+///  The links of a soft body with at least getMinBatchedLinks() links are graph coloured into batches of links that
+///  share no node, and each batch is solved with btParallelFor on a packed copy of the node positions or velocities.
+///  This changes the order of the Gauss-Seidel sweep over the links compared to btDefaultSoftBodySolver, so the results
+///  of those bodies differ slightly from it, but they are the same for any number of threads.
+///  The batches are rebuilt when the number or storage of the nodes or links of a body changes, or on
+///  optimize(softBodies, true).
+///
+class btDefaultSoftBodySolverMt : public btDefaultSoftBodySolver
+{
+public:
+	struct PackedLink
+	{
+		int m_node0;
+		int m_node1;
+		btScalar m_c0;  // (ima+imb)*kLST
+		btScalar m_c1;  // rl^2
+	};
+
+	struct LinkBatches
+	{
+		const btSoftBody* m_body;
+		const btSoftBody::Node* m_nodes;
+		const btSoftBody::Link* m_links;
+		int m_numNodes;
+		int m_numLinks;
+		int m_numParallelBatches;  // the batches after these hold the links that got no colour, solved serially
+
+		btAlignedObjectArray<int> m_batchOffsets;  // links of batch i are [m_batchOffsets[i], m_batchOffsets[i+1])
+		btAlignedObjectArray<int> m_linkSlots;     // packed index of each link
+		btAlignedObjectArray<PackedLink> m_packedLinks;
+		btAlignedObjectArray<btVector3> m_gradients;   // m_c3 of the packed links
+		btAlignedObjectArray<btScalar> m_gradientScales;  // m_c2 of the packed links
+		btAlignedObjectArray<btVector3> m_nodeState;   // positions or velocities of the nodes while a link solver runs
+		btAlignedObjectArray<btScalar> m_invMasses;
+
+		LinkBatches() : m_body(NULL), m_nodes(NULL), m_links(NULL), m_numNodes(0), m_numLinks(0), m_numParallelBatches(0)
+		{
+		}
+	};
+
+protected:
+	btAlignedObjectArray<LinkBatches> m_linkBatches;  // same order as m_softBodySet
+	btAlignedObjectArray<btSoftBody*> m_scratchBodies;
+	btAlignedObjectArray<btBroadphaseProxy*> m_scratchProxies;
+	btAlignedObjectArray<int> m_scratchIndices;
+	int m_minBatchedLinks;
+	int m_linkGrainSize;
+
+	bool isIndependent(const btSoftBody* psb) const;
+	LinkBatches& updateLinkBatches(int bodyIndex);
+	void solveConstraintsBatched(btSoftBody* psb, LinkBatches& batches);
+	void solveLinkPositions(btSoftBody* psb, LinkBatches& batches, btScalar kst);
+	void solveLinkVelocities(btSoftBody* psb, LinkBatches& batches, btScalar kst);
+
+public:
+	btDefaultSoftBodySolverMt();
+
+	virtual ~btDefaultSoftBodySolverMt();
+
+	///bodies with fewer links are solved exactly like btDefaultSoftBodySolver does, default 1024
+	void setMinBatchedLinks(int minBatchedLinks)
+	{
+		m_minBatchedLinks = minBatchedLinks;
+	}
+	int getMinBatchedLinks() const
+	{
+		return m_minBatchedLinks;
+	}
+
+	///number of links per task when a batch is solved with btParallelFor, default 256
+	void setLinkGrainSize(int grainSize)
+	{
+		m_linkGrainSize = btMax(grainSize, 1);
+	}
+	int getLinkGrainSize() const
+	{
+		return m_linkGrainSize;
+	}
+
+	virtual void updateSoftBodies();
+
+	virtual void optimize(btAlignedObjectArray<btSoftBody*>& softBodies, bool forceUpdate = false);
+
+	virtual void solveConstraints(btScalar solverdt);
+
+	virtual void predictMotion(btScalar solverdt);
+};
+
+#endif  //BT_SOFT_BODY_DEFAULT_SOLVER_MT_H
@@ -16,12 +16,105 @@
 #include "btDeformableBackwardEulerObjective.h"
 #include "btPreconditioner.h"
 #include "LinearMath/btQuickprof.h"
+#include "LinearMath/btThreads.h"
+
+static void btDeformableParallelFor(int count, int grainSize, const btIParallelForBody& body)
+{
+#if BT_THREADSAFE
+	btITaskScheduler* scheduler = btGetTaskScheduler();
+	if (scheduler && scheduler->getNumThreads() > 1)
+	{
+		btParallelFor(0, count, grainSize, body);
+		return;
+	}
+#endif  // #if BT_THREADSAFE
+	body.forLoop(0, count);
+}
+
+// mass term and node damping of the parallel multiply
+struct btDeformableMultiplyNodesLoop : public btIParallelForBody
+{
+	const btDeformableBackwardEulerObjective* m_objective;
+	const btVector3* m_x;
+	btVector3* m_b;
+	btScalar m_dampingScale;
+
+	void forLoop(int iBegin, int iEnd) const
+	{
+		const btDeformableBackwardEulerObjective& objective = *m_objective;
+		for (int i = iBegin; i < iEnd; ++i)
+		{
+			const btSoftBody::Node& node = *objective.m_nodes[i];
+			m_b[i] = (node.m_im == 0) ? btVector3(0, 0, 0) : m_x[i] / node.m_im;
+			const int body = objective.m_nodeBodies[i];
+			if (!objective.m_softBodies[body]->isActive())
+			{
+				continue;
+			}
+			for (int f = objective.m_bodyForceOffsets[body]; f < objective.m_bodyForceOffsets[body + 1]; ++f)
+			{
+				objective.m_bodyForces[f]->addScaledNodeDampingForceDifferential(m_dampingScale, node, m_x[i], m_b[i]);
+			}
+		}
+	}
+};
+
+// force differentials of the elements of one batch, the elements of a batch share no node
+struct btDeformableMultiplyElementsLoop : public btIParallelForBody
+{
+	const btDeformableBackwardEulerObjective* m_objective;
+	const btDeformableBackwardEulerObjective::Element* m_elements;
+	const btVector3* m_x;
+	btVector3* m_b;
+	btScalar m_dampingScale;
+	btScalar m_elasticScale;
+
+	void forLoop(int iBegin, int iEnd) const
+	{
+		const btDeformableBackwardEulerObjective& objective = *m_objective;
+		btVector3 local_x[4], local_b[4];
+		for (int i = iBegin; i < iEnd; ++i)
+		{
+			const btDeformableBackwardEulerObjective::Element& element = m_elements[i];
+			const btSoftBody* psb = objective.m_softBodies[element.m_body];
+			if (!psb->isActive())
+			{
+				continue;
+			}
+			const int numElementNodes = btDeformableLagrangianForce::getElementNumNodes(element.m_type);
+			for (int k = 0; k < numElementNodes; ++k)
+			{
+				local_x[k] = m_x[btDeformableLagrangianForce::getElementNode(psb, element.m_type, element.m_index, k)->index];
+				local_b[k].setZero();
+			}
+			for (int f = objective.m_bodyForceOffsets[element.m_body]; f < objective.m_bodyForceOffsets[element.m_body + 1]; ++f)
+			{
+				btDeformableLagrangianForce* force = objective.m_bodyForces[f];
+				if (force->getElementType() != element.m_type)
+				{
+					continue;
+				}
+				force->addScaledElementDampingForceDifferential(m_dampingScale, psb, element.m_index, local_x, local_b);
+				if (objective.m_implicit)
+				{
+					force->addScaledElementElasticForceDifferential(m_elasticScale, psb, element.m_index, local_x, local_b);
+				}
+			}
+			for (int k = 0; k < numElementNodes; ++k)
+			{
+				m_b[btDeformableLagrangianForce::getElementNode(psb, element.m_type, element.m_index, k)->index] += local_b[k];
+			}
+		}
+	}
+};
 
 btDeformableBackwardEulerObjective::btDeformableBackwardEulerObjective(btAlignedObjectArray<btSoftBody*>& softBodies, const TVStack& backup_v)
-	: m_softBodies(softBodies), m_projection(softBodies), m_backupVelocity(backup_v), m_implicit(false)
+	: m_softBodies(softBodies), m_projection(softBodies), m_backupVelocity(backup_v), m_implicit(false), m_parallelMultiply(false), m_numParallelBatches(0)
 {
 	m_massPreconditioner = new MassPreconditioner(m_softBodies);
 	m_KKTPreconditioner = new KKTPreconditioner(m_softBodies, m_projection, m_lf, m_dt, m_implicit);
+	m_blockJacobiPreconditioner = new BlockJacobiPreconditioner(m_softBodies, m_projection, m_lf, m_dt, m_implicit);
+	m_incompleteCholeskyPreconditioner = new IncompleteCholeskyPreconditioner(m_softBodies, m_projection, m_lf, m_dt, m_implicit);
 	m_preconditioner = m_KKTPreconditioner;
 }
 
@@ -29,6 +122,8 @@ btDeformableBackwardEulerObjective::~btDeformableBackwardEulerObjective()
 {
 	delete m_KKTPreconditioner;
 	delete m_massPreconditioner;
+	delete m_blockJacobiPreconditioner;
+	delete m_incompleteCholeskyPreconditioner;
 }
 
 void btDeformableBackwardEulerObjective::reinitialize(bool nodeUpdated, btScalar dt)
@@ -59,6 +154,140 @@ void btDeformableBackwardEulerObjective::reinitialize(bool nodeUpdated, btScalar
 	}
 	m_projection.reinitialize(nodeUpdated);
 	//    m_preconditioner->reinitialize(nodeUpdated);
+	if (m_parallelMultiply)
+	{
+		updateElementBatches(nodeUpdated);
+	}
+}
+
+void btDeformableBackwardEulerObjective::updateElementBatches(bool nodeUpdated)
+{
+	BT_PROFILE("updateElementBatches");
+	// forces can be added and removed between steps, so the forces of each soft body are gathered every time
+	m_bodyForceOffsets.resize(m_softBodies.size() + 1);
+	m_bodyForces.resize(0);
+	m_nodalForces.resize(0);
+	int numElements = 0;
+	for (int i = 0; i < m_softBodies.size(); ++i)
+	{
+		m_bodyForceOffsets[i] = m_bodyForces.size();
+		bool useTetras = false, useLinks = false;
+		for (int j = 0; j < m_lf.size(); ++j)
+		{
+			btDeformableLagrangianForce* force = m_lf[j];
+			if (force->getElementType() != BT_NO_ELEMENT && force->m_softBodies.findLinearSearch2(m_softBodies[i]) >= 0)
+			{
+				m_bodyForces.push_back(force);
+				useTetras |= (force->getElementType() == BT_TETRA_ELEMENT);
+				useLinks |= (force->getElementType() == BT_LINK_ELEMENT);
+			}
+		}
+		numElements += (useTetras ? m_softBodies[i]->m_tetras.size() : 0) + (useLinks ? m_softBodies[i]->m_links.size() : 0);
+	}
+	m_bodyForceOffsets[m_softBodies.size()] = m_bodyForces.size();
+	for (int j = 0; j < m_lf.size(); ++j)
+	{
+		if (m_lf[j]->getElementType() == BT_NO_ELEMENT)
+		{
+			m_nodalForces.push_back(m_lf[j]);
+		}
+	}
+
+	if (!nodeUpdated && m_nodeBodies.size() == m_nodes.size() && m_elements.size() == numElements)
+	{
+		return;
+	}
+
+	m_nodeBodies.resize(m_nodes.size());
+	m_elements.resize(0);
+	for (int i = 0; i < m_softBodies.size(); ++i)
+	{
+		const btSoftBody* psb = m_softBodies[i];
+		for (int j = 0; j < psb->m_nodes.size(); ++j)
+		{
+			m_nodeBodies[psb->m_nodes[j].index] = i;
+		}
+		for (int type = BT_TETRA_ELEMENT; type <= BT_LINK_ELEMENT; ++type)
+		{
+			bool used = false;
+			for (int f = m_bodyForceOffsets[i]; f < m_bodyForceOffsets[i + 1]; ++f)
+			{
+				used |= (m_bodyForces[f]->getElementType() == type);
+			}
+			const int numBodyElements = used ? btDeformableLagrangianForce::getNumElements(psb, btDeformableElementType(type)) : 0;
+			for (int j = 0; j < numBodyElements; ++j)
+			{
+				Element element;
+				element.m_body = i;
+				element.m_index = j;
+				element.m_type = btDeformableElementType(type);
+				m_elements.push_back(element);
+			}
+		}
+	}
+
+	// greedy colouring with a bit per colour for each node, elements that find no free colour are summed serially
+	const int maxColours = 64;
+	btAlignedObjectArray<unsigned long long> nodeColours;
+	nodeColours.resize(m_nodes.size(), 0);
+	btAlignedObjectArray<int> elementColours;
+	elementColours.resize(m_elements.size());
+	btAlignedObjectArray<int> colourCounts;
+	colourCounts.resize(maxColours + 1, 0);
+	int numColours = 0;
+	for (int i = 0; i < m_elements.size(); ++i)
+	{
+		const Element& element = m_elements[i];
+		const btSoftBody* psb = m_softBodies[element.m_body];
+		const int numElementNodes = btDeformableLagrangianForce::getElementNumNodes(element.m_type);
+		unsigned long long used = 0;
+		for (int k = 0; k < numElementNodes; ++k)
+		{
+			used |= nodeColours[btDeformableLagrangianForce::getElementNode(psb, element.m_type, element.m_index, k)->index];
+		}
+		int colour = 0;
+		while (colour < maxColours && (used & (1ULL << colour)))
+		{
+			++colour;
+		}
+		if (colour < maxColours)
+		{
+			for (int k = 0; k < numElementNodes; ++k)
+			{
+				nodeColours[btDeformableLagrangianForce::getElementNode(psb, element.m_type, element.m_index, k)->index] |= (1ULL << colour);
+			}
+			numColours = btMax(numColours, colour + 1);
+		}
+		elementColours[i] = colour;
+		colourCounts[colour]++;
+	}
+
+	m_numParallelBatches = numColours;
+	const bool hasOverflow = colourCounts[maxColours] > 0;
+	m_batchOffsets.resize(numColours + (hasOverflow ? 2 : 1));
+	m_batchOffsets[0] = 0;
+	for (int c = 0; c < numColours; ++c)
+	{
+		m_batchOffsets[c + 1] = m_batchOffsets[c] + colourCounts[c];
+	}
+	if (hasOverflow)
+	{
+		m_batchOffsets[numColours + 1] = m_batchOffsets[numColours] + colourCounts[maxColours];
+	}
+	btAlignedObjectArray<int> fill;
+	fill.resize(maxColours + 1);
+	for (int c = 0; c < numColours; ++c)
+	{
+		fill[c] = m_batchOffsets[c];
+	}
+	fill[maxColours] = m_batchOffsets[numColours];
+	btAlignedObjectArray<Element> sorted;
+	sorted.resize(m_elements.size());
+	for (int i = 0; i < m_elements.size(); ++i)
+	{
+		sorted[fill[elementColours[i]]++] = m_elements[i];
+	}
+	m_elements.copyFromArray(sorted);
 }
 
 void btDeformableBackwardEulerObjective::setDt(btScalar dt)
@@ -66,30 +295,82 @@ void btDeformableBackwardEulerObjective::setDt(btScalar dt)
 	m_dt = dt;
 }
 
-void btDeformableBackwardEulerObjective::multiply(const TVStack& x, TVStack& b) const
+void btDeformableBackwardEulerObjective::multiplyElementBatches(const TVStack& x, TVStack& b) const
 {
-	BT_PROFILE("multiply");
-	// add in the mass term
-	size_t counter = 0;
-	for (int i = 0; i < m_softBodies.size(); ++i)
+	if (m_nodes.size() == 0)
 	{
-		btSoftBody* psb = m_softBodies[i];
-		for (int j = 0; j < psb->m_nodes.size(); ++j)
+		return;
+	}
+	btDeformableMultiplyNodesLoop nodesLoop;
+	nodesLoop.m_objective = this;
+	nodesLoop.m_x = &x[0];
+	nodesLoop.m_b = &b[0];
+	nodesLoop.m_dampingScale = -m_dt;
+	btDeformableParallelFor(m_nodes.size(), 256, nodesLoop);
+
+	btDeformableMultiplyElementsLoop elementsLoop;
+	elementsLoop.m_objective = this;
+	elementsLoop.m_x = &x[0];
+	elementsLoop.m_b = &b[0];
+	elementsLoop.m_dampingScale = -m_dt;
+	elementsLoop.m_elasticScale = -m_dt * m_dt;
+	for (int i = 0; i < m_batchOffsets.size() - 1; ++i)
+	{
+		const int numBatchElements = m_batchOffsets[i + 1] - m_batchOffsets[i];
+		elementsLoop.m_elements = &m_elements[0] + m_batchOffsets[i];
+		if (i < m_numParallelBatches)
 		{
-			const btSoftBody::Node& node = psb->m_nodes[j];
-			b[counter] = (node.m_im == 0) ? btVector3(0, 0, 0) : x[counter] / node.m_im;
-			++counter;
+			btDeformableParallelFor(numBatchElements, 64, elementsLoop);
+		}
+		else
+		{
+			elementsLoop.forLoop(0, numBatchElements);
 		}
 	}
 
-	for (int i = 0; i < m_lf.size(); ++i)
+	for (int i = 0; i < m_nodalForces.size(); ++i)
 	{
-		// add damping matrix
-		m_lf[i]->addScaledDampingForceDifferential(-m_dt, x, b);
-        // Always integrate picking force implicitly for stability.
-        if (m_implicit || m_lf[i]->getForceType() == BT_MOUSE_PICKING_FORCE)
+		m_nodalForces[i]->addScaledDampingForceDifferential(-m_dt, x, b);
+		// Always integrate picking force implicitly for stability.
+		if (m_implicit || m_nodalForces[i]->getForceType() == BT_MOUSE_PICKING_FORCE)
 		{
-			m_lf[i]->addScaledElasticForceDifferential(-m_dt * m_dt, x, b);
+			m_nodalForces[i]->addScaledElasticForceDifferential(-m_dt * m_dt, x, b);
+		}
+	}
+}
+
+void btDeformableBackwardEulerObjective::multiply(const TVStack& x, TVStack& b) const
+{
+	BT_PROFILE("multiply");
+	// the batches are built by reinitialize, until then the serial multiply is used
+	if (m_parallelMultiply && m_nodeBodies.size() == m_nodes.size())
+	{
+		multiplyElementBatches(x, b);
+	}
+	else
+	{
+		// add in the mass term
+		size_t counter = 0;
+		for (int i = 0; i < m_softBodies.size(); ++i)
+		{
+			btSoftBody* psb = m_softBodies[i];
+			for (int j = 0; j < psb->m_nodes.size(); ++j)
+			{
+				const btSoftBody::Node& node = psb->m_nodes[j];
+				b[counter] = (node.m_im == 0) ? btVector3(0, 0, 0) : x[counter] / node.m_im;
+				++counter;
+			}
+		}
+
+		for (int i = 0; i < m_lf.size(); ++i)
+		{
+			// add damping matrix
+			m_lf[i]->addScaledDampingForceDifferential(-m_dt, x, b);
+			// Always integrate picking force implicitly for stability.
+			if (m_implicit || m_lf[i]->getForceType() == BT_MOUSE_PICKING_FORCE)
+			{
+				m_lf[i]->addScaledElasticForceDifferential(-m_dt * m_dt, x, b);
+			}
 		}
 	}
 	int offset = m_nodes.size();
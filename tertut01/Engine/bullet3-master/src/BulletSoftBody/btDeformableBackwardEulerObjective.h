@@ -34,7 +34,17 @@ public:
 	enum _
 	{
 		Mass_preconditioner,
-		KKT_preconditioner
+		KKT_preconditioner,
+		BlockJacobi_preconditioner,
+		IncompleteCholesky_preconditioner
+	};
+
+	// a tetrahedron or link of m_softBodies[m_body]
+	struct Element
+	{
+		int m_body;
+		int m_index;
+		btDeformableElementType m_type;
 	};
 
 	typedef btAlignedObjectArray<btVector3> TVStack;
@@ -48,6 +58,17 @@ public:
 	bool m_implicit;
 	MassPreconditioner* m_massPreconditioner;
 	KKTPreconditioner* m_KKTPreconditioner;
+	BlockJacobiPreconditioner* m_blockJacobiPreconditioner;
+	IncompleteCholeskyPreconditioner* m_incompleteCholeskyPreconditioner;
+
+	bool m_parallelMultiply;
+	btAlignedObjectArray<Element> m_elements;     // the elements used by the forces, grouped into batches
+	btAlignedObjectArray<int> m_batchOffsets;     // elements of batch i are [m_batchOffsets[i], m_batchOffsets[i+1])
+	int m_numParallelBatches;                     // the batches after these hold the elements that got no colour
+	btAlignedObjectArray<int> m_bodyForceOffsets;  // forces of soft body i are [m_bodyForceOffsets[i], m_bodyForceOffsets[i+1])
+	btAlignedObjectArray<btDeformableLagrangianForce*> m_bodyForces;
+	btAlignedObjectArray<btDeformableLagrangianForce*> m_nodalForces;  // forces without an element-wise form
+	btAlignedObjectArray<int> m_nodeBodies;        // soft body of each node
 
 	btDeformableBackwardEulerObjective(btAlignedObjectArray<btSoftBody*>& softBodies, const TVStack& backup_v);
 
@@ -73,6 +94,20 @@ public:
 	// perform A*x = b
 	void multiply(const TVStack& x, TVStack& b) const;
 
+	// If true, multiply sums the element force differentials with btParallelFor over batches of elements that share no
+	// node. The result does not depend on the number of threads, but the sums are rounded differently than the serial
+	// multiply.
+	void setParallelMultiply(bool parallelMultiply)
+	{
+		m_parallelMultiply = parallelMultiply;
+	}
+
+	// update the forces of each soft body, and colour the elements when the nodes or elements changed
+	void updateElementBatches(bool nodeUpdated);
+
+	// the mass and force differential part of multiply, computed over the element batches
+	void multiplyElementBatches(const TVStack& x, TVStack& b) const;
+
 	// set initial guess for CG solve
 	void initialGuess(TVStack& dv, const TVStack& residual);
 
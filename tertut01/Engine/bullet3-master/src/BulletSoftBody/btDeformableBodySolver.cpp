@@ -24,6 +24,7 @@ btDeformableBodySolver::btDeformableBodySolver()
 {
 	m_objective = new btDeformableBackwardEulerObjective(m_softBodies, m_backupVelocity);
 	m_reducedSolver = false;
+	m_lastSolveIterations = 0;
 }
 
 btDeformableBodySolver::~btDeformableBodySolver()
@@ -165,7 +166,8 @@ void btDeformableBodySolver::updateEnergy(btScalar scale)
 
 btScalar btDeformableBodySolver::computeDescentStep(TVStack& ddv, const TVStack& residual, bool verbose)
 {
-	m_cg.solve(*m_objective, ddv, residual, false);
+	m_objective->m_preconditioner->update();
+	m_lastSolveIterations = m_cg.solve(*m_objective, ddv, residual, false);
 	btScalar inner_product = m_cg.dot(residual, m_ddv);
 	btScalar res_norm = m_objective->computeNorm(residual);
 	btScalar tol = 1e-5 * res_norm * m_objective->computeNorm(m_ddv);
@@ -213,10 +215,11 @@ void btDeformableBodySolver::updateDv(btScalar scale)
 
 void btDeformableBodySolver::computeStep(TVStack& ddv, const TVStack& residual)
 {
+	m_objective->m_preconditioner->update();
 	if (m_useProjection)
-		m_cg.solve(*m_objective, ddv, residual, false);
+		m_lastSolveIterations = m_cg.solve(*m_objective, ddv, residual, false);
 	else
-		m_cr.solve(*m_objective, ddv, residual, false);
+		m_lastSolveIterations = m_cr.solve(*m_objective, ddv, residual, false);
 }
 
 void btDeformableBodySolver::reinitialize(const btAlignedObjectArray<btSoftBody*>& softBodies, btScalar dt)
@@ -47,6 +47,7 @@ protected:
 	btScalar m_newtonTolerance;                                    // stop newton iterations if f(x) < m_newtonTolerance
 	bool m_lineSearch;                                             // If true, use newton's method with line search under implicit scheme
 	bool m_reducedSolver;																					 // flag for reduced soft body solver
+	int m_lastSolveIterations;                                     // Krylov iterations of the last linear solve
 public:
 	// handles data related to objective function
 	btDeformableBackwardEulerObjective* m_objective;
@@ -180,6 +181,14 @@ public:
 			case btDeformableBackwardEulerObjective::KKT_preconditioner:
 				m_objective->m_preconditioner = m_objective->m_KKTPreconditioner;
 				break;
+
+			case btDeformableBackwardEulerObjective::BlockJacobi_preconditioner:
+				m_objective->m_preconditioner = m_objective->m_blockJacobiPreconditioner;
+				break;
+
+			case btDeformableBackwardEulerObjective::IncompleteCholesky_preconditioner:
+				m_objective->m_preconditioner = m_objective->m_incompleteCholeskyPreconditioner;
+				break;
 			
 			default:
 				btAssert(false);
@@ -187,6 +196,22 @@ public:
 		}
 	}
 
+	// If true, the matrix-vector products of the linear solves run in parallel over batches of elements that share no
+	// node, and the vector operations of the Krylov solvers run in parallel over fixed blocks. The results do not depend
+	// on the number of threads, but they are not bit-identical to the serial solve.
+	void setParallelSolve(bool parallel)
+	{
+		m_objective->setParallelMultiply(parallel);
+		m_cg.setParallel(parallel);
+		m_cr.setParallel(parallel);
+	}
+
+	// the number of Krylov iterations of the last linear solve
+	int getLastSolveIterations() const
+	{
+		return m_lastSolveIterations;
+	}
+
 	virtual btAlignedObjectArray<btDeformableLagrangianForce*>* getLagrangianForceArray()
 	{
 		return &(m_objective->m_lf);
@@ -30,6 +30,14 @@ enum btDeformableLagrangianForceType
 	BT_MOUSE_PICKING_FORCE = 6
 };
 
+// the soft body elements a force sums its differentials over
+enum btDeformableElementType
+{
+	BT_NO_ELEMENT = 0,     // the force has no element-wise form
+	BT_TETRA_ELEMENT = 1,  // btSoftBody::m_tetras
+	BT_LINK_ELEMENT = 2    // btSoftBody::m_links
+};
+
 static inline double randomDouble(double low, double high)
 {
 	return low + static_cast<double>(rand()) / RAND_MAX * (high - low);
@@ -70,6 +78,85 @@ public:
 
 	virtual btDeformableLagrangianForceType getForceType() = 0;
 
+	// Element-wise form of the force differentials. The differentials over the whole system are the sum of the element
+	// and node terms below, which lets them be evaluated in parallel over elements that share no node and lets the
+	// preconditioners build the blocks of the system matrix.
+	virtual btDeformableElementType getElementType()
+	{
+		return BT_NO_ELEMENT;
+	}
+
+	// add damping df of one element, dv and df hold the values of the nodes of the element in the order of its m_n
+	virtual void addScaledElementDampingForceDifferential(btScalar scale, const btSoftBody* psb, int element, const btVector3* dv, btVector3* df)
+	{
+	}
+
+	// add elastic df of one element
+	virtual void addScaledElementElasticForceDifferential(btScalar scale, const btSoftBody* psb, int element, const btVector3* dx, btVector3* df)
+	{
+	}
+
+	// add the damping df of a node that does not couple it to other nodes
+	virtual void addScaledNodeDampingForceDifferential(btScalar scale, const btSoftBody::Node& node, const btVector3& dv, btVector3& df)
+	{
+	}
+
+	static int getElementNumNodes(btDeformableElementType type)
+	{
+		return (type == BT_TETRA_ELEMENT) ? 4 : ((type == BT_LINK_ELEMENT) ? 2 : 0);
+	}
+
+	static int getNumElements(const btSoftBody* psb, btDeformableElementType type)
+	{
+		return (type == BT_TETRA_ELEMENT) ? psb->m_tetras.size() : ((type == BT_LINK_ELEMENT) ? psb->m_links.size() : 0);
+	}
+
+	static const btSoftBody::Node* getElementNode(const btSoftBody* psb, btDeformableElementType type, int element, int i)
+	{
+		return (type == BT_TETRA_ELEMENT) ? psb->m_tetras[element].m_n[i] : psb->m_links[element].m_n[i];
+	}
+
+	// sum the element and node differentials over the active soft bodies of the force
+	void addScaledElementForceDifferentials(btScalar scale, const TVStack& dx, TVStack& df, bool damping)
+	{
+		const btDeformableElementType type = getElementType();
+		const int numElementNodes = getElementNumNodes(type);
+		btVector3 local_dx[4], local_df[4];
+		for (int i = 0; i < m_softBodies.size(); ++i)
+		{
+			const btSoftBody* psb = m_softBodies[i];
+			if (!psb->isActive())
+			{
+				continue;
+			}
+			const int numElements = getNumElements(psb, type);
+			for (int j = 0; j < numElements; ++j)
+			{
+				for (int k = 0; k < numElementNodes; ++k)
+				{
+					local_dx[k] = dx[getElementNode(psb, type, j, k)->index];
+					local_df[k].setZero();
+				}
+				if (damping)
+					addScaledElementDampingForceDifferential(scale, psb, j, local_dx, local_df);
+				else
+					addScaledElementElasticForceDifferential(scale, psb, j, local_dx, local_df);
+				for (int k = 0; k < numElementNodes; ++k)
+				{
+					df[getElementNode(psb, type, j, k)->index] += local_df[k];
+				}
+			}
+			if (damping)
+			{
+				for (int j = 0; j < psb->m_nodes.size(); ++j)
+				{
+					const btSoftBody::Node& node = psb->m_nodes[j];
+					addScaledNodeDampingForceDifferential(scale, node, dx[node.index], df[node.index]);
+				}
+			}
+		}
+	}
+
 	virtual void reinitialize(bool nodeUpdated)
 	{
 	}
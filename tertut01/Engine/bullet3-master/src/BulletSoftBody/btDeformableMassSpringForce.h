@@ -119,35 +119,56 @@ public:
 	virtual void addScaledDampingForceDifferential(btScalar scale, const TVStack& dv, TVStack& df)
 	{
 		// implicit damping force differential
-		for (int i = 0; i < m_softBodies.size(); ++i)
+		addScaledElementForceDifferentials(scale, dv, df, true);
+	}
+
+	virtual btDeformableElementType getElementType()
+	{
+		return BT_LINK_ELEMENT;
+	}
+
+	virtual void addScaledElementDampingForceDifferential(btScalar scale, const btSoftBody* psb, int element, const btVector3* dv, btVector3* df)
+	{
+		btScalar scaled_k_damp = m_dampingStiffness * scale;
+		const btSoftBody::Link& link = psb->m_links[element];
+		const btSoftBody::Node* node1 = link.m_n[0];
+		const btSoftBody::Node* node2 = link.m_n[1];
+
+		btVector3 local_scaled_df = scaled_k_damp * (dv[1] - dv[0]);
+		if (m_momentum_conserving)
 		{
-			btSoftBody* psb = m_softBodies[i];
-			if (!psb->isActive())
+			if ((node2->m_x - node1->m_x).norm() > SIMD_EPSILON)
 			{
-				continue;
+				btVector3 dir = (node2->m_x - node1->m_x).normalized();
+				local_scaled_df = scaled_k_damp * (dv[1] - dv[0]).dot(dir) * dir;
 			}
-			btScalar scaled_k_damp = m_dampingStiffness * scale;
-			for (int j = 0; j < psb->m_links.size(); ++j)
-			{
-				const btSoftBody::Link& link = psb->m_links[j];
-				btSoftBody::Node* node1 = link.m_n[0];
-				btSoftBody::Node* node2 = link.m_n[1];
-				size_t id1 = node1->index;
-				size_t id2 = node2->index;
+		}
+		df[0] += local_scaled_df;
+		df[1] -= local_scaled_df;
+	}
 
-				btVector3 local_scaled_df = scaled_k_damp * (dv[id2] - dv[id1]);
-				if (m_momentum_conserving)
-				{
-					if ((node2->m_x - node1->m_x).norm() > SIMD_EPSILON)
-					{
-						btVector3 dir = (node2->m_x - node1->m_x).normalized();
-						local_scaled_df = scaled_k_damp * (dv[id2] - dv[id1]).dot(dir) * dir;
-					}
-				}
-				df[id1] += local_scaled_df;
-				df[id2] -= local_scaled_df;
-			}
+	virtual void addScaledElementElasticForceDifferential(btScalar scale, const btSoftBody* psb, int element, const btVector3* dx, btVector3* df)
+	{
+		const btSoftBody::Link& link = psb->m_links[element];
+		const btSoftBody::Node* node1 = link.m_n[0];
+		const btSoftBody::Node* node2 = link.m_n[1];
+		btScalar r = link.m_rl;
+
+		btVector3 dir = (node1->m_q - node2->m_q);
+		btScalar dir_norm = dir.norm();
+		btVector3 dir_normalized = (dir_norm > SIMD_EPSILON) ? dir.normalized() : btVector3(0, 0, 0);
+		btVector3 dx_diff = dx[0] - dx[1];
+		btVector3 scaled_df = btVector3(0, 0, 0);
+		btScalar scaled_k = scale * (link.m_bbending ? m_bendingStiffness : m_elasticStiffness);
+		if (dir_norm > SIMD_EPSILON)
+		{
+			scaled_df -= scaled_k * dir_normalized.dot(dx_diff) * dir_normalized;
+			scaled_df += scaled_k * dir_normalized.dot(dx_diff) * ((dir_norm - r) / dir_norm) * dir_normalized;
+			scaled_df -= scaled_k * ((dir_norm - r) / dir_norm) * dx_diff;
 		}
+
+		df[0] += scaled_df;
+		df[1] -= scaled_df;
 	}
 
 	virtual void buildDampingForceDifferentialDiagonal(btScalar scale, TVStack& diagA)
@@ -256,40 +277,7 @@ public:
 
 	virtual void addScaledElasticForceDifferential(btScalar scale, const TVStack& dx, TVStack& df)
 	{
-		// implicit damping force differential
-		for (int i = 0; i < m_softBodies.size(); ++i)
-		{
-			const btSoftBody* psb = m_softBodies[i];
-			if (!psb->isActive())
-			{
-				continue;
-			}
-			for (int j = 0; j < psb->m_links.size(); ++j)
-			{
-				const btSoftBody::Link& link = psb->m_links[j];
-				btSoftBody::Node* node1 = link.m_n[0];
-				btSoftBody::Node* node2 = link.m_n[1];
-				size_t id1 = node1->index;
-				size_t id2 = node2->index;
-				btScalar r = link.m_rl;
-
-				btVector3 dir = (node1->m_q - node2->m_q);
-				btScalar dir_norm = dir.norm();
-				btVector3 dir_normalized = (dir_norm > SIMD_EPSILON) ? dir.normalized() : btVector3(0, 0, 0);
-				btVector3 dx_diff = dx[id1] - dx[id2];
-				btVector3 scaled_df = btVector3(0, 0, 0);
-				btScalar scaled_k = scale * (link.m_bbending ? m_bendingStiffness : m_elasticStiffness);
-				if (dir_norm > SIMD_EPSILON)
-				{
-					scaled_df -= scaled_k * dir_normalized.dot(dx_diff) * dir_normalized;
-					scaled_df += scaled_k * dir_normalized.dot(dx_diff) * ((dir_norm - r) / dir_norm) * dir_normalized;
-					scaled_df -= scaled_k * ((dir_norm - r) / dir_norm) * dx_diff;
-				}
-
-				df[id1] += scaled_df;
-				df[id2] -= scaled_df;
-			}
-		}
+		addScaledElementForceDifferentials(scale, dx, df, false);
 	}
 
 	virtual btDeformableLagrangianForceType getForceType()
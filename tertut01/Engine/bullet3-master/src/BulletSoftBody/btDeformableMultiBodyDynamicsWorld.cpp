@@ -63,6 +63,7 @@ btDeformableMultiBodyDynamicsWorld::btDeformableMultiBodyDynamicsWorld(btDispatc
 	m_implicit = false;
 	m_lineSearch = false;
 	m_useProjection = false;
+	m_preconditioner = -1;
 	m_ccdIterations = 5;
 	m_solverDeformableBodyIslandCallback = new DeformableBodyInplaceSolverIslandCallback(constraintSolver, dispatcher);
 }
@@ -472,6 +473,10 @@ void btDeformableMultiBodyDynamicsWorld::reinitialize(btScalar timeStep)
 		m_deformableBodySolver->setStrainLimiting(false);
 		m_deformableBodySolver->setPreconditioner(btDeformableBackwardEulerObjective::KKT_preconditioner);
 	}
+	if (m_preconditioner >= 0)
+	{
+		m_deformableBodySolver->setPreconditioner(m_preconditioner);
+	}
 }
 
 void btDeformableMultiBodyDynamicsWorld::debugDrawWorld()
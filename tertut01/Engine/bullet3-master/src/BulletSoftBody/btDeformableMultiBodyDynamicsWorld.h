@@ -50,6 +50,7 @@ class btDeformableMultiBodyDynamicsWorld : public btMultiBodyDynamicsWorld
 	bool m_implicit;
 	bool m_lineSearch;
 	bool m_useProjection;
+	int m_preconditioner;
 	DeformableBodyInplaceSolverIslandCallback* m_solverDeformableBodyIslandCallback;
 
 	typedef void (*btSolverCallback)(btScalar time, btDeformableMultiBodyDynamicsWorld* world);
@@ -171,6 +172,13 @@ public:
 		m_useProjection = useProjection;
 	}
 
+	// one of the btDeformableBackwardEulerObjective preconditioners, or -1 to use the mass preconditioner with
+	// projection and the KKT preconditioner without (the default)
+	void setPreconditioner(int preconditioner)
+	{
+		m_preconditioner = preconditioner;
+	}
+
 	void applyRepulsionForce(btScalar timeStep);
 
 	void performGeometricCollisions(btScalar timeStep);
@@ -275,42 +275,7 @@ public:
 			return;
 		int numNodes = getNumNodes();
 		btAssert(numNodes <= df.size());
-		btVector3 grad_N_hat_1st_col = btVector3(-1, -1, -1);
-		for (int i = 0; i < m_softBodies.size(); ++i)
-		{
-			btSoftBody* psb = m_softBodies[i];
-			if (!psb->isActive())
-			{
-				continue;
-			}
-			for (int j = 0; j < psb->m_tetras.size(); ++j)
-			{
-				btSoftBody::Tetra& tetra = psb->m_tetras[j];
-				btSoftBody::Node* node0 = tetra.m_n[0];
-				btSoftBody::Node* node1 = tetra.m_n[1];
-				btSoftBody::Node* node2 = tetra.m_n[2];
-				btSoftBody::Node* node3 = tetra.m_n[3];
-				size_t id0 = node0->index;
-				size_t id1 = node1->index;
-				size_t id2 = node2->index;
-				size_t id3 = node3->index;
-				btMatrix3x3 dF = Ds(id0, id1, id2, id3, dv) * tetra.m_Dm_inverse;
-				btMatrix3x3 I;
-				I.setIdentity();
-				btMatrix3x3 dP = (dF + dF.transpose()) * m_mu_damp + I * (dF[0][0] + dF[1][1] + dF[2][2]) * m_lambda_damp;
-				//                firstPiolaDampingDifferential(psb->m_tetraScratchesTn[j], dF, dP);
-				//                btVector3 df_on_node0 = dP * (tetra.m_Dm_inverse.transpose()*grad_N_hat_1st_col);
-				btMatrix3x3 df_on_node123 = dP * tetra.m_Dm_inverse.transpose();
-				btVector3 df_on_node0 = df_on_node123 * grad_N_hat_1st_col;
-
-				// damping force differential
-				btScalar scale1 = scale * tetra.m_element_measure;
-				df[id0] -= scale1 * df_on_node0;
-				df[id1] -= scale1 * df_on_node123.getColumn(0);
-				df[id2] -= scale1 * df_on_node123.getColumn(1);
-				df[id3] -= scale1 * df_on_node123.getColumn(2);
-			}
-		}
+		addScaledElementForceDifferentials(scale, dv, df, true);
 	}
 
 	virtual void buildDampingForceDifferentialDiagonal(btScalar scale, TVStack& diagA) {}
@@ -319,40 +284,54 @@ public:
 	{
 		int numNodes = getNumNodes();
 		btAssert(numNodes <= df.size());
+		addScaledElementForceDifferentials(scale, dx, df, false);
+	}
+
+	virtual btDeformableElementType getElementType()
+	{
+		return BT_TETRA_ELEMENT;
+	}
+
+	virtual void addScaledElementDampingForceDifferential(btScalar scale, const btSoftBody* psb, int element, const btVector3* dv, btVector3* df)
+	{
+		if (m_mu_damp == 0 && m_lambda_damp == 0)
+			return;
 		btVector3 grad_N_hat_1st_col = btVector3(-1, -1, -1);
-		for (int i = 0; i < m_softBodies.size(); ++i)
-		{
-			btSoftBody* psb = m_softBodies[i];
-			if (!psb->isActive())
-			{
-				continue;
-			}
-			for (int j = 0; j < psb->m_tetras.size(); ++j)
-			{
-				btSoftBody::Tetra& tetra = psb->m_tetras[j];
-				btSoftBody::Node* node0 = tetra.m_n[0];
-				btSoftBody::Node* node1 = tetra.m_n[1];
-				btSoftBody::Node* node2 = tetra.m_n[2];
-				btSoftBody::Node* node3 = tetra.m_n[3];
-				size_t id0 = node0->index;
-				size_t id1 = node1->index;
-				size_t id2 = node2->index;
-				size_t id3 = node3->index;
-				btMatrix3x3 dF = Ds(id0, id1, id2, id3, dx) * tetra.m_Dm_inverse;
-				btMatrix3x3 dP;
-				firstPiolaDifferential(psb->m_tetraScratches[j], dF, dP);
-				//                btVector3 df_on_node0 = dP * (tetra.m_Dm_inverse.transpose()*grad_N_hat_1st_col);
-				btMatrix3x3 df_on_node123 = dP * tetra.m_Dm_inverse.transpose();
-				btVector3 df_on_node0 = df_on_node123 * grad_N_hat_1st_col;
+		const btSoftBody::Tetra& tetra = psb->m_tetras[element];
+		btMatrix3x3 dF = btMatrix3x3(dv[1] - dv[0], dv[2] - dv[0], dv[3] - dv[0]).transpose() * tetra.m_Dm_inverse;
+		btMatrix3x3 I;
+		I.setIdentity();
+		btMatrix3x3 dP = (dF + dF.transpose()) * m_mu_damp + I * (dF[0][0] + dF[1][1] + dF[2][2]) * m_lambda_damp;
+		//                firstPiolaDampingDifferential(psb->m_tetraScratchesTn[j], dF, dP);
+		//                btVector3 df_on_node0 = dP * (tetra.m_Dm_inverse.transpose()*grad_N_hat_1st_col);
+		btMatrix3x3 df_on_node123 = dP * tetra.m_Dm_inverse.transpose();
+		btVector3 df_on_node0 = df_on_node123 * grad_N_hat_1st_col;
 
-				// elastic force differential
-				btScalar scale1 = scale * tetra.m_element_measure;
-				df[id0] -= scale1 * df_on_node0;
-				df[id1] -= scale1 * df_on_node123.getColumn(0);
-				df[id2] -= scale1 * df_on_node123.getColumn(1);
-				df[id3] -= scale1 * df_on_node123.getColumn(2);
-			}
-		}
+		// damping force differential
+		btScalar scale1 = scale * tetra.m_element_measure;
+		df[0] -= scale1 * df_on_node0;
+		df[1] -= scale1 * df_on_node123.getColumn(0);
+		df[2] -= scale1 * df_on_node123.getColumn(1);
+		df[3] -= scale1 * df_on_node123.getColumn(2);
+	}
+
+	virtual void addScaledElementElasticForceDifferential(btScalar scale, const btSoftBody* psb, int element, const btVector3* dx, btVector3* df)
+	{
+		btVector3 grad_N_hat_1st_col = btVector3(-1, -1, -1);
+		const btSoftBody::Tetra& tetra = psb->m_tetras[element];
+		btMatrix3x3 dF = btMatrix3x3(dx[1] - dx[0], dx[2] - dx[0], dx[3] - dx[0]).transpose() * tetra.m_Dm_inverse;
+		btMatrix3x3 dP;
+		firstPiolaDifferential(psb->m_tetraScratches[element], dF, dP);
+		//                btVector3 df_on_node0 = dP * (tetra.m_Dm_inverse.transpose()*grad_N_hat_1st_col);
+		btMatrix3x3 df_on_node123 = dP * tetra.m_Dm_inverse.transpose();
+		btVector3 df_on_node0 = df_on_node123 * grad_N_hat_1st_col;
+
+		// elastic force differential
+		btScalar scale1 = scale * tetra.m_element_measure;
+		df[0] -= scale1 * df_on_node0;
+		df[1] -= scale1 * df_on_node123.getColumn(0);
+		df[2] -= scale1 * df_on_node123.getColumn(1);
+		df[3] -= scale1 * df_on_node123.getColumn(2);
 	}
 
 	void firstPiola(const btSoftBody::TetraScratch& s, btMatrix3x3& P)
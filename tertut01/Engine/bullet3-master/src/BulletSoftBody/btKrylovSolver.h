@@ -22,6 +22,87 @@
 #include <LinearMath/btVector3.h>
 #include <LinearMath/btScalar.h>
 #include "LinearMath/btQuickprof.h"
+#include "LinearMath/btThreads.h"
+
+// number of vectors per block when the vector operations run in parallel
+static const int btKrylovBlockSize = 512;
+
+static inline void btKrylovParallelFor(int count, int grainSize, const btIParallelForBody& body)
+{
+#if BT_THREADSAFE
+	btITaskScheduler* scheduler = btGetTaskScheduler();
+	if (scheduler && scheduler->getNumThreads() > 1)
+	{
+		btParallelFor(0, count, grainSize, body);
+		return;
+	}
+#endif  // #if BT_THREADSAFE
+	body.forLoop(0, count);
+}
+
+// per block sums of a[i].dot(b[i]), accumulated componentwise so the inner loop stays in SIMD registers
+struct btKrylovDotLoop : public btIParallelForBody
+{
+	const btVector3* m_a;
+	const btVector3* m_b;
+	btScalar* m_blockSums;
+	int m_size;
+
+	void forLoop(int iBegin, int iEnd) const
+	{
+		for (int block = iBegin; block < iEnd; ++block)
+		{
+			const int begin = block * btKrylovBlockSize;
+			const int end = btMin(begin + btKrylovBlockSize, m_size);
+			btVector3 sum(0, 0, 0);
+			for (int i = begin; i < end; ++i)
+			{
+				sum += m_a[i] * m_b[i];
+			}
+			m_blockSums[block] = sum.x() + sum.y() + sum.z();
+		}
+	}
+};
+
+// per block maxima of the absolute values of the components of a
+struct btKrylovMaxNormLoop : public btIParallelForBody
+{
+	const btVector3* m_a;
+	btScalar* m_blockSums;
+	int m_size;
+
+	void forLoop(int iBegin, int iEnd) const
+	{
+		for (int block = iBegin; block < iEnd; ++block)
+		{
+			const int begin = block * btKrylovBlockSize;
+			const int end = btMin(begin + btKrylovBlockSize, m_size);
+			btVector3 ret(0, 0, 0);
+			for (int i = begin; i < end; ++i)
+			{
+				ret.setMax(m_a[i].absolute());
+			}
+			m_blockSums[block] = ret[ret.maxAxis()];
+		}
+	}
+};
+
+// result[i] = s * a[i] + b[i], result may alias b
+struct btKrylovAxpyLoop : public btIParallelForBody
+{
+	btScalar m_s;
+	const btVector3* m_a;
+	const btVector3* m_b;
+	btVector3* m_result;
+
+	void forLoop(int iBegin, int iEnd) const
+	{
+		for (int i = iBegin; i < iEnd; ++i)
+		{
+			m_result[i] = m_s * m_a[i] + m_b[i];
+		}
+	}
+};
 
 template <class MatrixX>
 class btKrylovSolver
@@ -31,8 +112,11 @@ class btKrylovSolver
 public:
 	int m_maxIterations;
 	btScalar m_tolerance;
+	bool m_parallel;
+	btAlignedObjectArray<btScalar> m_blockSums;
+
 	btKrylovSolver(int maxIterations, btScalar tolerance)
-		: m_maxIterations(maxIterations), m_tolerance(tolerance)
+		: m_maxIterations(maxIterations), m_tolerance(tolerance), m_parallel(false)
 	{
 	}
 
@@ -48,6 +132,11 @@ public:
 		btAssert(a.size() == b.size());
 		TVStack c;
 		c.resize(a.size());
+		if (m_parallel)
+		{
+			axpy(-1, b, a, c);
+			return c;
+		}
 		for (int i = 0; i < a.size(); ++i)
 		{
 			c[i] = a[i] - b[i];
@@ -63,6 +152,20 @@ public:
 	virtual SIMD_FORCE_INLINE btScalar norm(const TVStack& a)
 	{
 		btScalar ret = 0;
+		if (m_parallel && a.size())
+		{
+			btKrylovMaxNormLoop loop;
+			loop.m_a = &a[0];
+			loop.m_size = a.size();
+			const int numBlocks = prepareBlocks(a.size());
+			loop.m_blockSums = &m_blockSums[0];
+			btKrylovParallelFor(numBlocks, 1, loop);
+			for (int i = 0; i < numBlocks; ++i)
+			{
+				ret = btMax(ret, m_blockSums[i]);
+			}
+			return ret;
+		}
 		for (int i = 0; i < a.size(); ++i)
 		{
 			for (int d = 0; d < 3; ++d)
@@ -76,6 +179,23 @@ public:
 	virtual SIMD_FORCE_INLINE btScalar dot(const TVStack& a, const TVStack& b)
 	{
 		btScalar ans(0);
+		if (m_parallel && a.size())
+		{
+			btAssert(a.size() == b.size());
+			btKrylovDotLoop loop;
+			loop.m_a = &a[0];
+			loop.m_b = &b[0];
+			loop.m_size = a.size();
+			const int numBlocks = prepareBlocks(a.size());
+			loop.m_blockSums = &m_blockSums[0];
+			btKrylovParallelFor(numBlocks, 1, loop);
+			// the blocks are summed in order, so the result does not depend on the number of threads
+			for (int i = 0; i < numBlocks; ++i)
+			{
+				ans += m_blockSums[i];
+			}
+			return ans;
+		}
 		for (int i = 0; i < a.size(); ++i)
 			ans += a[i].dot(b[i]);
 		return ans;
@@ -85,6 +205,11 @@ public:
 	{
 		//        result += s*a
 		btAssert(a.size() == result.size());
+		if (m_parallel)
+		{
+			axpy(s, a, result, result);
+			return;
+		}
 		for (int i = 0; i < a.size(); ++i)
 			result[i] += s * a[i];
 	}
@@ -94,11 +219,56 @@ public:
 		// result = a*s + b
 		TVStack result;
 		result.resize(a.size());
+		if (m_parallel)
+		{
+			axpy(s, a, b, result);
+			return result;
+		}
 		for (int i = 0; i < a.size(); ++i)
 			result[i] = s * a[i] + b[i];
 		return result;
 	}
 
+	virtual SIMD_FORCE_INLINE void multSelfAndAdd(btScalar s, TVStack& a, const TVStack& b)
+	{
+		// a = a*s + b, same as a = multAndAdd(s, a, b) without the temporary
+		btAssert(a.size() == b.size());
+		if (m_parallel)
+		{
+			axpy(s, a, b, a);
+			return;
+		}
+		for (int i = 0; i < a.size(); ++i)
+			a[i] = s * a[i] + b[i];
+	}
+
+	// Split the vector operations into fixed blocks of btKrylovBlockSize vectors that run with btParallelFor. The dot
+	// products sum the blocks in order, so the iterations do not depend on the number of threads, but they are rounded
+	// differently than the serial sums.
+	void setParallel(bool parallel)
+	{
+		m_parallel = parallel;
+	}
+
+	int prepareBlocks(int size)
+	{
+		const int numBlocks = (size + btKrylovBlockSize - 1) / btKrylovBlockSize;
+		m_blockSums.resizeNoInitialize(numBlocks);
+		return numBlocks;
+	}
+
+	void axpy(btScalar s, const TVStack& a, const TVStack& b, TVStack& result)
+	{
+		if (a.size() == 0)
+			return;
+		btKrylovAxpyLoop loop;
+		loop.m_s = s;
+		loop.m_a = &a[0];
+		loop.m_b = &b[0];
+		loop.m_result = &result[0];
+		btKrylovParallelFor(a.size(), btKrylovBlockSize, loop);
+	}
+
 	virtual SIMD_FORCE_INLINE void setTolerance(btScalar tolerance)
 	{
 		m_tolerance = tolerance;
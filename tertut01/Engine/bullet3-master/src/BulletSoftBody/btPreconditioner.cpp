@@ -0,0 +1,611 @@
+/*
+ Bullet Continuous Collision Detection and Physics Library
+ Copyright (c) 2019 Google Inc. http://bulletphysics.org
+ This software is provided 'as-is', without any express or implied warranty.
+ In no event will the authors be held liable for any damages arising from the use of this software.
+ Permission is granted to anyone to use this software for any purpose,
+ including commercial applications, and to alter it and redistribute it freely,
+ subject to the following restrictions:
+ 1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+ 2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+ 3. This notice may not be removed or altered from any source distribution.
+ */
+
+#include "btDeformableBackwardEulerObjective.h"
+#include "btPreconditioner.h"
+#include "LinearMath/btQuickprof.h"
+#include "LinearMath/btThreads.h"
+
+static void btPreconditionerParallelFor(int count, int grainSize, const btIParallelForBody& body)
+{
+#if BT_THREADSAFE
+	btITaskScheduler* scheduler = btGetTaskScheduler();
+	if (scheduler && scheduler->getNumThreads() > 1)
+	{
+		btParallelFor(0, count, grainSize, body);
+		return;
+	}
+#endif  // #if BT_THREADSAFE
+	body.forLoop(0, count);
+}
+
+struct btBlockJacobiLoop : public btIParallelForBody
+{
+	const btMatrix3x3* m_inv_A;
+	const btVector3* m_x;
+	btVector3* m_b;
+
+	void forLoop(int iBegin, int iEnd) const
+	{
+		for (int i = iBegin; i < iEnd; ++i)
+		{
+			m_b[i] = m_inv_A[i] * m_x[i];
+		}
+	}
+};
+
+struct btBlockEntry
+{
+	int m_row;
+	int m_col;
+};
+
+struct btBlockEntrySortPredicate
+{
+	bool operator()(const btBlockEntry& a, const btBlockEntry& b) const
+	{
+		return (a.m_row < b.m_row) || (a.m_row == b.m_row && a.m_col < b.m_col);
+	}
+};
+
+BlockJacobiPreconditioner::BlockJacobiPreconditioner(const btAlignedObjectArray<btSoftBody*>& softBodies, btDeformableContactProjection& projections, const btAlignedObjectArray<btDeformableLagrangianForce*>& lf, const btScalar& dt, const bool& implicit)
+	: m_softBodies(softBodies), m_projections(projections), m_lf(lf), m_dt(dt), m_implicit(implicit)
+{
+}
+
+void BlockJacobiPreconditioner::addBlock(int row, int col, const btMatrix3x3& block)
+{
+	if (row == col)
+	{
+		m_diagA[row] += block;
+	}
+}
+
+void BlockJacobiPreconditioner::gatherForces()
+{
+	int numNodes = 0;
+	for (int i = 0; i < m_softBodies.size(); ++i)
+	{
+		numNodes += m_softBodies[i]->m_nodes.size();
+	}
+	m_freeNodes.resize(numNodes);
+	for (int i = 0; i < m_softBodies.size(); ++i)
+	{
+		const btSoftBody* psb = m_softBodies[i];
+		for (int j = 0; j < psb->m_nodes.size(); ++j)
+		{
+			m_freeNodes[psb->m_nodes[j].index] = (psb->m_nodes[j].m_im > 0);
+		}
+	}
+
+	m_bodyForceOffsets.resize(m_softBodies.size() + 1);
+	m_bodyForces.resize(0);
+	for (int i = 0; i < m_softBodies.size(); ++i)
+	{
+		m_bodyForceOffsets[i] = m_bodyForces.size();
+		for (int j = 0; j < m_lf.size(); ++j)
+		{
+			if (m_lf[j]->getElementType() != BT_NO_ELEMENT && m_lf[j]->m_softBodies.findLinearSearch2(m_softBodies[i]) >= 0)
+			{
+				m_bodyForces.push_back(m_lf[j]);
+			}
+		}
+	}
+	m_bodyForceOffsets[m_softBodies.size()] = m_bodyForces.size();
+}
+
+void BlockJacobiPreconditioner::buildBlocks()
+{
+	const int numNodes = m_freeNodes.size();
+	btMatrix3x3 zero;
+	zero.setValue(0, 0, 0, 0, 0, 0, 0, 0, 0);
+	m_diagA.resize(numNodes);
+	for (int i = 0; i < numNodes; ++i)
+	{
+		m_diagA[i] = zero;
+	}
+
+	btMatrix3x3 I;
+	I.setIdentity();
+	btVector3 local_dx[4], local_df[4];
+	btMatrix3x3 blocks[4][4];
+	for (int i = 0; i < m_softBodies.size(); ++i)
+	{
+		const btSoftBody* psb = m_softBodies[i];
+		for (int j = 0; j < psb->m_nodes.size(); ++j)
+		{
+			const btSoftBody::Node& node = psb->m_nodes[j];
+			if (node.m_im > 0)
+			{
+				addBlock(node.index, node.index, I * (1.0 / node.m_im));
+			}
+		}
+		if (!psb->isActive())
+		{
+			continue;
+		}
+		for (int type = BT_TETRA_ELEMENT; type <= BT_LINK_ELEMENT; ++type)
+		{
+			const btDeformableElementType elementType = btDeformableElementType(type);
+			bool used = false;
+			for (int f = m_bodyForceOffsets[i]; f < m_bodyForceOffsets[i + 1]; ++f)
+			{
+				used |= (m_bodyForces[f]->getElementType() == elementType);
+			}
+			if (!used)
+			{
+				continue;
+			}
+			const int numElementNodes = btDeformableLagrangianForce::getElementNumNodes(elementType);
+			const int numElements = btDeformableLagrangianForce::getNumElements(psb, elementType);
+			for (int j = 0; j < numElements; ++j)
+			{
+				// the element is linear in dx, so each unit dx gives one column of its blocks
+				for (int a = 0; a < numElementNodes; ++a)
+				{
+					for (int d = 0; d < 3; ++d)
+					{
+						for (int k = 0; k < numElementNodes; ++k)
+						{
+							local_dx[k].setZero();
+							local_df[k].setZero();
+						}
+						local_dx[a][d] = 1;
+						for (int f = m_bodyForceOffsets[i]; f < m_bodyForceOffsets[i + 1]; ++f)
+						{
+							btDeformableLagrangianForce* force = m_bodyForces[f];
+							if (force->getElementType() != elementType)
+							{
+								continue;
+							}
+							force->addScaledElementDampingForceDifferential(-m_dt, psb, j, local_dx, local_df);
+							if (m_implicit)
+							{
+								force->addScaledElementElasticForceDifferential(-m_dt * m_dt, psb, j, local_dx, local_df);
+							}
+						}
+						for (int k = 0; k < numElementNodes; ++k)
+						{
+							for (int r = 0; r < 3; ++r)
+							{
+								blocks[k][a][r][d] = local_df[k][r];
+							}
+						}
+					}
+				}
+				for (int k = 0; k < numElementNodes; ++k)
+				{
+					const btSoftBody::Node* nk = btDeformableLagrangianForce::getElementNode(psb, elementType, j, k);
+					for (int a = 0; a < numElementNodes; ++a)
+					{
+						const btSoftBody::Node* na = btDeformableLagrangianForce::getElementNode(psb, elementType, j, a);
+						if (nk->m_im > 0 && na->m_im > 0)
+						{
+							addBlock(nk->index, na->index, blocks[k][a]);
+						}
+					}
+				}
+			}
+		}
+		for (int j = 0; j < psb->m_nodes.size(); ++j)
+		{
+			const btSoftBody::Node& node = psb->m_nodes[j];
+			if (node.m_im == 0)
+			{
+				continue;
+			}
+			btMatrix3x3 block = zero;
+			for (int d = 0; d < 3; ++d)
+			{
+				btVector3 dv(0, 0, 0), df(0, 0, 0);
+				dv[d] = 1;
+				for (int f = m_bodyForceOffsets[i]; f < m_bodyForceOffsets[i + 1]; ++f)
+				{
+					m_bodyForces[f]->addScaledNodeDampingForceDifferential(-m_dt, node, dv, df);
+				}
+				for (int r = 0; r < 3; ++r)
+				{
+					block[r][d] = df[r];
+				}
+			}
+			addBlock(node.index, node.index, block);
+		}
+	}
+
+	// forces without an element-wise form only contribute the diagonal blocks of their differentials
+	TVStack dx, df;
+	for (int i = 0; i < m_lf.size(); ++i)
+	{
+		btDeformableLagrangianForce* force = m_lf[i];
+		if (force->getElementType() != BT_NO_ELEMENT || force->getForceType() == BT_GRAVITY_FORCE)
+		{
+			continue;
+		}
+		dx.resize(numNodes);
+		df.resize(numNodes);
+		btMatrix3x3 block;
+		for (int d = 0; d < 3; ++d)
+		{
+			for (int j = 0; j < numNodes; ++j)
+			{
+				dx[j].setZero();
+				dx[j][d] = 1;
+				df[j].setZero();
+			}
+			force->addScaledDampingForceDifferential(-m_dt, dx, df);
+			if (m_implicit || force->getForceType() == BT_MOUSE_PICKING_FORCE)
+			{
+				force->addScaledElasticForceDifferential(-m_dt * m_dt, dx, df);
+			}
+			for (int j = 0; j < numNodes; ++j)
+			{
+				if (!df[j].isZero())
+				{
+					block = zero;
+					for (int r = 0; r < 3; ++r)
+					{
+						block[r][d] = df[j][r];
+					}
+					addBlock(j, j, block);
+				}
+			}
+		}
+	}
+
+	m_inv_A.resize(numNodes);
+	for (int i = 0; i < m_softBodies.size(); ++i)
+	{
+		const btSoftBody* psb = m_softBodies[i];
+		for (int j = 0; j < psb->m_nodes.size(); ++j)
+		{
+			const btSoftBody::Node& node = psb->m_nodes[j];
+			const btMatrix3x3& A = m_diagA[node.index];
+			btMatrix3x3& inv = m_inv_A[node.index];
+			inv = zero;
+			if (node.m_im == 0)
+			{
+				continue;
+			}
+			if (A.determinant() > SIMD_EPSILON * btFabs(A[0][0] * A[1][1] * A[2][2]))
+			{
+				inv = A.inverse();
+			}
+			else
+			{
+				for (int d = 0; d < 3; ++d)
+				{
+					inv[d][d] = (A[d][d] > 0) ? 1.0 / A[d][d] : 0;
+				}
+			}
+		}
+	}
+
+	m_inv_S.resize(m_projections.m_lagrangeMultipliers.size());
+	for (int c = 0; c < m_projections.m_lagrangeMultipliers.size(); ++c)
+	{
+		// S[k,k] = e_k^T * C A_d^-1 C^T * e_k
+		const LagrangeMultiplier& lm = m_projections.m_lagrangeMultipliers[c];
+		btVector3& t = m_inv_S[c];
+		t.setZero();
+		for (int j = 0; j < lm.m_num_constraints; ++j)
+		{
+			for (int i = 0; i < lm.m_num_nodes; ++i)
+			{
+				t[j] += lm.m_dirs[j].dot(m_inv_A[lm.m_indices[i]] * lm.m_dirs[j]) * lm.m_weights[i] * lm.m_weights[i];
+			}
+		}
+		for (int d = 0; d < 3; ++d)
+		{
+			t[d] = (t[d] == 0) ? 0.0 : 1.0 / t[d];
+		}
+	}
+}
+
+void BlockJacobiPreconditioner::update()
+{
+	BT_PROFILE("BlockJacobiPreconditioner::update");
+	gatherForces();
+	buildBlocks();
+}
+
+void BlockJacobiPreconditioner::applyBlockJacobi(const TVStack& x, TVStack& b) const
+{
+	btAssert(b.size() == x.size());
+	btAssert(m_inv_A.size() + m_inv_S.size() == x.size());
+	if (m_inv_A.size())
+	{
+		btBlockJacobiLoop loop;
+		loop.m_inv_A = &m_inv_A[0];
+		loop.m_x = &x[0];
+		loop.m_b = &b[0];
+		btPreconditionerParallelFor(m_inv_A.size(), 256, loop);
+	}
+	int offset = m_inv_A.size();
+	for (int i = 0; i < m_inv_S.size(); ++i)
+	{
+		b[i + offset] = x[i + offset] * m_inv_S[i];
+	}
+}
+
+void BlockJacobiPreconditioner::operator()(const TVStack& x, TVStack& b)
+{
+	applyBlockJacobi(x, b);
+	m_projections.project(b);
+}
+
+IncompleteCholeskyPreconditioner::IncompleteCholeskyPreconditioner(const btAlignedObjectArray<btSoftBody*>& softBodies, btDeformableContactProjection& projections, const btAlignedObjectArray<btDeformableLagrangianForce*>& lf, const btScalar& dt, const bool& implicit)
+	: BlockJacobiPreconditioner(softBodies, projections, lf, dt, implicit), m_factorized(false)
+{
+}
+
+void IncompleteCholeskyPreconditioner::buildStructure()
+{
+	const int numNodes = m_freeNodes.size();
+
+	// strictly lower blocks coupling two free nodes of an element of a force
+	btAlignedObjectArray<btBlockEntry> entries;
+	for (int i = 0; i < m_softBodies.size(); ++i)
+	{
+		const btSoftBody* psb = m_softBodies[i];
+		if (!psb->isActive())
+		{
+			continue;
+		}
+		for (int type = BT_TETRA_ELEMENT; type <= BT_LINK_ELEMENT; ++type)
+		{
+			const btDeformableElementType elementType = btDeformableElementType(type);
+			bool used = false;
+			for (int f = m_bodyForceOffsets[i]; f < m_bodyForceOffsets[i + 1]; ++f)
+			{
+				used |= (m_bodyForces[f]->getElementType() == elementType);
+			}
+			if (!used)
+			{
+				continue;
+			}
+			const int numElementNodes = btDeformableLagrangianForce::getElementNumNodes(elementType);
+			const int numElements = btDeformableLagrangianForce::getNumElements(psb, elementType);
+			for (int j = 0; j < numElements; ++j)
+			{
+				for (int k = 0; k < numElementNodes; ++k)
+				{
+					const btSoftBody::Node* nk = btDeformableLagrangianForce::getElementNode(psb, elementType, j, k);
+					for (int a = 0; a < numElementNodes; ++a)
+					{
+						const btSoftBody::Node* na = btDeformableLagrangianForce::getElementNode(psb, elementType, j, a);
+						if (nk->index > na->index && nk->m_im > 0 && na->m_im > 0)
+						{
+							btBlockEntry entry;
+							entry.m_row = nk->index;
+							entry.m_col = na->index;
+							entries.push_back(entry);
+						}
+					}
+				}
+			}
+		}
+	}
+	entries.quickSort(btBlockEntrySortPredicate());
+
+	m_blockRowOffsets.resize(numNodes + 1);
+	m_blockCols.resize(0);
+	int e = 0;
+	for (int i = 0; i < numNodes; ++i)
+	{
+		m_blockRowOffsets[i] = m_blockCols.size();
+		for (; e < entries.size() && entries[e].m_row == i; ++e)
+		{
+			if (m_blockCols.size() == m_blockRowOffsets[i] || m_blockCols[m_blockCols.size() - 1] != entries[e].m_col)
+			{
+				m_blockCols.push_back(entries[e].m_col);
+			}
+		}
+	}
+	m_blockRowOffsets[numNodes] = m_blockCols.size();
+	btMatrix3x3 zero;
+	zero.setValue(0, 0, 0, 0, 0, 0, 0, 0, 0);
+	m_blocks.resize(m_blockCols.size());
+	for (int i = 0; i < m_blocks.size(); ++i)
+	{
+		m_blocks[i] = zero;
+	}
+
+	// one scalar row per degree of freedom, the columns of a row are sorted and the rows of fixed nodes are empty
+	m_rowOffsets.resize(3 * numNodes + 1);
+	m_cols.resize(0);
+	for (int i = 0; i < numNodes; ++i)
+	{
+		for (int d = 0; d < 3; ++d)
+		{
+			m_rowOffsets[3 * i + d] = m_cols.size();
+			if (!m_freeNodes[i])
+			{
+				continue;
+			}
+			for (int k = m_blockRowOffsets[i]; k < m_blockRowOffsets[i + 1]; ++k)
+			{
+				for (int c = 0; c < 3; ++c)
+				{
+					m_cols.push_back(3 * m_blockCols[k] + c);
+				}
+			}
+			for (int c = 0; c < d; ++c)
+			{
+				m_cols.push_back(3 * i + c);
+			}
+		}
+	}
+	m_rowOffsets[3 * numNodes] = m_cols.size();
+	m_values.resize(m_cols.size());
+	m_diagL.resize(3 * numNodes);
+	m_y.resize(3 * numNodes);
+}
+
+void IncompleteCholeskyPreconditioner::addBlock(int row, int col, const btMatrix3x3& block)
+{
+	if (row == col)
+	{
+		m_diagA[row] += block;
+	}
+	else if (row > col)
+	{
+		// the blocks of a row are sorted by column
+		int lo = m_blockRowOffsets[row], hi = m_blockRowOffsets[row + 1];
+		while (lo < hi)
+		{
+			int mid = (lo + hi) / 2;
+			if (m_blockCols[mid] < col)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+		btAssert(lo < m_blockRowOffsets[row + 1] && m_blockCols[lo] == col);
+		m_blocks[lo] += block;
+	}
+}
+
+bool IncompleteCholeskyPreconditioner::factorize()
+{
+	const int numNodes = m_diagA.size();
+	for (int i = 0; i < numNodes; ++i)
+	{
+		if (!m_freeNodes[i])
+		{
+			continue;
+		}
+		for (int d = 0; d < 3; ++d)
+		{
+			int p = m_rowOffsets[3 * i + d];
+			for (int k = m_blockRowOffsets[i]; k < m_blockRowOffsets[i + 1]; ++k)
+			{
+				for (int c = 0; c < 3; ++c)
+				{
+					m_values[p++] = m_blocks[k][d][c];
+				}
+			}
+			for (int c = 0; c < d; ++c)
+			{
+				m_values[p++] = m_diagA[i][d][c];
+			}
+		}
+	}
+
+	for (int i = 0; i < numNodes; ++i)
+	{
+		for (int d = 0; d < 3; ++d)
+		{
+			const int r = 3 * i + d;
+			const int rowBegin = m_rowOffsets[r];
+			const int rowEnd = m_rowOffsets[r + 1];
+			if (!m_freeNodes[i])
+			{
+				m_diagL[r] = 1;
+				continue;
+			}
+			btScalar diag = m_diagA[i][d][d];
+			for (int p = rowBegin; p < rowEnd; ++p)
+			{
+				const int c = m_cols[p];
+				// L(r, c) = (A(r, c) - sum_k L(r, k) * L(c, k)) / L(c, c) over the columns k < c in both rows
+				btScalar sum = m_values[p];
+				int pr = rowBegin, pc = m_rowOffsets[c];
+				const int cEnd = m_rowOffsets[c + 1];
+				while (pr < p && pc < cEnd)
+				{
+					if (m_cols[pr] == m_cols[pc])
+					{
+						sum -= m_values[pr++] * m_values[pc++];
+					}
+					else if (m_cols[pr] < m_cols[pc])
+					{
+						++pr;
+					}
+					else
+					{
+						++pc;
+					}
+				}
+				m_values[p] = sum / m_diagL[c];
+				diag -= m_values[p] * m_values[p];
+			}
+			if (!(diag > SIMD_EPSILON * m_diagA[i][d][d]))
+			{
+				return false;
+			}
+			m_diagL[r] = btSqrt(diag);
+		}
+	}
+	return true;
+}
+
+void IncompleteCholeskyPreconditioner::update()
+{
+	BT_PROFILE("IncompleteCholeskyPreconditioner::update");
+	gatherForces();
+	buildStructure();
+	buildBlocks();
+	m_factorized = factorize();
+}
+
+void IncompleteCholeskyPreconditioner::operator()(const TVStack& x, TVStack& b)
+{
+	if (!m_factorized)
+	{
+		applyBlockJacobi(x, b);
+		m_projections.project(b);
+		return;
+	}
+	btAssert(b.size() == x.size());
+	const int numNodes = m_diagA.size();
+	const int n = 3 * numNodes;
+	for (int i = 0; i < numNodes; ++i)
+	{
+		for (int d = 0; d < 3; ++d)
+		{
+			m_y[3 * i + d] = x[i][d];
+		}
+	}
+	// L * y = x
+	for (int r = 0; r < n; ++r)
+	{
+		btScalar sum = m_y[r];
+		for (int p = m_rowOffsets[r]; p < m_rowOffsets[r + 1]; ++p)
+		{
+			sum -= m_values[p] * m_y[m_cols[p]];
+		}
+		m_y[r] = sum / m_diagL[r];
+	}
+	// L^T * z = y
+	for (int r = n - 1; r >= 0; --r)
+	{
+		const btScalar z = m_y[r] / m_diagL[r];
+		m_y[r] = z;
+		for (int p = m_rowOffsets[r]; p < m_rowOffsets[r + 1]; ++p)
+		{
+			m_y[m_cols[p]] -= m_values[p] * z;
+		}
+	}
+	for (int i = 0; i < numNodes; ++i)
+	{
+		if (m_freeNodes[i])
+			b[i].setValue(m_y[3 * i], m_y[3 * i + 1], m_y[3 * i + 2]);
+		else
+			b[i].setZero();
+	}
+	int offset = numNodes;
+	for (int i = 0; i < m_inv_S.size(); ++i)
+	{
+		b[i + offset] = x[i + offset] * m_inv_S[i];
+	}
+	m_projections.project(b);
+}
@@ -22,6 +22,8 @@ public:
 	typedef btAlignedObjectArray<btVector3> TVStack;
 	virtual void operator()(const TVStack& x, TVStack& b) = 0;
 	virtual void reinitialize(bool nodeUpdated) = 0;
+	// rebuild the parts that depend on the current state right before a linear solve
+	virtual void update() {}
 	virtual ~Preconditioner() {}
 };
 
@@ -282,4 +284,83 @@ public:
 #endif
 };
 
+// Inverts the 3x3 diagonal blocks of A = M - dt * D (- dt^2 * K for the implicit scheme), built from the element-wise
+// force differentials. Forces without an element-wise form contribute the diagonal blocks of their differentials, which
+// is exact for forces like mouse picking that act on single nodes. The lagrange multipliers use the diagonal of the
+// Schur complement like KKTPreconditioner. The blocks couple the components of a node, so the result is projected again
+// to keep the conjugate gradient directions in the subspace allowed by the contact projections.
+class BlockJacobiPreconditioner : public Preconditioner
+{
+protected:
+	const btAlignedObjectArray<btSoftBody*>& m_softBodies;
+	btDeformableContactProjection& m_projections;
+	const btAlignedObjectArray<btDeformableLagrangianForce*>& m_lf;
+	const btScalar& m_dt;
+	const bool& m_implicit;
+	btAlignedObjectArray<btMatrix3x3> m_diagA;  // the diagonal blocks of A
+	btAlignedObjectArray<btMatrix3x3> m_inv_A;  // their inverses, zero for fixed nodes
+	TVStack m_inv_S;
+	btAlignedObjectArray<bool> m_freeNodes;      // nodes with m_im > 0, the others get no preconditioned value
+	btAlignedObjectArray<int> m_bodyForceOffsets;  // element forces of soft body i are [m_bodyForceOffsets[i], m_bodyForceOffsets[i+1])
+	btAlignedObjectArray<btDeformableLagrangianForce*> m_bodyForces;
+
+	// called for each element and node contribution A(row, col) += block while the blocks are built
+	virtual void addBlock(int row, int col, const btMatrix3x3& block);
+
+	// find the free nodes and the element forces of each soft body
+	void gatherForces();
+
+	// assemble the contributions of all forces and invert the diagonal blocks
+	void buildBlocks();
+
+	void applyBlockJacobi(const TVStack& x, TVStack& b) const;
+
+public:
+	BlockJacobiPreconditioner(const btAlignedObjectArray<btSoftBody*>& softBodies, btDeformableContactProjection& projections, const btAlignedObjectArray<btDeformableLagrangianForce*>& lf, const btScalar& dt, const bool& implicit);
+
+	virtual ~BlockJacobiPreconditioner() {}
+
+	virtual void reinitialize(bool nodeUpdated) {}
+
+	virtual void update();
+
+	virtual void operator()(const TVStack& x, TVStack& b);
+};
+
+// Incomplete Cholesky factorization with zero fill-in, A ~ L * L^T, on the sparsity of the node adjacency of the
+// elements. The factorization and the triangular solves are serial. If a pivot is not positive, which can happen when
+// an implicit elastic Hessian is indefinite, the block Jacobi preconditioner is used until the next update.
+class IncompleteCholeskyPreconditioner : public BlockJacobiPreconditioner
+{
+	btAlignedObjectArray<int> m_blockRowOffsets;  // strictly lower blocks of node row i are [m_blockRowOffsets[i], m_blockRowOffsets[i+1])
+	btAlignedObjectArray<int> m_blockCols;
+	btAlignedObjectArray<btMatrix3x3> m_blocks;
+	btAlignedObjectArray<int> m_rowOffsets;  // lower triangle of L in compressed rows, one row per degree of freedom
+	btAlignedObjectArray<int> m_cols;
+	btAlignedObjectArray<btScalar> m_values;
+	btAlignedObjectArray<btScalar> m_diagL;
+	btAlignedObjectArray<btScalar> m_y;
+	bool m_factorized;
+
+	void buildStructure();
+	bool factorize();
+
+protected:
+	virtual void addBlock(int row, int col, const btMatrix3x3& block);
+
+public:
+	IncompleteCholeskyPreconditioner(const btAlignedObjectArray<btSoftBody*>& softBodies, btDeformableContactProjection& projections, const btAlignedObjectArray<btDeformableLagrangianForce*>& lf, const btScalar& dt, const bool& implicit);
+
+	virtual ~IncompleteCholeskyPreconditioner() {}
+
+	virtual void update();
+
+	virtual void operator()(const TVStack& x, TVStack& b);
+
+	bool isFactorized() const
+	{
+		return m_factorized;
+	}
+};
+
 #endif /* BT_PRECONDITIONER_H */
@@ -2,6 +2,7 @@
 #include "LinearMath/btMinMax.h"
 #include "LinearMath/btAlignedObjectArray.h"
 #include "LinearMath/btThreads.h"
+#include "LinearMath/btTaskGraph.h"
 #include "LinearMath/btQuickprof.h"
 #include <stdio.h>
 #include <algorithm>
@@ -18,6 +19,15 @@
 
 #endif
 
+#if __cplusplus >= 201103L || (defined(_MSC_VER) && _MSC_VER >= 1700)
+
+// the task graph needs atomic counters and deques, without C++11 atomics task graphs run on the main thread
+#define BT_TASK_GRAPH_USE_CPP11_ATOMICS 1
+#include <atomic>
+#include <thread>
+
+#endif
+
 typedef unsigned long long btU64;
 static const int kCacheLineSize = 64;
 
@@ -153,6 +163,192 @@ public:
 	}
 };
 
+#if BT_TASK_GRAPH_USE_CPP11_ATOMICS
+
+static inline std::atomic<int>& btAtomicInt(int& value)
+{
+	return *reinterpret_cast<std::atomic<int>*>(&value);
+}
+
+///
+/// TaskDeque -- Chase-Lev work-stealing deque of task indexes.
+///              The owning thread pushes and pops at the bottom without locking, other threads
+///              steal from the top with a compare-and-swap.
+///              Each task of a graph is pushed at most once, so a deque with room for every task never wraps around.
+///
+ATTRIBUTE_ALIGNED64(class)
+TaskDeque
+{
+	int m_top;  // advanced by thieves (and by the owner when it takes the last task)
+	char m_topPadding[kCacheLineSize];  // prevent false sharing between owner and thieves
+	int m_bottom;  // only written by the owner
+	btAlignedObjectArray<int> m_tasks;
+	char m_cachePadding[kCacheLineSize];  // prevent false sharing
+
+public:
+	TaskDeque()
+	{
+		m_top = 0;
+		m_bottom = 0;
+	}
+	void reset(int capacity)
+	{
+		m_top = 0;
+		m_bottom = 0;
+		if (m_tasks.size() < capacity)
+		{
+			m_tasks.resize(capacity);
+		}
+	}
+	void push(int task)
+	{
+		int bottom = btAtomicInt(m_bottom).load(std::memory_order_relaxed);
+		btAssert(bottom < m_tasks.size());
+		btAtomicInt(m_tasks[bottom]).store(task, std::memory_order_relaxed);
+		btAtomicInt(m_bottom).store(bottom + 1, std::memory_order_release);
+	}
+	// returns -1 if the deque is empty
+	int pop()
+	{
+		int bottom = btAtomicInt(m_bottom).load(std::memory_order_relaxed) - 1;
+		btAtomicInt(m_bottom).store(bottom, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int top = btAtomicInt(m_top).load(std::memory_order_relaxed);
+		int task = -1;
+		if (top <= bottom)
+		{
+			task = btAtomicInt(m_tasks[bottom]).load(std::memory_order_relaxed);
+			if (top == bottom)
+			{
+				// last task, race the thieves for it
+				if (!btAtomicInt(m_top).compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+				{
+					task = -1;
+				}
+				btAtomicInt(m_bottom).store(bottom + 1, std::memory_order_relaxed);
+			}
+		}
+		else
+		{
+			btAtomicInt(m_bottom).store(bottom + 1, std::memory_order_relaxed);
+		}
+		return task;
+	}
+	// returns -1 if the deque is empty or another thread got there first
+	int steal()
+	{
+		int top = btAtomicInt(m_top).load(std::memory_order_acquire);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int bottom = btAtomicInt(m_bottom).load(std::memory_order_acquire);
+		if (top < bottom)
+		{
+			int task = btAtomicInt(m_tasks[top]).load(std::memory_order_relaxed);
+			if (btAtomicInt(m_top).compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+			{
+				return task;
+			}
+		}
+		return -1;
+	}
+};
+
+///
+/// TaskGraphRun -- state shared by all threads while a btTaskGraph runs
+///
+ATTRIBUTE_ALIGNED64(struct)
+TaskGraphRun
+{
+	btTaskGraph* m_graph;
+	TaskDeque* m_deques;  // one per thread, indexed by thread id
+	int m_numDeques;
+	char m_cachePadding[kCacheLineSize];  // keep the counter below off the cacheline that is only read
+	int m_numTasksRemaining;
+
+	int stealTask(int threadId)
+	{
+		for (int i = 1; i < m_numDeques; ++i)
+		{
+			int victim = (threadId + i) % m_numDeques;
+			int task = m_deques[victim].steal();
+			if (task >= 0)
+			{
+				return task;
+			}
+		}
+		return -1;
+	}
+
+	// runs tasks until every task of the graph has finished
+	void execute(int threadId)
+	{
+		BT_PROFILE("executeTaskGraph");
+		btAssert(threadId < m_numDeques);
+		TaskDeque& deque = m_deques[threadId];
+		int* pendingCounts = m_graph->getPendingCounts();
+		int numIdleSpins = 0;
+		while (btAtomicInt(m_numTasksRemaining).load(std::memory_order_acquire) > 0)
+		{
+			int task = deque.pop();
+			if (task < 0)
+			{
+				task = stealTask(threadId);
+			}
+			if (task < 0)
+			{
+				// the thread holding the remaining work may have been preempted, give it a chance to run
+				if (++numIdleSpins > 64)
+				{
+					std::this_thread::yield();
+				}
+				btSpinPause();
+				continue;
+			}
+			numIdleSpins = 0;
+			while (task >= 0)
+			{
+				m_graph->runTask(task);
+				// the first successor that becomes ready runs next on this thread, the others go to the deque
+				int continuation = -1;
+				for (int i = 0; i < m_graph->getNumSuccessors(task); ++i)
+				{
+					int successor = m_graph->getSuccessor(task, i);
+					if (btAtomicInt(pendingCounts[successor]).fetch_sub(1, std::memory_order_acq_rel) == 1)
+					{
+						if (continuation < 0)
+						{
+							continuation = successor;
+						}
+						else
+						{
+							deque.push(successor);
+						}
+					}
+				}
+				btAtomicInt(m_numTasksRemaining).fetch_sub(1, std::memory_order_release);
+				task = continuation;
+			}
+		}
+	}
+};
+
+class TaskGraphJob : public IJob
+{
+	TaskGraphRun* m_run;
+
+public:
+	TaskGraphJob(TaskGraphRun* run)
+	{
+		m_run = run;
+	}
+	virtual void executeJob(int threadId) BT_OVERRIDE
+	{
+		// each worker gets one of these, it returns once the whole graph is done
+		m_run->execute(threadId);
+	}
+};
+
+#endif  // #if BT_TASK_GRAPH_USE_CPP11_ATOMICS
+
 ATTRIBUTE_ALIGNED64(class)
 JobQueue
 {
@@ -199,6 +395,7 @@ public:
 		m_queueLock = NULL;
 		m_headIndex = 0;
 		m_tailIndex = 0;
+		m_queueIsEmpty = true;
 		m_useSpinMutex = false;
 	}
 	~JobQueue()
@@ -428,6 +625,10 @@ class btTaskSchedulerDefault : public btITaskScheduler
 	btAlignedObjectArray<JobQueue*> m_perThreadJobQueues;
 	btAlignedObjectArray<ThreadLocalStorage> m_threadLocalStorage;
 	btSpinMutex m_antiNestingLock;  // prevent nested parallel-for
+#if BT_TASK_GRAPH_USE_CPP11_ATOMICS
+	btAlignedObjectArray<TaskDeque> m_taskDeques;  // one per thread
+	TaskGraphRun m_taskGraphRun;
+#endif  // #if BT_TASK_GRAPH_USE_CPP11_ATOMICS
 	btClock m_clock;
 	int m_numThreads;
 	int m_numWorkerThreads;
@@ -464,9 +665,10 @@ public:
 		}
 	}
 
-	void init()
+	void init(int numThreads)
 	{
 		btThreadSupportInterface::ConstructionInfo constructionInfo("TaskScheduler", WorkerThreadFunc);
+		constructionInfo.m_numThreads = numThreads;
 		m_threadSupport = btThreadSupportInterface::create(constructionInfo);
 		m_workerDirective = static_cast<WorkerThreadDirectives*>(btAlignedAlloc(sizeof(*m_workerDirective), 64));
 
@@ -773,18 +975,86 @@ public:
 			return body.sumLoop(iBegin, iEnd);
 		}
 	}
+
+#if BT_TASK_GRAPH_USE_CPP11_ATOMICS
+	virtual void runTaskGraph(btTaskGraph& graph) BT_OVERRIDE
+	{
+		BT_PROFILE("runTaskGraph_ThreadSupport");
+		int numTasks = graph.getNumTasks();
+		if (numTasks > 1 && m_numWorkerThreads > 0 && m_antiNestingLock.tryLock())
+		{
+			if (!graph.prepare())
+			{
+				btAssert(!"btTaskGraph has a dependency cycle");
+				m_antiNestingLock.unlock();
+				return;
+			}
+			typedef TaskGraphJob JobType;
+			// one long running job per worker, the tasks themselves are handed out by the deques
+			int jobCount = m_numWorkerThreads;
+			m_numJobs = jobCount;
+			int jobSize = sizeof(JobType);
+			for (int i = 0; i < m_numActiveJobQueues; ++i)
+			{
+				m_jobQueues[i].clearQueue(jobCount, jobSize);
+			}
+
+			if (m_taskDeques.size() < m_numThreads)
+			{
+				m_taskDeques.resize(m_numThreads);
+			}
+			for (int i = 0; i < m_numThreads; ++i)
+			{
+				m_taskDeques[i].reset(numTasks);
+			}
+			// spread the root tasks over all threads, the main thread included
+			const btAlignedObjectArray<int>& rootTasks = graph.getRootTasks();
+			for (int i = 0; i < rootTasks.size(); ++i)
+			{
+				m_taskDeques[i % m_numThreads].push(rootTasks[i]);
+			}
+			m_taskGraphRun.m_graph = &graph;
+			m_taskGraphRun.m_deques = &m_taskDeques[0];
+			m_taskGraphRun.m_numDeques = m_numThreads;
+			m_taskGraphRun.m_numTasksRemaining = numTasks;
+
+			// prepare worker threads for incoming work
+			prepareWorkerThreads();
+			for (int iThread = kFirstWorkerThreadId; iThread < m_numThreads; ++iThread)
+			{
+				JobQueue* jq = m_perThreadJobQueues[iThread];
+				btAssert(jq);
+				void* jobMem = jq->allocJobMem(jobSize);
+				JobType* job = new (jobMem) TaskGraphJob(&m_taskGraphRun);  // placement new
+				jq->submitJob(job);
+			}
+			wakeWorkers(jobCount);
+
+			// the main thread takes part in running the graph, then waits for the workers to return
+			m_taskGraphRun.execute(0);
+			waitJobs();
+			m_antiNestingLock.unlock();
+		}
+		else
+		{
+			BT_PROFILE("runTaskGraph_mainThread");
+			// just run on main thread
+			graph.runSequential();
+		}
+	}
+#endif  // #if BT_TASK_GRAPH_USE_CPP11_ATOMICS
 };
 
-btITaskScheduler* btCreateDefaultTaskScheduler()
+btITaskScheduler* btCreateDefaultTaskScheduler(int numThreads)
 {
 	btTaskSchedulerDefault* ts = new btTaskSchedulerDefault();
-	ts->init();
+	ts->init(numThreads);
 	return ts;
 }
 
 #else  // #if BT_THREADSAFE
 
-btITaskScheduler* btCreateDefaultTaskScheduler()
+btITaskScheduler* btCreateDefaultTaskScheduler(int)
 {
 	return NULL;
 }
@@ -212,6 +212,22 @@ void btThreadSupportPosix::runTask(int threadIndex, void* userData)
 	btThreadStatus& threadStatus = m_activeThreadStatus[threadIndex];
 	btAssert(threadIndex >= 0);
 	btAssert(threadIndex < m_activeThreadStatus.size());
+	if (m_startedThreadsMask & (UINT64(1) << threadIndex))
+	{
+		// the task scheduler sees a worker asleep just before its task returns, and before a task it was started
+		// with gets to run. A task that is still running picks up the new jobs or misses this round, one that
+		// returned is collected first, or its response would be taken for the end of the new task
+		m_cs->lock();
+		bool hasFinished = (2 == threadStatus.m_status);
+		m_cs->unlock();
+		if (!hasFinished)
+		{
+			return;
+		}
+		checkPThreadFunction(sem_wait(m_mainSemaphore));
+		threadStatus.m_status = 0;
+		m_startedThreadsMask &= ~(UINT64(1) << threadIndex);
+	}
 	threadStatus.m_cs = m_cs;
 	threadStatus.m_commandId = 1;
 	threadStatus.m_status = 1;
@@ -269,7 +285,9 @@ void btThreadSupportPosix::waitForAllTasks()
 
 void btThreadSupportPosix::startThreads(const ConstructionInfo& threadConstructionInfo)
 {
-	m_numThreads = btGetNumHardwareThreads() - 1;  // main thread exists already
+	// one thread per hardware thread, unless the caller asked for more or less
+	int numThreads = threadConstructionInfo.m_numThreads > 0 ? threadConstructionInfo.m_numThreads : btGetNumHardwareThreads();
+	m_numThreads = btMin(numThreads, int(BT_MAX_THREAD_COUNT)) - 1;  // main thread exists already
 	m_activeThreadStatus.resize(m_numThreads);
 	m_startedThreadsMask = 0;
 
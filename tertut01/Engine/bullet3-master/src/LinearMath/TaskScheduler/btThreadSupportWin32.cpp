@@ -259,6 +259,19 @@ void btThreadSupportWin32::runTask(int threadIndex, void* userData)
 	btThreadStatus& threadStatus = m_activeThreadStatus[threadIndex];
 	btAssert(threadIndex >= 0);
 	btAssert(int(threadIndex) < m_activeThreadStatus.size());
+	if (m_startedThreadMask & (DWORD_PTR(1) << threadIndex))
+	{
+		// the task scheduler sees a worker asleep just before its task returns, and before a task it was started
+		// with gets to run. A task that is still running picks up the new jobs or misses this round, one that
+		// returned is collected first, or its completion event would be taken for the end of the new task
+		if (threadStatus.m_status != 2)
+		{
+			return;
+		}
+		WaitForSingleObject(threadStatus.m_eventCompleteHandle, INFINITE);
+		threadStatus.m_status = 0;
+		m_startedThreadMask &= ~(DWORD_PTR(1) << threadIndex);
+	}
 
 	threadStatus.m_commandId = 1;
 	threadStatus.m_status = 1;
@@ -313,8 +326,9 @@ void btThreadSupportWin32::startThreads(const ConstructionInfo& threadConstructi
 	{
 		dwProcessAffinityMask = 0;
 	}
-	///The number of threads should be equal to the number of available cores - 1
-	m_numThreads = btMin(procInfo.numLogicalProcessors, int(BT_MAX_THREAD_COUNT)) - 1;  // cap to max thread count (-1 because main thread already exists)
+	///The number of threads should be equal to the number of available cores - 1, unless the caller asked for more or less
+	int numThreads = threadConstructionInfo.m_numThreads > 0 ? threadConstructionInfo.m_numThreads : procInfo.numLogicalProcessors;
+	m_numThreads = btMin(numThreads, int(BT_MAX_THREAD_COUNT)) - 1;  // cap to max thread count (-1 because main thread already exists)
 
 	m_activeThreadStatus.resize(m_numThreads);
 	m_completeHandles.resize(m_numThreads);
@@ -358,7 +372,7 @@ void btThreadSupportWin32::startThreads(const ConstructionInfo& threadConstructi
 		//SetThreadPriority( handle, THREAD_PRIORITY_BELOW_NORMAL );
 
 		{
-			int processorId = i + 1;  // leave processor 0 for main thread
+			int processorId = (i + 1) % procInfo.numLogicalProcessors;  // leave processor 0 for main thread, unless there are more threads than processors
 			DWORD_PTR teamMask = getProcessorTeamMask(procInfo, processorId);
 			if (teamMask)
 			{
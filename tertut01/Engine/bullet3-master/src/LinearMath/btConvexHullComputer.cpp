@@ -18,6 +18,7 @@ subject to the following restrictions:
 #include "btAlignedObjectArray.h"
 #include "btMinMax.h"
 #include "btVector3.h"
+#include "btThreads.h"
 
 #ifdef __GNUC__
 #include <stdint.h>
@@ -2758,3 +2759,1163 @@ btScalar btConvexHullComputer::compute(const void* coords, bool doubleCoords, in
 
 	return shift;
 }
+
+//
+// btConvexHullComputer::computeQuickhull
+//
+// btConvexHullInternal rounds the points to a grid of 10216 cells along each axis of the bounding box. A point that is
+// inside every face of the hull of the other points by more than twice the extent of a cell along the face normal
+// stays inside after rounding, so it cannot be a vertex of the output. The quickhull works in grid coordinates, and
+// keeps its vertices and all points that are less than a margin of twice that inside. Most points are discarded before
+// by the polytope of the extreme points along a fixed set of directions. The quickhull runs on fixed chunks of the
+// remaining points in parallel, and once more on the union of their results.
+//
+
+#if !defined(BT_USE_DOUBLE_PRECISION) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define BT_QUICKHULL_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+static const int btQuickhullMinPoints = 256;
+static const int btQuickhullScanChunkSize = 16384;
+static const int btQuickhullBuildChunkSize = 65536;
+static const int btQuickhullProbeSize = 4096;
+static const int btQuickhullNumDirections = 13;
+
+// in grid cells. The margin of a face is btQuickhullMargin times the extent of a cell along its normal
+static const btScalar btQuickhullMargin = btScalar(4);
+static const btScalar btQuickhullTolerance = btScalar(1.0 / 16);
+
+static const btScalar btQuickhullDirections[btQuickhullNumDirections][3] = {
+	{1, 0, 0},
+	{0, 1, 0},
+	{0, 0, 1},
+	{1, 1, 0},
+	{1, -1, 0},
+	{1, 0, 1},
+	{1, 0, -1},
+	{0, 1, 1},
+	{0, 1, -1},
+	{1, 1, 1},
+	{1, 1, -1},
+	{1, -1, 1},
+	{1, -1, -1}};
+
+static void btQuickhullParallelFor(int iBegin, int iEnd, int grainSize, const btIParallelForBody& body)
+{
+#if BT_THREADSAFE
+	btITaskScheduler* scheduler = btGetTaskScheduler();
+	if (scheduler && scheduler->getNumThreads() > 1 && !btThreadsAreRunning())
+	{
+		btParallelFor(iBegin, iEnd, grainSize, body);
+		return;
+	}
+#endif  // #if BT_THREADSAFE
+	body.forLoop(iBegin, iEnd);
+}
+
+struct btQuickhullInput
+{
+	const char* m_coords;
+	bool m_doubleCoords;
+	int m_stride;
+
+	btVector3 getPoint(int i) const
+	{
+		const char* ptr = m_coords + size_t(i) * size_t(m_stride);
+		if (m_doubleCoords)
+		{
+			const double* v = (const double*)ptr;
+			return btVector3((btScalar)v[0], (btScalar)v[1], (btScalar)v[2]);
+		}
+		const float* v = (const float*)ptr;
+		return btVector3(v[0], v[1], v[2]);
+	}
+
+	// loads the points [begin, end) as three coordinate arrays, padded to a multiple of 4 with copies of the last point
+	int load(int begin, int end, btAlignedObjectArray<btScalar>& x, btAlignedObjectArray<btScalar>& y, btAlignedObjectArray<btScalar>& z) const
+	{
+		int count = end - begin;
+		int padded = (count + 3) & ~3;
+		x.resizeNoInitialize(padded);
+		y.resizeNoInitialize(padded);
+		z.resizeNoInitialize(padded);
+		const char* ptr = m_coords + size_t(begin) * size_t(m_stride);
+		if (m_doubleCoords)
+		{
+			for (int i = 0; i < count; i++, ptr += m_stride)
+			{
+				const double* v = (const double*)ptr;
+				x[i] = (btScalar)v[0];
+				y[i] = (btScalar)v[1];
+				z[i] = (btScalar)v[2];
+			}
+		}
+		else
+		{
+			for (int i = 0; i < count; i++, ptr += m_stride)
+			{
+				const float* v = (const float*)ptr;
+				x[i] = v[0];
+				y[i] = v[1];
+				z[i] = v[2];
+			}
+		}
+		for (int i = count; i < padded; i++)
+		{
+			x[i] = x[count - 1];
+			y[i] = y[count - 1];
+			z[i] = z[count - 1];
+		}
+		return padded;
+	}
+};
+
+// index of the first maximum and the first minimum of the dot products of the points with direction
+static void btQuickhullFindExtremesScalar(const btScalar* x, const btScalar* y, const btScalar* z, int count, const btScalar* direction, btScalar& maxDot, int& maxIndex, btScalar& minDot, int& minIndex)
+{
+	maxDot = minDot = x[0] * direction[0] + y[0] * direction[1] + z[0] * direction[2];
+	maxIndex = minIndex = 0;
+	for (int i = 1; i < count; i++)
+	{
+		btScalar dot = x[i] * direction[0] + y[i] * direction[1] + z[i] * direction[2];
+		if (dot > maxDot)
+		{
+			maxDot = dot;
+			maxIndex = i;
+		}
+		if (dot < minDot)
+		{
+			minDot = dot;
+			minIndex = i;
+		}
+	}
+}
+
+// same as btQuickhullFindExtremesScalar, count has to be a multiple of 4
+static void btQuickhullFindExtremes(const btScalar* x, const btScalar* y, const btScalar* z, int count, const btScalar* direction, btScalar& maxDot, int& maxIndex, btScalar& minDot, int& minIndex)
+{
+#ifdef BT_QUICKHULL_USE_SSE2
+	// the extreme values of blocks of points, then the first index in the first block that holds them
+	const int blockSize = 64;
+	const __m128 dx = _mm_set1_ps(direction[0]);
+	const __m128 dy = _mm_set1_ps(direction[1]);
+	const __m128 dz = _mm_set1_ps(direction[2]);
+	int maxBlock = 0;
+	int minBlock = 0;
+	for (int block = 0; block < count; block += blockSize)
+	{
+		const int end = btMin(block + blockSize, count);
+		__m128 dot = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_load_ps(x + block), dx), _mm_mul_ps(_mm_load_ps(y + block), dy)), _mm_mul_ps(_mm_load_ps(z + block), dz));
+		__m128 blockMax = dot;
+		__m128 blockMin = dot;
+		for (int i = block + 4; i < end; i += 4)
+		{
+			dot = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_load_ps(x + i), dx), _mm_mul_ps(_mm_load_ps(y + i), dy)), _mm_mul_ps(_mm_load_ps(z + i), dz));
+			blockMax = _mm_max_ps(blockMax, dot);
+			blockMin = _mm_min_ps(blockMin, dot);
+		}
+		btScalar maxValues[4], minValues[4];
+		_mm_storeu_ps(maxValues, blockMax);
+		_mm_storeu_ps(minValues, blockMin);
+		const btScalar blockMaxDot = btMax(btMax(maxValues[0], maxValues[1]), btMax(maxValues[2], maxValues[3]));
+		const btScalar blockMinDot = btMin(btMin(minValues[0], minValues[1]), btMin(minValues[2], minValues[3]));
+		if ((block == 0) || (blockMaxDot > maxDot))
+		{
+			maxDot = blockMaxDot;
+			maxBlock = block;
+		}
+		if ((block == 0) || (blockMinDot < minDot))
+		{
+			minDot = blockMinDot;
+			minBlock = block;
+		}
+	}
+	btScalar dot;
+	int index;
+	btQuickhullFindExtremesScalar(x + maxBlock, y + maxBlock, z + maxBlock, btMin(blockSize, count - maxBlock), direction, maxDot, maxIndex, dot, index);
+	btQuickhullFindExtremesScalar(x + minBlock, y + minBlock, z + minBlock, btMin(blockSize, count - minBlock), direction, dot, index, minDot, minIndex);
+	maxIndex += maxBlock;
+	minIndex += minBlock;
+#else
+	btQuickhullFindExtremesScalar(x, y, z, count, direction, maxDot, maxIndex, minDot, minIndex);
+#endif
+}
+
+// Sets flags[i] to 1 for the points that are outside any of the planes in grid coordinates, and to 0 for the others.
+// planes holds the normal and offset of each plane, each of them repeated four times. The points within radius of the
+// origin are inside all planes, which saves testing them one by one.
+static void btQuickhullClassify(const btScalar* x, const btScalar* y, const btScalar* z, int count, const btVector3& center, const btVector3& scale, btScalar radius, const btScalar* planes, int numPlanes, unsigned char* flags)
+{
+#ifdef BT_QUICKHULL_USE_SSE2
+	const __m128 cx = _mm_set1_ps(center.getX());
+	const __m128 cy = _mm_set1_ps(center.getY());
+	const __m128 cz = _mm_set1_ps(center.getZ());
+	const __m128 sx = _mm_set1_ps(scale.getX());
+	const __m128 sy = _mm_set1_ps(scale.getY());
+	const __m128 sz = _mm_set1_ps(scale.getZ());
+	const __m128 threshold = _mm_setzero_ps();
+	const __m128 radius2 = _mm_set1_ps(radius * radius);
+	for (int i = 0; i < count; i += 4)
+	{
+		__m128 px = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(x + i), cx), sx);
+		__m128 py = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(y + i), cy), sy);
+		__m128 pz = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(z + i), cz), sz);
+		__m128 best = _mm_set1_ps(-BT_LARGE_FLOAT);
+		__m128 length2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(px, px), _mm_mul_ps(py, py)), _mm_mul_ps(pz, pz));
+		const int numTested = (_mm_movemask_ps(_mm_cmplt_ps(length2, radius2)) == 15) ? 0 : numPlanes;
+		for (int k = 0; k < numTested; k++)
+		{
+			const btScalar* plane = planes + 16 * k;
+			__m128 distance = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(px, _mm_load_ps(plane)), _mm_mul_ps(py, _mm_load_ps(plane + 4))), _mm_mul_ps(pz, _mm_load_ps(plane + 8))), _mm_load_ps(plane + 12));
+			best = _mm_max_ps(best, distance);
+			if (((k & 3) == 3) && (_mm_movemask_ps(_mm_cmpgt_ps(best, threshold)) == 15))
+			{
+				break;
+			}
+		}
+		int mask = _mm_movemask_ps(_mm_cmpgt_ps(best, threshold));
+		int n = btMin(4, count - i);
+		for (int l = 0; l < n; l++)
+		{
+			flags[i + l] = (unsigned char)((mask >> l) & 1);
+		}
+	}
+#else
+	for (int i = 0; i < count; i++)
+	{
+		btVector3 p = (btVector3(x[i], y[i], z[i]) - center) * scale;
+		unsigned char keep = 0;
+		const int numTested = (p.length2() < radius * radius) ? 0 : numPlanes;
+		for (int k = 0; k < numTested; k++)
+		{
+			const btScalar* plane = planes + 16 * k;
+			if (p.getX() * plane[0] + p.getY() * plane[4] + p.getZ() * plane[8] - plane[12] > 0)
+			{
+				keep = 1;
+				break;
+			}
+		}
+		flags[i] = keep;
+	}
+#endif
+}
+
+// Quickhull over triangles with conflict lists, in grid coordinates
+class btQuickhullBuilder
+{
+public:
+	struct Face
+	{
+		int m_vertices[3];
+		int m_neighbors[3];  // face across the edge from m_vertices[i] to m_vertices[(i + 1) % 3]
+		btVector3 m_normal;
+		btScalar m_offset;
+		btScalar m_margin;
+		int m_conflicts;  // first point of the conflict list, or -1
+		int m_furthest;
+		btScalar m_furthestDistance;
+		int m_visited;
+		bool m_deleted;
+	};
+
+private:
+	struct HorizonFrame
+	{
+		int m_face;
+		int m_edge;
+		int m_step;
+	};
+
+	btAlignedObjectArray<btVector3> m_points;
+	btAlignedObjectArray<int> m_sourceIndices;
+	btAlignedObjectArray<int> m_nextConflict;
+	btAlignedObjectArray<int> m_pointStamps;
+	btAlignedObjectArray<Face> m_faces;
+	btAlignedObjectArray<int> m_hullPoints;
+	btAlignedObjectArray<int> m_nearPoints;
+	btAlignedObjectArray<int> m_pending;
+
+	btAlignedObjectArray<int> m_visible;
+	btAlignedObjectArray<int> m_horizonFaces;
+	btAlignedObjectArray<int> m_horizonEdges;
+	btAlignedObjectArray<int> m_newFaces;
+	btAlignedObjectArray<int> m_outerFaces;
+	btAlignedObjectArray<HorizonFrame> m_stack;
+
+	int m_stamp;
+
+	int findEdge(int face, int a, int b) const
+	{
+		const int* v = m_faces[face].m_vertices;
+		for (int i = 0; i < 3; i++)
+		{
+			if ((v[i] == a) && (v[(i + 1) % 3] == b))
+			{
+				return i;
+			}
+		}
+		return -1;
+	}
+
+	bool isDegenerate(int a, int b, int c) const
+	{
+		btVector3 ab = m_points[b] - m_points[a];
+		return ab.cross(m_points[c] - m_points[a]).length() <= btQuickhullTolerance * ab.length();
+	}
+
+	// returns -1 if the triangle is degenerate
+	int addFace(int a, int b, int c)
+	{
+		if (isDegenerate(a, b, c))
+		{
+			return -1;
+		}
+		btVector3 normal = (m_points[b] - m_points[a]).cross(m_points[c] - m_points[a]);
+		btScalar length = normal.length();
+		Face face;
+		face.m_vertices[0] = a;
+		face.m_vertices[1] = b;
+		face.m_vertices[2] = c;
+		face.m_neighbors[0] = face.m_neighbors[1] = face.m_neighbors[2] = -1;
+		face.m_normal = normal / length;
+		face.m_offset = face.m_normal.dot(m_points[a]);
+		face.m_margin = btQuickhullMargin * (btFabs(face.m_normal.getX()) + btFabs(face.m_normal.getY()) + btFabs(face.m_normal.getZ()));
+		face.m_conflicts = -1;
+		face.m_furthest = -1;
+		face.m_furthestDistance = 0;
+		face.m_visited = 0;
+		face.m_deleted = false;
+		m_faces.push_back(face);
+		return m_faces.size() - 1;
+	}
+
+	void addConflict(int face, int point, btScalar distance)
+	{
+		Face& f = m_faces[face];
+		if (f.m_conflicts < 0)
+		{
+			m_pending.push_back(face);
+			f.m_furthest = point;
+			f.m_furthestDistance = distance;
+		}
+		else if (distance > f.m_furthestDistance)
+		{
+			f.m_furthest = point;
+			f.m_furthestDistance = distance;
+		}
+		m_nextConflict[point] = f.m_conflicts;
+		f.m_conflicts = point;
+	}
+
+	// Adds the point to the conflict list of the face it is furthest outside of. A point that is outside none of the
+	// faces is kept as near point if it is less than the margin inside any of the faces or of the additional faces.
+	void assignPoint(int point, const int* faces, int numFaces, const int* outerFaces, int numOuterFaces)
+	{
+		const btVector3& p = m_points[point];
+		int best = -1;
+		btScalar bestDistance = -BT_LARGE_FLOAT;
+		bool near = false;
+		for (int i = 0; i < numFaces; i++)
+		{
+			const Face& f = m_faces[faces[i]];
+			btScalar distance = f.m_normal.dot(p) - f.m_offset;
+			if (distance > bestDistance)
+			{
+				best = faces[i];
+				bestDistance = distance;
+			}
+			near |= (distance > -f.m_margin);
+		}
+		if (bestDistance > btQuickhullTolerance)
+		{
+			addConflict(best, point, bestDistance);
+			return;
+		}
+		for (int i = 0; (i < numOuterFaces) && !near; i++)
+		{
+			const Face& f = m_faces[outerFaces[i]];
+			near = (f.m_normal.dot(p) - f.m_offset > -f.m_margin);
+		}
+		if (near)
+		{
+			m_nearPoints.push_back(point);
+		}
+	}
+
+	// Keeps an apex whose cone of new faces would be degenerate as near point, without adding it to the hull. The hull
+	// stays inside the hull of the candidates, so the points it discards are still deep enough inside.
+	void skipApex(int face, int apex)
+	{
+		Face& f = m_faces[face];
+		int* link = &f.m_conflicts;
+		while (*link != apex)
+		{
+			link = &m_nextConflict[*link];
+		}
+		*link = m_nextConflict[apex];
+		m_nearPoints.push_back(apex);
+		f.m_furthest = -1;
+		f.m_furthestDistance = -BT_LARGE_FLOAT;
+		for (int point = f.m_conflicts; point >= 0; point = m_nextConflict[point])
+		{
+			btScalar distance = f.m_normal.dot(m_points[point]) - f.m_offset;
+			if (distance > f.m_furthestDistance)
+			{
+				f.m_furthest = point;
+				f.m_furthestDistance = distance;
+			}
+		}
+		if (f.m_conflicts >= 0)
+		{
+			m_pending.push_back(face);
+		}
+	}
+
+	bool addApex(int face)
+	{
+		const int apex = m_faces[face].m_furthest;
+		const btVector3 eye = m_points[apex];
+		m_stamp++;
+
+		// depth first search over the visible faces, which yields the horizon in counter-clockwise order
+		m_visible.resize(0);
+		m_horizonFaces.resize(0);
+		m_horizonEdges.resize(0);
+		m_faces[face].m_visited = m_stamp;
+		m_visible.push_back(face);
+		HorizonFrame root;
+		root.m_face = face;
+		root.m_edge = 0;
+		root.m_step = 0;
+		m_stack.resize(0);
+		m_stack.push_back(root);
+		while (m_stack.size())
+		{
+			HorizonFrame& frame = m_stack[m_stack.size() - 1];
+			if (frame.m_step == 3)
+			{
+				m_stack.pop_back();
+				continue;
+			}
+			const int current = frame.m_face;
+			const int edge = (frame.m_edge + frame.m_step) % 3;
+			frame.m_step++;
+			const int neighbor = m_faces[current].m_neighbors[edge];
+			Face& n = m_faces[neighbor];
+			if (n.m_visited == m_stamp)
+			{
+				continue;
+			}
+			if (n.m_normal.dot(eye) - n.m_offset > btQuickhullTolerance)
+			{
+				const int* v = m_faces[current].m_vertices;
+				int back = findEdge(neighbor, v[(edge + 1) % 3], v[edge]);
+				if (back < 0)
+				{
+					return false;
+				}
+				n.m_visited = m_stamp;
+				m_visible.push_back(neighbor);
+				HorizonFrame child;
+				child.m_face = neighbor;
+				child.m_edge = back + 1;
+				child.m_step = 0;
+				m_stack.push_back(child);
+			}
+			else
+			{
+				m_horizonFaces.push_back(current);
+				m_horizonEdges.push_back(edge);
+			}
+		}
+
+		// The horizon has to be a simple loop, otherwise the visible faces are not a disk, and the new faces must not be
+		// degenerate. Both can happen within the tolerance, then the apex is skipped.
+		const int numHorizon = m_horizonFaces.size();
+		if (numHorizon < 3)
+		{
+			skipApex(face, apex);
+			return true;
+		}
+		for (int i = 0; i < numHorizon; i++)
+		{
+			const int* v = m_faces[m_horizonFaces[i]].m_vertices;
+			const int j = (i + 1) % numHorizon;
+			const int* w = m_faces[m_horizonFaces[j]].m_vertices;
+			const int a = v[m_horizonEdges[i]];
+			const int b = v[(m_horizonEdges[i] + 1) % 3];
+			if ((b != w[m_horizonEdges[j]]) || (m_pointStamps[a] == m_stamp) || isDegenerate(a, b, apex))
+			{
+				skipApex(face, apex);
+				return true;
+			}
+			m_pointStamps[a] = m_stamp;
+		}
+
+		// cone of new faces from the horizon to the apex
+		const int firstNew = m_faces.size();
+		m_newFaces.resize(0);
+		m_outerFaces.resize(0);
+		for (int i = 0; i < numHorizon; i++)
+		{
+			const int a = m_faces[m_horizonFaces[i]].m_vertices[m_horizonEdges[i]];
+			const int b = m_faces[m_horizonFaces[i]].m_vertices[(m_horizonEdges[i] + 1) % 3];
+			const int outer = m_faces[m_horizonFaces[i]].m_neighbors[m_horizonEdges[i]];
+			const int created = addFace(a, b, apex);
+			const int back = findEdge(outer, b, a);
+			if ((created < 0) || (back < 0))
+			{
+				return false;
+			}
+			Face& f = m_faces[created];
+			f.m_neighbors[0] = outer;
+			f.m_neighbors[1] = firstNew + (i + 1) % numHorizon;
+			f.m_neighbors[2] = firstNew + (i + numHorizon - 1) % numHorizon;
+			m_faces[outer].m_neighbors[back] = created;
+			m_newFaces.push_back(created);
+			m_outerFaces.push_back(outer);
+		}
+
+		for (int i = 0; i < m_visible.size(); i++)
+		{
+			Face& f = m_faces[m_visible[i]];
+			f.m_deleted = true;
+			int point = f.m_conflicts;
+			f.m_conflicts = -1;
+			while (point >= 0)
+			{
+				int next = m_nextConflict[point];
+				if (point != apex)
+				{
+					assignPoint(point, &m_newFaces[0], numHorizon, &m_outerFaces[0], numHorizon);
+				}
+				point = next;
+			}
+		}
+		m_hullPoints.push_back(apex);
+		return true;
+	}
+
+public:
+	btQuickhullBuilder()
+		: m_stamp(0)
+	{
+	}
+
+	void copyFrom(const btQuickhullBuilder& other)
+	{
+		btAssert(other.m_pending.size() == 0);
+		m_points.copyFromArray(other.m_points);
+		m_sourceIndices.copyFromArray(other.m_sourceIndices);
+		m_nextConflict.copyFromArray(other.m_nextConflict);
+		m_pointStamps.copyFromArray(other.m_pointStamps);
+		m_faces.copyFromArray(other.m_faces);
+		m_hullPoints.copyFromArray(other.m_hullPoints);
+		m_nearPoints.copyFromArray(other.m_nearPoints);
+		m_pending.resize(0);
+		m_stamp = other.m_stamp;
+	}
+
+	int getNumPoints() const
+	{
+		return m_points.size();
+	}
+
+	const btAlignedObjectArray<Face>& getFaces() const
+	{
+		return m_faces;
+	}
+
+	void addPoint(const btVector3& p, int sourceIndex)
+	{
+		m_points.push_back(p);
+		m_sourceIndices.push_back(sourceIndex);
+		m_nextConflict.push_back(-1);
+		m_pointStamps.push_back(0);
+	}
+
+	// builds the initial tetrahedron from the points added so far and assigns the others to its faces.
+	// Returns false if the points are not spread in all three dimensions by more than the margin.
+	bool buildSimplex()
+	{
+		const int count = m_points.size();
+		if (count < 4)
+		{
+			return false;
+		}
+		int i0 = 0;
+		int i1 = 1;
+		btScalar maxDistance = -1;
+		for (int i = 0; i < count; i++)
+		{
+			for (int j = i + 1; j < count; j++)
+			{
+				btScalar distance = m_points[i].distance2(m_points[j]);
+				if (distance > maxDistance)
+				{
+					maxDistance = distance;
+					i0 = i;
+					i1 = j;
+				}
+			}
+		}
+		if (btSqrt(maxDistance) <= btQuickhullMargin)
+		{
+			return false;
+		}
+
+		btVector3 axis = (m_points[i1] - m_points[i0]).normalized();
+		int i2 = -1;
+		maxDistance = btQuickhullMargin;
+		for (int i = 0; i < count; i++)
+		{
+			btScalar distance = (m_points[i] - m_points[i0]).cross(axis).length();
+			if (distance > maxDistance)
+			{
+				maxDistance = distance;
+				i2 = i;
+			}
+		}
+		if (i2 < 0)
+		{
+			return false;
+		}
+
+		btVector3 normal = (m_points[i1] - m_points[i0]).cross(m_points[i2] - m_points[i0]).normalized();
+		int i3 = -1;
+		maxDistance = btQuickhullMargin;
+		for (int i = 0; i < count; i++)
+		{
+			btScalar distance = btFabs(normal.dot(m_points[i] - m_points[i0]));
+			if (distance > maxDistance)
+			{
+				maxDistance = distance;
+				i3 = i;
+			}
+		}
+		if (i3 < 0)
+		{
+			return false;
+		}
+
+		// base triangle facing away from the fourth point
+		if (normal.dot(m_points[i3] - m_points[i0]) > 0)
+		{
+			btSwap(i1, i2);
+		}
+		int faces[4];
+		faces[0] = addFace(i0, i1, i2);
+		faces[1] = addFace(i1, i0, i3);
+		faces[2] = addFace(i2, i1, i3);
+		faces[3] = addFace(i0, i2, i3);
+		for (int i = 0; i < 4; i++)
+		{
+			if (faces[i] < 0)
+			{
+				return false;
+			}
+		}
+		for (int i = 0; i < 4; i++)
+		{
+			for (int e = 0; e < 3; e++)
+			{
+				const int* v = m_faces[faces[i]].m_vertices;
+				for (int j = 0; j < 4; j++)
+				{
+					if ((j != i) && (findEdge(faces[j], v[(e + 1) % 3], v[e]) >= 0))
+					{
+						m_faces[faces[i]].m_neighbors[e] = faces[j];
+					}
+				}
+			}
+		}
+		m_hullPoints.push_back(i0);
+		m_hullPoints.push_back(i1);
+		m_hullPoints.push_back(i2);
+		m_hullPoints.push_back(i3);
+		for (int i = 0; i < count; i++)
+		{
+			if ((i != i0) && (i != i1) && (i != i2) && (i != i3))
+			{
+				assignPoint(i, faces, 4, NULL, 0);
+			}
+		}
+		return true;
+	}
+
+	// assigns the points from first on to the current faces
+	void assignPoints(int first)
+	{
+		btAlignedObjectArray<int> faces;
+		for (int i = 0; i < m_faces.size(); i++)
+		{
+			if (!m_faces[i].m_deleted)
+			{
+				faces.push_back(i);
+			}
+		}
+		for (int i = first; i < m_points.size(); i++)
+		{
+			assignPoint(i, &faces[0], faces.size(), NULL, 0);
+		}
+	}
+
+	// adds the furthest conflict point of a face as vertex until all conflict lists are empty.
+	// Returns false if the faces are not connected consistently anymore, which should not happen.
+	bool expand()
+	{
+		while (m_pending.size())
+		{
+			int face = m_pending[m_pending.size() - 1];
+			m_pending.pop_back();
+			if (m_faces[face].m_deleted || (m_faces[face].m_conflicts < 0))
+			{
+				continue;
+			}
+			if (!addApex(face))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// source indices of the hull vertices and of the near points
+	void getCandidates(btAlignedObjectArray<int>& candidates) const
+	{
+		for (int i = 0; i < m_hullPoints.size(); i++)
+		{
+			candidates.push_back(m_sourceIndices[m_hullPoints[i]]);
+		}
+		for (int i = 0; i < m_nearPoints.size(); i++)
+		{
+			candidates.push_back(m_sourceIndices[m_nearPoints[i]]);
+		}
+	}
+};
+
+struct btQuickhullChunkResult
+{
+	btVector3 m_min;
+	btVector3 m_max;
+	btScalar m_maxDot[btQuickhullNumDirections];
+	btScalar m_minDot[btQuickhullNumDirections];
+	int m_maxIndex[btQuickhullNumDirections];
+	int m_minIndex[btQuickhullNumDirections];
+};
+
+struct btQuickhullBoundsLoop : public btIParallelForBody
+{
+	const btQuickhullInput* m_input;
+	int m_count;
+	btQuickhullChunkResult* m_results;
+
+	void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
+	{
+		for (int chunk = iBegin; chunk < iEnd; chunk++)
+		{
+			int begin = chunk * btQuickhullScanChunkSize;
+			int end = btMin(begin + btQuickhullScanChunkSize, m_count);
+			btVector3 min = m_input->getPoint(begin);
+			btVector3 max = min;
+			for (int i = begin + 1; i < end; i++)
+			{
+				btVector3 p = m_input->getPoint(i);
+				min.setMin(p);
+				max.setMax(p);
+			}
+			m_results[chunk].m_min = min;
+			m_results[chunk].m_max = max;
+		}
+	}
+};
+
+struct btQuickhullExtremesLoop : public btIParallelForBody
+{
+	const btQuickhullInput* m_input;
+	int m_count;
+	const btScalar* m_directions;
+	btQuickhullChunkResult* m_results;
+
+	void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
+	{
+		btAlignedObjectArray<btScalar> x, y, z;
+		for (int chunk = iBegin; chunk < iEnd; chunk++)
+		{
+			int begin = chunk * btQuickhullScanChunkSize;
+			int padded = m_input->load(begin, btMin(begin + btQuickhullScanChunkSize, m_count), x, y, z);
+			btQuickhullChunkResult& result = m_results[chunk];
+			for (int d = 0; d < btQuickhullNumDirections; d++)
+			{
+				btQuickhullFindExtremes(&x[0], &y[0], &z[0], padded, m_directions + 3 * d, result.m_maxDot[d], result.m_maxIndex[d], result.m_minDot[d], result.m_minIndex[d]);
+				result.m_maxIndex[d] += begin;
+				result.m_minIndex[d] += begin;
+			}
+		}
+	}
+};
+
+struct btQuickhullClassifyLoop : public btIParallelForBody
+{
+	const btQuickhullInput* m_input;
+	int m_count;
+	btVector3 m_center;
+	btVector3 m_scale;
+	btScalar m_radius;
+	const btScalar* m_planes;
+	int m_numPlanes;
+	unsigned char* m_flags;
+
+	void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
+	{
+		btAlignedObjectArray<btScalar> x, y, z;
+		btAlignedObjectArray<unsigned char> flags;
+		for (int chunk = iBegin; chunk < iEnd; chunk++)
+		{
+			int begin = chunk * btQuickhullScanChunkSize;
+			int end = btMin(begin + btQuickhullScanChunkSize, m_count);
+			int padded = m_input->load(begin, end, x, y, z);
+			flags.resizeNoInitialize(padded);
+			btQuickhullClassify(&x[0], &y[0], &z[0], padded, m_center, m_scale, m_radius, m_planes, m_numPlanes, &flags[0]);
+			memcpy(m_flags + begin, &flags[0], end - begin);
+		}
+	}
+};
+
+// the first extreme points of all chunks without duplicates, and those along the axes
+static void btQuickhullMergeExtremes(const btAlignedObjectArray<btQuickhullChunkResult>& chunks, int numChunks, btAlignedObjectArray<int>& extremes, int* axisExtremes)
+{
+	for (int d = 0; d < btQuickhullNumDirections; d++)
+	{
+		int maxChunk = 0;
+		int minChunk = 0;
+		for (int i = 1; i < numChunks; i++)
+		{
+			if (chunks[i].m_maxDot[d] > chunks[maxChunk].m_maxDot[d])
+			{
+				maxChunk = i;
+			}
+			if (chunks[i].m_minDot[d] < chunks[minChunk].m_minDot[d])
+			{
+				minChunk = i;
+			}
+		}
+		int candidates[2] = {chunks[maxChunk].m_maxIndex[d], chunks[minChunk].m_minIndex[d]};
+		if (d < 3)
+		{
+			axisExtremes[2 * d] = candidates[0];
+			axisExtremes[2 * d + 1] = candidates[1];
+		}
+		for (int k = 0; k < 2; k++)
+		{
+			if (extremes.findLinearSearch(candidates[k]) == extremes.size())
+			{
+				extremes.push_back(candidates[k]);
+			}
+		}
+	}
+}
+
+// builds the polytope of the extreme points and the planes for btQuickhullClassify, returns false if it failed
+static bool btQuickhullBuildSeed(const btQuickhullInput& input, const btAlignedObjectArray<int>& extremes, const btVector3& center, const btVector3& scale, btQuickhullBuilder& seed, btAlignedObjectArray<btScalar>& planes, btScalar& radius)
+{
+	for (int i = 0; i < extremes.size(); i++)
+	{
+		seed.addPoint((input.getPoint(extremes[i]) - center) * scale, extremes[i]);
+	}
+	if (!seed.buildSimplex() || !seed.expand())
+	{
+		return false;
+	}
+
+	planes.resize(0);
+	radius = BT_LARGE_FLOAT;
+	const btAlignedObjectArray<btQuickhullBuilder::Face>& faces = seed.getFaces();
+	for (int i = 0; i < faces.size(); i++)
+	{
+		const btQuickhullBuilder::Face& f = faces[i];
+		if (!f.m_deleted)
+		{
+			const btScalar plane[4] = {f.m_normal.getX(), f.m_normal.getY(), f.m_normal.getZ(), f.m_offset - f.m_margin};
+			radius = btMin(radius, plane[3]);
+			for (int k = 0; k < 16; k++)
+			{
+				planes.push_back(plane[k / 4]);
+			}
+		}
+	}
+	radius = btMax(radius, btScalar(0));
+	return true;
+}
+
+// quickhull of the seed and the points, returns false if it failed
+static bool btQuickhullBuild(const btQuickhullInput& input, const btQuickhullBuilder& seed, const btVector3& center, const btVector3& scale, const int* points, int numPoints, btAlignedObjectArray<int>& candidates)
+{
+	btQuickhullBuilder builder;
+	builder.copyFrom(seed);
+	int first = builder.getNumPoints();
+	for (int i = 0; i < numPoints; i++)
+	{
+		builder.addPoint((input.getPoint(points[i]) - center) * scale, points[i]);
+	}
+	builder.assignPoints(first);
+	candidates.resize(0);
+	if (!builder.expand())
+	{
+		return false;
+	}
+	builder.getCandidates(candidates);
+	return true;
+}
+
+struct btQuickhullBuildResult
+{
+	btAlignedObjectArray<int> m_candidates;
+	bool m_ok;
+};
+
+struct btQuickhullBuildLoop : public btIParallelForBody
+{
+	const btQuickhullInput* m_input;
+	const btQuickhullBuilder* m_seed;
+	btVector3 m_center;
+	btVector3 m_scale;
+	const int* m_points;
+	int m_numPoints;
+	btQuickhullBuildResult* m_results;
+
+	void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
+	{
+		for (int chunk = iBegin; chunk < iEnd; chunk++)
+		{
+			int begin = chunk * btQuickhullBuildChunkSize;
+			int end = btMin(begin + btQuickhullBuildChunkSize, m_numPoints);
+			btQuickhullBuildResult& result = m_results[chunk];
+			result.m_ok = btQuickhullBuild(*m_input, *m_seed, m_center, m_scale, m_points + begin, end - begin, result.m_candidates);
+		}
+	}
+};
+
+template <typename T>
+static void btQuickhullGather(const btQuickhullInput& input, const btAlignedObjectArray<int>& indices, btAlignedObjectArray<T>& coords)
+{
+	coords.resizeNoInitialize(3 * indices.size());
+	for (int i = 0; i < indices.size(); i++)
+	{
+		const T* v = (const T*)(input.m_coords + size_t(indices[i]) * size_t(input.m_stride));
+		coords[3 * i] = v[0];
+		coords[3 * i + 1] = v[1];
+		coords[3 * i + 2] = v[2];
+	}
+}
+
+btScalar btConvexHullComputer::computeQuickhull(const void* coords, bool doubleCoords, int stride, int count, btScalar shrink, btScalar shrinkClamp)
+{
+	if (count < btQuickhullMinPoints)
+	{
+		return compute(coords, doubleCoords, stride, count, shrink, shrinkClamp);
+	}
+
+	btQuickhullInput input;
+	input.m_coords = (const char*)coords;
+	input.m_doubleCoords = doubleCoords;
+	input.m_stride = stride;
+
+	// bounding box and grid of btConvexHullInternal
+	const int numChunks = (count + btQuickhullScanChunkSize - 1) / btQuickhullScanChunkSize;
+	btAlignedObjectArray<btQuickhullChunkResult> chunks;
+	chunks.resize(numChunks);
+	btQuickhullBoundsLoop boundsLoop;
+	boundsLoop.m_input = &input;
+	boundsLoop.m_count = count;
+	boundsLoop.m_results = &chunks[0];
+	btQuickhullParallelFor(0, numChunks, 1, boundsLoop);
+	btVector3 min = chunks[0].m_min;
+	btVector3 max = chunks[0].m_max;
+	for (int i = 1; i < numChunks; i++)
+	{
+		min.setMin(chunks[i].m_min);
+		max.setMax(chunks[i].m_max);
+	}
+	const btVector3 center = (min + max) * btScalar(0.5);
+	const btVector3 extent = max - min;
+	if (!(extent.getX() > 0) || !(extent.getY() > 0) || !(extent.getZ() > 0))
+	{
+		return compute(coords, doubleCoords, stride, count, shrink, shrinkClamp);
+	}
+	const btVector3 scale = btVector3(btScalar(10216), btScalar(10216), btScalar(10216)) / extent;
+
+	// extreme points along the directions in grid coordinates
+	btScalar directions[3 * btQuickhullNumDirections];
+	for (int d = 0; d < btQuickhullNumDirections; d++)
+	{
+		for (int k = 0; k < 3; k++)
+		{
+			// the axes unscaled, so that their extreme points are exactly the bounding box
+			directions[3 * d + k] = (d < 3) ? btQuickhullDirections[d][k] : btQuickhullDirections[d][k] * scale[k];
+		}
+	}
+	btQuickhullExtremesLoop extremesLoop;
+	extremesLoop.m_input = &input;
+	extremesLoop.m_count = count;
+	extremesLoop.m_directions = directions;
+	extremesLoop.m_results = &chunks[0];
+	btQuickhullParallelFor(0, numChunks, 1, extremesLoop);
+
+	btAlignedObjectArray<int> extremes;
+	int axisExtremes[6];
+	btQuickhullMergeExtremes(chunks, numChunks, extremes, axisExtremes);
+
+	// the polytope of the extreme points is the seed of all quickhulls
+	btQuickhullBuilder seed;
+	btAlignedObjectArray<btScalar> planes;
+	btScalar radius;
+	if (!btQuickhullBuildSeed(input, extremes, center, scale, seed, planes, radius))
+	{
+		return compute(coords, doubleCoords, stride, count, shrink, shrinkClamp);
+	}
+
+	// discard the points that are deeper inside the seed than the margin
+	btAlignedObjectArray<unsigned char> flags;
+	flags.resizeNoInitialize(count);
+	btQuickhullClassifyLoop classifyLoop;
+	classifyLoop.m_input = &input;
+	classifyLoop.m_count = count;
+	classifyLoop.m_center = center;
+	classifyLoop.m_scale = scale;
+	classifyLoop.m_radius = radius;
+	classifyLoop.m_planes = &planes[0];
+	classifyLoop.m_numPlanes = planes.size() / 16;
+	classifyLoop.m_flags = &flags[0];
+	btQuickhullParallelFor(0, numChunks, 1, classifyLoop);
+
+	for (int i = 0; i < extremes.size(); i++)
+	{
+		flags[extremes[i]] = 0;
+	}
+	btAlignedObjectArray<int> remaining;
+	for (int i = 0; i < count; i++)
+	{
+		if (flags[i])
+		{
+			remaining.push_back(i);
+		}
+	}
+
+	// A quickhull of an evenly spread sample first. If it keeps most of them, like for points on a sphere, the
+	// quickhulls of all points would not discard enough to pay off, and all remaining points are candidates.
+	btAlignedObjectArray<int> candidates;
+	bool useQuickhull = remaining.size() > 0;
+	if (remaining.size() > btQuickhullProbeSize)
+	{
+		btAlignedObjectArray<int> probe;
+		for (int i = 0; i < btQuickhullProbeSize; i++)
+		{
+			probe.push_back(remaining[int((long long)i * remaining.size() / btQuickhullProbeSize)]);
+		}
+		if (!btQuickhullBuild(input, seed, center, scale, &probe[0], probe.size(), candidates))
+		{
+			return compute(coords, doubleCoords, stride, count, shrink, shrinkClamp);
+		}
+		useQuickhull = (candidates.size() * 2 <= probe.size());
+	}
+	if (!useQuickhull)
+	{
+		candidates.resize(0);
+		seed.getCandidates(candidates);
+		for (int i = 0; i < remaining.size(); i++)
+		{
+			candidates.push_back(remaining[i]);
+		}
+	}
+	else
+	{
+		// quickhull per chunk of the remaining points, then once more over the candidates of all chunks
+		const int numBuildChunks = (remaining.size() + btQuickhullBuildChunkSize - 1) / btQuickhullBuildChunkSize;
+		btAlignedObjectArray<btQuickhullBuildResult> results;
+		results.resize(numBuildChunks);
+		btQuickhullBuildLoop buildLoop;
+		buildLoop.m_input = &input;
+		buildLoop.m_seed = &seed;
+		buildLoop.m_center = center;
+		buildLoop.m_scale = scale;
+		buildLoop.m_points = &remaining[0];
+		buildLoop.m_numPoints = remaining.size();
+		buildLoop.m_results = &results[0];
+		btQuickhullParallelFor(0, numBuildChunks, 1, buildLoop);
+		for (int i = 0; i < numBuildChunks; i++)
+		{
+			if (!results[i].m_ok)
+			{
+				return compute(coords, doubleCoords, stride, count, shrink, shrinkClamp);
+			}
+		}
+
+		if (numBuildChunks == 1)
+		{
+			candidates.copyFromArray(results[0].m_candidates);
+		}
+		else
+		{
+			for (int i = 0; i < numBuildChunks; i++)
+			{
+				const btAlignedObjectArray<int>& chunkCandidates = results[i].m_candidates;
+				for (int j = 0; j < chunkCandidates.size(); j++)
+				{
+					flags[chunkCandidates[j]] = 2;
+				}
+			}
+			btAlignedObjectArray<int> merged;
+			for (int i = 0; i < remaining.size(); i++)
+			{
+				if (flags[remaining[i]] == 2)
+				{
+					merged.push_back(remaining[i]);
+				}
+			}
+			if (!btQuickhullBuild(input, seed, center, scale, merged.size() ? &merged[0] : NULL, merged.size(), candidates))
+			{
+				return compute(coords, doubleCoords, stride, count, shrink, shrinkClamp);
+			}
+		}
+	}
+
+	// the extreme points along the axes keep the bounding box, and thereby the grid, of the exact algorithm
+	for (int i = 0; i < candidates.size(); i++)
+	{
+		flags[candidates[i]] = 3;
+	}
+	for (int i = 0; i < 6; i++)
+	{
+		flags[axisExtremes[i]] = 3;
+	}
+	btAlignedObjectArray<int> indices;
+	for (int i = 0; i < count; i++)
+	{
+		if (flags[i] == 3)
+		{
+			indices.push_back(i);
+		}
+	}
+
+	btScalar shift;
+	original_vertex_index.resize(0);
+	if (doubleCoords)
+	{
+		btAlignedObjectArray<double> gathered;
+		btQuickhullGather(input, indices, gathered);
+		shift = compute(&gathered[0], true, 3 * sizeof(double), indices.size(), shrink, shrinkClamp);
+	}
+	else
+	{
+		btAlignedObjectArray<float> gathered;
+		btQuickhullGather(input, indices, gathered);
+		shift = compute(&gathered[0], false, 3 * sizeof(float), indices.size(), shrink, shrinkClamp);
+	}
+	for (int i = 0; i < original_vertex_index.size(); i++)
+	{
+		original_vertex_index[i] = indices[original_vertex_index[i]];
+	}
+	return shift;
+}
@@ -19,7 +19,16 @@
 #include <sys/sysctl.h>  //for sysctlbyname
 #endif                   //BT_USE_NEON
 
-///Rudimentary btCpuFeatureUtility for CPU features: only report the features that Bullet actually uses (SSE4/FMA3, NEON_HPFP)
+//AVX2 and AVX-512 are detected on any x86 build, because kernels using them are compiled per function and picked at run-time
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define BT_CPU_HAS_X86_CPUID 1
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <cpuid.h>
+#define BT_CPU_HAS_X86_CPUID 1
+#endif
+
+///Rudimentary btCpuFeatureUtility for CPU features: only report the features that Bullet actually uses (SSE4/FMA3, AVX2/AVX-512, NEON_HPFP)
 ///We assume SSE2 in case BT_USE_SSE2 is defined in LinearMath/btScalar.h
 class btCpuFeatureUtility
 {
@@ -28,9 +37,38 @@ public:
 	{
 		CPU_FEATURE_FMA3 = 1,
 		CPU_FEATURE_SSE4_1 = 2,
-		CPU_FEATURE_NEON_HPFP = 4
+		CPU_FEATURE_NEON_HPFP = 4,
+		CPU_FEATURE_AVX2 = 8,
+		CPU_FEATURE_AVX512F = 16
 	};
 
+#ifdef BT_CPU_HAS_X86_CPUID
+	static void cpuid(unsigned int leaf, unsigned int subLeaf, unsigned int regs[4])
+	{
+#ifdef _MSC_VER
+		int cpuInfo[4];
+		__cpuidex(cpuInfo, (int)leaf, (int)subLeaf);
+		for (int i = 0; i < 4; i++)
+			regs[i] = (unsigned int)cpuInfo[i];
+#else
+		__cpuid_count(leaf, subLeaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+	}
+
+	static unsigned long long xgetbv0()
+	{
+#ifdef _MSC_VER
+		return _xgetbv(0);
+#else
+		unsigned int eax, edx;
+		__asm__ __volatile__("xgetbv"
+							 : "=a"(eax), "=d"(edx)
+							 : "c"(0));
+		return ((unsigned long long)edx << 32) | eax;
+#endif
+	}
+#endif  //BT_CPU_HAS_X86_CPUID
+
 	static int getCpuFeatures()
 	{
 		static int capabilities = 0;
@@ -80,6 +118,34 @@ public:
 		}
 #endif  //BT_ALLOW_SSE4
 
+#ifdef BT_CPU_HAS_X86_CPUID
+		{
+			unsigned int regs[4];
+			cpuid(0, 0, regs);
+			unsigned int maxLeaf = regs[0];
+			cpuid(1, 0, regs);
+			bool osUsesXSAVE_XRSTORE = (regs[2] & (1 << 27)) != 0;
+			unsigned long long xcr0 = osUsesXSAVE_XRSTORE ? xgetbv0() : 0;
+			//the OS must save the YMM state for AVX2, and the opmask and ZMM state as well for AVX-512
+			bool osSavesYmm = (xcr0 & 0x6) == 0x6;
+			bool osSavesZmm = (xcr0 & 0xe6) == 0xe6;
+			if (maxLeaf >= 7)
+			{
+				cpuid(7, 0, regs);
+				const unsigned int AVX2Flag = (1 << 5);
+				const unsigned int AVX512FFlag = (1 << 16);
+				if (osSavesYmm && (regs[1] & AVX2Flag))
+				{
+					capabilities |= btCpuFeatureUtility::CPU_FEATURE_AVX2;
+				}
+				if (osSavesZmm && (regs[1] & AVX512FFlag))
+				{
+					capabilities |= btCpuFeatureUtility::CPU_FEATURE_AVX512F;
+				}
+			}
+		}
+#endif  //BT_CPU_HAS_X86_CPUID
+
 		testedCapabilities = true;
 		return capabilities;
 	}
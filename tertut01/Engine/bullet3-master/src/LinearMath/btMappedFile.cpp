@@ -0,0 +1,155 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2006 Erwin Coumans  https://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "btMappedFile.h"
+#include "btAlignedAllocator.h"
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#elif defined(__unix__) || defined(__APPLE__)
+#define BT_MAPPED_FILE_USE_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include <stdio.h>
+#endif
+
+btMappedFile::btMappedFile()
+	: m_data(0),
+	  m_size(0),
+	  m_mapped(false),
+	  m_copyOnWrite(false)
+#if defined(_WIN32)
+	  ,
+	  m_fileHandle(INVALID_HANDLE_VALUE),
+	  m_mappingHandle(0)
+#endif
+{
+}
+
+btMappedFile::~btMappedFile()
+{
+	close();
+}
+
+bool btMappedFile::open(const char* fileName, bool copyOnWrite)
+{
+	close();
+#if defined(_WIN32)
+	HANDLE file = CreateFileA(fileName, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+	{
+		CloseHandle(file);
+		return false;
+	}
+	HANDLE mapping = CreateFileMappingA(file, 0, copyOnWrite ? PAGE_WRITECOPY : PAGE_READONLY, 0, 0, 0);
+	const void* data = mapping ? MapViewOfFile(mapping, copyOnWrite ? FILE_MAP_COPY : FILE_MAP_READ, 0, 0, 0) : 0;
+	if (!data)
+	{
+		if (mapping)
+			CloseHandle(mapping);
+		CloseHandle(file);
+		return false;
+	}
+	m_fileHandle = file;
+	m_mappingHandle = mapping;
+	m_data = data;
+	m_size = size_t(size.QuadPart);
+	m_mapped = true;
+#elif defined(BT_MAPPED_FILE_USE_MMAP)
+	int fd = ::open(fileName, O_RDONLY);
+	if (fd < 0)
+	{
+		return false;
+	}
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size == 0)
+	{
+		::close(fd);
+		return false;
+	}
+	void* data = mmap(0, size_t(st.st_size), copyOnWrite ? (PROT_READ | PROT_WRITE) : PROT_READ, MAP_PRIVATE, fd, 0);
+	// the mapping keeps its own reference to the file
+	::close(fd);
+	if (data == MAP_FAILED)
+	{
+		return false;
+	}
+	m_data = data;
+	m_size = size_t(st.st_size);
+	m_mapped = true;
+#else
+	FILE* file = fopen(fileName, "rb");
+	if (!file)
+	{
+		return false;
+	}
+	fseek(file, 0, SEEK_END);
+	long size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	void* data = size > 0 ? btAlignedAlloc(size_t(size), 16) : 0;
+	if (!data || fread(data, 1, size_t(size), file) != size_t(size))
+	{
+		if (data)
+			btAlignedFree(data);
+		fclose(file);
+		return false;
+	}
+	fclose(file);
+	m_data = data;
+	m_size = size_t(size);
+	m_mapped = false;
+#endif
+	m_copyOnWrite = copyOnWrite;
+	return true;
+}
+
+void btMappedFile::close()
+{
+	if (!m_data)
+	{
+		return;
+	}
+	if (m_mapped)
+	{
+#if defined(_WIN32)
+		UnmapViewOfFile(m_data);
+		CloseHandle(m_mappingHandle);
+		CloseHandle(m_fileHandle);
+		m_mappingHandle = 0;
+		m_fileHandle = INVALID_HANDLE_VALUE;
+#elif defined(BT_MAPPED_FILE_USE_MMAP)
+		munmap(const_cast<void*>(m_data), m_size);
+#endif
+	}
+	else
+	{
+		btAlignedFree(const_cast<void*>(m_data));
+	}
+	m_data = 0;
+	m_size = 0;
+	m_mapped = false;
+	m_copyOnWrite = false;
+}
@@ -0,0 +1,73 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2006 Erwin Coumans  https://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef BT_MAPPED_FILE_H
+#define BT_MAPPED_FILE_H
+
+#include "btScalar.h"
+#include <stddef.h>
+
+///btMappedFile maps a whole file read-only into memory, so baked data such as a BVH written with
+///btOptimizedBvh::serializeInPlace can be used straight from the page cache, without reading and copying it first.
+///The data is aligned to at least 16 bytes. Writing to it crashes unless the file was opened copy-on-write, where written
+///pages get private copies and the file itself stays unchanged. On platforms without memory mapping the file is read into
+///an aligned buffer instead.
+class btMappedFile
+{
+	const void* m_data;
+	size_t m_size;
+	bool m_mapped;  // false if m_data was read into memory we allocated
+	bool m_copyOnWrite;
+#if defined(_WIN32)
+	void* m_fileHandle;
+	void* m_mappingHandle;
+#endif
+
+	btMappedFile(const btMappedFile&);
+	btMappedFile& operator=(const btMappedFile&);
+
+public:
+	btMappedFile();
+	~btMappedFile();
+
+	///closes the file that was open, returns false if fileName cannot be opened or is empty
+	bool open(const char* fileName, bool copyOnWrite = false);
+
+	void close();
+
+	bool isOpen() const
+	{
+		return m_data != 0;
+	}
+
+	const void* getData() const
+	{
+		return m_data;
+	}
+
+	///only valid for files opened copy-on-write
+	void* getWritableData() const
+	{
+		btAssert(m_copyOnWrite);
+		return const_cast<void*>(m_data);
+	}
+
+	size_t getSize() const
+	{
+		return m_size;
+	}
+};
+
+#endif  //BT_MAPPED_FILE_H
@@ -20,32 +20,55 @@ subject to the following restrictions:
 #include "btThreads.h"
 
 ///The btPoolAllocator class allows to efficiently allocate a large pool of objects, instead of dynamically allocating them separately.
+///allocate and freeMemory are lock-free, the free elements form a stack that the threads push and pop with a compare-exchange
 class btPoolAllocator
 {
 	int m_elemSize;
 	int m_maxElements;
 	int m_freeCount;
-	void* m_firstFree;
+	// the index of the first free element in the low 32 bits, -1 if there is none, and a counter in the high 32 bits that
+	// changes with every push and pop. A thread that read the head before others popped and pushed the same element
+	// back fails its compare-exchange, instead of installing a stale next index (the ABA problem).
+	// 32 bit targets only align a long long to 4 bytes, the 64 bit atomics need 8
+	ATTRIBUTE_ALIGNED16(long long m_firstFree);
+	int m_numContentions;  // failed compare-exchanges, only if BT_THREADSAFE
 	unsigned char* m_pool;
-	btSpinMutex m_mutex;  // only used if BT_THREADSAFE
+
+	static long long makeHead(long long oldHead, int index)
+	{
+		const unsigned long long counter = (static_cast<unsigned long long>(oldHead) >> 32) + 1;
+		return static_cast<long long>((counter << 32) | static_cast<unsigned int>(index));
+	}
+
+	static int getHeadIndex(long long head)
+	{
+		return static_cast<int>(static_cast<unsigned int>(head & 0xffffffff));
+	}
+
+	// a free element stores the index of the next free element in its first bytes
+	int* getNextFree(int index)
+	{
+		return reinterpret_cast<int*>(m_pool + index * m_elemSize);
+	}
 
 public:
+	BT_DECLARE_ALIGNED_ALLOCATOR();
+
 	btPoolAllocator(int elemSize, int maxElements)
 		: m_elemSize(elemSize),
 		  m_maxElements(maxElements)
 	{
+		btAssert(m_elemSize >= int(sizeof(int)));
 		m_pool = (unsigned char*)btAlignedAlloc(static_cast<unsigned int>(m_elemSize * m_maxElements), 16);
 
-		unsigned char* p = m_pool;
-		m_firstFree = p;
-		m_freeCount = m_maxElements;
-		int count = m_maxElements;
-		while (--count)
+		for (int i = 0; i < m_maxElements; ++i)
 		{
-			*(void**)p = (p + m_elemSize);
-			p += m_elemSize;
+			*getNextFree(i) = (i + 1 < m_maxElements) ? i + 1 : -1;
 		}
-		*(void**)p = 0;
+		btAssert((reinterpret_cast<size_t>(&m_firstFree) & 7) == 0);
+		m_firstFree = makeHead(0, m_maxElements ? 0 : -1);
+		m_freeCount = m_maxElements;
+		m_numContentions = 0;
 	}
 
 	~btPoolAllocator()
@@ -55,12 +78,12 @@ public:
 
 	int getFreeCount() const
 	{
-		return m_freeCount;
+		return btAtomicLoad(&m_freeCount);
 	}
 
 	int getUsedCount() const
 	{
-		return m_maxElements - m_freeCount;
+		return m_maxElements - getFreeCount();
 	}
 
 	int getMaxCount() const
@@ -68,21 +91,35 @@ public:
 		return m_maxElements;
 	}
 
+	///how often allocate and freeMemory had to retry because another thread changed the stack at the same time
+	int getNumContentions() const
+	{
+		return btAtomicLoad(&m_numContentions);
+	}
+
 	void* allocate(int size)
 	{
 		// release mode fix
 		(void)size;
-		btMutexLock(&m_mutex);
 		btAssert(!size || size <= m_elemSize);
 		//btAssert(m_freeCount>0);  // should return null if all full
-		void* result = m_firstFree;
-		if (NULL != m_firstFree)
+		while (true)
 		{
-			m_firstFree = *(void**)m_firstFree;
-			--m_freeCount;
+			const long long head = btAtomicLoad64(&m_firstFree);
+			const int index = getHeadIndex(head);
+			if (index < 0)
+			{
+				return NULL;
+			}
+			// may read an element that another thread popped in the meantime, then the compare-exchange fails
+			const int next = btAtomicLoad(getNextFree(index));
+			if (btAtomicCompareExchange64(&m_firstFree, head, makeHead(head, next)))
+			{
+				btAtomicFetchAdd(&m_freeCount, -1);
+				return m_pool + index * m_elemSize;
+			}
+			btAtomicFetchAdd(&m_numContentions, 1);
 		}
-		btMutexUnlock(&m_mutex);
-		return result;
 	}
 
 	bool validPtr(void* ptr)
@@ -103,11 +140,18 @@ public:
 		{
 			btAssert((unsigned char*)ptr >= m_pool && (unsigned char*)ptr < m_pool + m_maxElements * m_elemSize);
 
-			btMutexLock(&m_mutex);
-			*(void**)ptr = m_firstFree;
-			m_firstFree = ptr;
-			++m_freeCount;
-			btMutexUnlock(&m_mutex);
+			const int index = int(((unsigned char*)ptr - m_pool) / m_elemSize);
+			while (true)
+			{
+				const long long head = btAtomicLoad64(&m_firstFree);
+				btAtomicStore(getNextFree(index), getHeadIndex(head));
+				if (btAtomicCompareExchange64(&m_firstFree, head, makeHead(head, index)))
+				{
+					btAtomicFetchAdd(&m_freeCount, 1);
+					return;
+				}
+				btAtomicFetchAdd(&m_numContentions, 1);
+			}
 		}
 	}
 
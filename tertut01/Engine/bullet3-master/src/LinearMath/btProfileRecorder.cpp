@@ -0,0 +1,527 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2006 Erwin Coumans  https://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "btProfileRecorder.h"
+#include "btAlignedAllocator.h"
+#include "btMinMax.h"
+#include <string.h>
+
+#if __cplusplus >= 201103L || (defined(_MSC_VER) && _MSC_VER >= 1700)
+#define BT_PROFILE_RECORDER_USE_CPP11_ATOMICS 1
+#include <atomic>
+#include <chrono>
+#endif
+
+#if !defined(BT_PROFILE_RECORDER_NO_RDTSC) && (defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86))
+#define BT_PROFILE_RECORDER_USE_RDTSC 1
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#endif
+
+typedef unsigned long long btU64;
+
+static const char btProfileRecorderCaptureMagic[8] = {'B', 'T', 'P', 'R', 'O', 'F', '1', 0};
+static const unsigned char btProfileRecorderNameRecord = 'N';
+static const unsigned char btProfileRecorderEventRecord = 'E';
+
+// the clock of the profile zone functions, rdtsc or a steady clock in nanoseconds
+static inline btU64 btProfileRecorderTicks()
+{
+#if BT_PROFILE_RECORDER_USE_RDTSC
+	return __rdtsc();
+#elif BT_PROFILE_RECORDER_USE_CPP11_ATOMICS
+	return btU64(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+#else
+	static btClock clock;
+	return clock.getTimeNanoseconds();
+#endif
+}
+
+// the ring buffer indexes are written by one thread and read by the aggregating thread
+#if BT_PROFILE_RECORDER_USE_CPP11_ATOMICS
+static inline int btProfileRecorderLoad(const int& value)
+{
+	return reinterpret_cast<const std::atomic<int>&>(value).load(std::memory_order_acquire);
+}
+static inline void btProfileRecorderStore(int& value, int newValue)
+{
+	reinterpret_cast<std::atomic<int>&>(value).store(newValue, std::memory_order_release);
+}
+#else
+static inline int btProfileRecorderLoad(const int& value)
+{
+	return *static_cast<const volatile int*>(&value);
+}
+static inline void btProfileRecorderStore(int& value, int newValue)
+{
+	*static_cast<volatile int*>(&value) = newValue;
+}
+#endif
+
+ATTRIBUTE_ALIGNED64(struct)
+btProfileRecorder::ThreadLog
+{
+	struct Event
+	{
+		const char* m_name;
+		btU64 m_startTicks;
+		btU64 m_endTicks;
+	};
+
+	// written by the owning thread
+	Event* m_events;  // allocated at the first zone, m_head publishes it
+	int m_head;
+	int m_numDropped;
+	int m_depth;
+	int m_generation;  // the start() of the recorder that m_depth belongs to
+	const char* m_zoneNames[MAX_ZONE_DEPTH];
+	btU64 m_zoneStartTicks[MAX_ZONE_DEPTH];
+
+	// written by the aggregating thread, on its own cache line
+	ATTRIBUTE_ALIGNED64(int m_tail);
+};
+
+static btProfileRecorder* gCurrentProfileRecorder = 0;
+
+static void btProfileRecorderEnterZone(const char* name)
+{
+	btU64 ticks = btProfileRecorderTicks();
+	btProfileRecorder* recorder = gCurrentProfileRecorder;
+	btProfileRecorder::ThreadLog* log = recorder ? recorder->getThreadLog(btQuickprofGetCurrentThreadIndex2()) : 0;
+	if (log == 0)
+	{
+		return;
+	}
+	int depth = log->m_depth++;
+	if (depth < btProfileRecorder::MAX_ZONE_DEPTH)
+	{
+		log->m_zoneNames[depth] = name;
+		log->m_zoneStartTicks[depth] = ticks;
+	}
+}
+
+static void btProfileRecorderLeaveZone()
+{
+	btU64 ticks = btProfileRecorderTicks();
+	btProfileRecorder* recorder = gCurrentProfileRecorder;
+	btProfileRecorder::ThreadLog* log = recorder ? recorder->getThreadLog(btQuickprofGetCurrentThreadIndex2()) : 0;
+	// zones that were entered before the recorder started are not recorded
+	if (log == 0 || log->m_depth == 0)
+	{
+		return;
+	}
+	int depth = --log->m_depth;
+	if (depth >= btProfileRecorder::MAX_ZONE_DEPTH)
+	{
+		return;
+	}
+	int capacity = recorder->getEventsPerThread();
+	int head = log->m_head;
+	if (head - btProfileRecorderLoad(log->m_tail) >= capacity)
+	{
+		btProfileRecorderStore(log->m_numDropped, log->m_numDropped + 1);
+		return;
+	}
+	btProfileRecorder::ThreadLog::Event& event = log->m_events[head & (capacity - 1)];
+	event.m_name = log->m_zoneNames[depth];
+	event.m_startTicks = log->m_zoneStartTicks[depth];
+	event.m_endTicks = ticks;
+	btProfileRecorderStore(log->m_head, head + 1);
+}
+
+static void btProfileRecorderWriteVarint(btAlignedObjectArray<unsigned char>& buffer, btU64 value)
+{
+	while (value >= 0x80)
+	{
+		buffer.push_back((unsigned char)(value | 0x80));
+		value >>= 7;
+	}
+	buffer.push_back((unsigned char)value);
+}
+
+static bool btProfileRecorderReadVarint(const unsigned char*& data, const unsigned char* end, btU64& value)
+{
+	value = 0;
+	for (int shift = 0; shift < 64; shift += 7)
+	{
+		if (data == end)
+		{
+			return false;
+		}
+		unsigned char byte = *data++;
+		value |= btU64(byte & 0x7f) << shift;
+		if ((byte & 0x80) == 0)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+// the same events as examples/Utils/ChromeTraceUtil, timestamps are in microseconds
+static void btProfileRecorderWriteChromeTraceEvent(FILE* file, bool& first, int threadIndex, const char* name, btU64 startTime, btU64 endTime)
+{
+	if (!first)
+	{
+		fprintf(file, ",\n");
+	}
+	first = false;
+	fprintf(file, "{\"cat\":\"timing\",\"pid\":1,\"tid\":%d,\"ts\":%llu.%03u ,\"ph\":\"B\",\"name\":\"%s\",\"args\":{}},\n",
+			threadIndex, startTime / 1000, unsigned(startTime % 1000), name);
+	fprintf(file, "{\"cat\":\"timing\",\"pid\":1,\"tid\":%d,\"ts\":%llu.%03u ,\"ph\":\"E\",\"name\":\"%s\",\"args\":{}}",
+			threadIndex, endTime / 1000, unsigned(endTime % 1000), name);
+}
+
+btProfileRecorder::btProfileRecorder(int eventsPerThread)
+	: m_keepEvents(false),
+	  m_previousEnterFunc(0),
+	  m_previousLeaveFunc(0),
+	  m_startTicks(0),
+	  m_nanosecondsPerTick(1.0),
+	  m_generation(0),
+	  m_captureFile(0)
+{
+	m_eventsPerThread = 16;
+	while (m_eventsPerThread < eventsPerThread && m_eventsPerThread < (1 << 30))
+	{
+		m_eventsPerThread *= 2;
+	}
+	void* mem = btAlignedAlloc(sizeof(ThreadLog) * MAX_THREAD_COUNT, 64);
+	m_threadLogs = static_cast<ThreadLog*>(mem);
+	memset(mem, 0, sizeof(ThreadLog) * MAX_THREAD_COUNT);
+}
+
+btProfileRecorder::~btProfileRecorder()
+{
+	if (isRecording())
+	{
+		stop();
+	}
+	endCapture();
+	for (int i = 0; i < MAX_THREAD_COUNT; ++i)
+	{
+		if (m_threadLogs[i].m_events)
+		{
+			btAlignedFree(m_threadLogs[i].m_events);
+		}
+	}
+	btAlignedFree(m_threadLogs);
+}
+
+btProfileRecorder::ThreadLog* btProfileRecorder::getThreadLog(unsigned int threadIndex)
+{
+	if (threadIndex >= (unsigned int)MAX_THREAD_COUNT)
+	{
+		return 0;
+	}
+	ThreadLog* log = &m_threadLogs[threadIndex];
+	if (log->m_generation != m_generation)
+	{
+		// the thread may have been inside a zone when the recorder stopped, so its zones start over
+		if (log->m_events == 0)
+		{
+			// published to the aggregating thread by the first store of m_head
+			log->m_events = static_cast<ThreadLog::Event*>(btAlignedAlloc(sizeof(ThreadLog::Event) * m_eventsPerThread, 64));
+		}
+		log->m_depth = 0;
+		log->m_generation = m_generation;
+	}
+	return log;
+}
+
+void btProfileRecorder::start()
+{
+	btAssert(gCurrentProfileRecorder == 0);
+	if (gCurrentProfileRecorder)
+	{
+		return;
+	}
+	m_generation++;
+	m_clock.reset();
+	m_startTicks = btProfileRecorderTicks();
+	m_nanosecondsPerTick = 1.0;
+	m_previousEnterFunc = btGetCurrentEnterProfileZoneFunc();
+	m_previousLeaveFunc = btGetCurrentLeaveProfileZoneFunc();
+	gCurrentProfileRecorder = this;
+	btSetCustomEnterProfileZoneFunc(btProfileRecorderEnterZone);
+	btSetCustomLeaveProfileZoneFunc(btProfileRecorderLeaveZone);
+}
+
+void btProfileRecorder::stop()
+{
+	if (!isRecording())
+	{
+		return;
+	}
+	btSetCustomEnterProfileZoneFunc(m_previousEnterFunc);
+	btSetCustomLeaveProfileZoneFunc(m_previousLeaveFunc);
+	gCurrentProfileRecorder = 0;
+	aggregate();
+}
+
+bool btProfileRecorder::isRecording() const
+{
+	return gCurrentProfileRecorder == this;
+}
+
+btU64 btProfileRecorder::toNanoseconds(btU64 ticks) const
+{
+	return ticks > m_startTicks ? btU64(double(ticks - m_startTicks) * m_nanosecondsPerTick) : 0;
+}
+
+int btProfileRecorder::getCaptureNameIndex(const char* name)
+{
+	const int* index = m_captureNames.find(btHashPtr(name));
+	if (index)
+	{
+		return *index;
+	}
+	// a name record precedes the first event record that uses it
+	int nameIndex = m_captureNames.size();
+	m_captureNames.insert(btHashPtr(name), nameIndex);
+	int length = int(strlen(name));
+	btAlignedObjectArray<unsigned char> record;
+	record.push_back(btProfileRecorderNameRecord);
+	btProfileRecorderWriteVarint(record, btU64(nameIndex));
+	btProfileRecorderWriteVarint(record, btU64(length));
+	fwrite(&record[0], 1, record.size(), m_captureFile);
+	fwrite(name, 1, length, m_captureFile);
+	return nameIndex;
+}
+
+void btProfileRecorder::aggregate()
+{
+#if BT_PROFILE_RECORDER_USE_RDTSC
+	// refine the rate of the time stamp counter with the time since start
+	btU64 ticks = btProfileRecorderTicks();
+	btU64 nanoseconds = m_clock.getTimeNanoseconds();
+	if (ticks > m_startTicks && nanoseconds > 0)
+	{
+		m_nanosecondsPerTick = double(nanoseconds) / double(ticks - m_startTicks);
+	}
+#endif
+	for (int threadIndex = 0; threadIndex < MAX_THREAD_COUNT; ++threadIndex)
+	{
+		ThreadLog& log = m_threadLogs[threadIndex];
+		int head = btProfileRecorderLoad(log.m_head);
+		int tail = log.m_tail;
+		if (head == tail)
+		{
+			continue;
+		}
+		m_captureBuffer.resize(0);
+		btU64 previousStartTime = 0;
+		const char* lastName = 0;
+		int lastStatsIndex = -1;
+		for (int i = tail; i != head; ++i)
+		{
+			const ThreadLog::Event& logEvent = log.m_events[i & (m_eventsPerThread - 1)];
+			btProfileEvent event;
+			event.m_name = logEvent.m_name;
+			event.m_startTime = toNanoseconds(logEvent.m_startTicks);
+			event.m_endTime = btMax(event.m_startTime, toNanoseconds(logEvent.m_endTicks));
+			event.m_threadIndex = threadIndex;
+			btU64 duration = event.m_endTime - event.m_startTime;
+
+			// zones in loops repeat their name, so most lookups are skipped
+			if (event.m_name != lastName)
+			{
+				const int* index = m_zoneStatsIndex.find(btHashPtr(event.m_name));
+				if (index == 0)
+				{
+					btProfileZoneStats newStats;
+					newStats.m_name = event.m_name;
+					newStats.m_numCalls = 0;
+					newStats.m_totalTime = 0;
+					newStats.m_maxTime = 0;
+					m_zoneStatsIndex.insert(btHashPtr(event.m_name), m_zoneStats.size());
+					m_zoneStats.push_back(newStats);
+				}
+				lastName = event.m_name;
+				lastStatsIndex = index ? *index : m_zoneStats.size() - 1;
+			}
+			btProfileZoneStats& stats = m_zoneStats[lastStatsIndex];
+			stats.m_numCalls++;
+			stats.m_totalTime += duration;
+			stats.m_maxTime = btMax(stats.m_maxTime, duration);
+
+			if (m_keepEvents)
+			{
+				m_events.push_back(event);
+			}
+			if (m_captureFile)
+			{
+				// the events of a thread are ordered by their end, so the start can go back in time
+				long long delta = (long long)(event.m_startTime - previousStartTime);
+				previousStartTime = event.m_startTime;
+				btProfileRecorderWriteVarint(m_captureBuffer, btU64(getCaptureNameIndex(event.m_name)));
+				btProfileRecorderWriteVarint(m_captureBuffer, (btU64(delta) << 1) ^ btU64(delta >> 63));
+				btProfileRecorderWriteVarint(m_captureBuffer, duration);
+			}
+		}
+		btProfileRecorderStore(log.m_tail, head);
+
+		if (m_captureFile)
+		{
+			btAlignedObjectArray<unsigned char> record;
+			record.push_back(btProfileRecorderEventRecord);
+			btProfileRecorderWriteVarint(record, btU64(threadIndex));
+			btProfileRecorderWriteVarint(record, btU64(head - tail));
+			fwrite(&record[0], 1, record.size(), m_captureFile);
+			fwrite(&m_captureBuffer[0], 1, m_captureBuffer.size(), m_captureFile);
+		}
+	}
+}
+
+void btProfileRecorder::resetZoneStats()
+{
+	m_zoneStats.resize(0);
+	m_zoneStatsIndex.clear();
+}
+
+int btProfileRecorder::getNumDroppedZones() const
+{
+	int numDropped = 0;
+	for (int i = 0; i < MAX_THREAD_COUNT; ++i)
+	{
+		numDropped += btProfileRecorderLoad(m_threadLogs[i].m_numDropped);
+	}
+	return numDropped;
+}
+
+bool btProfileRecorder::writeChromeTrace(const char* fileName) const
+{
+	FILE* file = fopen(fileName, "w");
+	if (file == 0)
+	{
+		return false;
+	}
+	fprintf(file, "{\"traceEvents\":[\n");
+	bool first = true;
+	for (int i = 0; i < m_events.size(); ++i)
+	{
+		const btProfileEvent& event = m_events[i];
+		btProfileRecorderWriteChromeTraceEvent(file, first, event.m_threadIndex, event.m_name, event.m_startTime, event.m_endTime);
+	}
+	fprintf(file, "\n],\n\"displayTimeUnit\": \"ns\"}");
+	fclose(file);
+	return true;
+}
+
+bool btProfileRecorder::beginCapture(const char* fileName)
+{
+	endCapture();
+	m_captureFile = fopen(fileName, "wb");
+	if (m_captureFile == 0)
+	{
+		return false;
+	}
+	fwrite(btProfileRecorderCaptureMagic, 1, sizeof(btProfileRecorderCaptureMagic), m_captureFile);
+	return true;
+}
+
+void btProfileRecorder::endCapture()
+{
+	if (m_captureFile)
+	{
+		fclose(m_captureFile);
+		m_captureFile = 0;
+		m_captureNames.clear();
+	}
+}
+
+bool btProfileRecorder::convertCaptureToChromeTrace(const char* captureFileName, const char* jsonFileName)
+{
+	FILE* captureFile = fopen(captureFileName, "rb");
+	if (captureFile == 0)
+	{
+		return false;
+	}
+	btAlignedObjectArray<unsigned char> capture;
+	unsigned char chunk[4096];
+	size_t numRead;
+	while ((numRead = fread(chunk, 1, sizeof(chunk), captureFile)) > 0)
+	{
+		for (size_t i = 0; i < numRead; ++i)
+		{
+			capture.push_back(chunk[i]);
+		}
+	}
+	fclose(captureFile);
+	if (capture.size() < int(sizeof(btProfileRecorderCaptureMagic)) || memcmp(&capture[0], btProfileRecorderCaptureMagic, sizeof(btProfileRecorderCaptureMagic)) != 0)
+	{
+		return false;
+	}
+
+	FILE* file = fopen(jsonFileName, "w");
+	if (file == 0)
+	{
+		return false;
+	}
+	fprintf(file, "{\"traceEvents\":[\n");
+	bool first = true;
+	bool valid = true;
+	btAlignedObjectArray<char> nameChars;  // the names, each terminated by a zero
+	btAlignedObjectArray<int> nameOffsets;
+	const unsigned char* data = &capture[0] + sizeof(btProfileRecorderCaptureMagic);
+	const unsigned char* end = &capture[0] + capture.size();
+	while (valid && data != end)
+	{
+		unsigned char recordType = *data++;
+		if (recordType == btProfileRecorderNameRecord)
+		{
+			btU64 nameIndex, length;
+			valid = btProfileRecorderReadVarint(data, end, nameIndex) && btProfileRecorderReadVarint(data, end, length) &&
+					nameIndex == btU64(nameOffsets.size()) && length <= btU64(end - data);
+			if (valid)
+			{
+				nameOffsets.push_back(nameChars.size());
+				for (btU64 i = 0; i < length; ++i)
+				{
+					nameChars.push_back(char(*data++));
+				}
+				nameChars.push_back(0);
+			}
+		}
+		else if (recordType == btProfileRecorderEventRecord)
+		{
+			btU64 threadIndex, numEvents;
+			valid = btProfileRecorderReadVarint(data, end, threadIndex) && btProfileRecorderReadVarint(data, end, numEvents);
+			btU64 startTime = 0;
+			for (btU64 i = 0; valid && i < numEvents; ++i)
+			{
+				btU64 nameIndex, zigzagDelta, duration;
+				valid = btProfileRecorderReadVarint(data, end, nameIndex) && btProfileRecorderReadVarint(data, end, zigzagDelta) &&
+						btProfileRecorderReadVarint(data, end, duration) && nameIndex < btU64(nameOffsets.size());
+				if (valid)
+				{
+					startTime += (zigzagDelta >> 1) ^ (~(zigzagDelta & 1) + 1);
+					const char* name = &nameChars[nameOffsets[int(nameIndex)]];
+					btProfileRecorderWriteChromeTraceEvent(file, first, int(threadIndex), name, startTime, startTime + duration);
+				}
+			}
+		}
+		else
+		{
+			valid = false;
+		}
+	}
+	fprintf(file, "\n],\n\"displayTimeUnit\": \"ns\"}");
+	fclose(file);
+	return valid;
+}
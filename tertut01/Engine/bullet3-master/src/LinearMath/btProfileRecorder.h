@@ -0,0 +1,136 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2006 Erwin Coumans  https://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef BT_PROFILE_RECORDER_H
+#define BT_PROFILE_RECORDER_H
+
+#include "btQuickprof.h"
+#include "btAlignedObjectArray.h"
+#include "btHashMap.h"
+#include <stdio.h>
+
+///a finished BT_PROFILE zone, times are in nanoseconds since the recorder started
+struct btProfileEvent
+{
+	const char* m_name;
+	unsigned long long m_startTime;
+	unsigned long long m_endTime;
+	int m_threadIndex;
+};
+
+///the zones with the same name string, over all threads, since the last resetZoneStats
+struct btProfileZoneStats
+{
+	const char* m_name;
+	int m_numCalls;
+	unsigned long long m_totalTime;
+	unsigned long long m_maxTime;
+};
+
+///
+/// btProfileRecorder -- records BT_PROFILE zones of all threads, including the worker threads of the task scheduler.
+///
+///  While it records, it is installed as the enter/leave profile zone function. Each thread writes its finished zones
+///  into its own fixed size ring buffer, without locks or allocations after the first zone, and timestamps them with
+///  rdtsc where available and a steady clock otherwise. When nothing records, BT_PROFILE costs the call to the
+///  default empty zone functions, as before.
+///
+///  aggregate() drains the ring buffers, adds the zones to the per name statistics and to the capture, so it should be
+///  called periodically, for example once per frame, from one thread at a time. Zones that do not fit into a full ring
+///  buffer are dropped and counted. Zones deeper than MAX_ZONE_DEPTH are not recorded.
+///
+///  Zones can be kept in memory and written as a Chrome trace JSON file in the format of examples/Utils/ChromeTraceUtil,
+///  for chrome://tracing. For long runs, beginCapture streams them to a compact binary file instead,
+///  about 4 bytes per zone, which convertCaptureToChromeTrace turns into JSON later.
+///
+///  The overhead per zone is measured by test/BulletDynamics/test_btProfileRecorder.cpp. On a virtualized Xeon, where
+///  rdtsc alone takes 12 ns, an enter/leave pair costs 3 ns without a recorder and 34 ns while recording, including
+///  aggregate(). The two clock reads are most of it.
+///
+class btProfileRecorder
+{
+public:
+	enum
+	{
+		MAX_THREAD_COUNT = BT_QUICKPROF_MAX_THREAD_COUNT,
+		MAX_ZONE_DEPTH = 64
+	};
+
+	struct ThreadLog;
+
+	///eventsPerThread is rounded up to a power of two, each event takes 24 bytes on 64 bit platforms
+	btProfileRecorder(int eventsPerThread = 16384);
+	~btProfileRecorder();
+
+	///installs this recorder as the profile zone functions, only one recorder can record at a time.
+	///The profile zone functions are plain pointers, so start and stop between simulation steps, and keep the recorder
+	///alive as long as the threads of the task scheduler, which may still be inside a zone.
+	void start();
+	///restores the previous profile zone functions and drains the ring buffers
+	void stop();
+	bool isRecording() const;
+
+	///moves the zones of all threads from their ring buffers into the statistics and the capture
+	void aggregate();
+
+	const btAlignedObjectArray<btProfileZoneStats>& getZoneStats() const { return m_zoneStats; }
+	void resetZoneStats();
+	///the zones that did not fit into the ring buffers since the recorder was created
+	int getNumDroppedZones() const;
+
+	///with keepEvents, aggregate() also collects the zones for writeChromeTrace
+	void setKeepEvents(bool keepEvents) { m_keepEvents = keepEvents; }
+	const btAlignedObjectArray<btProfileEvent>& getEvents() const { return m_events; }
+	void clearEvents() { m_events.resize(0); }
+	bool writeChromeTrace(const char* fileName) const;
+
+	///aggregate() writes the zones to fileName until endCapture
+	bool beginCapture(const char* fileName);
+	void endCapture();
+	static bool convertCaptureToChromeTrace(const char* captureFileName, const char* jsonFileName);
+
+	///for the profile zone functions, called by the thread with threadIndex only
+	ThreadLog* getThreadLog(unsigned int threadIndex);
+	int getEventsPerThread() const { return m_eventsPerThread; }
+
+private:
+	btProfileRecorder(const btProfileRecorder&);
+	btProfileRecorder& operator=(const btProfileRecorder&);
+
+	unsigned long long toNanoseconds(unsigned long long ticks) const;
+	int getCaptureNameIndex(const char* name);
+
+	ThreadLog* m_threadLogs;
+	int m_eventsPerThread;
+	bool m_keepEvents;
+	btEnterProfileZoneFunc* m_previousEnterFunc;
+	btLeaveProfileZoneFunc* m_previousLeaveFunc;
+
+	// the clock that started with the recorder, rdtsc ticks are converted with the rate measured up to the last aggregate
+	btClock m_clock;
+	unsigned long long m_startTicks;
+	double m_nanosecondsPerTick;
+	int m_generation;  // counts the calls to start
+
+	btAlignedObjectArray<btProfileZoneStats> m_zoneStats;
+	btHashMap<btHashPtr, int> m_zoneStatsIndex;
+	btAlignedObjectArray<btProfileEvent> m_events;
+
+	FILE* m_captureFile;
+	btHashMap<btHashPtr, int> m_captureNames;  // the index of each name written to the capture
+	btAlignedObjectArray<unsigned char> m_captureBuffer;  // the events of one thread, written as one record
+};
+
+#endif  //BT_PROFILE_RECORDER_H
@@ -605,14 +605,21 @@ public:
 
 	virtual btChunk* allocate(size_t size, int numElements)
 	{
-		unsigned char* ptr = internalAlloc(int(size) * numElements + sizeof(btChunk));
+		const int length = int(size) * numElements;
+		//pad the chunk so that the data of the next chunk starts 16 byte aligned in the file,
+		//then a memory mapped file can use arrays such as the quantized BVH nodes in place
+		const int fileOffset = m_currentSize + (m_totalSize ? 0 : BT_HEADER_LENGTH);
+		const int padding = (16 - (fileOffset + 2 * int(sizeof(btChunk)) + length) % 16) % 16;
+
+		unsigned char* ptr = internalAlloc(length + padding + sizeof(btChunk));
 
 		unsigned char* data = ptr + sizeof(btChunk);
+		memset(data + length, 0, padding);
 
 		btChunk* chunk = (btChunk*)ptr;
 		chunk->m_chunkCode = 0;
 		chunk->m_oldPtr = data;
-		chunk->m_length = int(size) * numElements;
+		chunk->m_length = length + padding;
 		chunk->m_number = numElements;
 
 		m_chunkPtrs.push_back(chunk);
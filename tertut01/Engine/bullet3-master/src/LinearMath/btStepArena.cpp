@@ -0,0 +1,173 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2006 Erwin Coumans  https://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "btStepArena.h"
+#include "btAlignedAllocator.h"
+#include "btMinMax.h"
+
+btStepArena::btStepArena(size_t minBlockSize)
+{
+	m_currentBlock = 0;
+	m_offset = 0;
+	m_blockBase = 0;
+	m_minBlockSize = minBlockSize;
+	m_numAllocations = 0;
+	m_numBlockAllocations = 0;
+	m_peakBytes = 0;
+}
+
+btStepArena::~btStepArena()
+{
+	freeBlocks();
+}
+
+void btStepArena::addBlock(size_t size)
+{
+	Block block;
+	block.m_memory = static_cast<unsigned char*>(btAlignedAlloc(size, 64));
+	block.m_size = size;
+	m_blocks.push_back(block);
+	++m_numBlockAllocations;
+}
+
+void btStepArena::freeBlocks()
+{
+	for (int i = 0; i < m_blocks.size(); ++i)
+	{
+		btAlignedFree(m_blocks[i].m_memory);
+	}
+	m_blocks.clear();
+}
+
+void* btStepArena::allocate(size_t size, size_t alignment)
+{
+	btAssert(alignment > 0 && (alignment & (alignment - 1)) == 0);
+	while (true)
+	{
+		if (m_currentBlock < m_blocks.size())
+		{
+			const Block& block = m_blocks[m_currentBlock];
+			const size_t address = reinterpret_cast<size_t>(block.m_memory) + m_offset;
+			const size_t start = ((address + alignment - 1) & ~(alignment - 1)) - reinterpret_cast<size_t>(block.m_memory);
+			if (start + size <= block.m_size)
+			{
+				m_offset = start + size;
+				++m_numAllocations;
+				m_peakBytes = btMax(m_peakBytes, m_blockBase + m_offset);
+				return block.m_memory + start;
+			}
+			// the rest of this block is lost until the next rewind or reset
+			m_blockBase += block.m_size;
+			m_offset = 0;
+			++m_currentBlock;
+			continue;
+		}
+		size_t blockSize = m_blocks.size() ? m_blocks[m_blocks.size() - 1].m_size * 2 : m_minBlockSize;
+		addBlock(btMax(blockSize, size + alignment));
+	}
+}
+
+void btStepArena::reset()
+{
+	if (m_blocks.size() > 1)
+	{
+		const size_t capacity = getCapacity();
+		freeBlocks();
+		addBlock(capacity);
+	}
+	m_currentBlock = 0;
+	m_offset = 0;
+	m_blockBase = 0;
+}
+
+bool btStepArena::owns(const void* ptr) const
+{
+	const unsigned char* p = static_cast<const unsigned char*>(ptr);
+	for (int i = 0; i <= m_currentBlock && i < m_blocks.size(); ++i)
+	{
+		const Block& block = m_blocks[i];
+		const size_t end = (i == m_currentBlock) ? m_offset : block.m_size;
+		if (p >= block.m_memory && p < block.m_memory + end)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+size_t btStepArena::getCapacity() const
+{
+	size_t capacity = 0;
+	for (int i = 0; i < m_blocks.size(); ++i)
+	{
+		capacity += m_blocks[i].m_size;
+	}
+	return capacity;
+}
+
+void btStepArena::resetStats()
+{
+	m_numAllocations = 0;
+	m_numBlockAllocations = 0;
+	m_peakBytes = getBytesInUse();
+}
+
+// one cache line or more per arena, so the threads do not write to each other's lines
+ATTRIBUTE_ALIGNED64(struct)
+btThreadArenaSlot
+{
+	btStepArena m_arena;
+};
+
+static btThreadArenaSlot gThreadArenas[BT_MAX_THREAD_COUNT];
+
+btStepArena* btGetThreadArena()
+{
+	const unsigned int threadIndex = btGetCurrentThreadIndex();
+	btAssert(threadIndex < BT_MAX_THREAD_COUNT);
+	return &gThreadArenas[threadIndex].m_arena;
+}
+
+void btResetThreadArenas()
+{
+	for (unsigned int i = 0; i < BT_MAX_THREAD_COUNT; ++i)
+	{
+		gThreadArenas[i].m_arena.reset();
+	}
+}
+
+void btGetThreadArenaStats(btStepArenaStats& stats)
+{
+	stats.m_numAllocations = 0;
+	stats.m_numBlockAllocations = 0;
+	stats.m_peakBytes = 0;
+	stats.m_capacity = 0;
+	for (unsigned int i = 0; i < BT_MAX_THREAD_COUNT; ++i)
+	{
+		const btStepArena& arena = gThreadArenas[i].m_arena;
+		stats.m_numAllocations += arena.getNumAllocations();
+		stats.m_numBlockAllocations += arena.getNumBlockAllocations();
+		stats.m_peakBytes += arena.getPeakBytes();
+		stats.m_capacity += arena.getCapacity();
+	}
+}
+
+void btResetThreadArenaStats()
+{
+	for (unsigned int i = 0; i < BT_MAX_THREAD_COUNT; ++i)
+	{
+		gThreadArenas[i].m_arena.resetStats();
+	}
+}
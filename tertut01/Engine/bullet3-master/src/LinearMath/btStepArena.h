@@ -0,0 +1,129 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2006 Erwin Coumans  https://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef BT_STEP_ARENA_H
+#define BT_STEP_ARENA_H
+
+#include "btAlignedObjectArray.h"
+#include "btThreads.h"
+
+///
+/// btStepArena -- linear allocator for scratch memory that lives no longer than a simulation step.
+///
+///  Allocating moves an offset forward in the current block, single allocations are never freed. rewind releases
+///  everything allocated after a marker, reset releases everything. If a step did not fit into one block, reset
+///  replaces the blocks by a single block as large as all of them, so the following steps of the same size do not
+///  touch the heap at all.
+///
+///  An arena is not thread safe. btGetThreadArena returns the arena of the calling thread, so code running in a
+///  btParallelFor loop can allocate without locks, as long as it releases the memory before the loop ends.
+///
+class btStepArena
+{
+public:
+	struct Marker
+	{
+		int m_block;
+		size_t m_offset;
+		size_t m_blockBase;
+	};
+
+	btStepArena(size_t minBlockSize = 64 * 1024);
+	~btStepArena();
+
+	///alignment must be a power of two
+	void* allocate(size_t size, size_t alignment = 16);
+
+	template <typename T>
+	T* allocateArray(int count)
+	{
+		return static_cast<T*>(allocate(sizeof(T) * count, 16));
+	}
+
+	Marker getMarker() const
+	{
+		Marker marker;
+		marker.m_block = m_currentBlock;
+		marker.m_offset = m_offset;
+		marker.m_blockBase = m_blockBase;
+		return marker;
+	}
+
+	///releases everything allocated after the marker was taken
+	void rewind(const Marker& marker)
+	{
+		btAssert(marker.m_block < m_currentBlock || (marker.m_block == m_currentBlock && marker.m_offset <= m_offset));
+		m_currentBlock = marker.m_block;
+		m_offset = marker.m_offset;
+		m_blockBase = marker.m_blockBase;
+	}
+
+	///releases everything, and merges the blocks into one if there is more than one
+	void reset();
+
+	///true if ptr is inside the part of the arena that is allocated
+	bool owns(const void* ptr) const;
+
+	int getNumAllocations() const { return m_numAllocations; }
+	int getNumBlockAllocations() const { return m_numBlockAllocations; }
+	size_t getBytesInUse() const { return m_blockBase + m_offset; }
+	size_t getPeakBytes() const { return m_peakBytes; }
+	size_t getCapacity() const;
+	void resetStats();
+
+private:
+	struct Block
+	{
+		unsigned char* m_memory;
+		size_t m_size;
+	};
+
+	btAlignedObjectArray<Block> m_blocks;
+	int m_currentBlock;
+	size_t m_offset;
+	size_t m_blockBase;  // bytes of the blocks before the current one
+	size_t m_minBlockSize;
+
+	int m_numAllocations;
+	int m_numBlockAllocations;
+	size_t m_peakBytes;
+
+	void addBlock(size_t size);
+	void freeBlocks();
+
+	btStepArena(const btStepArena&);
+	btStepArena& operator=(const btStepArena&);
+};
+
+///the statistics of the arenas of all threads, added up
+struct btStepArenaStats
+{
+	int m_numAllocations;
+	int m_numBlockAllocations;
+	size_t m_peakBytes;
+	size_t m_capacity;
+};
+
+///the arena of the calling thread, by btGetCurrentThreadIndex
+btStepArena* btGetThreadArena();
+
+///resets the arenas of all threads. Call it between steps, when no thread allocates from its arena,
+///like btDiscreteDynamicsWorldMt::stepSimulation does
+void btResetThreadArenas();
+
+void btGetThreadArenaStats(btStepArenaStats& stats);
+void btResetThreadArenaStats();
+
+#endif  //BT_STEP_ARENA_H
@@ -0,0 +1,161 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2006 Erwin Coumans  https://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "btTaskGraph.h"
+#include "btQuickprof.h"
+
+btTaskGraph::btTaskGraph()
+{
+}
+
+void btTaskGraph::clear()
+{
+	m_tasks.resizeNoInitialize(0);
+	m_dependencies.resizeNoInitialize(0);
+	m_successors.resizeNoInitialize(0);
+	m_rootTasks.resizeNoInitialize(0);
+	m_pendingCounts.resizeNoInitialize(0);
+	m_sequentialOrder.resizeNoInitialize(0);
+}
+
+int btTaskGraph::addTask(const btITaskBody& body, int taskArg)
+{
+	Task& task = m_tasks.expandNonInitializing();
+	task.m_body = &body;
+	task.m_arg = taskArg;
+	task.m_numPredecessors = 0;
+	task.m_firstSuccessor = 0;
+	return m_tasks.size() - 1;
+}
+
+void btTaskGraph::addDependency(int predecessor, int successor)
+{
+	btAssert(predecessor >= 0 && predecessor < m_tasks.size());
+	btAssert(successor >= 0 && successor < m_tasks.size());
+	btAssert(predecessor != successor);
+	m_dependencies.push_back(predecessor);
+	m_dependencies.push_back(successor);
+}
+
+int btTaskGraph::addContinuation(const btITaskBody& body, int taskArg, const int* predecessors, int numPredecessors)
+{
+	int task = addTask(body, taskArg);
+	for (int i = 0; i < numPredecessors; ++i)
+	{
+		addDependency(predecessors[i], task);
+	}
+	return task;
+}
+
+bool btTaskGraph::prepare()
+{
+	BT_PROFILE("btTaskGraph::prepare");
+	const int numTasks = m_tasks.size();
+	const int numDependencies = m_dependencies.size() / 2;
+
+	// counting sort of the dependencies by predecessor gives the successor lists
+	for (int i = 0; i < numTasks; ++i)
+	{
+		m_tasks[i].m_numPredecessors = 0;
+		m_tasks[i].m_firstSuccessor = 0;
+	}
+	for (int i = 0; i < numDependencies; ++i)
+	{
+		m_tasks[m_dependencies[i * 2]].m_firstSuccessor++;
+		m_tasks[m_dependencies[i * 2 + 1]].m_numPredecessors++;
+	}
+	int offset = 0;
+	for (int i = 0; i < numTasks; ++i)
+	{
+		int count = m_tasks[i].m_firstSuccessor;
+		m_tasks[i].m_firstSuccessor = offset;
+		offset += count;
+	}
+	m_successors.resizeNoInitialize(numDependencies);
+	m_pendingCounts.resizeNoInitialize(numTasks);
+	for (int i = 0; i < numTasks; ++i)
+	{
+		m_pendingCounts[i] = 0;
+	}
+	for (int i = 0; i < numDependencies; ++i)
+	{
+		int predecessor = m_dependencies[i * 2];
+		m_successors[m_tasks[predecessor].m_firstSuccessor + m_pendingCounts[predecessor]++] = m_dependencies[i * 2 + 1];
+	}
+
+	m_rootTasks.resizeNoInitialize(0);
+	for (int i = 0; i < numTasks; ++i)
+	{
+		m_pendingCounts[i] = m_tasks[i].m_numPredecessors;
+		if (m_tasks[i].m_numPredecessors == 0)
+		{
+			m_rootTasks.push_back(i);
+		}
+	}
+
+	// a topological sort both checks for cycles and gives the order for running without threads
+	m_sequentialOrder.resizeNoInitialize(0);
+	for (int i = 0; i < m_rootTasks.size(); ++i)
+	{
+		m_sequentialOrder.push_back(m_rootTasks[i]);
+	}
+	for (int i = 0; i < m_sequentialOrder.size(); ++i)
+	{
+		int task = m_sequentialOrder[i];
+		for (int j = 0; j < getNumSuccessors(task); ++j)
+		{
+			int successor = getSuccessor(task, j);
+			if (--m_pendingCounts[successor] == 0)
+			{
+				m_sequentialOrder.push_back(successor);
+			}
+		}
+	}
+	for (int i = 0; i < numTasks; ++i)
+	{
+		m_pendingCounts[i] = m_tasks[i].m_numPredecessors;
+	}
+	return m_sequentialOrder.size() == numTasks;
+}
+
+void btTaskGraph::runSequential()
+{
+	BT_PROFILE("btTaskGraph::runSequential");
+	if (!prepare())
+	{
+		btAssert(!"btTaskGraph has a dependency cycle");
+		return;
+	}
+	for (int i = 0; i < m_sequentialOrder.size(); ++i)
+	{
+		runTask(m_sequentialOrder[i]);
+	}
+}
+
+void btRunTaskGraph(btTaskGraph& graph)
+{
+#if BT_THREADSAFE
+
+	btITaskScheduler* scheduler = btGetTaskScheduler();
+	btAssert(scheduler != NULL);  // call btSetTaskScheduler() with a valid task scheduler first!
+	scheduler->runTaskGraph(graph);
+
+#else  // #if BT_THREADSAFE
+
+	// unlike btParallelFor this is fine without threads, the tasks just run one after another
+	graph.runSequential();
+
+#endif  // #if BT_THREADSAFE
+}
@@ -0,0 +1,107 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2006 Erwin Coumans  https://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef BT_TASK_GRAPH_H
+#define BT_TASK_GRAPH_H
+
+#include "btAlignedObjectArray.h"
+#include "btThreads.h"
+
+//
+// btITaskBody -- subclass this to express a task of a btTaskGraph.
+//                The same body may be shared by many tasks, each task passes its own argument
+//
+class btITaskBody
+{
+public:
+	virtual ~btITaskBody() {}
+	virtual void runTask(int taskArg) const = 0;
+};
+
+///
+/// btTaskGraph -- a set of tasks and the dependencies between them.
+///
+///  A task may start once every task it depends on has finished, so independent chains of work
+///  overlap instead of waiting at a barrier like consecutive btParallelFor calls do.
+///  A continuation is just a task that depends on the tasks it continues: when the last of them finishes,
+///  the thread that finished it runs the continuation right away, while the data is still in its cache.
+///
+///  The graph is built on one thread, then run with btRunTaskGraph(). Running it does not change the
+///  tasks or dependencies, so a graph with the same shape can be run again without rebuilding it.
+///
+///  In the dynamics world only the island stage uses it so far (btSimulationIslandManagerMt::taskGraphIslandDispatch):
+///  each island's integration continues its solve. The other stages of the step are still btParallelFor barriers.
+///
+class btTaskGraph
+{
+	struct Task
+	{
+		const btITaskBody* m_body;
+		int m_arg;
+		int m_numPredecessors;
+		int m_firstSuccessor;  // into m_successors, set by prepare()
+	};
+	btAlignedObjectArray<Task> m_tasks;
+	btAlignedObjectArray<int> m_dependencies;  // pairs of predecessor, successor in the order they were added
+	btAlignedObjectArray<int> m_successors;    // successors of each task, grouped by task
+	btAlignedObjectArray<int> m_rootTasks;     // tasks without predecessors
+	btAlignedObjectArray<int> m_pendingCounts;  // unfinished predecessors of each task while the graph runs
+	btAlignedObjectArray<int> m_sequentialOrder;  // a topological order, set by prepare()
+
+public:
+	btTaskGraph();
+
+	void clear();
+
+	// returns the index of the new task
+	int addTask(const btITaskBody& body, int taskArg = 0);
+
+	// the successor will not start before the predecessor has finished
+	void addDependency(int predecessor, int successor);
+
+	// adds a task that runs after all the given tasks have finished, returns its index
+	int addContinuation(const btITaskBody& body, int taskArg, const int* predecessors, int numPredecessors);
+
+	int getNumTasks() const { return m_tasks.size(); }
+
+	//
+	// for task schedulers
+	//
+
+	// called at the start of every run: builds the successor lists and resets the pending counts.
+	// Returns false if the dependencies contain a cycle, in which case the graph must not be run
+	bool prepare();
+	const btAlignedObjectArray<int>& getRootTasks() const { return m_rootTasks; }
+	int getNumSuccessors(int task) const
+	{
+		return (task + 1 < m_tasks.size() ? m_tasks[task + 1].m_firstSuccessor : m_successors.size()) - m_tasks[task].m_firstSuccessor;
+	}
+	int getSuccessor(int task, int i) const { return m_successors[m_tasks[task].m_firstSuccessor + i]; }
+	// counters a scheduler decrements atomically; a task is ready when its counter drops to zero
+	int* getPendingCounts() { return m_pendingCounts.size() ? &m_pendingCounts[0] : NULL; }
+	void runTask(int task) const
+	{
+		const Task& t = m_tasks[task];
+		t.m_body->runTask(t.m_arg);
+	}
+
+	// runs the tasks on the calling thread in an order that respects the dependencies
+	void runSequential();
+};
+
+// btRunTaskGraph -- call this to run all tasks of a graph on the current task scheduler, returns when all have finished
+void btRunTaskGraph(btTaskGraph& graph);
+
+#endif  //BT_TASK_GRAPH_H
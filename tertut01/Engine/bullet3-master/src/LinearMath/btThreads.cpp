@@ -13,7 +13,9 @@ subject to the following restrictions:
 */
 
 #include "btThreads.h"
+#include "btTaskGraph.h"
 #include "btQuickprof.h"
+#include "btAlignedObjectArray.h"
 #include <algorithm>  // for min and max
 
 #if BT_USE_OPENMP && BT_THREADSAFE
@@ -364,6 +366,11 @@ void btITaskScheduler::deactivate()
 	}
 }
 
+void btITaskScheduler::runTaskGraph(btTaskGraph& graph)
+{
+	graph.runSequential();
+}
+
 void btPushThreadsAreRunning()
 {
 	gThreadsRunningCounterMutex.lock();
@@ -463,6 +470,47 @@ btScalar btParallelSum(int iBegin, int iEnd, int grainSize, const btIParallelSum
 #endif  //#else // #if BT_THREADSAFE
 }
 
+struct btParallelSumOrderedLoop : public btIParallelForBody
+{
+	const btIParallelSumBody* m_body;
+	btScalar* m_sums;
+	int m_begin;
+
+	void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
+	{
+		for (int i = iBegin; i < iEnd; ++i)
+		{
+			m_sums[i - m_begin] = m_body->sumLoop(i, i + 1);
+		}
+	}
+};
+
+btScalar btParallelSumOrdered(int iBegin, int iEnd, int grainSize, const btIParallelSumBody& body)
+{
+	if (iEnd <= iBegin)
+	{
+		return btScalar(0);
+	}
+	btAlignedObjectArray<btScalar> sums;
+	sums.resizeNoInitialize(iEnd - iBegin);
+	btParallelSumOrderedLoop loop;
+	loop.m_body = &body;
+	loop.m_sums = &sums[0];
+	loop.m_begin = iBegin;
+#if BT_THREADSAFE
+	btParallelFor(iBegin, iEnd, grainSize, loop);
+#else
+	loop.forLoop(iBegin, iEnd);
+#endif
+	// the partial sums are added in the same order whichever thread computed them
+	btScalar sum = btScalar(0);
+	for (int i = 0; i < sums.size(); ++i)
+	{
+		sum += sums[i];
+	}
+	return sum;
+}
+
 ///
 /// btTaskSchedulerSequential -- non-threaded implementation of task scheduler
 ///                              (really just useful for testing performance of single threaded vs multi)
@@ -95,6 +95,102 @@ SIMD_FORCE_INLINE bool btMutexTryLock(btSpinMutex* mutex)
 #endif  // #if BT_THREADSAFE
 }
 
+//
+// btAtomic* -- int operations for lock-free code inside btParallelFor loops. Loads and stores are relaxed,
+//              the end of the parallel loop orders them with respect to later work.
+//              Like btMutex*, plain memory accesses when BT_THREADSAFE is undefined or 0.
+//
+#if BT_THREADSAFE && (__cplusplus >= 201103L || (defined(_MSC_VER) && _MSC_VER >= 1700))
+#include <atomic>
+#define BT_ATOMICS_USE_CPP11 1
+#elif BT_THREADSAFE && defined(__GNUC__)
+#define BT_ATOMICS_USE_GCC_BUILTINS 1
+#elif BT_THREADSAFE
+#error "no atomic operations defined -- unknown platform"
+#endif
+
+SIMD_FORCE_INLINE int btAtomicLoad(const int* value)
+{
+#if BT_ATOMICS_USE_CPP11
+	return reinterpret_cast<const std::atomic<int>*>(value)->load(std::memory_order_relaxed);
+#elif BT_ATOMICS_USE_GCC_BUILTINS
+	return *static_cast<const volatile int*>(value);
+#else
+	return *value;
+#endif
+}
+
+SIMD_FORCE_INLINE void btAtomicStore(int* value, int newValue)
+{
+#if BT_ATOMICS_USE_CPP11
+	reinterpret_cast<std::atomic<int>*>(value)->store(newValue, std::memory_order_relaxed);
+#elif BT_ATOMICS_USE_GCC_BUILTINS
+	*static_cast<volatile int*>(value) = newValue;
+#else
+	*value = newValue;
+#endif
+}
+
+// returns true if value was expected and is now newValue
+SIMD_FORCE_INLINE bool btAtomicCompareExchange(int* value, int expected, int newValue)
+{
+#if BT_ATOMICS_USE_CPP11
+	return reinterpret_cast<std::atomic<int>*>(value)->compare_exchange_strong(expected, newValue, std::memory_order_acq_rel, std::memory_order_relaxed);
+#elif BT_ATOMICS_USE_GCC_BUILTINS
+	return __sync_bool_compare_and_swap(value, expected, newValue);
+#else
+	if (*value != expected)
+	{
+		return false;
+	}
+	*value = newValue;
+	return true;
+#endif
+}
+
+// returns the value before the addition
+SIMD_FORCE_INLINE int btAtomicFetchAdd(int* value, int delta)
+{
+#if BT_ATOMICS_USE_CPP11
+	return reinterpret_cast<std::atomic<int>*>(value)->fetch_add(delta, std::memory_order_relaxed);
+#elif BT_ATOMICS_USE_GCC_BUILTINS
+	return __sync_fetch_and_add(value, delta);
+#else
+	int oldValue = *value;
+	*value += delta;
+	return oldValue;
+#endif
+}
+
+// 64 bit versions for an index and a counter in one word. The load acquires, so a thread that sees the word
+// also sees what was written before the compare-exchange that stored it
+SIMD_FORCE_INLINE long long btAtomicLoad64(const long long* value)
+{
+#if BT_ATOMICS_USE_CPP11
+	return reinterpret_cast<const std::atomic<long long>*>(value)->load(std::memory_order_acquire);
+#elif BT_ATOMICS_USE_GCC_BUILTINS
+	return __sync_fetch_and_add(const_cast<long long*>(value), 0);
+#else
+	return *value;
+#endif
+}
+
+SIMD_FORCE_INLINE bool btAtomicCompareExchange64(long long* value, long long expected, long long newValue)
+{
+#if BT_ATOMICS_USE_CPP11
+	return reinterpret_cast<std::atomic<long long>*>(value)->compare_exchange_strong(expected, newValue, std::memory_order_acq_rel, std::memory_order_relaxed);
+#elif BT_ATOMICS_USE_GCC_BUILTINS
+	return __sync_bool_compare_and_swap(value, expected, newValue);
+#else
+	if (*value != expected)
+	{
+		return false;
+	}
+	*value = newValue;
+	return true;
+#endif
+}
+
 //
 // btIParallelForBody -- subclass this to express work that can be done in parallel
 //
@@ -116,6 +212,8 @@ public:
 	virtual btScalar sumLoop(int iBegin, int iEnd) const = 0;
 };
 
+class btTaskGraph;
+
 //
 // btITaskScheduler -- subclass this to implement a task scheduler that can dispatch work to
 //                     worker threads
@@ -132,6 +230,7 @@ public:
 	virtual void setNumThreads(int numThreads) = 0;
 	virtual void parallelFor(int iBegin, int iEnd, int grainSize, const btIParallelForBody& body) = 0;
 	virtual btScalar parallelSum(int iBegin, int iEnd, int grainSize, const btIParallelSumBody& body) = 0;
+	virtual void runTaskGraph(btTaskGraph& graph);  // default runs the tasks one after another on the calling thread
 	virtual void sleepWorkerThreadsHint() {}  // hint the task scheduler that we may not be using these threads for a little while
 
 	// internal use only
@@ -155,7 +254,8 @@ btITaskScheduler* btGetTaskScheduler();
 btITaskScheduler* btGetSequentialTaskScheduler();
 
 // create a default task scheduler (Win32 or pthreads based)
-btITaskScheduler* btCreateDefaultTaskScheduler();
+// with one thread per hardware thread, or with numThreads threads (at most BT_MAX_THREAD_COUNT) even if that is more than the cores
+btITaskScheduler* btCreateDefaultTaskScheduler(int numThreads = 0);
 
 // get OpenMP task scheduler (if available, otherwise returns null)
 btITaskScheduler* btGetOpenMPTaskScheduler();
@@ -174,4 +274,8 @@ void btParallelFor(int iBegin, int iEnd, int grainSize, const btIParallelForBody
 //                 (iterations may be done out of order, so no dependencies are allowed)
 btScalar btParallelSum(int iBegin, int iEnd, int grainSize, const btIParallelSumBody& body);
 
+// btParallelSumOrdered -- like btParallelSum, but the sum is formed in index order from the result of each single iteration,
+//                        so it does not depend on the number of threads or how the scheduler splits the range
+btScalar btParallelSumOrdered(int iBegin, int iEnd, int grainSize, const btIParallelSumBody& body);
+
 #endif
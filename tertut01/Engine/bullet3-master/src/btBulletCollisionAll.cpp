@@ -1,6 +1,7 @@
 #include "BulletCollision/BroadphaseCollision/btAxisSweep3.cpp"
 #include "BulletCollision/BroadphaseCollision/btDbvt.cpp"
 #include "BulletCollision/BroadphaseCollision/btOverlappingPairCache.cpp"
+#include "BulletCollision/BroadphaseCollision/btOpenAddressingPairCache.cpp"
 #include "BulletCollision/BroadphaseCollision/btBroadphaseProxy.cpp"
 #include "BulletCollision/BroadphaseCollision/btDbvtBroadphase.cpp"
 #include "BulletCollision/BroadphaseCollision/btQuantizedBvh.cpp"
@@ -39,6 +40,7 @@
 #include "BulletCollision/NarrowPhaseCollision/btPolyhedralContactClipping.cpp"
 #include "BulletCollision/NarrowPhaseCollision/btConvexCast.cpp"
 #include "BulletCollision/NarrowPhaseCollision/btGjkPairDetector.cpp"
+#include "BulletCollision/NarrowPhaseCollision/btGjkPairBatch.cpp"
 #include "BulletCollision/NarrowPhaseCollision/btRaycastCallback.cpp"
 #include "BulletCollision/NarrowPhaseCollision/btGjkConvexCast.cpp"
 #include "BulletCollision/NarrowPhaseCollision/btMinkowskiPenetrationDepthSolver.cpp"
@@ -83,6 +85,7 @@
 #include "BulletCollision/CollisionShapes/btScaledBvhTriangleMeshShape.cpp"
 #include "BulletCollision/CollisionShapes/btSdfCollisionShape.cpp"
 #include "BulletCollision/CollisionShapes/btMiniSDF.cpp"
+#include "BulletCollision/CollisionShapes/btSdfBaker.cpp"
 #include "BulletCollision/CollisionShapes/btUniformScalingShape.cpp"
 #include "BulletCollision/Gimpact/btContactProcessing.cpp"
 #include "BulletCollision/Gimpact/btGImpactQuantizedBvh.cpp"
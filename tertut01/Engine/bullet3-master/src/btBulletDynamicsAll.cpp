@@ -3,6 +3,7 @@
 #include "BulletDynamics/Dynamics/btSimulationIslandManagerMt.cpp"
 #include "BulletDynamics/Dynamics/btDiscreteDynamicsWorldMt.cpp"
 #include "BulletDynamics/Dynamics/btSimpleDynamicsWorld.cpp"
+#include "BulletDynamics/Dynamics/btWorldSnapshot.cpp"
 #include "BulletDynamics/ConstraintSolver/btBatchedConstraints.cpp"
 #include "BulletDynamics/ConstraintSolver/btConeTwistConstraint.cpp"
 #include "BulletDynamics/ConstraintSolver/btGeneric6DofSpringConstraint.cpp"
@@ -21,10 +22,12 @@
 #include "BulletDynamics/ConstraintSolver/btGeneric6DofSpring2Constraint.cpp"
 #include "BulletDynamics/ConstraintSolver/btSequentialImpulseConstraintSolver.cpp"
 #include "BulletDynamics/ConstraintSolver/btSequentialImpulseConstraintSolverMt.cpp"
+#include "BulletDynamics/ConstraintSolver/btWideConstraintBlocks.cpp"
 #include "BulletDynamics/MLCPSolvers/btDantzigLCP.cpp"
 #include "BulletDynamics/MLCPSolvers/btLemkeAlgorithm.cpp"
 #include "BulletDynamics/MLCPSolvers/btMLCPSolver.cpp"
 #include "BulletDynamics/Featherstone/btMultiBody.cpp"
+#include "BulletDynamics/Featherstone/btMultiBodyBatch.cpp"
 #include "BulletDynamics/Featherstone/btMultiBodyDynamicsWorld.cpp"
 #include "BulletDynamics/Featherstone/btMultiBodyJointMotor.cpp"
 #include "BulletDynamics/Featherstone/btMultiBodyGearConstraint.cpp"
@@ -7,7 +7,11 @@
 #include "LinearMath/btSerializer64.cpp"
 #include "LinearMath/btConvexHullComputer.cpp"
 #include "LinearMath/btQuickprof.cpp"
+#include "LinearMath/btProfileRecorder.cpp"
 #include "LinearMath/btThreads.cpp"
+#include "LinearMath/btTaskGraph.cpp"
+#include "LinearMath/btMappedFile.cpp"
+#include "LinearMath/btStepArena.cpp"
 #include "LinearMath/btReducedVector.cpp"
 #include "LinearMath/TaskScheduler/btTaskScheduler.cpp"
 #include "LinearMath/TaskScheduler/btThreadSupportPosix.cpp"
@@ -464,6 +464,76 @@ c   [0]	float32_t	0.829904
 		}
 	}
 
+	////////////////////////////////////
+	//
+	// Time and Test tree build and queries
+	//
+	////////////////////////////////////
+	{
+		btDbvtVolume volumes[DATA_SIZE];
+		void* data[DATA_SIZE];
+		for (i = 0; i < DATA_SIZE; i++)
+		{
+			btVector3 mi = a[i].tMins(), mx = a[i].tMins();
+			mi.setMin(a[i].tMaxs());
+			mx.setMax(a[i].tMaxs());
+			volumes[i] = btDbvtVolume::FromMM(mi * 100, mi * 100 + (mx - mi) * 2);
+			data[i] = (void*)(size_t)i;
+		}
+
+		uint64_t insertTime, bulkTime, startTime;
+		btDbvt incremental, bulk;
+		startTime = ReadTicks();
+		for (i = 0; i < DATA_SIZE; i++)
+		{
+			incremental.insert(volumes[i], data[i]);
+		}
+		insertTime = ReadTicks() - startTime;
+		startTime = ReadTicks();
+		bulk.insertBulk(volumes, data, DATA_SIZE);
+		bulkTime = ReadTicks() - startTime;
+
+		vlog("Tree build Timing:\n");
+		vlog("     \t    insert\tinsertBulk\n");
+		vlog("    \t%10.4f\t%10.4f\n", TicksToCycles(insertTime) / DATA_SIZE, TicksToCycles(bulkTime) / DATA_SIZE);
+
+		struct Counter : btDbvt::ICollide
+		{
+			int count;
+			int sum;
+			Counter() : count(0), sum(0) {}
+			void Process(const btDbvtNode* n)
+			{
+				count++;
+				sum += n->dataAsInt;
+			}
+		};
+		Counter incrementalHits, bulkHits;
+		uint64_t incrementalQueryTime, bulkQueryTime;
+		startTime = ReadTicks();
+		for (i = 0; i < DATA_SIZE; i++)
+		{
+			incremental.collideTV(incremental.m_root, volumes[i], incrementalHits);
+		}
+		incrementalQueryTime = ReadTicks() - startTime;
+		startTime = ReadTicks();
+		for (i = 0; i < DATA_SIZE; i++)
+		{
+			bulk.collideTV(bulk.m_root, volumes[i], bulkHits);
+		}
+		bulkQueryTime = ReadTicks() - startTime;
+
+		vlog("Tree query Timing:\n");
+		vlog("     \t    insert\tinsertBulk\n");
+		vlog("    \t%10.4f\t%10.4f\n", TicksToCycles(incrementalQueryTime) / DATA_SIZE, TicksToCycles(bulkQueryTime) / DATA_SIZE);
+
+		if (incrementalHits.count != bulkHits.count || incrementalHits.sum != bulkHits.sum)
+		{
+			printf("Tree query fail with insert = %d, insertBulk = %d hits\n", incrementalHits.count, bulkHits.count);
+			return 1;
+		}
+	}
+
 	return 0;
 }
 #endif
@@ -0,0 +1,296 @@
+#include <btBulletDynamicsCommon.h>
+#include <LinearMath/btMappedFile.h>
+#include <LinearMath/btQuickprof.h>
+#include <LinearMath/btSerializer.h>
+#include "../../Extras/Serialize/BulletWorldImporter/btBulletWorldImporter.h"
+#include <gtest/gtest.h>
+#include <stdio.h>
+#include <string.h>
+#if defined(__linux__)
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+// exposes the mapped files, to check which data is used in place
+class btMappedTestImporter : public btBulletWorldImporter
+{
+public:
+	const btMappedFile* getMappedFile(int i) const
+	{
+		return m_mappedFiles[i];
+	}
+};
+
+struct btTerrainScene
+{
+	btTriangleIndexVertexArray* m_mesh;
+	btBvhTriangleMeshShape* m_terrainShape;
+	btSphereShape* m_sphereShape;
+	btDefaultCollisionConfiguration* m_collisionConfiguration;
+	btCollisionDispatcher* m_dispatcher;
+	btDbvtBroadphase* m_broadphase;
+	btSequentialImpulseConstraintSolver* m_solver;
+	btDiscreteDynamicsWorld* m_world;
+	btAlignedObjectArray<btVector3> m_vertices;
+	btAlignedObjectArray<int> m_indices;
+
+	// a bumpy grid of n by n vertices, with a sphere resting on it
+	btTerrainScene(int n)
+	{
+		for (int y = 0; y < n; y++)
+		{
+			for (int x = 0; x < n; x++)
+			{
+				m_vertices.push_back(btVector3(btScalar(x), btSin(btScalar(x) * btScalar(0.3)) * btCos(btScalar(y) * btScalar(0.2)), btScalar(y)));
+			}
+		}
+		for (int y = 0; y < n - 1; y++)
+		{
+			for (int x = 0; x < n - 1; x++)
+			{
+				const int i = y * n + x;
+				m_indices.push_back(i);
+				m_indices.push_back(i + n);
+				m_indices.push_back(i + 1);
+				m_indices.push_back(i + 1);
+				m_indices.push_back(i + n);
+				m_indices.push_back(i + n + 1);
+			}
+		}
+		m_mesh = new btTriangleIndexVertexArray(m_indices.size() / 3, &m_indices[0], 3 * sizeof(int), m_vertices.size(), m_vertices[0].m_floats, sizeof(btVector3));
+		m_terrainShape = new btBvhTriangleMeshShape(m_mesh, true);
+		m_sphereShape = new btSphereShape(btScalar(0.5));
+
+		m_collisionConfiguration = new btDefaultCollisionConfiguration();
+		m_dispatcher = new btCollisionDispatcher(m_collisionConfiguration);
+		m_broadphase = new btDbvtBroadphase();
+		m_solver = new btSequentialImpulseConstraintSolver();
+		m_world = new btDiscreteDynamicsWorld(m_dispatcher, m_broadphase, m_solver, m_collisionConfiguration);
+
+		m_world->addRigidBody(new btRigidBody(0, 0, m_terrainShape));
+		btTransform start;
+		start.setIdentity();
+		start.setOrigin(btVector3(btScalar(n / 2), 2, btScalar(n / 2)));
+		btVector3 inertia;
+		m_sphereShape->calculateLocalInertia(1, inertia);
+		m_world->addRigidBody(new btRigidBody(1, new btDefaultMotionState(start), m_sphereShape, inertia));
+	}
+
+	~btTerrainScene()
+	{
+		for (int i = m_world->getNumCollisionObjects() - 1; i >= 0; i--)
+		{
+			btRigidBody* body = btRigidBody::upcast(m_world->getCollisionObjectArray()[i]);
+			m_world->removeRigidBody(body);
+			delete body->getMotionState();
+			delete body;
+		}
+		delete m_world;
+		delete m_solver;
+		delete m_broadphase;
+		delete m_dispatcher;
+		delete m_collisionConfiguration;
+		delete m_sphereShape;
+		delete m_terrainShape;
+		delete m_mesh;
+	}
+
+	void save(const char* fileName)
+	{
+		btDefaultSerializer serializer;
+		m_world->serialize(&serializer);
+		FILE* file = fopen(fileName, "wb");
+		ASSERT_TRUE(file != NULL);
+		fwrite(serializer.getBufferPointer(), serializer.getCurrentBufferSize(), 1, file);
+		fclose(file);
+	}
+};
+
+static btBvhTriangleMeshShape* findTerrainShape(btWorldImporter& importer)
+{
+	for (int i = 0; i < importer.getNumCollisionShapes(); i++)
+	{
+		btCollisionShape* shape = importer.getCollisionShapeByIndex(i);
+		if (shape->getShapeType() == TRIANGLE_MESH_SHAPE_PROXYTYPE)
+		{
+			return (btBvhTriangleMeshShape*)shape;
+		}
+	}
+	return NULL;
+}
+
+static btScalar rayFraction(btBvhTriangleMeshShape* shape, const btVector3& from, const btVector3& to)
+{
+	btCollisionObject object;
+	object.setCollisionShape(shape);
+	btCollisionWorld::ClosestRayResultCallback callback(from, to);
+	btTransform fromTransform, toTransform;
+	fromTransform.setIdentity();
+	fromTransform.setOrigin(from);
+	toTransform.setIdentity();
+	toTransform.setOrigin(to);
+	btCollisionWorld::rayTestSingle(fromTransform, toTransform, &object, shape, object.getWorldTransform(), callback);
+	return callback.hasHit() ? callback.m_closestHitFraction : btScalar(1);
+}
+
+static bool isInside(const btMappedFile* file, const void* ptr)
+{
+	const char* data = (const char*)file->getData();
+	return (const char*)ptr >= data && (const char*)ptr < data + file->getSize();
+}
+
+static bool loadScene(btMappedTestImporter& importer, const char* fileName, bool useMapping)
+{
+	return useMapping ? importer.loadFileMapped(fileName) : importer.loadFile(fileName);
+}
+
+// how much the peak resident memory grows while loading, measured in a child process so both loaders start from the same peak
+static double peakMegabytesOfLoad(const char* fileName, bool useMapping)
+{
+#if defined(__linux__)
+	FILE* file = fopen("/proc/self/statm", "r");
+	unsigned long size = 0, resident = 0;
+	if (!file || fscanf(file, "%lu %lu", &size, &resident) != 2)
+	{
+		resident = 0;
+	}
+	if (file)
+	{
+		fclose(file);
+	}
+	const pid_t pid = fork();
+	if (pid == 0)
+	{
+		btMappedTestImporter importer;
+		_exit(loadScene(importer, fileName, useMapping) ? 0 : 1);
+	}
+	int status = 0;
+	struct rusage usage;
+	if (pid < 0 || wait4(pid, &status, 0, &usage) != pid || status != 0)
+	{
+		return -1;
+	}
+	return (double(usage.ru_maxrss) * 1024. - double(resident) * double(sysconf(_SC_PAGESIZE))) / (1024. * 1024.);
+#else
+	return -1;
+#endif
+}
+
+TEST(btBulletFileMapped, SameShapesAsCopyingLoader)
+{
+	const char* fileName = "test_btBulletFileMapped.bullet";
+	{
+		btTerrainScene scene(64);
+		scene.save(fileName);
+	}
+
+	btBulletWorldImporter copying;
+	ASSERT_TRUE(copying.loadFile(fileName));
+	btMappedTestImporter mapped;
+	ASSERT_TRUE(mapped.loadFileMapped(fileName));
+
+	EXPECT_EQ(copying.getNumCollisionShapes(), mapped.getNumCollisionShapes());
+	EXPECT_EQ(copying.getNumRigidBodies(), mapped.getNumRigidBodies());
+	btBvhTriangleMeshShape* copiedShape = findTerrainShape(copying);
+	btBvhTriangleMeshShape* mappedShape = findTerrainShape(mapped);
+	ASSERT_TRUE(copiedShape != NULL);
+	ASSERT_TRUE(mappedShape != NULL);
+
+	// the vertices, indices and quantized nodes are used in place
+	const unsigned char* vertexBase;
+	const unsigned char* indexBase;
+	int numVertices, vertexStride, indexStride, numFaces;
+	PHY_ScalarType vertexType, indexType;
+	mappedShape->getMeshInterface()->getLockedReadOnlyVertexIndexBase(&vertexBase, numVertices, vertexType, vertexStride, &indexBase, indexStride, numFaces, indexType);
+	EXPECT_TRUE(isInside(mapped.getMappedFile(0), vertexBase));
+	EXPECT_TRUE(isInside(mapped.getMappedFile(0), indexBase));
+	EXPECT_EQ(numFaces, 2 * 63 * 63);
+	mappedShape->getMeshInterface()->unLockReadOnlyVertexBase(0);
+
+	const QuantizedNodeArray& copiedNodes = copiedShape->getOptimizedBvh()->getQuantizedNodeArray();
+	const QuantizedNodeArray& mappedNodes = mappedShape->getOptimizedBvh()->getQuantizedNodeArray();
+	ASSERT_EQ(copiedNodes.size(), mappedNodes.size());
+	EXPECT_TRUE(isInside(mapped.getMappedFile(0), &mappedNodes[0]));
+	EXPECT_EQ(0, memcmp(&copiedNodes[0], &mappedNodes[0], copiedNodes.size() * sizeof(btQuantizedBvhNode)));
+
+	srand(1);
+	for (int i = 0; i < 200; i++)
+	{
+		const btVector3 from(btScalar(rand() % 6000 + 150) / 100, 5, btScalar(rand() % 6000 + 150) / 100);
+		const btVector3 to = from + btVector3(btScalar(rand() % 200 - 100) / 100, -10, btScalar(rand() % 200 - 100) / 100);
+		const btScalar fraction = rayFraction(copiedShape, from, to);
+		EXPECT_LT(fraction, 1);
+		EXPECT_EQ(fraction, rayFraction(mappedShape, from, to));
+	}
+
+	copying.deleteAllData();
+	mapped.deleteAllData();
+	remove(fileName);
+}
+
+TEST(btBulletFileMapped, RefitDoesNotChangeTheFile)
+{
+	const char* fileName = "test_btBulletFileMapped_refit.bullet";
+	{
+		btTerrainScene scene(16);
+		scene.save(fileName);
+	}
+	btMappedFile before;
+	ASSERT_TRUE(before.open(fileName));
+	btAlignedObjectArray<char> original;
+	original.resize(int(before.getSize()));
+	memcpy(&original[0], before.getData(), before.getSize());
+	before.close();
+
+	btMappedTestImporter mapped;
+	ASSERT_TRUE(mapped.loadFileMapped(fileName));
+	btBvhTriangleMeshShape* shape = findTerrainShape(mapped);
+	ASSERT_TRUE(shape != NULL);
+	btVector3 aabbMin, aabbMax;
+	shape->getAabb(btTransform::getIdentity(), aabbMin, aabbMax);
+	// the written pages become private copies of the mapping
+	shape->refitTree(aabbMin - btVector3(1, 1, 1), aabbMax + btVector3(1, 1, 1));
+	mapped.deleteAllData();
+
+	btMappedFile after;
+	ASSERT_TRUE(after.open(fileName));
+	ASSERT_EQ(size_t(original.size()), after.getSize());
+	EXPECT_EQ(0, memcmp(&original[0], after.getData(), after.getSize()));
+	after.close();
+	remove(fileName);
+}
+
+TEST(btBulletFileMapped, Benchmark)
+{
+	const char* fileName = "test_btBulletFileMapped_benchmark.bullet";
+	{
+		btTerrainScene scene(512);
+		scene.save(fileName);
+	}
+	FILE* file = fopen(fileName, "rb");
+	ASSERT_TRUE(file != NULL);
+	fseek(file, 0, SEEK_END);
+	const long fileSize = ftell(file);
+	fclose(file);
+
+	const char* names[2] = {"loadFile", "loadFileMapped"};
+	for (int mode = 0; mode < 2; mode++)
+	{
+		btMappedTestImporter importer;
+		btClock clock;
+		ASSERT_TRUE(loadScene(importer, fileName, mode == 1));
+		const unsigned long long time = clock.getTimeMicroseconds();
+		ASSERT_TRUE(findTerrainShape(importer) != NULL);
+		importer.deleteAllData();
+		printf("%.1f MB file with %d triangles, %s: %.2f ms, peak resident memory +%.1f MB\n", fileSize / (1024. * 1024.),
+			   2 * 511 * 511, names[mode], time / 1000., peakMegabytesOfLoad(fileName, mode == 1));
+	}
+	remove(fileName);
+}
+
+int main(int argc, char** argv)
+{
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
@@ -0,0 +1,233 @@
+#include <LinearMath/btConvexHullComputer.h>
+#include <LinearMath/btQuickprof.h>
+#include <LinearMath/btThreads.h>
+#include <gtest/gtest.h>
+#include "btTestTaskScheduler.h"
+#include <stdio.h>
+
+static btScalar randomScalar(btScalar lo, btScalar hi)
+{
+	return lo + (hi - lo) * btScalar(rand()) / btScalar(RAND_MAX);
+}
+
+static btVector3 randomVector(btScalar lo, btScalar hi)
+{
+	return btVector3(randomScalar(lo, hi), randomScalar(lo, hi), randomScalar(lo, hi));
+}
+
+enum Cloud
+{
+	BALL,
+	CUBE,
+	SPHERE,      // all points on the hull
+	ELLIPSOID,   // anisotropic and far from the origin
+	LATTICE,     // many duplicate and coplanar points
+	FLAT,        // all points in a plane
+	NUM_CLOUDS
+};
+
+static void createCloud(Cloud cloud, int count, unsigned int seed, btAlignedObjectArray<btVector3>& points)
+{
+	srand(seed);
+	points.resize(count);
+	for (int i = 0; i < count; ++i)
+	{
+		btVector3 p;
+		switch (cloud)
+		{
+			case BALL:
+			case ELLIPSOID:
+				do
+				{
+					p = randomVector(-1, 1);
+				} while (p.length2() > 1);
+				if (cloud == ELLIPSOID)
+				{
+					p = p * btVector3(1000, 1, 10) + btVector3(5000, -300, 20);
+				}
+				break;
+			case CUBE:
+				p = randomVector(-1, 1);
+				break;
+			case SPHERE:
+				do
+				{
+					p = randomVector(-1, 1);
+				} while (p.length2() < btScalar(0.01) || p.length2() > 1);
+				p.normalize();
+				break;
+			case LATTICE:
+				p = btVector3(btScalar(rand() % 20), btScalar(rand() % 20), btScalar(rand() % 20));
+				break;
+			default:
+				p = randomVector(-1, 1);
+				p.setZ(p.getX() * btScalar(0.5) - p.getY());
+				break;
+		}
+		points[i] = p;
+	}
+}
+
+static void sortedVertices(const btConvexHullComputer& hull, btAlignedObjectArray<btVector3>& vertices)
+{
+	struct Less
+	{
+		bool operator()(const btVector3& a, const btVector3& b) const
+		{
+			if (a.getX() != b.getX())
+			{
+				return a.getX() < b.getX();
+			}
+			if (a.getY() != b.getY())
+			{
+				return a.getY() < b.getY();
+			}
+			return a.getZ() < b.getZ();
+		}
+	};
+	vertices.copyFromArray(hull.vertices);
+	vertices.quickSort(Less());
+}
+
+// the quickhull gives the same hull as compute, but possibly with the vertices in another order
+static void expectSameHull(const btConvexHullComputer& expected, const btConvexHullComputer& actual, const btAlignedObjectArray<btVector3>& points, const char* what)
+{
+	ASSERT_EQ(expected.vertices.size(), actual.vertices.size()) << what;
+	EXPECT_EQ(expected.edges.size(), actual.edges.size()) << what;
+	EXPECT_EQ(expected.faces.size(), actual.faces.size()) << what;
+	ASSERT_EQ(actual.vertices.size(), actual.original_vertex_index.size()) << what;
+
+	btAlignedObjectArray<btVector3> expectedVertices, actualVertices;
+	sortedVertices(expected, expectedVertices);
+	sortedVertices(actual, actualVertices);
+	for (int i = 0; i < expectedVertices.size(); ++i)
+	{
+		EXPECT_EQ(expectedVertices[i], actualVertices[i]) << what << " vertex " << i;
+	}
+
+	btVector3 min = points[0];
+	btVector3 max = points[0];
+	for (int i = 1; i < points.size(); ++i)
+	{
+		min.setMin(points[i]);
+		max.setMax(points[i]);
+	}
+	const btScalar tolerance = (max - min).length() * btScalar(1e-3);
+	for (int i = 0; i < actual.vertices.size(); ++i)
+	{
+		const int index = actual.original_vertex_index[i];
+		ASSERT_TRUE(index >= 0 && index < points.size()) << what;
+		EXPECT_LT((points[index] - actual.vertices[i]).length(), tolerance) << what << " vertex " << i;
+	}
+}
+
+TEST(btConvexHullQuickhull, SameHullAsCompute)
+{
+	static const char* names[NUM_CLOUDS] = {"ball", "cube", "sphere", "ellipsoid", "lattice", "flat"};
+	const int counts[] = {100, 5000, 200000};
+	for (int c = 0; c < NUM_CLOUDS; ++c)
+	{
+		for (int n = 0; n < int(sizeof(counts) / sizeof(counts[0])); ++n)
+		{
+			btAlignedObjectArray<btVector3> points;
+			createCloud(Cloud(c), counts[n], 17 + c, points);
+			btConvexHullComputer expected, actual;
+			expected.compute(&points[0].getX(), sizeof(btVector3), points.size(), 0, 0);
+			actual.computeQuickhull(&points[0].getX(), sizeof(btVector3), points.size(), 0, 0);
+			char what[64];
+			sprintf(what, "%s of %d points", names[c], counts[n]);
+			expectSameHull(expected, actual, points, what);
+		}
+	}
+}
+
+TEST(btConvexHullQuickhull, DoubleCoordsAndStride)
+{
+	btAlignedObjectArray<btVector3> points;
+	createCloud(ELLIPSOID, 100000, 5, points);
+	// x, y, z and a fourth value that is not a coordinate
+	btAlignedObjectArray<double> coords;
+	coords.resize(4 * points.size());
+	for (int i = 0; i < points.size(); ++i)
+	{
+		coords[4 * i] = points[i].getX();
+		coords[4 * i + 1] = points[i].getY();
+		coords[4 * i + 2] = points[i].getZ();
+		coords[4 * i + 3] = 1e30;
+	}
+	btConvexHullComputer expected, actual;
+	expected.compute(&coords[0], 4 * sizeof(double), points.size(), 0, 0);
+	actual.computeQuickhull(&coords[0], 4 * sizeof(double), points.size(), 0, 0);
+	expectSameHull(expected, actual, points, "double coords");
+}
+
+TEST(btConvexHullQuickhull, Shrink)
+{
+	btAlignedObjectArray<btVector3> points;
+	createCloud(BALL, 50000, 9, points);
+	btConvexHullComputer expected, actual;
+	const btScalar expectedShift = expected.compute(&points[0].getX(), sizeof(btVector3), points.size(), btScalar(0.05), btScalar(0.5));
+	const btScalar actualShift = actual.computeQuickhull(&points[0].getX(), sizeof(btVector3), points.size(), btScalar(0.05), btScalar(0.5));
+	EXPECT_NEAR(expectedShift, actualShift, btScalar(1e-4));
+	EXPECT_EQ(expected.vertices.size(), actual.vertices.size());
+	EXPECT_EQ(expected.faces.size(), actual.faces.size());
+}
+
+TEST(btConvexHullQuickhull, SameResultForAnyThreadCount)
+{
+	btThreadCountSweep sweep;
+	btAlignedObjectArray<btVector3> points;
+	createCloud(BALL, 300000, 3, points);
+	btConvexHullComputer reference;
+	ASSERT_TRUE(sweep.run(1));
+	reference.computeQuickhull(&points[0].getX(), sizeof(btVector3), points.size(), 0, 0);
+	const int threadCounts[] = {2, 4, 8};
+	for (int t = 0; t < int(sizeof(threadCounts) / sizeof(threadCounts[0])); ++t)
+	{
+		if (!sweep.run(threadCounts[t]))
+		{
+			continue;
+		}
+		btConvexHullComputer hull;
+		hull.computeQuickhull(&points[0].getX(), sizeof(btVector3), points.size(), 0, 0);
+		ASSERT_EQ(reference.vertices.size(), hull.vertices.size());
+		ASSERT_EQ(reference.edges.size(), hull.edges.size());
+		for (int i = 0; i < hull.vertices.size(); ++i)
+		{
+			EXPECT_EQ(reference.vertices[i], hull.vertices[i]);
+			EXPECT_EQ(reference.original_vertex_index[i], hull.original_vertex_index[i]);
+		}
+		for (int i = 0; i < hull.edges.size(); ++i)
+		{
+			EXPECT_EQ(reference.edges[i].getTargetVertex(), hull.edges[i].getTargetVertex());
+		}
+	}
+}
+
+TEST(btConvexHullQuickhull, Benchmark)
+{
+	setUpTaskScheduler();
+	btClock clock;
+	for (int count = 1000; count <= 1000000; count *= 10)
+	{
+		btAlignedObjectArray<btVector3> points;
+		createCloud(BALL, count, 1, points);
+		btConvexHullComputer expected, actual;
+		clock.reset();
+		expected.compute(&points[0].getX(), sizeof(btVector3), points.size(), 0, 0);
+		const unsigned long long computeTime = clock.getTimeMicroseconds();
+		clock.reset();
+		actual.computeQuickhull(&points[0].getX(), sizeof(btVector3), points.size(), 0, 0);
+		const unsigned long long quickhullTime = clock.getTimeMicroseconds();
+		printf("%d points in a ball: %d vertices, compute %.2f ms, computeQuickhull %.2f ms (%.2fx)\n",
+			   count, actual.vertices.size(), computeTime / 1000., quickhullTime / 1000.,
+			   double(computeTime) / double(quickhullTime ? quickhullTime : 1));
+		EXPECT_EQ(expected.vertices.size(), actual.vertices.size());
+	}
+}
+
+int main(int argc, char** argv)
+{
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
@@ -0,0 +1,288 @@
+#include <btBulletDynamicsCommon.h>
+#include <BulletDynamics/Dynamics/btDiscreteDynamicsWorldMt.h>
+#include <BulletDynamics/ConstraintSolver/btSequentialImpulseConstraintSolverMt.h>
+#include <BulletCollision/CollisionDispatch/btCollisionDispatcherMt.h>
+#include <LinearMath/btQuickprof.h>
+#include <gtest/gtest.h>
+#include "btTestTaskScheduler.h"
+#include <string.h>
+
+// Terms of very different magnitude, so that adding them in another order changes the rounding
+struct MixedMagnitudeSum : public btIParallelSumBody
+{
+	btAlignedObjectArray<btScalar> m_values;
+
+	btScalar sumLoop(int iBegin, int iEnd) const BT_OVERRIDE
+	{
+		btScalar sum = 0;
+		for (int i = iBegin; i < iEnd; ++i)
+		{
+			sum += m_values[i];
+		}
+		return sum;
+	}
+};
+
+TEST(BulletDynamicsTest, ParallelSumOrderedMatchesSerialSum)
+{
+	setUpTaskScheduler();
+	MixedMagnitudeSum body;
+	srand(7);
+	for (int i = 0; i < 5000; ++i)
+	{
+		const btScalar value = btScalar(rand()) / btScalar(RAND_MAX) - btScalar(0.5);
+		body.m_values.push_back((i % 7) == 0 ? value * btScalar(1e6) : value * btScalar(1e-3));
+	}
+	btScalar expected = 0;
+	for (int i = 0; i < body.m_values.size(); ++i)
+	{
+		expected += body.m_values[i];
+	}
+	const int grainSizes[] = {1, 7, 100, 5000};
+	for (int i = 0; i < 4; ++i)
+	{
+		EXPECT_EQ(expected, btParallelSumOrdered(0, body.m_values.size(), grainSizes[i], body)) << "grain size " << grainSizes[i];
+	}
+	EXPECT_EQ(btScalar(0), btParallelSumOrdered(10, 10, 1, body));
+}
+
+#if BT_THREADSAFE
+
+static unsigned long long hashScalars(unsigned long long hash, const btScalar* values, int count)
+{
+	const unsigned char* bytes = (const unsigned char*)values;
+	for (size_t i = 0; i < count * sizeof(btScalar); ++i)
+	{
+		hash = (hash ^ bytes[i]) * 1099511628211ULL;
+	}
+	return hash;
+}
+
+static unsigned long long hashVector(unsigned long long hash, const btVector3& v)
+{
+	return hashScalars(hash, v.m_floats, 3);
+}
+
+static unsigned long long hashWorldState(const btDiscreteDynamicsWorld& world)
+{
+	unsigned long long hash = 14695981039346656037ULL;
+	const btCollisionObjectArray& objects = world.getCollisionObjectArray();
+	for (int i = 0; i < objects.size(); ++i)
+	{
+		const btRigidBody* body = btRigidBody::upcast(objects[i]);
+		const btTransform& transform = objects[i]->getWorldTransform();
+		hash = hashVector(hash, transform.getOrigin());
+		for (int row = 0; row < 3; ++row)
+		{
+			hash = hashVector(hash, transform.getBasis()[row]);
+		}
+		if (body)
+		{
+			hash = hashVector(hash, body->getLinearVelocity());
+			hash = hashVector(hash, body->getAngularVelocity());
+		}
+	}
+	return hash;
+}
+
+// A pile big enough for the batched multithreaded solver, a hinge chain, a compound body with several
+// manifolds per pair, fast bodies with predictive contacts and a kinematic pusher
+static void simulateScene(bool deterministic, int numSteps, btAlignedObjectArray<unsigned long long>& hashes, unsigned long long& stepTime)
+{
+	btDefaultCollisionConfiguration collisionConfiguration;
+	btCollisionDispatcherMt dispatcher(&collisionConfiguration);
+	btDbvtBroadphase broadphase;
+	btConstraintSolverPoolMt solverPool(BT_MAX_THREAD_COUNT);
+	btSequentialImpulseConstraintSolverMt solverMt;
+	btDiscreteDynamicsWorldMt world(&dispatcher, &broadphase, &solverPool, &solverMt, &collisionConfiguration);
+	world.setDeterministic(deterministic);
+	EXPECT_EQ(deterministic, world.isDeterministic());
+	// the residual only matters for the result when the solver may stop early
+	world.getSolverInfo().m_leastSquaresResidualThreshold = btScalar(1e-4);
+
+	btAlignedObjectArray<btCollisionShape*> shapes;
+	btAlignedObjectArray<btRigidBody*> bodies;
+	btStaticPlaneShape* groundShape = new btStaticPlaneShape(btVector3(0, 1, 0), 0);
+	shapes.push_back(groundShape);
+	btRigidBody* ground = new btRigidBody(btRigidBody::btRigidBodyConstructionInfo(0, NULL, groundShape));
+	world.addRigidBody(ground);
+	bodies.push_back(ground);
+
+	btBoxShape* boxShape = new btBoxShape(btVector3(btScalar(0.5), btScalar(0.5), btScalar(0.5)));
+	btSphereShape* sphereShape = new btSphereShape(btScalar(0.25));
+	btCompoundShape* compoundShape = new btCompoundShape();
+	compoundShape->addChildShape(btTransform(btQuaternion::getIdentity(), btVector3(-1, 0, 0)), boxShape);
+	compoundShape->addChildShape(btTransform(btQuaternion::getIdentity(), btVector3(0, 0, 0)), boxShape);
+	compoundShape->addChildShape(btTransform(btQuaternion::getIdentity(), btVector3(1, 0, 0)), boxShape);
+	shapes.push_back(boxShape);
+	shapes.push_back(sphereShape);
+	shapes.push_back(compoundShape);
+
+	btVector3 inertia;
+	boxShape->calculateLocalInertia(1, inertia);
+	for (int x = 0; x < 10; ++x)
+	{
+		for (int y = 0; y < 6; ++y)
+		{
+			for (int z = 0; z < 10; ++z)
+			{
+				btRigidBody::btRigidBodyConstructionInfo info(1, NULL, boxShape, inertia);
+				info.m_startWorldTransform.setIdentity();
+				info.m_startWorldTransform.setOrigin(btVector3(btScalar(x) * btScalar(1.02), btScalar(0.5) + btScalar(y) * btScalar(1.05), btScalar(z) * btScalar(1.02) + btScalar(0.05) * y));
+				btRigidBody* box = new btRigidBody(info);
+				world.addRigidBody(box);
+				bodies.push_back(box);
+			}
+		}
+	}
+
+	btRigidBody* previous = NULL;
+	for (int i = 0; i < 8; ++i)
+	{
+		btRigidBody::btRigidBodyConstructionInfo info(i == 0 ? 0 : 1, NULL, boxShape, i == 0 ? btVector3(0, 0, 0) : inertia);
+		info.m_startWorldTransform.setIdentity();
+		info.m_startWorldTransform.setOrigin(btVector3(btScalar(-6) + btScalar(1.1) * i, btScalar(12), btScalar(4)));
+		btRigidBody* link = new btRigidBody(info);
+		world.addRigidBody(link);
+		bodies.push_back(link);
+		if (previous)
+		{
+			btHingeConstraint* hinge = new btHingeConstraint(*previous, *link, btVector3(btScalar(0.55), 0, 0), btVector3(btScalar(-0.55), 0, 0), btVector3(0, 0, 1), btVector3(0, 0, 1));
+			world.addConstraint(hinge, true);
+		}
+		previous = link;
+	}
+
+	{
+		btVector3 compoundInertia;
+		compoundShape->calculateLocalInertia(3, compoundInertia);
+		btRigidBody::btRigidBodyConstructionInfo info(3, NULL, compoundShape, compoundInertia);
+		info.m_startWorldTransform.setIdentity();
+		info.m_startWorldTransform.setOrigin(btVector3(4, 9, 4));
+		btRigidBody* compound = new btRigidBody(info);
+		world.addRigidBody(compound);
+		bodies.push_back(compound);
+	}
+
+	btVector3 sphereInertia;
+	sphereShape->calculateLocalInertia(1, sphereInertia);
+	for (int i = 0; i < 12; ++i)
+	{
+		btRigidBody::btRigidBodyConstructionInfo info(1, NULL, sphereShape, sphereInertia);
+		info.m_startWorldTransform.setIdentity();
+		info.m_startWorldTransform.setOrigin(btVector3(btScalar(i) * btScalar(0.8), btScalar(20), btScalar(-3)));
+		btRigidBody* sphere = new btRigidBody(info);
+		sphere->setLinearVelocity(btVector3(btScalar(0.5) * i, -60, btScalar(40)));
+		sphere->setCcdMotionThreshold(btScalar(0.1));
+		sphere->setCcdSweptSphereRadius(btScalar(0.2));
+		world.addRigidBody(sphere);
+		bodies.push_back(sphere);
+	}
+
+	btRigidBody* pusher;
+	{
+		btRigidBody::btRigidBodyConstructionInfo info(0, NULL, boxShape);
+		info.m_startWorldTransform.setIdentity();
+		info.m_startWorldTransform.setOrigin(btVector3(-2, btScalar(0.5), 2));
+		pusher = new btRigidBody(info);
+		pusher->setCollisionFlags(pusher->getCollisionFlags() | btCollisionObject::CF_KINEMATIC_OBJECT);
+		pusher->setActivationState(DISABLE_DEACTIVATION);
+		world.addRigidBody(pusher);
+		bodies.push_back(pusher);
+	}
+
+	hashes.resize(0);
+	btClock clock;
+	stepTime = 0;
+	for (int step = 0; step < numSteps; ++step)
+	{
+		btTransform pusherTransform = pusher->getWorldTransform();
+		pusherTransform.getOrigin() += btVector3(btScalar(0.04), 0, 0);
+		pusher->setWorldTransform(pusherTransform);
+		clock.reset();
+		world.stepSimulation(btScalar(1. / 60.), 0, btScalar(1. / 60.));
+		stepTime += clock.getTimeMicroseconds();
+		hashes.push_back(hashWorldState(world));
+	}
+
+	for (int i = world.getNumConstraints() - 1; i >= 0; --i)
+	{
+		btTypedConstraint* constraint = world.getConstraint(i);
+		world.removeConstraint(constraint);
+		delete constraint;
+	}
+	for (int i = 0; i < bodies.size(); ++i)
+	{
+		world.removeRigidBody(bodies[i]);
+		delete bodies[i];
+	}
+	for (int i = 0; i < shapes.size(); ++i)
+	{
+		delete shapes[i];
+	}
+}
+
+TEST(BulletDynamicsTest, DeterministicMtSameResultForAnyThreadCount)
+{
+	const int numSteps = 200;
+	btThreadCountSweep sweep;
+	btAlignedObjectArray<unsigned long long> expected;
+	unsigned long long time;
+	ASSERT_TRUE(sweep.run(1));
+	simulateScene(true, numSteps, expected, time);
+	ASSERT_EQ(numSteps, expected.size());
+
+	// 1 thread again last, after the scheduler had 32
+	const int threadCounts[] = {4, 32, 1};
+	for (int i = 0; i < int(sizeof(threadCounts) / sizeof(threadCounts[0])); ++i)
+	{
+		const int numThreads = threadCounts[i];
+		ASSERT_TRUE(sweep.run(numThreads));
+		btAlignedObjectArray<unsigned long long> actual;
+		simulateScene(true, numSteps, actual, time);
+		ASSERT_EQ(numSteps, actual.size());
+		int firstDifference = -1;
+		for (int step = 0; step < numSteps && firstDifference < 0; ++step)
+		{
+			if (actual[step] != expected[step])
+			{
+				firstDifference = step;
+			}
+		}
+		EXPECT_EQ(-1, firstDifference) << numThreads << " threads";
+	}
+}
+
+// On a machine with fewer than 4 cores the threads share them, and the times are only comparable to each other
+TEST(BulletDynamicsTest, DeterministicMtOverhead)
+{
+	const int numThreads = 4;
+	btThreadCountSweep sweep;
+	ASSERT_TRUE(sweep.run(numThreads));
+	const int numSteps = 120;
+	btAlignedObjectArray<unsigned long long> hashes;
+	unsigned long long time[2] = {0, 0};
+	// best of two runs, to keep the comparison away from scheduling noise
+	for (int run = 0; run < 2; ++run)
+	{
+		for (int deterministic = 0; deterministic < 2; ++deterministic)
+		{
+			unsigned long long runTime;
+			simulateScene(deterministic != 0, numSteps, hashes, runTime);
+			if (run == 0 || runTime < time[deterministic])
+			{
+				time[deterministic] = runTime;
+			}
+		}
+	}
+	printf("%d threads, %d steps: %.2f ms per step, %.2f ms deterministic (%+.1f%%)\n", numThreads, numSteps,
+		   time[0] / (1000. * numSteps), time[1] / (1000. * numSteps), 100. * (double(time[1]) / double(time[0] ? time[0] : 1) - 1.));
+}
+
+#endif  // #if BT_THREADSAFE
+
+int main(int argc, char** argv)
+{
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
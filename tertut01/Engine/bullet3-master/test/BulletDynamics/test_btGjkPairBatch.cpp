@@ -0,0 +1,288 @@
+#include <btBulletDynamicsCommon.h>
+#include <BulletCollision/NarrowPhaseCollision/btGjkPairBatch.h>
+#include <BulletCollision/NarrowPhaseCollision/btGjkEpaPenetrationDepthSolver.h>
+#include <BulletCollision/NarrowPhaseCollision/btGjkPairDetector.h>
+#include <BulletCollision/NarrowPhaseCollision/btPointCollector.h>
+#include <BulletCollision/NarrowPhaseCollision/btVoronoiSimplexSolver.h>
+#include <gtest/gtest.h>
+#include <stdio.h>
+
+static btScalar randomScalar(btScalar lo, btScalar hi)
+{
+	return lo + (hi - lo) * btScalar(rand()) / btScalar(RAND_MAX);
+}
+
+static btVector3 randomVector(btScalar lo, btScalar hi)
+{
+	return btVector3(randomScalar(lo, hi), randomScalar(lo, hi), randomScalar(lo, hi));
+}
+
+static btQuaternion randomRotation()
+{
+	return btQuaternion(randomVector(-1, 1).normalized(), randomScalar(0, SIMD_2_PI));
+}
+
+static btConvexHullShape* createRock(int numPoints, btScalar radius)
+{
+	btConvexHullShape* hull = new btConvexHullShape();
+	for (int i = 0; i < numPoints; ++i)
+	{
+		hull->addPoint(randomVector(-1, 1).normalized() * randomScalar(radius * btScalar(0.6), radius), false);
+	}
+	hull->recalcLocalAabb();
+	return hull;
+}
+
+static btScalar scalarDistance(const btConvexShape* shapeA, const btTransform& transformA, const btConvexShape* shapeB, const btTransform& transformB)
+{
+	btVoronoiSimplexSolver simplexSolver;
+	btGjkEpaPenetrationDepthSolver penetrationSolver;
+	btGjkPairDetector detector(shapeA, shapeB, &simplexSolver, &penetrationSolver);
+	btDiscreteCollisionDetectorInterface::ClosestPointInput input;
+	input.m_transformA = transformA;
+	input.m_transformB = transformB;
+	btPointCollector result;
+	detector.getClosestPoints(input, result, 0);
+	return result.m_hasResult ? result.m_distance : BT_LARGE_FLOAT;
+}
+
+// A lane is only reported separated when btGjkPairDetector finds the shapes further apart than the maximum distance
+TEST(BulletDynamicsTest, GjkPairBatchSeparationIsConservative)
+{
+	srand(4242);
+	btBoxShape box(btVector3(1, btScalar(0.5), btScalar(0.7)));
+	btSphereShape sphere(btScalar(0.6));
+	btCapsuleShape capsule(btScalar(0.3), 1);
+	btConvexHullShape* rock = createRock(20, 1);
+	const btConvexShape* shapes[4] = {&box, &sphere, &capsule, rock};
+	const btScalar maximumDistance = btScalar(0.02);
+
+	int numPairs = 0;
+	int numSeparated = 0;
+	int numClose = 0;
+	for (int typeA = 0; typeA < 4; ++typeA)
+	{
+		for (int typeB = 0; typeB < 4; ++typeB)
+		{
+			for (int batchIndex = 0; batchIndex < 500; ++batchIndex)
+			{
+				btGjkPairBatch batch;
+				btTransform transformA[btGjkPairBatch::MAX_LANES];
+				btTransform transformB[btGjkPairBatch::MAX_LANES];
+				const int numLanes = 1 + batchIndex % btGjkPairBatch::MAX_LANES;
+				for (int lane = 0; lane < numLanes; ++lane)
+				{
+					transformA[lane] = btTransform(randomRotation(), randomVector(-btScalar(1.6), btScalar(1.6)));
+					transformB[lane] = btTransform(randomRotation(), randomVector(-btScalar(1.6), btScalar(1.6)));
+					const btVector3 warmStart = (batchIndex & 4) ? randomVector(-1, 1) : btVector3(0, 0, 0);
+					batch.setPair(lane, shapes[typeA], transformA[lane], shapes[typeB], transformB[lane], warmStart, maximumDistance);
+				}
+				batch.computeSeparation(numLanes);
+				for (int lane = 0; lane < numLanes; ++lane)
+				{
+					const btScalar distance = scalarDistance(shapes[typeA], transformA[lane], shapes[typeB], transformB[lane]);
+					numPairs++;
+					if (batch.isSeparated(lane))
+					{
+						numSeparated++;
+						EXPECT_GT(distance, maximumDistance) << "types " << typeA << " " << typeB;
+					}
+					else if (distance > btScalar(0.1))
+					{
+						numClose++;
+					}
+				}
+			}
+		}
+	}
+	printf("%d pairs, %d separated, %d further than 0.1 not separated\n", numPairs, numSeparated, numClose);
+	// GJK does not converge on every separated pair within the iteration limit, but most
+	EXPECT_LT(numClose, numPairs / 50);
+	delete rock;
+}
+
+// Boxes, spheres, capsules and rocks fall on a box, with or without the batched separation test
+struct FallingShapesWorld
+{
+	btDefaultCollisionConfiguration m_collisionConfiguration;
+	btCollisionDispatcher m_dispatcher;
+	btDbvtBroadphase m_broadphase;
+	btSequentialImpulseConstraintSolver m_solver;
+	btDiscreteDynamicsWorld m_world;
+	btAlignedObjectArray<btCollisionShape*> m_shapes;
+	btAlignedObjectArray<btRigidBody*> m_bodies;
+
+	FallingShapesWorld(bool batchConvexPairs)
+		: m_dispatcher(&m_collisionConfiguration),
+		  m_world(&m_dispatcher, &m_broadphase, &m_solver, &m_collisionConfiguration)
+	{
+		if (batchConvexPairs)
+		{
+			m_dispatcher.setDispatcherFlags(m_dispatcher.getDispatcherFlags() | btCollisionDispatcher::CD_BATCH_CONVEX_CONVEX_PAIRS);
+		}
+		srand(777);
+		btCollisionShape* ground = new btBoxShape(btVector3(20, 1, 20));
+		m_shapes.push_back(ground);
+		addBody(ground, 0, btTransform(btQuaternion::getIdentity(), btVector3(0, -1, 0)));
+
+		m_shapes.push_back(new btBoxShape(btVector3(btScalar(0.5), btScalar(0.3), btScalar(0.4))));
+		m_shapes.push_back(new btSphereShape(btScalar(0.4)));
+		m_shapes.push_back(new btCapsuleShape(btScalar(0.25), btScalar(0.6)));
+		m_shapes.push_back(createRock(16, btScalar(0.5)));
+		m_shapes.push_back(createRock(24, btScalar(0.6)));
+		for (int i = 0; i < 400; ++i)
+		{
+			const btVector3 position(btScalar(i % 8) * btScalar(1.3) - 5, btScalar(1 + i / 64) * btScalar(1.3), btScalar((i / 8) % 8) * btScalar(1.3) - 5);
+			addBody(m_shapes[1 + i % 5], 1, btTransform(randomRotation(), position + randomVector(-btScalar(0.1), btScalar(0.1))));
+		}
+	}
+
+	~FallingShapesWorld()
+	{
+		for (int i = 0; i < m_bodies.size(); ++i)
+		{
+			m_world.removeRigidBody(m_bodies[i]);
+			delete m_bodies[i]->getMotionState();
+			delete m_bodies[i];
+		}
+		for (int i = 0; i < m_shapes.size(); ++i)
+		{
+			delete m_shapes[i];
+		}
+	}
+
+	void addBody(btCollisionShape* shape, btScalar mass, const btTransform& transform)
+	{
+		btVector3 inertia(0, 0, 0);
+		if (mass > 0)
+		{
+			shape->calculateLocalInertia(mass, inertia);
+		}
+		btRigidBody* body = new btRigidBody(mass, new btDefaultMotionState(transform), shape, inertia);
+		m_world.addRigidBody(body);
+		m_bodies.push_back(body);
+	}
+
+	int getNumContacts() const
+	{
+		int numContacts = 0;
+		for (int i = 0; i < m_dispatcher.getNumManifolds(); ++i)
+		{
+			numContacts += m_dispatcher.getManifoldByIndexInternal(i)->getNumContacts();
+		}
+		return numContacts;
+	}
+};
+
+TEST(BulletDynamicsTest, GjkPairBatchKeepsSimulationIdentical)
+{
+	FallingShapesWorld reference(false);
+	FallingShapesWorld batched(true);
+	for (int step = 0; step < 240; ++step)
+	{
+		reference.m_world.stepSimulation(btScalar(1.) / btScalar(60.), 0);
+		batched.m_world.stepSimulation(btScalar(1.) / btScalar(60.), 0);
+		ASSERT_EQ(reference.m_dispatcher.getNumManifolds(), batched.m_dispatcher.getNumManifolds()) << "step " << step;
+		ASSERT_EQ(reference.getNumContacts(), batched.getNumContacts()) << "step " << step;
+	}
+	for (int i = 0; i < reference.m_bodies.size(); ++i)
+	{
+		const btTransform& expected = reference.m_bodies[i]->getWorldTransform();
+		const btTransform& actual = batched.m_bodies[i]->getWorldTransform();
+		EXPECT_EQ(0, memcmp(&expected.getOrigin(), &actual.getOrigin(), sizeof(btVector3))) << "body " << i;
+		EXPECT_EQ(0, memcmp(&expected.getBasis(), &actual.getBasis(), sizeof(btMatrix3x3))) << "body " << i;
+	}
+	for (int i = 0; i < reference.m_dispatcher.getNumManifolds(); ++i)
+	{
+		const btPersistentManifold* expected = reference.m_dispatcher.getManifoldByIndexInternal(i);
+		const btPersistentManifold* actual = batched.m_dispatcher.getManifoldByIndexInternal(i);
+		ASSERT_EQ(expected->getNumContacts(), actual->getNumContacts());
+		for (int j = 0; j < expected->getNumContacts(); ++j)
+		{
+			EXPECT_EQ(expected->getContactPoint(j).getDistance(), actual->getContactPoint(j).getDistance());
+			EXPECT_EQ(0, memcmp(&expected->getContactPoint(j).m_positionWorldOnB, &actual->getContactPoint(j).m_positionWorldOnB, sizeof(btVector3)));
+		}
+	}
+}
+
+// 10000 rocks on a jittered grid, most neighbours overlap in the broadphase but do not touch
+TEST(BulletDynamicsTest, GjkPairBatchRockPileBenchmark)
+{
+	srand(99);
+	btDefaultCollisionConfiguration collisionConfiguration;
+	btCollisionDispatcher dispatcher(&collisionConfiguration);
+	btDbvtBroadphase broadphase;
+	btCollisionWorld world(&dispatcher, &broadphase, &collisionConfiguration);
+	btAlignedObjectArray<btConvexHullShape*> rocks;
+	for (int i = 0; i < 8; ++i)
+	{
+		rocks.push_back(createRock(16 + 2 * i, 1));
+	}
+	btAlignedObjectArray<btCollisionObject*> objects;
+	const int gridSize[3] = {25, 20, 20};
+	for (int x = 0; x < gridSize[0]; ++x)
+	{
+		for (int y = 0; y < gridSize[1]; ++y)
+		{
+			for (int z = 0; z < gridSize[2]; ++z)
+			{
+				btCollisionObject* object = new btCollisionObject();
+				object->setCollisionShape(rocks[rand() % rocks.size()]);
+				const btVector3 position = btVector3(btScalar(x), btScalar(y), btScalar(z)) * btScalar(1.9) + randomVector(-btScalar(0.2), btScalar(0.2));
+				object->setWorldTransform(btTransform(randomRotation(), position));
+				world.addCollisionObject(object);
+				objects.push_back(object);
+			}
+		}
+	}
+	ASSERT_EQ(10000, objects.size());
+
+	// the first pass creates the collision algorithms and manifolds
+	world.performDiscreteCollisionDetection();
+	const int numPairs = broadphase.getOverlappingPairCache()->getNumOverlappingPairs();
+	int numTouchingPairs = 0;
+	for (int i = 0; i < dispatcher.getNumManifolds(); ++i)
+	{
+		numTouchingPairs += dispatcher.getManifoldByIndexInternal(i)->getNumContacts() > 0;
+	}
+	int numContacts[2];
+	unsigned long long time[2];
+	const int numPasses = 5;
+	for (int batched = 0; batched < 2; ++batched)
+	{
+		dispatcher.setDispatcherFlags(batched ? btCollisionDispatcher::CD_BATCH_CONVEX_CONVEX_PAIRS : 0);
+		world.performDiscreteCollisionDetection();
+		btClock clock;
+		for (int pass = 0; pass < numPasses; ++pass)
+		{
+			world.performDiscreteCollisionDetection();
+		}
+		time[batched] = clock.getTimeMicroseconds();
+		numContacts[batched] = 0;
+		for (int i = 0; i < dispatcher.getNumManifolds(); ++i)
+		{
+			numContacts[batched] += dispatcher.getManifoldByIndexInternal(i)->getNumContacts();
+		}
+	}
+	printf("%d rocks, %d pairs, %d touching: %.2f ms per collision pass, %.2f ms with batched separation (%.2fx)\n",
+		   objects.size(), numPairs, numTouchingPairs, time[0] / (1000. * numPasses), time[1] / (1000. * numPasses),
+		   double(time[0]) / double(time[1] ? time[1] : 1));
+	EXPECT_EQ(numContacts[0], numContacts[1]);
+	EXPECT_GT(numPairs, 2 * numTouchingPairs);
+
+	for (int i = 0; i < objects.size(); ++i)
+	{
+		world.removeCollisionObject(objects[i]);
+		delete objects[i];
+	}
+	for (int i = 0; i < rocks.size(); ++i)
+	{
+		delete rocks[i];
+	}
+}
+
+int main(int argc, char** argv)
+{
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
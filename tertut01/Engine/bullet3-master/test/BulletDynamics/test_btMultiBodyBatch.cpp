@@ -0,0 +1,397 @@
+#include <btBulletDynamicsCommon.h>
+#include <BulletDynamics/Featherstone/btMultiBody.h>
+#include <BulletDynamics/Featherstone/btMultiBodyBatch.h>
+#include <BulletDynamics/Featherstone/btMultiBodyConstraintSolver.h>
+#include <BulletDynamics/Featherstone/btMultiBodyDynamicsWorld.h>
+#include <BulletDynamics/Featherstone/btMultiBodyLinkCollider.h>
+#include <LinearMath/btQuickprof.h>
+#include <gtest/gtest.h>
+#include "btTestTaskScheduler.h"
+#include <stdio.h>
+#include <string.h>
+
+static btScalar randomScalar(btScalar lo, btScalar hi)
+{
+	return lo + (hi - lo) * btScalar(rand()) / btScalar(RAND_MAX);
+}
+
+static btVector3 randomVector(btScalar lo, btScalar hi)
+{
+	return btVector3(randomScalar(lo, hi), randomScalar(lo, hi), randomScalar(lo, hi));
+}
+
+static btQuaternion randomRotation()
+{
+	return btQuaternion(randomVector(-1, 1).normalized(), randomScalar(0, SIMD_2_PI));
+}
+
+enum Topology
+{
+	REVOLUTE_CHAIN,
+	MIXED_CHAIN,  // revolute, prismatic and fixed joints
+	BINARY_TREE,
+	NUM_TOPOLOGIES
+};
+
+// a multibody with random masses, frames and state, seeded so that calling it twice with the same seed gives the same multibody
+static btMultiBody* createMultiBody(Topology topology, int numLinks, bool fixedBase, unsigned int seed)
+{
+	srand(seed);
+	btMultiBody* body = new btMultiBody(numLinks, randomScalar(1, 3), randomVector(btScalar(0.2), 1), fixedBase, false);
+	for (int i = 0; i < numLinks; ++i)
+	{
+		const int parent = topology == BINARY_TREE && i > 0 ? (i - 1) / 2 : i - 1;
+		const btScalar mass = randomScalar(btScalar(0.5), 2);
+		const btVector3 inertia = randomVector(btScalar(0.05), btScalar(0.5));
+		const btQuaternion rotParentToThis = randomRotation();
+		const btVector3 axis = randomVector(-1, 1).normalized();
+		const btVector3 parentComToPivot = randomVector(-btScalar(0.5), btScalar(0.5));
+		const btVector3 pivotToCom = randomVector(-btScalar(0.5), btScalar(0.5));
+		const int jointType = topology == MIXED_CHAIN ? i % 3 : 0;
+		if (jointType == 0)
+		{
+			body->setupRevolute(i, mass, inertia, parent, rotParentToThis, axis, parentComToPivot, pivotToCom, true);
+		}
+		else if (jointType == 1)
+		{
+			body->setupPrismatic(i, mass, inertia, parent, rotParentToThis, axis, parentComToPivot, pivotToCom, true);
+		}
+		else
+		{
+			body->setupFixed(i, mass, inertia, parent, rotParentToThis, parentComToPivot, pivotToCom);
+		}
+	}
+	body->finalizeMultiDof();
+	body->setLinearDamping(randomScalar(0, btScalar(0.1)));
+	body->setAngularDamping(randomScalar(0, btScalar(0.1)));
+	body->setUseGyroTerm((seed & 1) != 0);
+	body->setWorldToBaseRot(randomRotation());
+	if (!fixedBase)
+	{
+		body->setBaseVel(randomVector(-1, 1));
+		body->setBaseOmega(randomVector(-1, 1));
+		body->addBaseForce(randomVector(-5, 5));
+		body->addBaseTorque(randomVector(-1, 1));
+	}
+	for (int i = 0; i < numLinks; ++i)
+	{
+		if (body->getLink(i).m_dofCount)
+		{
+			body->setJointPos(i, randomScalar(-1, 1));
+			body->setJointVel(i, randomScalar(-2, 2));
+			body->addJointTorque(i, randomScalar(-1, 1));
+		}
+		body->addLinkForce(i, randomVector(-5, 5));
+		body->addLinkTorque(i, randomVector(-1, 1));
+	}
+	return body;
+}
+
+static void expectNear(const btScalar* expected, const btScalar* actual, int size, btScalar tolerance, const char* what)
+{
+	for (int i = 0; i < size; ++i)
+	{
+		EXPECT_NEAR(expected[i], actual[i], tolerance * (1 + btFabs(expected[i]))) << what << " " << i;
+	}
+}
+
+// The batched velocity step matches computeAccelerationsArticulatedBodyAlgorithmMultiDof, including the cached
+// articulated inertia data that calcAccelerationDeltasMultiDof uses for the constraint solver
+TEST(BulletDynamicsTest, MultiBodyBatchMatchesScalar)
+{
+	const btScalar timeStep = btScalar(1.) / btScalar(60.);
+	const int numLinks[] = {0, 1, 5, 12};
+	btAlignedObjectArray<btMultiBody*> scalarBodies;
+	btAlignedObjectArray<btMultiBody*> batchedBodies;
+	unsigned int numCreated = 0;
+	int numTopologies = 0;
+	for (int topology = 0; topology < NUM_TOPOLOGIES; ++topology)
+	{
+		for (int n = 0; n < 4; ++n)
+		{
+			if (topology != REVOLUTE_CHAIN && numLinks[n] < 5)
+				continue;
+			for (int fixedBase = 0; fixedBase < 2; ++fixedBase)
+			{
+				for (int gyro = 0; gyro < 2; ++gyro)
+				{
+					// groups of 1 to 6 copies, so that some batches are only partially filled
+					const int numCopies = 1 + (numTopologies % 6);
+					for (int copy = 0; copy < numCopies; ++copy)
+					{
+						const unsigned int seed = 2 * (++numCreated) + unsigned(gyro);
+						scalarBodies.push_back(createMultiBody(Topology(topology), numLinks[n], fixedBase != 0, seed));
+						batchedBodies.push_back(createMultiBody(Topology(topology), numLinks[n], fixedBase != 0, seed));
+						ASSERT_TRUE(btMultiBodyBatch::isSupported(batchedBodies[batchedBodies.size() - 1]));
+					}
+					++numTopologies;
+				}
+			}
+		}
+	}
+
+	btAlignedObjectArray<btScalar> scratch_r;
+	btAlignedObjectArray<btVector3> scratch_v;
+	btAlignedObjectArray<btMatrix3x3> scratch_m;
+	for (int i = 0; i < scalarBodies.size(); ++i)
+	{
+		scalarBodies[i]->computeAccelerationsArticulatedBodyAlgorithmMultiDof(timeStep, scratch_r, scratch_v, scratch_m, false, false, false);
+	}
+	// reversed, so that the batches do not follow the creation order
+	btAlignedObjectArray<btMultiBody*> reversed;
+	for (int i = batchedBodies.size() - 1; i >= 0; --i)
+	{
+		reversed.push_back(batchedBodies[i]);
+	}
+	btMultiBodyBatch batch;
+	batch.computeAccelerations(&reversed[0], reversed.size(), timeStep);
+	EXPECT_EQ(numTopologies, batch.getNumGroups());
+
+	srand(77);
+	for (int i = 0; i < scalarBodies.size(); ++i)
+	{
+		const btMultiBody* scalarBody = scalarBodies[i];
+		const btMultiBody* batchedBody = batchedBodies[i];
+		const int numDofs = scalarBody->getNumDofs() + 6;
+		expectNear(scalarBody->getVelocityVector(), batchedBody->getVelocityVector(), numDofs, btScalar(1e-4), "velocity");
+
+		btAlignedObjectArray<btScalar> force, scalarDelta, batchedDelta;
+		force.resize(numDofs);
+		scalarDelta.resize(numDofs);
+		batchedDelta.resize(numDofs);
+		for (int dof = 0; dof < numDofs; ++dof)
+		{
+			force[dof] = randomScalar(-1, 1);
+		}
+		scalarBody->calcAccelerationDeltasMultiDof(&force[0], &scalarDelta[0], scratch_r, scratch_v);
+		batchedBody->calcAccelerationDeltasMultiDof(&force[0], &batchedDelta[0], scratch_r, scratch_v);
+		expectNear(&scalarDelta[0], &batchedDelta[0], numDofs, btScalar(1e-4), "acceleration delta");
+	}
+
+	for (int i = 0; i < scalarBodies.size(); ++i)
+	{
+		delete scalarBodies[i];
+		delete batchedBodies[i];
+	}
+}
+
+// The velocities do not depend on the number of threads the batches are distributed over
+TEST(BulletDynamicsTest, MultiBodyBatchSameResultForAnyThreadCount)
+{
+	btThreadCountSweep sweep;
+	const int numBodies = 64;
+	const int threadCounts[] = {1, 2, 4, 8};
+	btAlignedObjectArray<btScalar> expected;
+	for (int t = 0; t < 4; ++t)
+	{
+		if (!sweep.run(threadCounts[t]))
+		{
+			continue;
+		}
+		btAlignedObjectArray<btMultiBody*> bodies;
+		for (int i = 0; i < numBodies; ++i)
+		{
+			bodies.push_back(createMultiBody(Topology(i % NUM_TOPOLOGIES), 8, (i & 4) != 0, unsigned(i)));
+		}
+		btMultiBodyBatch batch;
+		batch.computeAccelerations(&bodies[0], numBodies, btScalar(1.) / btScalar(60.));
+		btAlignedObjectArray<btScalar> velocities;
+		for (int i = 0; i < numBodies; ++i)
+		{
+			for (int dof = 0; dof < bodies[i]->getNumDofs() + 6; ++dof)
+			{
+				velocities.push_back(bodies[i]->getVelocityVector()[dof]);
+			}
+			delete bodies[i];
+		}
+		if (t == 0)
+		{
+			expected = velocities;
+		}
+		ASSERT_EQ(expected.size(), velocities.size());
+		EXPECT_EQ(0, memcmp(&expected[0], &velocities[0], sizeof(btScalar) * expected.size())) << threadCounts[t] << " threads";
+	}
+}
+
+struct MultiBodyWorld
+{
+	btDefaultCollisionConfiguration m_collisionConfiguration;
+	btCollisionDispatcher m_dispatcher;
+	btDbvtBroadphase m_broadphase;
+	btMultiBodyConstraintSolver m_solver;
+	btMultiBodyDynamicsWorld m_world;
+	btStaticPlaneShape m_groundShape;
+	btSphereShape m_linkShape;
+	btCollisionObject m_ground;
+	btAlignedObjectArray<btMultiBody*> m_bodies;
+	btAlignedObjectArray<btMultiBodyLinkCollider*> m_colliders;
+
+	MultiBodyWorld()
+		: m_dispatcher(&m_collisionConfiguration),
+		  m_world(&m_dispatcher, &m_broadphase, &m_solver, &m_collisionConfiguration),
+		  m_groundShape(btVector3(0, 1, 0), 0),
+		  m_linkShape(btScalar(0.15))
+	{
+		m_world.setGravity(btVector3(0, -10, 0));
+		m_ground.setCollisionShape(&m_groundShape);
+		m_world.addCollisionObject(&m_ground);
+	}
+
+	~MultiBodyWorld()
+	{
+		for (int i = 0; i < m_colliders.size(); ++i)
+		{
+			m_world.removeCollisionObject(m_colliders[i]);
+			delete m_colliders[i];
+		}
+		for (int i = 0; i < m_bodies.size(); ++i)
+		{
+			m_world.removeMultiBody(m_bodies[i]);
+			delete m_bodies[i];
+		}
+		m_world.removeCollisionObject(&m_ground);
+	}
+
+	// a chain of revolute joints about z, hanging from a fixed base or falling onto the ground with a floating one
+	void addChain(int numLinks, bool fixedBase, const btVector3& basePosition, bool withColliders)
+	{
+		const btVector3 inertia(btScalar(0.01), btScalar(0.01), btScalar(0.01));
+		btMultiBody* body = new btMultiBody(numLinks, 1, inertia, fixedBase, false);
+		for (int i = 0; i < numLinks; ++i)
+		{
+			body->setupRevolute(i, 1, inertia, i - 1, btQuaternion(0, 0, 0, 1), btVector3(0, 0, 1), btVector3(btScalar(0.15), 0, 0), btVector3(btScalar(0.15), 0, 0), true);
+		}
+		body->finalizeMultiDof();
+		body->setBasePos(basePosition);
+		body->setLinearDamping(btScalar(0.01));
+		body->setAngularDamping(btScalar(0.01));
+		for (int i = 0; i < numLinks; ++i)
+		{
+			body->setJointPos(i, btScalar(0.3) * btSin(btScalar(i)));
+		}
+		m_world.addMultiBody(body);
+		m_bodies.push_back(body);
+
+		if (withColliders)
+		{
+			btAlignedObjectArray<btQuaternion> worldToLocal;
+			btAlignedObjectArray<btVector3> localOrigin;
+			worldToLocal.resize(numLinks + 1);
+			localOrigin.resize(numLinks + 1);
+			body->updateCollisionObjectWorldTransforms(worldToLocal, localOrigin);
+			for (int i = -1; i < numLinks; ++i)
+			{
+				btMultiBodyLinkCollider* collider = new btMultiBodyLinkCollider(body, i);
+				collider->setCollisionShape(&m_linkShape);
+				btTransform transform;
+				transform.setIdentity();
+				transform.setOrigin(localOrigin[i + 1]);
+				transform.setRotation(worldToLocal[i + 1].inverse());
+				collider->setWorldTransform(transform);
+				m_world.addCollisionObject(collider, btBroadphaseProxy::DefaultFilter, btBroadphaseProxy::AllFilter);
+				if (i < 0)
+				{
+					body->setBaseCollider(collider);
+				}
+				else
+				{
+					body->getLink(i).m_collider = collider;
+				}
+				m_colliders.push_back(collider);
+			}
+		}
+	}
+};
+
+// Chains falling onto the ground follow the same trajectories when stepped with the batch
+TEST(BulletDynamicsTest, MultiBodyBatchContactTrajectories)
+{
+	MultiBodyWorld scalarWorld, batchedWorld;
+	batchedWorld.m_world.setUseBatchedArticulations(true);
+	for (int i = 0; i < 6; ++i)
+	{
+		const btVector3 position(btScalar(i) * 4, btScalar(0.5) + btScalar(0.1) * btScalar(i), 0);
+		scalarWorld.addChain(6, false, position, true);
+		batchedWorld.addChain(6, false, position, true);
+	}
+	btScalar maxDifference = 0;
+	for (int step = 0; step < 60; ++step)
+	{
+		scalarWorld.m_world.stepSimulation(btScalar(1.) / btScalar(60.), 0);
+		batchedWorld.m_world.stepSimulation(btScalar(1.) / btScalar(60.), 0);
+		for (int i = 0; i < scalarWorld.m_bodies.size(); ++i)
+		{
+			maxDifference = btMax(maxDifference, (scalarWorld.m_bodies[i]->getBasePos() - batchedWorld.m_bodies[i]->getBasePos()).length());
+		}
+	}
+	EXPECT_EQ(1, batchedWorld.m_world.getArticulationBatch().getNumGroups());
+	EXPECT_EQ(2, batchedWorld.m_world.getArticulationBatch().getNumBatches());
+	EXPECT_LT(maxDifference, btScalar(1e-2));
+	for (int i = 0; i < batchedWorld.m_bodies.size(); ++i)
+	{
+		// resting on the ground
+		EXPECT_GT(batchedWorld.m_bodies[i]->getBasePos().getY(), btScalar(0.1));
+		EXPECT_LT(batchedWorld.m_bodies[i]->getBasePos().getY(), btScalar(0.2));
+	}
+}
+
+TEST(BulletDynamicsTest, MultiBodyBatchBenchmark)
+{
+	const int numChains = 1000;
+	const int numLinks = 12;
+	const int numSteps = 20;
+	unsigned long long time[2];
+	unsigned long long velocityTime[2];
+	btVector3 tipPosition[2];
+	setUpTaskScheduler();
+	for (int batched = 0; batched < 2; ++batched)
+	{
+		MultiBodyWorld world;
+		world.m_world.setUseBatchedArticulations(batched != 0);
+		for (int i = 0; i < numChains; ++i)
+		{
+			world.addChain(numLinks, true, btVector3(btScalar(i % 40), 5, btScalar(i / 40)), false);
+		}
+		world.m_world.stepSimulation(btScalar(1.) / btScalar(60.), 0);
+		btClock clock;
+		for (int step = 0; step < numSteps; ++step)
+		{
+			world.m_world.stepSimulation(btScalar(1.) / btScalar(60.), 0);
+		}
+		time[batched] = clock.getTimeMicroseconds();
+		tipPosition[batched] = world.m_bodies[numChains - 1]->localPosToWorld(numLinks - 1, btVector3(0, 0, 0));
+
+		// the velocity step alone
+		btAlignedObjectArray<btScalar> scratch_r;
+		btAlignedObjectArray<btVector3> scratch_v;
+		btAlignedObjectArray<btMatrix3x3> scratch_m;
+		btMultiBodyBatch batch;
+		clock.reset();
+		for (int step = 0; step < numSteps; ++step)
+		{
+			if (batched)
+			{
+				batch.computeAccelerations(&world.m_bodies[0], numChains, 0);
+			}
+			else
+			{
+				for (int i = 0; i < numChains; ++i)
+				{
+					world.m_bodies[i]->computeAccelerationsArticulatedBodyAlgorithmMultiDof(0, scratch_r, scratch_v, scratch_m, false, false, false);
+				}
+			}
+		}
+		velocityTime[batched] = clock.getTimeMicroseconds();
+	}
+	printf("%d chains of %d links: %.2f ms per step, %.2f ms batched; articulated body algorithm %.2f ms, %.2f ms batched (%.2fx)\n",
+		   numChains, numLinks, time[0] / (1000. * numSteps), time[1] / (1000. * numSteps),
+		   velocityTime[0] / (1000. * numSteps), velocityTime[1] / (1000. * numSteps),
+		   double(velocityTime[0]) / double(velocityTime[1] ? velocityTime[1] : 1));
+	EXPECT_LT((tipPosition[0] - tipPosition[1]).length(), btScalar(1e-2));
+}
+
+int main(int argc, char** argv)
+{
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
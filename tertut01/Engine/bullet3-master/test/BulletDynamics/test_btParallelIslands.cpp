@@ -0,0 +1,495 @@
+#include <btBulletDynamicsCommon.h>
+#include <BulletDynamics/Dynamics/btDiscreteDynamicsWorldMt.h>
+#include <BulletDynamics/Dynamics/btSimulationIslandManagerMt.h>
+#include <BulletDynamics/ConstraintSolver/btSequentialImpulseConstraintSolverMt.h>
+#include <BulletCollision/CollisionDispatch/btCollisionDispatcherMt.h>
+#include <LinearMath/btQuickprof.h>
+#include <gtest/gtest.h>
+#include <stdio.h>
+
+static btITaskScheduler* getTaskScheduler()
+{
+	static btITaskScheduler* scheduler = NULL;
+#if BT_THREADSAFE
+	if (!scheduler)
+	{
+		scheduler = btCreateDefaultTaskScheduler();
+	}
+#endif  // #if BT_THREADSAFE
+	if (!scheduler)
+	{
+		scheduler = btGetSequentialTaskScheduler();
+	}
+	return scheduler;
+}
+
+// what the island dispatch got to solve, in order
+struct btCapturedIsland
+{
+	btAlignedObjectArray<btCollisionObject*> m_bodies;
+	btAlignedObjectArray<btPersistentManifold*> m_manifolds;
+	btAlignedObjectArray<btTypedConstraint*> m_constraints;
+};
+static btAlignedObjectArray<btCapturedIsland>* gCapturedIslands = NULL;
+
+static void captureIslandDispatch(btAlignedObjectArray<btSimulationIslandManagerMt::Island*>* islands, const btSimulationIslandManagerMt::SolverParams&)
+{
+	for (int i = 0; i < islands->size(); ++i)
+	{
+		const btSimulationIslandManagerMt::Island& island = *(*islands)[i];
+		if (gCapturedIslands)
+		{
+			btCapturedIsland& captured = gCapturedIslands->expand();
+			captured.m_bodies.copyFromArray(island.bodyArray);
+			captured.m_manifolds.copyFromArray(island.manifoldArray);
+			captured.m_constraints.copyFromArray(island.constraintArray);
+		}
+	}
+}
+
+struct btIslandScene
+{
+	btDefaultCollisionConfiguration* m_collisionConfiguration;
+	btCollisionDispatcher* m_dispatcher;
+	btDbvtBroadphase* m_broadphase;
+	btSequentialImpulseConstraintSolver* m_solver;
+	btDiscreteDynamicsWorld* m_world;
+	btSphereShape* m_sphereShape;
+	btBoxShape* m_groundShape;
+	btAlignedObjectArray<btTypedConstraint*> m_constraints;
+
+	// rows of touching spheres on a ground box, every third row chained by point to point constraints to the next
+	btIslandScene(int numBodies, int rowLength)
+	{
+		m_collisionConfiguration = new btDefaultCollisionConfiguration();
+		m_dispatcher = new btCollisionDispatcher(m_collisionConfiguration);
+		m_broadphase = new btDbvtBroadphase();
+		m_solver = new btSequentialImpulseConstraintSolver();
+		m_world = new btDiscreteDynamicsWorld(m_dispatcher, m_broadphase, m_solver, m_collisionConfiguration);
+		m_sphereShape = new btSphereShape(btScalar(0.5));
+		const int numRows = (numBodies + rowLength - 1) / rowLength;
+		const int rowsPerSide = int(btSqrt(btScalar(numRows))) + 1;
+		m_groundShape = new btBoxShape(btVector3(btScalar(rowsPerSide * rowLength), 1, btScalar(rowsPerSide * 2)));
+
+		btRigidBody::btRigidBodyConstructionInfo groundInfo(0, 0, m_groundShape);
+		groundInfo.m_startWorldTransform.setOrigin(btVector3(0, -1, 0));
+		m_world->addRigidBody(new btRigidBody(groundInfo));
+
+		btVector3 inertia;
+		m_sphereShape->calculateLocalInertia(1, inertia);
+		btRigidBody::btRigidBodyConstructionInfo info(1, 0, m_sphereShape, inertia);
+		btRigidBody* previousRowStart = NULL;
+		for (int i = 0; i < numBodies; ++i)
+		{
+			const int row = i / rowLength;
+			const int column = i % rowLength;
+			info.m_startWorldTransform.setOrigin(btVector3(btScalar((row % rowsPerSide) * rowLength * 1.5 + column * 0.9 - rowsPerSide * rowLength),
+														   btScalar(0.49),
+														   btScalar((row / rowsPerSide) * 3 - rowsPerSide * 2)));
+			btRigidBody* body = new btRigidBody(info);
+			m_world->addRigidBody(body);
+			if (column == 0)
+			{
+				if (previousRowStart && (row % 3) != 0)
+				{
+					btPoint2PointConstraint* constraint = new btPoint2PointConstraint(*previousRowStart, *body, btVector3(0, 0, 1.5), btVector3(0, 0, -1.5));
+					m_world->addConstraint(constraint);
+					m_constraints.push_back(constraint);
+				}
+				previousRowStart = body;
+			}
+		}
+		m_world->performDiscreteCollisionDetection();
+	}
+
+	~btIslandScene()
+	{
+		// removing the bodies one by one searches the pairs and body arrays each time, which takes minutes for
+		// the benchmark, so drop all pairs and proxies at once and let the world go with its bodies
+		btOverlappingPairCache* pairCache = m_world->getPairCache();
+		while (int numPairs = pairCache->getNumOverlappingPairs())
+		{
+			btBroadphasePair& pair = pairCache->getOverlappingPairArray()[numPairs - 1];
+			pairCache->removeOverlappingPair(pair.m_pProxy0, pair.m_pProxy1, m_dispatcher);
+		}
+		btCollisionObjectArray objects = m_world->getCollisionObjectArray();
+		for (int i = 0; i < objects.size(); ++i)
+		{
+			m_broadphase->destroyProxy(objects[i]->getBroadphaseHandle(), m_dispatcher);
+			objects[i]->setBroadphaseHandle(NULL);
+		}
+		for (int i = 0; i < m_constraints.size(); ++i)
+		{
+			m_constraints[i]->getRigidBodyA().removeConstraintRef(m_constraints[i]);
+			m_constraints[i]->getRigidBodyB().removeConstraintRef(m_constraints[i]);
+			delete m_constraints[i];
+		}
+		delete m_world;
+		for (int i = 0; i < objects.size(); ++i)
+		{
+			delete objects[i];
+		}
+		delete m_solver;
+		delete m_broadphase;
+		delete m_dispatcher;
+		delete m_collisionConfiguration;
+		delete m_sphereShape;
+		delete m_groundShape;
+	}
+
+	// the island part of a step of btDiscreteDynamicsWorldMt, with the given island manager
+	void buildIslands(btSimulationIslandManagerMt& islandManager)
+	{
+		btSimulationIslandManagerMt::SolverParams solverParams;
+		solverParams.m_solverPool = m_solver;
+		solverParams.m_solverInfo = &m_world->getSolverInfo();
+		solverParams.m_dispatcher = m_dispatcher;
+		islandManager.setIslandDispatchFunction(captureIslandDispatch);
+		islandManager.updateActivationState(m_world, m_dispatcher);
+		islandManager.findConstraintUnions(NULL, 0, m_constraints.size() ? &m_constraints[0] : NULL, m_constraints.size());
+		islandManager.storeIslandActivationState(m_world);
+		islandManager.buildAndProcessIslands(m_dispatcher, m_world, m_constraints, solverParams);
+	}
+
+	void captureIslands(btSimulationIslandManagerMt& islandManager, btAlignedObjectArray<btCapturedIsland>& islands)
+	{
+		islands.resize(0);
+		gCapturedIslands = &islands;
+		buildIslands(islandManager);
+		gCapturedIslands = NULL;
+	}
+};
+
+// the world array index of the first body with the same island tag, the same for both ways of building islands
+static void getComponents(btDiscreteDynamicsWorld* world, btAlignedObjectArray<int>& components)
+{
+	btCollisionObjectArray& objects = world->getCollisionObjectArray();
+	btAlignedObjectArray<int> firstWithTag;
+	firstWithTag.resize(objects.size(), -1);
+	components.resize(objects.size());
+	for (int i = 0; i < objects.size(); ++i)
+	{
+		const int tag = objects[i]->getIslandTag();
+		if (tag < 0)
+		{
+			components[i] = -1;
+			continue;
+		}
+		if (firstWithTag[tag] < 0)
+		{
+			firstWithTag[tag] = i;
+		}
+		components[i] = firstWithTag[tag];
+	}
+}
+
+template <typename T>
+struct btLess
+{
+	bool operator()(const T& a, const T& b) const
+	{
+		return a < b;
+	}
+};
+
+template <typename T>
+static bool sameArray(const btAlignedObjectArray<T>& a, const btAlignedObjectArray<T>& b)
+{
+	if (a.size() != b.size())
+	{
+		return false;
+	}
+	for (int i = 0; i < a.size(); ++i)
+	{
+		if (!(a[i] == b[i]))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+template <typename T>
+static void sortedItems(const btAlignedObjectArray<btCapturedIsland>& islands, btAlignedObjectArray<T*> btCapturedIsland::*items, btAlignedObjectArray<T*>& sorted)
+{
+	sorted.resize(0);
+	for (int i = 0; i < islands.size(); ++i)
+	{
+		for (int j = 0; j < (islands[i].*items).size(); ++j)
+		{
+			sorted.push_back((islands[i].*items)[j]);
+		}
+	}
+	sorted.quickSort(btLess<T*>());
+}
+
+static void saveActivation(btDiscreteDynamicsWorld* world, btAlignedObjectArray<int>& states)
+{
+	states.resize(0);
+	for (int i = 0; i < world->getNumCollisionObjects(); ++i)
+	{
+		states.push_back(world->getCollisionObjectArray()[i]->getActivationState());
+	}
+}
+
+static void restoreActivation(btDiscreteDynamicsWorld* world, const btAlignedObjectArray<int>& states)
+{
+	for (int i = 0; i < world->getNumCollisionObjects(); ++i)
+	{
+		world->getCollisionObjectArray()[i]->forceActivationState(states[i]);
+		world->getCollisionObjectArray()[i]->setDeactivationTime(0);
+	}
+}
+
+static bool sameIslands(const btAlignedObjectArray<btCapturedIsland>& a, const btAlignedObjectArray<btCapturedIsland>& b)
+{
+	if (a.size() != b.size())
+	{
+		return false;
+	}
+	for (int i = 0; i < a.size(); ++i)
+	{
+		if (!sameArray(a[i].m_bodies, b[i].m_bodies) || !sameArray(a[i].m_manifolds, b[i].m_manifolds) || !sameArray(a[i].m_constraints, b[i].m_constraints))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+TEST(btParallelIslands, ConcurrentUnionFindRootIsSmallestIndex)
+{
+	btSetTaskScheduler(getTaskScheduler());
+	const int numElements = 20000;
+	btAlignedObjectArray<int> edges;
+	srand(3);
+	for (int i = 0; i < 15000; ++i)
+	{
+		edges.push_back(rand() % numElements);
+		edges.push_back(rand() % numElements);
+	}
+	btUnionFind serial;
+	serial.reset(numElements);
+	for (int i = 0; i < edges.size(); i += 2)
+	{
+		serial.unite(edges[i], edges[i + 1]);
+	}
+
+	struct UniteLoop : public btIParallelForBody
+	{
+		btUnionFind* m_unionFind;
+		const int* m_edges;
+		void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
+		{
+			for (int i = iBegin; i < iEnd; ++i)
+			{
+				m_unionFind->uniteConcurrent(m_edges[2 * i], m_edges[2 * i + 1]);
+			}
+		}
+	};
+	btUnionFind concurrent;
+	concurrent.reset(numElements);
+	UniteLoop loop;
+	loop.m_unionFind = &concurrent;
+	loop.m_edges = &edges[0];
+	btParallelFor(0, edges.size() / 2, 16, loop);
+
+	btAlignedObjectArray<int> smallest;
+	smallest.resize(numElements, numElements);
+	for (int i = 0; i < numElements; ++i)
+	{
+		const int root = serial.find(i);
+		smallest[root] = btMin(smallest[root], i);
+	}
+	for (int i = 0; i < numElements; ++i)
+	{
+		ASSERT_EQ(smallest[serial.find(i)], concurrent.find(i)) << "element " << i;
+	}
+}
+
+TEST(btParallelIslands, SameIslandsAsSerialBuild)
+{
+	btSetTaskScheduler(getTaskScheduler());
+	btIslandScene scene(3000, 7);
+	btCollisionObjectArray& objects = scene.m_world->getCollisionObjectArray();
+	// some islands sleep, one of them partly
+	for (int i = 100; i < 400; ++i)
+	{
+		objects[i]->forceActivationState(ISLAND_SLEEPING);
+	}
+	btAlignedObjectArray<int> initialStates;
+	saveActivation(scene.m_world, initialStates);
+
+	// without merging small islands into batches the island count can be compared too
+	btSimulationIslandManagerMt serialManager;
+	serialManager.setMinimumSolverBatchSize(1);
+	btAlignedObjectArray<btCapturedIsland> serialIslands;
+	scene.captureIslands(serialManager, serialIslands);
+	btAlignedObjectArray<int> serialComponents, serialStates;
+	getComponents(scene.m_world, serialComponents);
+	saveActivation(scene.m_world, serialStates);
+
+	restoreActivation(scene.m_world, initialStates);
+	btSimulationIslandManagerMt parallelManager;
+	parallelManager.setMinimumSolverBatchSize(1);
+	parallelManager.setParallelIslands(true);
+	btAlignedObjectArray<btCapturedIsland> parallelIslands;
+	scene.captureIslands(parallelManager, parallelIslands);
+	btAlignedObjectArray<int> parallelComponents, parallelStates;
+	getComponents(scene.m_world, parallelComponents);
+	saveActivation(scene.m_world, parallelStates);
+
+	EXPECT_TRUE(sameArray(serialComponents, parallelComponents));
+	EXPECT_TRUE(sameArray(serialStates, parallelStates));
+	// each island id is the smallest union-find index of the island, bodies are in world order
+	for (int i = 0; i < objects.size(); ++i)
+	{
+		if (parallelComponents[i] >= 0)
+		{
+			EXPECT_EQ(objects[parallelComponents[i]]->getIslandTag(), objects[i]->getIslandTag());
+		}
+	}
+	EXPECT_EQ(serialIslands.size(), parallelIslands.size());
+	EXPECT_GT(parallelIslands.size(), 1);
+
+	btAlignedObjectArray<btCollisionObject*> serialBodies, parallelBodies;
+	sortedItems(serialIslands, &btCapturedIsland::m_bodies, serialBodies);
+	sortedItems(parallelIslands, &btCapturedIsland::m_bodies, parallelBodies);
+	EXPECT_TRUE(sameArray(serialBodies, parallelBodies));
+	EXPECT_LT(parallelBodies.size(), 3000);
+	btAlignedObjectArray<btPersistentManifold*> serialManifolds, parallelManifolds;
+	sortedItems(serialIslands, &btCapturedIsland::m_manifolds, serialManifolds);
+	sortedItems(parallelIslands, &btCapturedIsland::m_manifolds, parallelManifolds);
+	EXPECT_TRUE(sameArray(serialManifolds, parallelManifolds));
+	EXPECT_GT(parallelManifolds.size(), 0);
+	btAlignedObjectArray<btTypedConstraint*> serialConstraints, parallelConstraints;
+	sortedItems(serialIslands, &btCapturedIsland::m_constraints, serialConstraints);
+	sortedItems(parallelIslands, &btCapturedIsland::m_constraints, parallelConstraints);
+	EXPECT_TRUE(sameArray(serialConstraints, parallelConstraints));
+	EXPECT_GT(parallelConstraints.size(), 0);
+
+	// the manifolds and constraints of an island belong to its bodies
+	for (int i = 0; i < parallelIslands.size(); ++i)
+	{
+		const btCapturedIsland& island = parallelIslands[i];
+		for (int j = 0; j < island.m_manifolds.size(); ++j)
+		{
+			const btCollisionObject* body = island.m_manifolds[j]->getBody0()->isStaticOrKinematicObject() ? island.m_manifolds[j]->getBody1() : island.m_manifolds[j]->getBody0();
+			EXPECT_GE(island.m_bodies.findLinearSearch((btCollisionObject*)body), 0);
+		}
+		for (int j = 0; j < island.m_constraints.size(); ++j)
+		{
+			EXPECT_GE(island.m_bodies.findLinearSearch(&island.m_constraints[j]->getRigidBodyA()), 0);
+		}
+	}
+}
+
+TEST(btParallelIslands, SameIslandsForAnyNumberOfThreads)
+{
+	btITaskScheduler* scheduler = getTaskScheduler();
+	btSetTaskScheduler(scheduler);
+	btIslandScene scene(5000, 5);
+	btAlignedObjectArray<int> initialStates;
+	saveActivation(scene.m_world, initialStates);
+	btSimulationIslandManagerMt islandManager;
+	islandManager.setParallelIslands(true);
+
+	const int maxThreads = scheduler->getNumThreads();
+	btAlignedObjectArray<btCapturedIsland> firstIslands, islands;
+	for (int numThreads = 1; numThreads <= maxThreads; numThreads = (numThreads == maxThreads ? maxThreads + 1 : btMin(numThreads * 2, maxThreads)))
+	{
+		scheduler->setNumThreads(numThreads);
+		for (int run = 0; run < 3; ++run)
+		{
+			restoreActivation(scene.m_world, initialStates);
+			scene.captureIslands(islandManager, numThreads == 1 && run == 0 ? firstIslands : islands);
+			if (numThreads > 1 || run > 0)
+			{
+				EXPECT_TRUE(sameIslands(firstIslands, islands)) << numThreads << " threads";
+			}
+		}
+	}
+	scheduler->setNumThreads(maxThreads);
+}
+
+TEST(btParallelIslands, WorldStepsWithParallelIslands)
+{
+	btSetTaskScheduler(getTaskScheduler());
+	btDefaultCollisionConfiguration collisionConfiguration;
+	btCollisionDispatcherMt dispatcher(&collisionConfiguration);
+	btDbvtBroadphase broadphase;
+	btConstraintSolverPoolMt solverPool(BT_MAX_THREAD_COUNT);
+	btDiscreteDynamicsWorldMt world(&dispatcher, &broadphase, &solverPool, NULL, &collisionConfiguration);
+	static_cast<btSimulationIslandManagerMt*>(world.getSimulationIslandManager())->setParallelIslands(true);
+
+	btBoxShape ground(btVector3(50, 1, 50));
+	btRigidBody::btRigidBodyConstructionInfo groundInfo(0, 0, &ground);
+	groundInfo.m_startWorldTransform.setOrigin(btVector3(0, -1, 0));
+	btRigidBody groundBody(groundInfo);
+	world.addRigidBody(&groundBody);
+	btBoxShape box(btVector3(btScalar(0.5), btScalar(0.5), btScalar(0.5)));
+	btVector3 inertia;
+	box.calculateLocalInertia(1, inertia);
+	btRigidBody::btRigidBodyConstructionInfo info(1, 0, &box, inertia);
+	btAlignedObjectArray<btRigidBody*> bodies;
+	for (int stack = 0; stack < 10; ++stack)
+	{
+		for (int level = 0; level < 5; ++level)
+		{
+			info.m_startWorldTransform.setOrigin(btVector3(btScalar(stack * 3 - 15), btScalar(0.5 + level * 1.01), 0));
+			btRigidBody* body = new btRigidBody(info);
+			world.addRigidBody(body);
+			bodies.push_back(body);
+		}
+	}
+	for (int i = 0; i < 600; ++i)
+	{
+		world.stepSimulation(btScalar(1. / 60.), 0, btScalar(1. / 60.));
+	}
+	// the stacks stand and have gone to sleep
+	for (int i = 0; i < bodies.size(); ++i)
+	{
+		EXPECT_NEAR(btScalar(0.5 + (i % 5) * 1.0), bodies[i]->getWorldTransform().getOrigin().getY(), btScalar(0.05));
+		EXPECT_EQ(ISLAND_SLEEPING, bodies[i]->getActivationState());
+	}
+	for (int i = 0; i < bodies.size(); ++i)
+	{
+		world.removeRigidBody(bodies[i]);
+		delete bodies[i];
+	}
+	world.removeRigidBody(&groundBody);
+}
+
+TEST(btParallelIslands, Benchmark)
+{
+	btITaskScheduler* scheduler = getTaskScheduler();
+	btSetTaskScheduler(scheduler);
+	const int sizes[] = {10000, 50000, 200000};
+	for (int s = 0; s < 3; ++s)
+	{
+		btIslandScene scene(sizes[s], 4);
+		double milliseconds[2];
+		for (int mode = 0; mode < 2; ++mode)
+		{
+			btSimulationIslandManagerMt islandManager;
+			islandManager.setParallelIslands(mode == 1);
+			scene.buildIslands(islandManager);
+			const int numRuns = 5;
+			btClock clock;
+			for (int run = 0; run < numRuns; ++run)
+			{
+				scene.buildIslands(islandManager);
+			}
+			milliseconds[mode] = clock.getTimeMicroseconds() / (1000. * numRuns);
+		}
+		printf("%d bodies, %d pairs, %d manifolds, %d threads: serial islands %.2f ms, parallel islands %.2f ms\n", sizes[s],
+			   scene.m_world->getPairCache()->getNumOverlappingPairs(), scene.m_dispatcher->getNumManifolds(), scheduler->getNumThreads(),
+			   milliseconds[0], milliseconds[1]);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
@@ -0,0 +1,228 @@
+#include <LinearMath/btProfileRecorder.h>
+#include <LinearMath/btThreads.h>
+#include <gtest/gtest.h>
+#include <stdio.h>
+
+static void runZones(int numZones)
+{
+	volatile int work = 0;
+	for (int i = 0; i < numZones; ++i)
+	{
+		BT_PROFILE("overhead");
+		work++;
+	}
+}
+
+static void runNestedZones(int numFrames)
+{
+	volatile int work = 0;
+	for (int i = 0; i < numFrames; ++i)
+	{
+		BT_PROFILE("frame");
+		{
+			BT_PROFILE("collision");
+			work++;
+		}
+		{
+			BT_PROFILE("solver");
+			for (int j = 0; j < 3; ++j)
+			{
+				BT_PROFILE("iteration");
+				work++;
+			}
+		}
+	}
+}
+
+static const btProfileZoneStats* findZoneStats(const btProfileRecorder& recorder, const char* name)
+{
+	const btAlignedObjectArray<btProfileZoneStats>& stats = recorder.getZoneStats();
+	for (int i = 0; i < stats.size(); ++i)
+	{
+		if (strcmp(stats[i].m_name, name) == 0)
+		{
+			return &stats[i];
+		}
+	}
+	return NULL;
+}
+
+static bool readFile(const char* fileName, btAlignedObjectArray<char>& contents)
+{
+	FILE* file = fopen(fileName, "rb");
+	if (!file)
+	{
+		return false;
+	}
+	int c;
+	while ((c = fgetc(file)) != EOF)
+	{
+		contents.push_back(char(c));
+	}
+	fclose(file);
+	return true;
+}
+
+// Measures the cost of a BT_PROFILE zone with the default zone functions and while recording
+TEST(BulletDynamicsTest, ProfileRecorderOverhead)
+{
+	const int numZones = 1 << 20;
+	const int aggregateInterval = 4096;
+	runZones(aggregateInterval);  // warm up
+
+	btClock clock;
+	runZones(numZones);
+	unsigned long long disabledTime = clock.getTimeNanoseconds();
+
+	btProfileRecorder recorder;
+	recorder.start();
+	clock.reset();
+	for (int i = 0; i < numZones; i += aggregateInterval)
+	{
+		runZones(aggregateInterval);
+		recorder.aggregate();
+	}
+	unsigned long long recordingTime = clock.getTimeNanoseconds();
+	recorder.stop();
+
+	printf("BT_PROFILE zone: %.1f ns without a recorder, %.1f ns recording (including aggregate)\n",
+		   double(disabledTime) / numZones, double(recordingTime) / numZones);
+
+	const btProfileZoneStats* stats = findZoneStats(recorder, "overhead");
+	ASSERT_TRUE(stats != NULL);
+	EXPECT_EQ(numZones, stats->m_numCalls);
+	EXPECT_EQ(0, recorder.getNumDroppedZones());
+	EXPECT_LE(stats->m_maxTime, recordingTime);
+
+	// the default zone functions are back
+	EXPECT_FALSE(recorder.isRecording());
+	runZones(16);
+	recorder.aggregate();
+	EXPECT_EQ(numZones, findZoneStats(recorder, "overhead")->m_numCalls);
+}
+
+TEST(BulletDynamicsTest, ProfileRecorderNestedZonesAndTraceExport)
+{
+	const int numFrames = 100;
+	const char* captureFileName = "Test_btProfileRecorder.btprof";
+	const char* traceFileName = "Test_btProfileRecorder_trace.json";
+	const char* convertedFileName = "Test_btProfileRecorder_capture.json";
+
+	btProfileRecorder recorder(1024);
+	recorder.setKeepEvents(true);
+	ASSERT_TRUE(recorder.beginCapture(captureFileName));
+	recorder.start();
+	for (int i = 0; i < numFrames; i += 10)
+	{
+		runNestedZones(10);
+		recorder.aggregate();
+	}
+	recorder.stop();
+	recorder.endCapture();
+
+	EXPECT_EQ(numFrames, findZoneStats(recorder, "frame")->m_numCalls);
+	EXPECT_EQ(numFrames, findZoneStats(recorder, "collision")->m_numCalls);
+	EXPECT_EQ(numFrames, findZoneStats(recorder, "solver")->m_numCalls);
+	EXPECT_EQ(3 * numFrames, findZoneStats(recorder, "iteration")->m_numCalls);
+	EXPECT_GE(findZoneStats(recorder, "frame")->m_totalTime, findZoneStats(recorder, "solver")->m_totalTime);
+
+	// zones are reported when they end, each frame contains the zones reported before it
+	const btAlignedObjectArray<btProfileEvent>& events = recorder.getEvents();
+	ASSERT_EQ(6 * numFrames, events.size());
+	for (int i = 0; i < events.size(); i += 6)
+	{
+		const btProfileEvent& frame = events[i + 5];
+		EXPECT_STREQ("frame", frame.m_name);
+		EXPECT_EQ(0, frame.m_threadIndex);
+		for (int j = 0; j < 5; ++j)
+		{
+			EXPECT_GE(events[i + j].m_startTime, frame.m_startTime);
+			EXPECT_LE(events[i + j].m_endTime, frame.m_endTime);
+		}
+		if (i > 0)
+		{
+			EXPECT_GE(frame.m_startTime, events[i - 1].m_endTime);
+		}
+	}
+
+	// the capture holds the same events as the recorder, so both traces are identical
+	ASSERT_TRUE(recorder.writeChromeTrace(traceFileName));
+	ASSERT_TRUE(btProfileRecorder::convertCaptureToChromeTrace(captureFileName, convertedFileName));
+	btAlignedObjectArray<char> trace, converted, capture;
+	ASSERT_TRUE(readFile(traceFileName, trace));
+	ASSERT_TRUE(readFile(convertedFileName, converted));
+	ASSERT_TRUE(readFile(captureFileName, capture));
+	ASSERT_EQ(trace.size(), converted.size());
+	EXPECT_EQ(0, memcmp(&trace[0], &converted[0], trace.size()));
+	const char* traceStart = "{\"traceEvents\":[\n{\"cat\":\"timing\",\"pid\":1,\"tid\":0,\"ts\":";
+	EXPECT_EQ(0, memcmp(&trace[0], traceStart, strlen(traceStart)));
+	EXPECT_LT(capture.size(), 8 * events.size());
+	printf("%d zones: %d bytes of Chrome trace, %d bytes of capture\n", events.size(), trace.size(), capture.size());
+
+	// a truncated capture is rejected
+	FILE* truncated = fopen(captureFileName, "wb");
+	ASSERT_TRUE(truncated != NULL);
+	fwrite(&capture[0], 1, capture.size() - 1, truncated);
+	fclose(truncated);
+	EXPECT_FALSE(btProfileRecorder::convertCaptureToChromeTrace(captureFileName, convertedFileName));
+
+	remove(captureFileName);
+	remove(traceFileName);
+	remove(convertedFileName);
+}
+
+TEST(BulletDynamicsTest, ProfileRecorderDropsZonesOfFullBuffers)
+{
+	btProfileRecorder recorder(16);
+	recorder.start();
+	runZones(100);
+	recorder.aggregate();
+	runZones(10);
+	recorder.stop();
+	EXPECT_EQ(16 + 10, findZoneStats(recorder, "overhead")->m_numCalls);
+	EXPECT_EQ(100 - 16, recorder.getNumDroppedZones());
+}
+
+#if BT_THREADSAFE
+
+struct ProfiledLoop : public btIParallelForBody
+{
+	void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
+	{
+		BT_PROFILE("forLoop");
+		runNestedZones(iEnd - iBegin);
+	}
+};
+
+TEST(BulletDynamicsTest, ProfileRecorderRecordsWorkerThreads)
+{
+	btITaskScheduler* scheduler = btCreateDefaultTaskScheduler();
+	if (!scheduler)
+	{
+		scheduler = btGetSequentialTaskScheduler();
+	}
+	btSetTaskScheduler(scheduler);
+
+	const int numFrames = 20000;
+	btProfileRecorder recorder;
+	recorder.start();
+	ProfiledLoop loop;
+	for (int i = 0; i < 10; ++i)
+	{
+		btParallelFor(0, numFrames / 10, 50, loop);
+		recorder.aggregate();
+	}
+	recorder.stop();
+
+	EXPECT_EQ(0, recorder.getNumDroppedZones());
+	EXPECT_EQ(numFrames, findZoneStats(recorder, "frame")->m_numCalls);
+	EXPECT_EQ(3 * numFrames, findZoneStats(recorder, "iteration")->m_numCalls);
+}
+
+#endif  // #if BT_THREADSAFE
+
+int main(int argc, char** argv)
+{
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
@@ -0,0 +1,151 @@
+#include <btBulletDynamicsCommon.h>
+#include <gtest/gtest.h>
+#include "btTestTaskScheduler.h"
+
+static btScalar randomScalar(btScalar lo, btScalar hi)
+{
+	return lo + (hi - lo) * btScalar(rand()) / btScalar(RAND_MAX);
+}
+
+static btVector3 randomVector(btScalar lo, btScalar hi)
+{
+	return btVector3(randomScalar(lo, hi), randomScalar(lo, hi), randomScalar(lo, hi));
+}
+
+// A field of boxes, spheres and triangle mesh quads, some of them in a second collision group
+struct RayTestScene
+{
+	btDefaultCollisionConfiguration m_collisionConfiguration;
+	btCollisionDispatcher m_dispatcher;
+	btBroadphaseInterface* m_broadphase;
+	btCollisionWorld* m_world;
+	btBoxShape m_boxShape;
+	btSphereShape m_sphereShape;
+	btTriangleMesh m_mesh;
+	btBvhTriangleMeshShape* m_meshShape;
+	btAlignedObjectArray<btCollisionObject*> m_objects;
+
+	RayTestScene(btBroadphaseInterface* broadphase)
+		: m_dispatcher(&m_collisionConfiguration),
+		  m_broadphase(broadphase),
+		  m_boxShape(btVector3(1, btScalar(0.5), 2)),
+		  m_sphereShape(1)
+	{
+		m_world = new btCollisionWorld(&m_dispatcher, m_broadphase, &m_collisionConfiguration);
+		m_mesh.addTriangle(btVector3(-2, 0, -2), btVector3(2, 0, -2), btVector3(2, 0, 2));
+		m_mesh.addTriangle(btVector3(-2, 0, -2), btVector3(2, 0, 2), btVector3(-2, 0, 2));
+		m_meshShape = new btBvhTriangleMeshShape(&m_mesh, true);
+		srand(1357);
+		for (int i = 0; i < 300; ++i)
+		{
+			btCollisionObject* object = new btCollisionObject();
+			btCollisionShape* shapes[3] = {&m_boxShape, &m_sphereShape, m_meshShape};
+			object->setCollisionShape(shapes[i % 3]);
+			btTransform transform;
+			transform.setIdentity();
+			transform.setOrigin(randomVector(-40, 40));
+			transform.setRotation(btQuaternion(randomVector(-1, 1).normalized(), randomScalar(0, SIMD_2_PI)));
+			object->setWorldTransform(transform);
+			const int group = (i % 5) == 0 ? 2 : 1;
+			m_world->addCollisionObject(object, group, btBroadphaseProxy::AllFilter);
+			m_objects.push_back(object);
+		}
+		m_world->updateAabbs();
+	}
+
+	~RayTestScene()
+	{
+		for (int i = 0; i < m_objects.size(); ++i)
+		{
+			m_world->removeCollisionObject(m_objects[i]);
+			delete m_objects[i];
+		}
+		delete m_world;
+		delete m_meshShape;
+		delete m_broadphase;
+	}
+};
+
+static void expectRayBatchMatchesRayTest(RayTestScene& scene)
+{
+	btAlignedObjectArray<btVector3> from, to;
+	btAlignedObjectArray<int> masks;
+	for (int i = 0; i < 2000; ++i)
+	{
+		// a few sensors casting fans of rays, and some rays from anywhere
+		const btVector3 origin = (i % 4) ? btVector3(btScalar((i / 500) * 10 - 15), 0, 0) : randomVector(-50, 50);
+		from.push_back(origin);
+		to.push_back(origin + randomVector(-1, 1).normalized() * randomScalar(10, 80));
+		masks.push_back((i % 7) == 0 ? 2 : int(btBroadphaseProxy::AllFilter));
+	}
+	btCollisionWorld::RayBatchResults results;
+	scene.m_world->rayTestBatch(&from[0], &to[0], &masks[0], from.size(), results);
+	ASSERT_EQ(results.m_collisionObjects.size(), from.size());
+	int numHits = 0;
+	for (int i = 0; i < from.size(); ++i)
+	{
+		btCollisionWorld::ClosestRayResultCallback expected(from[i], to[i]);
+		expected.m_collisionFilterMask = masks[i];
+		scene.m_world->rayTest(from[i], to[i], expected);
+		ASSERT_EQ(expected.m_collisionObject, results.m_collisionObjects[i]) << "ray " << i;
+		EXPECT_FLOAT_EQ(expected.m_closestHitFraction, results.m_hitFractions[i]) << "ray " << i;
+		if (expected.hasHit())
+		{
+			++numHits;
+			EXPECT_LT((expected.m_hitPointWorld - results.m_hitPointWorld[i]).length(), btScalar(1e-4)) << "ray " << i;
+			EXPECT_LT((expected.m_hitNormalWorld - results.m_hitNormalWorld[i]).length(), btScalar(1e-4)) << "ray " << i;
+		}
+	}
+	EXPECT_GT(numHits, 100);
+}
+
+TEST(BulletCollisionTest, RayTestBatchMatchesRayTest)
+{
+	setUpTaskScheduler();
+	RayTestScene scene(new btDbvtBroadphase());
+	expectRayBatchMatchesRayTest(scene);
+}
+
+TEST(BulletCollisionTest, RayTestBatchWithoutPacketBroadphase)
+{
+	// btSimpleBroadphase tests the rays of a packet one by one
+	setUpTaskScheduler();
+	RayTestScene scene(new btSimpleBroadphase());
+	expectRayBatchMatchesRayTest(scene);
+}
+
+TEST(BulletCollisionTest, ConvexSweepTestBatchMatchesConvexSweepTest)
+{
+	setUpTaskScheduler();
+	RayTestScene scene(new btDbvtBroadphase());
+	btSphereShape castShape(btScalar(0.5));
+	btAlignedObjectArray<btTransform> from, to;
+	for (int i = 0; i < 200; ++i)
+	{
+		btTransform start, end;
+		start.setIdentity();
+		end.setIdentity();
+		start.setOrigin(randomVector(-50, 50));
+		end.setOrigin(start.getOrigin() + randomVector(-1, 1).normalized() * 40);
+		from.push_back(start);
+		to.push_back(end);
+	}
+	btCollisionWorld::ConvexBatchResults results;
+	scene.m_world->convexSweepTestBatch(&castShape, &from[0], &to[0], 0, from.size(), results);
+	int numHits = 0;
+	for (int i = 0; i < from.size(); ++i)
+	{
+		btCollisionWorld::ClosestConvexResultCallback expected(from[i].getOrigin(), to[i].getOrigin());
+		scene.m_world->convexSweepTest(&castShape, from[i], to[i], expected);
+		ASSERT_EQ(expected.m_hitCollisionObject, results.m_hitCollisionObjects[i]) << "cast " << i;
+		EXPECT_FLOAT_EQ(expected.m_closestHitFraction, results.m_hitFractions[i]) << "cast " << i;
+		numHits += expected.hasHit();
+	}
+	EXPECT_GT(numHits, 10);
+}
+
+int main(int argc, char** argv)
+{
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
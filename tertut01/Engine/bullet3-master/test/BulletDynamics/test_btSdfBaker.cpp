@@ -0,0 +1,332 @@
+#include <btBulletCollisionCommon.h>
+#include <BulletCollision/CollisionShapes/btMiniSDF.h>
+#include <BulletCollision/CollisionShapes/btSdfBaker.h>
+#include <BulletCollision/CollisionShapes/btSdfCollisionShape.h>
+#include <LinearMath/btQuickprof.h>
+#include <LinearMath/btThreads.h>
+#include <gtest/gtest.h>
+#include "btTestTaskScheduler.h"
+#include <stdio.h>
+
+static btScalar randomScalar(btScalar lo, btScalar hi)
+{
+	return lo + (hi - lo) * btScalar(rand()) / btScalar(RAND_MAX);
+}
+
+static btVector3 randomVector(btScalar lo, btScalar hi)
+{
+	return btVector3(randomScalar(lo, hi), randomScalar(lo, hi), randomScalar(lo, hi));
+}
+
+static void subdivide(btTriangleMesh* mesh, const btVector3& a, const btVector3& b, const btVector3& c, int levels, int& triangleIndex, int skipEvery)
+{
+	if (levels == 0)
+	{
+		if (!skipEvery || (triangleIndex % skipEvery))
+		{
+			mesh->addTriangle(a, b, c);
+		}
+		triangleIndex++;
+		return;
+	}
+	const btVector3 ab = (a + b).normalized();
+	const btVector3 bc = (b + c).normalized();
+	const btVector3 ca = (c + a).normalized();
+	subdivide(mesh, a, ab, ca, levels - 1, triangleIndex, skipEvery);
+	subdivide(mesh, ab, b, bc, levels - 1, triangleIndex, skipEvery);
+	subdivide(mesh, ca, bc, c, levels - 1, triangleIndex, skipEvery);
+	subdivide(mesh, ab, bc, ca, levels - 1, triangleIndex, skipEvery);
+}
+
+// unit sphere with 8 * 4^levels counter-clockwise triangles, every skipEvery-th triangle left out if it is not 0
+static btTriangleMesh* createSphereMesh(int levels, int skipEvery = 0)
+{
+	btTriangleMesh* mesh = new btTriangleMesh();
+	int triangleIndex = 0;
+	for (int octant = 0; octant < 8; ++octant)
+	{
+		const btScalar sx = (octant & 1) ? btScalar(-1) : btScalar(1);
+		const btScalar sy = (octant & 2) ? btScalar(-1) : btScalar(1);
+		const btScalar sz = (octant & 4) ? btScalar(-1) : btScalar(1);
+		const btVector3 x(sx, 0, 0), y(0, sy, 0), z(0, 0, sz);
+		if (sx * sy * sz > 0)
+		{
+			subdivide(mesh, x, y, z, levels, triangleIndex, skipEvery);
+		}
+		else
+		{
+			subdivide(mesh, x, z, y, levels, triangleIndex, skipEvery);
+		}
+	}
+	return mesh;
+}
+
+static btTriangleMesh* createBoxMesh(const btVector3& halfExtents)
+{
+	btTriangleMesh* mesh = new btTriangleMesh();
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		for (int side = -1; side <= 1; side += 2)
+		{
+			const int u = (axis + 1) % 3;
+			const int v = (axis + 2) % 3;
+			btVector3 corners[4];
+			for (int i = 0; i < 4; ++i)
+			{
+				corners[i][axis] = side * halfExtents[axis];
+				corners[i][u] = ((i == 1 || i == 2) ? 1 : -1) * halfExtents[u];
+				corners[i][v] = ((i >= 2) ? 1 : -1) * halfExtents[v];
+			}
+			if (side > 0)
+			{
+				mesh->addTriangle(corners[0], corners[1], corners[2]);
+				mesh->addTriangle(corners[0], corners[2], corners[3]);
+			}
+			else
+			{
+				mesh->addTriangle(corners[0], corners[2], corners[1]);
+				mesh->addTriangle(corners[0], corners[3], corners[2]);
+			}
+		}
+	}
+	return mesh;
+}
+
+static btScalar boxDistance(const btVector3& p, const btVector3& halfExtents)
+{
+	const btVector3 q = p.absolute() - halfExtents;
+	btVector3 outside = q;
+	outside.setMax(btVector3(0, 0, 0));
+	return outside.length() + btMin(btMax(q.getX(), btMax(q.getY(), q.getZ())), btScalar(0));
+}
+
+TEST(btSdfBaker, SphereDistances)
+{
+	btTriangleMesh* mesh = createSphereMesh(5);
+	btSdfBaker baker;
+	baker.m_resolution[0] = baker.m_resolution[1] = baker.m_resolution[2] = 24;
+	baker.m_domainMargin = btScalar(0.5);
+	btMiniSDF sdf;
+	ASSERT_TRUE(baker.bake(mesh, sdf));
+	EXPECT_EQ(sdf.m_n_cells, 24u * 24u * 24u);
+	EXPECT_EQ(sdf.m_cells[0].size(), 24 * 24 * 24);
+
+	srand(1);
+	for (int i = 0; i < 1000; ++i)
+	{
+		const btVector3 p = randomVector(btScalar(-1.45), btScalar(1.45));
+		double dist;
+		btVector3 gradient;
+		ASSERT_TRUE(sdf.interpolate(0, dist, p, &gradient));
+		EXPECT_NEAR(p.length() - 1, dist, 0.01) << p.getX() << " " << p.getY() << " " << p.getZ();
+		if (p.length() > btScalar(0.2))
+		{
+			EXPECT_GT(gradient.normalized().dot(p.normalized()), btScalar(0.98));
+		}
+	}
+	delete mesh;
+}
+
+TEST(btSdfBaker, BoxDistancesAndExplicitDomain)
+{
+	const btVector3 halfExtents(2, btScalar(0.5), 1);
+	btTriangleMesh* mesh = createBoxMesh(halfExtents);
+	btSdfBaker baker;
+	baker.m_resolution[0] = 40;
+	baker.m_resolution[1] = 16;
+	baker.m_resolution[2] = 24;
+	btMiniSDF sdf;
+	ASSERT_TRUE(baker.bake(mesh, btVector3(-3, -1, -2), btVector3(3, 1, 2), sdf));
+
+	srand(2);
+	for (int i = 0; i < 1000; ++i)
+	{
+		const btVector3 p = randomVector(-1, 1) * btVector3(btScalar(2.9), btScalar(0.9), btScalar(1.9));
+		double dist;
+		ASSERT_TRUE(sdf.interpolate(0, dist, p, NULL));
+		// the cubic interpolation rounds the edges and corners of the box a little
+		EXPECT_NEAR(boxDistance(p, halfExtents), dist, 0.05);
+	}
+	double dist;
+	EXPECT_FALSE(sdf.interpolate(0, dist, btVector3(4, 0, 0), NULL));
+	delete mesh;
+}
+
+TEST(btSdfBaker, WindingNumberSignOfOpenMesh)
+{
+	// a sphere with every seventh triangle missing is still inside out the same way
+	btTriangleMesh* mesh = createSphereMesh(4, 7);
+	btSdfBaker baker;
+	baker.m_resolution[0] = baker.m_resolution[1] = baker.m_resolution[2] = 16;
+	btMiniSDF sdf;
+	ASSERT_TRUE(baker.bake(mesh, sdf));
+	const btVector3 inside[] = {btVector3(0, 0, 0), btVector3(btScalar(0.5), 0, 0), btVector3(0, btScalar(-0.6), btScalar(0.3))};
+	for (int i = 0; i < 3; ++i)
+	{
+		double dist;
+		ASSERT_TRUE(sdf.interpolate(0, dist, inside[i], NULL));
+		EXPECT_LT(dist, 0);
+	}
+	double dist;
+	ASSERT_TRUE(sdf.interpolate(0, dist, btVector3(btScalar(1.05), 0, 0), NULL));
+	EXPECT_GT(dist, 0);
+	delete mesh;
+}
+
+TEST(btSdfBaker, NarrowBand)
+{
+	btTriangleMesh* mesh = createSphereMesh(4);
+	btSdfBaker baker;
+	baker.m_resolution[0] = baker.m_resolution[1] = baker.m_resolution[2] = 32;
+	btMiniSDF dense;
+	ASSERT_TRUE(baker.bake(mesh, dense));
+	baker.m_narrowBand = btScalar(0.15);
+	btMiniSDF band;
+	ASSERT_TRUE(baker.bake(mesh, band));
+	EXPECT_LT(band.m_cells[0].size(), dense.m_cells[0].size() / 2);
+	EXPECT_LT(band.m_nodes[0].size(), dense.m_nodes[0].size());
+
+	srand(3);
+	for (int i = 0; i < 1000; ++i)
+	{
+		const btVector3 p = randomVector(btScalar(-1), btScalar(1)).normalized() * randomScalar(btScalar(0.9), btScalar(1.1));
+		double denseDist, bandDist;
+		ASSERT_TRUE(dense.interpolate(0, denseDist, p, NULL));
+		ASSERT_TRUE(band.interpolate(0, bandDist, p, NULL));
+		EXPECT_EQ(denseDist, bandDist);
+	}
+	double dist;
+	EXPECT_FALSE(band.interpolate(0, dist, btVector3(0, 0, 0), NULL));
+	delete mesh;
+}
+
+TEST(btSdfBaker, SaveLoadAndShape)
+{
+	btTriangleMesh* mesh = createSphereMesh(3);
+	btSdfBaker baker;
+	baker.m_resolution[0] = baker.m_resolution[1] = baker.m_resolution[2] = 12;
+	baker.m_narrowBand = btScalar(0.3);
+	btMiniSDF sdf;
+	ASSERT_TRUE(baker.bake(mesh, sdf));
+	btAlignedObjectArray<char> data;
+	sdf.save(data);
+
+	btSdfCollisionShape loaded, copied;
+	ASSERT_TRUE(loaded.initializeSDF(&data[0], data.size()));
+	ASSERT_TRUE(copied.initializeSDF(sdf));
+	srand(4);
+	for (int i = 0; i < 200; ++i)
+	{
+		const btVector3 p = randomVector(btScalar(-1.2), btScalar(1.2));
+		btScalar loadedDist, copiedDist;
+		btVector3 loadedNormal, copiedNormal;
+		const bool hasLoaded = loaded.queryPoint(p, loadedDist, loadedNormal);
+		ASSERT_EQ(hasLoaded, copied.queryPoint(p, copiedDist, copiedNormal));
+		if (hasLoaded)
+		{
+			EXPECT_EQ(loadedDist, copiedDist);
+			EXPECT_EQ(loadedNormal, copiedNormal);
+		}
+	}
+	delete mesh;
+}
+
+TEST(btSdfBaker, SameResultForAnyThreadCount)
+{
+	btThreadCountSweep sweep;
+	btTriangleMesh* mesh = createSphereMesh(4, 11);
+	btSdfBaker baker;
+	baker.m_resolution[0] = baker.m_resolution[1] = baker.m_resolution[2] = 20;
+	baker.m_narrowBand = btScalar(0.2);
+	btMiniSDF reference;
+	ASSERT_TRUE(sweep.run(1));
+	ASSERT_TRUE(baker.bake(mesh, reference));
+	btAlignedObjectArray<char> referenceData;
+	reference.save(referenceData);
+	const int threadCounts[] = {2, 4, 8};
+	for (int t = 0; t < int(sizeof(threadCounts) / sizeof(threadCounts[0])); ++t)
+	{
+		if (!sweep.run(threadCounts[t]))
+		{
+			continue;
+		}
+		btMiniSDF sdf;
+		ASSERT_TRUE(baker.bake(mesh, sdf));
+		btAlignedObjectArray<char> data;
+		sdf.save(data);
+		ASSERT_EQ(referenceData.size(), data.size());
+		EXPECT_EQ(0, memcmp(&referenceData[0], &data[0], data.size())) << threadCounts[t] << " threads";
+	}
+	delete mesh;
+}
+
+TEST(btSdfBaker, Benchmark)
+{
+	setUpTaskScheduler();
+	btTriangleMesh* mesh = createSphereMesh(6);
+	btClock clock;
+	btSdfBaker baker;
+	baker.m_resolution[0] = baker.m_resolution[1] = baker.m_resolution[2] = 64;
+	btMiniSDF dense, band;
+	clock.reset();
+	ASSERT_TRUE(baker.bake(mesh, dense));
+	const unsigned long long denseTime = clock.getTimeMicroseconds();
+	baker.m_narrowBand = btScalar(0.1);
+	clock.reset();
+	ASSERT_TRUE(baker.bake(mesh, band));
+	const unsigned long long bandTime = clock.getTimeMicroseconds();
+	printf("%d triangles, 64^3 cells: dense %.1f ms (%.1f ms per million cells, %d nodes), narrow band %.1f ms (%d cells, %d nodes)\n",
+		   mesh->getNumTriangles(), denseTime / 1000., denseTime / 1000. / (64 * 64 * 64 / 1e6), dense.m_nodes[0].size(),
+		   bandTime / 1000., band.m_cells[0].size(), band.m_nodes[0].size());
+
+	// contact queries of a box resting on the sphere, against the sdf and against the triangle mesh
+	btDefaultCollisionConfiguration configuration;
+	btCollisionDispatcher dispatcher(&configuration);
+	btDbvtBroadphase broadphase;
+	btCollisionWorld world(&dispatcher, &broadphase, &configuration);
+	btSdfCollisionShape sdfShape;
+	ASSERT_TRUE(sdfShape.initializeSDF(band));
+	btBvhTriangleMeshShape meshShape(mesh, true);
+	btBoxShape box(btVector3(btScalar(0.2), btScalar(0.2), btScalar(0.2)));
+
+	struct ContactCounter : public btCollisionWorld::ContactResultCallback
+	{
+		int m_numContacts;
+		ContactCounter() : m_numContacts(0) {}
+		virtual btScalar addSingleResult(btManifoldPoint& cp, const btCollisionObjectWrapper* colObj0Wrap, int partId0, int index0, const btCollisionObjectWrapper* colObj1Wrap, int partId1, int index1)
+		{
+			m_numContacts++;
+			return 0;
+		}
+	};
+
+	btCollisionShape* shapes[2] = {&sdfShape, &meshShape};
+	const char* names[2] = {"sdf", "triangle mesh"};
+	const int numQueries = 2000;
+	for (int s = 0; s < 2; ++s)
+	{
+		btCollisionObject target, probe;
+		target.setCollisionShape(shapes[s]);
+		probe.setCollisionShape(&box);
+		ContactCounter counter;
+		srand(5);
+		clock.reset();
+		for (int i = 0; i < numQueries; ++i)
+		{
+			const btVector3 direction = randomVector(-1, 1).normalized();
+			btTransform transform(btQuaternion(randomVector(-1, 1).normalized(), randomScalar(0, SIMD_2_PI)), direction * btScalar(1.15));
+			probe.setWorldTransform(transform);
+			world.contactPairTest(&probe, &target, counter);
+		}
+		const unsigned long long time = clock.getTimeMicroseconds();
+		printf("box against %s: %.2f us per contact query, %d contacts\n", names[s], double(time) / numQueries, counter.m_numContacts);
+		EXPECT_GT(counter.m_numContacts, 0);
+	}
+	delete mesh;
+}
+
+int main(int argc, char** argv)
+{
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
@@ -0,0 +1,452 @@
+#include <btBulletDynamicsCommon.h>
+#include <BulletDynamics/Dynamics/btDiscreteDynamicsWorldMt.h>
+#include <BulletDynamics/ConstraintSolver/btSequentialImpulseConstraintSolverMt.h>
+#include <BulletCollision/CollisionDispatch/btCollisionDispatcherMt.h>
+#include <LinearMath/btStepArena.h>
+#include <LinearMath/btPoolAllocator.h>
+#include <LinearMath/btQuickprof.h>
+#include <gtest/gtest.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static btITaskScheduler* getTaskScheduler()
+{
+	static btITaskScheduler* scheduler = NULL;
+#if BT_THREADSAFE
+	if (!scheduler)
+	{
+		scheduler = btCreateDefaultTaskScheduler();
+	}
+#endif  // #if BT_THREADSAFE
+	if (!scheduler)
+	{
+		scheduler = btGetSequentialTaskScheduler();
+	}
+	return scheduler;
+}
+
+// counts the heap allocations that go through btAlignedAlloc
+static int gNumHeapAllocations = 0;
+
+static void* countingAlloc(size_t size)
+{
+	btAtomicFetchAdd(&gNumHeapAllocations, 1);
+	return malloc(size);
+}
+
+static void countingFree(void* ptr)
+{
+	free(ptr);
+}
+
+// The scenes of examples/Benchmarks/BenchmarkDemo in the multithreaded world of its CommonRigidBodyMTBase:
+// 1 is the 3000 box stack, 5 the boxes, spheres and capsules falling onto a landscape, here a generated
+// triangle mesh in place of landscapeData.h
+struct btArenaScene
+{
+	btDefaultCollisionConfiguration* m_collisionConfiguration;
+	btCollisionDispatcherMt* m_dispatcher;
+	btDbvtBroadphase* m_broadphase;
+	btConstraintSolverPoolMt* m_solverPool;
+	btSequentialImpulseConstraintSolverMt* m_solverMt;
+	btDiscreteDynamicsWorldMt* m_world;
+	btAlignedObjectArray<btCollisionShape*> m_shapes;
+	btAlignedObjectArray<btRigidBody*> m_bodies;
+	btAlignedObjectArray<btScalar> m_vertices;
+	btAlignedObjectArray<int> m_indices;
+	btTriangleIndexVertexArray* m_meshInterface;
+
+	btArenaScene(int benchmark, bool useThreadArenas)
+	{
+		btDefaultCollisionConstructionInfo cci;
+		cci.m_defaultMaxPersistentManifoldPoolSize = 80000;
+		cci.m_defaultMaxCollisionAlgorithmPoolSize = 80000;
+		m_collisionConfiguration = new btDefaultCollisionConfiguration(cci);
+		m_dispatcher = new btCollisionDispatcherMt(m_collisionConfiguration, 40);
+		if (useThreadArenas)
+		{
+			m_dispatcher->setDispatcherFlags(m_dispatcher->getDispatcherFlags() | btCollisionDispatcher::CD_USE_THREAD_ARENAS);
+		}
+		m_broadphase = new btDbvtBroadphase();
+		m_solverPool = new btConstraintSolverPoolMt(BT_MAX_THREAD_COUNT);
+		m_solverMt = new btSequentialImpulseConstraintSolverMt();
+		m_world = new btDiscreteDynamicsWorldMt(m_dispatcher, m_broadphase, m_solverPool, m_solverMt, m_collisionConfiguration);
+		m_world->getSolverInfo().m_solverMode |= SOLVER_ENABLE_FRICTION_DIRECTION_CACHING;
+		m_world->getSolverInfo().m_numIterations = 5;
+		m_world->setGravity(btVector3(0, -10, 0));
+		m_meshInterface = NULL;
+
+		if (benchmark == 1)
+		{
+			addBody(0, btVector3(0, -50, 0), new btBoxShape(btVector3(250, 50, 250)));
+			btCollisionShape* blockShape = new btBoxShape(btVector3(1, 1, 1));
+			const int size = 8;
+			const btScalar spacing = 1;
+			btScalar offset = -size * (2 + spacing) * btScalar(0.5);
+			btScalar height = 2;
+			for (int k = 0; k < 47; k++)
+			{
+				for (int j = 0; j < size; j++)
+				{
+					for (int i = 0; i < size; i++)
+					{
+						addBody(2, btVector3(offset + i * (2 + spacing), height, offset + j * (2 + spacing)), blockShape);
+					}
+				}
+				offset -= btScalar(0.05) * spacing * (size - 1);
+				height += 2 + spacing;
+			}
+		}
+		else
+		{
+			addLandscape();
+			const int size = 10;
+			const btScalar cubeSize = btScalar(1.5);
+			btScalar spacing = 2;
+			btScalar offset = -size * (cubeSize * 2 + spacing) * btScalar(0.5);
+			btScalar height = 20;
+			int shapeIndex = 0;
+			for (int k = 0; k < 10; k++)
+			{
+				for (int j = 0; j < size; j++)
+				{
+					for (int i = 0; i < size; i++)
+					{
+						// 60 units lower than in the demo, so the bodies reach the landscape within the first steps
+						btVector3 pos = btVector3(0, -35, 0) + btVector3(5, 1, 5) * btVector3(offset + i * (cubeSize * 2 + spacing), height, offset + j * (cubeSize * 2 + spacing));
+						// the demo picks the shapes with rand(), go through them in turn instead
+						const int idx = shapeIndex++ % 9;
+						const btScalar r = btScalar(0.5) * (idx % 3 + 1);
+						if (idx < 3)
+						{
+							addBody(r, pos, new btBoxShape(btVector3(cubeSize, cubeSize, cubeSize) * r));
+						}
+						else if (idx < 6)
+						{
+							addBody(r, pos, new btSphereShape(btScalar(1.5) * r));
+						}
+						else
+						{
+							addBody(r, pos, new btCapsuleShape(r, 2 * r));
+						}
+					}
+				}
+				offset -= btScalar(0.05) * spacing * (size - 1);
+				spacing *= btScalar(1.1);
+				height += cubeSize * 2 + spacing;
+			}
+		}
+	}
+
+	~btArenaScene()
+	{
+		for (int i = m_bodies.size() - 1; i >= 0; i--)
+		{
+			m_world->removeRigidBody(m_bodies[i]);
+			delete m_bodies[i];
+		}
+		for (int i = 0; i < m_shapes.size(); ++i)
+		{
+			delete m_shapes[i];
+		}
+		delete m_meshInterface;
+		delete m_world;
+		delete m_solverMt;
+		delete m_solverPool;
+		delete m_broadphase;
+		delete m_dispatcher;
+		delete m_collisionConfiguration;
+	}
+
+	void addBody(btScalar mass, const btVector3& position, btCollisionShape* shape)
+	{
+		if (m_shapes.findLinearSearch(shape) == m_shapes.size())
+		{
+			m_shapes.push_back(shape);
+		}
+		btVector3 inertia(0, 0, 0);
+		if (mass != 0)
+		{
+			shape->calculateLocalInertia(mass, inertia);
+		}
+		btRigidBody::btRigidBodyConstructionInfo info(mass, NULL, shape, inertia);
+		info.m_startWorldTransform.setIdentity();
+		info.m_startWorldTransform.setOrigin(position);
+		btRigidBody* body = new btRigidBody(info);
+		m_world->addRigidBody(body);
+		m_bodies.push_back(body);
+	}
+
+	// rolling hills of 128 x 128 quads of 4 units, about the size of the landscape of the demo
+	void addLandscape()
+	{
+		const int numQuads = 128;
+		const btScalar quadSize = 4;
+		for (int z = 0; z <= numQuads; ++z)
+		{
+			for (int x = 0; x <= numQuads; ++x)
+			{
+				m_vertices.push_back((x - numQuads / 2) * quadSize);
+				m_vertices.push_back(btScalar(4) * btSin(x * btScalar(0.2)) * btCos(z * btScalar(0.15)));
+				m_vertices.push_back((z - numQuads / 2) * quadSize);
+			}
+		}
+		for (int z = 0; z < numQuads; ++z)
+		{
+			for (int x = 0; x < numQuads; ++x)
+			{
+				const int i = z * (numQuads + 1) + x;
+				m_indices.push_back(i);
+				m_indices.push_back(i + numQuads + 1);
+				m_indices.push_back(i + 1);
+				m_indices.push_back(i + 1);
+				m_indices.push_back(i + numQuads + 1);
+				m_indices.push_back(i + numQuads + 2);
+			}
+		}
+		m_meshInterface = new btTriangleIndexVertexArray(m_indices.size() / 3, &m_indices[0], 3 * sizeof(int),
+														 m_vertices.size() / 3, &m_vertices[0], 3 * sizeof(btScalar));
+		addBody(0, btVector3(0, -25, 0), new btBvhTriangleMeshShape(m_meshInterface, true));
+		m_bodies[m_bodies.size() - 1]->setFriction(btScalar(0.9));
+	}
+
+	void step()
+	{
+		m_world->stepSimulation(btScalar(1. / 60.), 0, btScalar(1. / 60.));
+	}
+};
+
+TEST(btStepArena, AllocatesAlignedAndRewinds)
+{
+	btStepArena arena(256);
+	const btStepArena::Marker start = arena.getMarker();
+	char* a = static_cast<char*>(arena.allocate(3, 1));
+	void* b = arena.allocate(40, 16);
+	void* c = arena.allocate(8, 64);
+	EXPECT_EQ(0u, reinterpret_cast<size_t>(b) % 16);
+	EXPECT_EQ(0u, reinterpret_cast<size_t>(c) % 64);
+	EXPECT_TRUE(arena.owns(a));
+	EXPECT_TRUE(arena.owns(c));
+
+	const btStepArena::Marker marker = arena.getMarker();
+	void* d = arena.allocate(100);
+	EXPECT_TRUE(arena.owns(d));
+	arena.rewind(marker);
+	EXPECT_FALSE(arena.owns(d));
+	// the memory after the marker is handed out again
+	EXPECT_EQ(d, arena.allocate(100));
+
+	arena.rewind(start);
+	EXPECT_EQ(0u, arena.getBytesInUse());
+	EXPECT_EQ(a, arena.allocate(3, 1));
+	EXPECT_EQ(1, arena.getNumBlockAllocations());
+}
+
+TEST(btStepArena, ResetMergesBlocks)
+{
+	btStepArena arena(1024);
+	// a step that needs several blocks
+	for (int i = 0; i < 100; ++i)
+	{
+		memset(arena.allocate(200), i, 200);
+	}
+	EXPECT_GT(arena.getNumBlockAllocations(), 1);
+	const size_t peak = arena.getPeakBytes();
+	EXPECT_GE(peak, 100u * 200u);
+
+	arena.reset();
+	EXPECT_EQ(0u, arena.getBytesInUse());
+	EXPECT_GE(arena.getCapacity(), peak);
+
+	// the same step again fits into the merged block
+	arena.resetStats();
+	for (int i = 0; i < 100; ++i)
+	{
+		memset(arena.allocate(200), i, 200);
+	}
+	EXPECT_EQ(0, arena.getNumBlockAllocations());
+	EXPECT_EQ(100, arena.getNumAllocations());
+	arena.reset();
+	EXPECT_EQ(0, arena.getNumBlockAllocations());
+}
+
+struct ThreadArenaLoop : public btIParallelForBody
+{
+	int* m_failures;
+
+	void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
+	{
+		btStepArena* arena = btGetThreadArena();
+		for (int i = iBegin; i < iEnd; ++i)
+		{
+			const btStepArena::Marker marker = arena->getMarker();
+			int* values = arena->allocateArray<int>(64);
+			for (int j = 0; j < 64; ++j)
+			{
+				values[j] = i + j;
+			}
+			// another thread writing into the same memory would show here
+			for (int j = 0; j < 64; ++j)
+			{
+				if (values[j] != i + j)
+				{
+					btAtomicFetchAdd(m_failures, 1);
+				}
+			}
+			arena->rewind(marker);
+		}
+	}
+};
+
+TEST(btStepArena, EachThreadHasItsOwnArena)
+{
+	btSetTaskScheduler(getTaskScheduler());
+	int failures = 0;
+	ThreadArenaLoop loop;
+	loop.m_failures = &failures;
+	btParallelFor(0, 20000, 16, loop);
+	EXPECT_EQ(0, failures);
+	btResetThreadArenas();
+}
+
+struct PoolAllocatorLoop : public btIParallelForBody
+{
+	btPoolAllocator* m_pool;
+	int* m_failures;
+
+	void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
+	{
+		for (int i = iBegin; i < iEnd; ++i)
+		{
+			int* elements[4];
+			for (int j = 0; j < 4; ++j)
+			{
+				elements[j] = static_cast<int*>(m_pool->allocate(sizeof(int) * 2));
+				elements[j][0] = i;
+				elements[j][1] = j;
+			}
+			// an element handed out twice would have been overwritten
+			for (int j = 0; j < 4; ++j)
+			{
+				if (elements[j][0] != i || elements[j][1] != j)
+				{
+					btAtomicFetchAdd(m_failures, 1);
+				}
+				m_pool->freeMemory(elements[j]);
+			}
+		}
+	}
+};
+
+struct PointerLess
+{
+	bool operator()(const void* a, const void* b) const
+	{
+		return a < b;
+	}
+};
+
+TEST(btStepArena, PoolAllocatorFromManyThreads)
+{
+	btITaskScheduler* scheduler = getTaskScheduler();
+	btSetTaskScheduler(scheduler);
+	btPoolAllocator pool(sizeof(int) * 2, 4 * BT_MAX_THREAD_COUNT);
+	int failures = 0;
+	PoolAllocatorLoop loop;
+	loop.m_pool = &pool;
+	loop.m_failures = &failures;
+	btParallelFor(0, 200000, 64, loop);
+	EXPECT_EQ(0, failures);
+	EXPECT_EQ(pool.getMaxCount(), pool.getFreeCount());
+
+	// all elements can still be allocated once
+	btAlignedObjectArray<void*> elements;
+	while (void* element = pool.allocate(sizeof(int) * 2))
+	{
+		EXPECT_TRUE(pool.validPtr(element));
+		elements.push_back(element);
+	}
+	EXPECT_EQ(pool.getMaxCount(), elements.size());
+	EXPECT_EQ(0, pool.getFreeCount());
+	elements.quickSort(PointerLess());
+	for (int i = 1; i < elements.size(); ++i)
+	{
+		EXPECT_NE(elements[i - 1], elements[i]);
+	}
+	printf("%d threads, %d contended pool operations in 800000 allocations and frees\n", scheduler->getNumThreads(), pool.getNumContentions());
+}
+
+TEST(btStepArena, TransientAlgorithmsGiveSameSimulation)
+{
+	btSetTaskScheduler(btGetSequentialTaskScheduler());
+	btArenaScene pooled(5, false);
+	btArenaScene arena(5, true);
+	btResetThreadArenaStats();
+	for (int i = 0; i < 120; ++i)
+	{
+		pooled.step();
+		arena.step();
+	}
+	btStepArenaStats stats;
+	btGetThreadArenaStats(stats);
+	// the per triangle algorithms came from the arena, and did not leak into the pool
+	EXPECT_GT(stats.m_numAllocations, 0);
+	EXPECT_EQ(pooled.m_collisionConfiguration->getCollisionAlgorithmPool()->getUsedCount(),
+			  arena.m_collisionConfiguration->getCollisionAlgorithmPool()->getUsedCount());
+	EXPECT_EQ(pooled.m_dispatcher->getNumManifolds(), arena.m_dispatcher->getNumManifolds());
+	for (int i = 0; i < pooled.m_bodies.size(); ++i)
+	{
+		const btVector3& a = pooled.m_bodies[i]->getWorldTransform().getOrigin();
+		const btVector3& b = arena.m_bodies[i]->getWorldTransform().getOrigin();
+		EXPECT_EQ(a.getX(), b.getX());
+		EXPECT_EQ(a.getY(), b.getY());
+		EXPECT_EQ(a.getZ(), b.getZ());
+	}
+	btSetTaskScheduler(getTaskScheduler());
+}
+
+TEST(btStepArena, Benchmark)
+{
+	btITaskScheduler* scheduler = getTaskScheduler();
+	btSetTaskScheduler(scheduler);
+	const int benchmarks[] = {1, 5};
+	for (int b = 0; b < 2; ++b)
+	{
+		for (int mode = 0; mode < 2; ++mode)
+		{
+			btArenaScene scene(benchmarks[b], mode == 1);
+			// let the stack settle and the bodies reach the landscape first
+			for (int i = 0; i < 180; ++i)
+			{
+				scene.step();
+			}
+			const btPoolAllocator* algorithmPool = scene.m_collisionConfiguration->getCollisionAlgorithmPool();
+			const btPoolAllocator* manifoldPool = scene.m_collisionConfiguration->getPersistentManifoldPool();
+			const int contentions = algorithmPool->getNumContentions() + manifoldPool->getNumContentions();
+			btResetThreadArenaStats();
+			gNumHeapAllocations = 0;
+			btAlignedAllocSetCustom(countingAlloc, countingFree);
+			const int numSteps = 30;
+			btClock clock;
+			for (int i = 0; i < numSteps; ++i)
+			{
+				scene.step();
+			}
+			const double milliseconds = clock.getTimeMicroseconds() / (1000. * numSteps);
+			btAlignedAllocSetCustom(NULL, NULL);
+			btStepArenaStats stats;
+			btGetThreadArenaStats(stats);
+			printf("BenchmarkDemo %d, %d bodies, %d manifolds, %d threads, %s: %.2f ms per step, %.1f heap allocations, %.1f arena allocations, %.1f contended pool operations per step\n",
+				   benchmarks[b], scene.m_bodies.size(), scene.m_dispatcher->getNumManifolds(), scheduler->getNumThreads(),
+				   mode ? "thread arenas" : "algorithm pool", milliseconds, double(gNumHeapAllocations) / numSteps,
+				   double(stats.m_numAllocations) / numSteps,
+				   double(algorithmPool->getNumContentions() + manifoldPool->getNumContentions() - contentions) / numSteps);
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
@@ -0,0 +1,204 @@
+#include <btBulletDynamicsCommon.h>
+#include <BulletDynamics/Dynamics/btDiscreteDynamicsWorldMt.h>
+#include <LinearMath/btQuickprof.h>
+#include <LinearMath/btTaskGraph.h>
+#include <gtest/gtest.h>
+#include "btTestTaskScheduler.h"
+#include <stdio.h>
+
+// Each task checks that all of its predecessors finished before it started, and counts how often it ran
+struct CheckedTasks : public btITaskBody
+{
+	mutable btAlignedObjectArray<int> m_runCounts;
+	btAlignedObjectArray<btAlignedObjectArray<int> > m_predecessors;
+	mutable btSpinMutex m_mutex;
+	mutable int m_numOrderErrors;
+
+	CheckedTasks() : m_numOrderErrors(0) {}
+
+	int add(btTaskGraph& graph, const int* predecessors, int numPredecessors)
+	{
+		int task = graph.addContinuation(*this, m_runCounts.size(), predecessors, numPredecessors);
+		EXPECT_EQ(task, m_runCounts.size());
+		m_runCounts.push_back(0);
+		m_predecessors.push_back(btAlignedObjectArray<int>());
+		for (int i = 0; i < numPredecessors; ++i)
+		{
+			m_predecessors[task].push_back(predecessors[i]);
+		}
+		return task;
+	}
+
+	void runTask(int task) const BT_OVERRIDE
+	{
+		btMutexLock(&m_mutex);
+		for (int i = 0; i < m_predecessors[task].size(); ++i)
+		{
+			if (m_runCounts[m_predecessors[task][i]] != 1)
+			{
+				m_numOrderErrors++;
+			}
+		}
+		m_runCounts[task]++;
+		btMutexUnlock(&m_mutex);
+	}
+};
+
+TEST(BulletDynamicsTest, TaskGraphRunsTasksOnceInOrder)
+{
+	setUpTaskScheduler();
+	btTaskGraph graph;
+	CheckedTasks tasks;
+	// a few independent chains fanning out and back in, plus tasks without any dependencies
+	btAlignedObjectArray<int> chainEnds;
+	for (int chain = 0; chain < 16; ++chain)
+	{
+		int head = tasks.add(graph, NULL, 0);
+		int fan[4];
+		for (int i = 0; i < 4; ++i)
+		{
+			fan[i] = tasks.add(graph, &head, 1);
+		}
+		int join = tasks.add(graph, fan, 4);
+		for (int i = 0; i < chain; ++i)
+		{
+			join = tasks.add(graph, &join, 1);
+		}
+		chainEnds.push_back(join);
+	}
+	for (int i = 0; i < 100; ++i)
+	{
+		tasks.add(graph, NULL, 0);
+	}
+	int last = tasks.add(graph, &chainEnds[0], chainEnds.size());
+
+	// run it twice to make sure a graph can be reused
+	for (int run = 1; run <= 2; ++run)
+	{
+		btRunTaskGraph(graph);
+		for (int i = 0; i < tasks.m_runCounts.size(); ++i)
+		{
+			ASSERT_EQ(tasks.m_runCounts[i], 1) << "task " << i;
+		}
+		EXPECT_EQ(tasks.m_numOrderErrors, 0);
+		// reset for the next run
+		for (int i = 0; i < tasks.m_runCounts.size(); ++i)
+		{
+			tasks.m_runCounts[i] = 0;
+		}
+	}
+	EXPECT_EQ(graph.getNumSuccessors(last), 0);
+	EXPECT_EQ(graph.getRootTasks().size(), 16 + 100);
+}
+
+TEST(BulletDynamicsTest, TaskGraphDetectsCycles)
+{
+	btTaskGraph graph;
+	CheckedTasks tasks;
+	int a = tasks.add(graph, NULL, 0);
+	int b = tasks.add(graph, &a, 1);
+	int c = tasks.add(graph, &b, 1);
+	EXPECT_TRUE(graph.prepare());
+	graph.addDependency(c, b);
+	EXPECT_FALSE(graph.prepare());
+}
+
+#if BT_THREADSAFE
+
+// Several separate stacks give several islands, so the task graph has something to overlap.
+// Returns the average time of a step in milliseconds
+static double simulateStacks(btSimulationIslandManagerMt::IslandDispatchFunc dispatch, btAlignedObjectArray<btTransform>& transforms, int numStacks = 12)
+{
+	btDefaultCollisionConfiguration collisionConfiguration;
+	// btCollisionDispatcherMt creates manifolds in whatever order the threads get to them, which changes the results
+	btCollisionDispatcher dispatcher(&collisionConfiguration);
+	btDbvtBroadphase broadphase;
+	btConstraintSolverPoolMt solverPool(BT_MAX_THREAD_COUNT);
+	btDiscreteDynamicsWorldMt world(&dispatcher, &broadphase, &solverPool, NULL, &collisionConfiguration);
+	static_cast<btSimulationIslandManagerMt*>(world.getSimulationIslandManager())->setIslandDispatchFunction(dispatch);
+	// islands are not merged, each stack is solved on its own
+	static_cast<btSimulationIslandManagerMt*>(world.getSimulationIslandManager())->setMinimumSolverBatchSize(1);
+
+	btStaticPlaneShape groundShape(btVector3(0, 1, 0), 0);
+	btBoxShape boxShape(btVector3(btScalar(0.5), btScalar(0.5), btScalar(0.5)));
+	btRigidBody ground(btRigidBody::btRigidBodyConstructionInfo(0, NULL, &groundShape));
+	world.addRigidBody(&ground);
+
+	btAlignedObjectArray<btRigidBody*> boxes;
+	btVector3 inertia;
+	boxShape.calculateLocalInertia(1, inertia);
+	for (int stack = 0; stack < numStacks; ++stack)
+	{
+		for (int level = 0; level < 5; ++level)
+		{
+			btRigidBody::btRigidBodyConstructionInfo info(1, NULL, &boxShape, inertia);
+			info.m_startWorldTransform.setIdentity();
+			info.m_startWorldTransform.setOrigin(btVector3(btScalar(stack * 3), btScalar(0.5) + btScalar(1.05) * level, btScalar(0.1) * level));
+			btRigidBody* box = new btRigidBody(info);
+			world.addRigidBody(box);
+			boxes.push_back(box);
+		}
+	}
+	const int numSteps = 60;
+	btClock clock;
+	for (int i = 0; i < numSteps; ++i)
+	{
+		world.stepSimulation(btScalar(1. / 60.), 0, btScalar(1. / 60.));
+	}
+	double stepMs = clock.getTimeMicroseconds() * 1e-3 / numSteps;
+	transforms.resize(0);
+	for (int i = 0; i < boxes.size(); ++i)
+	{
+		transforms.push_back(boxes[i]->getWorldTransform());
+		world.removeRigidBody(boxes[i]);
+		delete boxes[i];
+	}
+	world.removeRigidBody(&ground);
+	return stepMs;
+}
+
+TEST(BulletDynamicsTest, TaskGraphIslandDispatchMatchesParallelDispatch)
+{
+	btThreadCountSweep sweep;
+	const int threadCounts[] = {1, 4};
+	for (int t = 0; t < int(sizeof(threadCounts) / sizeof(threadCounts[0])); ++t)
+	{
+		ASSERT_TRUE(sweep.run(threadCounts[t]));
+		btAlignedObjectArray<btTransform> expected;
+		btAlignedObjectArray<btTransform> actual;
+		simulateStacks(btSimulationIslandManagerMt::parallelIslandDispatch, expected);
+		simulateStacks(btSimulationIslandManagerMt::taskGraphIslandDispatch, actual);
+		ASSERT_EQ(expected.size(), actual.size());
+		for (int i = 0; i < expected.size(); ++i)
+		{
+			EXPECT_EQ(expected[i].getOrigin(), actual[i].getOrigin()) << "box " << i << ", " << threadCounts[t] << " threads";
+			EXPECT_EQ(expected[i].getRotation(), actual[i].getRotation()) << "box " << i << ", " << threadCounts[t] << " threads";
+		}
+	}
+}
+
+// Thread counts from 1 to 32, as far as there are hardware threads
+TEST(BulletDynamicsTest, TaskGraphIslandDispatchScaling)
+{
+	btThreadCountSweep sweep;
+	const int threadCounts[] = {1, 2, 4, 8, 16, 32};
+	for (int t = 0; t < int(sizeof(threadCounts) / sizeof(threadCounts[0])); ++t)
+	{
+		if (!sweep.runOnHardwareThreads(threadCounts[t]))
+		{
+			continue;
+		}
+		btAlignedObjectArray<btTransform> transforms;
+		double parallelMs = simulateStacks(btSimulationIslandManagerMt::parallelIslandDispatch, transforms, 64);
+		double graphMs = simulateStacks(btSimulationIslandManagerMt::taskGraphIslandDispatch, transforms, 64);
+		printf("%d threads, 64 stacks: parallelIslandDispatch %.2f ms/step, taskGraphIslandDispatch %.2f ms/step\n", threadCounts[t], parallelMs, graphMs);
+	}
+}
+
+#endif  // #if BT_THREADSAFE
+
+int main(int argc, char** argv)
+{
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
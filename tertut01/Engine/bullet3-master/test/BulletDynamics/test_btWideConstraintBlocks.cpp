@@ -0,0 +1,414 @@
+#include <btBulletDynamicsCommon.h>
+#include <BulletDynamics/ConstraintSolver/btWideConstraintBlocks.h>
+#include <LinearMath/btQuickprof.h>
+#include <gtest/gtest.h>
+#include <stdio.h>
+
+static unsigned int nextRandom(unsigned int& state)
+{
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+	return state;
+}
+
+static btScalar randomSigned(unsigned int& state)
+{
+	return btScalar(nextRandom(state) & 0xffff) / btScalar(0x8000) - btScalar(1);
+}
+
+static btVector3 randomVector(unsigned int& state)
+{
+	btScalar x = randomSigned(state);
+	btScalar y = randomSigned(state);
+	btScalar z = randomSigned(state);
+	return btVector3(x, y, z);
+}
+
+// A pool of random contact rows between dynamic bodies and one static body, like the solver builds for a pile of boxes
+struct RandomRows
+{
+	btBoxShape m_shape;
+	btAlignedObjectArray<btRigidBody*> m_rigidBodies;
+	btAlignedObjectArray<btSolverBody> m_bodies;
+	btConstraintArray m_rows;
+
+	RandomRows(int numBodies, int numRows) : m_shape(btVector3(1, 1, 1))
+	{
+		unsigned int state = 12345;
+		for (int i = 0; i <= numBodies; ++i)
+		{
+			// body 0 is static
+			btScalar mass = i == 0 ? btScalar(0) : btScalar(1);
+			btRigidBody::btRigidBodyConstructionInfo info(mass, NULL, &m_shape, btVector3(1, 1, 1));
+			info.m_startWorldTransform.setOrigin(randomVector(state) * btScalar(20));
+			m_rigidBodies.push_back(new btRigidBody(info));
+
+			btSolverBody body;
+			body.m_worldTransform = info.m_startWorldTransform;
+			body.m_deltaLinearVelocity.setZero();
+			body.m_deltaAngularVelocity.setZero();
+			body.m_angularFactor.setValue(1, 1, 1);
+			body.m_linearFactor.setValue(1, 1, 1);
+			body.m_invMass.setValue(mass ? 1 : 0, mass ? 1 : 0, mass ? 1 : 0);
+			body.m_originalBody = m_rigidBodies[i];
+			m_bodies.push_back(body);
+		}
+		for (int i = 0; i < numRows; ++i)
+		{
+			btSolverConstraint row;
+			row.m_solverBodyIdA = nextRandom(state) % (numBodies + 1);
+			do
+			{
+				row.m_solverBodyIdB = nextRandom(state) % (numBodies + 1);
+			} while (row.m_solverBodyIdB == row.m_solverBodyIdA);
+			row.m_contactNormal1 = randomVector(state).normalized();
+			row.m_contactNormal2 = -row.m_contactNormal1;
+			row.m_relpos1CrossNormal = randomVector(state);
+			row.m_relpos2CrossNormal = randomVector(state);
+			row.m_angularComponentA = m_bodies[row.m_solverBodyIdA].m_invMass.x() ? row.m_relpos1CrossNormal * btScalar(0.5) : btVector3(0, 0, 0);
+			row.m_angularComponentB = m_bodies[row.m_solverBodyIdB].m_invMass.x() ? row.m_relpos2CrossNormal * btScalar(0.5) : btVector3(0, 0, 0);
+			row.m_jacDiagABInv = btScalar(0.25) + btScalar(0.1) * randomSigned(state);
+			row.m_rhs = randomSigned(state);
+			row.m_cfm = btScalar(0.01);
+			row.m_lowerLimit = 0;
+			row.m_upperLimit = btScalar(1e10);
+			row.m_friction = btScalar(0.5);
+			row.m_appliedImpulse = btScalar(0);
+			row.m_frictionIndex = i;
+			m_rows.push_back(row);
+		}
+	}
+
+	~RandomRows()
+	{
+		for (int i = 0; i < m_rigidBodies.size(); ++i)
+		{
+			delete m_rigidBodies[i];
+		}
+	}
+};
+
+GTEST_TEST(BulletDynamics, WideConstraintBlocksAreConflictFree)
+{
+	RandomRows rows(200, 1500);
+	for (int kernel = 0; kernel < btWideConstraintBlocks::KERNEL_COUNT; ++kernel)
+	{
+		btWideConstraintBlocks::s_preferredKernel = btWideConstraintBlocks::SolverKernel(kernel);
+		btWideConstraintBlocks blocks;
+		blocks.setup(&rows.m_rows, rows.m_bodies);
+		EXPECT_TRUE(blocks.validate(&rows.m_rows, rows.m_bodies));
+		EXPECT_EQ(1500, blocks.m_numRows);
+
+		// the lanes should be well used: 1500 rows over 200 bodies fit into few partially filled blocks
+		int minBlocks = (1500 + blocks.m_laneCount - 1) / blocks.m_laneCount;
+		EXPECT_LE(blocks.m_numBlocks, minBlocks + minBlocks / 4);
+	}
+	btWideConstraintBlocks::s_preferredKernel = btWideConstraintBlocks::KERNEL_AVX512;
+}
+
+GTEST_TEST(BulletDynamics, WideConstraintKernelsMatchScalarKernel)
+{
+	for (int kernel = btWideConstraintBlocks::KERNEL_AVX2; kernel < btWideConstraintBlocks::KERNEL_COUNT; ++kernel)
+	{
+		if (!btWideConstraintBlocks::isKernelSupported(btWideConstraintBlocks::SolverKernel(kernel)))
+		{
+			printf("%s kernel not supported on this CPU, skipped\n", btWideConstraintBlocks::getKernelName(btWideConstraintBlocks::SolverKernel(kernel)));
+			continue;
+		}
+		RandomRows wideRows(200, 1500);
+		RandomRows scalarRows(200, 1500);
+		btWideConstraintBlocks::s_preferredKernel = btWideConstraintBlocks::SolverKernel(kernel);
+		btWideConstraintBlocks wideContacts, wideFriction;
+		wideContacts.setup(&wideRows.m_rows, wideRows.m_bodies);
+		wideFriction.setup(&wideRows.m_rows, wideRows.m_bodies, &wideContacts);
+		ASSERT_EQ(kernel, wideContacts.m_kernel);
+
+		// run the scalar kernel over identical blocks
+		btWideConstraintBlocks scalarContacts, scalarFriction;
+		scalarContacts.setup(&scalarRows.m_rows, scalarRows.m_bodies);
+		scalarFriction.setup(&scalarRows.m_rows, scalarRows.m_bodies, &scalarContacts);
+		scalarContacts.m_kernel = btWideConstraintBlocks::KERNEL_SCALAR;
+		scalarFriction.m_kernel = btWideConstraintBlocks::KERNEL_SCALAR;
+
+		for (int iteration = 0; iteration < 10; ++iteration)
+		{
+			btScalar wideResidual = wideContacts.solve(wideRows.m_bodies);
+			wideResidual = btMax(wideResidual, wideFriction.solve(wideRows.m_bodies, &wideContacts));
+			btScalar scalarResidual = scalarContacts.solve(scalarRows.m_bodies);
+			scalarResidual = btMax(scalarResidual, scalarFriction.solve(scalarRows.m_bodies, &scalarContacts));
+			EXPECT_FLOAT_EQ(scalarResidual, wideResidual);
+		}
+
+		wideContacts.writeBackAppliedImpulses(&wideRows.m_rows);
+		scalarContacts.writeBackAppliedImpulses(&scalarRows.m_rows);
+		int numPositive = 0;
+		for (int i = 0; i < wideRows.m_rows.size(); ++i)
+		{
+			EXPECT_FLOAT_EQ(btScalar(scalarRows.m_rows[i].m_appliedImpulse), btScalar(wideRows.m_rows[i].m_appliedImpulse));
+			EXPECT_GE(btScalar(wideRows.m_rows[i].m_appliedImpulse), btScalar(0));
+			numPositive += btScalar(wideRows.m_rows[i].m_appliedImpulse) > 0;
+		}
+		EXPECT_GT(numPositive, 0);
+		for (int i = 0; i < wideRows.m_bodies.size(); ++i)
+		{
+			for (int j = 0; j < 3; ++j)
+			{
+				EXPECT_FLOAT_EQ(scalarRows.m_bodies[i].m_deltaLinearVelocity[j], wideRows.m_bodies[i].m_deltaLinearVelocity[j]);
+				EXPECT_FLOAT_EQ(scalarRows.m_bodies[i].m_deltaAngularVelocity[j], wideRows.m_bodies[i].m_deltaAngularVelocity[j]);
+			}
+		}
+		// the static body never picks up velocity
+		EXPECT_TRUE(wideRows.m_bodies[0].m_deltaLinearVelocity.fuzzyZero());
+	}
+	btWideConstraintBlocks::s_preferredKernel = btWideConstraintBlocks::KERNEL_AVX512;
+}
+
+// Times the solver iterations alone, so the wide and row-by-row modes can be compared in iterations per second
+class TimedSolver : public btSequentialImpulseConstraintSolver
+{
+public:
+	unsigned long long m_iterationMicroseconds;
+	int m_numIterations;
+
+	TimedSolver() : m_iterationMicroseconds(0), m_numIterations(0) {}
+
+	virtual btScalar solveGroupCacheFriendlyIterations(btCollisionObject** bodies, int numBodies, btPersistentManifold** manifoldPtr, int numManifolds, btTypedConstraint** constraints, int numConstraints, const btContactSolverInfo& infoGlobal, btIDebugDraw* debugDrawer)
+	{
+		btClock clock;
+		btScalar result = btSequentialImpulseConstraintSolver::solveGroupCacheFriendlyIterations(bodies, numBodies, manifoldPtr, numManifolds, constraints, numConstraints, infoGlobal, debugDrawer);
+		m_iterationMicroseconds += clock.getTimeMicroseconds();
+		m_numIterations += m_analyticsData.m_numIterationsUsed;
+		return result;
+	}
+};
+
+// The scenes from examples/Benchmarks/BenchmarkDemo, on the same ground box and with the same solver settings
+struct BenchmarkWorld
+{
+	btDefaultCollisionConfiguration m_collisionConfiguration;
+	btCollisionDispatcher m_dispatcher;
+	btDbvtBroadphase m_broadphase;
+	TimedSolver m_solver;
+	btDiscreteDynamicsWorld m_world;
+	btBoxShape m_groundShape;
+	btBoxShape m_boxShape;
+	btAlignedObjectArray<btRigidBody*> m_bodies;
+
+	BenchmarkWorld(int solverMode, int numIterations = 5)
+		: m_dispatcher(&m_collisionConfiguration),
+		  m_world(&m_dispatcher, &m_broadphase, &m_solver, &m_collisionConfiguration),
+		  m_groundShape(btVector3(250, 50, 250)),
+		  m_boxShape(btVector3(1, 1, 1))
+	{
+		m_world.setGravity(btVector3(0, -10, 0));
+		m_world.getSolverInfo().m_solverMode = solverMode | SOLVER_ENABLE_FRICTION_DIRECTION_CACHING;
+		m_world.getSolverInfo().m_numIterations = numIterations;
+
+		btTransform trans;
+		trans.setIdentity();
+		trans.setOrigin(btVector3(0, -50, 0));
+		addBody(0, trans, &m_groundShape);
+	}
+
+	// BenchmarkDemo::createPyramid, centred on the origin
+	void createPyramid(int stackSize)
+	{
+		const btVector3 boxSize(1, 1, 1);
+		const btScalar space = 0.0001f;
+		btScalar diffX = boxSize[0] * 1.02f;
+		btScalar diffY = boxSize[1] * 1.02f;
+		btScalar diffZ = boxSize[2] * 1.02f;
+		btScalar offsetX = -stackSize * (diffX * 2.0f + space) * 0.5f;
+		btScalar offsetZ = -stackSize * (diffZ * 2.0f + space) * 0.5f;
+		btVector3 pos(0.0f, boxSize[1], 0.0f);
+		btTransform trans;
+		trans.setIdentity();
+		while (stackSize)
+		{
+			for (int j = 0; j < stackSize; j++)
+			{
+				pos[2] = offsetZ + (float)j * (diffZ * 2.0f + space);
+				for (int i = 0; i < stackSize; i++)
+				{
+					pos[0] = offsetX + (float)i * (diffX * 2.0f + space);
+					trans.setOrigin(pos);
+					addBody(1, trans, &m_boxShape);
+				}
+			}
+			offsetX += diffX;
+			offsetZ += diffZ;
+			pos[1] += (diffY * 2.0f + space);
+			stackSize--;
+		}
+	}
+
+	// BenchmarkDemo::createTest1, "3000 fall boxes": 47 layers of 8 x 8 boxes dropped onto the ground
+	void createFallingBoxes(int numLayers)
+	{
+		const int size = 8;
+		const float cubeSize = 1.0f;
+		float spacing = cubeSize;
+		btVector3 pos(0.0f, cubeSize * 2, 0.f);
+		float offset = -size * (cubeSize * 2.0f + spacing) * 0.5f;
+		btTransform trans;
+		trans.setIdentity();
+		for (int k = 0; k < numLayers; k++)
+		{
+			for (int j = 0; j < size; j++)
+			{
+				pos[2] = offset + (float)j * (cubeSize * 2.0f + spacing);
+				for (int i = 0; i < size; i++)
+				{
+					pos[0] = offset + (float)i * (cubeSize * 2.0f + spacing);
+					trans.setOrigin(pos);
+					addBody(2, trans, &m_boxShape);
+				}
+			}
+			offset -= 0.05f * spacing * (size - 1);
+			pos[1] += (cubeSize * 2.0f + spacing);
+		}
+	}
+
+	~BenchmarkWorld()
+	{
+		for (int i = 0; i < m_bodies.size(); ++i)
+		{
+			m_world.removeRigidBody(m_bodies[i]);
+			delete m_bodies[i];
+		}
+	}
+
+	void addBody(btScalar mass, const btTransform& trans, btCollisionShape* shape)
+	{
+		btVector3 localInertia(0, 0, 0);
+		if (mass)
+			shape->calculateLocalInertia(mass, localInertia);
+		btRigidBody::btRigidBodyConstructionInfo info(mass, NULL, shape, localInertia);
+		info.m_startWorldTransform = trans;
+		btRigidBody* body = new btRigidBody(info);
+		m_world.addRigidBody(body);
+		m_bodies.push_back(body);
+	}
+
+	double getIterationsPerSecond() const
+	{
+		return m_solver.m_numIterations / (m_solver.m_iterationMicroseconds * 1e-6);
+	}
+
+	// deepest penetration over all contact points, the usual sign of a solver that does not converge
+	btScalar getMaxPenetration()
+	{
+		btScalar maxPenetration = 0;
+		for (int i = 0; i < m_dispatcher.getNumManifolds(); ++i)
+		{
+			btPersistentManifold* manifold = m_dispatcher.getManifoldByIndexInternal(i);
+			for (int j = 0; j < manifold->getNumContacts(); ++j)
+			{
+				maxPenetration = btMax(maxPenetration, -manifold->getContactPoint(j).getDistance());
+			}
+		}
+		return maxPenetration;
+	}
+};
+
+GTEST_TEST(BulletDynamics, WideSolverMatchesScalarSolverOnPyramid)
+{
+	const int stackSize = 8;
+	const int numSteps = 180;
+	BenchmarkWorld scalarWorld(SOLVER_USE_WARMSTARTING | SOLVER_SIMD);
+	BenchmarkWorld wideWorld(SOLVER_USE_WARMSTARTING | SOLVER_SIMD | SOLVER_WIDE_SIMD);
+	scalarWorld.createPyramid(stackSize);
+	wideWorld.createPyramid(stackSize);
+	for (int i = 0; i < numSteps; ++i)
+	{
+		scalarWorld.m_world.stepSimulation(btScalar(1. / 60.), 0);
+		wideWorld.m_world.stepSimulation(btScalar(1. / 60.), 0);
+	}
+
+	// the two modes visit the rows in a different order, so the results agree closely but not exactly
+	btScalar maxDeviation = 0;
+	btScalar maxSpeed = 0;
+	btScalar scalarDrift = 0;
+	btScalar wideDrift = 0;
+	BenchmarkWorld initialWorld(0);
+	initialWorld.createPyramid(stackSize);
+	for (int i = 1; i < wideWorld.m_bodies.size(); ++i)
+	{
+		const btVector3& initialPos = initialWorld.m_bodies[i]->getWorldTransform().getOrigin();
+		const btVector3& scalarPos = scalarWorld.m_bodies[i]->getWorldTransform().getOrigin();
+		const btVector3& widePos = wideWorld.m_bodies[i]->getWorldTransform().getOrigin();
+		maxDeviation = btMax(maxDeviation, (widePos - scalarPos).length());
+		scalarDrift = btMax(scalarDrift, (scalarPos - initialPos).length());
+		wideDrift = btMax(wideDrift, (widePos - initialPos).length());
+		maxSpeed = btMax(maxSpeed, wideWorld.m_bodies[i]->getLinearVelocity().length());
+	}
+	printf("drift from the initial pyramid: row-by-row %f, wide %f\n", scalarDrift, wideDrift);
+	EXPECT_LT(maxDeviation, btScalar(0.05));
+	EXPECT_LT(wideDrift, scalarDrift + btScalar(0.05));
+	EXPECT_LT(maxSpeed, btScalar(0.1));
+
+	double scalarRate = scalarWorld.getIterationsPerSecond();
+	double wideRate = wideWorld.getIterationsPerSecond();
+	printf("pyramid of %d boxes, %d manifolds: row-by-row %.0f iterations/s, %s blocks %.0f iterations/s (%.2fx), max deviation %f\n",
+		   wideWorld.m_bodies.size() - 1, wideWorld.m_dispatcher.getNumManifolds(), scalarRate,
+		   btWideConstraintBlocks::getKernelName(btWideConstraintBlocks::chooseKernel()), wideRate, wideRate / scalarRate, maxDeviation);
+}
+
+GTEST_TEST(BulletDynamics, WideSolverOnBenchmarkDemoFallingBoxes)
+{
+	// BenchmarkDemo test 1, until the bottom layers have landed and piled up.
+	// Falling boxes diverge chaotically between solvers, so only the quality of each pile is compared
+	const int numLayers = 47;
+	const int numSteps = 150;
+	const int iterationCounts[] = {5, 10, 20};
+	for (int k = 0; k < 3; ++k)
+	{
+		BenchmarkWorld scalarWorld(SOLVER_USE_WARMSTARTING | SOLVER_SIMD, iterationCounts[k]);
+		BenchmarkWorld wideWorld(SOLVER_USE_WARMSTARTING | SOLVER_SIMD | SOLVER_WIDE_SIMD, iterationCounts[k]);
+		scalarWorld.createFallingBoxes(numLayers);
+		wideWorld.createFallingBoxes(numLayers);
+		btScalar scalarPenetration = 0;
+		btScalar widePenetration = 0;
+		for (int i = 0; i < numSteps; ++i)
+		{
+			scalarWorld.m_world.stepSimulation(btScalar(1. / 60.), 0);
+			wideWorld.m_world.stepSimulation(btScalar(1. / 60.), 0);
+			scalarPenetration = btMax(scalarPenetration, scalarWorld.getMaxPenetration());
+			widePenetration = btMax(widePenetration, wideWorld.getMaxPenetration());
+		}
+
+		btScalar scalarLowest = BT_LARGE_FLOAT;
+		btScalar wideLowest = BT_LARGE_FLOAT;
+		btScalar wideMaxSpeed = 0;
+		btScalar scalarMaxSpeed = 0;
+		for (int i = 1; i < wideWorld.m_bodies.size(); ++i)
+		{
+			scalarLowest = btMin(scalarLowest, scalarWorld.m_bodies[i]->getWorldTransform().getOrigin().y());
+			wideLowest = btMin(wideLowest, wideWorld.m_bodies[i]->getWorldTransform().getOrigin().y());
+			scalarMaxSpeed = btMax(scalarMaxSpeed, scalarWorld.m_bodies[i]->getLinearVelocity().length());
+			wideMaxSpeed = btMax(wideMaxSpeed, wideWorld.m_bodies[i]->getLinearVelocity().length());
+		}
+
+		// boxes do not sink deeper, contacts are not resolved worse than row by row and nothing is launched
+		EXPECT_GT(wideLowest, scalarLowest - btScalar(0.25));
+		EXPECT_LT(widePenetration, scalarPenetration * btScalar(1.5));
+		EXPECT_LT(wideMaxSpeed, scalarMaxSpeed * btScalar(1.5) + btScalar(1));
+		EXPECT_GT(wideWorld.m_dispatcher.getNumManifolds(), wideWorld.m_bodies.size() / 2);
+
+		double scalarRate = scalarWorld.getIterationsPerSecond();
+		double wideRate = wideWorld.getIterationsPerSecond();
+		printf("%d falling boxes, %d iterations, %d manifolds: row-by-row %.0f iterations/s (%.2f ms/step), %s blocks %.0f iterations/s (%.2f ms/step, %.2fx), max penetration %f vs %f, lowest box %f vs %f\n",
+			   wideWorld.m_bodies.size() - 1, iterationCounts[k], wideWorld.m_dispatcher.getNumManifolds(),
+			   scalarRate, scalarWorld.m_solver.m_iterationMicroseconds * 1e-3 / numSteps,
+			   btWideConstraintBlocks::getKernelName(btWideConstraintBlocks::chooseKernel()),
+			   wideRate, wideWorld.m_solver.m_iterationMicroseconds * 1e-3 / numSteps, wideRate / scalarRate,
+			   scalarPenetration, widePenetration, scalarLowest, wideLowest);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
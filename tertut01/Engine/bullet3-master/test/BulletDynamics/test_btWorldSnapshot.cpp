@@ -0,0 +1,339 @@
+#include <btBulletDynamicsCommon.h>
+#include <BulletDynamics/Dynamics/btWorldSnapshot.h>
+#include <LinearMath/btQuickprof.h>
+#include <LinearMath/btSerializer.h>
+#include <gtest/gtest.h>
+#include <stdlib.h>
+
+static unsigned long long hashScalars(unsigned long long hash, const btScalar* values, int count)
+{
+	const unsigned char* bytes = (const unsigned char*)values;
+	for (size_t i = 0; i < count * sizeof(btScalar); ++i)
+	{
+		hash = (hash ^ bytes[i]) * 1099511628211ULL;
+	}
+	return hash;
+}
+
+static unsigned long long hashWorldState(const btDiscreteDynamicsWorld& world)
+{
+	unsigned long long hash = 14695981039346656037ULL;
+	const btCollisionObjectArray& objects = world.getCollisionObjectArray();
+	for (int i = 0; i < objects.size(); ++i)
+	{
+		const btTransform& transform = objects[i]->getWorldTransform();
+		hash = hashScalars(hash, transform.getOrigin().m_floats, 3);
+		for (int row = 0; row < 3; ++row)
+		{
+			hash = hashScalars(hash, transform.getBasis()[row].m_floats, 3);
+		}
+		if (const btRigidBody* body = btRigidBody::upcast(objects[i]))
+		{
+			hash = hashScalars(hash, body->getLinearVelocity().m_floats, 3);
+			hash = hashScalars(hash, body->getAngularVelocity().m_floats, 3);
+		}
+		const int activationState = objects[i]->getActivationState();
+		hash = (hash ^ (unsigned long long)activationState) * 1099511628211ULL;
+	}
+	return hash;
+}
+
+struct SnapshotScene
+{
+	btDefaultCollisionConfiguration m_collisionConfiguration;
+	btCollisionDispatcher m_dispatcher;
+	btDbvtBroadphase m_broadphase;
+	btSequentialImpulseConstraintSolver m_solver;
+	btDiscreteDynamicsWorld m_world;
+	btStaticPlaneShape m_groundShape;
+	btBoxShape m_boxShape;
+	btAlignedObjectArray<btRigidBody*> m_bodies;
+
+	SnapshotScene()
+		: m_dispatcher(&m_collisionConfiguration),
+		  m_world(&m_dispatcher, &m_broadphase, &m_solver, &m_collisionConfiguration),
+		  m_groundShape(btVector3(0, 1, 0), 0),
+		  m_boxShape(btVector3(btScalar(0.5), btScalar(0.5), btScalar(0.5)))
+	{
+		// the order of new pairs and manifolds must not depend on the history of the broadphase tree
+		m_world.getDispatchInfo().m_deterministicOverlappingPairs = true;
+		m_world.setGravity(btVector3(0, -10, 0));
+		addBody(0, btVector3(0, 0, 0), &m_groundShape);
+	}
+
+	~SnapshotScene()
+	{
+		for (int i = m_world.getNumConstraints() - 1; i >= 0; --i)
+		{
+			btTypedConstraint* constraint = m_world.getConstraint(i);
+			m_world.removeConstraint(constraint);
+			delete constraint;
+		}
+		for (int i = 0; i < m_bodies.size(); ++i)
+		{
+			m_world.removeRigidBody(m_bodies[i]);
+			delete m_bodies[i];
+		}
+	}
+
+	btRigidBody* addBody(btScalar mass, const btVector3& position, btCollisionShape* shape)
+	{
+		btVector3 inertia(0, 0, 0);
+		if (mass != 0)
+		{
+			shape->calculateLocalInertia(mass, inertia);
+		}
+		btRigidBody::btRigidBodyConstructionInfo info(mass, NULL, shape, inertia);
+		info.m_startWorldTransform.setIdentity();
+		info.m_startWorldTransform.setOrigin(position);
+		btRigidBody* body = new btRigidBody(info);
+		m_world.addRigidBody(body);
+		m_bodies.push_back(body);
+		return body;
+	}
+
+	// stacks that keep standing, boxes sliding apart on the ground and a swinging hinge chain,
+	// so the set of pairs stays the same while everything moves
+	void addStacksSlidersAndChain()
+	{
+		for (int stack = 0; stack < 5; ++stack)
+		{
+			for (int level = 0; level < 6; ++level)
+			{
+				addBody(1, btVector3(btScalar(stack * 3), btScalar(0.5) + btScalar(1.001) * level, btScalar(0.02) * (level & 1)), &m_boxShape);
+			}
+		}
+		for (int i = 0; i < 6; ++i)
+		{
+			btRigidBody* slider = addBody(1, btVector3(btScalar(i * 3), btScalar(0.5), btScalar(-6)), &m_boxShape);
+			slider->setLinearVelocity(btVector3(btScalar(i) - btScalar(2.5), 0, btScalar(-4)));
+			slider->setActivationState(DISABLE_DEACTIVATION);
+		}
+		btRigidBody* previous = addBody(0, btVector3(-6, 10, 6), &m_boxShape);
+		for (int i = 1; i < 7; ++i)
+		{
+			btRigidBody* link = addBody(1, btVector3(btScalar(-6) + btScalar(1.1) * i, 10, 6), &m_boxShape);
+			btHingeConstraint* hinge = new btHingeConstraint(*previous, *link, btVector3(btScalar(0.55), 0, 0), btVector3(btScalar(-0.55), 0, 0), btVector3(0, 0, 1), btVector3(0, 0, 1));
+			m_world.addConstraint(hinge, true);
+			previous = link;
+		}
+	}
+
+	void step(int numSteps, btAlignedObjectArray<unsigned long long>* hashes)
+	{
+		for (int i = 0; i < numSteps; ++i)
+		{
+			m_world.stepSimulation(btScalar(1. / 60.), 1, btScalar(1. / 60.));
+			if (hashes)
+			{
+				hashes->push_back(hashWorldState(m_world));
+			}
+		}
+	}
+};
+
+TEST(BulletDynamicsTest, WorldSnapshotRollbackReplaysIdentically)
+{
+	SnapshotScene scene;
+	scene.addStacksSlidersAndChain();
+	scene.step(30, NULL);
+
+	btWorldSnapshot snapshot;
+	scene.m_world.captureSnapshot(snapshot);
+	EXPECT_FALSE(snapshot.isDelta());
+	EXPECT_EQ(scene.m_world.getNumCollisionObjects(), snapshot.getNumObjectStates());
+	EXPECT_GT(snapshot.getNumManifoldStates(), 30);
+	const unsigned long long capturedHash = hashWorldState(scene.m_world);
+
+	btAlignedObjectArray<unsigned long long> expected;
+	scene.step(90, &expected);
+	EXPECT_NE(capturedHash, expected[expected.size() - 1]);
+
+	int numLostManifolds = -1;
+	ASSERT_TRUE(scene.m_world.restoreSnapshot(snapshot, &numLostManifolds));
+	EXPECT_EQ(0, numLostManifolds);
+	EXPECT_EQ(capturedHash, hashWorldState(scene.m_world));
+
+	btAlignedObjectArray<unsigned long long> actual;
+	scene.step(90, &actual);
+	ASSERT_EQ(expected.size(), actual.size());
+	for (int i = 0; i < expected.size(); ++i)
+	{
+		ASSERT_EQ(expected[i], actual[i]) << "step " << i;
+	}
+}
+
+TEST(BulletDynamicsTest, WorldSnapshotDeltasRestoreEachFrame)
+{
+	SnapshotScene scene;
+	scene.addStacksSlidersAndChain();
+	// boxes resting apart from everything else fall asleep and drop out of the deltas
+	for (int i = 0; i < 40; ++i)
+	{
+		scene.addBody(1, btVector3(btScalar(20 + 2 * (i % 8)), btScalar(0.5), btScalar(2 * (i / 8))), &scene.m_boxShape);
+	}
+	scene.step(150, NULL);
+
+	btRigidBody* sleeper = scene.m_bodies[scene.m_bodies.size() - 1];
+	ASSERT_EQ(ISLAND_SLEEPING, sleeper->getActivationState());
+
+	// every frame is a delta on the previous one
+	btWorldSnapshot keyFrame;
+	scene.m_world.captureSnapshot(keyFrame);
+	const int numFrames = 20;
+	btAlignedObjectArray<btWorldSnapshot*> deltas;
+	btAlignedObjectArray<unsigned long long> hashes;
+	for (int frame = 0; frame < numFrames; ++frame)
+	{
+		scene.step(1, &hashes);
+		if (frame == 10)
+		{
+			// moved by the game between steps, it stays asleep
+			sleeper->translate(btVector3(0, 0, 1));
+			hashes[frame] = hashWorldState(scene.m_world);
+		}
+		btWorldSnapshot* delta = new btWorldSnapshot();
+		scene.m_world.captureSnapshot(*delta, frame ? deltas[frame - 1] : &keyFrame);
+		EXPECT_TRUE(delta->isDelta());
+		EXPECT_GT(delta->getNumObjectStates(), 0);
+		EXPECT_LT(delta->getNumObjectStates(), keyFrame.getNumObjectStates() - 40);
+		EXPECT_LT(delta->getMemorySize(), keyFrame.getMemorySize());
+		deltas.push_back(delta);
+	}
+	EXPECT_EQ(ISLAND_SLEEPING, sleeper->getActivationState());
+	// jump around between the frames
+	const int frames[] = {7, 19, 0, 12, 12, 3};
+	for (int i = 0; i < 6; ++i)
+	{
+		ASSERT_TRUE(scene.m_world.restoreSnapshot(*deltas[frames[i]]));
+		EXPECT_EQ(hashes[frames[i]], hashWorldState(scene.m_world)) << "frame " << frames[i];
+	}
+	// and replay from one of them
+	int numLostManifolds = -1;
+	ASSERT_TRUE(scene.m_world.restoreSnapshot(*deltas[5], &numLostManifolds));
+	EXPECT_EQ(0, numLostManifolds);
+	for (int frame = 6; frame < numFrames; ++frame)
+	{
+		scene.step(1, NULL);
+		if (frame == 10)
+		{
+			sleeper->translate(btVector3(0, 0, 1));
+		}
+		EXPECT_EQ(hashes[frame], hashWorldState(scene.m_world)) << "frame " << frame;
+	}
+	for (int i = 0; i < deltas.size(); ++i)
+	{
+		delete deltas[i];
+	}
+}
+
+TEST(BulletDynamicsTest, WorldSnapshotRejectsOtherWorlds)
+{
+	SnapshotScene scene;
+	scene.addStacksSlidersAndChain();
+	scene.step(5, NULL);
+	btWorldSnapshot snapshot;
+	scene.m_world.captureSnapshot(snapshot);
+	const unsigned long long hash = hashWorldState(scene.m_world);
+
+	btRigidBody* extra = scene.addBody(1, btVector3(0, 20, 0), &scene.m_boxShape);
+	EXPECT_FALSE(scene.m_world.restoreSnapshot(snapshot));
+	scene.m_world.removeRigidBody(extra);
+	scene.m_bodies.pop_back();
+	delete extra;
+
+	SnapshotScene other;
+	other.addStacksSlidersAndChain();
+	EXPECT_FALSE(other.m_world.restoreSnapshot(snapshot));
+
+	scene.step(5, NULL);
+	EXPECT_TRUE(scene.m_world.restoreSnapshot(snapshot));
+	EXPECT_EQ(hash, hashWorldState(scene.m_world));
+}
+
+static int gNumSnapshotAllocations = 0;
+
+static void* countingAlloc(size_t size)
+{
+	gNumSnapshotAllocations++;
+	return malloc(size);
+}
+
+static void countingFree(void* ptr)
+{
+	free(ptr);
+}
+
+// 10000 boxes resting on the ground, most of them asleep, against the serializer that a save goes through today
+TEST(BulletDynamicsTest, WorldSnapshotBenchmark)
+{
+	SnapshotScene scene;
+	for (int i = 0; i < 10000; ++i)
+	{
+		scene.addBody(1, btVector3(btScalar(2 * (i % 100)), btScalar(0.5), btScalar(2 * (i / 100))), &scene.m_boxShape);
+	}
+	scene.step(2, NULL);
+	for (int i = 1; i < scene.m_bodies.size(); ++i)
+	{
+		if (i % 10)
+		{
+			scene.m_bodies[i]->forceActivationState(ISLAND_SLEEPING);
+		}
+	}
+	// the first step zeroes the velocities of the sleeping bodies, the second one their predicted transforms
+	scene.step(2, NULL);
+
+	const int numRuns = 20;
+	btWorldSnapshot keyFrame;
+	btWorldSnapshot delta;
+	scene.m_world.captureSnapshot(keyFrame);
+	btClock clock;
+	for (int i = 0; i < numRuns; ++i)
+	{
+		scene.m_world.captureSnapshot(keyFrame);
+	}
+	const unsigned long long captureTime = clock.getTimeMicroseconds();
+	scene.step(1, NULL);
+	// what the previous frame changed, against the full snapshot taken before it
+	scene.m_world.captureSnapshot(delta, &keyFrame);
+	clock.reset();
+	for (int i = 0; i < numRuns; ++i)
+	{
+		scene.m_world.captureSnapshot(delta, &keyFrame);
+	}
+	const unsigned long long deltaTime = clock.getTimeMicroseconds();
+
+	gNumSnapshotAllocations = 0;
+	btAlignedAllocSetCustom(countingAlloc, countingFree);
+	clock.reset();
+	bool restored = true;
+	for (int i = 0; i < numRuns; ++i)
+	{
+		restored = scene.m_world.restoreSnapshot((i & 1) ? delta : keyFrame) && restored;
+	}
+	const unsigned long long restoreTime = clock.getTimeMicroseconds();
+	btAlignedAllocSetCustom(NULL, NULL);
+	EXPECT_TRUE(restored);
+	EXPECT_EQ(0, gNumSnapshotAllocations);
+
+	clock.reset();
+	{
+		btDefaultSerializer serializer;
+		scene.m_world.serialize(&serializer);
+	}
+	const unsigned long long serializeTime = clock.getTimeMicroseconds();
+
+	printf("%d bodies, %d manifolds: capture %.3f ms (%.1f MB), delta capture %.3f ms (%d objects, %.2f MB), restore %.3f ms, btDefaultSerializer %.1f ms\n",
+		   scene.m_world.getNumCollisionObjects(), scene.m_dispatcher.getNumManifolds(),
+		   captureTime / (1000. * numRuns), keyFrame.getMemorySize() / (1024. * 1024.),
+		   deltaTime / (1000. * numRuns), delta.getNumObjectStates(), delta.getMemorySize() / (1024. * 1024.),
+		   restoreTime / (1000. * numRuns), serializeTime / 1000.);
+	EXPECT_LT(delta.getNumObjectStates(), 1100);
+	EXPECT_LT(deltaTime, captureTime);
+}
+
+int main(int argc, char** argv)
+{
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
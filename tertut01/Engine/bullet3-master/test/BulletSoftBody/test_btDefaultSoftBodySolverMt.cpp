@@ -0,0 +1,344 @@
+#include <btBulletDynamicsCommon.h>
+#include <BulletSoftBody/btSoftRigidDynamicsWorld.h>
+#include <BulletSoftBody/btSoftBodyRigidBodyCollisionConfiguration.h>
+#include <BulletSoftBody/btSoftBodyHelpers.h>
+#include <BulletSoftBody/btDefaultSoftBodySolverMt.h>
+#include <LinearMath/btQuickprof.h>
+#include <gtest/gtest.h>
+#include "btTestTaskScheduler.h"
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+
+static void hashBytes(unsigned long long& hash, const void* data, size_t size)
+{
+	const unsigned char* bytes = (const unsigned char*)data;
+	for (size_t i = 0; i < size; ++i)
+	{
+		hash = (hash ^ bytes[i]) * 1099511628211ULL;
+	}
+}
+
+// Scenes after examples/SoftDemo, on a static ground box
+struct SoftScene
+{
+	btSoftBodyRigidBodyCollisionConfiguration m_collisionConfiguration;
+	btCollisionDispatcher m_dispatcher;
+	btDbvtBroadphase m_broadphase;
+	btSequentialImpulseConstraintSolver m_solver;
+	btSoftRigidDynamicsWorld m_world;
+	btBoxShape m_groundShape;
+	btAlignedObjectArray<btCollisionShape*> m_shapes;
+	btAlignedObjectArray<btRigidBody*> m_bodies;
+
+	SoftScene(btSoftBodySolver* softBodySolver)
+		: m_dispatcher(&m_collisionConfiguration),
+		  m_world(&m_dispatcher, &m_broadphase, &m_solver, &m_collisionConfiguration, softBodySolver),
+		  m_groundShape(btVector3(50, 1, 50))
+	{
+		addRigidBody(0, btVector3(0, -1, 0), &m_groundShape);
+	}
+
+	~SoftScene()
+	{
+		for (int i = m_world.getSoftBodyArray().size() - 1; i >= 0; --i)
+		{
+			btSoftBody* psb = m_world.getSoftBodyArray()[i];
+			m_world.removeSoftBody(psb);
+			delete psb;
+		}
+		for (int i = 0; i < m_bodies.size(); ++i)
+		{
+			m_world.removeRigidBody(m_bodies[i]);
+			delete m_bodies[i];
+		}
+		for (int i = 0; i < m_shapes.size(); ++i)
+		{
+			delete m_shapes[i];
+		}
+	}
+
+	btRigidBody* addRigidBody(btScalar mass, const btVector3& origin, btCollisionShape* shape)
+	{
+		btVector3 inertia(0, 0, 0);
+		if (mass != 0)
+		{
+			shape->calculateLocalInertia(mass, inertia);
+		}
+		btRigidBody::btRigidBodyConstructionInfo info(mass, NULL, shape, inertia);
+		info.m_startWorldTransform.setOrigin(origin);
+		btRigidBody* body = new btRigidBody(info);
+		m_world.addRigidBody(body);
+		m_bodies.push_back(body);
+		return body;
+	}
+
+	btSoftBodyWorldInfo& worldInfo()
+	{
+		return m_world.getWorldInfo();
+	}
+
+	// Init_Ropes
+	void addRopes()
+	{
+		const int n = 15;
+		for (int i = 0; i < n; ++i)
+		{
+			btSoftBody* psb = btSoftBodyHelpers::CreateRope(worldInfo(), btVector3(-10, 8, i * btScalar(0.25)), btVector3(10, 8, i * btScalar(0.25)), 16, 1 + 2);
+			psb->m_cfg.piterations = 4;
+			psb->m_materials[0]->m_kLST = btScalar(0.1) + (i / (btScalar)(n - 1)) * btScalar(0.9);
+			psb->setTotalMass(20);
+			m_world.addSoftBody(psb);
+		}
+	}
+
+	// Init_RopeAttach, the ropes hang on a dynamic box and are solved in order
+	void addRopeAttach()
+	{
+		btCollisionShape* shape = new btBoxShape(btVector3(2, 6, 2));
+		m_shapes.push_back(shape);
+		btRigidBody* body = addRigidBody(50, btVector3(12, 8, 20), shape);
+		for (int i = 0; i < 2; ++i)
+		{
+			const btVector3 p(0, 8, btScalar(20 - 1 + 2 * i));
+			btSoftBody* psb = btSoftBodyHelpers::CreateRope(worldInfo(), p, p + btVector3(10, 0, 0), 8, 1);
+			psb->setTotalMass(50);
+			m_world.addSoftBody(psb);
+			psb->appendAnchor(psb->m_nodes.size() - 1, body);
+		}
+	}
+
+	// Init_Aero, without the random placement
+	void addAero(int count)
+	{
+		const btScalar s = 2;
+		const btScalar h = 10;
+		for (int i = 0; i < count; ++i)
+		{
+			btSoftBody* psb = btSoftBodyHelpers::CreatePatch(worldInfo(), btVector3(-s, h, -s), btVector3(+s, h, -s), btVector3(-s, h, +s), btVector3(+s, h, +s), 6, 6, 0, true);
+			btSoftBody::Material* pm = psb->appendMaterial();
+			psb->generateBendingConstraints(2, pm);
+			psb->m_cfg.kLF = btScalar(0.004);
+			psb->m_cfg.kDG = btScalar(0.0003);
+			psb->m_cfg.aeromodel = btSoftBody::eAeroModel::V_TwoSided;
+			btTransform trs;
+			btQuaternion rot;
+			rot.setEuler(SIMD_PI / 8 + btScalar(0.01) * (i % 7), -SIMD_PI / 7 + btScalar(0.01) * (i % 5), btScalar(0.01) * (i % 3));
+			trs.setIdentity();
+			trs.setOrigin(btVector3(btScalar((i % 10) * 5 - 25), btScalar(20 + (i / 10) * 3), btScalar(-30)));
+			trs.setRotation(rot);
+			psb->transform(trs);
+			psb->setTotalMass(btScalar(0.1));
+			psb->addForce(btVector3(0, 2, 0), 0);
+			m_world.addSoftBody(psb);
+		}
+	}
+
+	// Init_Pressure
+	void addPressure(const btVector3& center)
+	{
+		btSoftBody* psb = btSoftBodyHelpers::CreateEllipsoid(worldInfo(), center, btVector3(1, 1, 1) * 3, 512);
+		psb->m_materials[0]->m_kLST = btScalar(0.1);
+		psb->m_cfg.kDF = 1;
+		psb->m_cfg.kDP = btScalar(0.001);
+		psb->m_cfg.kPR = 2500;
+		psb->setTotalMass(30, true);
+		m_world.addSoftBody(psb);
+	}
+
+	// Init_Cloth, a patch with bending constraints pinned at the corners
+	btSoftBody* addCloth(const btVector3& center, btScalar size, int resolution)
+	{
+		const btScalar s = size / 2;
+		btSoftBody* psb = btSoftBodyHelpers::CreatePatch(worldInfo(), center + btVector3(-s, 0, -s), center + btVector3(+s, 0, -s), center + btVector3(-s, 0, +s), center + btVector3(+s, 0, +s), resolution, resolution, 1 + 2 + 4 + 8, true);
+		psb->getCollisionShape()->setMargin(btScalar(0.5));
+		btSoftBody::Material* pm = psb->appendMaterial();
+		pm->m_kLST = btScalar(0.4);
+		psb->generateBendingConstraints(2, pm);
+		psb->setTotalMass(150);
+		m_world.addSoftBody(psb);
+		return psb;
+	}
+
+	void step(int numSteps)
+	{
+		for (int i = 0; i < numSteps; ++i)
+		{
+			m_world.stepSimulation(btScalar(1. / 60.), 0);
+		}
+	}
+
+	unsigned long long hashState()
+	{
+		unsigned long long hash = 14695981039346656037ULL;
+		for (int i = 0; i < m_world.getSoftBodyArray().size(); ++i)
+		{
+			const btSoftBody* psb = m_world.getSoftBodyArray()[i];
+			for (int j = 0; j < psb->m_nodes.size(); ++j)
+			{
+				hashBytes(hash, psb->m_nodes[j].m_x.m_floats, 3 * sizeof(btScalar));
+				hashBytes(hash, psb->m_nodes[j].m_v.m_floats, 3 * sizeof(btScalar));
+			}
+		}
+		for (int i = 0; i < m_bodies.size(); ++i)
+		{
+			hashBytes(hash, m_bodies[i]->getWorldTransform().getOrigin().m_floats, 3 * sizeof(btScalar));
+		}
+		return hash;
+	}
+};
+
+static void buildSmallBodies(SoftScene& scene)
+{
+	scene.addRopes();
+	scene.addRopeAttach();
+	scene.addAero(20);
+	scene.addCloth(btVector3(20, 6, 0), 8, 9);
+}
+
+// Below the link threshold every soft body goes through btSoftBody::solveConstraints, the results are bit-identical
+TEST(BulletSoftBodyTest, MtSolverMatchesDefaultSolver)
+{
+	btThreadCountSweep sweep;
+	const int numSteps = 120;
+	unsigned long long expected = 0;
+	{
+		btDefaultSoftBodySolver solver;
+		SoftScene scene(&solver);
+		buildSmallBodies(scene);
+		scene.addPressure(btVector3(-20, 10, 0));
+		scene.step(numSteps);
+		expected = scene.hashState();
+	}
+	const int threadCounts[] = {1, 2, 4, 8};
+	for (int i = 0; i < 4; ++i)
+	{
+		const int numThreads = threadCounts[i];
+		if (!sweep.run(numThreads))
+		{
+			continue;
+		}
+		btDefaultSoftBodySolverMt solver;
+		solver.setMinBatchedLinks(INT_MAX);
+		SoftScene scene(&solver);
+		buildSmallBodies(scene);
+		scene.addPressure(btVector3(-20, 10, 0));
+		scene.step(numSteps);
+		EXPECT_EQ(expected, scene.hashState()) << numThreads << " threads";
+	}
+}
+
+struct ClothShape
+{
+	btScalar m_strain;
+	btScalar m_lowest;
+
+	ClothShape(const btSoftBody* cloth)
+	{
+		m_strain = 0;
+		int numLinks = 0;
+		for (int i = 0; i < cloth->m_links.size(); ++i)
+		{
+			const btSoftBody::Link& l = cloth->m_links[i];
+			if (!l.m_bbending)
+			{
+				m_strain += btFabs(l.m_n[0]->m_x.distance(l.m_n[1]->m_x) / l.m_rl - 1);
+				numLinks++;
+			}
+		}
+		m_strain /= numLinks;
+		m_lowest = cloth->m_nodes[0].m_x.y();
+		for (int i = 1; i < cloth->m_nodes.size(); ++i)
+		{
+			m_lowest = btMin(m_lowest, cloth->m_nodes[i].m_x.y());
+		}
+	}
+};
+
+// The coloured link order of a big cloth gives the same result for any number of threads. The sweep order differs from
+// the default solver, so the swinging cloth is compared by how far it stretches and sags.
+TEST(BulletSoftBodyTest, MtSolverBatchedLinks)
+{
+	btThreadCountSweep sweep;
+	const int numSteps = 90;
+	btScalar expectedStrain = 0;
+	btScalar expectedLowest = 0;
+	{
+		btDefaultSoftBodySolver solver;
+		SoftScene scene(&solver);
+		btSoftBody* cloth = scene.addCloth(btVector3(0, 6, 0), 16, 31);
+		scene.step(numSteps);
+		const ClothShape shape(cloth);
+		expectedStrain = shape.m_strain;
+		expectedLowest = shape.m_lowest;
+	}
+	unsigned long long firstHash = 0;
+	const int threadCounts[] = {1, 2, 4, 8};
+	for (int i = 0; i < 4; ++i)
+	{
+		const int numThreads = threadCounts[i];
+		if (!sweep.run(numThreads))
+		{
+			continue;
+		}
+		btDefaultSoftBodySolverMt solver;
+		SoftScene scene(&solver);
+		btSoftBody* cloth = scene.addCloth(btVector3(0, 6, 0), 16, 31);
+		ASSERT_GE(cloth->m_links.size(), solver.getMinBatchedLinks());
+		scene.step(numSteps);
+		const unsigned long long hash = scene.hashState();
+		if (i == 0)
+		{
+			firstHash = hash;
+			const ClothShape shape(cloth);
+			EXPECT_NEAR(expectedStrain, shape.m_strain, expectedStrain * btScalar(0.25));
+			// the cloth is 16 units wide and sags about 4 units below its corners
+			EXPECT_NEAR(expectedLowest, shape.m_lowest, btScalar(0.8));
+		}
+		EXPECT_EQ(firstHash, hash) << numThreads << " threads";
+	}
+}
+
+static unsigned long long timeSteps(btSoftBodySolver* solver, int numSteps)
+{
+	SoftScene scene(solver);
+	for (int i = 0; i < 4; ++i)
+	{
+		scene.addCloth(btVector3(btScalar(i * 20 - 30), 10, 0), 16, 48);
+	}
+	scene.addAero(50);
+	scene.addRopes();
+	scene.addPressure(btVector3(0, 12, 25));
+	scene.step(2);
+	btClock clock;
+	scene.step(numSteps);
+	return clock.getTimeMicroseconds();
+}
+
+TEST(BulletSoftBodyTest, MtSolverBenchmark)
+{
+	setUpTaskScheduler();
+	const int numSteps = 30;
+	btDefaultSoftBodySolver defaultSolver;
+	const unsigned long long defaultTime = timeSteps(&defaultSolver, numSteps);
+	printf("btDefaultSoftBodySolver: %.2f ms/step\n", defaultTime / (1000. * numSteps));
+	btThreadCountSweep sweep;
+	const int threadCounts[] = {1, 2, 4, 8, 16};
+	for (int i = 0; i < 5; ++i)
+	{
+		const int numThreads = threadCounts[i];
+		if (!sweep.runOnHardwareThreads(numThreads))
+		{
+			break;
+		}
+		btDefaultSoftBodySolverMt solver;
+		const unsigned long long time = timeSteps(&solver, numSteps);
+		printf("btDefaultSoftBodySolverMt, %d threads: %.2f ms/step (%.2fx)\n", numThreads, time / (1000. * numSteps), double(defaultTime) / double(time));
+	}
+}
+
+int main(int argc, char** argv)
+{
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
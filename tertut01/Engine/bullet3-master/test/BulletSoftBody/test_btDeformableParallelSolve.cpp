@@ -0,0 +1,403 @@
+#include <btBulletDynamicsCommon.h>
+#include <BulletSoftBody/btDeformableMultiBodyDynamicsWorld.h>
+#include <BulletSoftBody/btDeformableMultiBodyConstraintSolver.h>
+#include <BulletSoftBody/btDeformableBodySolver.h>
+#include <BulletSoftBody/btSoftBodyRigidBodyCollisionConfiguration.h>
+#include <BulletSoftBody/btSoftBodyHelpers.h>
+#include <BulletSoftBody/btDeformableGravityForce.h>
+#include <BulletSoftBody/btDeformableNeoHookeanForce.h>
+#include <BulletSoftBody/btDeformableLinearElasticityForce.h>
+#include <BulletSoftBody/btDeformableMassSpringForce.h>
+#include <LinearMath/btQuickprof.h>
+#include <gtest/gtest.h>
+#include "btTestTaskScheduler.h"
+#include <stdio.h>
+#include <string>
+
+static void hashBytes(unsigned long long& hash, const void* data, size_t size)
+{
+	const unsigned char* bytes = (const unsigned char*)data;
+	for (size_t i = 0; i < size; ++i)
+	{
+		hash = (hash ^ bytes[i]) * 1099511628211ULL;
+	}
+}
+
+// A box of n[0] x n[1] x n[2] cubes of side h, each split into 6 tetrahedra, in the TetGen format read by
+// btSoftBodyHelpers::CreateFromTetGenData
+static void createTetBoxData(const int n[3], btScalar h, const btVector3& origin, std::string& ele, std::string& node)
+{
+	char line[256];
+	const int nx = n[0] + 1, ny = n[1] + 1, nz = n[2] + 1;
+	sprintf(line, "%d 3 0 0\n", nx * ny * nz);
+	node = line;
+	for (int k = 0; k < nz; ++k)
+	{
+		for (int j = 0; j < ny; ++j)
+		{
+			for (int i = 0; i < nx; ++i)
+			{
+				sprintf(line, "%d %f %f %f\n", (k * ny + j) * nx + i,
+						double(origin.x() + i * h), double(origin.y() + j * h), double(origin.z() + k * h));
+				node += line;
+			}
+		}
+	}
+	// the 6 positively oriented tetrahedra around the diagonal from corner 0 to corner 7 of each cube
+	static const int tets[6][4] = {{0, 1, 3, 7}, {0, 1, 7, 5}, {0, 2, 7, 3}, {0, 2, 6, 7}, {0, 4, 5, 7}, {0, 4, 7, 6}};
+	sprintf(line, "%d 4 0\n", n[0] * n[1] * n[2] * 6);
+	ele = line;
+	int index = 0;
+	for (int k = 0; k < n[2]; ++k)
+	{
+		for (int j = 0; j < n[1]; ++j)
+		{
+			for (int i = 0; i < n[0]; ++i)
+			{
+				int corners[8];
+				for (int c = 0; c < 8; ++c)
+				{
+					corners[c] = ((k + ((c >> 2) & 1)) * ny + (j + ((c >> 1) & 1))) * nx + (i + (c & 1));
+				}
+				for (int t = 0; t < 6; ++t)
+				{
+					sprintf(line, "%d %d %d %d %d\n", index++, corners[tets[t][0]], corners[tets[t][1]], corners[tets[t][2]], corners[tets[t][3]]);
+					ele += line;
+				}
+			}
+		}
+	}
+}
+
+enum SceneType
+{
+	NEO_HOOKEAN_EXPLICIT,       // examples/DeformableDemo/Pinch
+	LINEAR_ELASTIC_IMPLICIT,    // examples/DeformableDemo/VolumetricDeformable
+	MASS_SPRING_CLOTH,          // examples/DeformableDemo/DeformableSelfCollision
+	NUM_SCENE_TYPES
+};
+
+static const char* sSceneNames[NUM_SCENE_TYPES] = {"NeoHookean", "LinearElasticity", "MassSpringCloth"};
+
+// Scenes after examples/DeformableDemo, dropped on a static ground box
+struct DeformableScene
+{
+	btSoftBodyRigidBodyCollisionConfiguration m_collisionConfiguration;
+	btCollisionDispatcher m_dispatcher;
+	btDbvtBroadphase m_broadphase;
+	btDeformableBodySolver m_deformableSolver;
+	btDeformableMultiBodyConstraintSolver m_solver;
+	btDeformableMultiBodyDynamicsWorld* m_world;
+	btBoxShape m_groundShape;
+	btRigidBody* m_ground;
+	btAlignedObjectArray<btDeformableLagrangianForce*> m_forces;
+
+	DeformableScene(SceneType type, int resolution, int preconditioner, bool parallel)
+		: m_dispatcher(&m_collisionConfiguration),
+		  m_groundShape(btVector3(50, 1, 50))
+	{
+		m_solver.setDeformableSolver(&m_deformableSolver);
+		m_world = new btDeformableMultiBodyDynamicsWorld(&m_dispatcher, &m_broadphase, &m_solver, &m_collisionConfiguration, &m_deformableSolver);
+		btVector3 gravity(0, -10, 0);
+		m_world->setGravity(gravity);
+		m_world->getWorldInfo().m_gravity = gravity;
+		m_world->getWorldInfo().m_sparsesdf.setDefaultVoxelsz(0.25);
+		m_world->getWorldInfo().m_sparsesdf.Reset();
+
+		btTransform groundTransform;
+		groundTransform.setIdentity();
+		groundTransform.setOrigin(btVector3(0, -1, 0));
+		btRigidBody::btRigidBodyConstructionInfo rbInfo(0, 0, &m_groundShape);
+		rbInfo.m_startWorldTransform = groundTransform;
+		m_ground = new btRigidBody(rbInfo);
+		m_ground->setFriction(1);
+		m_world->addRigidBody(m_ground);
+
+		btSoftBody* psb;
+		if (type == MASS_SPRING_CLOTH)
+		{
+			const btScalar s = 2;
+			psb = btSoftBodyHelpers::CreatePatch(m_world->getWorldInfo(), btVector3(-s, 2, -s), btVector3(s, 2, -s),
+												 btVector3(-s, 2, s), btVector3(s, 2, s), resolution, resolution, 0, true);
+			psb->getCollisionShape()->setMargin(0.05);
+			psb->generateBendingConstraints(2);
+			psb->setTotalMass(1);
+			psb->m_cfg.kDF = 0.5;
+			psb->m_cfg.collisions = btSoftBody::fCollision::SDF_RD;
+			psb->m_cfg.collisions |= btSoftBody::fCollision::SDF_RDF;
+			addForce(psb, new btDeformableMassSpringForce(100, 1, true));
+		}
+		else
+		{
+			std::string ele, node;
+			const int n[3] = {resolution, resolution / 2, resolution};
+			createTetBoxData(n, btScalar(2) / resolution, btVector3(-1, 0.5, -1), ele, node);
+			psb = btSoftBodyHelpers::CreateFromTetGenData(m_world->getWorldInfo(), ele.c_str(), 0, node.c_str(), false, true, true);
+			btSoftBodyHelpers::generateBoundaryFaces(psb);
+			psb->getCollisionShape()->setMargin(0.05);
+			psb->setTotalMass(1);
+			psb->m_cfg.kDF = 0.5;
+			psb->m_cfg.collisions = btSoftBody::fCollision::SDF_RD;
+			psb->m_cfg.collisions |= btSoftBody::fCollision::SDF_RDN;
+			if (type == NEO_HOOKEAN_EXPLICIT)
+			{
+				addForce(psb, new btDeformableNeoHookeanForce(8, 3, 0.02));
+			}
+			else
+			{
+				addForce(psb, new btDeformableLinearElasticityForce(100, 100, 0.01));
+			}
+		}
+		psb->m_cfg.kKHR = 1;
+		psb->m_cfg.kCHR = 1;
+		psb->m_sleepingThreshold = 0;
+		m_world->addSoftBody(psb);
+		addForce(psb, new btDeformableGravityForce(gravity));
+
+		m_world->setImplicit(type == LINEAR_ELASTIC_IMPLICIT);
+		m_world->setLineSearch(false);
+		m_world->setUseProjection(true);
+		if (preconditioner >= 0)
+		{
+			m_world->setPreconditioner(preconditioner);
+		}
+		m_deformableSolver.setParallelSolve(parallel);
+	}
+
+	~DeformableScene()
+	{
+		for (int i = m_world->getSoftBodyArray().size() - 1; i >= 0; --i)
+		{
+			btSoftBody* psb = m_world->getSoftBodyArray()[i];
+			m_world->removeSoftBody(psb);
+			delete psb;
+		}
+		m_world->removeRigidBody(m_ground);
+		delete m_ground;
+		delete m_world;
+		for (int i = 0; i < m_forces.size(); ++i)
+		{
+			delete m_forces[i];
+		}
+	}
+
+	void addForce(btSoftBody* psb, btDeformableLagrangianForce* force)
+	{
+		m_forces.push_back(force);
+		m_world->addForce(psb, force);
+	}
+
+	btSoftBody* getSoftBody()
+	{
+		return m_world->getSoftBodyArray()[0];
+	}
+
+	// steps the world and returns the sum of the Krylov iterations of the last linear solve of each step
+	int step(int numSteps)
+	{
+		int iterations = 0;
+		for (int i = 0; i < numSteps; ++i)
+		{
+			m_world->stepSimulation(btScalar(1) / 240, 0);
+			iterations += m_deformableSolver.getLastSolveIterations();
+		}
+		return iterations;
+	}
+
+	unsigned long long hashState()
+	{
+		unsigned long long hash = 14695981039346656037ULL;
+		btSoftBody* psb = getSoftBody();
+		for (int i = 0; i < psb->m_nodes.size(); ++i)
+		{
+			hashBytes(hash, &psb->m_nodes[i].m_x, sizeof(btVector3));
+			hashBytes(hash, &psb->m_nodes[i].m_v, sizeof(btVector3));
+		}
+		return hash;
+	}
+
+	btScalar maxDistance(DeformableScene& other)
+	{
+		btSoftBody* psb = getSoftBody();
+		btSoftBody* otherPsb = other.getSoftBody();
+		btScalar maxDist = 0;
+		for (int i = 0; i < psb->m_nodes.size(); ++i)
+		{
+			maxDist = btMax(maxDist, psb->m_nodes[i].m_x.distance(otherPsb->m_nodes[i].m_x));
+		}
+		return maxDist;
+	}
+
+	bool isValid()
+	{
+		btSoftBody* psb = getSoftBody();
+		for (int i = 0; i < psb->m_nodes.size(); ++i)
+		{
+			const btVector3& x = psb->m_nodes[i].m_x;
+			if (!(btFabs(x.x()) < 10 && x.y() > -1 && x.y() < 10 && btFabs(x.z()) < 10))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+};
+
+TEST(BulletSoftBodyTest, ParallelMultiplyMatchesSerial)
+{
+	btThreadCountSweep sweep;
+	// without threads in the build the parallel multiply still runs, on the calling thread
+	if (!sweep.run(4))
+	{
+		ASSERT_TRUE(sweep.run(1));
+	}
+	for (int type = 0; type < NUM_SCENE_TYPES; ++type)
+	{
+		DeformableScene scene(SceneType(type), 8, -1, true);
+		scene.step(30);
+		btDeformableBackwardEulerObjective* objective = scene.m_deformableSolver.m_objective;
+		ASSERT_GT(objective->m_nodes.size(), 0);
+		ASSERT_EQ(objective->m_projection.m_lagrangeMultipliers.size(), 0);
+
+		btAlignedObjectArray<btVector3> x, serial, parallel;
+		x.resize(objective->m_nodes.size());
+		serial.resize(x.size());
+		parallel.resize(x.size());
+		srand(7);
+		for (int i = 0; i < x.size(); ++i)
+		{
+			x[i].setValue(btScalar(rand()) / RAND_MAX - btScalar(0.5), btScalar(rand()) / RAND_MAX - btScalar(0.5), btScalar(rand()) / RAND_MAX - btScalar(0.5));
+		}
+		objective->setParallelMultiply(false);
+		objective->multiply(x, serial);
+		objective->setParallelMultiply(true);
+		objective->multiply(x, parallel);
+
+		btScalar maxValue = 0, maxError = 0;
+		for (int i = 0; i < x.size(); ++i)
+		{
+			maxValue = btMax(maxValue, serial[i].length());
+			maxError = btMax(maxError, serial[i].distance(parallel[i]));
+		}
+		EXPECT_GT(maxValue, 0) << sSceneNames[type];
+		EXPECT_LE(maxError, maxValue * btScalar(1e-4)) << sSceneNames[type];
+	}
+}
+
+TEST(BulletSoftBodyTest, ParallelSolveIsDeterministic)
+{
+	btThreadCountSweep sweep;
+	static const int threadCounts[] = {1, 2, 4, 8};
+	for (int type = 0; type < NUM_SCENE_TYPES; ++type)
+	{
+		unsigned long long reference = 0;
+		for (int t = 0; t < int(sizeof(threadCounts) / sizeof(threadCounts[0])); ++t)
+		{
+			if (!sweep.run(threadCounts[t]))
+			{
+				continue;
+			}
+			DeformableScene scene(SceneType(type), 6, btDeformableBackwardEulerObjective::BlockJacobi_preconditioner, true);
+			scene.step(60);
+			EXPECT_TRUE(scene.isValid()) << sSceneNames[type];
+			unsigned long long hash = scene.hashState();
+			if (t == 0)
+			{
+				reference = hash;
+			}
+			else
+			{
+				EXPECT_EQ(reference, hash) << sSceneNames[type] << " with " << threadCounts[t] << " threads";
+			}
+		}
+	}
+}
+
+TEST(BulletSoftBodyTest, BlockPreconditionersConverge)
+{
+	setUpTaskScheduler();
+	for (int type = 0; type < NUM_SCENE_TYPES; ++type)
+	{
+		// the default preconditioner of the world with projection is the mass preconditioner
+		DeformableScene reference(SceneType(type), 6, -1, false);
+		DeformableScene blockJacobi(SceneType(type), 6, btDeformableBackwardEulerObjective::BlockJacobi_preconditioner, false);
+		DeformableScene incompleteCholesky(SceneType(type), 6, btDeformableBackwardEulerObjective::IncompleteCholesky_preconditioner, false);
+		reference.step(120);
+		blockJacobi.step(120);
+		incompleteCholesky.step(120);
+		EXPECT_TRUE(reference.isValid()) << sSceneNames[type];
+		EXPECT_TRUE(blockJacobi.isValid()) << sSceneNames[type];
+		EXPECT_TRUE(incompleteCholesky.isValid()) << sSceneNames[type];
+		EXPECT_LT(blockJacobi.maxDistance(reference), 0.05) << sSceneNames[type];
+		EXPECT_LT(incompleteCholesky.maxDistance(reference), 0.05) << sSceneNames[type];
+
+		// The iterations of the steps depend on the right hand side: the mass preconditioner solves free fall in one or
+		// two iterations, as uniform velocities are in the null space of the elastic forces. Compare the
+		// preconditioners on the system of the resting body with a generic right hand side instead.
+		btDeformableBackwardEulerObjective* objective = reference.m_deformableSolver.m_objective;
+		btAlignedObjectArray<btVector3> rhs, x;
+		rhs.resize(objective->m_nodes.size());
+		x.resize(rhs.size());
+		srand(11);
+		for (int i = 0; i < rhs.size(); ++i)
+		{
+			rhs[i].setValue(btScalar(rand()) / RAND_MAX - btScalar(0.5), btScalar(rand()) / RAND_MAX - btScalar(0.5), btScalar(rand()) / RAND_MAX - btScalar(0.5));
+		}
+		objective->project(rhs);
+		Preconditioner* preconditioners[] = {objective->m_massPreconditioner, objective->m_blockJacobiPreconditioner, objective->m_incompleteCholeskyPreconditioner};
+		int iterations[3];
+		for (int p = 0; p < 3; ++p)
+		{
+			objective->m_preconditioner = preconditioners[p];
+			preconditioners[p]->reinitialize(true);
+			preconditioners[p]->update();
+			for (int i = 0; i < x.size(); ++i)
+			{
+				x[i].setZero();
+			}
+			btConjugateGradient<btDeformableBackwardEulerObjective> cg(300);
+			iterations[p] = cg.solve(*objective, x, rhs);
+		}
+		EXPECT_TRUE(objective->m_incompleteCholeskyPreconditioner->isFactorized()) << sSceneNames[type];
+		EXPECT_LE(iterations[1], iterations[0]) << sSceneNames[type];
+		EXPECT_LT(iterations[2], iterations[1]) << sSceneNames[type];
+	}
+}
+
+// Prints the Krylov iterations and the time per step of each preconditioner, serial and parallel
+TEST(BulletSoftBodyTest, ParallelSolveBenchmark)
+{
+	setUpTaskScheduler();
+	static const int preconditioners[] = {btDeformableBackwardEulerObjective::Mass_preconditioner,
+										  btDeformableBackwardEulerObjective::BlockJacobi_preconditioner,
+										  btDeformableBackwardEulerObjective::IncompleteCholesky_preconditioner};
+	static const char* preconditionerNames[] = {"Mass", "BlockJacobi", "IncompleteCholesky"};
+	const int numThreads = setNumThreads(64);
+	const int numSteps = 20;
+	printf("%-18s %-20s %8s %12s %12s\n", "scene", "preconditioner", "iters", "serial ms", "parallel ms");
+	for (int type = 0; type < NUM_SCENE_TYPES; ++type)
+	{
+		for (int p = 0; p < int(sizeof(preconditioners) / sizeof(preconditioners[0])); ++p)
+		{
+			double ms[2];
+			int iterations = 0;
+			for (int parallel = 0; parallel < 2; ++parallel)
+			{
+				DeformableScene scene(SceneType(type), 12, preconditioners[p], parallel != 0);
+				scene.step(1);
+				btClock clock;
+				iterations = scene.step(numSteps);
+				ms[parallel] = clock.getTimeMicroseconds() / 1000.0 / numSteps;
+				EXPECT_TRUE(scene.isValid()) << sSceneNames[type] << " " << preconditionerNames[p];
+			}
+			printf("%-18s %-20s %8.1f %12.3f %12.3f\n", sSceneNames[type], preconditionerNames[p], double(iterations) / numSteps, ms[0], ms[1]);
+		}
+	}
+	printf("%d threads\n", numThreads);
+}
+
+int main(int argc, char** argv)
+{
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
@@ -0,0 +1,162 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2006 Erwin Coumans  https://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef BT_TEST_TASK_SCHEDULER_H
+#define BT_TEST_TASK_SCHEDULER_H
+
+///Task scheduler set up shared by the multithreaded unit tests.
+///The default task scheduler has one thread per hardware thread, so on a machine with few cores any larger thread
+///count is clamped, and a test comparing the results of several thread counts may only ever run one of them.
+///btThreadCountSweep runs the counts a test asks for, with more threads than cores if needed, and records which ran.
+
+#include "LinearMath/btThreads.h"
+#include "LinearMath/btAlignedObjectArray.h"
+#include <gtest/gtest.h>
+#include <stdio.h>
+#include <string>
+
+///makes the default task scheduler current, with all of its threads (one per hardware thread)
+inline void setUpTaskScheduler()
+{
+#if BT_THREADSAFE
+	static btITaskScheduler* scheduler = NULL;
+	if (!scheduler)
+	{
+		scheduler = btCreateDefaultTaskScheduler();
+		if (!scheduler)
+		{
+			scheduler = btGetSequentialTaskScheduler();
+		}
+	}
+	btSetTaskScheduler(scheduler);
+	scheduler->setNumThreads(scheduler->getMaxNumThreads());
+#endif  // #if BT_THREADSAFE
+}
+
+///runs numThreads threads, or all threads of the current scheduler if it has fewer, and returns the count that runs
+inline int setNumThreads(int numThreads)
+{
+	btITaskScheduler* scheduler = btGetTaskScheduler();
+	if (!scheduler)
+	{
+		return 1;
+	}
+	scheduler->setNumThreads(btMin(numThreads, scheduler->getMaxNumThreads()));
+	return scheduler->getNumThreads();
+}
+
+///Sets the thread count for each step of a sweep over thread counts. Counts that can't run are skipped and reported,
+///the counts that ran are printed and recorded as the "threadCounts" property of the test when the sweep goes out of
+///scope, which also makes the default task scheduler current again.
+class btThreadCountSweep
+{
+public:
+	~btThreadCountSweep()
+	{
+		const std::string ran = toString(m_ran);
+		const ::testing::TestInfo* test = ::testing::UnitTest::GetInstance()->current_test_info();
+		printf("%s: ran %s thread(s)", test ? test->name() : "sweep", ran.c_str());
+		if (m_skipped.size())
+		{
+			printf(", skipped %s as the task scheduler has fewer", toString(m_skipped).c_str());
+		}
+		if (m_ran.size() < 2)
+		{
+			printf(", no thread counts were compared");
+		}
+		printf("\n");
+		::testing::Test::RecordProperty("threadCounts", ran);
+		setUpTaskScheduler();
+	}
+
+	///runs exactly numThreads threads, with a scheduler that has more threads than the machine has cores if needed, so
+	///results of different counts can be compared. Returns false when the build has no threads and numThreads > 1
+	bool run(int numThreads)
+	{
+		setUpTaskScheduler();
+#if BT_THREADSAFE
+		if (btGetTaskScheduler()->getMaxNumThreads() < numThreads)
+		{
+			btSetTaskScheduler(getWideTaskScheduler(numThreads));
+		}
+#endif  // #if BT_THREADSAFE
+		return use(numThreads);
+	}
+
+	///runs numThreads threads if the default scheduler has them, for timings, which mean little with more threads than
+	///cores. Returns false otherwise
+	bool runOnHardwareThreads(int numThreads)
+	{
+		setUpTaskScheduler();
+		return use(numThreads);
+	}
+
+	///counts that ran so far
+	const btAlignedObjectArray<int>& getThreadCounts() const
+	{
+		return m_ran;
+	}
+
+private:
+	btAlignedObjectArray<int> m_ran;
+	btAlignedObjectArray<int> m_skipped;
+
+	static std::string toString(const btAlignedObjectArray<int>& counts)
+	{
+		std::string text;
+		for (int i = 0; i < counts.size(); ++i)
+		{
+			char buffer[16];
+			sprintf(buffer, i ? " %d" : "%d", counts[i]);
+			text += buffer;
+		}
+		return text;
+	}
+
+	bool use(int numThreads)
+	{
+		btITaskScheduler* scheduler = btGetTaskScheduler();
+		const int maxNumThreads = scheduler ? scheduler->getMaxNumThreads() : 1;
+		if (numThreads > maxNumThreads)
+		{
+			m_skipped.push_back(numThreads);
+			return false;
+		}
+		if (scheduler)
+		{
+			scheduler->setNumThreads(numThreads);
+			EXPECT_EQ(numThreads, scheduler->getNumThreads());
+		}
+		m_ran.push_back(numThreads);
+		return true;
+	}
+
+#if BT_THREADSAFE
+	///a default scheduler with at least numThreads threads, kept for the other sweeps of the test program
+	static btITaskScheduler* getWideTaskScheduler(int numThreads)
+	{
+		static btITaskScheduler* scheduler = NULL;
+		if (!scheduler || scheduler->getMaxNumThreads() < numThreads)
+		{
+			// not current, setUpTaskScheduler made the default one current
+			delete scheduler;
+			scheduler = btCreateDefaultTaskScheduler(btMin(numThreads, int(BT_MAX_THREAD_COUNT)));
+		}
+		return scheduler;
+	}
+#endif  // #if BT_THREADSAFE
+};
+
+#endif  //BT_TEST_TASK_SCHEDULER_H
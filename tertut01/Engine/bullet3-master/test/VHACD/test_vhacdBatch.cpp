@@ -0,0 +1,280 @@
+#include <VHACD.h>
+#include <LinearMath/btAlignedObjectArray.h>
+#include <LinearMath/btThreads.h>
+#include <gtest/gtest.h>
+#include <math.h>
+#include <stdio.h>
+
+struct TorusMesh
+{
+	btAlignedObjectArray<float> m_points;
+	btAlignedObjectArray<double> m_pointsDouble;
+	btAlignedObjectArray<int> m_triangles;
+
+	// a torus needs several hulls, the minor radius makes meshes that decompose differently
+	TorusMesh(float minorRadius)
+	{
+		const int rings = 24;
+		const int sides = 12;
+		const float majorRadius = 1.0f;
+		for (int i = 0; i < rings; ++i)
+		{
+			const float u = 2.0f * float(M_PI) * i / rings;
+			for (int j = 0; j < sides; ++j)
+			{
+				const float v = 2.0f * float(M_PI) * j / sides;
+				const float r = majorRadius + minorRadius * cosf(v);
+				m_points.push_back(r * cosf(u));
+				m_points.push_back(r * sinf(u));
+				m_points.push_back(minorRadius * sinf(v));
+			}
+		}
+		for (int i = 0; i < m_points.size(); ++i)
+		{
+			m_pointsDouble.push_back(m_points[i]);
+		}
+		for (int i = 0; i < rings; ++i)
+		{
+			for (int j = 0; j < sides; ++j)
+			{
+				const int a = i * sides + j;
+				const int b = ((i + 1) % rings) * sides + j;
+				const int c = ((i + 1) % rings) * sides + (j + 1) % sides;
+				const int d = i * sides + (j + 1) % sides;
+				m_triangles.push_back(a);
+				m_triangles.push_back(b);
+				m_triangles.push_back(c);
+				m_triangles.push_back(a);
+				m_triangles.push_back(c);
+				m_triangles.push_back(d);
+			}
+		}
+	}
+
+	unsigned int getNumPoints() const
+	{
+		return m_points.size() / 3;
+	}
+
+	unsigned int getNumTriangles() const
+	{
+		return m_triangles.size() / 3;
+	}
+};
+
+// without the principal axes alignment the voxel grid starts at 64 cells along the thinnest side, whatever the resolution
+static VHACD::IVHACD::Parameters smallParameters()
+{
+	VHACD::IVHACD::Parameters params;
+	params.m_resolution = 20000;
+	params.m_pca = 1;
+	params.m_maxNumVerticesPerCH = 32;
+	params.m_oclAcceleration = false;
+	return params;
+}
+
+// the hull counts, points and triangles one after the other, to compare decompositions exactly
+static void appendHull(const VHACD::IVHACD::ConvexHull& ch, btAlignedObjectArray<double>& hulls)
+{
+	hulls.push_back(ch.m_nPoints);
+	hulls.push_back(ch.m_nTriangles);
+	for (unsigned int i = 0; i < 3 * ch.m_nPoints; ++i)
+	{
+		hulls.push_back(ch.m_points[i]);
+	}
+	for (unsigned int i = 0; i < 3 * ch.m_nTriangles; ++i)
+	{
+		hulls.push_back(ch.m_triangles[i]);
+	}
+}
+
+// returns the number of hulls
+static unsigned int decompose(const TorusMesh& mesh, const VHACD::IVHACD::Parameters& params, btAlignedObjectArray<double>& hulls)
+{
+	VHACD::IVHACD* vhacd = VHACD::CreateVHACD();
+	EXPECT_TRUE(vhacd->Compute(&mesh.m_points[0], 3, mesh.getNumPoints(), &mesh.m_triangles[0], 3, mesh.getNumTriangles(), params));
+	const unsigned int numHulls = vhacd->GetNConvexHulls();
+	hulls.resize(0);
+	for (unsigned int i = 0; i < numHulls; ++i)
+	{
+		VHACD::IVHACD::ConvexHull ch;
+		vhacd->GetConvexHull(i, ch);
+		appendHull(ch, hulls);
+	}
+	vhacd->Release();
+	return numHulls;
+}
+
+static void getBatchHulls(const VHACD::IVHACDBatch* batch, unsigned int mesh, btAlignedObjectArray<double>& hulls)
+{
+	hulls.resize(0);
+	for (unsigned int i = 0; i < batch->GetNConvexHulls(mesh); ++i)
+	{
+		VHACD::IVHACD::ConvexHull ch;
+		batch->GetConvexHull(mesh, i, ch);
+		appendHull(ch, hulls);
+	}
+}
+
+static void expectSameHulls(const btAlignedObjectArray<double>& expected, const btAlignedObjectArray<double>& actual)
+{
+	ASSERT_EQ(expected.size(), actual.size());
+	for (int i = 0; i < expected.size(); ++i)
+	{
+		ASSERT_EQ(expected[i], actual[i]) << "value " << i;
+	}
+}
+
+static unsigned int addMesh(VHACD::IVHACDBatch* batch, const TorusMesh& mesh, const VHACD::IVHACD::Parameters& params)
+{
+	return batch->AddMesh(&mesh.m_points[0], 3, mesh.getNumPoints(), &mesh.m_triangles[0], 3, mesh.getNumTriangles(), params);
+}
+
+TEST(VHACDTest, SerialAndThreadedDecompositionsMatch)
+{
+	const TorusMesh thin(0.2f), thick(0.4f);
+	const VHACD::IVHACD::Parameters params = smallParameters();
+
+	btSetTaskScheduler(btGetSequentialTaskScheduler());
+	btAlignedObjectArray<double> serialThin, serialThick;
+	EXPECT_GT(decompose(thin, params, serialThin), 2u);
+	EXPECT_GT(decompose(thick, params, serialThick), 2u);
+
+#if BT_THREADSAFE
+	btITaskScheduler* scheduler = btCreateDefaultTaskScheduler();
+	if (scheduler)
+	{
+		scheduler->setNumThreads(scheduler->getMaxNumThreads());
+		btSetTaskScheduler(scheduler);
+		printf("%d threads\n", scheduler->getNumThreads());
+		// the plane search of a single mesh runs on the threads
+		btAlignedObjectArray<double> threaded;
+		decompose(thin, params, threaded);
+		expectSameHulls(serialThin, threaded);
+
+		// a batch runs one mesh per thread
+		VHACD::IVHACDBatch* batch = VHACD::CreateVHACDBatch();
+		const unsigned int thinMesh = addMesh(batch, thin, params);
+		const unsigned int thickMesh = addMesh(batch, thick, params);
+		batch->Compute();
+		getBatchHulls(batch, thinMesh, threaded);
+		expectSameHulls(serialThin, threaded);
+		getBatchHulls(batch, thickMesh, threaded);
+		expectSameHulls(serialThick, threaded);
+		batch->Release();
+
+		btSetTaskScheduler(btGetSequentialTaskScheduler());
+		delete scheduler;
+	}
+#endif  // #if BT_THREADSAFE
+}
+
+TEST(VHACDTest, BatchSharesDuplicatesAndCachesResults)
+{
+	btSetTaskScheduler(btGetSequentialTaskScheduler());
+	const TorusMesh thin(0.2f), thick(0.4f);
+	const VHACD::IVHACD::Parameters params = smallParameters();
+	btAlignedObjectArray<double> expectedThin, expectedThick, actual;
+	decompose(thin, params, expectedThin);
+	decompose(thick, params, expectedThick);
+
+	VHACD::IVHACDBatch* batch = VHACD::CreateVHACDBatch();
+	addMesh(batch, thin, params);
+	addMesh(batch, thick, params);
+	// the same mesh again, given as doubles
+	batch->AddMesh(&thin.m_pointsDouble[0], 3, thin.getNumPoints(), &thin.m_triangles[0], 3, thin.getNumTriangles(), params);
+	batch->Compute();
+	EXPECT_EQ(3u, batch->GetNMeshes());
+	EXPECT_EQ(2u, batch->GetNCachedResults());
+	for (unsigned int mesh = 0; mesh < 3; ++mesh)
+	{
+		EXPECT_FALSE(batch->IsCached(mesh));
+	}
+	EXPECT_GT(batch->GetComputeTime(0), 0.0);
+	EXPECT_EQ(0.0, batch->GetComputeTime(2));
+	getBatchHulls(batch, 0, actual);
+	expectSameHulls(expectedThin, actual);
+	getBatchHulls(batch, 1, actual);
+	expectSameHulls(expectedThick, actual);
+	getBatchHulls(batch, 2, actual);
+	expectSameHulls(expectedThin, actual);
+
+	// a second Compute takes both from the cache, other parameters decompose again
+	batch->Clear();
+	VHACD::IVHACD::Parameters otherParams = params;
+	otherParams.m_maxNumVerticesPerCH = 16;
+	addMesh(batch, thick, params);
+	addMesh(batch, thin, params);
+	addMesh(batch, thin, otherParams);
+	batch->Compute();
+	EXPECT_TRUE(batch->IsCached(0));
+	EXPECT_TRUE(batch->IsCached(1));
+	EXPECT_FALSE(batch->IsCached(2));
+	EXPECT_EQ(0.0, batch->GetComputeTime(0));
+	EXPECT_EQ(0.0, batch->GetComputeTime(1));
+	EXPECT_EQ(3u, batch->GetNCachedResults());
+	getBatchHulls(batch, 0, actual);
+	expectSameHulls(expectedThick, actual);
+	getBatchHulls(batch, 1, actual);
+	expectSameHulls(expectedThin, actual);
+
+	batch->ClearCache();
+	EXPECT_EQ(0u, batch->GetNCachedResults());
+	batch->Release();
+}
+
+TEST(VHACDTest, BatchWavesRespectMemoryBudget)
+{
+	btSetTaskScheduler(btGetSequentialTaskScheduler());
+	const TorusMesh meshes[] = {TorusMesh(0.15f), TorusMesh(0.2f), TorusMesh(0.3f), TorusMesh(0.4f)};
+	const int numMeshes = sizeof(meshes) / sizeof(meshes[0]);
+	const VHACD::IVHACD::Parameters params = smallParameters();
+	VHACD::IVHACDBatch* batch = VHACD::CreateVHACDBatch();
+	const size_t meshMemory = batch->EstimateMemory(meshes[0].getNumPoints(), meshes[0].getNumTriangles(), params);
+
+	btAlignedObjectArray<double> expected[numMeshes];
+	// no budget, budget for two and a half meshes, budget below a single mesh
+	const size_t budgets[] = {0, meshMemory * 5 / 2, meshMemory / 2};
+	const unsigned int expectedWaves[] = {1, 2, 4};
+	for (int run = 0; run < 3; ++run)
+	{
+		batch->ClearCache();
+		batch->SetMemoryBudget(budgets[run]);
+		for (int i = 0; i < numMeshes; ++i)
+		{
+			addMesh(batch, meshes[i], params);
+		}
+		batch->Compute();
+		EXPECT_EQ(expectedWaves[run], batch->GetNWaves()) << "budget " << budgets[run];
+		if (budgets[run] >= meshMemory)
+		{
+			EXPECT_LE(batch->GetMaxWaveMemory(), budgets[run]);
+		}
+		else if (budgets[run] > 0)
+		{
+			// a mesh over budget runs alone
+			EXPECT_EQ(meshMemory, batch->GetMaxWaveMemory());
+		}
+		// the waves don't change the hulls
+		for (int i = 0; i < numMeshes; ++i)
+		{
+			btAlignedObjectArray<double> actual;
+			getBatchHulls(batch, i, actual);
+			if (run == 0)
+			{
+				expected[i] = actual;
+			}
+			else
+			{
+				expectSameHulls(expected[i], actual);
+			}
+		}
+	}
+	batch->Release();
+}
+
+int main(int argc, char** argv)
+{
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
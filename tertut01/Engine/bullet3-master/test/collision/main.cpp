@@ -32,6 +32,14 @@ subject to the following restrictions:
 #include "BulletCollision/NarrowPhaseCollision/btComputeGjkEpaPenetration.h"
 #include "BulletCollision/NarrowPhaseCollision/btGjkEpa3.h"
 #include "BulletCollision/NarrowPhaseCollision/btMprPenetration.h"
+#include "BulletCollision/BroadphaseCollision/btDbvt.h"
+#include "BulletCollision/BroadphaseCollision/btDbvtBroadphase.h"
+#include "BulletCollision/BroadphaseCollision/btOpenAddressingPairCache.h"
+#include "BulletCollision/CollisionShapes/btBvhTriangleMeshShape.h"
+#include "BulletCollision/CollisionShapes/btTriangleIndexVertexArray.h"
+#include "LinearMath/btMappedFile.h"
+#include "LinearMath/btQuickprof.h"
+#include "../../examples/Benchmarks/landscapeData.h"
 
 namespace {
 
@@ -294,6 +302,970 @@ TEST(BulletCollisionTest, Heightfield_ProcessAllTriangles_FiltersByUpAxis)
 	EXPECT_EQ(triangles.size(), 0);
 }
 
+
+// Random boxes in a cube, a mix of small and larger ones like a level of props and buildings
+static void randomVolumes(int count, unsigned int seed, btAlignedObjectArray<btDbvtVolume>& volumes)
+{
+	srand(seed);
+	volumes.resize(count);
+	for (int i = 0; i < count; ++i)
+	{
+		const btVector3 center(rand() % 1000, rand() % 1000, rand() % 1000);
+		const btVector3 extents(1 + rand() % 10, 1 + rand() % 10, 1 + rand() % (i % 10 ? 10 : 50));
+		volumes[i] = btDbvtVolume::FromCE(center, extents);
+	}
+}
+
+// Checks parents and that every internal volume holds both children, returns the number of leaves
+static int checkTree(const btDbvtNode* node, const btDbvtNode* parent)
+{
+	EXPECT_EQ(node->parent, parent);
+	if (node->isleaf())
+		return 1;
+	EXPECT_TRUE(node->volume.Contain(node->childs[0]->volume));
+	EXPECT_TRUE(node->volume.Contain(node->childs[1]->volume));
+	return checkTree(node->childs[0], node) + checkTree(node->childs[1], node);
+}
+
+struct CollectLeaves : btDbvt::ICollide
+{
+	btAlignedObjectArray<int> hits;
+	void Process(const btDbvtNode* leaf) { hits.push_back(leaf->dataAsInt); }
+};
+
+static void queryTree(const btDbvt& tree, const btDbvtVolume& volume, CollectLeaves& collide)
+{
+	collide.hits.resize(0);
+	tree.collideTV(tree.m_root, volume, collide);
+	collide.hits.quickSort(std::less<int>());
+}
+
+// The number of volumes a query tests against, which is what the tree quality decides
+static int queryCost(const btDbvtNode* node, const btDbvtVolume& volume)
+{
+	if (!Intersect(node->volume, volume) || node->isleaf())
+		return 1;
+	return 1 + queryCost(node->childs[0], volume) + queryCost(node->childs[1], volume);
+}
+
+TEST(BulletCollisionTest, Dbvt_InsertBulk_MatchesIncrementalInsert)
+{
+	btAlignedObjectArray<btDbvtVolume> volumes;
+	randomVolumes(3000, 1234, volumes);
+	btAlignedObjectArray<void*> data;
+	for (int i = 0; i < volumes.size(); ++i)
+		data.push_back((void*)(size_t)i);
+
+	btDbvt incremental;
+	for (int i = 0; i < volumes.size(); ++i)
+		incremental.insert(volumes[i], data[i]);
+
+	// half of the leaves go in first to check that insertBulk keeps the existing ones
+	btDbvt bulk;
+	btAlignedObjectArray<btDbvtNode*> leaves;
+	leaves.resize(volumes.size());
+	const int half = volumes.size() / 2;
+	bulk.insertBulk(&volumes[0], &data[0], half, &leaves[0]);
+	bulk.insertBulk(&volumes[half], &data[half], volumes.size() - half, &leaves[half]);
+	EXPECT_EQ(bulk.m_leaves, volumes.size());
+	EXPECT_EQ(checkTree(bulk.m_root, 0), volumes.size());
+	for (int i = 0; i < leaves.size(); ++i)
+		EXPECT_EQ(leaves[i]->dataAsInt, i);
+
+	btAlignedObjectArray<btDbvtVolume> queries;
+	randomVolumes(200, 5678, queries);
+	int incrementalCost = 0;
+	int bulkCost = 0;
+	for (int i = 0; i < queries.size(); ++i)
+	{
+		CollectLeaves expected, actual;
+		queryTree(incremental, queries[i], expected);
+		queryTree(bulk, queries[i], actual);
+		ASSERT_EQ(expected.hits.size(), actual.hits.size());
+		for (int j = 0; j < expected.hits.size(); ++j)
+			EXPECT_EQ(expected.hits[j], actual.hits[j]);
+		incrementalCost += queryCost(incremental.m_root, queries[i]);
+		bulkCost += queryCost(bulk.m_root, queries[i]);
+	}
+	// the point of the SAH build, queries touch fewer nodes
+	EXPECT_LT(bulkCost, incrementalCost);
+
+	// removing and updating leaves of a bulk built tree works as usual
+	for (int i = 0; i < leaves.size(); i += 3)
+		bulk.remove(leaves[i]);
+	for (int i = 1; i < leaves.size(); i += 3)
+		bulk.update(leaves[i], queries[i % queries.size()]);
+	EXPECT_EQ(checkTree(bulk.m_root, 0), bulk.m_leaves);
+}
+
+TEST(BulletCollisionTest, Dbvt_Refit_AfterMovingLeaves)
+{
+	btAlignedObjectArray<btDbvtVolume> volumes;
+	randomVolumes(2000, 4321, volumes);
+	btDbvt tree;
+	btAlignedObjectArray<btDbvtNode*> leaves;
+	for (int i = 0; i < volumes.size(); ++i)
+		leaves.push_back(tree.insert(volumes[i], (void*)(size_t)i));
+
+	btAlignedObjectArray<btDbvtVolume> moved;
+	randomVolumes(volumes.size(), 8765, moved);
+	for (int i = 0; i < leaves.size(); ++i)
+		leaves[i]->volume = moved[i];
+	tree.refit();
+	EXPECT_EQ(checkTree(tree.m_root, 0), volumes.size());
+
+	// the same overlaps as a brute force search over the moved volumes
+	btAlignedObjectArray<btDbvtVolume> queries;
+	randomVolumes(100, 1111, queries);
+	for (int i = 0; i < queries.size(); ++i)
+	{
+		CollectLeaves collide;
+		queryTree(tree, queries[i], collide);
+		btAlignedObjectArray<int> expected;
+		for (int j = 0; j < moved.size(); ++j)
+		{
+			if (Intersect(moved[j], queries[i]))
+				expected.push_back(j);
+		}
+		ASSERT_EQ(expected.size(), collide.hits.size());
+		for (int j = 0; j < expected.size(); ++j)
+			EXPECT_EQ(expected[j], collide.hits[j]);
+	}
+}
+
+// Moves every box a little and finds the pairs of boxes that really overlap
+static void moveAndCollectPairs(btDbvtBroadphase& broadphase, bool batched, btAlignedObjectArray<int>& pairs)
+{
+	btAlignedObjectArray<btDbvtVolume> volumes;
+	randomVolumes(1000, 2468, volumes);
+	btAlignedObjectArray<btBroadphaseProxy*> proxies;
+	for (int i = 0; i < volumes.size(); ++i)
+		proxies.push_back(broadphase.createProxy(volumes[i].Mins(), volumes[i].Maxs(), 0, (void*)(size_t)i, 1, 1, 0));
+
+	btAlignedObjectArray<btVector3> mins, maxs;
+	for (int step = 0; step < 20; ++step)
+	{
+		mins.resize(0);
+		maxs.resize(0);
+		for (int i = 0; i < proxies.size(); ++i)
+		{
+			// a few boxes teleport, the others drift
+			const btVector3 offset = i % 50 == step ? btVector3(300, 0, 0) : btVector3(btScalar(0.5) * step, 0, btScalar(0.25) * (i % 3));
+			mins.push_back(volumes[i].Mins() + offset);
+			maxs.push_back(volumes[i].Maxs() + offset);
+		}
+		if (batched)
+		{
+			broadphase.setAabbs(&proxies[0], &mins[0], &maxs[0], proxies.size(), 0);
+		}
+		else
+		{
+			for (int i = 0; i < proxies.size(); ++i)
+				broadphase.setAabb(proxies[i], mins[i], maxs[i], 0);
+		}
+		broadphase.calculateOverlappingPairs(0);
+	}
+	EXPECT_EQ(checkTree(broadphase.m_sets[0].m_root, 0), broadphase.m_sets[0].m_leaves);
+
+	// the pair cache may still hold pairs that stopped overlapping, those are removed a few per frame
+	btBroadphasePairArray& pairArray = broadphase.getOverlappingPairCache()->getOverlappingPairArray();
+	pairs.resize(0);
+	for (int i = 0; i < pairArray.size(); ++i)
+	{
+		const int a = (int)(size_t)pairArray[i].m_pProxy0->m_clientObject;
+		const int b = (int)(size_t)pairArray[i].m_pProxy1->m_clientObject;
+		if (TestAabbAgainstAabb2(mins[a], maxs[a], mins[b], maxs[b]))
+			pairs.push_back(btMin(a, b) * proxies.size() + btMax(a, b));
+	}
+	pairs.quickSort(std::less<int>());
+	int numExpected = 0;
+	for (int a = 0; a < proxies.size(); ++a)
+	{
+		for (int b = a + 1; b < proxies.size(); ++b)
+		{
+			if (TestAabbAgainstAabb2(mins[a], maxs[a], mins[b], maxs[b]))
+				++numExpected;
+		}
+	}
+	EXPECT_EQ(pairs.size(), numExpected);
+
+	for (int i = 0; i < proxies.size(); ++i)
+		broadphase.destroyProxy(proxies[i], 0);
+}
+
+TEST(BulletCollisionTest, DbvtBroadphase_SetAabbs_MatchesSetAabb)
+{
+	btDbvtBroadphase single, batched;
+	btAlignedObjectArray<int> expected, actual;
+	moveAndCollectPairs(single, false, expected);
+	moveAndCollectPairs(batched, true, actual);
+	EXPECT_GT(expected.size(), 0);
+	ASSERT_EQ(expected.size(), actual.size());
+	for (int i = 0; i < expected.size(); ++i)
+		EXPECT_EQ(expected[i], actual[i]);
+}
+
+// Teleports every 20th box far away and sums the query costs around the boxes left behind and in the gap
+static void teleportAndQuery(btDbvtBroadphase& broadphase, bool batched, int& costNear, int& costBetween)
+{
+	btAlignedObjectArray<btDbvtVolume> volumes;
+	randomVolumes(1000, 1357, volumes);
+	btAlignedObjectArray<btBroadphaseProxy*> proxies;
+	btAlignedObjectArray<btVector3> mins, maxs;
+	for (int i = 0; i < volumes.size(); ++i)
+	{
+		proxies.push_back(broadphase.createProxy(volumes[i].Mins(), volumes[i].Maxs(), 0, (void*)(size_t)i, 1, 1, 0));
+		mins.push_back(volumes[i].Mins());
+		maxs.push_back(volumes[i].Maxs());
+	}
+
+	const btVector3 jump(100000, 0, 0);
+	for (int i = 0; i < proxies.size(); i += 20)
+	{
+		mins[i] += jump;
+		maxs[i] += jump;
+	}
+	if (batched)
+	{
+		broadphase.setAabbs(&proxies[0], &mins[0], &maxs[0], proxies.size(), 0);
+	}
+	else
+	{
+		for (int i = 0; i < proxies.size(); ++i)
+			broadphase.setAabb(proxies[i], mins[i], maxs[i], 0);
+	}
+	EXPECT_EQ(checkTree(broadphase.m_sets[0].m_root, 0), proxies.size());
+	for (int i = 0; i < proxies.size(); i += 20)
+		EXPECT_TRUE(((btDbvtProxy*)proxies[i])->leaf->volume.Contain(btDbvtVolume::FromMM(mins[i], maxs[i])));
+
+	btAlignedObjectArray<btDbvtVolume> queries;
+	randomVolumes(200, 9753, queries);
+	costNear = 0;
+	costBetween = 0;
+	for (int i = 0; i < queries.size(); ++i)
+	{
+		costNear += queryCost(broadphase.m_sets[0].m_root, queries[i]);
+		const btDbvtVolume between = btDbvtVolume::FromMM(queries[i].Mins() + jump / 2, queries[i].Maxs() + jump / 2);
+		costBetween += queryCost(broadphase.m_sets[0].m_root, between);
+	}
+
+	for (int i = 0; i < proxies.size(); ++i)
+		broadphase.destroyProxy(proxies[i], 0);
+}
+
+TEST(BulletCollisionTest, DbvtBroadphase_SetAabbs_TeleportKeepsQueriesCheap)
+{
+	btDbvtBroadphase single, batched;
+	int singleNear, singleBetween, batchedNear, batchedBetween;
+	teleportAndQuery(single, false, singleNear, singleBetween);
+	teleportAndQuery(batched, true, batchedNear, batchedBetween);
+	// grown in place, the ancestors of the teleported leaves would span the jump and queries would walk into them
+	EXPECT_LT(batchedNear, singleNear * 5 / 4);
+	EXPECT_LT(batchedBetween, singleBetween * 5 / 4);
+}
+
+static void makeProxies(int count, btAlignedObjectArray<btBroadphaseProxy>& proxies)
+{
+	proxies.resize(count);
+	for (int i = 0; i < count; ++i)
+	{
+		proxies[i].m_uniqueId = i + 2;
+		proxies[i].m_collisionFilterGroup = 1;
+		proxies[i].m_collisionFilterMask = 1;
+		proxies[i].m_clientObject = (void*)(size_t)i;
+	}
+}
+
+// a pair of different proxies in random order, as the broadphase reports them
+static void randomPair(btAlignedObjectArray<btBroadphaseProxy>& proxies, btBroadphaseProxy*& proxy0, btBroadphaseProxy*& proxy1)
+{
+	const int a = rand() % proxies.size();
+	const int b = (a + 1 + rand() % (proxies.size() - 1)) % proxies.size();
+	proxy0 = &proxies[a];
+	proxy1 = &proxies[b];
+}
+
+static void expectSamePairs(btOverlappingPairCache& expected, btOverlappingPairCache& actual)
+{
+	btBroadphasePairArray& expectedPairs = expected.getOverlappingPairArray();
+	btBroadphasePairArray& actualPairs = actual.getOverlappingPairArray();
+	ASSERT_EQ(expectedPairs.size(), actualPairs.size());
+	for (int i = 0; i < expectedPairs.size(); ++i)
+	{
+		ASSERT_EQ(expectedPairs[i].m_pProxy0, actualPairs[i].m_pProxy0) << "pair " << i;
+		ASSERT_EQ(expectedPairs[i].m_pProxy1, actualPairs[i].m_pProxy1) << "pair " << i;
+	}
+}
+
+struct RemoveEveryThirdPair : public btOverlapCallback
+{
+	int m_count;
+	RemoveEveryThirdPair() : m_count(0) {}
+	bool processOverlap(btBroadphasePair& /*pair*/) BT_OVERRIDE
+	{
+		return (m_count++ % 3) == 0;
+	}
+};
+
+TEST(BulletCollisionTest, OpenAddressingPairCache_MatchesHashedPairCache)
+{
+	btAlignedObjectArray<btBroadphaseProxy> proxies;
+	makeProxies(300, proxies);
+	btHashedOverlappingPairCache hashed;
+	btOpenAddressingPairCache open;
+	srand(1234);
+	for (int i = 0; i < 20000; ++i)
+	{
+		btBroadphaseProxy *proxy0, *proxy1;
+		randomPair(proxies, proxy0, proxy1);
+		// mostly adds, so the tables grow, with enough removals to shift entries back
+		const int op = rand() % 8;
+		if (op < 5)
+		{
+			btBroadphasePair* expected = hashed.addOverlappingPair(proxy0, proxy1);
+			btBroadphasePair* actual = open.addOverlappingPair(proxy0, proxy1);
+			ASSERT_EQ(expected - hashed.getOverlappingPairArrayPtr(), actual - open.getOverlappingPairArrayPtr());
+		}
+		else if (op < 7)
+		{
+			hashed.removeOverlappingPair(proxy0, proxy1, 0);
+			open.removeOverlappingPair(proxy0, proxy1, 0);
+		}
+		else
+		{
+			btBroadphasePair* expected = hashed.findPair(proxy0, proxy1);
+			btBroadphasePair* actual = open.findPair(proxy0, proxy1);
+			ASSERT_EQ(expected == 0, actual == 0);
+			if (expected)
+			{
+				ASSERT_EQ(expected - hashed.getOverlappingPairArrayPtr(), actual - open.getOverlappingPairArrayPtr());
+			}
+		}
+	}
+	EXPECT_GT(open.getNumOverlappingPairs(), 1000);
+	expectSamePairs(hashed, open);
+
+	RemoveEveryThirdPair hashedCallback, openCallback;
+	hashed.processAllOverlappingPairs(&hashedCallback, 0);
+	open.processAllOverlappingPairs(&openCallback, 0);
+	expectSamePairs(hashed, open);
+
+	hashed.removeOverlappingPairsContainingProxy(&proxies[7], 0);
+	open.removeOverlappingPairsContainingProxy(&proxies[7], 0);
+	expectSamePairs(hashed, open);
+
+	// btHashedOverlappingPairCache only exposes it through the interface
+	static_cast<btOverlappingPairCache&>(hashed).sortOverlappingPairs(0);
+	open.sortOverlappingPairs(0);
+	expectSamePairs(hashed, open);
+	for (int i = 0; i < open.getNumOverlappingPairs(); ++i)
+	{
+		btBroadphasePair& pair = open.getOverlappingPairArray()[i];
+		EXPECT_EQ(open.findPair(pair.m_pProxy1, pair.m_pProxy0), &pair);
+	}
+}
+
+struct ConcurrentPairAdder : public btIParallelForBody
+{
+	btOpenAddressingPairCache* m_cache;
+	const btAlignedObjectArray<btBroadphaseProxy*>* m_pairs;
+	void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
+	{
+		for (int i = iBegin; i < iEnd; ++i)
+		{
+			m_cache->addOverlappingPairConcurrent((*m_pairs)[i * 2], (*m_pairs)[i * 2 + 1]);
+		}
+	}
+};
+
+static void addConcurrently(btOpenAddressingPairCache& cache, const btAlignedObjectArray<btBroadphaseProxy*>& pairs)
+{
+	ConcurrentPairAdder adder;
+	adder.m_cache = &cache;
+	adder.m_pairs = &pairs;
+#if BT_THREADSAFE
+	if (btGetTaskScheduler() && btGetTaskScheduler()->getNumThreads() > 1)
+		btParallelFor(0, pairs.size() / 2, 64, adder);
+	else
+#endif
+		adder.forLoop(0, pairs.size() / 2);
+	cache.flushConcurrentPairs();
+}
+
+TEST(BulletCollisionTest, OpenAddressingPairCache_ConcurrentAddIsDeterministic)
+{
+#if BT_THREADSAFE
+	if (!btGetTaskScheduler())
+	{
+		btITaskScheduler* scheduler = btCreateDefaultTaskScheduler();
+		btSetTaskScheduler(scheduler ? scheduler : btGetSequentialTaskScheduler());
+	}
+#endif
+	btAlignedObjectArray<btBroadphaseProxy> proxies;
+	makeProxies(500, proxies);
+	srand(4321);
+	btAlignedObjectArray<btBroadphaseProxy*> pairs;
+	for (int i = 0; i < 20000; ++i)
+	{
+		btBroadphaseProxy *proxy0, *proxy1;
+		randomPair(proxies, proxy0, proxy1);
+		pairs.push_back(proxy0);
+		pairs.push_back(proxy1);
+	}
+	btOpenAddressingPairCache expected;
+	addConcurrently(expected, pairs);
+	EXPECT_GT(expected.getNumOverlappingPairs(), 10000);
+
+	// the same pairs found in another order, and some found again next frame
+	for (int i = pairs.size() / 2 - 1; i > 0; --i)
+	{
+		const int j = rand() % (i + 1);
+		btSwap(pairs[i * 2], pairs[j * 2]);
+		btSwap(pairs[i * 2 + 1], pairs[j * 2 + 1]);
+		if (rand() % 2)
+			btSwap(pairs[i * 2], pairs[i * 2 + 1]);
+	}
+	btOpenAddressingPairCache actual;
+	addConcurrently(actual, pairs);
+	expectSamePairs(expected, actual);
+	addConcurrently(actual, pairs);
+	expectSamePairs(expected, actual);
+	for (int i = 0; i < pairs.size(); i += 2)
+		EXPECT_TRUE(actual.findPair(pairs[i], pairs[i + 1]) != 0);
+}
+
+template <class T>
+static void pairCacheThroughput(const char* name, const btAlignedObjectArray<btBroadphaseProxy*>& pairs)
+{
+	T cache;
+	const int numPairs = pairs.size() / 2;
+	btClock clock;
+	for (int i = 0; i < numPairs; ++i)
+		cache.addOverlappingPair(pairs[i * 2], pairs[i * 2 + 1]);
+	const unsigned long addTime = clock.getTimeMicroseconds();
+	clock.reset();
+	// the broadphase reports most pairs again every frame
+	for (int i = 0; i < numPairs; ++i)
+		cache.addOverlappingPair(pairs[i * 2], pairs[i * 2 + 1]);
+	const unsigned long addAgainTime = clock.getTimeMicroseconds();
+	clock.reset();
+	int found = 0;
+	for (int i = numPairs - 1; i >= 0; --i)
+		found += cache.findPair(pairs[i * 2 + 1], pairs[i * 2]) != 0;
+	const unsigned long findTime = clock.getTimeMicroseconds();
+	clock.reset();
+	for (int i = 0; i < numPairs; i += 2)
+		cache.removeOverlappingPair(pairs[i * 2], pairs[i * 2 + 1], 0);
+	const unsigned long removeTime = clock.getTimeMicroseconds();
+	EXPECT_EQ(found, numPairs);
+	EXPECT_EQ(cache.getNumOverlappingPairs(), numPairs / 2);
+	printf("%s: %d pairs, add %lu us, add again %lu us, find %lu us, remove half %lu us\n", name, numPairs, addTime, addAgainTime, findTime, removeTime);
+}
+
+TEST(BulletCollisionTest, OpenAddressingPairCache_Throughput)
+{
+	// one million unique pairs between 4096 proxies
+	btAlignedObjectArray<btBroadphaseProxy> proxies;
+	makeProxies(4096, proxies);
+	btAlignedObjectArray<btBroadphaseProxy*> pairs;
+	for (int a = 0; a < proxies.size(); ++a)
+	{
+		for (int k = 1; k <= 244; ++k)
+		{
+			const int b = (a + k * 7) % proxies.size();
+			pairs.push_back(&proxies[a]);
+			pairs.push_back(&proxies[b]);
+		}
+	}
+	srand(99);
+	for (int i = pairs.size() / 2 - 1; i > 0; --i)
+	{
+		const int j = rand() % (i + 1);
+		btSwap(pairs[i * 2], pairs[j * 2]);
+		btSwap(pairs[i * 2 + 1], pairs[j * 2 + 1]);
+	}
+	pairCacheThroughput<btHashedOverlappingPairCache>("btHashedOverlappingPairCache", pairs);
+	pairCacheThroughput<btOpenAddressingPairCache>("btOpenAddressingPairCache", pairs);
+}
+
+static btScalar* LandscapeVtx[] = {Landscape01Vtx, Landscape02Vtx, Landscape03Vtx, Landscape04Vtx, Landscape05Vtx, Landscape06Vtx, Landscape07Vtx, Landscape08Vtx};
+static unsigned short* LandscapeIdx[] = {Landscape01Idx, Landscape02Idx, Landscape03Idx, Landscape04Idx, Landscape05Idx, Landscape06Idx, Landscape07Idx, Landscape08Idx};
+static int LandscapeVtxCount[] = {Landscape01VtxCount, Landscape02VtxCount, Landscape03VtxCount, Landscape04VtxCount, Landscape05VtxCount, Landscape06VtxCount, Landscape07VtxCount, Landscape08VtxCount};
+static int LandscapeIdxCount[] = {Landscape01IdxCount, Landscape02IdxCount, Landscape03IdxCount, Landscape04IdxCount, Landscape05IdxCount, Landscape06IdxCount, Landscape07IdxCount, Landscape08IdxCount};
+
+// the eight landscape patches of the benchmark demo as the parts of one mesh
+static void makeLandscape(btTriangleIndexVertexArray& mesh)
+{
+	for (int i = 0; i < 8; ++i)
+	{
+		btIndexedMesh part;
+		part.m_vertexBase = (const unsigned char*)LandscapeVtx[i];
+		part.m_vertexStride = sizeof(btScalar) * 3;
+		part.m_numVertices = LandscapeVtxCount[i];
+		part.m_triangleIndexBase = (const unsigned char*)LandscapeIdx[i];
+		part.m_triangleIndexStride = sizeof(short) * 3;
+		part.m_numTriangles = LandscapeIdxCount[i] / 3;
+		part.m_indexType = PHY_SHORT;
+		mesh.addIndexedMesh(part, PHY_SHORT);
+	}
+}
+
+struct CollectNodes : public btNodeOverlapCallback
+{
+	btAlignedObjectArray<int> hits;
+	void processNode(int subPart, int triangleIndex) BT_OVERRIDE
+	{
+		hits.push_back(subPart * 100000 + triangleIndex);
+	}
+};
+
+struct CollectTriangles : public btTriangleCallback
+{
+	btAlignedObjectArray<int> hits;
+	void processTriangle(btVector3* triangle, int partId, int triangleIndex) BT_OVERRIDE
+	{
+		hits.push_back(partId * 100000 + triangleIndex);
+	}
+};
+
+// returns the number of leaves below nodeIndex after checking escape indices and that every node contains its children
+static int checkQuantizedTree(const QuantizedNodeArray& nodes, int nodeIndex)
+{
+	const btQuantizedBvhNode& node = nodes[nodeIndex];
+	if (node.isLeafNode())
+		return 1;
+	const int left = nodeIndex + 1;
+	const int right = left + (nodes[left].isLeafNode() ? 1 : nodes[left].getEscapeIndex());
+	for (int child = left; child != -1; child = (child == left ? right : -1))
+	{
+		for (int i = 0; i < 3; ++i)
+		{
+			EXPECT_LE(node.m_quantizedAabbMin[i], nodes[child].m_quantizedAabbMin[i]);
+			EXPECT_GE(node.m_quantizedAabbMax[i], nodes[child].m_quantizedAabbMax[i]);
+		}
+	}
+	const int numLeaves = checkQuantizedTree(nodes, left) + checkQuantizedTree(nodes, right);
+	EXPECT_EQ(node.getEscapeIndex(), 2 * numLeaves - 1);
+	return numLeaves;
+}
+
+// The number of nodes a query tests against, which is what the tree quality decides
+static int quantizedQueryCost(const QuantizedNodeArray& nodes, int nodeIndex, const unsigned short* queryMin, const unsigned short* queryMax)
+{
+	const btQuantizedBvhNode& node = nodes[nodeIndex];
+	if (!testQuantizedAabbAgainstQuantizedAabb(queryMin, queryMax, node.m_quantizedAabbMin, node.m_quantizedAabbMax) || node.isLeafNode())
+		return 1;
+	const int left = nodeIndex + 1;
+	const int right = left + (nodes[left].isLeafNode() ? 1 : nodes[left].getEscapeIndex());
+	return 1 + quantizedQueryCost(nodes, left, queryMin, queryMax) + quantizedQueryCost(nodes, right, queryMin, queryMax);
+}
+
+static void randomQueries(const btVector3& aabbMin, const btVector3& aabbMax, int count, btAlignedObjectArray<btVector3>& queries)
+{
+	srand(2468);
+	const btVector3 size = aabbMax - aabbMin;
+	for (int i = 0; i < count; ++i)
+	{
+		const btVector3 p(aabbMin.x() + size.x() * rand() / RAND_MAX, aabbMin.y() + size.y() * rand() / RAND_MAX, aabbMin.z() + size.z() * rand() / RAND_MAX);
+		const btVector3 q(aabbMin.x() + size.x() * rand() / RAND_MAX, aabbMin.y() + size.y() * rand() / RAND_MAX, aabbMin.z() + size.z() * rand() / RAND_MAX);
+		queries.push_back(p);
+		queries.push_back(q);
+	}
+}
+
+static void expectSameHits(btAlignedObjectArray<int>& expected, btAlignedObjectArray<int>& actual)
+{
+	expected.quickSort(std::less<int>());
+	actual.quickSort(std::less<int>());
+	ASSERT_EQ(expected.size(), actual.size());
+	for (int i = 0; i < expected.size(); ++i)
+		EXPECT_EQ(expected[i], actual[i]);
+}
+
+TEST(BulletCollisionTest, QuantizedBvh_SAHMatchesMeanSplit)
+{
+	btTriangleIndexVertexArray mesh;
+	makeLandscape(mesh);
+	btVector3 aabbMin, aabbMax;
+	mesh.calculateAabbBruteForce(aabbMin, aabbMax);
+
+	btClock clock;
+	btOptimizedBvh meanSplit;
+	meanSplit.build(&mesh, true, aabbMin, aabbMax);
+	const unsigned long meanSplitBuildTime = clock.getTimeMicroseconds();
+	clock.reset();
+	btOptimizedBvh sah;
+	sah.build(&mesh, true, aabbMin, aabbMax, true);
+	const unsigned long sahBuildTime = clock.getTimeMicroseconds();
+
+	// same format: a node per leaf and per split, in depth first order, with headers for the small subtrees
+	const int numTriangles = checkQuantizedTree(meanSplit.getQuantizedNodeArray(), 0);
+	EXPECT_EQ(checkQuantizedTree(sah.getQuantizedNodeArray(), 0), numTriangles);
+	EXPECT_EQ(sah.calculateSerializeBufferSize(), sizeof(btQuantizedBvh) + (2 * numTriangles - 1) * sizeof(btQuantizedBvhNode) + sah.getSubtreeInfoArray().size() * sizeof(btBvhSubtreeInfo));
+	for (int i = 0; i < sah.getSubtreeInfoArray().size(); ++i)
+	{
+		const btBvhSubtreeInfo& subtree = sah.getSubtreeInfoArray()[i];
+		const btQuantizedBvhNode& root = sah.getQuantizedNodeArray()[subtree.m_rootNodeIndex];
+		EXPECT_EQ(subtree.m_subtreeSize, root.isLeafNode() ? 1 : root.getEscapeIndex());
+		EXPECT_LE(subtree.m_subtreeSize * (int)sizeof(btQuantizedBvhNode), MAX_SUBTREE_SIZE_IN_BYTES);
+	}
+
+	// boxes of 1/32 of the landscape and rays across all of it
+	btAlignedObjectArray<btVector3> points;
+	randomQueries(aabbMin, aabbMax, 4000, points);
+	const btVector3 extent = (aabbMax - aabbMin) * btScalar(1. / 64.);
+	int meanSplitCost = 0;
+	int sahCost = 0;
+	int numHits = 0;
+	for (int i = 0; i < points.size(); i += 2)
+	{
+		CollectNodes expected, actual;
+		meanSplit.reportAabbOverlappingNodex(&expected, points[i] - extent, points[i] + extent);
+		sah.reportAabbOverlappingNodex(&actual, points[i] - extent, points[i] + extent);
+		numHits += expected.hits.size();
+		expectSameHits(expected.hits, actual.hits);
+
+		unsigned short queryMin[3], queryMax[3];
+		sah.quantizeWithClamp(queryMin, points[i] - extent, 0);
+		sah.quantizeWithClamp(queryMax, points[i] + extent, 1);
+		meanSplitCost += quantizedQueryCost(meanSplit.getQuantizedNodeArray(), 0, queryMin, queryMax);
+		sahCost += quantizedQueryCost(sah.getQuantizedNodeArray(), 0, queryMin, queryMax);
+
+		CollectNodes expectedRay, actualRay;
+		meanSplit.reportRayOverlappingNodex(&expectedRay, points[i], points[i + 1]);
+		sah.reportRayOverlappingNodex(&actualRay, points[i], points[i + 1]);
+		expectSameHits(expectedRay.hits, actualRay.hits);
+	}
+	EXPECT_GT(numHits, 0);
+	EXPECT_LT(sahCost, meanSplitCost);
+
+	CollectNodes collect;
+	clock.reset();
+	for (int i = 0; i < points.size(); i += 2)
+		meanSplit.reportRayOverlappingNodex(&collect, points[i], points[i + 1]);
+	const unsigned long meanSplitRayTime = clock.getTimeMicroseconds();
+	clock.reset();
+	for (int i = 0; i < points.size(); i += 2)
+		sah.reportRayOverlappingNodex(&collect, points[i], points[i + 1]);
+	const unsigned long sahRayTime = clock.getTimeMicroseconds();
+	printf("landscape, %d triangles: build %lu us mean split, %lu us SAH, %d aabb queries test %d nodes mean split, %d SAH, %d rays %lu us mean split, %lu us SAH\n",
+		   numTriangles, meanSplitBuildTime, sahBuildTime, points.size() / 2, meanSplitCost, sahCost, points.size() / 2, meanSplitRayTime, sahRayTime);
+}
+
+TEST(BulletCollisionTest, QuantizedBvh_MappedFile)
+{
+	btTriangleIndexVertexArray mesh;
+	makeLandscape(mesh);
+	btBvhTriangleMeshShape built(&mesh, true, false);
+	built.setUseSurfaceAreaHeuristic(true);
+	built.buildOptimizedBvh();
+
+	// bake the tree into a file like an offline tool would
+	const char* fileName = "Test_Collision_landscape.bvh";
+	btOptimizedBvh* bvh = built.getOptimizedBvh();
+	const unsigned size = bvh->calculateSerializeBufferSize();
+	void* buffer = btAlignedAlloc(size, 16);
+	ASSERT_TRUE(bvh->serializeInPlace(buffer, size, false));
+	FILE* file = fopen(fileName, "wb");
+	ASSERT_TRUE(file != 0);
+	fwrite(buffer, 1, size, file);
+	fclose(file);
+	btAlignedFree(buffer);
+
+	{
+		btMappedFile mapped;
+		ASSERT_TRUE(mapped.open(fileName));
+		EXPECT_EQ(mapped.getSize(), size);
+		btBvhTriangleMeshShape loaded(&mesh, true, false);
+		EXPECT_FALSE(loaded.setMappedOptimizedBvh(mapped.getData(), size / 2));
+		ASSERT_TRUE(loaded.setMappedOptimizedBvh(mapped.getData(), (unsigned int)mapped.getSize()));
+
+		// the nodes are used where they are in the mapping, which is read-only, so any write would crash
+		const char* nodes = (const char*)&loaded.getOptimizedBvh()->getQuantizedNodeArray()[0];
+		EXPECT_TRUE(nodes > (const char*)mapped.getData() && nodes < (const char*)mapped.getData() + mapped.getSize());
+		// serialize only writes the nodes in use, buildTree leaves one spare
+		EXPECT_EQ(loaded.getOptimizedBvh()->getQuantizedNodeArray().size(), bvh->getQuantizedNodeArray().size() - 1);
+
+		btVector3 aabbMin, aabbMax;
+		mesh.calculateAabbBruteForce(aabbMin, aabbMax);
+		btAlignedObjectArray<btVector3> points;
+		randomQueries(aabbMin, aabbMax, 500, points);
+		const btVector3 extent = (aabbMax - aabbMin) * btScalar(1. / 64.);
+		for (int i = 0; i < points.size(); i += 2)
+		{
+			CollectTriangles expected, actual;
+			built.processAllTriangles(&expected, points[i] - extent, points[i] + extent);
+			loaded.processAllTriangles(&actual, points[i] - extent, points[i] + extent);
+			expectSameHits(expected.hits, actual.hits);
+
+			CollectTriangles expectedRay, actualRay;
+			built.performRaycast(&expectedRay, points[i], points[i + 1]);
+			loaded.performRaycast(&actualRay, points[i], points[i + 1]);
+			expectSameHits(expectedRay.hits, actualRay.hits);
+		}
+	}
+	remove(fileName);
+}
+
+
+// Rolling hills with ridges, in [0, 200]
+static btScalar terrainHeight(int x, int z)
+{
+	const btScalar fx = btScalar(x), fz = btScalar(z);
+	btScalar h = 100 + 60 * btSin(fx * btScalar(0.0031)) * btCos(fz * btScalar(0.0027));
+	h += 25 * btSin(fx * btScalar(0.021) + fz * btScalar(0.017));
+	h += 10 * btSin(fx * btScalar(0.13)) * btSin(fz * btScalar(0.11));
+	h += btScalar(((x * 73856093) ^ (z * 19349663)) & 1023) / btScalar(1024.);
+	return btMax(btScalar(0), btMin(btScalar(200), h));
+}
+
+// The same terrain stored as float, short and unsigned char
+struct TerrainData
+{
+	int width;
+	int length;
+	btAlignedObjectArray<float> heightsFloat;
+	btAlignedObjectArray<short> heightsShort;
+	btAlignedObjectArray<unsigned char> heightsUchar;
+
+	TerrainData(int width, int length) : width(width), length(length)
+	{
+		heightsFloat.resize(width * length);
+		heightsShort.resize(width * length);
+		heightsUchar.resize(width * length);
+		for (int z = 0; z < length; ++z)
+		{
+			for (int x = 0; x < width; ++x)
+			{
+				const btScalar h = terrainHeight(x, z);
+				heightsFloat[x + z * width] = float(h);
+				heightsShort[x + z * width] = short(h / btScalar(0.01));
+				heightsUchar[x + z * width] = (unsigned char)(h * btScalar(255. / 200.));
+			}
+		}
+	}
+
+	btHeightfieldTerrainShape* createShape(PHY_ScalarType type, int upAxis) const
+	{
+		switch (type)
+		{
+			case PHY_SHORT:
+				return new btHeightfieldTerrainShape(width, length, &heightsShort[0], btScalar(0.01), 0, 200, upAxis, false);
+			case PHY_UCHAR:
+				return new btHeightfieldTerrainShape(width, length, &heightsUchar[0], btScalar(200. / 255.), 0, 200, upAxis, false);
+			default:
+				return new btHeightfieldTerrainShape(width, length, &heightsFloat[0], btScalar(0), btScalar(200), upAxis, false);
+		}
+	}
+};
+
+static const char* heightTypeName(PHY_ScalarType type)
+{
+	return type == PHY_SHORT ? "short" : type == PHY_UCHAR ? "uchar" : "float";
+}
+
+// a point in local shape coordinates, from grid coordinates and a height above the bottom of the aabb
+static btVector3 terrainPoint(const btHeightfieldTerrainShape& shape, btScalar x, btScalar z, btScalar height)
+{
+	btVector3 aabbMin, aabbMax;
+	shape.getAabb(btTransform::getIdentity(), aabbMin, aabbMax);
+	const btVector3 localMin = aabbMin + btVector3(shape.getMargin(), shape.getMargin(), shape.getMargin());
+	const btVector3& scaling = shape.getLocalScaling();
+	btVector3 point;
+	const int up = shape.getUpAxis();
+	const int axisX = up == 0 ? 1 : 0;
+	const int axisZ = up == 2 ? 1 : 2;
+	point[axisX] = localMin[axisX] + x * btFabs(scaling[axisX]);
+	point[axisZ] = localMin[axisZ] + z * btFabs(scaling[axisZ]);
+	point[up] = localMin[up] + height * btFabs(scaling[up]);
+	return point;
+}
+
+// Two-sided segment against triangle, like btTriangleRaycastCallback without the closest hit filtering
+struct CollectRayHits : public btTriangleCallback
+{
+	btVector3 from;
+	btVector3 to;
+	btAlignedObjectArray<int> hits;
+	int numTriangles;
+
+	CollectRayHits(const btVector3& from, const btVector3& to) : from(from), to(to), numTriangles(0) {}
+
+	void processTriangle(btVector3* triangle, int partId, int triangleIndex) BT_OVERRIDE
+	{
+		++numTriangles;
+		const btVector3 dir = to - from;
+		const btVector3 e1 = triangle[1] - triangle[0];
+		const btVector3 e2 = triangle[2] - triangle[0];
+		const btVector3 p = dir.cross(e2);
+		const btScalar det = e1.dot(p);
+		if (btFabs(det) < SIMD_EPSILON)
+			return;
+		const btVector3 s = from - triangle[0];
+		const btScalar u = s.dot(p) / det;
+		if (u < 0 || u > 1)
+			return;
+		const btVector3 q = s.cross(e1);
+		const btScalar v = dir.dot(q) / det;
+		if (v < 0 || u + v > 1)
+			return;
+		const btScalar fraction = e2.dot(q) / det;
+		if (fraction >= 0 && fraction <= 1)
+			hits.push_back(partId * 100000 + triangleIndex);
+	}
+};
+
+struct CountTriangles : public btTriangleCallback
+{
+	int numTriangles;
+	CountTriangles() : numTriangles(0) {}
+	void processTriangle(btVector3*, int, int) BT_OVERRIDE { ++numTriangles; }
+};
+
+TEST(BulletCollisionTest, Heightfield_Accelerator_MatchesBruteForce)
+{
+	// not a power of two, and not a multiple of the chunk sizes
+	const TerrainData terrain(203, 157);
+	const PHY_ScalarType types[] = {PHY_FLOAT, PHY_SHORT, PHY_UCHAR};
+	const int chunkSizes[] = {1, 4, 16};
+	for (int t = 0; t < 3; ++t)
+	{
+		for (int upAxis = 0; upAxis < 3; ++upAxis)
+		{
+			btHeightfieldTerrainShape* reference = terrain.createShape(types[t], upAxis);
+			btHeightfieldTerrainShape* accelerated = terrain.createShape(types[t], upAxis);
+			if (upAxis == 1)
+			{
+				const btVector3 scaling(btScalar(2.), btScalar(0.5), btScalar(1.5));
+				reference->setLocalScaling(scaling);
+				accelerated->setLocalScaling(scaling);
+			}
+			for (int c = 0; c < 3; ++c)
+			{
+				SCOPED_TRACE(testing::Message() << heightTypeName(types[t]) << ", up axis " << upAxis << ", chunk size " << chunkSizes[c]);
+				accelerated->buildAccelerator(chunkSizes[c]);
+				srand(1357);
+				int numAabbHits = 0;
+				int numRayHits = 0;
+				for (int i = 0; i < 300; ++i)
+				{
+					const btVector3 center = terrainPoint(*reference, btScalar(rand() % 2200) / 10 - 5, btScalar(rand() % 1700) / 10 - 5, btScalar(rand() % 2200) / 10);
+					const btScalar size = btScalar(1 + rand() % 300) / 20;
+					const btVector3 extents(size, size * btScalar(rand() % 100) / 100, size);
+					CollectTriangles expected, actual;
+					reference->processAllTriangles(&expected, center - extents, center + extents);
+					accelerated->processAllTriangles(&actual, center - extents, center + extents);
+					numAabbHits += expected.hits.size();
+					expectSameHits(expected.hits, actual.hits);
+
+					// long rays across the terrain, and short ones like the rays of vehicle wheels
+					const btVector3 to = terrainPoint(*reference, btScalar(rand() % 2000) / 10, btScalar(rand() % 1500) / 10, btScalar(rand() % 2000) / 10);
+					const btVector3 from = (i & 1) ? terrainPoint(*reference, btScalar(rand() % 2000) / 10, btScalar(rand() % 1500) / 10, btScalar(rand() % 2400) / 10) : to + btVector3(btScalar(0.3), btScalar(2.), btScalar(-0.2));
+					CollectRayHits expectedRay(from, to), actualRay(from, to);
+					reference->performRaycast(&expectedRay, from, to);
+					accelerated->performRaycast(&actualRay, from, to);
+					numRayHits += expectedRay.hits.size();
+					expectSameHits(expectedRay.hits, actualRay.hits);
+				}
+				EXPECT_GT(numAabbHits, 0);
+				EXPECT_GT(numRayHits, 0);
+			}
+			delete reference;
+			delete accelerated;
+		}
+	}
+}
+
+static void heightfieldQueries(const char* name, const btHeightfieldTerrainShape& shape, PHY_ScalarType type, unsigned long buildTime)
+{
+	const int numCells = 4095;
+	btClock clock;
+
+	// long rays from above the hills down to the far side of the terrain
+	srand(2468);
+	int numTriangles = 0;
+	int numHits = 0;
+	for (int i = 0; i < 1000; ++i)
+	{
+		const btVector3 from = terrainPoint(shape, btScalar(rand() % numCells), btScalar(rand() % numCells), 220);
+		const btVector3 to = terrainPoint(shape, btScalar(rand() % numCells), btScalar(rand() % numCells), 60);
+		CollectRayHits ray(from, to);
+		shape.performRaycast(&ray, from, to);
+		numTriangles += ray.numTriangles;
+		numHits += ray.hits.size() > 0;
+	}
+	const unsigned long longRayTime = clock.getTimeMicroseconds();
+
+	// four rays per vehicle, along the suspension of a slightly tilted chassis
+	clock.reset();
+	int numWheelTriangles = 0;
+	for (int i = 0; i < 25000; ++i)
+	{
+		const int x = 1 + rand() % (numCells - 2), z = 1 + rand() % (numCells - 2);
+		const btVector3 ground = terrainPoint(shape, btScalar(x) + btScalar(0.5), btScalar(z) + btScalar(0.5), terrainHeight(x, z));
+		for (int w = 0; w < 4; ++w)
+		{
+			const btVector3 from = ground + btVector3(btScalar(w & 1) * 2, 1, btScalar(w >> 1) * 3);
+			const btVector3 to = from + btVector3(btScalar(0.2), btScalar(-1.6), btScalar(0.1));
+			CollectRayHits ray(from, to);
+			shape.performRaycast(&ray, from, to);
+			numWheelTriangles += ray.numTriangles;
+		}
+	}
+	const unsigned long wheelRayTime = clock.getTimeMicroseconds();
+
+	// wheel shapes rolling on the terrain or in the air
+	clock.reset();
+	int numWheelAabbTriangles = 0;
+	for (int i = 0; i < 100000; ++i)
+	{
+		const int x = 1 + rand() % (numCells - 2), z = 1 + rand() % (numCells - 2);
+		const btScalar clearance = btScalar(rand() % 200) / 100 - btScalar(0.3);
+		const btVector3 center = terrainPoint(shape, btScalar(x), btScalar(z), terrainHeight(x, z) + clearance);
+		const btVector3 extents(btScalar(0.4), btScalar(0.4), btScalar(0.4));
+		CountTriangles count;
+		shape.processAllTriangles(&count, center - extents, center + extents);
+		numWheelAabbTriangles += count.numTriangles;
+	}
+	const unsigned long wheelAabbTime = clock.getTimeMicroseconds();
+
+	// the aabbs of aircraft and debris flying over the terrain
+	clock.reset();
+	int numLargeAabbTriangles = 0;
+	for (int i = 0; i < 2000; ++i)
+	{
+		const btVector3 center = terrainPoint(shape, btScalar(rand() % numCells), btScalar(rand() % numCells), 150 + btScalar(rand() % 60));
+		const btVector3 extents(20, 5, 20);
+		CountTriangles count;
+		shape.processAllTriangles(&count, center - extents, center + extents);
+		numLargeAabbTriangles += count.numTriangles;
+	}
+	const unsigned long largeAabbTime = clock.getTimeMicroseconds();
+
+	printf("4k x 4k %s, %s: build %lu us, 1000 long rays %lu us (%d triangles, %d hits), 100000 wheel rays %lu us (%d triangles), 100000 wheel aabbs %lu us (%d triangles), 2000 large aabbs %lu us (%d triangles)\n",
+		   heightTypeName(type), name, buildTime, longRayTime, numTriangles, numHits, wheelRayTime, numWheelTriangles, wheelAabbTime, numWheelAabbTriangles, largeAabbTime, numLargeAabbTriangles);
+}
+
+TEST(BulletCollisionTest, Heightfield_Accelerator_Benchmark4k)
+{
+	const TerrainData terrain(4096, 4096);
+	const PHY_ScalarType types[] = {PHY_FLOAT, PHY_SHORT, PHY_UCHAR};
+	for (int t = 0; t < 3; ++t)
+	{
+		btHeightfieldTerrainShape* shape = terrain.createShape(types[t], 1);
+		heightfieldQueries("no accelerator", *shape, types[t], 0);
+		btClock clock;
+		shape->buildAccelerator();
+		EXPECT_EQ(shape->getNumAcceleratorLevels(), 9);
+		heightfieldQueries("chunk size 16", *shape, types[t], clock.getTimeMicroseconds());
+		clock.reset();
+		shape->buildAccelerator(4);
+		EXPECT_EQ(shape->getNumAcceleratorLevels(), 11);
+		heightfieldQueries("chunk size 4", *shape, types[t], clock.getTimeMicroseconds());
+		delete shape;
+	}
+}
+
 }  // namespace
 
 int main(int argc, char** argv)
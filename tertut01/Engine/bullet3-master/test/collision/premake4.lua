@@ -37,6 +37,16 @@
 		"../../src/BulletCollision/CollisionShapes/btConvexInternalShape.cpp",
 		"../../src/BulletCollision/CollisionShapes/btCollisionShape.cpp",
 		"../../src/BulletCollision/CollisionShapes/btConvexPolyhedron.cpp",
+		"../../src/BulletCollision/BroadphaseCollision/btDbvt.cpp",
+		"../../src/BulletCollision/BroadphaseCollision/btDbvtBroadphase.cpp",
+		"../../src/BulletCollision/BroadphaseCollision/btOverlappingPairCache.cpp",
+		"../../src/BulletCollision/BroadphaseCollision/btOpenAddressingPairCache.cpp",
+		"../../src/BulletCollision/BroadphaseCollision/btQuantizedBvh.cpp",
+		"../../src/BulletCollision/CollisionShapes/btOptimizedBvh.cpp",
+		"../../src/BulletCollision/CollisionShapes/btBvhTriangleMeshShape.cpp",
+		"../../src/BulletCollision/CollisionShapes/btTriangleMeshShape.cpp",
+		"../../src/BulletCollision/CollisionShapes/btStridingMeshInterface.cpp",
+		"../../src/BulletCollision/CollisionShapes/btTriangleIndexVertexArray.cpp",
 
 	}
 
@@ -9,6 +9,9 @@
 
 using namespace DirectX;
 
+int ModelClass::s_drawCallCount = 0;
+size_t ModelClass::s_bufferBytes = 0;
+
 /// Constructor to initialize member variables.
 ModelClass::ModelClass()
 {
@@ -19,6 +22,8 @@ ModelClass::ModelClass()
 /// Destructor to clean up resources.
 ModelClass::~ModelClass()
 {
+	// Planet models are created and destroyed while streaming, so release the GPU buffers with them.
+	ShutdownBuffers();
 }
 
 /// Initializes the model by loading it from a file and setting up buffers.
@@ -155,6 +160,7 @@ void ModelClass::Render(ID3D11DeviceContext* deviceContext)
 	// Put the vertex and index buffers on the graphics pipeline to prepare them for drawing.
 	RenderBuffers(deviceContext);
 	deviceContext->DrawIndexed(m_indexCount, 0, 0);
+	++s_drawCallCount;
 
 	return;
 }
@@ -178,6 +184,9 @@ bool ModelClass::InitializeBuffers(ID3D11Device* device)
 	HRESULT result;
 	int i;
 
+	// Release the buffers of a previous initialisation, e.g. after the device was restored.
+	ShutdownBuffers();
+
 	// Create the vertex array.
 	vertices = new VertexType[m_vertexCount];
 	if (!vertices)
@@ -244,6 +253,10 @@ bool ModelClass::InitializeBuffers(ID3D11Device* device)
 		return false;
 	}
 
+	// Track the buffer sizes for the telemetry panel.
+	m_bufferBytes = vertexBufferDesc.ByteWidth + indexBufferDesc.ByteWidth;
+	s_bufferBytes += m_bufferBytes;
+
 	// Release the arrays now that the vertex and index buffers have been created and loaded.
 	delete[] vertices;
 	vertices = 0;
@@ -271,6 +284,9 @@ void ModelClass::ShutdownBuffers()
 		m_vertexBuffer = 0;
 	}
 
+	s_bufferBytes -= m_bufferBytes;
+	m_bufferBytes = 0;
+
 	return;
 }
 
@@ -68,6 +68,17 @@ public:
     /// @return Pointer to the shader resource view of the diffuse texture.
     ID3D11ShaderResourceView* GetTexture();
 
+    /// Retrieves the number of draw calls issued by all models since the last reset.
+    /// @return The draw call count.
+    static int GetDrawCallCount() { return s_drawCallCount; }
+
+    /// Resets the shared draw call counter, typically at the start of a frame.
+    static void ResetDrawCallCount() { s_drawCallCount = 0; }
+
+    /// Retrieves the size of the vertex and index buffers held by all models.
+    /// @return The buffer size in bytes.
+    static size_t GetBufferBytes() { return s_bufferBytes; }
+
 private:
     /// Initializes the vertex and index buffers for the model.
     /// @param device Pointer to the Direct3D device.
@@ -118,6 +129,11 @@ private:
     std::string m_normalTextureFilename;
     std::string m_emissiveTextureFilename;
 
+    // Telemetry shared by every model.
+    static int s_drawCallCount; ///< Draw calls issued since the last reset.
+    static size_t s_bufferBytes; ///< Bytes held by live vertex and index buffers.
+    size_t m_bufferBytes = 0; ///< Bytes held by this model's buffers.
+
     // Texture resources.
     Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> m_diffuseTexture;
     Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> m_roughnessTexture;